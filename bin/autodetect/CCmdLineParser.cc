@@ -52,6 +52,10 @@ bool CCmdLineParser::parse(int argc,
                            bool& memoryUsage,
                            std::size_t& bucketResultsDelay,
                            bool& multivariateByFields,
+                           std::size_t& numberThreads,
+                           bool& binaryState,
+                           std::size_t& recordBatchSize,
+                           bool& pipelineInput,
                            TStrVec& clauseTokens) {
     try {
         boost::program_options::options_description desc(DESCRIPTION);
@@ -115,6 +119,14 @@ bool CCmdLineParser::parse(int argc,
                         "The numer of half buckets to store before choosing which overlapping bucket has the biggest anomaly")
             ("multivariateByFields",
                         "Optional flag to enable multi-variate analysis of correlated by fields")
+            ("numberThreads", boost::program_options::value<std::size_t>(),
+                        "Optional number of threads to use to process detectors when a bucket is closed and to forecast - default is 1")
+            ("binaryState",
+                        "Optional flag to persist state in a compact binary format rather than JSON")
+            ("recordBatchSize", boost::program_options::value<std::size_t>(),
+                        "Optional number of records to hold before adding them to the detectors in batches - default is 1")
+            ("pipelineInput",
+                        "Optional flag to parse input on a separate thread from the one which processes it")
         ;
         // clang-format on
 
@@ -228,6 +240,18 @@ bool CCmdLineParser::parse(int argc,
         if (vm.count("multivariateByFields") > 0) {
             multivariateByFields = true;
         }
+        if (vm.count("numberThreads") > 0) {
+            numberThreads = vm["numberThreads"].as<std::size_t>();
+        }
+        if (vm.count("binaryState") > 0) {
+            binaryState = true;
+        }
+        if (vm.count("recordBatchSize") > 0) {
+            recordBatchSize = vm["recordBatchSize"].as<std::size_t>();
+        }
+        if (vm.count("pipelineInput") > 0) {
+            pipelineInput = true;
+        }
 
         boost::program_options::collect_unrecognized(
             parsed.options, boost::program_options::include_positional)
@@ -64,6 +64,10 @@ public:
                       bool& memoryUsage,
                       std::size_t& bucketResultsDelay,
                       bool& multivariateByFields,
+                      std::size_t& numberThreads,
+                      bool& binaryState,
+                      std::size_t& recordBatchSize,
+                      bool& pipelineInput,
                       TStrVec& clauseTokens);
 
 private:
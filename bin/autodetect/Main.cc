@@ -88,6 +88,10 @@ int main(int argc, char** argv) {
     bool memoryUsage(false);
     std::size_t bucketResultsDelay(0);
     bool multivariateByFields(false);
+    std::size_t numberThreads(1);
+    bool binaryState(false);
+    std::size_t recordBatchSize(1);
+    bool pipelineInput(false);
     TStrVec clauseTokens;
     if (ml::autodetect::CCmdLineParser::parse(
             argc, argv, limitConfigFile, modelConfigFile, fieldConfigFile,
@@ -97,7 +101,8 @@ int main(int argc, char** argv) {
             maxQuantileInterval, inputFileName, isInputFileNamedPipe, outputFileName,
             isOutputFileNamedPipe, restoreFileName, isRestoreFileNamedPipe,
             persistFileName, isPersistFileNamedPipe, maxAnomalyRecords, memoryUsage,
-            bucketResultsDelay, multivariateByFields, clauseTokens) == false) {
+            bucketResultsDelay, multivariateByFields, numberThreads, binaryState,
+            recordBatchSize, pipelineInput, clauseTokens) == false) {
         return EXIT_FAILURE;
     }
 
@@ -222,7 +227,8 @@ int main(int argc, char** argv) {
                              boost::bind(&ml::api::CModelSnapshotJsonWriter::write,
                                          &modelSnapshotWriter, _1),
                              periodicPersister.get(), maxQuantileInterval,
-                             timeField, timeFormat, maxAnomalyRecords);
+                             timeField, timeFormat, maxAnomalyRecords,
+                             numberThreads, binaryState, recordBatchSize);
 
     if (!quantilesStateFile.empty()) {
         if (job.initNormalizer(quantilesStateFile) == false) {
@@ -257,7 +263,7 @@ int main(int argc, char** argv) {
 
     // The skeleton avoids the need to duplicate a lot of boilerplate code
     ml::api::CCmdSkeleton skeleton(restoreSearcher.get(), persister.get(),
-                                   *inputParser, *firstProcessor);
+                                   *inputParser, *firstProcessor, pipelineInput);
     bool ioLoopSucceeded(skeleton.ioLoop());
 
     // Unfortunately we cannot rely on destruction to finalise the output writer
@@ -43,7 +43,8 @@ public:
                       bool& isOutputFileNamedPipe,
                       std::string& quantilesState,
                       bool& deleteStateFiles,
-                      bool& writeCsv);
+                      bool& writeCsv,
+                      std::size_t& numberThreads);
 
 private:
     static const std::string DESCRIPTION;
@@ -54,10 +54,12 @@ int main(int argc, char** argv) {
     std::string quantilesStateFile;
     bool deleteStateFiles(false);
     bool writeCsv(false);
+    std::size_t numberThreads(1);
     if (ml::normalize::CCmdLineParser::parse(
-            argc, argv, modelConfigFile, logProperties, logPipe, bucketSpan, lengthEncodedInput,
-            inputFileName, isInputFileNamedPipe, outputFileName, isOutputFileNamedPipe,
-            quantilesStateFile, deleteStateFiles, writeCsv) == false) {
+            argc, argv, modelConfigFile, logProperties, logPipe, bucketSpan,
+            lengthEncodedInput, inputFileName, isInputFileNamedPipe, outputFileName,
+            isOutputFileNamedPipe, quantilesStateFile, deleteStateFiles, writeCsv,
+            numberThreads) == false) {
         return EXIT_FAILURE;
     }
 
@@ -115,7 +117,7 @@ int main(int argc, char** argv) {
     }()};
 
     // This object will do the work
-    ml::api::CResultNormalizer normalizer(modelConfig, *outputWriter);
+    ml::api::CResultNormalizer normalizer(modelConfig, *outputWriter, numberThreads);
 
     // Restore state
     if (!quantilesStateFile.empty()) {
@@ -130,7 +132,8 @@ int main(int argc, char** argv) {
 
     // Now handle the numbers to be normalised from stdin
     if (inputParser->readStream(boost::bind(&ml::api::CResultNormalizer::handleRecord,
-                                            &normalizer, _1)) == false) {
+                                            &normalizer, _1)) == false ||
+        normalizer.finalise() == false) {
         LOG_FATAL(<< "Failed to handle input to be normalized");
         return EXIT_FAILURE;
     }
@@ -0,0 +1,30 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include <core/CLogger.h>
+#include <core/CWordDictionary.h>
+
+#include <iostream>
+
+#include <stdlib.h>
+
+using namespace ml;
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "Utility to compile the word dictionary into an image which "
+                     "can be memory mapped"
+                  << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <dictionary file> <compiled file>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (core::CWordDictionary::compile(argv[1], argv[2]) == false) {
+        LOG_FATAL(<< "Unable to compile " << argv[1] << " into " << argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
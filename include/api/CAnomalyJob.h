@@ -25,6 +25,7 @@
 #include <api/CForecastRunner.h>
 #include <api/CJsonOutputWriter.h>
 #include <api/CModelSnapshotJsonWriter.h>
+#include <api/CRecordView.h>
 #include <api/ImportExport.h>
 
 #include <boost/unordered_map.hpp>
@@ -46,6 +47,7 @@ namespace core {
 class CDataAdder;
 class CDataSearcher;
 class CStateRestoreTraverser;
+class CStaticThreadPool;
 }
 namespace model {
 class CHierarchicalResults;
@@ -70,6 +72,19 @@ class CFieldConfig;
 //! handler to be a CJsonOutputWriter rather than a writer for an
 //! arbitrary format
 //!
+//! If more than one thread is requested, the detectors' work to close
+//! a bucket, i.e. sampling, computing results and generating model plot,
+//! is shared over a pool of threads. Each detector writes to its own
+//! results object and these are merged in the detectors' sorted order,
+//! so the output is the same as when the detectors are processed one
+//! at a time. The same pool is used by the individual models to sample
+//! their people concurrently.
+//!
+//! State can be persisted in JSON, the default, or in a compact binary
+//! format which is much faster to persist and restore for large jobs.
+//! The format is detected when state is restored so either can be read
+//! whichever is selected for persistence.
+//!
 class API_EXPORT CAnomalyJob : public CDataProcessor {
 public:
     //! Elasticsearch index for state
@@ -160,7 +175,10 @@ public:
                 core_t::TTime maxQuantileInterval = -1,
                 const std::string& timeFieldName = DEFAULT_TIME_FIELD_NAME,
                 const std::string& timeFieldFormat = EMPTY_STRING,
-                size_t maxAnomalyRecords = 0u);
+                size_t maxAnomalyRecords = 0u,
+                std::size_t numberThreads = 1,
+                bool binaryState = false,
+                std::size_t recordBatchSize = 1);
 
     virtual ~CAnomalyJob();
 
@@ -174,6 +192,10 @@ public:
     //! with any required modifications
     virtual bool handleRecord(const TStrStrUMap& dataRowFields);
 
+    //! Receive a single record to be processed whose fields can be
+    //! addressed by index.
+    virtual bool handleRecordView(const CRecordView& record);
+
     //! Perform any final processing once all input data has been seen.
     virtual void finalise();
 
@@ -203,10 +225,71 @@ public:
     //! here.
     const SRestoredStateDetail& restoreStateStatus() const;
 
+private:
+    using TBoolVec = std::vector<bool>;
+    using TSizeVec = std::vector<std::size_t>;
+    using TSizeVecVec = std::vector<TSizeVec>;
+    using TSizeSizePr = std::pair<std::size_t, std::size_t>;
+    using TSizeSizePrVec = std::vector<TSizeSizePr>;
+
+    //! \brief A detector to which records are routed.
+    struct SRoutedDetector {
+        //! The detector or null if it hasn't been created yet.
+        TAnomalyDetectorPtr s_Detector;
+        //! The position of the detector's pending records in
+        //! m_DetectorBatches. This is stale if that batch is for
+        //! another detector.
+        std::size_t s_Batch = 0;
+    };
+    using TRoutedDetectorVec = std::vector<SRoutedDetector>;
+    using TStrRoutedDetectorVecUMap = boost::unordered_map<std::string, TRoutedDetectorVec>;
+
+    //! \brief Routes records to the detectors of the keys which share
+    //! a partition field.
+    //!
+    //! DESCRIPTION:\n
+    //! Caches the detectors of these keys for each value of the partition
+    //! field, so finding them for a record needs one lookup of the value
+    //! rather than one lookup in m_Detectors for each key. The cache holds
+    //! at most m_MaxCachedPartitionValues values and is emptied when it is
+    //! full, since m_Detectors still holds every detector.
+    struct SPartitionRoute {
+        explicit SPartitionRoute(std::size_t fieldSlot);
+
+        //! The slot of the partition field in m_RecordFieldIndices.
+        std::size_t s_FieldSlot;
+        //! The number of keys with this partition field.
+        std::size_t s_NumberKeys;
+        //! The detectors of the keys for each partition field value.
+        TStrRoutedDetectorVecUMap s_Detectors;
+        //! The partition field value of the current record.
+        const std::string* s_CurrentValue;
+        //! The detectors for the current record or null if there are none.
+        TRoutedDetectorVec* s_CurrentDetectors;
+    };
+    using TPartitionRouteVec = std::vector<SPartitionRoute>;
+
+    //! \brief The pending records routed to one detector.
+    struct SDetectorBatch {
+        //! The detector.
+        model::CAnomalyDetector* s_Detector;
+        //! The index of the detector's key.
+        std::size_t s_Key;
+        //! The positions of the records in the pending records.
+        TSizeVec s_Records;
+    };
+    using TDetectorBatchVec = std::vector<SDetectorBatch>;
+
+    class CConcurrentRestore;
+
 private:
     //! NULL pointer that we can take a long-lived const reference to
     static const TAnomalyDetectorPtr NULL_DETECTOR;
 
+    //! The default maximum number of partition field values for which
+    //! each partition route caches detectors.
+    static const std::size_t MAX_CACHED_PARTITION_VALUES;
+
 private:
     //! Handle a control message.  The first character of the control
     //! message indicates its type.  Currently defined types are:
@@ -220,6 +303,22 @@ private:
     //! Write out the results for the bucket starting at \p bucketStartTime.
     void outputResults(core_t::TTime bucketStartTime);
 
+    //! Sample \p detectors, add their results for the bucket starting at
+    //! \p bucketStartTime to \p results and generate their model plot.
+    //!
+    //! The detectors are processed concurrently if we have a thread pool
+    //! and the results are added in the order of \p detectors.
+    void buildDetectorResults(core_t::TTime bucketStartTime,
+                              const TAnomalyDetectorPtrVec& detectors,
+                              model::CHierarchicalResults& results);
+
+    //! Build \p detector's results for the bucket starting at \p bucketStartTime
+    //! and generate its model plot.
+    void buildDetectorResults(core_t::TTime bucketStartTime,
+                              model::CAnomalyDetector& detector,
+                              model::CHierarchicalResults& results,
+                              TModelPlotDataVec& modelPlots);
+
     //! Write out interim results for the bucket starting at \p bucketStartTime.
     void outputInterimResults(core_t::TTime bucketStartTime);
 
@@ -242,12 +341,16 @@ private:
                       std::size_t& numDetectors);
 
     //! Attempt to restore one detector from an already-created traverser.
-    bool restoreSingleDetector(core::CStateRestoreTraverser& traverser);
+    //! If \p concurrentRestore is non-null the detector's state is handed
+    //! to it to be restored on the thread pool.
+    bool restoreSingleDetector(CConcurrentRestore* concurrentRestore,
+                               core::CStateRestoreTraverser& traverser);
 
     //! Restore the detector identified by \p key and \p partitionFieldValue
-    //! from \p traverser.
+    //! from \p traverser, using \p concurrentRestore if it is non-null.
     bool restoreDetectorState(const model::CSearchKey& key,
                               const std::string& partitionFieldValue,
+                              CConcurrentRestore* concurrentRestore,
                               core::CStateRestoreTraverser& traverser);
 
     //! Persist current state in the background
@@ -333,7 +436,8 @@ private:
     //! specified time range.
     void generateModelPlot(core_t::TTime startTime,
                            core_t::TTime endTime,
-                           const model::CAnomalyDetector& detector);
+                           const model::CAnomalyDetector& detector,
+                           TModelPlotDataVec& modelPlots);
 
     //! Write the pre-generated model plot to the output stream of the user's
     //! choosing: either file or streamed to the API
@@ -369,14 +473,40 @@ private:
     //! Populate detector keys from the field config.
     void populateDetectorKeys(const CFieldConfig& fieldConfig, TKeyVec& keys);
 
-    //! Extract the field called \p fieldName from \p dataRowFields.
-    const std::string* fieldValue(const std::string& fieldName, const TStrStrUMap& dataRowFields);
+    //! Populate the detector keys and group them by partition field.
+    void compileRecordRoutes();
+
+    //! Get the slot in m_RecordFieldIndices of each of \p fieldNames.
+    //! Empty field names, which are never looked up, get CRecordView::NOT_FOUND.
+    void fieldSlots(const TStrVec& fieldNames, TSizeVec& slots);
 
-    //! Extract the required fields from \p dataRowFields
+    //! Extract the fields in \p fieldSlots from \p record
     //! and add the new record to \p detector
-    void addRecord(const TAnomalyDetectorPtr detector,
+    void addRecord(const TAnomalyDetectorPtr& detector,
                    core_t::TTime time,
-                   const TStrStrUMap& dataRowFields);
+                   const TSizeVec& fieldSlots,
+                   const CRecordView& record);
+
+    //! Get an upper bound on the memory adding \p record to all the
+    //! detectors it is routed to can add to the resource monitor.
+    std::size_t pendingMemoryBound(const CRecordView& record);
+
+    //! Reserve \p bound bytes for a record which is pending if adding
+    //! it later can't change whether the detectors may allocate memory.
+    //! Otherwise adds the pending records to their detectors.
+    //!
+    //! \return True if the record can be pending.
+    bool reservePendingMemory(std::size_t bound);
+
+    //! Copy the fields of \p record to the pending records.
+    void copyPendingRecord(core_t::TTime time, const CRecordView& record);
+
+    //! Mark the last pending record as routed to \p detector, which
+    //! is for the key at \p key.
+    void routePendingRecord(SRoutedDetector& detector, std::size_t key);
+
+    //! Add the pending records to their detectors in batches.
+    void addPendingRecords();
 
 protected:
     //! Get all the detectors.
@@ -426,6 +556,63 @@ private:
     //! Detector keys.
     TKeyVec m_DetectorKeys;
 
+    //! The indices of the fields this job reads from each record.
+    CRecordView::CFieldIndices m_RecordFieldIndices;
+
+    //! The slot of the control field in m_RecordFieldIndices.
+    std::size_t m_ControlFieldSlot;
+
+    //! The slot of the time field in m_RecordFieldIndices.
+    std::size_t m_TimeFieldSlot;
+
+    //! The routes of records to the detectors for each distinct partition
+    //! field.
+    TPartitionRouteVec m_PartitionRoutes;
+
+    //! The maximum number of partition field values for which each
+    //! partition route caches detectors.
+    std::size_t m_MaxCachedPartitionValues;
+
+    //! The route of each detector key and its position in the route.
+    TSizeSizePrVec m_KeyRoutes;
+
+    //! The slots of the fields of interest of each detector key's detectors.
+    TSizeVecVec m_FieldsOfInterestSlots;
+
+    //! The number of records to hold before adding them to the detectors.
+    std::size_t m_RecordBatchSize;
+
+    //! The times of the pending records, which haven't been added to the
+    //! detectors yet.
+    model::CAnomalyDetector::TTimeVec m_PendingTimes;
+
+    //! The number of fields of each pending record.
+    std::size_t m_PendingRecordSize;
+
+    //! The field values of the pending records by record then slot. These
+    //! are reused, so only the first m_PendingTimes.size() records are set.
+    TStrVec m_PendingValues;
+
+    //! True for the pending field values which were present in the record.
+    TBoolVec m_PendingValuesPresent;
+
+    //! The pending records of each detector in the order they were first
+    //! routed a record. These are reused, so only the first
+    //! m_NumberDetectorBatches are current.
+    TDetectorBatchVec m_DetectorBatches;
+
+    //! The number of current detector batches.
+    std::size_t m_NumberDetectorBatches;
+
+    //! The memory reserved for adding the pending records.
+    std::size_t m_PendingMemory;
+
+    //! The times of one detector batch's records.
+    model::CAnomalyDetector::TTimeVec m_BatchTimes;
+
+    //! The fields of interest of one detector batch's records.
+    model::CAnomalyDetector::TStrCPtrVecVec m_BatchFieldValues;
+
     //! Map of objects to provide the inner workings
     TKeyAnomalyDetectorPtrUMap m_Detectors;
 
@@ -486,6 +673,13 @@ private:
     //! result is output
     TModelPlotDataVecQueue m_ModelPlotQueue;
 
+    //! The pool used to process detectors concurrently. This is null
+    //! if the job is single threaded.
+    std::unique_ptr<core::CStaticThreadPool> m_ThreadPool;
+
+    //! Should state be persisted in the binary format?
+    bool m_BinaryState;
+
     friend class ::CBackgroundPersisterTest;
     friend class ::CAnomalyJobTest;
 };
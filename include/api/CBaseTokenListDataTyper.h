@@ -14,7 +14,6 @@
 #include <api/ImportExport.h>
 
 #include <iosfwd>
-#include <list>
 #include <map>
 #include <memory>
 #include <string>
@@ -49,6 +48,16 @@ class CTokenListReverseSearchCreatorIntf;
 //! only be used within a single thread.  Any multi-threaded access must
 //! be serialised with an external lock.
 //!
+//! Rather than comparing each string with every existing type, candidate
+//! types are found using an inverted index from token IDs to the types
+//! whose base tokens contain them.  Types which share too little token
+//! weight with the string to possibly exceed the lower threshold, and
+//! which can't match its reverse search, are never compared.  This relies
+//! on the similarity being no greater than the proportion of the larger
+//! token weight which is made up of shared tokens.  The candidates are
+//! compared in the same order as the exhaustive search would, so the types
+//! chosen are identical.
+//!
 //! The reverse search creator is shallow copied on copy construction and
 //! assignment, hence should have no state that changes after construction.
 //! (If this rule needs to be changed then some strategy for ensuring
@@ -151,25 +160,29 @@ protected:
                                     size_t& totalWeight) = 0;
 
     //! Compute similarity between two vectors
+    //!
+    //! \note This must not exceed the proportion of the larger weight made
+    //! up of tokens present in both vectors, which is true for any measure
+    //! based on the weighted edit distance.  The candidate type search
+    //! relies on this.
+    //!
+    //! If the similarity is less than \p minSimilarity then the exact value
+    //! isn't needed and implementations may return any value which is less
+    //! than \p minSimilarity, which allows them to stop early.
     virtual double similarity(const TSizeSizePrVec& left,
                               size_t leftWeight,
                               const TSizeSizePrVec& right,
-                              size_t rightWeight) const = 0;
-
-    //! Used to hold statistics about the types we compute:
-    //! first -> count of matches
-    //! second -> type vector index
-    using TSizeSizePrList = std::list<TSizeSizePr>;
-    using TSizeSizePrListItr = TSizeSizePrList::iterator;
+                              size_t rightWeight,
+                              double minSimilarity) const = 0;
 
-    //! Add a match to an existing type
+    //! Add a match to the type at \p position in the types sorted by count
     void addTypeMatch(bool isDryRun,
                       const std::string& str,
                       size_t rawStringLen,
                       const TSizeSizePrVec& tokenIds,
                       const TSizeSizeMap& tokenUniqueIds,
                       double similarity,
-                      TSizeSizePrListItr& iter);
+                      size_t position);
 
     //! Given the total token weight in a vector and a threshold, what is
     //! the minimum possible token weight in a different vector that could
@@ -231,6 +244,38 @@ private:
     //! not expensive because CTokenListType is movable)
     using TTokenListTypeVec = std::vector<CTokenListType>;
 
+    using TSizeVec = std::vector<size_t>;
+
+    //! \brief An entry in the inverted index from a token to the types
+    //! whose base tokens contain it.
+    struct STypeToken {
+        STypeToken(size_t type, size_t weight, size_t commonWeight);
+
+        //! The type vector index
+        size_t s_Type;
+        //! The total weight of the token in the type's base tokens
+        size_t s_Weight;
+        //! The weight of the token in the type's common unique tokens,
+        //! or zero if it isn't one of them
+        size_t s_CommonWeight;
+    };
+    using TTypeTokenVec = std::vector<STypeToken>;
+    using TTypeTokenVecVec = std::vector<TTypeTokenVec>;
+
+    //! \brief The token weight a string shares with a type.
+    struct SSharedTokens {
+        SSharedTokens();
+
+        //! The weight of the shared tokens in the string
+        size_t s_Weight;
+        //! The weight of the shared tokens in the type's base tokens
+        size_t s_TypeWeight;
+        //! The number of the type's common unique tokens the string has
+        //! with the same weight
+        size_t s_CommonTokens;
+    };
+    using TSharedTokensVec = std::vector<SSharedTokens>;
+
     //! Tag for the token index
     struct SToken {};
 
@@ -245,6 +290,18 @@ private:
                                       const TTokenListTypeVec& types,
                                       core::CStatePersistInserter& inserter);
 
+    //! Find the positions in m_TypesByCount of the types which could match
+    //! the string whose tokens are in the work token members.  The result
+    //! is returned in \p candidates in ascending order.
+    void candidateTypes(size_t workWeight, TSizeVec& candidates);
+
+    //! Add the type with vector index \p type to the inverted token index.
+    void indexType(size_t type);
+
+    //! Update the inverted token index after some of the common unique
+    //! tokens of the type with vector index \p type have been removed.
+    void reindexCommonTokens(size_t type);
+
     //! Given a string containing comma separated pre-tokenised input, add
     //! the tokens to the working data structures in the same way as if they
     //! had been determined by the tokeniseString() method.  The result of
@@ -273,9 +330,19 @@ private:
     //! The types
     TTokenListTypeVec m_Types;
 
-    //! List of match count/index into type vector in descending order of
-    //! match count
-    TSizeSizePrList m_TypesByCount;
+    //! Match count/index into type vector in descending order of match
+    //! count
+    TSizeSizePrVec m_TypesByCount;
+
+    //! The position of each type in m_TypesByCount
+    TSizeVec m_TypePositions;
+
+    //! The types whose base tokens contain each token, indexed by token ID
+    TTypeTokenVecVec m_TypesByToken;
+
+    //! The types which have no common unique tokens.  These can match a
+    //! string's reverse search without sharing any tokens with it.
+    TSizeVec m_TypesWithoutCommonTokens;
 
     //! Used for looking up tokens to a unique ID
     TTokenMIndex m_TokenIdLookup;
@@ -288,6 +355,18 @@ private:
     //! repeated reallocations for different strings.
     TSizeSizeMap m_WorkTokenUniqueIds;
 
+    //! The token weight shared with each type.  This is a member to save
+    //! repeated reallocations for different strings.
+    TSharedTokensVec m_WorkSharedTokens;
+
+    //! The types which share tokens with the current string.  This is a
+    //! member to save repeated reallocations for different strings.
+    TSizeVec m_WorkSharingTypes;
+
+    //! The candidate types for the current string.  This is a member to
+    //! save repeated reallocations for different strings.
+    TSizeVec m_WorkCandidates;
+
     //! Used to parse pre-tokenised input supplied as CSV.
     CCsvInputParser::CCsvLineParser m_CsvLineParser;
 
@@ -32,17 +32,28 @@ class CInputParser;
 //! this class, which, in practice, means that the CIoManager object managing
 //! them must outlive this object.
 //!
+//! Input can optionally be pipelined: the input is parsed on a separate
+//! reader thread, which copies the records into batches and passes them
+//! to the calling thread through a bounded queue for processing.  Records,
+//! including control messages, are processed in the order they were read.
+//! A batch is passed on as soon as it contains a control message, so the
+//! response to a control message never waits for more input.
+//!
 class API_EXPORT CCmdSkeleton : private core::CNonCopyable {
 public:
     CCmdSkeleton(core::CDataSearcher* restoreSearcher,
                  core::CDataAdder* persister,
                  CInputParser& inputParser,
-                 CDataProcessor& processor);
+                 CDataProcessor& processor,
+                 bool pipelineInput = false);
 
     //! Pass input to the processor until it's consumed as much as it can.
     bool ioLoop();
 
 private:
+    //! Parse the input on a separate thread and process it on this one.
+    bool pipelinedIoLoop();
+
     //! Persists the state of the models
     bool persistState();
 
@@ -59,6 +70,9 @@ private:
     //! Reference to the object that's going to do the command-specific
     //! processing of the data.
     CDataProcessor& m_Processor;
+
+    //! Should the input be parsed on a separate thread?
+    bool m_PipelineInput;
 };
 }
 }
@@ -27,6 +27,7 @@ class CDataSearcher;
 namespace api {
 class CBackgroundPersister;
 class COutputHandler;
+class CRecordView;
 
 //! \brief
 //! Abstract interface for classes that process data records
@@ -63,6 +64,12 @@ public:
     //! with any required modifications
     virtual bool handleRecord(const TStrStrUMap& dataRowFields) = 0;
 
+    //! Receive a single record whose fields can be addressed by index.
+    //! The default implementation passes the record's field map to
+    //! handleRecord.  Processors that look up the same fields in every
+    //! record should override this to avoid hashing field names.
+    virtual bool handleRecordView(const CRecordView& record);
+
     //! Perform any final processing once all input data has been seen.
     virtual void finalise() = 0;
 
@@ -13,6 +13,7 @@
 #include <api/CCategoryExamplesCollector.h>
 #include <api/CDataProcessor.h>
 #include <api/CDataTyper.h>
+#include <api/CRecordView.h>
 #include <api/CTokenListDataTyper.h>
 #include <api/ImportExport.h>
 
@@ -91,6 +92,10 @@ public:
     //! STDOUT with its type field added
     virtual bool handleRecord(const TStrStrUMap& dataRowFields);
 
+    //! Receive a single record to be typed whose fields can be addressed
+    //! by index
+    virtual bool handleRecordView(const CRecordView& record);
+
     //! Perform any final processing once all input data has been seen.
     virtual void finalise();
 
@@ -115,7 +120,7 @@ private:
     void createTyper(const std::string& fieldName);
 
     //! Compute the type for a given record.
-    int computeType(const TStrStrUMap& dataRowFields);
+    int computeType(const CRecordView& record);
 
     //! Create the reverse search and return true if it has changed or false otherwise
     bool createReverseSearch(int type);
@@ -197,6 +202,15 @@ private:
     //! nullptr if this object is not responsible for starting periodic
     //! persistence.
     CBackgroundPersister* m_PeriodicPersister;
+
+    //! The indices of the fields this typer reads from each record.
+    CRecordView::CFieldIndices m_RecordFieldIndices;
+
+    //! The slot of the control field in m_RecordFieldIndices.
+    std::size_t m_ControlFieldSlot;
+
+    //! The slot of the categorization field in m_RecordFieldIndices.
+    std::size_t m_CategorizationFieldSlot;
 };
 }
 }
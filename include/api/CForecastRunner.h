@@ -38,6 +38,9 @@
 class CForecastRunnerTest;
 
 namespace ml {
+namespace core {
+class CStaticThreadPool;
+}
 namespace api {
 
 //! \brief
@@ -47,7 +50,13 @@ namespace api {
 //! Executes forecast jobs async to the main thread
 //!
 //! IMPLEMENTATION DECISIONS:\n
-//! Uses only 1 thread as worker.
+//! Uses 1 thread as worker to run forecast jobs one at a time. If more
+//! than one thread is requested the models of each job are forecast in
+//! parallel on a pool owned by the runner: each thread takes the next
+//! model, forecasts it and writes the results through its own sink onto
+//! the shared output stream. Models are still restored from disk one at
+//! a time, so at most one model per thread is held in addition to those
+//! the job already holds.
 //!
 //! The forecast runs in parallel to the main thread, this has
 //! various consequences:
@@ -113,6 +122,7 @@ public:
     using TAnomalyDetectorPtrVec = std::vector<TAnomalyDetectorPtr>;
 
     using TForecastModelWrapper = model::CForecastDataSink::SForecastModelWrapper;
+    using TForecastModelWrapperPtr = std::unique_ptr<TForecastModelWrapper>;
     using TForecastResultSeries = model::CForecastDataSink::SForecastResultSeries;
     using TForecastResultSeriesVec = std::vector<TForecastResultSeries>;
     using TMathsModelPtr = std::unique_ptr<maths::CModel>;
@@ -123,9 +133,12 @@ public:
     //! Initialize and start the forecast runner thread
     //! \p jobId The job ID
     //! \p strmOut The output stream to write forecast results to
+    //! \p numberThreads The number of threads to use to forecast the
+    //! models of a single job
     CForecastRunner(const std::string& jobId,
                     core::CJsonOutputStreamWrapper& strmOut,
-                    model::CResourceMonitor& resourceMonitor);
+                    model::CResourceMonitor& resourceMonitor,
+                    std::size_t numberThreads = 1);
 
     //! Destructor, cancels all queued forecast requests, finishes a running forecast.
     //! To finish all remaining forecasts call finishForecasts() first.
@@ -261,6 +274,9 @@ private:
     //! thread for the worker
     std::thread m_Worker;
 
+    //! The threads which help the worker forecast, null if it works alone
+    std::unique_ptr<core::CStaticThreadPool> m_ThreadPool;
+
     //! indicator for worker
     volatile bool m_Shutdown;
 
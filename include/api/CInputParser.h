@@ -8,6 +8,7 @@
 
 #include <core/CNonCopyable.h>
 
+#include <api/CRecordView.h>
 #include <api/ImportExport.h>
 
 #include <boost/ref.hpp>
@@ -28,8 +29,11 @@ namespace api {
 //! Abstract base class for input parser classes.
 //!
 //! IMPLEMENTATION DECISIONS:\n
-//! Abstract interface declares the readStream method that must be
-//! implemented in sub-classes.
+//! Abstract interface declares the readRecords method that must be
+//! implemented in sub-classes.  This passes each record to the reader
+//! as a CRecordView, whose fields can be addressed by index.  The
+//! readStream method, which passes each record as a map from field
+//! name to value, is an adapter for readers that don't need this.
 //!
 class API_EXPORT CInputParser : private core::CNonCopyable {
 public:
@@ -55,6 +59,11 @@ public:
     //! 2) Data row fields
     using TReaderFunc = std::function<bool(const TStrStrUMap&)>;
 
+    //! Callback function prototype that gets called for each record
+    //! read from the input stream when fields are to be addressed by
+    //! index.  Return false to exit reader loop.
+    using TRecordReaderFunc = std::function<bool(const CRecordView&)>;
+
 public:
     CInputParser();
     virtual ~CInputParser();
@@ -68,13 +77,17 @@ public:
     //! Get field names
     const TStrVec& fieldNames() const;
 
-    //! Read records from the stream.  The supplied settings function is
-    //! called only once.  The supplied reader function is called once per
-    //! record.  If the supplied reader function returns false, reading will
-    //! stop.  This method keeps reading until it reaches the end of the
-    //! stream or an error occurs.  If it successfully reaches the end of
-    //! the stream it returns true, otherwise it returns false.  If
-    virtual bool readStream(const TReaderFunc& readerFunc) = 0;
+    //! Read records from the stream.  The supplied reader function is
+    //! called once per record.  If the supplied reader function returns
+    //! false, reading will stop.  This method keeps reading until it
+    //! reaches the end of the stream or an error occurs.  If it
+    //! successfully reaches the end of the stream it returns true,
+    //! otherwise it returns false.
+    bool readStream(const TReaderFunc& readerFunc);
+
+    //! As readStream, but the reader function is passed a view of each
+    //! record whose fields can be addressed by index.
+    virtual bool readRecords(const TRecordReaderFunc& readerFunc) = 0;
 
 protected:
     //! Set the "got field names" flag
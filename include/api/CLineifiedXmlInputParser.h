@@ -50,7 +50,7 @@ public:
     //! reading will stop.  This method keeps reading until it reaches the
     //! end of the stream or an error occurs.  If it successfully reaches
     //! the end of the stream it returns true, otherwise it returns false.
-    virtual bool readStream(const TReaderFunc& readerFunc);
+    virtual bool readRecords(const TRecordReaderFunc& readerFunc);
 
 private:
     //! Attempt to parse the current working record into data fields.
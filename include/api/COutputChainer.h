@@ -110,6 +110,10 @@ private:
     //! order as the field names in m_FieldNames.  This avoids the need to
     //! do hash lookups when populating m_WorkRecordFields.
     TStrRefVec m_WorkRecordFieldRefs;
+
+    //! The generation of the record views passed to the next data
+    //! processor, which changes whenever the field names are set.
+    std::size_t m_WorkRecordGeneration;
 };
 }
 }
@@ -0,0 +1,149 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_ml_api_CRecordView_h
+#define INCLUDED_ml_api_CRecordView_h
+
+#include <api/ImportExport.h>
+
+#include <boost/ref.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace ml {
+namespace api {
+
+//! \brief
+//! A view of a single input record whose fields are addressed by index.
+//!
+//! DESCRIPTION:\n
+//! Input parsers decode every record into the same set of strings, one
+//! per field, in the order of their field names.  This class gives
+//! consumers access to those strings by field index, so that a consumer
+//! that resolves the indices of the fields it needs once can then read
+//! each record without hashing field names or copying values.
+//!
+//! The view also carries the map from field name to value that the
+//! parser populates, so consumers that still want the map interface
+//! can use fieldMap().  A view may be constructed from just a map, in
+//! which case it is unindexed and lookups fall back to the map.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! Views are cheap to construct and only valid for the duration of the
+//! callback they're passed to: they refer to storage owned by the
+//! producer of the record.
+//!
+//! The field names of a stream of records can change, for example when
+//! a self-describing input format is read with arbitrary fields, so each
+//! view has a generation.  Views with the same generation are guaranteed
+//! to have the same field names in the same order.  Generations are
+//! unique across all producers, so a consumer can't mistake the indices
+//! of one stream for those of another.  Generation 0 means unindexed.
+//!
+class API_EXPORT CRecordView {
+public:
+    using TStrVec = std::vector<std::string>;
+    using TSizeVec = std::vector<std::size_t>;
+    using TStrStrUMap = boost::unordered_map<std::string, std::string>;
+    using TStrRef = boost::reference_wrapper<std::string>;
+    using TStrRefVec = std::vector<TStrRef>;
+
+    //! Index returned for fields which aren't present in the record.
+    static const std::size_t NOT_FOUND;
+
+    //! \brief
+    //! Caches the indices of a set of field names in a stream of records.
+    //!
+    //! DESCRIPTION:\n
+    //! Consumers register the field names they need once to get a slot
+    //! for each one and then look up values by slot.  The indices are
+    //! only recomputed when the generation of the records changes.
+    class API_EXPORT CFieldIndices {
+    public:
+        CFieldIndices();
+
+        //! Get the slot for \p fieldName, adding it if necessary.
+        std::size_t slot(const std::string& fieldName);
+
+        //! Get the value of the field in \p slot of \p record or null
+        //! if the record doesn't have the field.
+        const std::string* value(std::size_t slot, const CRecordView& record);
+
+        //! Get the number of slots.
+        std::size_t size() const;
+
+        //! Remove all the field names.
+        void clear();
+
+    private:
+        //! Compute the index of each field name in \p record.
+        void resolve(const CRecordView& record);
+
+    private:
+        //! The field names in slot order.
+        TStrVec m_FieldNames;
+
+        //! The index of each field name in the records of m_Generation.
+        TSizeVec m_Indices;
+
+        //! The generation of the records m_Indices were computed for.
+        std::size_t m_Generation;
+    };
+
+public:
+    //! Create an unindexed view of \p fieldMap.
+    explicit CRecordView(const TStrStrUMap& fieldMap);
+
+    //! Create a view of a record whose field values in the order of
+    //! \p fieldNames are \p fieldValues.  These must be references to
+    //! the values in \p fieldMap.
+    CRecordView(std::size_t generation,
+                const TStrVec& fieldNames,
+                const TStrRefVec& fieldValues,
+                const TStrStrUMap& fieldMap);
+
+    //! Get a generation which hasn't been used by any other view.
+    static std::size_t newGeneration();
+
+    //! Can fields be addressed by index?
+    bool indexed() const;
+
+    //! Get the generation of this view's field names.
+    std::size_t generation() const;
+
+    //! Get the field names in index order (empty if not indexed).
+    const TStrVec& fieldNames() const;
+
+    //! Get the index of \p fieldName or NOT_FOUND.  This is a linear
+    //! search so the result should be cached by the caller.
+    std::size_t fieldIndex(const std::string& fieldName) const;
+
+    //! Get the value of the field at \p index or null for NOT_FOUND.
+    const std::string* fieldValue(std::size_t index) const;
+
+    //! Get the value of \p fieldName or null if it isn't present.
+    const std::string* fieldValue(const std::string& fieldName) const;
+
+    //! Get the map from field name to value.
+    const TStrStrUMap& fieldMap() const;
+
+private:
+    //! Used for the field names and values of unindexed views.
+    static const TStrVec EMPTY_FIELD_NAMES;
+    static const TStrRefVec EMPTY_FIELD_VALUES;
+
+private:
+    std::size_t m_Generation;
+    const TStrVec& m_FieldNames;
+    const TStrRefVec& m_FieldValues;
+    const TStrStrUMap& m_FieldMap;
+};
+}
+}
+
+#endif // INCLUDED_ml_api_CRecordView_h
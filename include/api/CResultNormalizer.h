@@ -17,11 +17,15 @@
 
 #include <boost/unordered_map.hpp>
 
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
 
 namespace ml {
+namespace core {
+class CStaticThreadPool;
+}
 namespace api {
 
 //! \brief
@@ -40,6 +44,14 @@ namespace api {
 //! The state required to initialize the normalizers is a JSON document
 //! as created by model::CHierarchicalResultsNormalizer::toJson().
 //!
+//! Renormalizing all of a job's results can mean normalizing many millions
+//! of records. If more than one thread is requested the records are handled
+//! in blocks: the fields of each record in a block are parsed and its score
+//! normalized concurrently, each distinct normalizer is looked up once per
+//! block and the records are written in their original order when the
+//! block is complete. In this mode finalise must be called once all the
+//! records have been handled to write the last block.
+//!
 //! IMPLEMENTATION DECISIONS:\n
 //! Does not support processor chaining functionality as it is unlikely
 //! that this class would ever be chained to another data processor.
@@ -75,9 +87,16 @@ public:
     using TStrStrUMapItr = TStrStrUMap::iterator;
     using TStrStrUMapCItr = TStrStrUMap::const_iterator;
 
+    //! The number of records normalized together when using more than
+    //! one thread.
+    static const std::size_t BLOCK_SIZE;
+
 public:
     CResultNormalizer(const model::CAnomalyDetectorModelConfig& modelConfig,
-                      COutputHandler& outputHandler);
+                      COutputHandler& outputHandler,
+                      std::size_t numberThreads = 1);
+
+    ~CResultNormalizer();
 
     //! Initialise the system change normalizer
     bool initNormalizer(const std::string& stateFileName);
@@ -85,7 +104,50 @@ public:
     //! Handle a record to be normalized
     bool handleRecord(const TStrStrUMap& dataRowFields);
 
+    //! Normalize and write any records which haven't been written yet.
+    bool finalise();
+
 private:
+    using TStrStrUMapVec = std::vector<TStrStrUMap>;
+    using TNormalizerCPtrUMap =
+        boost::unordered_map<std::string, const model::CAnomalyScore::CNormalizer*>;
+    using TThreadPoolUPtr = std::unique_ptr<core::CStaticThreadPool>;
+
+    //! \brief The fields of a record needed to normalize it.
+    struct SRecord {
+        std::string s_Level;
+        std::string s_PartitionName;
+        std::string s_PartitionValue;
+        std::string s_PersonName;
+        std::string s_PersonValue;
+        std::string s_Function;
+        std::string s_ValueFieldName;
+        double s_Probability = 0.0;
+        bool s_IsNormalizable = false;
+        const model::CAnomalyScore::CNormalizer* s_Normalizer = nullptr;
+        std::string s_NormalizedScore;
+    };
+    using TRecordVec = std::vector<SRecord>;
+
+private:
+    //! Tell the output handler the field names if this is the first record.
+    bool writeFieldNames(const TStrStrUMap& dataRowFields);
+
+    //! Normalize and write the records in the current block.
+    bool handleBlock();
+
+    //! Parse the fields of \p dataRowFields needed to normalize it.
+    void parseRecord(const TStrStrUMap& dataRowFields, SRecord& record) const;
+
+    //! Get the normalizer for \p record's level and fields.
+    const model::CAnomalyScore::CNormalizer* normalizer(const SRecord& record) const;
+
+    //! Compute \p record's normalized score.
+    void normalize(SRecord& record) const;
+
+    //! Write \p dataRowFields with \p record's normalized score.
+    bool writeRecord(const TStrStrUMap& dataRowFields, const SRecord& record);
+
     bool parseDataFields(const TStrStrUMap& dataRowFields,
                          std::string& level,
                          std::string& partitionName,
@@ -94,7 +156,7 @@ private:
                          std::string& personValue,
                          std::string& function,
                          std::string& valueFieldName,
-                         double& probability);
+                         double& probability) const;
 
     template<typename T>
     bool parseDataField(const TStrStrUMap& dataRowFields,
@@ -129,6 +191,20 @@ private:
 
     //! The hierarchical results normalizer
     model::CHierarchicalResultsNormalizer m_Normalizer;
+
+    //! The pool used to normalize blocks of records concurrently, or null
+    //! if records are normalized one at a time.
+    TThreadPoolUPtr m_ThreadPool;
+
+    //! The records in the current block.
+    TStrStrUMapVec m_BlockFields;
+
+    //! The normalization fields of the records in the current block.
+    TRecordVec m_BlockRecords;
+
+    //! The normalizers looked up for the current block keyed by level and
+    //! field names.
+    TNormalizerCPtrUMap m_BlockNormalizers;
 };
 }
 }
@@ -12,8 +12,11 @@
 #include <core/CWordDictionary.h>
 
 #include <api/CBaseTokenListDataTyper.h>
+#include <api/CTokenListTokeniser.h>
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <string>
 
 #include <ctype.h>
@@ -48,6 +51,9 @@ template<bool DO_WARPING = true,
          size_t MIN_DICTIONARY_LENGTH = 2,
          typename DICTIONARY_WEIGHT_FUNC = core::CWordDictionary::TWeightAll2>
 class CTokenListDataTyper : public CBaseTokenListDataTyper {
+public:
+    using TTokeniser = CTokenListTokeniser<ALLOW_UNDERSCORE, ALLOW_DOT, ALLOW_DASH, IGNORE_HEX>;
+
 public:
     //! Create a data typer with threshold for how comparable types are
     //! 0.0 means everything is the same type
@@ -71,43 +77,12 @@ protected:
         tokenUniqueIds.clear();
         totalWeight = 0;
 
-        std::string temp;
-
-        // TODO - make more efficient
-        std::string::size_type nonHexPos(std::string::npos);
-        for (std::string::size_type i = 0; i < str.size(); ++i) {
-            const char curChar(str[i]);
-
-            // Basically tokenise into [a-zA-Z0-9]+ strings, possibly
-            // allowing underscores, dots and dashes in the middle
-            if (::isalnum(static_cast<unsigned char>(curChar)) ||
-                (!temp.empty() && ((ALLOW_UNDERSCORE && curChar == '_') ||
-                                   (ALLOW_DOT && curChar == '.') ||
-                                   (ALLOW_DASH && curChar == '-')))) {
-                temp += curChar;
-                if (IGNORE_HEX) {
-                    // Count dots and dashes as numeric
-                    if (!::isxdigit(static_cast<unsigned char>(curChar)) &&
-                        curChar != '.' && curChar != '-') {
-                        nonHexPos = temp.length() - 1;
-                    }
-                }
-            } else {
-                if (!temp.empty()) {
-                    this->considerToken(fields, nonHexPos, temp, tokenIds,
-                                        tokenUniqueIds, totalWeight);
-                    temp.clear();
-                }
-
-                if (IGNORE_HEX) {
-                    nonHexPos = std::string::npos;
-                }
-            }
-        }
-
-        if (!temp.empty()) {
-            this->considerToken(fields, nonHexPos, temp, tokenIds, tokenUniqueIds, totalWeight);
-        }
+        TTokeniser::tokenise(str, [&](std::size_t start, std::size_t length,
+                                      std::string::size_type nonHexPos) {
+            m_WorkToken.assign(str, start, length);
+            this->considerToken(fields, nonHexPos, m_WorkToken, tokenIds,
+                                tokenUniqueIds, totalWeight);
+        });
 
         LOG_TRACE(<< str << " tokenised to " << tokenIds.size() << " tokens with total weight "
                   << totalWeight << ": " << SIdTranslater(*this, tokenIds, ' '));
@@ -134,12 +109,13 @@ protected:
     virtual double similarity(const TSizeSizePrVec& left,
                               size_t leftWeight,
                               const TSizeSizePrVec& right,
-                              size_t rightWeight) const {
+                              size_t rightWeight,
+                              double minSimilarity) const {
         double similarity(1.0);
 
         size_t maxWeight(std::max(leftWeight, rightWeight));
         if (maxWeight > 0) {
-            size_t diff(DO_WARPING ? m_SimilarityTester.weightedEditDistance(left, right)
+            size_t diff(DO_WARPING ? this->warpedDistance(left, right, maxWeight, minSimilarity)
                                    : this->compareNoWarp(left, right));
 
             similarity = 1.0 - double(diff) / double(maxWeight);
@@ -149,6 +125,24 @@ protected:
     }
 
 private:
+    //! Compute the weighted edit distance between two vectors of tokens,
+    //! giving up once it's large enough that the similarity must be less
+    //! than \p minSimilarity
+    size_t warpedDistance(const TSizeSizePrVec& left,
+                          const TSizeSizePrVec& right,
+                          size_t maxWeight,
+                          double minSimilarity) const {
+        // Any distance greater than this gives a similarity less than
+        // minSimilarity.  Rounding up means we never give up on a distance
+        // which is only just acceptable due to floating point error.
+        double maxDiff(std::ceil((1.0 - minSimilarity) * double(maxWeight)));
+        if (maxDiff >= double(std::numeric_limits<size_t>::max() / 2)) {
+            return m_SimilarityTester.weightedEditDistance(left, right);
+        }
+        return m_SimilarityTester.weightedEditDistance(
+            left, right, static_cast<size_t>(std::max(maxDiff, 0.0)));
+    }
+
     //! Compare two vectors of tokens without doing any warping (this is an
     //! alternative to using the Levenshtein distance, which is a form of
     //! warping)
@@ -237,6 +231,9 @@ private:
 
     //! Function used to increase weighting for dictionary words
     DICTIONARY_WEIGHT_FUNC m_DictionaryWeightFunc;
+
+    //! Holds the token being considered, reused to avoid allocations
+    std::string m_WorkToken;
 };
 }
 }
@@ -0,0 +1,258 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_ml_api_CTokenListTokeniser_h
+#define INCLUDED_ml_api_CTokenListTokeniser_h
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <ctype.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#ifdef Windows
+#include <intrin.h>
+#endif
+#endif
+
+namespace ml {
+namespace api {
+
+//! \brief
+//! Finds the tokens in a string for the token list data typer.
+//!
+//! DESCRIPTION:\n
+//! Tokens are [a-zA-Z0-9]+ strings, optionally allowing underscores, dots
+//! and dashes after the first character.  For each token the callback is
+//! passed its start position and length in the string and, if hex tokens
+//! are being ignored, the position in the token of the last character which
+//! can't be part of a hex number (dots and dashes count as numeric), or
+//! std::string::npos if there isn't one.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! The vectorised implementation classifies 64 characters at a time into
+//! bit masks, 16 characters per SSE2 instruction, and then finds the token
+//! boundaries in the masks by counting leading and trailing zeros.  This
+//! is much faster than examining one character at a time, because most
+//! characters of a message are in the middle of tokens.  SSE2 is available
+//! on every x86_64 CPU, so no runtime check is needed, but there is a
+//! scalar implementation for other architectures.  Both implementations
+//! are public so they can be checked against each other.
+//!
+//! Characters are classified as in the "C" locale, i.e. only ASCII letters
+//! and digits are alphanumeric.
+//!
+template<bool ALLOW_UNDERSCORE, bool ALLOW_DOT, bool ALLOW_DASH, bool IGNORE_HEX>
+class CTokenListTokeniser {
+public:
+    //! Call \p f for each token in \p str using the fastest implementation
+    //! available.
+    template<typename F>
+    static void tokenise(const std::string& str, F f) {
+#if defined(__SSE2__) || defined(_M_X64)
+        tokeniseVectorised(str, f);
+#else
+        tokeniseScalar(str, f);
+#endif
+    }
+
+    //! Call \p f for each token in \p str examining one character at a time.
+    template<typename F>
+    static void tokeniseScalar(const std::string& str, F f) {
+        std::size_t start(std::string::npos);
+        std::size_t nonHexPos(std::string::npos);
+        for (std::size_t i = 0; i < str.size(); ++i) {
+            const char curChar(str[i]);
+
+            // Basically tokenise into [a-zA-Z0-9]+ strings, possibly
+            // allowing underscores, dots and dashes in the middle
+            if (::isalnum(static_cast<unsigned char>(curChar)) ||
+                (start != std::string::npos &&
+                 ((ALLOW_UNDERSCORE && curChar == '_') || (ALLOW_DOT && curChar == '.') ||
+                  (ALLOW_DASH && curChar == '-')))) {
+                if (start == std::string::npos) {
+                    start = i;
+                }
+                if (IGNORE_HEX) {
+                    // Count dots and dashes as numeric
+                    if (!::isxdigit(static_cast<unsigned char>(curChar)) &&
+                        curChar != '.' && curChar != '-') {
+                        nonHexPos = i - start;
+                    }
+                }
+            } else if (start != std::string::npos) {
+                f(start, i - start, nonHexPos);
+                start = std::string::npos;
+                nonHexPos = std::string::npos;
+            }
+        }
+
+        if (start != std::string::npos) {
+            f(start, str.size() - start, nonHexPos);
+        }
+    }
+
+#if defined(__SSE2__) || defined(_M_X64)
+    //! Call \p f for each token in \p str examining 64 characters at a time.
+    template<typename F>
+    static void tokeniseVectorised(const std::string& str, F f) {
+        const char* data(str.data());
+        std::size_t length(str.size());
+
+        // Token state carried between blocks
+        bool inToken(false);
+        std::size_t start(0);
+        std::size_t lastNonHex(std::string::npos);
+
+        for (std::size_t base = 0; base < length; base += BLOCK_SIZE) {
+            // The final partial block is padded with zeros, which aren't
+            // token characters, so it ends any token in progress
+            const char* block(data + base);
+            char padded[BLOCK_SIZE];
+            if (length - base < BLOCK_SIZE) {
+                std::memset(padded, 0, BLOCK_SIZE);
+                std::memcpy(padded, block, length - base);
+                block = padded;
+            }
+
+            std::uint64_t alnum(0);
+            std::uint64_t word(0);
+            std::uint64_t nonHex(0);
+            classify(block, alnum, word, nonHex);
+
+            std::size_t pos(0);
+            while (pos < BLOCK_SIZE) {
+                std::uint64_t from(~std::uint64_t(0) << pos);
+                if (inToken == false) {
+                    std::uint64_t starts(alnum & from);
+                    if (starts == 0) {
+                        break;
+                    }
+                    pos = countTrailingZeros(starts);
+                    from = ~std::uint64_t(0) << pos;
+                    inToken = true;
+                    start = base + pos;
+                    lastNonHex = std::string::npos;
+                }
+
+                std::uint64_t ends(~word & from);
+                std::size_t end(BLOCK_SIZE);
+                if (ends != 0) {
+                    end = countTrailingZeros(ends);
+                }
+                if (IGNORE_HEX) {
+                    std::uint64_t tokenNonHex(
+                        nonHex & from &
+                        (end == BLOCK_SIZE ? ~std::uint64_t(0) : ~(~std::uint64_t(0) << end)));
+                    if (tokenNonHex != 0) {
+                        lastNonHex = base + 63 - countLeadingZeros(tokenNonHex);
+                    }
+                }
+                if (end == BLOCK_SIZE) {
+                    // The token continues into the next block
+                    break;
+                }
+
+                f(start, base + end - start,
+                  lastNonHex == std::string::npos ? lastNonHex : lastNonHex - start);
+                inToken = false;
+                pos = end;
+            }
+        }
+
+        if (inToken) {
+            f(start, length - start,
+              lastNonHex == std::string::npos ? lastNonHex : lastNonHex - start);
+        }
+    }
+#endif
+
+private:
+#if defined(__SSE2__) || defined(_M_X64)
+    //! The number of characters classified at a time.
+    static const std::size_t BLOCK_SIZE = 64;
+
+    //! Set bit i of \p alnum if character i of \p block is alphanumeric,
+    //! of \p word if it can be part of a token and of \p nonHex if it can
+    //! be part of a token but not a hex number.
+    static void classify(const char* block,
+                         std::uint64_t& alnum,
+                         std::uint64_t& word,
+                         std::uint64_t& nonHex) {
+        for (std::size_t i = 0; i < BLOCK_SIZE; i += 16) {
+            __m128i chars(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i)));
+
+            // Comparisons are signed so non-ASCII characters, which are
+            // negative, are never in range
+            __m128i digit(inRange(chars, '0', '9'));
+            __m128i lower(_mm_or_si128(chars, _mm_set1_epi8(0x20)));
+            __m128i alpha(inRange(lower, 'a', 'z'));
+            __m128i alnumChars(_mm_or_si128(digit, alpha));
+            __m128i dot(_mm_cmpeq_epi8(chars, _mm_set1_epi8('.')));
+            __m128i dash(_mm_cmpeq_epi8(chars, _mm_set1_epi8('-')));
+
+            __m128i wordChars(alnumChars);
+            if (ALLOW_UNDERSCORE) {
+                wordChars = _mm_or_si128(wordChars, _mm_cmpeq_epi8(chars, _mm_set1_epi8('_')));
+            }
+            if (ALLOW_DOT) {
+                wordChars = _mm_or_si128(wordChars, dot);
+            }
+            if (ALLOW_DASH) {
+                wordChars = _mm_or_si128(wordChars, dash);
+            }
+
+            alnum |= mask(alnumChars) << i;
+            word |= mask(wordChars) << i;
+            if (IGNORE_HEX) {
+                __m128i hexChars(_mm_or_si128(
+                    _mm_or_si128(digit, inRange(lower, 'a', 'f')), _mm_or_si128(dot, dash)));
+                nonHex |= mask(_mm_andnot_si128(hexChars, wordChars)) << i;
+            }
+        }
+    }
+
+    //! Get a mask of the characters of \p chars in [\p lo, \p hi].
+    static __m128i inRange(__m128i chars, char lo, char hi) {
+        return _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8(static_cast<char>(lo - 1))),
+                             _mm_cmplt_epi8(chars, _mm_set1_epi8(static_cast<char>(hi + 1))));
+    }
+
+    //! Get one bit per byte of \p bytes.
+    static std::uint64_t mask(__m128i bytes) {
+        return static_cast<std::uint64_t>(static_cast<unsigned int>(_mm_movemask_epi8(bytes)));
+    }
+
+    //! Get the index of the lowest set bit of \p x, which must be nonzero.
+    static std::size_t countTrailingZeros(std::uint64_t x) {
+#ifdef Windows
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return index;
+#else
+        return static_cast<std::size_t>(__builtin_ctzll(x));
+#endif
+    }
+
+    //! Get the number of zeros above the highest set bit of \p x, which
+    //! must be nonzero.
+    static std::size_t countLeadingZeros(std::uint64_t x) {
+#ifdef Windows
+        unsigned long index;
+        _BitScanReverse64(&index, x);
+        return 63 - index;
+#else
+        return static_cast<std::size_t>(__builtin_clzll(x));
+#endif
+    }
+#endif
+};
+}
+}
+
+#endif // INCLUDED_ml_api_CTokenListTokeniser_h
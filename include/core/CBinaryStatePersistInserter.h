@@ -0,0 +1,98 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_ml_core_CBinaryStatePersistInserter_h
+#define INCLUDED_ml_core_CBinaryStatePersistInserter_h
+
+#include <core/CStatePersistInserter.h>
+#include <core/ImportExport.h>
+
+#include <iosfwd>
+#include <string>
+
+namespace ml {
+namespace core {
+
+//! \brief
+//! For persisting state in a compact binary format.
+//!
+//! DESCRIPTION:\n
+//! Concrete implementation of the CStatePersistInserter interface
+//! that persists state as a sequence of tagged binary tokens. This
+//! is much cheaper to write and to read back than JSON for large
+//! states. It is restored by CBinaryStateRestoreTraverser.
+//!
+//! The format is a header, which can't be the start of a JSON
+//! document, followed by one token per value, start of level and
+//! end of level. Names and string values are length prefixed and
+//! floating point values inserted with a precision are stored raw.
+//! The root level is implicit and is ended by the destructor.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! Output is buffered and written to the stream in large blocks.
+//!
+//! Floating point values are rounded to the requested precision
+//! before they're stored so restoring gives the same value whichever
+//! format was used, up to the loss in the decimal representation.
+//! They are written in the byte order of the machine and so the state
+//! isn't portable between big and little endian architectures.
+//!
+class CORE_EXPORT CBinaryStatePersistInserter : public CStatePersistInserter {
+public:
+    //! The header which starts every binary state document
+    static const std::string HEADER;
+
+    //! \name Token Markers
+    //@{
+    static const char START_LEVEL = 'L';
+    static const char END_LEVEL = 'E';
+    static const char STRING_VALUE = 'S';
+    static const char DOUBLE_VALUE = 'D';
+    //@}
+
+public:
+    CBinaryStatePersistInserter(std::ostream& outputStream);
+
+    //! Destructor ends the root level and flushes
+    virtual ~CBinaryStatePersistInserter();
+
+    //! Store a name/value
+    virtual void insertValue(const std::string& name, const std::string& value);
+
+    //! Store a floating point number with a given level of precision
+    virtual void
+    insertValue(const std::string& name, double value, CIEEE754::EPrecision precision);
+
+    // Bring extra base class overloads into scope
+    using CStatePersistInserter::insertValue;
+
+    //! Flush the underlying output stream
+    void flush();
+
+protected:
+    //! Start a new level with the given name
+    virtual void newLevel(const std::string& name);
+
+    //! End the current level
+    virtual void endLevel();
+
+private:
+    //! Append a length prefixed string to the buffer.
+    void appendString(const std::string& value);
+
+    //! Write the buffer to the stream if it's full.
+    void flushIfFull();
+
+private:
+    //! The stream to which state is written
+    std::ostream& m_OutputStream;
+
+    //! Output waiting to be written to the stream
+    std::string m_Buffer;
+};
+}
+}
+
+#endif // INCLUDED_ml_core_CBinaryStatePersistInserter_h
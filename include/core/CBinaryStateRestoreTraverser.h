@@ -0,0 +1,142 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_ml_core_CBinaryStateRestoreTraverser_h
+#define INCLUDED_ml_core_CBinaryStateRestoreTraverser_h
+
+#include <core/CIEEE754.h>
+#include <core/CStateRestoreTraverser.h>
+#include <core/ImportExport.h>
+
+#include <iosfwd>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace ml {
+namespace core {
+
+//! \brief
+//! For restoring state in the binary format.
+//!
+//! DESCRIPTION:\n
+//! Concrete implementation of the CStateRestoreTraverser interface
+//! that restores state written by CBinaryStatePersistInserter.
+//!
+//! Use isBinaryState to choose between this and the JSON traverser
+//! for a stream which may contain either format.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! Input is streaming and reads directly from the stream buffer.
+//!
+//! Floating point values which were stored raw are only converted
+//! to a string if value() is called. valueAs returns them directly.
+//!
+class CORE_EXPORT CBinaryStateRestoreTraverser : public CStateRestoreTraverser {
+public:
+    CBinaryStateRestoreTraverser(std::istream& inputStream);
+
+    //! Check if \p inputStream contains binary state. This doesn't
+    //! consume any input.
+    static bool isBinaryState(std::istream& inputStream);
+
+    //! Navigate to the next element at the current level, or return false
+    //! if there isn't one
+    virtual bool next();
+
+    //! Does the current element have a sub-level?
+    virtual bool hasSubLevel() const;
+
+    //! Get the name of the current element - the returned reference is only
+    //! valid for as long as the traverser is pointing at the same element
+    virtual const std::string& name() const;
+
+    //! Get the value of the current element - the returned reference is
+    //! only valid for as long as the traverser is pointing at the same
+    //! element
+    virtual const std::string& value() const;
+
+    //! Get the value of the current element as a double.
+    virtual bool valueAs(double& result) const;
+
+    // Bring extra base class overloads into scope
+    using CStateRestoreTraverser::valueAs;
+
+    //! Is the traverser at the end of the inputstream?
+    virtual bool isEof() const;
+
+protected:
+    //! Navigate to the start of the sub-level of the current element, or
+    //! return false if there isn't one
+    virtual bool descend();
+
+    //! Navigate to the element of the level above from which descend() was
+    //! called, or return false if there isn't a level above
+    virtual bool ascend();
+
+    //! Copy the current element to \p inserter keeping raw doubles raw.
+    virtual void copyValue(CStatePersistInserter& inserter) const;
+
+private:
+    //! The types of token.
+    enum EToken { E_EndOfLevel, E_StartOfLevel, E_String, E_Double };
+
+    using TStrVec = std::vector<std::string>;
+
+private:
+    //! Check the header and read the first token.
+    bool start();
+
+    //! Read the next token.
+    bool advance();
+
+    //! Skip to the end of the sub-level of the current element.
+    bool skipSubLevel();
+
+    //! Read a length prefixed string into \p result.
+    bool readString(std::string& result);
+
+    //! Log that the state is corrupt and stop reading it.
+    bool fail(const char* reason);
+
+private:
+    //! The stream buffer from which state is read
+    std::streambuf* m_Input;
+
+    //! Set once the header has been read
+    bool m_Started;
+
+    //! Set once the end of the root level or an error is reached
+    bool m_Eof;
+
+    //! The type of the current token
+    EToken m_Type;
+
+    //! True if the current element's sub-level has already been read
+    bool m_SubLevelRead;
+
+    //! The name of the current element
+    std::string m_Name;
+
+    //! The value of the current element
+    mutable std::string m_Value;
+
+    //! True if the current value is a double which hasn't been converted
+    //! to a string yet
+    mutable bool m_ValueIsRaw;
+
+    //! The value of the current element if it's a double
+    double m_Double;
+
+    //! The precision with which the current double was stored
+    CIEEE754::EPrecision m_Precision;
+
+    //! The names of the elements whose sub-levels we're in
+    TStrVec m_Parents;
+};
+}
+}
+
+#endif // INCLUDED_ml_core_CBinaryStateRestoreTraverser_h
@@ -0,0 +1,136 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_ml_core_CPerfectHashWordMap_h
+#define INCLUDED_ml_core_CPerfectHashWordMap_h
+
+#include <core/CNonCopyable.h>
+#include <core/ImportExport.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace boost {
+namespace interprocess {
+class file_mapping;
+class mapped_region;
+}
+}
+
+namespace ml {
+namespace core {
+
+//! \brief
+//! A read-only map from words to small integers which is looked up
+//! ignoring case and can be memory mapped from a file.
+//!
+//! DESCRIPTION:\n
+//! The map is built once, by write(), into a binary image which is then
+//! mapped read-only by every process which needs it.  This means there's
+//! nothing to parse at start up and, because the pages are backed by the
+//! file, they're shared between all the processes on a machine which map
+//! the same image.
+//!
+//! Lookups ignore the case of ASCII letters and don't allocate.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! The image is a minimal perfect hash table built using the "hash,
+//! displace and compress" approach of Belazzougui, Botelho and
+//! Dietzfelbinger: words are hashed into buckets of about four words each
+//! and, starting from the largest bucket, a seed is searched for per bucket
+//! which sends every word in it to a free slot.  The table has exactly one
+//! slot per word so a lookup is two hashes, one slot and one string
+//! comparison, which is needed to reject words that aren't in the map.
+//!
+//! The image is written in the byte order of the machine which writes it
+//! and contains a marker so that an image written on a machine with the
+//! other byte order is rejected rather than misread.  If the image can't
+//! be mapped or is invalid map() returns false, and callers are expected
+//! to fall back to building their map some other way.
+//!
+class CORE_EXPORT CPerfectHashWordMap : private CNonCopyable {
+public:
+    using TStrUInt16Pr = std::pair<std::string, std::uint16_t>;
+    using TStrUInt16PrVec = std::vector<TStrUInt16Pr>;
+
+public:
+    CPerfectHashWordMap();
+    ~CPerfectHashWordMap();
+
+    //! Write the image of a map containing \p words to \p strm.  If a word
+    //! appears more than once, ignoring case, the last value is used.
+    static bool write(const TStrUInt16PrVec& words, std::ostream& strm);
+
+    //! Map the image in \p fileName, replacing any current image.
+    //!
+    //! \return false if the file can't be mapped or isn't a valid image,
+    //! in which case the map is empty.
+    bool map(const std::string& fileName);
+
+    //! Is there an image mapped?
+    bool mapped() const;
+
+    //! Get the number of words in the map.
+    std::size_t size() const;
+
+    //! Look up \p word ignoring case.
+    //!
+    //! \param[out] value Set to the value of \p word if it's in the map.
+    //! \return true if \p word is in the map.
+    bool lookup(const std::string& word, std::uint16_t& value) const;
+
+private:
+    //! The start of the image.
+    struct SHeader {
+        char s_Magic[4];
+        std::uint32_t s_Version;
+        std::uint32_t s_ByteOrder;
+        std::uint32_t s_NumberBuckets;
+        std::uint32_t s_NumberSlots;
+        std::uint32_t s_PoolSize;
+    };
+
+    //! A word's position in the pool and its value.
+    struct SSlot {
+        std::uint32_t s_Offset;
+        std::uint16_t s_Length;
+        std::uint16_t s_Value;
+    };
+
+    using TFileMappingPtr = std::unique_ptr<boost::interprocess::file_mapping>;
+    using TMappedRegionPtr = std::unique_ptr<boost::interprocess::mapped_region>;
+
+private:
+    //! Hash \p word ignoring case.
+    static std::uint64_t hash(const char* word, std::size_t length);
+
+    //! Derive a hash from \p hash and \p seed.
+    static std::uint64_t mix(std::uint64_t hash, std::uint64_t seed);
+
+    //! Unmap the current image.
+    void clear();
+
+private:
+    //! The mapped file.
+    TFileMappingPtr m_File;
+    TMappedRegionPtr m_Region;
+
+    //! The parts of the image.
+    std::uint32_t m_NumberBuckets;
+    std::uint32_t m_NumberSlots;
+    std::uint32_t m_PoolSize;
+    const std::uint32_t* m_Seeds;
+    const SSlot* m_Slots;
+    const char* m_Pool;
+};
+}
+}
+
+#endif // INCLUDED_ml_core_CPerfectHashWordMap_h
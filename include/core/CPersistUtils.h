@@ -689,6 +689,10 @@ public:
         inserter.insertValue(tag, toString(t));
     }
 
+    static void dispatch(const std::string& tag, double t, CStatePersistInserter& inserter) {
+        inserter.insertValue(tag, t, CIEEE754::E_SinglePrecision);
+    }
+
     template<typename A, typename B>
     static void dispatch(const std::string& tag,
                          const std::pair<A, B>& t,
@@ -869,6 +873,10 @@ public:
         return ret;
     }
 
+    static bool dispatch(const std::string& tag, double& t, CStateRestoreTraverser& traverser) {
+        return traverser.name() != tag || traverser.valueAs(t);
+    }
+
     template<typename A, typename B>
     static bool
     dispatch(const std::string& tag, std::pair<A, B>& t, CStateRestoreTraverser& traverser) {
@@ -0,0 +1,151 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_ml_core_CSpscRingBuffer_h
+#define INCLUDED_ml_core_CSpscRingBuffer_h
+
+#include <core/CNonCopyable.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace ml {
+namespace core {
+
+//! \brief
+//! A bounded single producer, single consumer queue.
+//!
+//! DESCRIPTION:\n
+//! A fixed capacity ring buffer for passing items from exactly one
+//! producer thread to exactly one consumer thread.  push blocks while
+//! the buffer is full and pop blocks while it is empty, so nothing is
+//! ever lost or overwritten.
+//!
+//! The number of times each side had to wait for the other is counted
+//! so callers can tell which side of the queue is the bottleneck.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! Because there is only one thread at each end, the read and write
+//! positions each have a single writer and the queue needs no lock
+//! while items flow.  A mutex and condition variable are used only to
+//! put a side to sleep when it has to wait and to wake it: the waiting
+//! side advertises that it is waiting before it rechecks the buffer and
+//! the other side only takes the lock to notify if it sees this, which
+//! means wakeups can't be lost.
+//!
+//! The positions increase monotonically and are reduced modulo the
+//! capacity to index the buffer.
+//!
+//! Each of the push and pop methods must only ever be called from one
+//! thread at a time.
+//!
+template<typename T>
+class CSpscRingBuffer : private CNonCopyable {
+public:
+    explicit CSpscRingBuffer(std::size_t capacity)
+        : m_Buffer(capacity > 0 ? capacity : 1), m_ReadPosition{0},
+          m_WritePosition{0}, m_ProducerWaiting{false}, m_ConsumerWaiting{false},
+          m_ProducerStalls{0}, m_ConsumerStalls{0} {}
+
+    //! Add \p item to the back of the queue, blocking until there is space.
+    void push(T item) {
+        std::size_t write{m_WritePosition.load(std::memory_order_relaxed)};
+        if (write - m_ReadPosition.load(std::memory_order_acquire) == m_Buffer.size()) {
+            ++m_ProducerStalls;
+            this->wait(m_ProducerWaiting, [this, write] {
+                return write - m_ReadPosition.load() < m_Buffer.size();
+            });
+        }
+        m_Buffer[write % m_Buffer.size()] = std::move(item);
+        m_WritePosition.store(write + 1);
+        this->notify(m_ConsumerWaiting);
+    }
+
+    //! Remove the item at the front of the queue into \p item, blocking
+    //! until there is one.
+    void pop(T& item) {
+        std::size_t read{m_ReadPosition.load(std::memory_order_relaxed)};
+        if (m_WritePosition.load(std::memory_order_acquire) == read) {
+            ++m_ConsumerStalls;
+            this->wait(m_ConsumerWaiting,
+                       [this, read] { return m_WritePosition.load() != read; });
+        }
+        item = std::move(m_Buffer[read % m_Buffer.size()]);
+        m_ReadPosition.store(read + 1);
+        this->notify(m_ProducerWaiting);
+    }
+
+    //! Get the maximum number of items the queue can hold.
+    std::size_t capacity() const { return m_Buffer.size(); }
+
+    //! Get the number of items in the queue.  This is only a snapshot if
+    //! called while items are being pushed or popped.
+    std::size_t size() const {
+        std::size_t read{m_ReadPosition.load()};
+        return m_WritePosition.load() - read;
+    }
+
+    //! Get the number of times push had to wait for space.
+    std::size_t producerStalls() const { return m_ProducerStalls.load(); }
+
+    //! Get the number of times pop had to wait for an item.
+    std::size_t consumerStalls() const { return m_ConsumerStalls.load(); }
+
+private:
+    using TAtomicBool = std::atomic<bool>;
+    using TAtomicSize = std::atomic<std::size_t>;
+
+private:
+    //! Sleep until \p ready returns true.
+    template<typename PREDICATE>
+    void wait(TAtomicBool& waiting, const PREDICATE& ready) {
+        std::unique_lock<std::mutex> lock{m_Mutex};
+        waiting.store(true);
+        m_Condition.wait(lock, ready);
+        waiting.store(false);
+    }
+
+    //! Wake the other side if it is waiting.
+    void notify(const TAtomicBool& waiting) {
+        if (waiting.load()) {
+            std::unique_lock<std::mutex> lock{m_Mutex};
+            m_Condition.notify_all();
+        }
+    }
+
+private:
+    //! The items.
+    std::vector<T> m_Buffer;
+
+    //! The total number of items popped.
+    TAtomicSize m_ReadPosition;
+
+    //! The total number of items pushed.
+    TAtomicSize m_WritePosition;
+
+    //! Set while the producer is waiting for space.
+    TAtomicBool m_ProducerWaiting;
+
+    //! Set while the consumer is waiting for an item.
+    TAtomicBool m_ConsumerWaiting;
+
+    //! The number of times the producer had to wait.
+    TAtomicSize m_ProducerStalls;
+
+    //! The number of times the consumer had to wait.
+    TAtomicSize m_ConsumerStalls;
+
+    //! Used to sleep and wake the side which is waiting.
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+};
+}
+}
+
+#endif // INCLUDED_ml_core_CSpscRingBuffer_h
@@ -44,7 +44,8 @@ public:
     }
 
     //! Store a floating point number with a given level of precision
-    void insertValue(const std::string& name, double value, CIEEE754::EPrecision precision);
+    virtual void
+    insertValue(const std::string& name, double value, CIEEE754::EPrecision precision);
 
     //! Store a nested level of state, to be populated by the supplied
     //! function or function object
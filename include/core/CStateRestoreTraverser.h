@@ -8,6 +8,7 @@
 
 #include <core/CLogger.h>
 #include <core/CNonCopyable.h>
+#include <core/CStringUtils.h>
 
 #include <core/ImportExport.h>
 
@@ -15,6 +16,7 @@
 
 namespace ml {
 namespace core {
+class CStatePersistInserter;
 
 //! \brief
 //! Abstract interface for restoring state.
@@ -82,9 +84,26 @@ public:
     //! element
     virtual const std::string& value() const = 0;
 
+    //! Convert the value of the current element to \p result.
+    template<typename TYPE>
+    bool valueAs(TYPE& result) const {
+        return CStringUtils::stringToType(this->value(), result);
+    }
+
+    //! Get the value of the current element as a double. Formats which
+    //! store floating point values in binary override this to avoid
+    //! converting them to and from a string.
+    virtual bool valueAs(double& result) const;
+
     //! Has the end of the inputstream been reached?
     virtual bool isEof() const = 0;
 
+    //! Copy the current element and the elements after it at the current
+    //! level, including all their sub-levels, to \p inserter.  This is
+    //! intended to be called from a function passed to traverseSubLevel
+    //! to capture a section of state so it can be restored elsewhere.
+    bool copyTo(CStatePersistInserter& inserter);
+
     //! Is the state document unintelligible?
     bool haveBadState() const;
 
@@ -93,6 +112,11 @@ protected:
     //! unintelligible.
     void setBadState();
 
+    //! Copy the name and value of the current element, which doesn't have
+    //! a sub-level, to \p inserter.  Formats which store values in binary
+    //! override this to avoid converting them to and from a string.
+    virtual void copyValue(CStatePersistInserter& inserter) const;
+
     //! Navigate to the start of the sub-level of the current element, or
     //! return false if there isn't one
     virtual bool descend() = 0;
@@ -0,0 +1,103 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_ml_core_CStaticThreadPool_h
+#define INCLUDED_ml_core_CStaticThreadPool_h
+
+#include <core/CNonCopyable.h>
+#include <core/ImportExport.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ml {
+namespace core {
+
+//! \brief
+//! A fixed size pool of worker threads.
+//!
+//! DESCRIPTION:\n
+//! Runs tasks on a fixed number of threads which are created when the
+//! pool is constructed and joined when it is destroyed.
+//!
+//! The main entry point is parallelForEach which calls a function for
+//! each index in a range, distributing the calls over the pool, and
+//! blocks until every call has completed. This is the pattern needed
+//! when independent pieces of work must be finished before a serial
+//! step can merge their results.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! The thread calling parallelForEach also processes indices. This means
+//! a pool with zero threads degrades to a simple loop, and that it is
+//! safe to call parallelForEach from a task which is itself running on
+//! the pool: the caller will finish the work even if no other thread is
+//! free to help.
+//!
+//! Indices are handed out one at a time from a shared counter, so calls
+//! with very uneven costs are still balanced across the threads.
+//!
+//! If any call throws, the first exception is rethrown on the calling
+//! thread once all the work has finished.
+class CORE_EXPORT CStaticThreadPool final : private CNonCopyable {
+public:
+    using TTask = std::function<void()>;
+    using TSizeFunc = std::function<void(std::size_t)>;
+
+public:
+    //! \param[in] size The number of worker threads to create. If this
+    //! is zero all work is done on the calling thread.
+    explicit CStaticThreadPool(std::size_t size);
+
+    ~CStaticThreadPool();
+
+    //! Get the number of worker threads.
+    std::size_t size() const;
+
+    //! Add \p task to the queue. It will be executed by the next free
+    //! worker, or immediately on the calling thread if there are none.
+    void schedule(TTask task);
+
+    //! Call \p f for each index in [0, \p n) and block until all the calls
+    //! have finished.
+    //!
+    //! \note \p f must be safe to call concurrently for distinct indices.
+    void parallelForEach(std::size_t n, const TSizeFunc& f);
+
+    //! Finish the queued tasks and stop the worker threads.
+    void shutdown();
+
+private:
+    using TThreadVec = std::vector<std::thread>;
+    using TTaskDeque = std::deque<TTask>;
+
+private:
+    //! The worker loop.
+    void worker();
+
+private:
+    //! Set when the pool is shutting down.
+    bool m_Done;
+
+    //! The pending tasks.
+    TTaskDeque m_Tasks;
+
+    //! Guards the task queue.
+    std::mutex m_Mutex;
+
+    //! Signalled when a task is queued or the pool shuts down.
+    std::condition_variable m_TaskReady;
+
+    //! The worker threads.
+    TThreadVec m_Workers;
+};
+}
+}
+
+#endif // INCLUDED_ml_core_CStaticThreadPool_h
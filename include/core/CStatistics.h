@@ -83,6 +83,30 @@ enum EStatTypes {
     //! The number of times partial memory estimates have been carried out
     E_NumberMemoryUsageEstimates,
 
+    //! The time in milliseconds for which input processing was paused to
+    //! start the last background persist
+    E_BackgroundPersistPauseTime,
+
+    //! The memory in bytes used by the last background persist which
+    //! wasn't shared with the live models
+    E_BackgroundPersistExtraMemory,
+
+    //! The number of batches of records passed from the input reader
+    //! thread to the processing thread
+    E_NumberInputBatches,
+
+    //! The total over batches of the number of batches waiting when each
+    //! one was taken for processing
+    E_InputQueueOccupancy,
+
+    //! The number of times the input reader thread had to wait because
+    //! the input queue was full
+    E_InputReaderStalls,
+
+    //! The number of times the processing thread had to wait because the
+    //! input queue was empty
+    E_InputProcessorStalls,
+
     // Add any new values here
 
     //! This MUST be last
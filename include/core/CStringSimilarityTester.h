@@ -14,7 +14,10 @@
 #include <boost/scoped_array.hpp>
 
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <iterator>
+#include <limits>
 #include <sstream>
 #include <string>
 
@@ -199,8 +202,10 @@ public:
     //! matrix diagonals are not necessarily monotonically increasing.
     //! See http://www.cs.helsinki.fi/u/ukkonen/InfCont85.PDF
     //!
-    //! TODO - It may be possible to apply some of the lesser optimisations
-    //! from section 2 of Ukkonen's paper to this algorithm.
+    //! If every element has the same weight then the weighted edit distance
+    //! is just that weight multiplied by the Levenshtein distance, which is
+    //! calculated many elements at a time.  In this case the first element
+    //! of each pair must also implement operator<().
     template<typename PAIRCONTAINER>
     size_t weightedEditDistance(const PAIRCONTAINER& first, const PAIRCONTAINER& second) const {
         // This is similar to the levenshteinDistanceSimple() method below,
@@ -229,6 +234,16 @@ public:
             return cost;
         }
 
+        size_t weight(0);
+        if (this->uniformWeight(first, second, weight) &&
+            std::min(firstLen, secondLen) <= BIT_PARALLEL_MAX_LENGTH) {
+            // The distance can't exceed the length of the longer sequence
+            size_t maxDistance(std::max(firstLen, secondLen));
+            return weight * (firstLen <= secondLen
+                                 ? this->bitParallelEditDistance(first, second, maxDistance)
+                                 : this->bitParallelEditDistance(second, first, maxDistance));
+        }
+
         // We need to store two columns of the matrix, but allocate both in
         // one go for efficiency.  Then the current and previous column
         // pointers alternate between pointing and the first and second half
@@ -284,7 +299,289 @@ public:
         return currentCol[secondLen];
     }
 
+    //! Calculate the weighted edit distance between two sequences, as
+    //! above, but give up as soon as it's known to exceed \p maxCost.
+    //! This is much cheaper than calculating the exact distance between
+    //! sequences which are very different, and callers often only need
+    //! the distance if it's small enough to be interesting.
+    //!
+    //! \return The weighted edit distance if this is no greater than
+    //! \p maxCost and otherwise some value greater than \p maxCost.
+    template<typename PAIRCONTAINER>
+    size_t weightedEditDistance(const PAIRCONTAINER& first,
+                                const PAIRCONTAINER& second,
+                                size_t maxCost) const {
+        size_t firstLen(first.size());
+        size_t secondLen(second.size());
+
+        // The boundary cases are cheap, and there's nothing to gain by
+        // imposing a bound if every result is acceptable
+        if (firstLen == 0 || secondLen == 0 ||
+            maxCost == std::numeric_limits<size_t>::max()) {
+            return this->weightedEditDistance(first, second);
+        }
+
+        size_t weight(0);
+        if (this->uniformWeight(first, second, weight) &&
+            std::min(firstLen, secondLen) <= BIT_PARALLEL_MAX_LENGTH) {
+            if (weight == 0) {
+                return 0;
+            }
+            size_t maxDistance(maxCost / weight);
+            size_t distance(firstLen <= secondLen
+                                ? this->bitParallelEditDistance(first, second, maxDistance)
+                                : this->bitParallelEditDistance(second, first, maxDistance));
+            return distance > maxDistance ? maxCost + 1 : weight * distance;
+        }
+
+        return this->bandedWeightedEditDistance(first, second, maxCost);
+    }
+
 private:
+    //! Sequences no longer than this can be compared a whole column of the
+    //! edit distance matrix at a time by bitParallelEditDistance().
+    static const size_t BIT_PARALLEL_MAX_LENGTH = 64;
+
+private:
+    //! Check if every element of \p first and \p second has the same
+    //! weight and, if so, get it in \p weight.
+    template<typename PAIRCONTAINER>
+    static bool uniformWeight(const PAIRCONTAINER& first,
+                              const PAIRCONTAINER& second,
+                              size_t& weight) {
+        weight = first.size() > 0 ? first[0].second : second[0].second;
+        for (size_t index = 0; index < first.size(); ++index) {
+            if (first[index].second != weight) {
+                return false;
+            }
+        }
+        for (size_t index = 0; index < second.size(); ++index) {
+            if (second[index].second != weight) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //! Calculate the Levenshtein distance between the first elements of
+    //! the pairs in two sequences using Myers' bit-vector algorithm, in the
+    //! formulation given by Hyyrö, which updates a whole column of the
+    //! matrix with a handful of word operations.  See
+    //! http://www.cs.tut.fi/~hyyro/publications/HyyroNordic03.pdf
+    //! This private method assumes that 0 < pattern.size() <= 64 and that
+    //! text.size() >= pattern.size().
+    //!
+    //! \return The distance if this is no greater than \p maxDistance and
+    //! otherwise some value greater than \p maxDistance.
+    template<typename PAIRCONTAINER>
+    size_t bitParallelEditDistance(const PAIRCONTAINER& pattern,
+                                   const PAIRCONTAINER& text,
+                                   size_t maxDistance) const {
+        size_t patternLen(pattern.size());
+        size_t textLen(text.size());
+
+        // Every extra element of the text needs an insertion
+        if (textLen - patternLen > maxDistance) {
+            return maxDistance + 1;
+        }
+
+        // Build the match mask of each distinct element of the pattern,
+        // i.e. the bit set of positions at which it occurs.  These are kept
+        // sorted by element so the mask of each element of the text can be
+        // found by binary search.  The elements are referred to by their
+        // first position in the pattern to avoid copying them.
+        using TElement = typename PAIRCONTAINER::value_type::first_type;
+        size_t elements[BIT_PARALLEL_MAX_LENGTH];
+        uint64_t masks[BIT_PARALLEL_MAX_LENGTH];
+        size_t numberElements(0);
+        auto less = [&pattern](size_t lhs, const TElement& rhs) {
+            return pattern[lhs].first < rhs;
+        };
+        auto lowerBound = [&](const TElement& element) {
+            return std::lower_bound(elements, elements + numberElements, element, less) -
+                   elements;
+        };
+        for (size_t index = 0; index < patternLen; ++index) {
+            std::ptrdiff_t position(lowerBound(pattern[index].first));
+            if (position == static_cast<std::ptrdiff_t>(numberElements) ||
+                !(pattern[elements[position]].first == pattern[index].first)) {
+                std::copy_backward(elements + position, elements + numberElements,
+                                   elements + numberElements + 1);
+                std::copy_backward(masks + position, masks + numberElements,
+                                   masks + numberElements + 1);
+                elements[position] = index;
+                masks[position] = 0;
+                ++numberElements;
+            }
+            masks[position] |= uint64_t(1) << index;
+        }
+
+        // The positive and negative vertical differences between adjacent
+        // cells of the current column, packed one row per bit
+        uint64_t lastRow(uint64_t(1) << (patternLen - 1));
+        uint64_t positive(~uint64_t(0));
+        uint64_t negative(0);
+        size_t distance(patternLen);
+
+        for (size_t across = 0; across < textLen; ++across) {
+            std::ptrdiff_t position(lowerBound(text[across].first));
+            uint64_t match(position < static_cast<std::ptrdiff_t>(numberElements) &&
+                                   pattern[elements[position]].first == text[across].first
+                               ? masks[position]
+                               : 0);
+
+            uint64_t xVertical(match | negative);
+            uint64_t xHorizontal((((match & positive) + positive) ^ positive) | match);
+            uint64_t positiveHorizontal(negative | ~(xHorizontal | positive));
+            uint64_t negativeHorizontal(positive & xHorizontal);
+
+            if (positiveHorizontal & lastRow) {
+                ++distance;
+            } else if (negativeHorizontal & lastRow) {
+                --distance;
+            }
+
+            // The top row of the matrix increases by one in every column
+            positiveHorizontal = (positiveHorizontal << 1) | 1;
+            negativeHorizontal <<= 1;
+            positive = negativeHorizontal | ~(xVertical | positiveHorizontal);
+            negative = positiveHorizontal & xVertical;
+
+            // The bottom row can decrease by at most one in each remaining
+            // column
+            if (distance > maxDistance + (textLen - across - 1)) {
+                return maxDistance + 1;
+            }
+        }
+
+        return distance;
+    }
+
+    //! Calculate the weighted edit distance, restricting the calculation to
+    //! the cells of the matrix which could be on a path costing no more
+    //! than \p maxCost.  This uses two of the optimisations from section 2
+    //! of Ukkonen's paper referenced above:
+    //!   -# Costs never decrease along a path, so rows of a column whose
+    //!      cost exceeds \p maxCost can be skipped, and in particular the
+    //!      calculation stops if this is true of every row in a column.
+    //!   -# Every path through a cell off the main diagonal needs at least
+    //!      one insertion or deletion per diagonal it moves across, so only
+    //!      a band of diagonals can be reached at an acceptable cost.
+    //! This private method assumes that first.size() > 0 and
+    //! second.size() > 0.
+    //!
+    //! \return The weighted edit distance if this is no greater than
+    //! \p maxCost and otherwise maxCost + 1.
+    template<typename PAIRCONTAINER>
+    size_t bandedWeightedEditDistance(const PAIRCONTAINER& first,
+                                      const PAIRCONTAINER& second,
+                                      size_t maxCost) const {
+        size_t firstLen(first.size());
+        size_t secondLen(second.size());
+        size_t exceeded(maxCost + 1);
+
+        // The number of diagonals above and below the main diagonal which
+        // can be reached.  Any path to the bottom right hand corner must
+        // move (secondLen - firstLen) diagonals and every diagonal it strays
+        // from the one it's heading for must be crossed twice.
+        size_t above(secondLen);
+        size_t below(firstLen);
+        size_t minWeight(std::numeric_limits<size_t>::max());
+        for (size_t index = 0; index < firstLen; ++index) {
+            minWeight = std::min(minWeight, first[index].second);
+        }
+        for (size_t index = 0; index < secondLen; ++index) {
+            minWeight = std::min(minWeight, second[index].second);
+        }
+        if (minWeight > 0) {
+            size_t maxIndels(maxCost / minWeight);
+            size_t lengthDiff(firstLen > secondLen ? firstLen - secondLen
+                                                   : secondLen - firstLen);
+            if (lengthDiff > maxIndels) {
+                return exceeded;
+            }
+            size_t slack((maxIndels - lengthDiff) / 2);
+            above = std::min(secondLen, slack + (secondLen > firstLen ? lengthDiff : 0));
+            below = std::min(firstLen, slack + (firstLen > secondLen ? lengthDiff : 0));
+        }
+
+        // We need to store two columns of the matrix, as the unbounded
+        // method does, but only the rows from prevLow to prevHigh of the
+        // previous column are valid.  All others are treated as exceeding
+        // the maximum cost.
+        TScopedSizeArray data(new size_t[(secondLen + 1) * 2]);
+        size_t* currentCol(data.get());
+        size_t* prevCol(currentCol + (secondLen + 1));
+
+        // Populate the left column
+        currentCol[0] = 0;
+        size_t low(0);
+        size_t high(0);
+        for (size_t downMinusOne = 0; downMinusOne < above; ++downMinusOne) {
+            currentCol[downMinusOne + 1] = currentCol[downMinusOne] +
+                                           second[downMinusOne].second;
+            if (currentCol[downMinusOne + 1] > maxCost) {
+                break;
+            }
+            high = downMinusOne + 1;
+        }
+
+        // Calculate the other entries in the matrix
+        for (size_t acrossMinusOne = 0; acrossMinusOne < firstLen; ++acrossMinusOne) {
+            std::swap(currentCol, prevCol);
+            size_t prevLow(low);
+            size_t prevHigh(high);
+            size_t firstCost(first[acrossMinusOne].second);
+
+            // Rows above the previous column's first valid row can't be
+            // reached at an acceptable cost
+            size_t across(acrossMinusOne + 1);
+            size_t start(std::max(prevLow, across > below ? across - below : 0));
+            size_t end(std::min(secondLen, across + above));
+
+            bool any(false);
+            for (size_t down = start; down <= end; ++down) {
+                // Deletion
+                size_t cost(down <= prevHigh ? prevCol[down] + firstCost : exceeded);
+                if (down > 0) {
+                    size_t secondCost(second[down - 1].second);
+                    // Insertion
+                    if (down > start) {
+                        cost = std::min(cost, currentCol[down - 1] + secondCost);
+                    }
+                    // Substitution
+                    if (down - 1 >= prevLow && down - 1 <= prevHigh) {
+                        cost = std::min(
+                            cost, prevCol[down - 1] +
+                                      ((first[acrossMinusOne].first == second[down - 1].first)
+                                           ? 0
+                                           : std::max(firstCost, secondCost)));
+                    }
+                }
+                currentCol[down] = cost;
+
+                if (cost <= maxCost) {
+                    if (any == false) {
+                        low = down;
+                        any = true;
+                    }
+                    high = down;
+                } else if (down > prevHigh) {
+                    // Only insertions remain below here and these can only
+                    // increase the cost
+                    break;
+                }
+            }
+
+            if (any == false) {
+                return exceeded;
+            }
+        }
+
+        // Result is the value in the bottom right hand corner of the matrix
+        return high == secondLen ? currentCol[secondLen] : exceeded;
+    }
+
     //! Calculate the Levenshtein distance using the naive method of
     //! calculating the entire distance matrix.  This private method
     //! assumes that first.size() > 0 and second.size() > 0.  However,
@@ -8,6 +8,7 @@
 
 #include <core/CFastMutex.h>
 #include <core/CNonCopyable.h>
+#include <core/CPerfectHashWordMap.h>
 #include <core/ImportExport.h>
 
 #include <boost/unordered_map.hpp>
@@ -40,6 +41,12 @@ namespace core {
 //!
 //! All checks are case-insensitive.
 //!
+//! If a compiled image of the dictionary, as written by compile(), is
+//! installed alongside the text file it is memory mapped instead of
+//! loading the text file.  This avoids parsing the text file at start
+//! up and means the dictionary's pages are shared between processes.
+//! The text file is loaded if the image is missing or invalid.
+//!
 //! TODO - extend this to cope with different dictionaries for
 //! different languages.
 //!
@@ -131,6 +138,10 @@ public:
     //! aren't in the dictionary.
     EPartOfSpeech partOfSpeech(const std::string& str) const;
 
+    //! Compile the text dictionary \p dictionaryFile into an image which
+    //! can be memory mapped and write it to \p compiledFile.
+    static bool compile(const std::string& dictionaryFile, const std::string& compiledFile);
+
 private:
     //! Constructor for a singleton is private
     CWordDictionary();
@@ -151,6 +162,9 @@ private:
     //! Name of the file to load that contains the dictionary words.
     static const char* const DICTIONARY_FILE;
 
+    //! Name of the file containing the compiled dictionary image.
+    static const char* const COMPILED_DICTIONARY_FILE;
+
     //! The constructor loads a file, and hence may take a while.  This
     //! mutex prevents the singleton object being constructed simultaneously
     //! in different threads.
@@ -169,8 +183,11 @@ private:
         boost::unordered_map<std::string, EPartOfSpeech, CStrHashIgnoreCase, CStrEqualIgnoreCase>;
     using TStrUMapCItr = TStrUMap::const_iterator;
 
-    //! Our dictionary of words
+    //! Our dictionary of words, if the compiled image isn't available
     TStrUMap m_DictionaryWords;
+
+    //! The compiled dictionary image, if it's available
+    CPerfectHashWordMap m_CompiledWords;
 };
 }
 }
@@ -62,6 +62,9 @@ public:
     //! Check if there are calendar components.
     TOptionalFeature test() const;
 
+    //! Get the number of buckets in the test window.
+    std::size_t size() const;
+
     //! Get a checksum for this object.
     std::uint64_t checksum(std::uint64_t seed = 0) const;
 
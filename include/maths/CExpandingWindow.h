@@ -45,11 +45,15 @@ namespace maths {
 //! bucketing interval expands.
 //!
 //! Since the bucket values can constitute a significant amount of
-//! memory, one can choose to store them in deflated format. Empirically,
-//! this saves between 60% and 95% of the memory of this class depending
-//! primarily on the number of populated buckets.
+//! memory, one can choose to store them compressed. They can either
+//! be deflated or byte packed. Byte packing XORs each bucket's count
+//! and mean with the previous populated bucket's, stores only their
+//! significant bytes and run length encodes empty buckets. It is as
+//! small as deflating the values and much cheaper to read and write,
+//! since there is no zlib stream and values are unpacked straight into
+//! the vector returned to the caller.
 //!
-//! The CPU cost of deflation is amortised by maintaining a small buffer
+//! The CPU cost of compression is amortised by maintaining a small buffer
 //! which is update with new values and only flushed when full.
 class MATHS_EXPORT CExpandingWindow {
 public:
@@ -60,12 +64,15 @@ public:
     using TFloatMeanAccumulatorVec = std::vector<TFloatMeanAccumulator>;
     using TPredictor = std::function<double(core_t::TTime)>;
 
+    //! The ways in which the bucket values can be stored.
+    enum ECompression { E_NoCompression, E_Deflate, E_BytePack };
+
 public:
     CExpandingWindow(core_t::TTime bucketLength,
                      TTimeCRng bucketLengths,
                      std::size_t size,
                      double decayRate = 0.0,
-                     bool deflate = true);
+                     ECompression compression = E_BytePack);
 
     //! Initialize by reading state from \p traverser.
     bool acceptRestoreTraverser(core::CStateRestoreTraverser& traverser);
@@ -124,35 +131,46 @@ private:
     using TSizeFloatMeanAccumulatorPr = std::pair<std::size_t, TFloatMeanAccumulator>;
     using TSizeFloatMeanAccumulatorPrVec = std::vector<TSizeFloatMeanAccumulatorPr>;
 
-    //! \brief Inflates the bucket values for the lifetime of the object.
-    class MATHS_EXPORT CScopeInflate : private core::CNonCopyable {
+    //! \brief Decompresses the bucket values for the lifetime of the object.
+    class MATHS_EXPORT CScopeDecompress : private core::CNonCopyable {
     public:
-        CScopeInflate(const CExpandingWindow& window, bool commit);
-        ~CScopeInflate();
+        CScopeDecompress(const CExpandingWindow& window, bool commit);
+        ~CScopeDecompress();
 
     private:
-        //! The window to inflate.
+        //! The window to decompress.
         const CExpandingWindow& m_Window;
         //! True if any buffered changes are to be committed.
         bool m_Commit;
     };
 
 private:
+    //! Get the bucket values, including any buffered changes, in \p result.
+    //!
+    //! \note This doesn't change the stored representation.
+    void bucketValues(TFloatMeanAccumulatorVec& result) const;
+
     //! Convert to a compressed representation.
-    void deflate(bool commit) const;
+    void compress(bool commit) const;
 
-    //! Implements deflate.
-    void doDeflate(bool commit);
+    //! Implements compress.
+    void doCompress(bool commit);
 
     //! Extract from the compressed representation.
-    void inflate(bool commit) const;
+    void decompress(bool commit) const;
+
+    //! Implements decompress.
+    void doDecompress(bool commit);
+
+    //! Extract the compressed values into \p result.
+    void extract(TFloatMeanAccumulatorVec& result) const;
 
-    //! Implements inflate.
-    void doInflate(bool commit);
+    //! Add the buffered values to \p result.
+    void addBufferedValues(TFloatMeanAccumulatorVec& result) const;
 
 private:
-    //! True if the bucket values are stored in deflated format.
-    bool m_Deflate;
+    //! The way the bucket values are stored.
+    ECompression m_Compression;
 
     //! The rate at which the bucket values are aged.
     double m_DecayRate;
@@ -181,8 +199,8 @@ private:
     //! The bucket values.
     TFloatMeanAccumulatorVec m_BucketValues;
 
-    //! The deflated bucket values.
-    TByteVec m_DeflatedBucketValues;
+    //! The compressed bucket values.
+    TByteVec m_CompressedBucketValues;
 
     //! The mean value time modulo the data bucketing length.
     TFloatMeanAccumulator m_MeanOffset;
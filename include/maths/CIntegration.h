@@ -217,6 +217,70 @@ public:
     //! false means that the function could not be evaluated at x.
     template<EOrder ORDER, typename F>
     static bool logGaussLegendre(const F& function, double a, double b, double& result) {
+        return batchLogGaussLegendre<ORDER>(
+            [&function](const double* x, std::size_t n, double* fx) {
+                for (std::size_t i = 0; i < n; ++i) {
+                    if (!function(x[i], fx[i])) {
+                        return false;
+                    }
+                }
+                return true;
+            },
+            a, b, result);
+    }
+
+    //! Gauss-Legendre quadrature of a function which is evaluated at all
+    //! the abscissas in one call.
+    //!
+    //! This is equivalent to gaussLegendre, but lets \p function share work
+    //! between the abscissas, for example by evaluating them all in one pass
+    //! over some data.
+    //!
+    //! \tparam ORDER The order of quadrature to use.
+    //! \tparam F It is assumed that this has the signature:
+    //!   bool function(const double* x, std::size_t n, double* f)
+    //! where f[i] is filled in with the value of the function at x[i] and
+    //! returning false means that the function could not be evaluated.
+    template<EOrder ORDER, typename F>
+    static bool batchGaussLegendre(const F& function, double a, double b, double& result) {
+        result = 0.0;
+
+        const double* weights = CGaussLegendreQuadrature::weights(ORDER);
+        const double* abscissas = CGaussLegendreQuadrature::abscissas(ORDER);
+
+        double x[ORDER];
+        double fx[ORDER] = {0.0};
+
+        double centre = (a + b) / 2.0;
+        double range = (b - a) / 2.0;
+        for (unsigned int i = 0; i < ORDER; ++i) {
+            x[i] = centre + range * abscissas[i];
+        }
+        if (!function(x, ORDER, fx)) {
+            return false;
+        }
+
+        for (unsigned int i = 0; i < ORDER; ++i) {
+            result += weights[i] * fx[i];
+        }
+        result *= range;
+
+        return true;
+    }
+
+    //! Gauss-Legendre quadrature using logarithms of a function which is
+    //! evaluated at all the abscissas in one call.
+    //!
+    //! This is equivalent to logGaussLegendre, but lets \p function share
+    //! work between the abscissas.
+    //!
+    //! \tparam ORDER The order of quadrature to use.
+    //! \tparam F It is assumed that this has the signature:
+    //!   bool function(const double* x, std::size_t n, double* f)
+    //! where f[i] is filled in with the log of the function at x[i] and
+    //! returning false means that the function could not be evaluated.
+    template<EOrder ORDER, typename F>
+    static bool batchLogGaussLegendre(const F& function, double a, double b, double& result) {
         result = 0.0;
 
         if (b <= a) {
@@ -226,15 +290,17 @@ public:
         const double* weights = CGaussLegendreQuadrature::weights(ORDER);
         const double* abscissas = CGaussLegendreQuadrature::abscissas(ORDER);
 
+        double x[ORDER];
         double fx[ORDER] = {0.0};
 
         // Evaluate f(x) at the abscissas.
         double centre = (a + b) / 2.0;
         double range = (b - a) / 2.0;
         for (unsigned int i = 0; i < ORDER; ++i) {
-            if (!function(centre + range * abscissas[i], fx[i])) {
-                return false;
-            }
+            x[i] = centre + range * abscissas[i];
+        }
+        if (!function(x, ORDER, fx)) {
+            return false;
         }
 
         // Re-normalize and then take exponentials to avoid underflow.
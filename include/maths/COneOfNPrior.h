@@ -44,8 +44,24 @@ struct SDistributionRestoreParams;
 //! in. All component models are owned by the object (it wouldn't make sense
 //! to share them) so this also defines the necessary functions to support
 //! value semantics and manage the heap.
+//!
+//! Once the data are well described by one model, the others only matter in
+//! so far as they can become competitive again. So, if lazy updates are enabled,
+//! models whose weight falls far below the most probable model's are frozen:
+//! their weights are still updated with every sample, but their parameters
+//! aren't, and the samples and time by which they must be propagated are
+//! instead queued. This is much cheaper because the parameter updates of most
+//! models are far more expensive than their likelihood and are much cheaper
+//! per sample in a batch. A frozen model is brought up-to-date, by replaying
+//! the queued samples as one batch, when its queue is full, when its weight
+//! recovers or when a sample falls outside its support. Its parameters are
+//! only a few samples out of date in the meantime and its weight is tiny, so
+//! this has little effect on model selection or the marginal likelihood.
 class MATHS_EXPORT COneOfNPrior : public CPrior {
 public:
+    //! The maximum number of samples by which a frozen model can lag.
+    static const std::size_t MAXIMUM_PENDING_SAMPLES;
+
     using TPriorPtr = std::unique_ptr<CPrior>;
     using TPriorPtrVec = std::vector<TPriorPtr>;
     using TPriorCPtrVec = std::vector<const CPrior*>;
@@ -141,6 +157,7 @@ public:
 
     //! Update the model weights using the marginal likelihoods for
     //! the data. The component prior parameters are then updated.
+    //! Frozen models are only updated lazily (see lazyUpdates).
     //!
     //! \param[in] samples A collection of samples of the variable.
     //! \param[in] weights The weights of each sample in \p samples.
@@ -317,8 +334,22 @@ public:
 
     //! Get the current constituent models.
     TPriorCPtrVec models() const;
+
+    //! Get the number of frozen models.
+    std::size_t numberFrozenModels() const;
+
+    //! Get the largest number of samples queued for any frozen model.
+    std::size_t maximumNumberPendingSamples() const;
     //@}
 
+    //! Enable or disable lazy updates of models with very low weight.
+    //!
+    //! These are disabled by default because the queued updates of the
+    //! frozen models use much more memory than the models themselves.
+    //!
+    //! \note If disabled all frozen models are brought up-to-date.
+    void lazyUpdates(bool enabled);
+
 private:
     using TDoubleSizePr = std::pair<double, std::size_t>;
     using TDoubleSizePr5Vec = core::CSmallVector<TDoubleSizePr, 5>;
@@ -326,6 +357,33 @@ private:
     using TWeightPriorPtrPrVec = std::vector<TWeightPriorPtrPr>;
     using TMaxAccumulator = CBasicStatistics::SMax<double>::TAccumulator;
 
+    //! \brief The updates which haven't yet been applied to a frozen model.
+    struct SPendingUpdates {
+        //! Get a checksum for this object.
+        uint64_t checksum(uint64_t seed) const;
+
+        //! Debug the memory used by this object.
+        void debugMemoryUsage(core::CMemoryUsage::TMemoryUsagePtr mem) const;
+
+        //! Get the memory used by this object.
+        std::size_t memoryUsage() const;
+
+        //! Persist state by passing information to \p inserter.
+        void acceptPersistInserter(core::CStatePersistInserter& inserter) const;
+
+        //! Restore state reading information from \p traverser.
+        bool acceptRestoreTraverser(core::CStateRestoreTraverser& traverser);
+
+        //! The samples.
+        TDouble1Vec s_Samples;
+        //! The weights of the samples.
+        TDoubleWeightsAry1Vec s_Weights;
+        //! The time by which the model hasn't been propagated.
+        double s_Time = 0.0;
+    };
+    using TPendingUpdatesPtr = std::unique_ptr<SPendingUpdates>;
+    using TPendingUpdatesPtrVec = std::vector<TPendingUpdatesPtr>;
+
 private:
     //! Read parameters from \p traverser.
     bool acceptRestoreTraverser(const SDistributionRestoreParams& params,
@@ -338,6 +396,16 @@ private:
     //! Get the normalized model weights.
     TDoubleSizePr5Vec normalizedLogWeights() const;
 
+    //! Bring any frozen models which can't wait until later up-to-date
+    //! before adding \p samples.
+    void thawModels(const TDouble1Vec& samples);
+
+    //! Check if the i'th model is frozen.
+    bool isFrozen(std::size_t i) const;
+
+    //! Apply the pending updates to the i'th model.
+    void thaw(std::size_t i);
+
     //! Get the median of the model means.
     double medianModelMean() const;
 
@@ -350,6 +418,13 @@ private:
 private:
     //! A collection of component models and their probabilities.
     TWeightPriorPtrPrVec m_Models;
+
+    //! The samples pending for each model, which are null unless the model
+    //! is frozen. This is empty unless lazy updates are enabled.
+    TPendingUpdatesPtrVec m_PendingUpdates;
+
+    //! True if models with very low weight are frozen.
+    bool m_LazyUpdates = false;
 };
 }
 }
@@ -77,6 +77,7 @@ namespace maths {
 //! and to reserve sufficient memory up front for our node allocator.
 class MATHS_EXPORT CQDigest : private core::CNonCopyable {
 public:
+    using TUInt32Vec = std::vector<uint32_t>;
     using TUInt32UInt64Pr = std::pair<uint32_t, uint64_t>;
     using TUInt32UInt64PrVec = std::vector<TUInt32UInt64Pr>;
 
@@ -176,6 +177,14 @@ public:
     //! Get the minimum knot point greater than \p x.
     void superlevelSetInfimum(uint32_t x, uint32_t& result) const;
 
+    //! Get the values at which the c.d.f. and p.d.f. bounds can change.
+    //!
+    //! The bounds computed by cdf and pdf are constant for all values
+    //! between consecutive end points, i.e. on each interval [x(i), x(i+1)).
+    //!
+    //! \param[out] result Filled in with the sorted distinct end points.
+    void cdfEndPoints(TUInt32Vec& result) const;
+
     //! Get a summary of the q-digest. This is the counts less
     //! than or equal to each distinct integer in the quantile
     //! summary.
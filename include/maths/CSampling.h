@@ -20,6 +20,8 @@
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/uniform_int_distribution.hpp>
 
+#include <atomic>
+#include <cstdint>
 #include <vector>
 
 namespace ml {
@@ -33,6 +35,14 @@ namespace maths {
 //!
 //! DEFINITION:\n
 //! This is a place holder for random sampling utilities and algorithms.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! The functions which don't take a generator draw from a shared generator
+//! which is protected by a lock. A thread can instead draw from its own
+//! stream, without locking, by creating a CScopeRandomNumberStream. The
+//! stream is seeded from a global seed and an identifier, so a piece of
+//! work which always uses the same identifier sees the same random numbers
+//! whichever thread runs it and whatever else is running at the same time.
 class MATHS_EXPORT CSampling : private core::CNonInstantiatable {
 public:
     using TDoubleVec = std::vector<double>;
@@ -110,6 +120,53 @@ public:
         ~CScopeMockRandomNumberGenerator();
     };
 
+    //! \brief Makes the calling thread draw from its own random number
+    //! stream in the scope in which it is constructed.
+    //!
+    //! DESCRIPTION:\n
+    //! While an object of this class is in scope, all the sampling functions
+    //! which don't take a generator use a generator which is private to the
+    //! calling thread. It is seeded from the global seed and \p stream, so
+    //! draws don't need a lock and don't depend on other threads' draws.
+    //!
+    //! Scopes nest: the enclosing stream is restored when one ends. If the
+    //! shared generator is mocked when the scope is created the mock is
+    //! used instead.
+    //!
+    //! Work which is handed to other threads should open a stream on the
+    //! thread which does it. Its identifier should combine current(), read
+    //! on the thread which hands out the work, with something which fixes
+    //! the piece of work, so the draws don't depend on how the work is
+    //! split between threads.
+    //!
+    //! \warning This must be created and destroyed on the same thread.
+    class MATHS_EXPORT CScopeRandomNumberStream : private core::CNonCopyable {
+    public:
+        using TOptionalUInt64 = boost::optional<std::uint64_t>;
+
+    public:
+        explicit CScopeRandomNumberStream(std::uint64_t stream);
+        ~CScopeRandomNumberStream();
+
+        //! Get the identifier of the calling thread's current stream or
+        //! none if it doesn't have one.
+        static TOptionalUInt64 current();
+
+        //! Get the generator for the calling thread's current stream
+        //! or null if it should use the shared generator.
+        static CPRNG::CXorOShiro128Plus* generator();
+
+    private:
+        //! The enclosing stream.
+        CScopeRandomNumberStream* m_Previous;
+        //! The stream's identifier.
+        std::uint64_t m_Stream;
+        //! True if the shared generator was mocked.
+        bool m_Mocked;
+        //! The stream's generator.
+        CPRNG::CXorOShiro128Plus m_Rng;
+    };
+
 public:
     //! \name Persistence
     //@{
@@ -120,7 +177,8 @@ public:
     static void staticsAcceptPersistInserter(core::CStatePersistInserter& inserter);
     //@}
 
-    //! Reinitialize the random number generator.
+    //! Reinitialize the shared random number generator and the seed
+    //! used for streams.
     static void seed();
 
     //! \name Uniform Sampling
@@ -376,8 +434,7 @@ public:
     //! internal random number generator to provide a random distribution.
     template<typename ITR>
     static void random_shuffle(ITR first, ITR last) {
-        core::CScopedFastLock scopedLock(ms_Lock);
-        random_shuffle(ms_Rng, first, last);
+        withGenerator([first, last](auto& rng) { random_shuffle(rng, first, last); });
     }
 
     //! Optimal (in a sense to be defined below) weighted sampling
@@ -421,12 +478,29 @@ private:
         RNG* m_Generator;
     };
 
+    //! Call \p f with the calling thread's random number generator.
+    template<typename F>
+    static decltype(auto) withGenerator(F f) {
+        CPRNG::CXorOShiro128Plus* rng = CScopeRandomNumberStream::generator();
+        if (rng != nullptr) {
+            return f(*rng);
+        }
+        core::CScopedFastLock scopedLock(ms_Lock);
+        return f(ms_Rng);
+    }
+
 private:
     //! The mutex for protecting access to the random number generator.
     static core::CFastMutex ms_Lock;
 
     //! The uniform random number generator.
     static CRandomNumberGenerator ms_Rng;
+
+    //! The seed which is combined with a stream's identifier to seed it.
+    static std::atomic<std::uint64_t> ms_StreamSeed;
+
+    //! True if the shared generator is mocked.
+    static std::atomic<bool> ms_Mocked;
 };
 }
 }
@@ -37,12 +37,21 @@ public:
 
     //! Cooley-Tukey fast DFT transform implementation.
     //!
-    //! \note This is a simple implementation radix 2 DIT which uses the chirp-z
-    //! idea to handle the case that the length of \p fx is not a power of 2. As
-    //! such it is definitely not a highly optimized FFT implementation. It should
-    //! be sufficiently fast for our needs.
+    //! \note This is a mixed radix DIT with specialised butterflies for radices
+    //! 2, 3, 4 and 5 which uses the chirp-z idea to handle the case that the
+    //! length of \p f has a prime factor greater than 31. The factors and twiddle
+    //! factors for each length are computed once and cached per thread.
     static void fft(TComplexVec& f);
 
+    //! Compute the DFT of the real series \p f.
+    //!
+    //! \note This uses a complex DFT of half the length if the length of \p f
+    //! is even.
+    //!
+    //! \param[in] f The values to transform.
+    //! \param[out] result Filled in with the DFT of \p f.
+    static void fft(const TDoubleVec& f, TComplexVec& result);
+
     //! This uses conjugate of the conjugate of the series is the inverse DFT trick
     //! to compute this using fft.
     static void ifft(TComplexVec& f);
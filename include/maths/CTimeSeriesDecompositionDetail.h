@@ -21,6 +21,7 @@
 #include <maths/CTrendComponent.h>
 #include <maths/ImportExport.h>
 
+#include <boost/optional.hpp>
 #include <boost/ref.hpp>
 
 #include <cstddef>
@@ -185,6 +186,10 @@ public:
 
     //! \brief Scans through increasingly low frequencies looking for custom
     //! diurnal and any other large amplitude seasonal components.
+    //!
+    //! DESCRIPTION:\n
+    //! Tests can be deferred by the CTimeSeriesTestScheduler, in which case
+    //! a copy of the window is kept to test later.
     class MATHS_EXPORT CPeriodicityTest : public CHandler {
     public:
         using TFloatMeanAccumulator = CBasicStatistics::SSampleMean<CFloatStorage>::TAccumulator;
@@ -253,8 +258,11 @@ public:
         //! Handle \p symbol.
         void apply(std::size_t symbol, const SMessage& message);
 
+        //! Run \p test on \p window.
+        void test(ETest test, const CExpandingWindow& window, const SAddValue& message);
+
         //! Get a new \p test. (Warning: this is owned by the caller.)
-        CExpandingWindow* newWindow(ETest test, bool deflate = true) const;
+        CExpandingWindow* newWindow(ETest test, bool compress = true) const;
 
         //! Account for memory that is not yet allocated
         //! during the initial state
@@ -272,10 +280,20 @@ public:
 
         //! Expanding windows on the "recent" time series values.
         TExpandingWindowPtrAry m_Windows;
+
+        //! Copies of the windows whose tests have been deferred.
+        TExpandingWindowPtrAry m_DeferredWindows;
+
+        //! The times at which to run the deferred tests.
+        TTimeAry m_DeferredTimes;
     };
 
     //! \brief Tests for cyclic calendar components explaining large prediction
     //! errors.
+    //!
+    //! DESCRIPTION:\n
+    //! Tests can be deferred by the CTimeSeriesTestScheduler, in which case
+    //! a copy of the test is kept to run later.
     class MATHS_EXPORT CCalendarTest : public CHandler {
     public:
         CCalendarTest(double decayRate, core_t::TTime bucketLength);
@@ -320,6 +338,9 @@ public:
         //! Handle \p symbol.
         void apply(std::size_t symbol, const SMessage& message);
 
+        //! Run \p test.
+        void test(const CCalendarCyclicTest& test, const SMessage& message);
+
         //! Check if we should run a test.
         bool shouldTest(core_t::TTime time);
 
@@ -337,11 +358,20 @@ public:
         //! Controls the rate at which information is lost.
         double m_DecayRate;
 
+        //! The raw data bucketing interval.
+        core_t::TTime m_BucketLength;
+
         //! The last month for which the test was run.
         int m_LastMonth;
 
+        //! The time at which to run the deferred test.
+        core_t::TTime m_DeferredTime;
+
         //! The test for arbitrary periodic components.
         TCalendarCyclicTestPtr m_Test;
+
+        //! A copy of the test which has been deferred.
+        TCalendarCyclicTestPtr m_DeferredTest;
     };
 
     //! \brief Holds and updates the components of the decomposition.
@@ -0,0 +1,136 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#ifndef INCLUDED_ml_maths_CTimeSeriesTestScheduler_h
+#define INCLUDED_ml_maths_CTimeSeriesTestScheduler_h
+
+#include <core/CFastMutex.h>
+#include <core/CMonotonicTime.h>
+#include <core/CNonCopyable.h>
+
+#include <maths/ImportExport.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ml {
+namespace maths {
+
+//! \brief Spreads the expensive tests for seasonal and calendar components
+//! of all a job's time series over its buckets.
+//!
+//! DESCRIPTION:\n
+//! The tests for seasonal and calendar components of a time series fall due
+//! at times which only depend on when the series was created, so the tests
+//! of series created in the same bucket all fall due in the same later bucket.
+//! Each bucket has a budget for the total cost of the tests which run in it,
+//! where the cost of a test is the number of values it tests. A test which
+//! falls due runs in the first bucket, up to the maximum delay, which has
+//! enough of its budget left and is deferred if that isn't the current one.
+//! If none has, it runs in the one with the least cost already scheduled.
+//! A deferred test's cost is charged to the bucket in which it will run
+//! when it is deferred, so tests which are overdue take their share of a
+//! bucket's budget before any which fall due in that bucket. Tests are
+//! therefore never deferred unless a bucket's budget is exhausted.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! This is a singleton because the budget is shared by all a job's series.
+//! The maximum delay is zero, i.e. tests are never deferred, unless the job
+//! sets it from its model config. The cost of a test is used rather than the
+//! time it takes so where it runs only depends on the data and the order in
+//! which the series are sampled. The time spent testing is only measured to
+//! report it and doesn't affect when tests run.
+//!
+//! This is thread safe.
+class MATHS_EXPORT CTimeSeriesTestScheduler : private core::CNonCopyable {
+public:
+    //! \brief Adds the time taken to run a test to the time spent testing
+    //! in the current bucket.
+    class MATHS_EXPORT CScopeTimeTest : private core::CNonCopyable {
+    public:
+        CScopeTimeTest();
+        ~CScopeTimeTest();
+
+    private:
+        //! The time at which the test started.
+        std::uint64_t m_Start;
+    };
+
+public:
+    //! Get the singleton.
+    static CTimeSeriesTestScheduler& instance();
+
+    //! Set the maximum number of buckets by which a test can be delayed.
+    void maximumDelay(std::size_t delay);
+
+    //! Set the total cost of the tests which can run in one bucket.
+    void bucketBudget(std::size_t budget);
+
+    //! Start a new bucket.
+    void startBucket();
+
+    //! Get the number of buckets by which to defer a test which has just
+    //! fallen due.
+    //!
+    //! \param[in] cost The number of values the test tests.
+    std::size_t delay(std::size_t cost);
+
+    //! Get the number of tests deferred in the last bucket.
+    std::size_t numberDeferredTests() const;
+
+    //! Get the time in milliseconds spent testing in the last bucket.
+    std::uint64_t lastBucketTestTime() const;
+
+    //! Stop deferring tests and clear all statistics.
+    void reset();
+
+private:
+    using TSizeVec = std::vector<std::size_t>;
+
+private:
+    CTimeSeriesTestScheduler();
+
+    //! Add \p time nanoseconds to the time spent testing in this bucket.
+    void addTestTime(std::uint64_t time);
+
+private:
+    //! Used to time tests.
+    core::CMonotonicTime m_Clock;
+
+    //! Serialises access to the state.
+    mutable core::CFastMutex m_Mutex;
+
+    //! The maximum number of buckets by which a test can be delayed.
+    std::size_t m_MaximumDelay;
+
+    //! The total cost of the tests which can run in one bucket.
+    std::size_t m_BucketBudget;
+
+    //! The index of the current bucket.
+    std::size_t m_Bucket;
+
+    //! The cost of the tests scheduled to run in this and the following
+    //! buckets up to the maximum delay, indexed by bucket modulo their
+    //! number.
+    TSizeVec m_ScheduledCosts;
+
+    //! The time in nanoseconds spent testing in this bucket.
+    std::uint64_t m_BucketTestTime;
+
+    //! The time in nanoseconds spent testing in the last bucket.
+    std::uint64_t m_LastBucketTestTime;
+
+    //! The number of tests deferred in this bucket.
+    std::size_t m_DeferredTests;
+
+    //! The number of tests deferred in the last bucket.
+    std::size_t m_LastBucketDeferredTests;
+};
+}
+}
+
+#endif // INCLUDED_ml_maths_CTimeSeriesTestScheduler_h
@@ -350,6 +350,29 @@ public:
     static double safeCdfComplement(const chi_squared& chi2, double x);
     //@}
 
+    //! \name Batch Standard Normal Functions
+    //! These evaluate a function of the standard normal distribution at
+    //! \p n values \p z, none of which may be NaN, and write the results
+    //! to \p result, which may be the same array as \p z.
+    //!
+    //! They are intended for evaluating many points at once, for example
+    //! all the samples at all the abscissas of a quadrature, and are much
+    //! cheaper per point than the equivalent boost::math calls: erfc is
+    //! computed from a Chebyshev fit whose evaluation the compiler can
+    //! vectorise over the points. They are accurate to close to double
+    //! precision, including far into the tails. Batches of only a few
+    //! points are passed to boost::math, which is faster for them.
+    //@{
+    //! Compute -log(Phi(z)) for each z, which is limited in the same way
+    //! as SMinusLogCdf, i.e. it is -log of the minimum double if Phi(z)
+    //! underflows. Negate z to get -log(1 - Phi(z)).
+    static void minusLogStandardNormalCdf(const double* z, std::size_t n, double* result);
+
+    //! Compute 2 * Phi(-|z|) for each z, i.e. the probability of a less
+    //! likely sample than z from the standard normal.
+    static void standardNormalTwoTailProbability(const double* z, std::size_t n, double* result);
+    //@}
+
     //! Compute the anomalousness from the probability of seeing a
     //! more extreme event for a distribution, i.e. for a sample
     //! \f$x\f$ from a R.V. the probability \f$P(R)\f$ of the set:
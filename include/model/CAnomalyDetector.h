@@ -22,6 +22,7 @@
 #include <model/ImportExport.h>
 #include <model/ModelTypes.h>
 
+#include <cstddef>
 #include <functional>
 #include <map>
 #include <memory>
@@ -69,6 +70,8 @@ class MODEL_EXPORT CAnomalyDetector : private core::CNonCopyable {
 public:
     using TStrVec = std::vector<std::string>;
     using TStrCPtrVec = std::vector<const std::string*>;
+    using TStrCPtrVecVec = std::vector<TStrCPtrVec>;
+    using TTimeVec = std::vector<core_t::TTime>;
     using TModelPlotDataVec = std::vector<CModelPlotData>;
     using TDataGathererPtr = std::shared_ptr<CDataGatherer>;
     using TModelFactoryCPtr = std::shared_ptr<const CModelFactory>;
@@ -124,6 +127,9 @@ public:
     //! copy that's only valid for a single purpose.  The boolean flag is
     //! redundant except to create a signature that will not be mistaken for
     //! a general purpose copy constructor.
+    //!
+    //! \note The copy shares the time series models with the original,
+    //! which copies them on write, so this is cheap even for large models.
     CAnomalyDetector(bool isForPersistence, const CAnomalyDetector& other);
 
     virtual ~CAnomalyDetector();
@@ -207,6 +213,17 @@ public:
     //! Extract and add the necessary details of an event record.
     void addRecord(core_t::TTime time, const TStrCPtrVec& fieldValues);
 
+    //! Extract and add the necessary details of a batch of event records.
+    //!
+    //! This gives the same results as adding each record in turn with
+    //! addRecord.
+    //!
+    //! \param[in] times The times of the records in the order they arrived.
+    //! \param[in] fieldValues The values of the fields of interest of the
+    //! records by field, i.e. fieldValues[i][j] is the value of the i'th
+    //! field of the j'th record.
+    void addRecords(const TTimeVec& times, const TStrCPtrVecVec& fieldValues);
+
     //! Update the results with this detector model's results.
     void buildResults(core_t::TTime bucketStartTime,
                       core_t::TTime bucketEndTime,
@@ -254,6 +271,17 @@ public:
     //! Return the total memory usage
     std::size_t memoryUsage() const;
 
+    //! Return the total memory usage computed without the models'
+    //! memory estimators.
+    std::size_t computeMemoryUsage() const;
+
+    //! Return the memory usage which is shared with a copy for persistence
+    std::size_t sharedMemoryUsage() const;
+
+    //! Get the change in memory usage recorded by the model and data
+    //! gatherer since this was last called.
+    std::ptrdiff_t takeMemoryUsageDelta();
+
     //! Get end of the last complete bucket we've observed.
     const core_t::TTime& lastBucketEndTime() const;
 
@@ -283,6 +311,11 @@ protected:
     //! for varied preprocessing.
     virtual const TStrCPtrVec& preprocessFieldValues(const TStrCPtrVec& fieldValues);
 
+    //! This function is called before adding a batch of \p numberRecords
+    //! records allowing for the same preprocessing of each record.
+    virtual const TStrCPtrVecVec& preprocessFieldValues(std::size_t numberRecords,
+                                                        const TStrCPtrVecVec& fieldValues);
+
     //! Initializes simple counting by adding a person called "count".
     void initSimpleCounting();
 
@@ -25,6 +25,7 @@
 #include <boost/ref.hpp>
 #include <boost/unordered_map.hpp>
 
+#include <cstddef>
 #include <functional>
 #include <limits>
 #include <map>
@@ -152,6 +153,7 @@ public:
     using TFeatureInfluenceCalculatorCPtrPrVecVec =
         std::vector<TFeatureInfluenceCalculatorCPtrPrVec>;
     using TMathsModelSPtr = std::shared_ptr<maths::CModel>;
+    using TMathsModelSPtrVec = std::vector<TMathsModelSPtr>;
     using TFeatureMathsModelSPtrPr = std::pair<model_t::EFeature, TMathsModelSPtr>;
     using TFeatureMathsModelSPtrPrVec = std::vector<TFeatureMathsModelSPtrPr>;
     using TMathsModelUPtr = std::unique_ptr<maths::CModel>;
@@ -207,6 +209,10 @@ public:
     //! state.  The clone may be incomplete in ways that do not affect the
     //! persisted representation, and must not be used for any other
     //! purpose.
+    //!
+    //! \note The clone shares the per person and attribute time series
+    //! models with this model until either updates them, so creating it
+    //! doesn't copy the bulk of the model state.
     //! \warning The caller owns the object returned.
     virtual CAnomalyDetectorModel* cloneForPersistence() const = 0;
     //@}
@@ -454,6 +460,21 @@ public:
     //! Get the memory used by this model
     virtual std::size_t memoryUsage() const = 0;
 
+    //! Get the memory used by this model without using the estimator.
+    std::size_t computedMemoryUsage() const;
+
+    //! Get the memory used by this model which is shared with a clone
+    //! for persistence.
+    virtual std::size_t sharedMemoryUsage() const;
+
+    //! Get the change in memory used by this model which has been recorded
+    //! since this was last called.
+    //!
+    //! \note This includes the models created, recycled and pruned, which
+    //! are the bulk of the change, but the resource monitor periodically
+    //! audits memoryUsage to correct the drift.
+    std::ptrdiff_t takeMemoryUsageDelta();
+
     //! Estimate the memory usage of the model based on number of people,
     //! attributes and correlations. Returns empty when the estimator
     //! is unable to produce an estimate.
@@ -513,17 +534,29 @@ protected:
         //! Persist the models passing state to \p inserter.
         void acceptPersistInserter(core::CStatePersistInserter& inserter) const;
 
+        //! Get the model with identifier \p id for update, first copying
+        //! it if it's shared with a clone for persistence.
+        //!
+        //! \note This is const because computing a model's probabilities,
+        //! which is const, updates its anomaly model.
+        maths::CModel* writableModel(std::size_t id) const;
+
         //! Debug the memory used by this model.
         void debugMemoryUsage(core::CMemoryUsage::TMemoryUsagePtr mem) const;
         //! Get the memory used by this model.
         std::size_t memoryUsage() const;
+        //! Get the memory used by the models which are shared with a clone.
+        std::size_t sharedMemoryUsage() const;
 
         //! The feature.
         model_t::EFeature s_Feature;
         //! A prototype model.
         TMathsModelSPtr s_NewModel;
         //! The person models.
-        TMathsModelUPtrVec s_Models;
+        //!
+        //! \note These are shared with clones for persistence and copied
+        //! on write, so they must only be updated via writableModel.
+        mutable TMathsModelSPtrVec s_Models;
     };
     using TFeatureModelsVec = std::vector<SFeatureModels>;
 
@@ -688,6 +721,10 @@ protected:
     //! Get the non-estimated value of the the memory used by this model.
     virtual std::size_t computeMemoryUsage() const = 0;
 
+    //! Record a change in the memory used by this model from \p before
+    //! to \p after bytes.
+    void recordMemoryUsageChange(std::size_t before, std::size_t after);
+
     //! Create a stub version of maths::CModel for use when pruning people
     //! or attributes to free memory resource.
     static maths::CModel* tinyModel();
@@ -720,6 +757,9 @@ private:
     //! The influence calculators to use for each feature which is being
     //! modeled.
     TFeatureInfluenceCalculatorCPtrPrVecVec m_InfluenceCalculators;
+
+    //! The change in memory usage recorded since it was last taken.
+    std::ptrdiff_t m_MemoryUsageDelta;
 };
 }
 }
@@ -27,6 +27,9 @@
 #include <vector>
 
 namespace ml {
+namespace core {
+class CStaticThreadPool;
+}
 namespace model {
 class CDetectionRule;
 class CInterimBucketCorrector;
@@ -118,6 +121,14 @@ public:
     //! The default number of half buckets to store before choosing which
     //! overlapping bucket has the biggest anomaly
     static const std::size_t DEFAULT_BUCKET_RESULTS_DELAY;
+
+    //! The default maximum number of buckets by which the tests for
+    //! seasonal and calendar components can be deferred.
+    static const std::size_t DEFAULT_MAXIMUM_TEST_DELAY;
+
+    //! The default total number of values the tests for seasonal and
+    //! calendar components which run in one bucket can test.
+    static const std::size_t DEFAULT_BUCKET_TEST_BUDGET;
     //@}
 
     //! \name Modelling
@@ -275,6 +286,12 @@ public:
     void bucketLength(core_t::TTime length);
     //! Set the number of buckets to delay finalizing out-of-phase buckets.
     void bucketResultsDelay(std::size_t delay);
+    //! Set the maximum number of buckets by which to defer the tests
+    //! for seasonal and calendar components.
+    void maximumTestDelay(std::size_t delay);
+    //! Set the total number of values the tests for seasonal and calendar
+    //! components which run in one bucket can test before tests are deferred.
+    void bucketTestBudget(std::size_t budget);
     //! Set the single interim bucket correction calculator.
     void interimBucketCorrector(const TInterimBucketCorrectorPtr& interimBucketCorrector);
     //! Set whether to model multibucket features.
@@ -282,6 +299,11 @@ public:
     //! Set whether multivariate analysis of correlated 'by' fields should
     //! be performed.
     void multivariateByFields(bool enabled);
+    //! Set the pool used by the models to sample people concurrently.
+    //!
+    //! \warning The caller must ensure that \p threadPool outlives the
+    //! models created from this config.
+    void threadPool(core::CStaticThreadPool* threadPool);
     //! Set the model factories.
     void factories(const TFactoryTypeFactoryPtrMap& factories);
     //! Set the style and parameter value for raw score aggregation.
@@ -361,6 +383,14 @@ public:
     //! Get the bucket result delay window.
     std::size_t bucketResultsDelay() const;
 
+    //! Get the maximum number of buckets by which to defer the tests
+    //! for seasonal and calendar components.
+    std::size_t maximumTestDelay() const;
+
+    //! Get the total number of values the tests for seasonal and calendar
+    //! components which run in one bucket can test before tests are deferred.
+    std::size_t bucketTestBudget() const;
+
     //! Get the single interim bucket correction calculator.
     const CInterimBucketCorrector& interimBucketCorrector() const;
 
@@ -448,9 +478,20 @@ private:
     //! store before choosing which overlapping bucket has the biggest anomaly
     std::size_t m_BucketResultsDelay;
 
+    //! The maximum number of buckets by which to defer the tests for
+    //! seasonal and calendar components.
+    std::size_t m_MaximumTestDelay;
+
+    //! The total number of values the tests for seasonal and calendar
+    //! components which run in one bucket can test.
+    std::size_t m_BucketTestBudget;
+
     //! Should multivariate analysis of correlated 'by' fields be performed?
     bool m_MultivariateByFields;
 
+    //! The pool used by the models to sample people concurrently.
+    core::CStaticThreadPool* m_ThreadPool;
+
     //! The single interim bucket correction calculator.
     TInterimBucketCorrectorPtr m_InterimBucketCorrector;
 
@@ -8,6 +8,7 @@
 #define INCLUDED_ml_model_CAnomalyScore_h
 
 #include <core/CCompressedDictionary.h>
+#include <core/CFastMutex.h>
 #include <core/CoreTypes.h>
 
 #include <maths/CBasicStatistics.h>
@@ -18,6 +19,7 @@
 #include <boost/optional.hpp>
 #include <boost/unordered_map.hpp>
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <string>
@@ -95,6 +97,18 @@ public:
 
     //! \brief Manages the normalization of aggregate anomaly scores
     //! based on historic values percentiles.
+    //!
+    //! IMPLEMENTATION DECISIONS:\n
+    //! The normalized score is the minimum of a number of ceilings. The
+    //! noise ceiling is linear in the discrete score and the quantile
+    //! ceiling is constant between consecutive end points of the raw score
+    //! quantile summaries' c.d.f.s, so both only change when the quantile
+    //! summaries change. These are cached in a lookup table which is built
+    //! the first time a score is normalized after the quantile summaries
+    //! change. The quantile ceiling of each interval is filled in the first
+    //! time a score in that interval is normalized. Normalizing a score is
+    //! then a binary search for its interval. This means scores can be
+    //! normalized concurrently, but not while the normalizer is updated.
     class MODEL_EXPORT CNormalizer : private core::CNonCopyable {
     public:
         using TOptionalBool = boost::optional<bool>;
@@ -186,6 +200,9 @@ public:
     private:
         using TDoubleDoublePr = std::pair<double, double>;
         using TDoubleDoublePrVec = std::vector<TDoubleDoublePr>;
+        using TUInt32Vec = std::vector<uint32_t>;
+        using TAtomicDoubleVec = std::vector<std::atomic<double>>;
+
         //! \brief Wraps a maximum score.
         class CMaxScore {
         public:
@@ -250,6 +267,24 @@ public:
         //! Retrieve the maximum score for a partition
         bool maxScore(const CMaximumScoreScope& scope, double& maxScore) const;
 
+        //! Estimate the quantile range including \p discreteScore.
+        void quantile(uint32_t discreteScore,
+                      double confidence,
+                      double& lowerBound,
+                      double& upperBound) const;
+
+        //! Compute the normalized score ceiling based on the quantile
+        //! of \p discreteScore.
+        double quantileScoreCeiling(uint32_t discreteScore) const;
+
+        //! Rebuild the lookup table if the quantile summaries have changed
+        //! since it was last built.
+        void refreshLookup() const;
+
+        //! Get the quantile score ceiling of \p discreteScore from the
+        //! lookup table.
+        double lookupQuantileScoreCeiling(uint32_t discreteScore) const;
+
     private:
         //! The percentile defining the largest noise score.
         double m_NoisePercentile;
@@ -292,6 +327,23 @@ public:
         //! The time to when we next age the quantiles.
         double m_TimeToQuantileDecay;
 
+        //! Serialises rebuilding the lookup table.
+        mutable core::CFastMutex m_LookupMutex;
+        //! True if the lookup table is up-to-date with the quantile summaries.
+        mutable std::atomic<bool> m_LookupIsCurrent;
+        //! The noise percentile discrete score.
+        mutable uint32_t m_LookupNoiseScore = 0;
+        //! The normalized score of the noise percentile.
+        mutable double m_LookupNoiseKnotPoint = 0.0;
+        //! The part of the noise ceiling due to the fraction of zero scores.
+        mutable double m_LookupNoiseOffset = 0.0;
+        //! The start of each discrete score interval on which the quantile
+        //! score ceiling is constant.
+        mutable TUInt32Vec m_LookupIntervals;
+        //! The quantile score ceiling on each interval or NaN if it hasn't
+        //! been computed yet.
+        mutable TAtomicDoubleVec m_LookupQuantileScoreCeilings;
+
     private:
         friend class ::CAnomalyScoreTest;
     };
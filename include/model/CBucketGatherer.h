@@ -17,6 +17,7 @@
 #include <model/CBucketQueue.h>
 #include <model/CEventData.h>
 #include <model/CModelParams.h>
+#include <model/CPersonAttributeCounts.h>
 #include <model/FunctionTypes.h>
 #include <model/ImportExport.h>
 #include <model/ModelTypes.h>
@@ -27,6 +28,7 @@
 #include <boost/unordered_map.hpp>
 #include <boost/unordered_set.hpp>
 
+#include <cstddef>
 #include <functional>
 #include <string>
 #include <utility>
@@ -76,14 +78,7 @@ public:
     using TWordSizeUMap = TDictionary::CWordUMap<std::size_t>::Type;
     using TWordSizeUMapItr = TWordSizeUMap::iterator;
     using TWordSizeUMapCItr = TWordSizeUMap::const_iterator;
-    using TSizeSizePrUInt64UMap = boost::unordered_map<TSizeSizePr, uint64_t>;
-    using TSizeSizePrUInt64UMapItr = TSizeSizePrUInt64UMap::iterator;
-    using TSizeSizePrUInt64UMapCItr = TSizeSizePrUInt64UMap::const_iterator;
-    using TSizeSizePrUInt64UMapQueue = CBucketQueue<TSizeSizePrUInt64UMap>;
-    using TTimeSizeSizePrUInt64UMapMap = std::map<core_t::TTime, TSizeSizePrUInt64UMap>;
-    using TSizeSizePrUInt64UMapQueueItr = TSizeSizePrUInt64UMapQueue::iterator;
-    using TSizeSizePrUInt64UMapQueueCItr = TSizeSizePrUInt64UMapQueue::const_iterator;
-    using TSizeSizePrUInt64UMapQueueCRItr = TSizeSizePrUInt64UMapQueue::const_reverse_iterator;
+    using TPersonAttributeCountsQueue = CBucketQueue<CPersonAttributeCounts>;
     using TSizeSizePrUSet = boost::unordered_set<TSizeSizePr>;
     using TSizeSizePrUSetCItr = TSizeSizePrUSet::const_iterator;
     using TSizeSizePrUSetQueue = CBucketQueue<TSizeSizePrUSet>;
@@ -304,7 +299,7 @@ public:
     //@{
     //! Get the non-zero (person, attribute) pair counts in the
     //! bucketing interval corresponding to the given time.
-    const TSizeSizePrUInt64UMap& bucketCounts(core_t::TTime time) const;
+    const CPersonAttributeCounts& bucketCounts(core_t::TTime time) const;
 
     //! Get the non-zero (person, attribute) pair counts for each
     //! value of influencing field.
@@ -323,6 +318,14 @@ public:
     //! Get the static size of this object.
     virtual std::size_t staticSize() const = 0;
 
+    //! Get the change in memory used by this component since this was
+    //! last called.
+    //!
+    //! This includes the change in the memory used by the bucket queues,
+    //! which is bounded by the number of records in the latency window,
+    //! and the changes derived classes record for their own state.
+    std::ptrdiff_t takeMemoryUsageDelta();
+
     //! Clear this data gatherer.
     virtual void clear() = 0;
 
@@ -432,6 +435,10 @@ private:
     void hiddenTimeNow(core_t::TTime time, bool skipUpdates);
 
 protected:
+    //! Record a change in the memory used by this component from \p before
+    //! to \p after bytes.
+    void recordMemoryUsageChange(std::size_t before, std::size_t after);
+
     //! Reference to the owning data gatherer
     CDataGatherer& m_DataGatherer;
 
@@ -444,7 +451,7 @@ private:
 
     //! The non-zero (person, attribute) pair counts in the current
     //! bucketing interval.
-    TSizeSizePrUInt64UMapQueue m_PersonAttributeCounts;
+    TPersonAttributeCountsQueue m_PersonAttributeCounts;
 
     //! A set per bucket that contains a (pid,cid) pair if at least
     //! one explicit null record has been seen.
@@ -452,6 +459,13 @@ private:
 
     //! The influencing field value counts per person and/or attribute.
     TSizeSizePrStoredStringPtrPrUInt64UMapVecQueue m_InfluencerCounts;
+
+    //! The memory used by the bucket queues when the change in memory
+    //! usage was last taken.
+    std::size_t m_BucketQueuesMemoryUsage;
+
+    //! The change in memory usage recorded since it was last taken.
+    std::ptrdiff_t m_MemoryUsageDelta;
 };
 }
 }
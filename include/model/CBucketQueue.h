@@ -17,6 +17,7 @@
 #include <boost/circular_buffer.hpp>
 
 #include <string>
+#include <utility>
 
 namespace ml {
 namespace model {
@@ -107,6 +108,27 @@ public:
         LOG_TRACE(<< "Queue after push -> " << core::CContainerPrinter::print(*this));
     }
 
+    //! Reuses the item for the earliest bucket as the item for the next
+    //! bucket and moves the time forward by bucket length. The item is
+    //! reset by \p reset, so it keeps any memory it has allocated. If the
+    //! \p time is earlier than the latest bucket end, this is ignored.
+    //!
+    //! \param[in] time The time to which the item corresponds.
+    //! \param[in] reset Called with the item to reset it.
+    template<typename F>
+    void recycle(core_t::TTime time, const F& reset) {
+        if (time <= m_LatestBucketEnd) {
+            LOG_ERROR(<< "Recycle was called with early time = " << time
+                      << ", latest bucket end time = " << m_LatestBucketEnd);
+            return;
+        }
+        m_LatestBucketEnd += m_BucketLength;
+        T item(std::move(m_Queue.back()));
+        reset(item);
+        m_Queue.push_front(std::move(item));
+        LOG_TRACE(<< "Queue after recycle -> " << core::CContainerPrinter::print(*this));
+    }
+
     //! Returns the item in the queue that corresponds to the bucket
     //! indicated by \p time.
     T& get(core_t::TTime time) { return m_Queue[this->index(time)]; }
@@ -17,6 +17,7 @@
 #include <model/CDynamicStringIdRegistry.h>
 #include <model/CEventData.h>
 #include <model/CModelParams.h>
+#include <model/CPersonAttributeCounts.h>
 #include <model/FunctionTypes.h>
 #include <model/ImportExport.h>
 #include <model/ModelTypes.h>
@@ -25,6 +26,7 @@
 #include <boost/optional.hpp>
 #include <boost/unordered_map.hpp>
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <utility>
@@ -105,14 +107,13 @@ public:
     using TStrVec = std::vector<std::string>;
     using TStrVecCItr = TStrVec::const_iterator;
     using TStrCPtrVec = std::vector<const std::string*>;
+    using TStrCPtrVecVec = std::vector<TStrCPtrVec>;
     using TSizeUInt64Pr = std::pair<std::size_t, uint64_t>;
     using TSizeUInt64PrVec = std::vector<TSizeUInt64Pr>;
     using TFeatureVec = model_t::TFeatureVec;
     using TSizeSizePr = std::pair<std::size_t, std::size_t>;
     using TSizeSizePrUInt64Pr = std::pair<TSizeSizePr, uint64_t>;
     using TSizeSizePrUInt64PrVec = std::vector<TSizeSizePrUInt64Pr>;
-    using TSizeSizePrUInt64UMap = boost::unordered_map<TSizeSizePr, uint64_t>;
-    using TSizeSizePrUInt64UMapQueue = CBucketQueue<TSizeSizePrUInt64UMap>;
     using TSizeSizePrStoredStringPtrPrUInt64UMap = CBucketGatherer::TSizeSizePrStoredStringPtrPrUInt64UMap;
     using TSizeSizePrStoredStringPtrPrUInt64UMapVec =
         std::vector<TSizeSizePrStoredStringPtrPrUInt64UMap>;
@@ -137,6 +138,10 @@ public:
     //! The expected memory usage per over field
     static const std::size_t ESTIMATED_MEM_USAGE_PER_OVER_FIELD;
 
+    //! The most extra memory processing the fields of one record can
+    //! add to the resource monitor, i.e. for a new person and attribute.
+    static const std::size_t MAX_EXTRA_MEM_USAGE_PER_RECORD;
+
 public:
     //! \name Life-cycle
     //@{
@@ -302,6 +307,23 @@ public:
     //! Record the arrival of \p data at \p time.
     bool addArrival(const TStrCPtrVec& fieldValues, CEventData& data, CResourceMonitor& resourceMonitor);
 
+    //! Record the arrival of a batch of records.
+    //!
+    //! This gives the same results as calling addArrival for each record
+    //! in turn, but reuses the field values and event data of each record
+    //! for the next and only looks up the identifier of a person or
+    //! attribute in the registries once for each run of records which
+    //! share it.
+    //!
+    //! \param[in] times The times of the records.
+    //! \param[in] fieldValues The values of the fields of interest of the
+    //! records by field, i.e. fieldValues[i][j] is the value of the i'th
+    //! field of the j'th record.
+    //! \return The number of records which were added.
+    std::size_t addArrivals(const TTimeVec& times,
+                            const TStrCPtrVecVec& fieldValues,
+                            CResourceMonitor& resourceMonitor);
+
     //! Roll time to the end of the bucket that is latency after the sampled bucket.
     void sampleNow(core_t::TTime sampleBucketStart);
 
@@ -570,7 +592,7 @@ public:
     //@{
     //! Get the non-zero (person, attribute) pair counts in the
     //! bucketing interval corresponding to the given time.
-    const TSizeSizePrUInt64UMap& bucketCounts(core_t::TTime time) const;
+    const CPersonAttributeCounts& bucketCounts(core_t::TTime time) const;
 
     //! Get the non-zero (person, attribute) pair counts for each
     //! value of influencing field.
@@ -586,6 +608,10 @@ public:
     //! Get the memory used by this component.
     std::size_t memoryUsage() const;
 
+    //! Get the change in memory used by this component since this was
+    //! last called.
+    std::ptrdiff_t takeMemoryUsageDelta();
+
     //! Clear this data gatherer.
     void clear();
 
@@ -691,6 +717,7 @@ private:
 
 private:
     using TModelParamsCRef = boost::reference_wrapper<const SModelParams>;
+    using TStrCPtrSizePr = std::pair<const std::string*, std::size_t>;
 
 private:
     //! Select the correct bucket gatherer based on the time: if we have
@@ -721,6 +748,14 @@ private:
     //! inserter.
     void persistBucketGatherers(core::CStatePersistInserter& inserter) const;
 
+    //! Record \p name in \p registry, or reuse \p batchName's identifier
+    //! if it is the last name recorded in the batch being added.
+    std::size_t addName(CDynamicStringIdRegistry& registry,
+                        TStrCPtrSizePr& batchName,
+                        const std::string& name,
+                        CResourceMonitor& resourceMonitor,
+                        bool& added);
+
     //! Create the bucket specific data gatherer.
     void createBucketGatherer(model_t::EAnalysisCategory gathererType,
                               const std::string& summaryCountFieldName,
@@ -769,6 +804,20 @@ private:
 
     //! The object responsible for managing sample counts.
     TSampleCountsPtr m_SampleCounts;
+
+    //! The memory used by the registries and sample counts when the
+    //! change in memory usage was last taken.
+    std::size_t m_RegistriesMemoryUsage;
+
+    //! True while a batch of records is being added.
+    bool m_AddingBatch;
+
+    //! The last person recorded in the batch being added and its identifier.
+    TStrCPtrSizePr m_BatchPerson;
+
+    //! The last attribute recorded in the batch being added and its
+    //! identifier.
+    TStrCPtrSizePr m_BatchAttribute;
 };
 }
 }
@@ -290,6 +290,10 @@ public:
     //! Get the memory used by this model.
     virtual std::size_t memoryUsage() const;
 
+    //! Get the memory used by this model which is shared with a clone
+    //! for persistence.
+    virtual std::size_t sharedMemoryUsage() const;
+
     //! Get the static size of this object - used for virtual hierarchies
     virtual std::size_t staticSize() const;
 
@@ -347,7 +351,11 @@ private:
 
     //! Get a writable model for \p feature and the attribute identified
     //! by \p cid.
-    maths::CModel* model(model_t::EFeature feature, std::size_t pid);
+    //!
+    //! \note This copies the model if it's shared with a clone for
+    //! persistence so only use it to update the model. It's const because
+    //! computing probabilities updates the model's anomaly model.
+    maths::CModel* writableModel(model_t::EFeature feature, std::size_t cid) const;
 
     //! Check if there are correlates for \p feature and the person and
     //! attribute identified by \p pid and \p cid, respectively.
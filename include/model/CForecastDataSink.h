@@ -156,6 +156,10 @@ public:
     //! get the number of forecast records written
     uint64_t numRecordsWritten() const;
 
+    //! add records written by other sinks for the same forecast to the
+    //! number of records this sink reports
+    void addNumRecordsWritten(uint64_t numRecords);
+
 private:
     void writeCommonStatsFields(rapidjson::Value& doc);
     void push(bool flush, rapidjson::Value& doc);
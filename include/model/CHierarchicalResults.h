@@ -329,6 +329,14 @@ public:
     //! Add the influencer called \p name.
     void addInfluencer(const std::string& name);
 
+    //! Move the simple search results and influencers in \p other to
+    //! the end of these results.
+    //!
+    //! This is used to combine results which were added separately, for
+    //! example by detectors running on different threads, so neither
+    //! object may have had its hierarchy built.
+    void merge(CHierarchicalResults& other);
+
     //! Build a hierarchy from the current flat node list using the
     //! default aggregation rules.
     //!
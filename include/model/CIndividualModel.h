@@ -19,6 +19,7 @@
 #include <boost/unordered_set.hpp>
 
 #include <cstddef>
+#include <functional>
 #include <utility>
 #include <vector>
 
@@ -53,6 +54,7 @@ public:
     using TFeatureSizeSizeTriple = core::CTriple<model_t::EFeature, std::size_t, std::size_t>;
     using TFeatureSizeSizeTripleDouble1VecUMap =
         boost::unordered_map<TFeatureSizeSizeTriple, TDouble1Vec>;
+    using TSizeSizeFunc = std::function<void(std::size_t, std::size_t)>;
 
 public:
     //! \name Life-cycle
@@ -161,6 +163,10 @@ public:
     //! Get the memory used by this model.
     virtual std::size_t memoryUsage() const = 0;
 
+    //! Get the memory used by this model which is shared with a clone
+    //! for persistence.
+    virtual std::size_t sharedMemoryUsage() const;
+
     //! Get the static size of this object - used for virtual hierarchies.
     virtual std::size_t staticSize() const = 0;
 
@@ -246,11 +252,35 @@ protected:
     const maths::CModel* model(model_t::EFeature feature, std::size_t pid) const;
 
     //! Get a writable model corresponding to \p feature of the person \p pid.
-    maths::CModel* model(model_t::EFeature feature, std::size_t pid);
+    //!
+    //! \note This copies the model if it's shared with a clone for
+    //! persistence so only use it to update the model. It's const because
+    //! computing probabilities updates the model's anomaly model.
+    maths::CModel* writableModel(model_t::EFeature feature, std::size_t pid) const;
 
     //! Sample the correlate models.
     void sampleCorrelateModels();
 
+    //! Call \p f on consecutive ranges [begin, end) which cover [0, \p n)
+    //! and block until all the calls have finished.
+    //!
+    //! If there is a thread pool, the ranges are shared over its threads.
+    //! This is used to update different people's models concurrently, so
+    //! it falls back to a single call if correlates are being modelled,
+    //! since then all the models feed the same correlation model. The
+    //! calling thread's random number stream is continued on the threads
+    //! which call \p f.
+    void sampleInShards(std::size_t n, const TSizeSizeFunc& f) const;
+
+    //! Get the identifier of the random number stream in which to sample
+    //! \p pid's \p feature model in the bucket starting at \p time.
+    //!
+    //! Each person's models draw from their own stream, derived from the
+    //! calling thread's stream, so the random numbers they see don't depend
+    //! on how people are sharded over threads.
+    static uint64_t
+    sampleStream(model_t::EFeature feature, std::size_t pid, core_t::TTime time);
+
     //! Correct \p baseline with \p corrections for interim results.
     void correctBaselineForInterim(model_t::EFeature feature,
                                    std::size_t pid,
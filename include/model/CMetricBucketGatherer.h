@@ -13,9 +13,11 @@
 #include <maths/CBasicStatistics.h>
 
 #include <model/CDataGatherer.h>
+#include <model/CGathererTools.h>
+#include <model/CPersonAttributeGatherers.h>
 #include <model/ImportExport.h>
 
-#include <boost/any.hpp>
+#include <boost/variant.hpp>
 
 #include <map>
 #include <string>
@@ -40,9 +42,28 @@ class CResourceMonitor;
 class MODEL_EXPORT CMetricBucketGatherer final : public CBucketGatherer {
 public:
     using TCategorySizePr = std::pair<model_t::EMetricCategory, std::size_t>;
-    using TCategorySizePrAnyMap = std::map<TCategorySizePr, boost::any>;
-    using TCategorySizePrAnyMapItr = TCategorySizePrAnyMap::iterator;
-    using TCategorySizePrAnyMapCItr = TCategorySizePrAnyMap::const_iterator;
+    using TMeanGatherers = CPersonAttributeGatherers<CGathererTools::TMeanGatherer>;
+    using TMedianGatherers = CPersonAttributeGatherers<CGathererTools::TMedianGatherer>;
+    using TMinGatherers = CPersonAttributeGatherers<CGathererTools::TMinGatherer>;
+    using TMaxGatherers = CPersonAttributeGatherers<CGathererTools::TMaxGatherer>;
+    using TVarianceGatherers = CPersonAttributeGatherers<CGathererTools::TVarianceGatherer>;
+    using TSumGatherers = CPersonAttributeGatherers<CGathererTools::CSumGatherer>;
+    using TMultivariateMeanGatherers =
+        CPersonAttributeGatherers<CGathererTools::TMultivariateMeanGatherer>;
+    using TMultivariateMinGatherers =
+        CPersonAttributeGatherers<CGathererTools::TMultivariateMinGatherer>;
+    using TMultivariateMaxGatherers =
+        CPersonAttributeGatherers<CGathererTools::TMultivariateMaxGatherer>;
+    using TGatherers = boost::variant<TMeanGatherers,
+                                      TMedianGatherers,
+                                      TMinGatherers,
+                                      TMaxGatherers,
+                                      TVarianceGatherers,
+                                      TSumGatherers,
+                                      TMultivariateMeanGatherers,
+                                      TMultivariateMinGatherers,
+                                      TMultivariateMaxGatherers>;
+    using TCategorySizePrGatherersMap = std::map<TCategorySizePr, TGatherers>;
 
 public:
     //! \name Life-cycle
@@ -280,6 +301,9 @@ private:
     //! Initialize the feature data gatherers.
     void initializeFeatureData();
 
+    //! Get the memory used by the feature data gatherers.
+    std::size_t featureDataMemoryUsage() const;
+
 private:
     //! The metric value field name.  This is held separately to
     //! m_FieldNames because in the case of summarization the field
@@ -314,8 +338,9 @@ private:
     //! for non-summarized input this will be empty
     TMetricCategoryVec m_FieldMetricCategories;
 
-    //! The data features we are gathering.
-    TCategorySizePrAnyMap m_FeatureData;
+    //! The gatherers of the statistics of each metric category we are
+    //! gathering keyed by category and dimension.
+    TCategorySizePrGatherersMap m_FeatureData;
 };
 }
 }
@@ -30,6 +30,7 @@
 namespace ml {
 namespace core {
 class CStateRestoreTraverser;
+class CStaticThreadPool;
 }
 
 namespace maths {
@@ -339,6 +340,12 @@ public:
     //! be performed.
     void multivariateByFields(bool enabled);
 
+    //! Set the pool used to sample people concurrently.
+    //!
+    //! \warning The caller must ensure that \p threadPool outlives the
+    //! models this creates.
+    void threadPool(core::CStaticThreadPool* threadPool);
+
     //! Set the minimum mode fraction used for initializing the models.
     void minimumModeFraction(double minimumModeFraction);
 
@@ -348,6 +355,10 @@ public:
     //! Set the periods and the number of points we'll use to model
     //! of the seasonal components in the data.
     void componentSize(std::size_t componentSize);
+
+    //! Set whether to update distribution models with very low weight
+    //! lazily.
+    void lazyPriorUpdates(bool enabled);
     //@}
 
     //! Update the bucket length, for ModelAutoConfig's benefit
@@ -366,6 +377,10 @@ public:
     //! component.
     std::size_t componentSize() const;
 
+    //! Check if distribution models with very low weight are updated
+    //! lazily.
+    bool lazyPriorUpdates() const;
+
     //! Get the minimum seasonal variance scale, specific to the model
     virtual double minimumSeasonalVarianceScale() const = 0;
 
@@ -444,6 +459,9 @@ private:
     TInterimBucketCorrectorWPtr m_InterimBucketCorrector;
 
     //! A cache of models for collections of features.
+    //!
+    //! \note Access to this and the following caches is locked since
+    //! detectors sharing this factory can create models concurrently.
     mutable TFeatureVecMathsModelMap m_MathsModelCache;
 
     //! A cache of priors for correlate pairs of collections of features.
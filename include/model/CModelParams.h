@@ -23,6 +23,9 @@
 #include <vector>
 
 namespace ml {
+namespace core {
+class CStaticThreadPool;
+}
 namespace maths {
 struct SDistributionRestoreParams;
 struct STimeSeriesDecompositionRestoreParams;
@@ -85,6 +88,10 @@ struct MODEL_EXPORT SModelParams {
     //! The minimum permitted count of points in a distribution mode.
     double s_MinimumModeCount;
 
+    //! If true update the parameters of distribution models with very
+    //! low weight lazily in batches.
+    bool s_LazyPriorUpdates;
+
     //! The minimum frequency of non-empty buckets at which we model all buckets.
     double s_CutoffToModelEmptyBuckets;
 
@@ -183,6 +190,13 @@ struct MODEL_EXPORT SModelParams {
     //! If true then cache the results of the probability calculation.
     bool s_CacheProbabilities;
     //@}
+
+    //! \name Concurrency
+    //@{
+    //! The pool used to sample people concurrently or null if they are
+    //! sampled on the calling thread.
+    core::CStaticThreadPool* s_ThreadPool;
+    //@}
 };
 }
 }
@@ -0,0 +1,133 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#ifndef INCLUDED_ml_model_CPersonAttributeCounts_h
+#define INCLUDED_ml_model_CPersonAttributeCounts_h
+
+#include <core/CMemoryUsage.h>
+
+#include <model/ImportExport.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ml {
+namespace model {
+
+//! \brief The counts of each (person, attribute) pair in a bucket.
+//!
+//! DESCRIPTION:\n
+//! A map from (person, attribute) pair to count which supports the subset
+//! of the boost::unordered_map interface the bucket gatherers use.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! Every record updates one of these and each is cleared when its bucket
+//! is recycled, so both must be cheap. The counts are stored contiguously
+//! in insertion order and indexed by an open addressed hash table with
+//! linear probing. Each slot of the table is stamped with the generation
+//! in which it was written, so clearing only needs to increment the current
+//! generation and both the counts and the table keep their memory for the
+//! next bucket.
+//!
+//! Erasing swaps the last count into the erased position and leaves a
+//! tombstone in the table, so, as for boost::unordered_map, erase returns
+//! an iterator to the next count to visit. Note that this invalidates
+//! iterators to the last count.
+class MODEL_EXPORT CPersonAttributeCounts {
+public:
+    using TSizeSizePr = std::pair<std::size_t, std::size_t>;
+    using value_type = std::pair<TSizeSizePr, uint64_t>;
+    using TSizeSizePrUInt64PrVec = std::vector<value_type>;
+    using iterator = TSizeSizePrUInt64PrVec::iterator;
+    using const_iterator = TSizeSizePrUInt64PrVec::const_iterator;
+
+public:
+    CPersonAttributeCounts();
+
+    //! Get the count of \p key inserting a zero count if it is missing.
+    uint64_t& operator[](const TSizeSizePr& key);
+
+    //! Find the count of \p key.
+    iterator find(const TSizeSizePr& key);
+
+    //! Find the count of \p key.
+    const_iterator find(const TSizeSizePr& key) const;
+
+    //! Erase the count at \p i.
+    //!
+    //! \return An iterator to the next count to visit.
+    iterator erase(iterator i);
+
+    //! Remove all counts in constant time.
+    void clear();
+
+    //! Check if there are no counts.
+    bool empty() const;
+
+    //! Get the number of counts.
+    std::size_t size() const;
+
+    //! \name Iteration
+    //@{
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+    //@}
+
+    //! Debug the memory used by this object.
+    void debugMemoryUsage(core::CMemoryUsage::TMemoryUsagePtr mem) const;
+
+    //! Get the memory used by this object.
+    std::size_t memoryUsage() const;
+
+private:
+    using TUInt64Vec = std::vector<uint64_t>;
+
+private:
+    //! The smallest number of slots in the table.
+    static const std::size_t MINIMUM_CAPACITY;
+
+private:
+    //! Get the slot at which to start probing for \p key.
+    std::size_t home(const TSizeSizePr& key) const;
+
+    //! Get the slot which holds \p key or the table size if it is missing.
+    std::size_t slot(const TSizeSizePr& key) const;
+
+    //! Set the slot at \p i to point to the count at \p index.
+    void point(std::size_t i, std::size_t index);
+
+    //! Check if the slot at \p i was written in the current generation.
+    bool current(std::size_t i) const;
+
+    //! Get the index of the count the slot at \p i points to.
+    std::size_t index(std::size_t i) const;
+
+    //! Rebuild the table so it has at least \p capacity slots.
+    void rehash(std::size_t capacity);
+
+private:
+    //! The counts in insertion order.
+    TSizeSizePrUInt64PrVec m_Counts;
+
+    //! The hash table. Each slot packs the generation in which it was
+    //! written into the high 32 bits and the index of the count to which
+    //! it points into the low 32 bits.
+    TUInt64Vec m_Slots;
+
+    //! The current generation.
+    uint32_t m_Generation;
+
+    //! The number of tombstones in the table.
+    std::size_t m_Tombstones;
+};
+}
+}
+
+#endif // INCLUDED_ml_model_CPersonAttributeCounts_h
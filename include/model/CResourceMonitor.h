@@ -6,6 +6,7 @@
 #ifndef INCLUDED_ml_model_CResourceMonitor_h
 #define INCLUDED_ml_model_CResourceMonitor_h
 
+#include <core/CFastMutex.h>
 #include <core/CoreTypes.h>
 
 #include <model/ImportExport.h>
@@ -13,6 +14,7 @@
 
 #include <boost/unordered_map.hpp>
 
+#include <cstdint>
 #include <functional>
 
 class CResourceMonitorTest;
@@ -30,6 +32,23 @@ class CResourcePruner;
 //!
 //! DESCRIPTION:\n
 //! Assess memory used by models and decide on further memory allocations.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! Computing the memory used by a detector visits every one of its models,
+//! so a refresh normally only adds the change in memory usage the detector
+//! has recorded since the last refresh, see CAnomalyDetector::takeMemoryUsageDelta.
+//! Not every change is recorded, so each detector's memory usage is audited
+//! in full every fullAuditPeriod refreshes. Each refresh which isn't an audit
+//! is assumed to be out by at most REFRESH_ERROR_FRACTION of the detector's
+//! usage and the detector is also audited whenever the accumulated error
+//! means the total memory usage could be on the other side of a limit, so
+//! the error can't affect allocation or pruning decisions.
+//!
+//! The methods which are called while detectors sample and compute
+//! results, i.e. the refreshes, allocation checks and extra memory
+//! and allocation failure accounting, are locked so that different
+//! detectors can be updated concurrently. Everything else must be
+//! called from the thread which owns the detectors.
 class MODEL_EXPORT CResourceMonitor {
 public:
     struct MODEL_EXPORT SResults {
@@ -40,11 +59,21 @@ public:
         std::size_t s_AllocationFailures;
         model_t::EMemoryStatus s_MemoryStatus;
         core_t::TTime s_BucketStartTime;
+        std::size_t s_DeferredSeasonalityTests;
+        std::uint64_t s_SeasonalityTestTime;
     };
 
 public:
-    using TDetectorPtrSizePr = std::pair<CAnomalyDetector*, std::size_t>;
-    using TDetectorPtrSizeUMap = boost::unordered_map<CAnomalyDetector*, std::size_t>;
+    //! \brief The memory used by a detector.
+    struct MODEL_EXPORT SDetectorMemory {
+        //! The memory usage on the last refresh.
+        std::size_t s_Usage = 0;
+        //! The number of refreshes until the next full audit.
+        std::size_t s_RefreshesUntilAudit = 0;
+        //! A bound on the error in the usage since the last full audit.
+        std::size_t s_ErrorBound = 0;
+    };
+    using TDetectorPtrDetectorMemoryUMap = boost::unordered_map<CAnomalyDetector*, SDetectorMemory>;
     using TMemoryUsageReporterFunc = std::function<void(const CResourceMonitor::SResults&)>;
     using TTimeSizeMap = std::map<core_t::TTime, std::size_t>;
 
@@ -56,6 +85,12 @@ public:
     static const double DEFAULT_BYTE_LIMIT_MARGIN;
     //! The maximum value of elapsed time used to scale the byte limit margin
     static const core_t::TTime MAXIMUM_BYTE_LIMIT_MARGIN_PERIOD;
+    //! The default number of refreshes between full audits of a detector's
+    //! memory usage
+    static const std::size_t DEFAULT_FULL_AUDIT_PERIOD;
+    //! The bound on the error, as a fraction of a detector's memory usage,
+    //! each refresh which isn't a full audit can introduce
+    static const double REFRESH_ERROR_FRACTION;
 
 public:
     //! Default constructor
@@ -84,18 +119,39 @@ public:
     //! Set a callback used when the memory usage grows
     void memoryUsageReporter(const TMemoryUsageReporterFunc& reporter);
 
-    //! Recalculate the memory usage if there is a memory limit
+    //! Update the memory usage of \p detector by the change it has recorded
+    //! or, if one is due, by a full audit.
     void refresh(CAnomalyDetector& detector);
 
-    //! Recalculate the memory usage regardless of whether there is a memory limit
+    //! Recalculate the memory usage of \p detector with a full audit.
     void forceRefresh(CAnomalyDetector& detector);
 
+    //! Recalculate the memory usage of \p detector with a full audit
+    //! once its state has been restored.
+    //!
+    //! \note This doesn't use the models' memory estimators or update the
+    //! memory usage statistic, so the statistics restored with the state
+    //! are unchanged.
+    void refreshRestored(CAnomalyDetector& detector);
+
+    //! Set the number of refreshes between full audits of each detector's
+    //! memory usage. A value of one audits on every refresh.
+    void fullAuditPeriod(std::size_t period);
+
     //! Set the internal memory limit, as specified in a limits config file
     void memoryLimit(std::size_t limitMBs);
 
     //! Get the memory status
     model_t::EMemoryStatus getMemoryStatus();
 
+    //! Check if memory usage is far enough below the limit that the
+    //! order in which detectors refresh their usage during one bucket
+    //! cannot change any allocation decisions.
+    //!
+    //! This is used to decide whether it is safe to update detectors
+    //! concurrently without changing the results.
+    bool hasHeadroomForConcurrentUpdates() const;
+
     //! Send a memory usage report if it's changed by more than a certain percentage
     void sendMemoryUsageReportIfSignificantlyChanged(core_t::TTime bucketStartTime);
 
@@ -128,6 +184,10 @@ public:
     //! for model's parts that have not been fully allocated yet.
     void addExtraMemory(std::size_t reserved);
 
+    //! Removes \p reserved of the memory added by addExtraMemory()
+    //! once it's accounted for by the components.
+    void removeExtraMemory(std::size_t reserved);
+
     //! Clears all extra memory
     void clearExtraMemory();
 
@@ -144,8 +204,16 @@ private:
     //! to the given value.
     void updateMemoryLimitsAndPruneThreshold(std::size_t limitMBs);
 
-    //! Update the given model and recalculate the total usage
-    void memUsage(CAnomalyDetector* detector);
+    //! Update the given model's usage to \p usage and recalculate the
+    //! total usage.
+    void memUsage(CAnomalyDetector* detector, std::size_t usage);
+
+    //! Set the memory usage of \p detector to \p usage, found by a full
+    //! audit, and optionally update the memory usage statistic.
+    void audited(CAnomalyDetector& detector, std::size_t usage, bool updateStatistic);
+
+    //! Check if a full audit of \p detector's memory usage is due.
+    bool isAuditDue(const SDetectorMemory& memory) const;
 
     //! Determine if we need to send a usage report, based on
     //! increased usage, or increased errors
@@ -166,7 +234,10 @@ private:
 
 private:
     //! The registered collection of components
-    TDetectorPtrSizeUMap m_Detectors;
+    TDetectorPtrDetectorMemoryUMap m_Detectors;
+
+    //! The number of refreshes between full audits of each detector
+    std::size_t m_FullAuditPeriod;
 
     //! Is there enough free memory to allow creating new components
     bool m_AllowAllocations;
@@ -183,6 +254,10 @@ private:
     //! Memory usage by anomaly detectors on the most recent calculation
     std::size_t m_CurrentAnomalyDetectorMemory;
 
+    //! A bound on the error in the anomaly detectors' memory usage from
+    //! the changes recorded since their last full audits
+    std::size_t m_ErrorBound;
+
     //! Extra memory to enable accounting of soon to be allocated memory
     std::size_t m_ExtraMemory;
 
@@ -226,6 +301,10 @@ private:
     //! Don't do any sort of memory checking if this is set
     bool m_NoLimit;
 
+    //! Serialises updates made while detectors are being sampled or restored
+    //! concurrently.
+    mutable core::CFastMutex m_Mutex;
+
     //! Test friends
     friend class ::CResourceMonitorTest;
     friend class ::CResourceLimitTest;
@@ -60,12 +60,20 @@ private:
     //! for varied preprocessing.
     virtual const TStrCPtrVec& preprocessFieldValues(const TStrCPtrVec& fieldValues);
 
+    //! This function is called before adding a batch of records
+    //! allowing for varied preprocessing.
+    virtual const TStrCPtrVecVec& preprocessFieldValues(std::size_t numberRecords,
+                                                        const TStrCPtrVecVec& fieldValues);
+
 private:
     //! Field values are strange compared to other anomaly detectors,
     //! because the "count" field always has value "count".  We need
     //! a vector to override the real value of any "count" field that
     //! might be present in the data.
     TStrCPtrVec m_FieldValues;
+
+    //! The field values of a batch of records by field.
+    TStrCPtrVecVec m_FieldValueColumns;
 };
 }
 }
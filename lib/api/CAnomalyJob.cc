@@ -5,25 +5,33 @@
  */
 #include <api/CAnomalyJob.h>
 
+#include <core/CBinaryStatePersistInserter.h>
+#include <core/CBinaryStateRestoreTraverser.h>
 #include <core/CDataAdder.h>
 #include <core/CDataSearcher.h>
 #include <core/CFunctional.h>
+#include <core/CHashing.h>
 #include <core/CJsonStatePersistInserter.h>
 #include <core/CJsonStateRestoreTraverser.h>
 #include <core/CLogger.h>
 #include <core/CScopedRapidJsonPoolAllocator.h>
 #include <core/CStateCompressor.h>
 #include <core/CStateDecompressor.h>
+#include <core/CStaticThreadPool.h>
 #include <core/CStatistics.h>
+#include <core/CStopWatch.h>
 #include <core/CStringUtils.h>
 #include <core/CTimeUtils.h>
 #include <core/Constants.h>
 
 #include <maths/CIntegerTools.h>
 #include <maths/COrderings.h>
+#include <maths/CSampling.h>
+#include <maths/CTimeSeriesTestScheduler.h>
 #include <maths/CTools.h>
 
 #include <model/CAnomalyScore.h>
+#include <model/CDataGatherer.h>
 #include <model/CForecastDataSink.h>
 #include <model/CHierarchicalResultsAggregator.h>
 #include <model/CHierarchicalResultsPopulator.h>
@@ -44,7 +52,11 @@
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include <algorithm>
+#include <condition_variable>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 
@@ -77,8 +89,146 @@ const std::string INTERIM_BUCKET_CORRECTOR_TAG("k");
 //! The minimum version required to read the state corresponding to a model snapshot.
 //! This should be updated every time there is a breaking change to the model state.
 const std::string MODEL_SNAPSHOT_MIN_VERSION("6.4.0");
+
+//! The maximum size of the copied detector state waiting to be restored
+//! concurrently. This bounds the extra memory used by concurrent restore.
+const std::size_t MAX_PENDING_RESTORE_BYTES{256 * 1024 * 1024};
+
+//! An upper bound on the memory the string stores use for a string
+//! in addition to its characters.
+const std::size_t MAX_STRING_STORE_OVERHEAD{256};
 }
 
+//! \brief
+//! Restores detectors on the job's thread pool.
+//!
+//! DESCRIPTION:\n
+//! The thread reading the snapshot creates each detector and copies
+//! its state, which is then restored on the pool while the reader
+//! moves on to the next detector. This overlaps decompressing and
+//! parsing the snapshot with restoring the detectors' models, which
+//! is where most of the time goes.
+//!
+//! IMPLEMENTATION DECISIONS:\n
+//! The copies are in the same format as the snapshot. The reader
+//! blocks while the copies waiting to be restored exceed a size limit,
+//! so the snapshot is never held in memory in its entirety. The copies
+//! are counted as extra memory by the resource monitor until they are
+//! restored, when the detector's memory is refreshed, so later detectors
+//! are created against the memory actually in use.
+//!
+//! The destructor waits for all restores to finish, since they refer
+//! to the job's detectors.
+class CAnomalyJob::CConcurrentRestore : private core::CNonCopyable {
+public:
+    CConcurrentRestore(core::CStaticThreadPool& threadPool,
+                       model::CResourceMonitor& resourceMonitor,
+                       bool binary)
+        : m_ThreadPool(threadPool), m_ResourceMonitor(resourceMonitor),
+          m_Binary(binary), m_PendingBytes(0), m_PendingRestores(0), m_Failed(false) {}
+
+    ~CConcurrentRestore() { this->wait(); }
+
+    //! Copy the state at the current level of \p traverser and schedule
+    //! \p detector to be restored from it.
+    bool restore(const TAnomalyDetectorPtr& detector,
+                 const model::CSearchKey& key,
+                 const std::string& partitionFieldValue,
+                 core::CStateRestoreTraverser& traverser) {
+        std::ostringstream state;
+        if (m_Binary) {
+            core::CBinaryStatePersistInserter inserter(state);
+            if (this->copy(traverser, inserter) == false) {
+                return false;
+            }
+        } else {
+            core::CJsonStatePersistInserter inserter(state);
+            if (this->copy(traverser, inserter) == false) {
+                return false;
+            }
+        }
+        auto copy = std::make_shared<std::string>(state.str());
+        std::size_t size{copy->size()};
+
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_RestoreFinished.wait(lock, [this, size] {
+                return m_PendingRestores == 0 ||
+                       (m_PendingBytes + size <= MAX_PENDING_RESTORE_BYTES &&
+                        size <= m_ResourceMonitor.allocationLimit());
+            });
+            if (m_Failed) {
+                return false;
+            }
+            m_PendingBytes += size;
+            ++m_PendingRestores;
+        }
+        m_ResourceMonitor.addExtraMemory(size);
+
+        bool binary{m_Binary};
+        m_ThreadPool.schedule([this, binary, detector, key, partitionFieldValue, copy] {
+            std::istringstream strm(*copy);
+            std::unique_ptr<core::CStateRestoreTraverser> copyTraverser;
+            if (binary) {
+                copyTraverser = std::make_unique<core::CBinaryStateRestoreTraverser>(strm);
+            } else {
+                copyTraverser = std::make_unique<core::CJsonStateRestoreTraverser>(strm);
+            }
+            bool restored{copyTraverser->traverseSubLevel(boost::bind(
+                              &model::CAnomalyDetector::acceptRestoreTraverser,
+                              detector.get(), boost::cref(partitionFieldValue), _1)) &&
+                          copyTraverser->haveBadState() == false};
+            if (restored) {
+                m_ResourceMonitor.refreshRestored(*detector);
+            } else {
+                LOG_ERROR(<< "Error restoring anomaly detector for key '"
+                          << key.debug() << '/' << partitionFieldValue << '\'');
+            }
+            m_ResourceMonitor.removeExtraMemory(copy->size());
+
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Failed = m_Failed || restored == false;
+            m_PendingBytes -= copy->size();
+            --m_PendingRestores;
+            m_RestoreFinished.notify_all();
+        });
+
+        return true;
+    }
+
+    //! Wait for the scheduled restores and check they all succeeded.
+    bool wait() {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_RestoreFinished.wait(lock, [this] { return m_PendingRestores == 0; });
+        return m_Failed == false;
+    }
+
+private:
+    //! Copy the state of the detector at the current level of \p traverser
+    //! into a level of \p inserter.
+    static bool copy(core::CStateRestoreTraverser& traverser,
+                     core::CStatePersistInserter& inserter) {
+        bool copied{false};
+        inserter.insertLevel(DETECTOR_TAG, [&traverser, &copied](core::CStatePersistInserter& inserter_) {
+            copied = traverser.traverseSubLevel(
+                [&inserter_](core::CStateRestoreTraverser& traverser_) {
+                    return traverser_.copyTo(inserter_);
+                });
+        });
+        return copied && traverser.haveBadState() == false;
+    }
+
+private:
+    core::CStaticThreadPool& m_ThreadPool;
+    model::CResourceMonitor& m_ResourceMonitor;
+    bool m_Binary;
+    std::size_t m_PendingBytes;
+    std::size_t m_PendingRestores;
+    bool m_Failed;
+    std::mutex m_Mutex;
+    std::condition_variable m_RestoreFinished;
+};
+
 // Statics
 const std::string CAnomalyJob::ML_STATE_INDEX(".ml-state");
 const std::string CAnomalyJob::STATE_TYPE("model_state");
@@ -86,6 +236,7 @@ const std::string CAnomalyJob::DEFAULT_TIME_FIELD_NAME("time");
 const std::string CAnomalyJob::EMPTY_STRING;
 
 const CAnomalyJob::TAnomalyDetectorPtr CAnomalyJob::NULL_DETECTOR;
+const std::size_t CAnomalyJob::MAX_CACHED_PARTITION_VALUES(10000);
 
 CAnomalyJob::CAnomalyJob(const std::string& jobId,
                          model::CLimits& limits,
@@ -97,11 +248,19 @@ CAnomalyJob::CAnomalyJob(const std::string& jobId,
                          core_t::TTime maxQuantileInterval,
                          const std::string& timeFieldName,
                          const std::string& timeFieldFormat,
-                         size_t maxAnomalyRecords)
+                         size_t maxAnomalyRecords,
+                         std::size_t numberThreads,
+                         bool binaryState,
+                         std::size_t recordBatchSize)
     : m_JobId(jobId), m_Limits(limits), m_OutputStream(outputStream),
-      m_ForecastRunner(m_JobId, m_OutputStream, limits.resourceMonitor()),
+      m_ForecastRunner(m_JobId, m_OutputStream, limits.resourceMonitor(), numberThreads),
       m_JsonOutputWriter(m_JobId, m_OutputStream), m_FieldConfig(fieldConfig),
       m_ModelConfig(modelConfig), m_NumRecordsHandled(0),
+      m_ControlFieldSlot(m_RecordFieldIndices.slot(CONTROL_FIELD_NAME)),
+      m_TimeFieldSlot(m_RecordFieldIndices.slot(timeFieldName)),
+      m_MaxCachedPartitionValues(MAX_CACHED_PARTITION_VALUES),
+      m_RecordBatchSize(std::max(recordBatchSize, std::size_t(1))),
+      m_PendingRecordSize(0), m_NumberDetectorBatches(0), m_PendingMemory(0),
       m_LastFinalisedBucketEndTime(0), m_PersistCompleteFunc(persistCompleteFunc),
       m_TimeFieldName(timeFieldName), m_TimeFieldFormat(timeFieldFormat),
       m_MaxDetectors(std::numeric_limits<size_t>::max()),
@@ -110,15 +269,28 @@ CAnomalyJob::CAnomalyJob(const std::string& jobId,
       m_LastNormalizerPersistTime(core::CTimeUtils::now()), m_LatestRecordTime(0),
       m_LastResultsTime(0), m_Aggregator(modelConfig), m_Normalizer(modelConfig),
       m_ResultsQueue(m_ModelConfig.bucketResultsDelay(), this->effectiveBucketLength()),
-      m_ModelPlotQueue(m_ModelConfig.bucketResultsDelay(), this->effectiveBucketLength(), 0) {
+      m_ModelPlotQueue(m_ModelConfig.bucketResultsDelay(), this->effectiveBucketLength(), 0),
+      m_BinaryState(binaryState) {
     m_JsonOutputWriter.limitNumberRecords(maxAnomalyRecords);
 
+    maths::CTimeSeriesTestScheduler::instance().maximumDelay(m_ModelConfig.maximumTestDelay());
+    maths::CTimeSeriesTestScheduler::instance().bucketBudget(m_ModelConfig.bucketTestBudget());
+
     m_Limits.resourceMonitor().memoryUsageReporter(
         boost::bind(&CJsonOutputWriter::reportMemoryUsage, &m_JsonOutputWriter, _1));
+
+    if (numberThreads > 1) {
+        LOG_DEBUG(<< "Using " << numberThreads << " threads to process detectors");
+        // The calling thread also does work so needs no worker.
+        m_ThreadPool = std::make_unique<core::CStaticThreadPool>(numberThreads - 1);
+        m_ModelConfig.threadPool(m_ThreadPool.get());
+    }
 }
 
 CAnomalyJob::~CAnomalyJob() {
     m_ForecastRunner.finishForecasts();
+    // The model config can outlive us.
+    m_ModelConfig.threadPool(nullptr);
 }
 
 void CAnomalyJob::newOutputStream() {
@@ -130,36 +302,40 @@ COutputHandler& CAnomalyJob::outputHandler() {
 }
 
 bool CAnomalyJob::handleRecord(const TStrStrUMap& dataRowFields) {
+    return this->handleRecordView(CRecordView(dataRowFields));
+}
+
+bool CAnomalyJob::handleRecordView(const CRecordView& record) {
     // Non-empty control fields take precedence over everything else
-    TStrStrUMapCItr iter = dataRowFields.find(CONTROL_FIELD_NAME);
-    if (iter != dataRowFields.end() && !iter->second.empty()) {
-        return this->handleControlMessage(iter->second);
+    const std::string* controlField = m_RecordFieldIndices.value(m_ControlFieldSlot, record);
+    if (controlField != nullptr && !controlField->empty()) {
+        return this->handleControlMessage(*controlField);
     }
 
     core_t::TTime time(0);
-    iter = dataRowFields.find(m_TimeFieldName);
-    if (iter == dataRowFields.end()) {
+    const std::string* timeField = m_RecordFieldIndices.value(m_TimeFieldSlot, record);
+    if (timeField == nullptr) {
         core::CStatistics::stat(stat_t::E_NumberRecordsNoTimeField).increment();
         LOG_ERROR(<< "Found record with no " << m_TimeFieldName << " field:"
-                  << core_t::LINE_ENDING << this->debugPrintRecord(dataRowFields));
+                  << core_t::LINE_ENDING << this->debugPrintRecord(record.fieldMap()));
         return true;
     }
     if (m_TimeFieldFormat.empty()) {
-        if (core::CStringUtils::stringToType(iter->second, time) == false) {
+        if (core::CStringUtils::stringToType(*timeField, time) == false) {
             core::CStatistics::stat(stat_t::E_NumberTimeFieldConversionErrors).increment();
             LOG_ERROR(<< "Cannot interpret " << m_TimeFieldName
                       << " field in record:" << core_t::LINE_ENDING
-                      << this->debugPrintRecord(dataRowFields));
+                      << this->debugPrintRecord(record.fieldMap()));
             return true;
         }
     } else {
         // Use this library function instead of raw strptime() as it works
         // around many operating system specific issues.
-        if (core::CTimeUtils::strptime(m_TimeFieldFormat, iter->second, time) == false) {
+        if (core::CTimeUtils::strptime(m_TimeFieldFormat, *timeField, time) == false) {
             core::CStatistics::stat(stat_t::E_NumberTimeFieldConversionErrors).increment();
             LOG_ERROR(<< "Cannot interpret " << m_TimeFieldName << " field using format "
                       << m_TimeFieldFormat << " in record:" << core_t::LINE_ENDING
-                      << this->debugPrintRecord(dataRowFields));
+                      << this->debugPrintRecord(record.fieldMap()));
             return true;
         }
     }
@@ -172,39 +348,104 @@ bool CAnomalyJob::handleRecord(const TStrStrUMap& dataRowFields) {
         core::CStatistics::stat(stat_t::E_NumberTimeOrderErrors).increment();
         std::ostringstream ss;
         ss << "Records must be in ascending time order. "
-           << "Record '" << this->debugPrintRecord(dataRowFields) << "' time "
+           << "Record '" << this->debugPrintRecord(record.fieldMap()) << "' time "
            << time << " is before bucket time " << m_LastFinalisedBucketEndTime;
         LOG_ERROR(<< ss.str());
         return true;
     }
 
+    // The pending records must be added before their bucket is finalised
+    if (m_PendingTimes.size() > 0 &&
+        m_LastFinalisedBucketEndTime + m_ModelConfig.bucketLength() + m_ModelConfig.latency() <= time) {
+        this->addPendingRecords();
+    }
+
     this->outputBucketResultsUntil(time);
 
     if (m_DetectorKeys.empty()) {
-        this->populateDetectorKeys(m_FieldConfig, m_DetectorKeys);
+        this->compileRecordRoutes();
     }
 
-    for (std::size_t i = 0u; i < m_DetectorKeys.size(); ++i) {
-        const std::string& partitionFieldName(m_DetectorKeys[i].partitionFieldName());
+    std::size_t pendingMemory{0};
+    bool pending{false};
+    if (m_RecordBatchSize > 1) {
+        pendingMemory = this->pendingMemoryBound(record);
+        pending = this->reservePendingMemory(pendingMemory);
+    }
+    bool copied{false};
 
+    for (auto& route : m_PartitionRoutes) {
         // An empty partitionFieldName means no partitioning
-        TStrStrUMapCItr itr = partitionFieldName.empty()
-                                  ? dataRowFields.end()
-                                  : dataRowFields.find(partitionFieldName);
-        const std::string& partitionFieldValue(
-            itr == dataRowFields.end() ? EMPTY_STRING : itr->second);
+        const std::string* partitionField =
+            route.s_FieldSlot == CRecordView::NOT_FOUND
+                ? nullptr
+                : m_RecordFieldIndices.value(route.s_FieldSlot, record);
+        route.s_CurrentValue = partitionField == nullptr ? &EMPTY_STRING : partitionField;
+        auto itr = route.s_Detectors.find(*route.s_CurrentValue);
+        route.s_CurrentDetectors = itr == route.s_Detectors.end() ? nullptr : &itr->second;
+    }
 
-        // TODO - should usenull apply to the partition field too?
+    for (std::size_t i = 0u; i < m_DetectorKeys.size(); ++i) {
+        SPartitionRoute& route = m_PartitionRoutes[m_KeyRoutes[i].first];
+        std::size_t position = m_KeyRoutes[i].second;
 
-        const TAnomalyDetectorPtr& detector = this->detectorForKey(
-            false, // not restoring
-            time, m_DetectorKeys[i], partitionFieldValue, m_Limits.resourceMonitor());
-        if (detector == nullptr) {
-            // There wasn't enough memory to create the detector
-            continue;
+        SRoutedDetector uncached;
+        SRoutedDetector* routed = nullptr;
+        if (route.s_CurrentDetectors != nullptr) {
+            routed = &(*route.s_CurrentDetectors)[position];
+        }
+        if (routed == nullptr || routed->s_Detector == nullptr) {
+            // TODO - should usenull apply to the partition field too?
+
+            // Creating a detector depends on the memory the pending records
+            // use so they must be added first.
+            if (m_PendingTimes.size() > 0) {
+                this->addPendingRecords();
+                copied = false;
+                pending = pending && this->reservePendingMemory(pendingMemory);
+            }
+
+            const TAnomalyDetectorPtr& detector = this->detectorForKey(
+                false, // not restoring
+                time, m_DetectorKeys[i], *route.s_CurrentValue,
+                m_Limits.resourceMonitor());
+            if (detector == nullptr) {
+                // There wasn't enough memory to create the detector
+                continue;
+            }
+            if (route.s_CurrentDetectors == nullptr && m_MaxCachedPartitionValues > 0) {
+                if (route.s_Detectors.size() >= m_MaxCachedPartitionValues) {
+                    route.s_Detectors.clear();
+                }
+                route.s_CurrentDetectors = &route.s_Detectors[*route.s_CurrentValue];
+                route.s_CurrentDetectors->resize(route.s_NumberKeys);
+            }
+            routed = route.s_CurrentDetectors != nullptr
+                         ? &(*route.s_CurrentDetectors)[position]
+                         : &uncached;
+            routed->s_Detector = detector;
+        }
+        const TAnomalyDetectorPtr& detector = routed->s_Detector;
+
+        // Every detector for a key has the same fields of interest
+        TSizeVec& fieldsOfInterestSlots = m_FieldsOfInterestSlots[i];
+        if (fieldsOfInterestSlots.size() != detector->fieldsOfInterest().size()) {
+            this->fieldSlots(detector->fieldsOfInterest(), fieldsOfInterestSlots);
         }
 
-        this->addRecord(detector, time, dataRowFields);
+        if (pending) {
+            if (copied == false) {
+                this->copyPendingRecord(time, record);
+                copied = true;
+            }
+            this->routePendingRecord(*routed, i);
+        } else {
+            this->addRecord(detector, time, fieldsOfInterestSlots, record);
+        }
+    }
+
+    if (m_PendingTimes.size() >= m_RecordBatchSize) {
+        this->addPendingRecords();
     }
 
     core::CStatistics::stat(stat_t::E_NumberApiRecordsHandled).increment();
@@ -216,6 +457,8 @@ bool CAnomalyJob::handleRecord(const TStrStrUMap& dataRowFields) {
 }
 
 void CAnomalyJob::finalise() {
+    this->addPendingRecords();
+
     // Persist final state of normalizer
     m_JsonOutputWriter.persistNormalizer(m_Normalizer, m_LastNormalizerPersistTime);
 
@@ -306,6 +549,9 @@ bool CAnomalyJob::handleControlMessage(const std::string& controlMessage) {
         return false;
     }
 
+    // Control messages act on all the records which preceded them
+    this->addPendingRecords();
+
     switch (controlMessage[0]) {
     case ' ':
         // Spaces are just used to fill the buffers and force prior messages
@@ -584,6 +830,10 @@ void CAnomalyJob::outputResults(core_t::TTime bucketStartTime) {
 
     core::CStopWatch timer(true);
 
+    // Sampling the bucket may run tests for seasonal and calendar components
+    // whose time is reported per bucket.
+    maths::CTimeSeriesTestScheduler::instance().startBucket();
+
     core_t::TTime bucketLength = m_ModelConfig.bucketLength();
 
     if (m_ModelPlotQueue.latestBucketEnd() < bucketLength) {
@@ -603,19 +853,19 @@ void CAnomalyJob::outputResults(core_t::TTime bucketStartTime) {
     std::sort(iterators.begin(), iterators.end(),
               core::CFunctional::SDereference<maths::COrderings::SFirstLess>());
 
+    TAnomalyDetectorPtrVec detectors;
+    detectors.reserve(iterators.size());
     for (std::size_t i = 0u; i < iterators.size(); ++i) {
-        model::CAnomalyDetector* detector(iterators[i]->second.get());
-        if (detector == nullptr) {
+        if (iterators[i]->second == nullptr) {
             LOG_ERROR(<< "Unexpected NULL pointer for key '"
                       << pairDebug(iterators[i]->first) << '\'');
             continue;
         }
-        detector->buildResults(bucketStartTime, bucketStartTime + bucketLength, results);
-        detector->releaseMemory(bucketStartTime - m_ModelConfig.samplingAgeCutoff());
-
-        this->generateModelPlot(bucketStartTime, bucketStartTime + bucketLength, *detector);
+        detectors.push_back(iterators[i]->second);
     }
 
+    this->buildDetectorResults(bucketStartTime, detectors, results);
+
     if (!results.empty()) {
         results.buildHierarchy();
 
@@ -651,6 +901,57 @@ void CAnomalyJob::outputResults(core_t::TTime bucketStartTime) {
     model::CStringStore::tidyUpNotThreadSafe();
 }
 
+void CAnomalyJob::buildDetectorResults(core_t::TTime bucketStartTime,
+                                       const TAnomalyDetectorPtrVec& detectors,
+                                       model::CHierarchicalResults& results) {
+    TModelPlotDataVec& modelPlots = m_ModelPlotQueue.get(bucketStartTime);
+
+    // Whether a detector is allowed to create new models depends on the
+    // memory used by the detectors which were sampled before it, so when
+    // we're near the memory limit we must process them in order.
+    if (m_ThreadPool == nullptr || detectors.size() < 2 ||
+        m_Limits.resourceMonitor().hasHeadroomForConcurrentUpdates() == false) {
+        for (const auto& detector : detectors) {
+            this->buildDetectorResults(bucketStartTime, *detector, results, modelPlots);
+        }
+        return;
+    }
+
+    LOG_TRACE(<< "Building results for " << detectors.size() << " detectors using "
+              << m_ThreadPool->size() + 1 << " threads");
+
+    std::vector<model::CHierarchicalResults> detectorResults(detectors.size());
+    std::vector<TModelPlotDataVec> detectorModelPlots(detectors.size());
+    m_ThreadPool->parallelForEach(detectors.size(), [&](std::size_t i) {
+        this->buildDetectorResults(bucketStartTime, *detectors[i],
+                                   detectorResults[i], detectorModelPlots[i]);
+    });
+
+    for (std::size_t i = 0u; i < detectors.size(); ++i) {
+        results.merge(detectorResults[i]);
+        std::move(detectorModelPlots[i].begin(), detectorModelPlots[i].end(),
+                  std::back_inserter(modelPlots));
+    }
+}
+
+void CAnomalyJob::buildDetectorResults(core_t::TTime bucketStartTime,
+                                       model::CAnomalyDetector& detector,
+                                       model::CHierarchicalResults& results,
+                                       TModelPlotDataVec& modelPlots) {
+    // Give each detector's bucket its own random number stream so results
+    // don't depend on how detectors are spread over threads.
+    std::string cue{detector.toCue()};
+    maths::CSampling::CScopeRandomNumberStream stream{core::CHashing::hashCombine(
+        core::CHashing::murmurHash64(cue.data(), static_cast<int>(cue.size()), 0),
+        static_cast<std::uint64_t>(bucketStartTime))};
+
+    core_t::TTime bucketLength = m_ModelConfig.bucketLength();
+    detector.buildResults(bucketStartTime, bucketStartTime + bucketLength, results);
+    detector.releaseMemory(bucketStartTime - m_ModelConfig.samplingAgeCutoff());
+    this->generateModelPlot(bucketStartTime, bucketStartTime + bucketLength,
+                            detector, modelPlots);
+}
+
 void CAnomalyJob::outputInterimResults(core_t::TTime bucketStartTime) {
     core::CStopWatch timer(true);
 
@@ -789,10 +1090,16 @@ bool CAnomalyJob::restoreState(core::CDataSearcher& restoreSearcher,
             return false;
         }
 
-        // We're dealing with streaming JSON state
-        core::CJsonStateRestoreTraverser traverser(*strm);
+        // We're dealing with streaming state in either format
+        std::unique_ptr<core::CStateRestoreTraverser> traverser;
+        if (core::CBinaryStateRestoreTraverser::isBinaryState(*strm)) {
+            LOG_DEBUG(<< "Restoring binary state");
+            traverser = std::make_unique<core::CBinaryStateRestoreTraverser>(*strm);
+        } else {
+            traverser = std::make_unique<core::CJsonStateRestoreTraverser>(*strm);
+        }
 
-        if (this->restoreState(traverser, completeToTime, numDetectors) == false) {
+        if (this->restoreState(*traverser, completeToTime, numDetectors) == false) {
             LOG_ERROR(<< "Failed to restore detectors");
             return false;
         }
@@ -881,6 +1188,15 @@ bool CAnomalyJob::restoreState(core::CStateRestoreTraverser& traverser,
         return true;
     }
 
+    // Detectors are independent so if we have threads they can be restored
+    // concurrently with reading the rest of the state.
+    std::unique_ptr<CConcurrentRestore> concurrentRestore;
+    if (m_ThreadPool != nullptr) {
+        bool binary{dynamic_cast<core::CBinaryStateRestoreTraverser*>(&traverser) != nullptr};
+        concurrentRestore = std::make_unique<CConcurrentRestore>(
+            *m_ThreadPool, m_Limits.resourceMonitor(), binary);
+    }
+
     while (traverser.next()) {
         const std::string& name = traverser.name();
         if (name == INTERIM_BUCKET_CORRECTOR_TAG) {
@@ -895,8 +1211,8 @@ bool CAnomalyJob::restoreState(core::CStateRestoreTraverser& traverser,
             }
             m_ModelConfig.interimBucketCorrector(interimBucketCorrector);
         } else if (name == TOP_LEVEL_DETECTOR_TAG) {
-            if (traverser.traverseSubLevel(boost::bind(
-                    &CAnomalyJob::restoreSingleDetector, this, _1)) == false) {
+            if (traverser.traverseSubLevel(boost::bind(&CAnomalyJob::restoreSingleDetector, this,
+                                                       concurrentRestore.get(), _1)) == false) {
                 LOG_ERROR(<< "Cannot restore anomaly detector");
                 return false;
             }
@@ -924,12 +1240,19 @@ bool CAnomalyJob::restoreState(core::CStateRestoreTraverser& traverser,
         }
     }
 
+    if (concurrentRestore != nullptr && concurrentRestore->wait() == false) {
+        LOG_ERROR(<< "Delegated portion of anomaly detector restore failed");
+        m_RestoredStateDetail.s_RestoredStateStatus = E_Failure;
+        return false;
+    }
+
     m_RestoredStateDetail.s_RestoredStateStatus = E_Success;
 
     return true;
 }
 
-bool CAnomalyJob::restoreSingleDetector(core::CStateRestoreTraverser& traverser) {
+bool CAnomalyJob::restoreSingleDetector(CConcurrentRestore* concurrentRestore,
+                                        core::CStateRestoreTraverser& traverser) {
     if (traverser.name() != KEY_TAG) {
         LOG_ERROR(<< "Cannot restore anomaly detector - " << KEY_TAG << " element expected but found "
                   << traverser.name() << '=' << traverser.value());
@@ -991,7 +1314,7 @@ bool CAnomalyJob::restoreSingleDetector(core::CStateRestoreTraverser& traverser)
         return false;
     }
 
-    if (this->restoreDetectorState(key, partitionFieldValue, traverser) == false ||
+    if (this->restoreDetectorState(key, partitionFieldValue, concurrentRestore, traverser) == false ||
         traverser.haveBadState()) {
         LOG_ERROR(<< "Delegated portion of anomaly detector restore failed");
         m_RestoredStateDetail.s_RestoredStateStatus = E_Failure;
@@ -1004,6 +1327,7 @@ bool CAnomalyJob::restoreSingleDetector(core::CStateRestoreTraverser& traverser)
 
 bool CAnomalyJob::restoreDetectorState(const model::CSearchKey& key,
                                        const std::string& partitionFieldValue,
+                                       CConcurrentRestore* concurrentRestore,
                                        core::CStateRestoreTraverser& traverser) {
     const TAnomalyDetectorPtr& detector =
         this->detectorForKey(true, // for restoring
@@ -1021,6 +1345,15 @@ bool CAnomalyJob::restoreDetectorState(const model::CSearchKey& key,
     LOG_DEBUG(<< "Restoring state for detector with key '" << key.debug() << '/'
               << partitionFieldValue << '\'');
 
+    if (concurrentRestore != nullptr) {
+        if (concurrentRestore->restore(detector, key, partitionFieldValue, traverser) == false) {
+            LOG_ERROR(<< "Error copying anomaly detector state for key '"
+                      << key.debug() << '/' << partitionFieldValue << '\'');
+            return false;
+        }
+        return true;
+    }
+
     if (traverser.traverseSubLevel(boost::bind(
             &model::CAnomalyDetector::acceptRestoreTraverser, detector.get(),
             boost::cref(partitionFieldValue), _1)) == false) {
@@ -1047,6 +1380,8 @@ bool CAnomalyJob::persistState(core::CDataAdder& persister) {
         return false;
     }
 
+    this->addPendingRecords();
+
     if (m_LastFinalisedBucketEndTime == 0) {
         LOG_INFO(<< "Will not persist detectors as no results have been output");
         return true;
@@ -1069,6 +1404,8 @@ bool CAnomalyJob::persistState(core::CDataAdder& persister) {
 bool CAnomalyJob::backgroundPersistState(CBackgroundPersister& backgroundPersister) {
     LOG_INFO(<< "Background persist starting data copy");
 
+    core::CStopWatch stopWatch(true);
+
     // Pass arguments by value: this is what we want for
     // passing to a new thread.
     // Do NOT add boost::ref wrappers around these arguments - they
@@ -1107,6 +1444,12 @@ bool CAnomalyJob::backgroundPersistState(CBackgroundPersister& backgroundPersist
     std::sort(copiedDetectors.begin(), copiedDetectors.end(),
               maths::COrderings::SFirstLess());
 
+    // The copies share the models with the live detectors so this is the
+    // time for which input processing is paused.
+    uint64_t pauseTime{stopWatch.stop()};
+    core::CStatistics::stat(stat_t::E_BackgroundPersistPauseTime).set(pauseTime);
+    LOG_INFO(<< "Background persist data copy took " << pauseTime << "ms");
+
     if (backgroundPersister.addPersistFunc(boost::bind(
             &CAnomalyJob::runBackgroundPersist, this, args, _1)) == false) {
         LOG_ERROR(<< "Failed to add anomaly detector background persistence function");
@@ -1123,11 +1466,27 @@ bool CAnomalyJob::runBackgroundPersist(TBackgroundPersistArgsPtr args,
         return false;
     }
 
-    return this->persistState(
+    bool result{this->persistState(
         "Periodic background persist at ", args->s_ResultsQueue,
         args->s_ModelPlotQueue, args->s_Time, args->s_Detectors, args->s_ModelSizeStats,
         args->s_InterimBucketCorrector, args->s_Aggregator, args->s_NormalizerState,
-        args->s_LatestRecordTime, args->s_LastResultsTime, persister);
+        args->s_LatestRecordTime, args->s_LastResultsTime, persister)};
+
+    // Models are only copied when the live detectors update them, so the
+    // memory the copies don't share with the live detectors is greatest
+    // just before they're released. The memory is computed in full, as
+    // sharedMemoryUsage is, rather than estimated.
+    std::size_t extraMemory{0};
+    for (const auto& detector : args->s_Detectors) {
+        std::size_t memory{detector.second->computeMemoryUsage()};
+        std::size_t shared{detector.second->sharedMemoryUsage()};
+        extraMemory += memory > shared ? memory - shared : 0;
+    }
+    core::CStatistics::stat(stat_t::E_BackgroundPersistExtraMemory).set(extraMemory);
+    LOG_INFO(<< "Background persist used " << extraMemory
+             << " bytes in addition to the live models");
+
+    return result;
 }
 
 bool CAnomalyJob::persistState(const std::string& descriptionPrefix,
@@ -1157,8 +1516,14 @@ bool CAnomalyJob::persistState(const std::string& descriptionPrefix,
             // values can change.  There should be no use of m_ variables in the
             // following code block.
             {
-                // The JSON inserter must be destructed before the stream is complete
-                core::CJsonStatePersistInserter inserter(*strm);
+                // The inserter must be destructed before the stream is complete
+                std::unique_ptr<core::CStatePersistInserter> inserter_;
+                if (m_BinaryState) {
+                    inserter_ = std::make_unique<core::CBinaryStatePersistInserter>(*strm);
+                } else {
+                    inserter_ = std::make_unique<core::CJsonStatePersistInserter>(*strm);
+                }
+                core::CStatePersistInserter& inserter{*inserter_};
                 inserter.insertValue(TIME_TAG, lastFinalisedBucketEnd);
                 inserter.insertValue(VERSION_TAG, model::CAnomalyDetector::STATE_VERSION);
 
@@ -1230,6 +1595,8 @@ bool CAnomalyJob::periodicPersistState(CBackgroundPersister& persister) {
         return false;
     }
 
+    this->addPendingRecords();
+
     // Prune the models so that the persisted state is as neat as possible
     this->pruneAllModels();
 
@@ -1316,13 +1683,14 @@ void CAnomalyJob::outputResultsWithinRange(bool isInterim, core_t::TTime start,
 
 void CAnomalyJob::generateModelPlot(core_t::TTime startTime,
                                     core_t::TTime endTime,
-                                    const model::CAnomalyDetector& detector) {
+                                    const model::CAnomalyDetector& detector,
+                                    TModelPlotDataVec& modelPlots) {
     double modelPlotBoundsPercentile(m_ModelConfig.modelPlotBoundsPercentile());
     if (modelPlotBoundsPercentile > 0.0) {
         LOG_TRACE(<< "Generating model debug data at " << startTime);
-        detector.generateModelPlot(
-            startTime, endTime, m_ModelConfig.modelPlotBoundsPercentile(),
-            m_ModelConfig.modelPlotTerms(), m_ModelPlotQueue.get(startTime));
+        detector.generateModelPlot(startTime, endTime,
+                                   m_ModelConfig.modelPlotBoundsPercentile(),
+                                   m_ModelConfig.modelPlotTerms(), modelPlots);
     }
 }
 
@@ -1453,6 +1821,13 @@ void CAnomalyJob::pruneAllModels() {
         }
         detector->pruneModels();
     }
+
+    // Pruning can leave the cached routes holding detectors for partition
+    // field values which may never be seen again.
+    for (auto& route : m_PartitionRoutes) {
+        route.s_Detectors.clear();
+        route.s_CurrentDetectors = nullptr;
+    }
 }
 
 CAnomalyJob::TAnomalyDetectorPtr
@@ -1486,27 +1861,169 @@ void CAnomalyJob::populateDetectorKeys(const CFieldConfig& fieldConfig, TKeyVec&
     }
 }
 
-const std::string* CAnomalyJob::fieldValue(const std::string& fieldName,
-                                           const TStrStrUMap& dataRowFields) {
-    TStrStrUMapCItr itr = fieldName.empty() ? dataRowFields.end()
-                                            : dataRowFields.find(fieldName);
-    const std::string& fieldValue(itr == dataRowFields.end() ? EMPTY_STRING : itr->second);
-    return !fieldName.empty() && fieldValue.empty() ? nullptr : &fieldValue;
+void CAnomalyJob::compileRecordRoutes() {
+    this->populateDetectorKeys(m_FieldConfig, m_DetectorKeys);
+
+    m_PartitionRoutes.clear();
+    m_KeyRoutes.clear();
+    m_KeyRoutes.reserve(m_DetectorKeys.size());
+    for (const auto& key : m_DetectorKeys) {
+        // The simple count detector always lives in a special null partition.
+        std::size_t slot = key.isSimpleCount() || key.partitionFieldName().empty()
+                               ? CRecordView::NOT_FOUND
+                               : m_RecordFieldIndices.slot(key.partitionFieldName());
+        auto route = std::find_if(m_PartitionRoutes.begin(), m_PartitionRoutes.end(),
+                                  [slot](const SPartitionRoute& candidate) {
+                                      return candidate.s_FieldSlot == slot;
+                                  });
+        if (route == m_PartitionRoutes.end()) {
+            route = m_PartitionRoutes.emplace(m_PartitionRoutes.end(), slot);
+        }
+        m_KeyRoutes.emplace_back(route - m_PartitionRoutes.begin(), route->s_NumberKeys++);
+    }
+
+    m_FieldsOfInterestSlots.assign(m_DetectorKeys.size(), TSizeVec());
+}
+
+void CAnomalyJob::fieldSlots(const TStrVec& fieldNames, TSizeVec& slots) {
+    slots.clear();
+    slots.reserve(fieldNames.size());
+    for (const auto& fieldName : fieldNames) {
+        slots.push_back(fieldName.empty() ? CRecordView::NOT_FOUND
+                                          : m_RecordFieldIndices.slot(fieldName));
+    }
 }
 
-void CAnomalyJob::addRecord(const TAnomalyDetectorPtr detector,
+void CAnomalyJob::addRecord(const TAnomalyDetectorPtr& detector,
                             core_t::TTime time,
-                            const TStrStrUMap& dataRowFields) {
+                            const TSizeVec& fieldSlots,
+                            const CRecordView& record) {
     model::CAnomalyDetector::TStrCPtrVec fieldValues;
-    const TStrVec& fieldNames = detector->fieldsOfInterest();
-    fieldValues.reserve(fieldNames.size());
-    for (std::size_t i = 0u; i < fieldNames.size(); ++i) {
-        fieldValues.push_back(fieldValue(fieldNames[i], dataRowFields));
+    fieldValues.reserve(fieldSlots.size());
+    for (auto slot : fieldSlots) {
+        // Fields which are named but missing or empty are null, but fields
+        // which aren't named at all are empty
+        if (slot == CRecordView::NOT_FOUND) {
+            fieldValues.push_back(&EMPTY_STRING);
+        } else {
+            const std::string* fieldValue = m_RecordFieldIndices.value(slot, record);
+            fieldValues.push_back(fieldValue == nullptr || fieldValue->empty() ? nullptr
+                                                                               : fieldValue);
+        }
     }
 
     detector->addRecord(time, fieldValues);
 }
 
+std::size_t CAnomalyJob::pendingMemoryBound(const CRecordView& record) {
+    // Besides the new people and attributes, the record's field values can
+    // be added to the string stores.
+    std::size_t result{model::CDataGatherer::MAX_EXTRA_MEM_USAGE_PER_RECORD};
+    for (std::size_t slot = 0u; slot < m_RecordFieldIndices.size(); ++slot) {
+        const std::string* value = m_RecordFieldIndices.value(slot, record);
+        result += MAX_STRING_STORE_OVERHEAD + (value == nullptr ? 0 : value->size());
+    }
+    return m_DetectorKeys.size() * result;
+}
+
+bool CAnomalyJob::reservePendingMemory(std::size_t bound) {
+    // If the detectors can allocate when the record arrives they must be
+    // able to when it is added, which the reservation guarantees. If they
+    // can't, they can't until the memory is next refreshed, which only
+    // happens after the pending records are added.
+    model::CResourceMonitor& resourceMonitor = m_Limits.resourceMonitor();
+    if (resourceMonitor.areAllocationsAllowed() == false) {
+        return true;
+    }
+    if (resourceMonitor.areAllocationsAllowed(m_PendingMemory + bound)) {
+        m_PendingMemory += bound;
+        return true;
+    }
+    this->addPendingRecords();
+    return false;
+}
+
+void CAnomalyJob::copyPendingRecord(core_t::TTime time, const CRecordView& record) {
+    std::size_t size{m_RecordFieldIndices.size()};
+    if (m_PendingTimes.size() > 0 && size != m_PendingRecordSize) {
+        this->addPendingRecords();
+    }
+    m_PendingRecordSize = size;
+
+    std::size_t start{m_PendingTimes.size() * size};
+    if (m_PendingValues.size() < start + size) {
+        m_PendingValues.resize(start + size);
+        m_PendingValuesPresent.resize(start + size);
+    }
+    for (std::size_t slot = 0u; slot < size; ++slot) {
+        const std::string* value = m_RecordFieldIndices.value(slot, record);
+        m_PendingValuesPresent[start + slot] = (value != nullptr);
+        if (value != nullptr) {
+            m_PendingValues[start + slot].assign(*value);
+        }
+    }
+    m_PendingTimes.push_back(time);
+}
+
+void CAnomalyJob::routePendingRecord(SRoutedDetector& detector, std::size_t key) {
+    std::size_t& batch = detector.s_Batch;
+    if (batch >= m_NumberDetectorBatches ||
+        m_DetectorBatches[batch].s_Detector != detector.s_Detector.get()) {
+        batch = m_NumberDetectorBatches++;
+        if (batch == m_DetectorBatches.size()) {
+            m_DetectorBatches.emplace_back();
+        }
+        m_DetectorBatches[batch].s_Detector = detector.s_Detector.get();
+        m_DetectorBatches[batch].s_Key = key;
+        m_DetectorBatches[batch].s_Records.clear();
+    }
+    m_DetectorBatches[batch].s_Records.push_back(m_PendingTimes.size() - 1);
+}
+
+void CAnomalyJob::addPendingRecords() {
+    // Adding the batches one detector at a time gives the same result as
+    // adding each record to all its detectors in turn because detectors
+    // only share the resource monitor, whose allocation decision can't
+    // change while the records are added (see reservePendingMemory).
+    for (std::size_t i = 0u; i < m_NumberDetectorBatches; ++i) {
+        const SDetectorBatch& batch = m_DetectorBatches[i];
+        const TSizeVec& fieldSlots = m_FieldsOfInterestSlots[batch.s_Key];
+
+        m_BatchTimes.clear();
+        m_BatchFieldValues.resize(fieldSlots.size());
+        for (auto& fieldValues : m_BatchFieldValues) {
+            fieldValues.clear();
+        }
+        for (auto record : batch.s_Records) {
+            m_BatchTimes.push_back(m_PendingTimes[record]);
+            std::size_t start{record * m_PendingRecordSize};
+            for (std::size_t j = 0u; j < fieldSlots.size(); ++j) {
+                // Fields which are named but missing or empty are null, but
+                // fields which aren't named at all are empty
+                const std::string* fieldValue{&EMPTY_STRING};
+                if (fieldSlots[j] != CRecordView::NOT_FOUND) {
+                    std::size_t k{start + fieldSlots[j]};
+                    fieldValue = m_PendingValuesPresent[k] && m_PendingValues[k].size() > 0
+                                     ? &m_PendingValues[k]
+                                     : nullptr;
+                }
+                m_BatchFieldValues[j].push_back(fieldValue);
+            }
+        }
+
+        batch.s_Detector->addRecords(m_BatchTimes, m_BatchFieldValues);
+    }
+
+    m_PendingTimes.clear();
+    m_NumberDetectorBatches = 0;
+    m_PendingMemory = 0;
+}
+
+CAnomalyJob::SPartitionRoute::SPartitionRoute(std::size_t fieldSlot)
+    : s_FieldSlot(fieldSlot), s_NumberKeys(0), s_CurrentValue(nullptr),
+      s_CurrentDetectors(nullptr) {
+}
+
 CAnomalyJob::SBackgroundPersistArgs::SBackgroundPersistArgs(
     const model::CResultsQueue& resultsQueue,
     const TModelPlotDataVecQueue& modelPlotQueue,
@@ -78,12 +78,14 @@ int CBaseTokenListDataTyper::computeType(bool isDryRun,
     size_t maxWeight(CBaseTokenListDataTyper::maxMatchingWeight(workWeight, m_LowerThreshold));
 
     // We search previous types in descending order of the number of matches
-    // we've seen for them
-    TSizeSizePrListItr bestSoFarIter(m_TypesByCount.end());
+    // we've seen for them, skipping those which can't possibly match
+    this->candidateTypes(workWeight, m_WorkCandidates);
+
+    size_t bestSoFarPosition(m_TypesByCount.size());
     double bestSoFarSimilarity(m_LowerThreshold);
-    for (TSizeSizePrListItr iter = m_TypesByCount.begin();
-         iter != m_TypesByCount.end(); ++iter) {
-        const CTokenListType& compType = m_Types[iter->second];
+    for (auto position : m_WorkCandidates) {
+        const TSizeSizePr& countAndIndex = m_TypesByCount[position];
+        const CTokenListType& compType = m_Types[countAndIndex.second];
         const TSizeSizePrVec& baseTokenIds = compType.baseTokenIds();
         size_t baseWeight(compType.baseWeight());
 
@@ -116,7 +118,12 @@ int CBaseTokenListDataTyper::computeType(bool isDryRun,
             }
         }
 
-        double similarity(this->similarity(m_WorkTokenIds, workWeight, baseTokenIds, baseWeight));
+        // Unless the current record matches the search for the existing type
+        // its similarity is only of interest if it beats the best so far
+        double minSimilarity(matchesSearch ? std::numeric_limits<double>::lowest()
+                                           : bestSoFarSimilarity);
+        double similarity(this->similarity(m_WorkTokenIds, workWeight, baseTokenIds,
+                                           baseWeight, minSimilarity));
 
         LOG_TRACE(<< similarity << '-' << compType.baseString() << '|' << str);
 
@@ -130,16 +137,16 @@ int CBaseTokenListDataTyper::computeType(bool isDryRun,
 
             // This is a strong match, so accept it immediately and stop
             // looking for better matches - use vector index plus one as type
-            int type(1 + int(iter->second));
+            int type(1 + int(countAndIndex.second));
             this->addTypeMatch(isDryRun, str, rawStringLen, m_WorkTokenIds,
-                               m_WorkTokenUniqueIds, similarity, iter);
+                               m_WorkTokenUniqueIds, similarity, position);
             return type;
         }
 
         if (similarity > bestSoFarSimilarity) {
             // This is a weak match, but remember it because it's the best we've
             // seen
-            bestSoFarIter = iter;
+            bestSoFarPosition = position;
             bestSoFarSimilarity = similarity;
 
             // Recalculate the minimum and maximum token counts that might
@@ -149,19 +156,21 @@ int CBaseTokenListDataTyper::computeType(bool isDryRun,
         }
     }
 
-    if (bestSoFarIter != m_TypesByCount.end()) {
+    if (bestSoFarPosition != m_TypesByCount.size()) {
         // Return the best match - use vector index plus one as type
-        int type(1 + int(bestSoFarIter->second));
-        this->addTypeMatch(isDryRun, str, rawStringLen, m_WorkTokenIds,
-                           m_WorkTokenUniqueIds, bestSoFarSimilarity, bestSoFarIter);
+        int type(1 + int(m_TypesByCount[bestSoFarPosition].second));
+        this->addTypeMatch(isDryRun, str, rawStringLen, m_WorkTokenIds, m_WorkTokenUniqueIds,
+                           bestSoFarSimilarity, bestSoFarPosition);
         return type;
     }
 
     // If we get here we haven't matched, so create a new type
     CTokenListType obj(isDryRun, str, rawStringLen, m_WorkTokenIds, workWeight,
                        m_WorkTokenUniqueIds);
+    m_TypePositions.push_back(m_TypesByCount.size());
     m_TypesByCount.push_back(TSizeSizePr(1, m_Types.size()));
     m_Types.push_back(obj);
+    this->indexType(m_Types.size() - 1);
     m_HasChanged = true;
 
     // Increment the counts of types that use a given token
@@ -341,6 +350,9 @@ bool CBaseTokenListDataTyper::hasChanged() const {
 bool CBaseTokenListDataTyper::acceptRestoreTraverser(core::CStateRestoreTraverser& traverser) {
     m_Types.clear();
     m_TypesByCount.clear();
+    m_TypePositions.clear();
+    m_TypesByToken.clear();
+    m_TypesWithoutCommonTokens.clear();
     m_TokenIdLookup.clear();
     m_WorkTokenIds.clear();
     m_WorkTokenUniqueIds.clear();
@@ -377,7 +389,16 @@ bool CBaseTokenListDataTyper::acceptRestoreTraverser(core::CStateRestoreTraverse
 
     // Types are persisted in order of creation, but this list needs to be
     // sorted by count instead
-    m_TypesByCount.sort(CPairFirstElementGreater());
+    std::stable_sort(m_TypesByCount.begin(), m_TypesByCount.end(),
+                     CPairFirstElementGreater());
+
+    m_TypePositions.resize(m_Types.size());
+    for (size_t position = 0; position < m_TypesByCount.size(); ++position) {
+        m_TypePositions[m_TypesByCount[position].second] = position;
+    }
+    for (size_t type = 0; type < m_Types.size(); ++type) {
+        this->indexType(type);
+    }
 
     return true;
 }
@@ -411,30 +432,142 @@ void CBaseTokenListDataTyper::addTypeMatch(bool isDryRun,
                                            const TSizeSizePrVec& tokenIds,
                                            const TSizeSizeMap& tokenUniqueIds,
                                            double similarity,
-                                           TSizeSizePrListItr& iter) {
-    if (m_Types[iter->second].addString(isDryRun, str, rawStringLen, tokenIds,
-                                        tokenUniqueIds, similarity) == true) {
+                                           size_t position) {
+    size_t type(m_TypesByCount[position].second);
+    CTokenListType& typeObj = m_Types[type];
+    size_t numberCommonTokens(typeObj.commonUniqueTokenIds().size());
+    if (typeObj.addString(isDryRun, str, rawStringLen, tokenIds, tokenUniqueIds,
+                          similarity) == true) {
         m_HasChanged = true;
     }
+    if (typeObj.commonUniqueTokenIds().size() != numberCommonTokens) {
+        this->reindexCommonTokens(type);
+    }
 
-    size_t& count = iter->first;
+    size_t& count = m_TypesByCount[position].first;
     ++count;
 
     // Search backwards for the point where the incremented count belongs
-    TSizeSizePrListItr swapIter(m_TypesByCount.end());
-    TSizeSizePrListItr checkIter(iter);
-    while (checkIter != m_TypesByCount.begin()) {
-        --checkIter;
-        if (count <= checkIter->first) {
-            break;
-        }
-        swapIter = checkIter;
+    size_t swapPosition(position);
+    while (swapPosition > 0 && count > m_TypesByCount[swapPosition - 1].first) {
+        --swapPosition;
     }
 
-    // Move the iterator we've matched nearer the front of the list if it
+    // Move the type we've matched nearer the front of the list if it
     // deserves this
-    if (swapIter != m_TypesByCount.end()) {
-        std::iter_swap(swapIter, iter);
+    if (swapPosition != position) {
+        std::swap(m_TypesByCount[swapPosition], m_TypesByCount[position]);
+        m_TypePositions[m_TypesByCount[swapPosition].second] = swapPosition;
+        m_TypePositions[m_TypesByCount[position].second] = position;
+    }
+}
+
+void CBaseTokenListDataTyper::candidateTypes(size_t workWeight, TSizeVec& candidates) {
+    candidates.clear();
+    m_WorkSharingTypes.clear();
+    m_WorkSharedTokens.resize(m_Types.size());
+
+    // Sum the weight of the tokens each type shares with the string
+    for (const auto& tokenUniqueId : m_WorkTokenUniqueIds) {
+        if (tokenUniqueId.first >= m_TypesByToken.size()) {
+            continue;
+        }
+        for (const auto& typeToken : m_TypesByToken[tokenUniqueId.first]) {
+            SSharedTokens& shared = m_WorkSharedTokens[typeToken.s_Type];
+            if (shared.s_TypeWeight == 0) {
+                m_WorkSharingTypes.push_back(typeToken.s_Type);
+            }
+            shared.s_Weight += tokenUniqueId.second;
+            shared.s_TypeWeight += typeToken.s_Weight;
+            if (typeToken.s_CommonWeight == tokenUniqueId.second) {
+                ++shared.s_CommonTokens;
+            }
+        }
+    }
+
+    // Every unshared token in either the string or the type's base tokens
+    // adds at least its weight to the edit distance, so this bounds the
+    // similarity.  However, types whose common unique tokens are all in the
+    // string can match its reverse search whatever their similarity.
+    for (auto type : m_WorkSharingTypes) {
+        const SSharedTokens& shared = m_WorkSharedTokens[type];
+        const CTokenListType& typeObj = m_Types[type];
+        size_t baseWeight(typeObj.baseWeight());
+        size_t minDiff(std::max(workWeight - shared.s_Weight, baseWeight - shared.s_TypeWeight));
+        double maxSimilarity(1.0 - double(minDiff) / double(std::max(workWeight, baseWeight)));
+        if (maxSimilarity > m_LowerThreshold ||
+            shared.s_CommonTokens == typeObj.commonUniqueTokenIds().size()) {
+            candidates.push_back(m_TypePositions[type]);
+        }
+    }
+    for (auto type : m_TypesWithoutCommonTokens) {
+        if (m_WorkSharedTokens[type].s_TypeWeight == 0) {
+            candidates.push_back(m_TypePositions[type]);
+        }
+    }
+
+    for (auto type : m_WorkSharingTypes) {
+        m_WorkSharedTokens[type] = SSharedTokens();
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+}
+
+void CBaseTokenListDataTyper::indexType(size_t type) {
+    const CTokenListType& typeObj = m_Types[type];
+
+    TSizeSizeMap baseUniqueTokenIds;
+    for (const auto& baseTokenId : typeObj.baseTokenIds()) {
+        baseUniqueTokenIds[baseTokenId.first] += baseTokenId.second;
+    }
+
+    // Both token collections are sorted by ID
+    const TSizeSizePrVec& commonUniqueTokenIds = typeObj.commonUniqueTokenIds();
+    auto commonIter = commonUniqueTokenIds.begin();
+    for (const auto& baseUniqueTokenId : baseUniqueTokenIds) {
+        size_t tokenId(baseUniqueTokenId.first);
+        while (commonIter != commonUniqueTokenIds.end() && commonIter->first < tokenId) {
+            ++commonIter;
+        }
+        size_t commonWeight(commonIter != commonUniqueTokenIds.end() &&
+                                    commonIter->first == tokenId
+                                ? commonIter->second
+                                : 0);
+        if (tokenId >= m_TypesByToken.size()) {
+            m_TypesByToken.resize(tokenId + 1);
+        }
+        m_TypesByToken[tokenId].emplace_back(type, baseUniqueTokenId.second, commonWeight);
+    }
+
+    if (commonUniqueTokenIds.empty()) {
+        m_TypesWithoutCommonTokens.push_back(type);
+    }
+}
+
+void CBaseTokenListDataTyper::reindexCommonTokens(size_t type) {
+    // Common unique tokens are only ever removed so we just need to clear
+    // the common weight of those which have gone.  The entries for each
+    // token are sorted by type because types are indexed in creation order.
+    const CTokenListType& typeObj = m_Types[type];
+    const TSizeSizePrVec& commonUniqueTokenIds = typeObj.commonUniqueTokenIds();
+    for (const auto& baseTokenId : typeObj.baseTokenIds()) {
+        auto common = std::lower_bound(
+            commonUniqueTokenIds.begin(), commonUniqueTokenIds.end(), baseTokenId.first,
+            [](const TSizeSizePr& lhs, size_t rhs) { return lhs.first < rhs; });
+        if (common != commonUniqueTokenIds.end() && common->first == baseTokenId.first) {
+            continue;
+        }
+        TTypeTokenVec& typeTokens = m_TypesByToken[baseTokenId.first];
+        auto typeToken = std::lower_bound(
+            typeTokens.begin(), typeTokens.end(), type,
+            [](const STypeToken& lhs, size_t rhs) { return lhs.s_Type < rhs; });
+        if (typeToken != typeTokens.end() && typeToken->s_Type == type) {
+            typeToken->s_CommonWeight = 0;
+        }
+    }
+
+    if (commonUniqueTokenIds.empty()) {
+        m_TypesWithoutCommonTokens.push_back(type);
     }
 }
 
@@ -532,6 +665,14 @@ CBaseTokenListDataTyper::CSizePairFirstElementEquals::CSizePairFirstElementEqual
     : m_Value(value) {
 }
 
+CBaseTokenListDataTyper::STypeToken::STypeToken(size_t type, size_t weight, size_t commonWeight)
+    : s_Type(type), s_Weight(weight), s_CommonWeight(commonWeight) {
+}
+
+CBaseTokenListDataTyper::SSharedTokens::SSharedTokens()
+    : s_Weight(0), s_TypeWeight(0), s_CommonTokens(0) {
+}
+
 CBaseTokenListDataTyper::SIdTranslater::SIdTranslater(const CBaseTokenListDataTyper& typer,
                                                       const TSizeSizePrVec& tokenIds,
                                                       char separator)
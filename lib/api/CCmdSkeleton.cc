@@ -8,21 +8,121 @@
 #include <core/CDataAdder.h>
 #include <core/CDataSearcher.h>
 #include <core/CLogger.h>
+#include <core/CSpscRingBuffer.h>
+#include <core/CStatistics.h>
 
 #include <api/CDataProcessor.h>
 #include <api/CInputParser.h>
+#include <api/CRecordView.h>
 
 #include <boost/bind.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+
 namespace ml {
 namespace api {
+namespace {
+
+//! The maximum number of records in a batch.
+const std::size_t BATCH_SIZE{256};
+
+//! The maximum number of batches waiting to be processed.
+const std::size_t QUEUE_CAPACITY{16};
+
+//! \brief
+//! A batch of records passed from the reader thread to the processing thread.
+//!
+//! DESCRIPTION:\n
+//! Batches are recycled, so the vectors and strings they hold are never
+//! shrunk and copying records into them rarely allocates.
+class CRecordBatch {
+public:
+    using TStrVec = std::vector<std::string>;
+    using TStrVecVec = std::vector<TStrVec>;
+    using TSizeVec = std::vector<std::size_t>;
+
+public:
+    CRecordBatch() : m_Size(0) {}
+
+    //! Remove all the records.
+    void clear() {
+        m_Size = 0;
+        m_LayoutIds.clear();
+        m_RecordLayouts.clear();
+    }
+
+    //! Get the number of records.
+    std::size_t size() const { return m_Size; }
+
+    //! Check if the batch has room for any more records.
+    bool full() const { return m_Size == BATCH_SIZE; }
+
+    //! Add a record whose field names are \p fieldNames, identified by
+    //! \p layoutId, and get the strings to hold its field values.
+    TStrVec& add(std::size_t layoutId, const TStrVec& fieldNames) {
+        if (m_LayoutIds.empty() || m_LayoutIds.back() != layoutId) {
+            if (m_FieldNames.size() == m_LayoutIds.size()) {
+                m_FieldNames.emplace_back();
+            }
+            m_FieldNames[m_LayoutIds.size()] = fieldNames;
+            m_LayoutIds.push_back(layoutId);
+        }
+        m_RecordLayouts.push_back(m_LayoutIds.size() - 1);
+        if (m_FieldValues.size() == m_Size) {
+            m_FieldValues.emplace_back();
+        }
+        TStrVec& fieldValues = m_FieldValues[m_Size++];
+        fieldValues.resize(fieldNames.size());
+        return fieldValues;
+    }
+
+    //! Get the identifier of the field names of record \p i.
+    std::size_t layoutId(std::size_t i) const {
+        return m_LayoutIds[m_RecordLayouts[i]];
+    }
+
+    //! Get the field names of record \p i.
+    const TStrVec& fieldNames(std::size_t i) const {
+        return m_FieldNames[m_RecordLayouts[i]];
+    }
+
+    //! Get the field values of record \p i.
+    TStrVec& fieldValues(std::size_t i) { return m_FieldValues[i]; }
+
+private:
+    //! The number of records.
+    std::size_t m_Size;
+
+    //! The identifiers of the distinct field names in the batch.
+    TSizeVec m_LayoutIds;
+
+    //! The field names corresponding to m_LayoutIds.
+    TStrVecVec m_FieldNames;
+
+    //! The index in m_LayoutIds of each record's field names.
+    TSizeVec m_RecordLayouts;
+
+    //! The field values of each record.
+    TStrVecVec m_FieldValues;
+};
+
+using TRecordBatchPtr = std::unique_ptr<CRecordBatch>;
+using TRecordBatchPtrVec = std::vector<TRecordBatchPtr>;
+using TRecordBatchQueue = core::CSpscRingBuffer<CRecordBatch*>;
+}
 
 CCmdSkeleton::CCmdSkeleton(core::CDataSearcher* restoreSearcher,
                            core::CDataAdder* persister,
                            CInputParser& inputParser,
-                           CDataProcessor& processor)
+                           CDataProcessor& processor,
+                           bool pipelineInput)
     : m_RestoreSearcher(restoreSearcher), m_Persister(persister),
-      m_InputParser(inputParser), m_Processor(processor) {
+      m_InputParser(inputParser), m_Processor(processor),
+      m_PipelineInput(pipelineInput) {
 }
 
 bool CCmdSkeleton::ioLoop() {
@@ -36,8 +136,13 @@ bool CCmdSkeleton::ioLoop() {
         }
     }
 
-    if (m_InputParser.readStream(boost::bind(&CDataProcessor::handleRecord,
-                                             &m_Processor, _1)) == false) {
+    if (m_PipelineInput) {
+        if (this->pipelinedIoLoop() == false) {
+            LOG_FATAL(<< "Failed to handle all input data");
+            return false;
+        }
+    } else if (m_InputParser.readRecords(boost::bind(&CDataProcessor::handleRecordView,
+                                                     &m_Processor, _1)) == false) {
         LOG_FATAL(<< "Failed to handle all input data");
         return false;
     }
@@ -50,6 +155,149 @@ bool CCmdSkeleton::ioLoop() {
     return this->persistState();
 }
 
+bool CCmdSkeleton::pipelinedIoLoop() {
+    using TStrVec = CRecordBatch::TStrVec;
+    using TStrStrUMap = CRecordView::TStrStrUMap;
+    using TStrRefVec = CRecordView::TStrRefVec;
+
+    // There are enough batches to fill the queue while one is being read
+    // and one processed, so the reader never waits for a free batch.
+    TRecordBatchPtrVec batches;
+    TRecordBatchQueue freeBatches{QUEUE_CAPACITY + 2};
+    TRecordBatchQueue fullBatches{QUEUE_CAPACITY};
+    for (std::size_t i = 0; i < freeBatches.capacity(); ++i) {
+        batches.push_back(std::make_unique<CRecordBatch>());
+        freeBatches.push(batches.back().get());
+    }
+
+    std::atomic<bool> processingFailed{false};
+    bool readSucceeded{false};
+
+    std::thread reader([&] {
+        CRecordView::CFieldIndices controlFieldIndex;
+        std::size_t controlFieldSlot{controlFieldIndex.slot(CDataProcessor::CONTROL_FIELD_NAME)};
+        std::size_t generation{0};
+        std::size_t layoutId{0};
+        TStrVec fieldNames;
+        TStrVec unindexedFieldNames;
+
+        CRecordBatch* batch{nullptr};
+        freeBatches.pop(batch);
+
+        readSucceeded = m_InputParser.readRecords([&](const CRecordView& record) {
+            if (processingFailed.load()) {
+                return false;
+            }
+
+            if (record.indexed()) {
+                if (record.generation() != generation) {
+                    generation = record.generation();
+                    fieldNames = record.fieldNames();
+                    ++layoutId;
+                }
+                TStrVec& fieldValues = batch->add(layoutId, fieldNames);
+                for (std::size_t i = 0; i < fieldValues.size(); ++i) {
+                    fieldValues[i].assign(*record.fieldValue(i));
+                }
+            } else {
+                // Records without a fixed layout may have different fields
+                // every time
+                generation = 0;
+                unindexedFieldNames.clear();
+                for (const auto& field : record.fieldMap()) {
+                    unindexedFieldNames.push_back(field.first);
+                }
+                if (unindexedFieldNames != fieldNames) {
+                    fieldNames.swap(unindexedFieldNames);
+                    ++layoutId;
+                }
+                TStrVec& fieldValues = batch->add(layoutId, fieldNames);
+                std::size_t i{0};
+                for (const auto& field : record.fieldMap()) {
+                    fieldValues[i++].assign(field.second);
+                }
+            }
+
+            const std::string* controlField = controlFieldIndex.value(controlFieldSlot, record);
+            if (batch->full() || (controlField != nullptr && !controlField->empty())) {
+                fullBatches.push(batch);
+                freeBatches.pop(batch);
+            }
+            return true;
+        });
+
+        if (batch->size() > 0) {
+            fullBatches.push(batch);
+        }
+        // A null batch marks the end of the input
+        fullBatches.push(nullptr);
+    });
+
+    // The processor sees records with the same field names through a map
+    // and references to its values which are only rebuilt when they change
+    std::size_t layoutId{0};
+    std::size_t generation{0};
+    TStrVec fieldNames;
+    TStrStrUMap fieldMap;
+    TStrRefVec fieldValueRefs;
+
+    std::size_t numberBatches{0};
+    std::size_t totalOccupancy{0};
+    for (;;) {
+        CRecordBatch* batch{nullptr};
+        fullBatches.pop(batch);
+        if (batch == nullptr) {
+            break;
+        }
+        ++numberBatches;
+        totalOccupancy += fullBatches.size();
+
+        // After a failure keep taking batches so the reader isn't blocked
+        for (std::size_t i = 0; processingFailed.load() == false && i < batch->size(); ++i) {
+            if (layoutId == 0 || batch->layoutId(i) != layoutId) {
+                layoutId = batch->layoutId(i);
+                generation = CRecordView::newGeneration();
+                fieldNames = batch->fieldNames(i);
+                fieldMap.clear();
+                fieldValueRefs.clear();
+                for (const auto& fieldName : fieldNames) {
+                    fieldValueRefs.push_back(boost::ref(fieldMap[fieldName]));
+                }
+            }
+
+            // Swapping hands the previous record's strings back to the batch
+            // to be reused
+            TStrVec& fieldValues = batch->fieldValues(i);
+            for (std::size_t j = 0; j < fieldValues.size(); ++j) {
+                fieldValueRefs[j].get().swap(fieldValues[j]);
+            }
+
+            if (m_Processor.handleRecordView(CRecordView(generation, fieldNames,
+                                                         fieldValueRefs, fieldMap)) == false) {
+                LOG_ERROR(<< "Record handler function forced exit");
+                processingFailed.store(true);
+            }
+        }
+
+        batch->clear();
+        freeBatches.push(batch);
+    }
+
+    reader.join();
+
+    core::CStatistics::stat(stat_t::E_NumberInputBatches).increment(numberBatches);
+    core::CStatistics::stat(stat_t::E_InputQueueOccupancy).increment(totalOccupancy);
+    core::CStatistics::stat(stat_t::E_InputReaderStalls).increment(fullBatches.producerStalls());
+    core::CStatistics::stat(stat_t::E_InputProcessorStalls).increment(fullBatches.consumerStalls());
+    LOG_DEBUG(<< "Processed " << numberBatches << " input batches: mean queue occupancy "
+              << static_cast<double>(totalOccupancy) /
+                     static_cast<double>(std::max(numberBatches, std::size_t(1)))
+              << ", reader stalls " << fullBatches.producerStalls()
+              << ", processor stalls " << fullBatches.consumerStalls());
+
+    return readSucceeded && processingFailed.load() == false;
+}
+
 bool CCmdSkeleton::persistState() {
     if (m_Persister == nullptr) {
         LOG_DEBUG(<< "No persistence sink specified - will not attempt to persist state");
@@ -39,7 +39,7 @@ const std::string& CCsvInputParser::fieldNameStr() const {
     return m_FieldNameStr;
 }
 
-bool CCsvInputParser::readStream(const TReaderFunc& readerFunc) {
+bool CCsvInputParser::readRecords(const TRecordReaderFunc& readerFunc) {
     // Reset the record buffer pointers in case we're reading a new stream
     m_WorkBufferEnd = m_WorkBufferPtr;
     m_NoMoreRecords = false;
@@ -67,6 +67,9 @@ bool CCsvInputParser::readStream(const TReaderFunc& readerFunc) {
         fieldValRefs.push_back(boost::ref(recordFields[*iter]));
     }
 
+    // The field names are fixed for the rest of the stream
+    CRecordView record(CRecordView::newGeneration(), fieldNames, fieldValRefs, recordFields);
+
     while (!m_NoMoreRecords) {
         if (this->parseCsvRecordFromStream() == false) {
             LOG_ERROR(<< "Failed to parse CSV record from stream");
@@ -82,7 +85,7 @@ bool CCsvInputParser::readStream(const TReaderFunc& readerFunc) {
             return false;
         }
 
-        if (readerFunc(recordFields) == false) {
+        if (readerFunc(record) == false) {
             LOG_ERROR(<< "Record handler function forced exit");
             return false;
         }
@@ -7,6 +7,8 @@
 
 #include <core/CLogger.h>
 
+#include <api/CRecordView.h>
+
 namespace ml {
 namespace api {
 
@@ -22,6 +24,10 @@ CDataProcessor::~CDataProcessor() {
     // empty definition to the header file!
 }
 
+bool CDataProcessor::handleRecordView(const CRecordView& record) {
+    return this->handleRecord(record.fieldMap());
+}
+
 std::string CDataProcessor::debugPrintRecord(const TStrStrUMap& dataRowFields) {
     if (dataRowFields.empty()) {
         return "<EMPTY RECORD>";
@@ -54,7 +54,9 @@ CFieldDataTyper::CFieldDataTyper(const std::string& jobId,
       m_MaxMatchingLength(0), m_JsonOutputWriter(jsonOutputWriter),
       m_ExamplesCollector(limits.maxExamples()),
       m_CategorizationFieldName(config.categorizationFieldName()),
-      m_CategorizationFilter(), m_PeriodicPersister(periodicPersister) {
+      m_CategorizationFilter(), m_PeriodicPersister(periodicPersister),
+      m_ControlFieldSlot(m_RecordFieldIndices.slot(CONTROL_FIELD_NAME)),
+      m_CategorizationFieldSlot(m_RecordFieldIndices.slot(m_CategorizationFieldName)) {
     this->createTyper(m_CategorizationFieldName);
 
     LOG_DEBUG(<< "Configuring categorization filtering");
@@ -71,6 +73,12 @@ void CFieldDataTyper::newOutputStream() {
 }
 
 bool CFieldDataTyper::handleRecord(const TStrStrUMap& dataRowFields) {
+    return this->handleRecordView(CRecordView(dataRowFields));
+}
+
+bool CFieldDataTyper::handleRecordView(const CRecordView& record) {
+    const TStrStrUMap& dataRowFields = record.fieldMap();
+
     // First time through we output the field names
     if (m_WriteFieldNames) {
         TStrVec fieldNames;
@@ -88,15 +96,15 @@ bool CFieldDataTyper::handleRecord(const TStrStrUMap& dataRowFields) {
     }
 
     // Non-empty control fields take precedence over everything else
-    TStrStrUMapCItr iter = dataRowFields.find(CONTROL_FIELD_NAME);
-    if (iter != dataRowFields.end() && !iter->second.empty()) {
+    const std::string* controlField = m_RecordFieldIndices.value(m_ControlFieldSlot, record);
+    if (controlField != nullptr && !controlField->empty()) {
         if (m_OutputHandler.consumesControlMessages()) {
             return m_OutputHandler.writeRow(dataRowFields, m_Overrides);
         }
-        return this->handleControlMessage(iter->second);
+        return this->handleControlMessage(*controlField);
     }
 
-    m_OutputFieldCategory = core::CStringUtils::typeToString(this->computeType(dataRowFields));
+    m_OutputFieldCategory = core::CStringUtils::typeToString(this->computeType(record));
 
     if (m_OutputHandler.writeRow(dataRowFields, m_Overrides) == false) {
         LOG_ERROR(<< "Unable to write output with type " << m_OutputFieldCategory
@@ -128,17 +136,19 @@ COutputHandler& CFieldDataTyper::outputHandler() {
     return m_OutputHandler;
 }
 
-int CFieldDataTyper::computeType(const TStrStrUMap& dataRowFields) {
+int CFieldDataTyper::computeType(const CRecordView& record) {
+    const TStrStrUMap& dataRowFields = record.fieldMap();
     const std::string& categorizationFieldName = m_DataTyper->fieldName();
-    TStrStrUMapCItr fieldIter = dataRowFields.find(categorizationFieldName);
-    if (fieldIter == dataRowFields.end()) {
+    const std::string* categorizationField =
+        m_RecordFieldIndices.value(m_CategorizationFieldSlot, record);
+    if (categorizationField == nullptr) {
         LOG_WARN(<< "Assigning type -1 to record with no "
                  << categorizationFieldName << " field:" << core_t::LINE_ENDING
                  << this->debugPrintRecord(dataRowFields));
         return -1;
     }
 
-    const std::string& fieldValue = fieldIter->second;
+    const std::string& fieldValue = *categorizationField;
     if (fieldValue.empty()) {
         LOG_WARN(<< "Assigning type -1 to record with blank "
                  << categorizationFieldName << " field:" << core_t::LINE_ENDING
@@ -6,10 +6,14 @@
 
 #include <api/CForecastRunner.h>
 
+#include <core/CHashing.h>
 #include <core/CLogger.h>
+#include <core/CStaticThreadPool.h>
 #include <core/CStopWatch.h>
 #include <core/CTimeUtils.h>
 
+#include <maths/CSampling.h>
+
 #include <model/CForecastDataSink.h>
 #include <model/CForecastModelPersist.h>
 #include <model/ModelTypes.h>
@@ -19,13 +23,29 @@
 #include <boost/system/error_code.hpp>
 
 #include <memory>
+#include <mutex>
 #include <sstream>
+#include <vector>
 
 namespace ml {
 namespace api {
 
 namespace {
 const std::string EMPTY_STRING;
+
+//! Get the identifier of the random number stream used to forecast \p model
+//! of \p series.
+uint64_t forecastStream(const model::CForecastDataSink::SForecastResultSeries& series,
+                        const model::CForecastDataSink::SForecastModelWrapper& model) {
+    auto hash = [](const std::string& value) {
+        return core::CHashing::murmurHash64(value.data(), static_cast<int>(value.size()), 0);
+    };
+    return core::CHashing::hashCombine(
+        core::CHashing::hashCombine(static_cast<uint64_t>(series.s_DetectorIndex),
+                                    static_cast<uint64_t>(model.s_Feature)),
+        core::CHashing::hashCombine(hash(series.s_PartitionFieldValue),
+                                    hash(model.s_ByFieldValue)));
+}
 }
 
 const std::string CForecastRunner::ERROR_FORECAST_REQUEST_FAILED_TO_PARSE("Failed to parse forecast request: ");
@@ -89,9 +109,14 @@ CForecastRunner::SForecast& CForecastRunner::SForecast::operator=(SForecast&& ot
 
 CForecastRunner::CForecastRunner(const std::string& jobId,
                                  core::CJsonOutputStreamWrapper& strmOut,
-                                 model::CResourceMonitor& resourceMonitor)
+                                 model::CResourceMonitor& resourceMonitor,
+                                 std::size_t numberThreads)
     : m_JobId(jobId), m_ConcurrentOutputStream(strmOut),
       m_ResourceMonitor(resourceMonitor), m_Shutdown(false) {
+    if (numberThreads > 1) {
+        // The forecast worker also forecasts so needs no pool thread.
+        m_ThreadPool = std::make_unique<core::CStaticThreadPool>(numberThreads - 1);
+    }
     m_Worker = std::thread([this] { this->forecastWorker(); });
 }
 
@@ -133,8 +158,6 @@ void CForecastRunner::forecastWorker() {
                 forecastJob.forecastEnd(), forecastJob.s_ExpiryTime,
                 forecastJob.s_MemoryUsage, m_ConcurrentOutputStream);
 
-            std::string message;
-
             // collecting the runtime messages first and sending it in 1 go
             TStrUSet messages(forecastJob.s_Messages);
             double processedModels = 0;
@@ -143,47 +166,120 @@ void CForecastRunner::forecastWorker() {
             size_t failedForecasts = 0;
             sink.writeStats(0.0, 0, forecastJob.s_Messages);
 
-            // while loops allow us to free up memory for every model right after each forecast is done
-            while (!forecastJob.s_ForecastSeries.empty()) {
-                TForecastResultSeries& series = forecastJob.s_ForecastSeries.back();
-                std::unique_ptr<model::CForecastModelPersist::CRestore> modelRestore;
-
-                // initialize persistence restore exactly once
-                if (!series.s_ToForecastPersisted.empty()) {
-                    modelRestore.reset(new model::CForecastModelPersist::CRestore(
-                        series.s_ModelParams, series.s_MinimumSeasonalVarianceScale,
-                        series.s_ToForecastPersisted));
+            // The series are visited from the back and their models handed out
+            // one at a time to the threads forecasting, so at most one model per
+            // thread is in flight in addition to those waiting in the job. The
+            // mutex guards the series, the restore and all the progress state.
+            std::mutex mutex;
+            size_t remainingSeries = forecastJob.s_ForecastSeries.size();
+            std::vector<std::size_t> modelsInFlight(remainingSeries, 0);
+            bool restoreInitialized = false;
+            std::unique_ptr<model::CForecastModelPersist::CRestore> modelRestore;
+
+            // Free the series which have no models left to hand out and none
+            // being forecast. These are always at the back.
+            auto releaseSeries = [&]() {
+                while (forecastJob.s_ForecastSeries.size() > remainingSeries &&
+                       modelsInFlight[forecastJob.s_ForecastSeries.size() - 1] == 0) {
+                    forecastJob.s_ForecastSeries.pop_back();
                 }
+            };
+
+            auto nextModel = [&](std::size_t& series, TForecastModelWrapperPtr& model) {
+                while (remainingSeries > 0) {
+                    TForecastResultSeries& current =
+                        forecastJob.s_ForecastSeries[remainingSeries - 1];
+
+                    // initialize persistence restore exactly once
+                    if (restoreInitialized == false) {
+                        if (!current.s_ToForecastPersisted.empty()) {
+                            modelRestore.reset(new model::CForecastModelPersist::CRestore(
+                                current.s_ModelParams, current.s_MinimumSeasonalVarianceScale,
+                                current.s_ToForecastPersisted));
+                        }
+                        restoreInitialized = true;
+                    }
 
-                while (series.s_ToForecast.empty() == false || modelRestore != nullptr) {
                     // check if we should backfill from persistence
-                    if (series.s_ToForecast.empty()) {
-                        TMathsModelPtr model;
+                    if (current.s_ToForecast.empty() && modelRestore != nullptr) {
+                        TMathsModelPtr restoredModel;
                         model_t::EFeature feature;
                         std::string byFieldValue;
 
-                        if (modelRestore->nextModel(model, feature, byFieldValue)) {
-                            series.s_ToForecast.emplace_back(
-                                feature, std::move(model), byFieldValue);
+                        if (modelRestore->nextModel(restoredModel, feature, byFieldValue)) {
+                            current.s_ToForecast.emplace_back(
+                                feature, std::move(restoredModel), byFieldValue);
                         } else {
                             // restorer exhausted, no need for further restoring
                             modelRestore.reset();
+                        }
+                    }
+
+                    if (current.s_ToForecast.empty() == false) {
+                        series = remainingSeries - 1;
+                        ++modelsInFlight[series];
+                        model = std::make_unique<TForecastModelWrapper>(
+                            std::move(current.s_ToForecast.back()));
+                        current.s_ToForecast.pop_back();
+                        return true;
+                    }
+
+                    --remainingSeries;
+                    restoreInitialized = false;
+                    releaseSeries();
+                }
+                return false;
+            };
+
+            auto forecastModels = [&](std::size_t) {
+                // Each thread writes its results through its own sink, which
+                // all share the concurrent output stream
+                model::CForecastDataSink threadSink(
+                    m_JobId, forecastJob.s_ForecastId, forecastJob.s_ForecastAlias,
+                    forecastJob.s_CreateTime, forecastJob.s_StartTime,
+                    forecastJob.forecastEnd(), forecastJob.s_ExpiryTime,
+                    forecastJob.s_MemoryUsage, m_ConcurrentOutputStream);
+                uint64_t numRecordsReported = 0;
+                std::string message;
+
+                for (;;) {
+                    std::size_t index;
+                    TForecastModelWrapperPtr model;
+                    const TForecastResultSeries* series_ = nullptr;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (nextModel(index, model) == false) {
                             break;
                         }
+                        series_ = &forecastJob.s_ForecastSeries[index];
+                    }
+                    const TForecastResultSeries& series = *series_;
+
+                    bool success;
+                    {
+                        // Each model draws from its own random number stream
+                        // so the forecast doesn't depend on which thread runs it
+                        maths::CSampling::CScopeRandomNumberStream stream{
+                            forecastStream(series, *model)};
+                        model_t::TDouble1VecDouble1VecPr support =
+                            model_t::support(model->s_Feature);
+                        success = model->s_ForecastModel->forecast(
+                            forecastJob.s_StartTime, forecastJob.forecastEnd(),
+                            forecastJob.s_BoundsPercentile, support.first, support.second,
+                            boost::bind(&model::CForecastDataSink::push, &threadSink, _1,
+                                        model_t::print(model->s_Feature),
+                                        series.s_PartitionFieldName,
+                                        series.s_PartitionFieldValue, series.s_ByFieldName,
+                                        model->s_ByFieldValue, series.s_DetectorIndex),
+                            message);
                     }
+                    // free up memory right after each forecast is done
+                    model.reset();
 
-                    const TForecastModelWrapper& model = series.s_ToForecast.back();
-                    model_t::TDouble1VecDouble1VecPr support =
-                        model_t::support(model.s_Feature);
-                    bool success = model.s_ForecastModel->forecast(
-                        forecastJob.s_StartTime, forecastJob.forecastEnd(),
-                        forecastJob.s_BoundsPercentile, support.first, support.second,
-                        boost::bind(&model::CForecastDataSink::push, &sink, _1,
-                                    model_t::print(model.s_Feature), series.s_PartitionFieldName,
-                                    series.s_PartitionFieldValue, series.s_ByFieldName,
-                                    model.s_ByFieldValue, series.s_DetectorIndex),
-                        message);
-                    series.s_ToForecast.pop_back();
+                    std::lock_guard<std::mutex> lock(mutex);
+
+                    sink.addNumRecordsWritten(threadSink.numRecordsWritten() - numRecordsReported);
+                    numRecordsReported = threadSink.numRecordsWritten();
 
                     if (success == false) {
                         LOG_DEBUG(<< "Detector " << series.s_DetectorIndex
@@ -197,6 +293,11 @@ void CForecastRunner::forecastWorker() {
                         message.clear();
                     }
 
+                    --modelsInFlight[index];
+                    releaseSeries();
+
+                    // progress is only written while holding the lock, so it
+                    // is always increasing
                     ++processedModels;
 
                     if (processedModels != totalNumberOfForecastableModels) {
@@ -208,8 +309,15 @@ void CForecastRunner::forecastWorker() {
                         }
                     }
                 }
-                forecastJob.s_ForecastSeries.pop_back();
+            };
+
+            if (m_ThreadPool != nullptr) {
+                // the calling thread also forecasts
+                m_ThreadPool->parallelForEach(m_ThreadPool->size() + 1, forecastModels);
+            } else {
+                forecastModels(0);
             }
+
             // write final message
             sink.writeStats(1.0, timer.stop(), messages,
                             failedForecasts != forecastJob.s_NumberOfForecastableModels);
@@ -26,6 +26,12 @@ const CInputParser::TStrVec& CInputParser::fieldNames() const {
     return m_FieldNames;
 }
 
+bool CInputParser::readStream(const TReaderFunc& readerFunc) {
+    return this->readRecords([&readerFunc](const CRecordView& record) {
+        return readerFunc(record.fieldMap());
+    });
+}
+
 void CInputParser::gotFieldNames(bool gotFieldNames) {
     m_GotFieldNames = gotFieldNames;
 }
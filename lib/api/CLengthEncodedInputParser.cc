@@ -45,7 +45,7 @@ CLengthEncodedInputParser::CLengthEncodedInputParser(std::istream& strmIn)
     }
 }
 
-bool CLengthEncodedInputParser::readStream(const TReaderFunc& readerFunc) {
+bool CLengthEncodedInputParser::readRecords(const TRecordReaderFunc& readerFunc) {
     // Reset the record buffer pointers in case we're reading a new stream
     m_WorkBufferEnd = m_WorkBufferPtr;
     m_NoMoreRecords = false;
@@ -77,6 +77,9 @@ bool CLengthEncodedInputParser::readStream(const TReaderFunc& readerFunc) {
         fieldValRefs.push_back(boost::ref(recordFields[*iter]));
     }
 
+    // The field names are fixed for the rest of the stream
+    CRecordView record(CRecordView::newGeneration(), fieldNames, fieldValRefs, recordFields);
+
     while (!m_NoMoreRecords) {
         if (this->parseRecordFromStream<false>(fieldValRefs) == false) {
             LOG_ERROR(<< "Failed to parse length encoded data record from stream");
@@ -89,7 +92,7 @@ bool CLengthEncodedInputParser::readStream(const TReaderFunc& readerFunc) {
 
         this->gotData(true);
 
-        if (readerFunc(recordFields) == false) {
+        if (readerFunc(record) == false) {
             LOG_ERROR(<< "Record handler function forced exit");
             return false;
         }
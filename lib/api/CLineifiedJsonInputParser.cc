@@ -17,7 +17,7 @@ CLineifiedJsonInputParser::CLineifiedJsonInputParser(std::istream& strmIn, bool
     : CLineifiedInputParser(strmIn), m_AllDocsSameStructure(allDocsSameStructure) {
 }
 
-bool CLineifiedJsonInputParser::readStream(const TReaderFunc& readerFunc) {
+bool CLineifiedJsonInputParser::readRecords(const TRecordReaderFunc& readerFunc) {
     TStrVec& fieldNames = this->fieldNames();
     TStrRefVec fieldValRefs;
 
@@ -27,6 +27,9 @@ bool CLineifiedJsonInputParser::readStream(const TReaderFunc& readerFunc) {
     // We reuse the same field map for every record
     TStrStrUMap recordFields;
 
+    // Records can only be addressed by index if they have common fields
+    std::size_t generation(0);
+
     char* begin(this->parseLine().first);
     while (begin != nullptr) {
         rapidjson::Document document;
@@ -41,6 +44,9 @@ bool CLineifiedJsonInputParser::readStream(const TReaderFunc& readerFunc) {
                 LOG_ERROR(<< "Failed to decode JSON document");
                 return false;
             }
+            if (generation == 0) {
+                generation = CRecordView::newGeneration();
+            }
         } else {
             if (this->decodeDocumentWithArbitraryFields(document, fieldNames,
                                                         recordFields) == false) {
@@ -49,7 +55,9 @@ bool CLineifiedJsonInputParser::readStream(const TReaderFunc& readerFunc) {
             }
         }
 
-        if (readerFunc(recordFields) == false) {
+        if (readerFunc(m_AllDocsSameStructure
+                           ? CRecordView(generation, fieldNames, fieldValRefs, recordFields)
+                           : CRecordView(recordFields)) == false) {
             LOG_ERROR(<< "Record handler function forced exit");
             return false;
         }
@@ -20,7 +20,7 @@ CLineifiedXmlInputParser::CLineifiedXmlInputParser(core::CXmlParserIntf& parser,
       m_AllDocsSameStructure(allDocsSameStructure) {
 }
 
-bool CLineifiedXmlInputParser::readStream(const TReaderFunc& readerFunc) {
+bool CLineifiedXmlInputParser::readRecords(const TRecordReaderFunc& readerFunc) {
     TStrVec& fieldNames = this->fieldNames();
     TStrRefVec fieldValRefs;
 
@@ -30,6 +30,9 @@ bool CLineifiedXmlInputParser::readStream(const TReaderFunc& readerFunc) {
     // We reuse the same field map for every record
     TStrStrUMap recordFields;
 
+    // Records can only be addressed by index if they have common fields
+    std::size_t generation(0);
+
     TCharPSizePr beginLenPair(this->parseLine());
     while (beginLenPair.first != nullptr) {
         if (m_Parser.parseBufferInSitu(beginLenPair.first, beginLenPair.second) == false) {
@@ -48,11 +51,16 @@ bool CLineifiedXmlInputParser::readStream(const TReaderFunc& readerFunc) {
                 LOG_ERROR(<< "Failed to decode XML document");
                 return false;
             }
+            if (generation == 0) {
+                generation = CRecordView::newGeneration();
+            }
         } else {
             this->decodeDocumentWithArbitraryFields(fieldNames, recordFields);
         }
 
-        if (readerFunc(recordFields) == false) {
+        if (readerFunc(m_AllDocsSameStructure
+                           ? CRecordView(generation, fieldNames, fieldValRefs, recordFields)
+                           : CRecordView(recordFields)) == false) {
             LOG_ERROR(<< "Record handler function forced exit");
             return false;
         }
@@ -20,6 +20,8 @@ const std::string TOTAL_BY_FIELD_COUNT("total_by_field_count");
 const std::string TOTAL_OVER_FIELD_COUNT("total_over_field_count");
 const std::string TOTAL_PARTITION_FIELD_COUNT("total_partition_field_count");
 const std::string BUCKET_ALLOCATION_FAILURES_COUNT("bucket_allocation_failures_count");
+const std::string DEFERRED_SEASONALITY_TESTS_COUNT("deferred_seasonality_tests_count");
+const std::string SEASONALITY_TEST_TIME_MS("seasonality_test_time_ms");
 const std::string MEMORY_STATUS("memory_status");
 const std::string TIMESTAMP("timestamp");
 const std::string LOG_TIME("log_time");
@@ -57,6 +59,12 @@ void CModelSizeStatsJsonWriter::write(const std::string& jobId,
     writer.String(BUCKET_ALLOCATION_FAILURES_COUNT);
     writer.Uint64(results.s_AllocationFailures);
 
+    writer.String(DEFERRED_SEASONALITY_TESTS_COUNT);
+    writer.Uint64(results.s_DeferredSeasonalityTests);
+
+    writer.String(SEASONALITY_TEST_TIME_MS);
+    writer.Uint64(results.s_SeasonalityTestTime);
+
     writer.String(MEMORY_STATUS);
     writer.String(print(results.s_MemoryStatus));
 
@@ -8,12 +8,13 @@
 #include <core/CLogger.h>
 
 #include <api/CDataProcessor.h>
+#include <api/CRecordView.h>
 
 namespace ml {
 namespace api {
 
 COutputChainer::COutputChainer(CDataProcessor& dataProcessor)
-    : m_DataProcessor(dataProcessor) {
+    : m_DataProcessor(dataProcessor), m_WorkRecordGeneration(0) {
 }
 
 void COutputChainer::newOutputStream() {
@@ -50,6 +51,7 @@ bool COutputChainer::fieldNames(const TStrVec& fieldNames, const TStrVec& extraF
         m_Hashes.push_back(EMPTY_FIELD_OVERRIDES.hash_function()(*iter));
         m_WorkRecordFieldRefs.push_back(boost::ref(m_WorkRecordFields[*iter]));
     }
+    m_WorkRecordGeneration = CRecordView::newGeneration();
 
     return true;
 }
@@ -91,7 +93,11 @@ bool COutputChainer::writeRow(const TStrStrUMap& dataRowFields,
                                    fieldValueIter->second.length());
     }
 
-    if (m_DataProcessor.handleRecord(m_WorkRecordFields) == false) {
+    // Pass the fields by index so the next data processor doesn't need to
+    // look them up by name
+    if (m_DataProcessor.handleRecordView(
+            CRecordView(m_WorkRecordGeneration, m_FieldNames,
+                        m_WorkRecordFieldRefs, m_WorkRecordFields)) == false) {
         LOG_ERROR(<< "Chained data processor function returned false for record:" << core_t::LINE_ENDING
                   << CDataProcessor::debugPrintRecord(m_WorkRecordFields));
         return false;
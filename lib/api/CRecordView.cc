@@ -0,0 +1,116 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include <api/CRecordView.h>
+
+#include <algorithm>
+#include <atomic>
+
+namespace ml {
+namespace api {
+
+namespace {
+//! The last generation handed out to a view; 0 is reserved for unindexed views.
+std::atomic<std::size_t> lastGeneration{0};
+}
+
+// Initialise statics
+const std::size_t CRecordView::NOT_FOUND(static_cast<std::size_t>(-1));
+const CRecordView::TStrVec CRecordView::EMPTY_FIELD_NAMES;
+const CRecordView::TStrRefVec CRecordView::EMPTY_FIELD_VALUES;
+
+CRecordView::CRecordView(const TStrStrUMap& fieldMap)
+    : m_Generation(0), m_FieldNames(EMPTY_FIELD_NAMES),
+      m_FieldValues(EMPTY_FIELD_VALUES), m_FieldMap(fieldMap) {
+}
+
+CRecordView::CRecordView(std::size_t generation,
+                         const TStrVec& fieldNames,
+                         const TStrRefVec& fieldValues,
+                         const TStrStrUMap& fieldMap)
+    : m_Generation(generation), m_FieldNames(fieldNames),
+      m_FieldValues(fieldValues), m_FieldMap(fieldMap) {
+}
+
+std::size_t CRecordView::newGeneration() {
+    return ++lastGeneration;
+}
+
+bool CRecordView::indexed() const {
+    return m_Generation != 0;
+}
+
+std::size_t CRecordView::generation() const {
+    return m_Generation;
+}
+
+const CRecordView::TStrVec& CRecordView::fieldNames() const {
+    return m_FieldNames;
+}
+
+std::size_t CRecordView::fieldIndex(const std::string& fieldName) const {
+    auto i = std::find(m_FieldNames.begin(), m_FieldNames.end(), fieldName);
+    return i == m_FieldNames.end() ? NOT_FOUND
+                                   : static_cast<std::size_t>(i - m_FieldNames.begin());
+}
+
+const std::string* CRecordView::fieldValue(std::size_t index) const {
+    return index < m_FieldValues.size() ? m_FieldValues[index].get_pointer() : nullptr;
+}
+
+const std::string* CRecordView::fieldValue(const std::string& fieldName) const {
+    auto i = m_FieldMap.find(fieldName);
+    return i == m_FieldMap.end() ? nullptr : &i->second;
+}
+
+const CRecordView::TStrStrUMap& CRecordView::fieldMap() const {
+    return m_FieldMap;
+}
+
+CRecordView::CFieldIndices::CFieldIndices() : m_Generation(0) {
+}
+
+std::size_t CRecordView::CFieldIndices::slot(const std::string& fieldName) {
+    auto i = std::find(m_FieldNames.begin(), m_FieldNames.end(), fieldName);
+    if (i != m_FieldNames.end()) {
+        return static_cast<std::size_t>(i - m_FieldNames.begin());
+    }
+    m_FieldNames.push_back(fieldName);
+    // Force the indices to be recomputed for the next record
+    m_Generation = 0;
+    return m_FieldNames.size() - 1;
+}
+
+const std::string* CRecordView::CFieldIndices::value(std::size_t slot,
+                                                     const CRecordView& record) {
+    if (record.indexed() == false) {
+        return record.fieldValue(m_FieldNames[slot]);
+    }
+    if (record.generation() != m_Generation) {
+        this->resolve(record);
+    }
+    return record.fieldValue(m_Indices[slot]);
+}
+
+std::size_t CRecordView::CFieldIndices::size() const {
+    return m_FieldNames.size();
+}
+
+void CRecordView::CFieldIndices::clear() {
+    m_FieldNames.clear();
+    m_Indices.clear();
+    m_Generation = 0;
+}
+
+void CRecordView::CFieldIndices::resolve(const CRecordView& record) {
+    m_Indices.clear();
+    m_Indices.reserve(m_FieldNames.size());
+    for (const auto& fieldName : m_FieldNames) {
+        m_Indices.push_back(record.fieldIndex(fieldName));
+    }
+    m_Generation = record.generation();
+}
+}
+}
@@ -5,6 +5,7 @@
  */
 #include <api/CResultNormalizer.h>
 
+#include <core/CStaticThreadPool.h>
 #include <core/CStringUtils.h>
 
 #include <maths/CTools.h>
@@ -30,13 +31,24 @@ const std::string CResultNormalizer::PARTITION_LEVEL("part");
 const std::string CResultNormalizer::BUCKET_INFLUENCER_LEVEL("inflb");
 const std::string CResultNormalizer::INFLUENCER_LEVEL("infl");
 const std::string CResultNormalizer::ZERO("0");
+const std::size_t CResultNormalizer::BLOCK_SIZE(4096);
 
 CResultNormalizer::CResultNormalizer(const model::CAnomalyDetectorModelConfig& modelConfig,
-                                     COutputHandler& outputHandler)
+                                     COutputHandler& outputHandler,
+                                     std::size_t numberThreads)
     : m_ModelConfig(modelConfig), m_OutputHandler(outputHandler),
       m_WriteFieldNames(true),
       m_OutputFieldNormalizedScore(m_OutputFields[NORMALIZED_SCORE_NAME]),
       m_Normalizer(m_ModelConfig) {
+    if (numberThreads > 1) {
+        LOG_DEBUG(<< "Using " << numberThreads << " threads to normalize results");
+        // The calling thread also does work so needs no worker.
+        m_ThreadPool = std::make_unique<core::CStaticThreadPool>(numberThreads - 1);
+        m_BlockFields.reserve(BLOCK_SIZE);
+    }
+}
+
+CResultNormalizer::~CResultNormalizer() {
 }
 
 bool CResultNormalizer::initNormalizer(const std::string& stateFileName) {
@@ -51,6 +63,29 @@ bool CResultNormalizer::initNormalizer(const std::string& stateFileName) {
 }
 
 bool CResultNormalizer::handleRecord(const TStrStrUMap& dataRowFields) {
+    if (this->writeFieldNames(dataRowFields) == false) {
+        return false;
+    }
+
+    if (m_ThreadPool != nullptr) {
+        m_BlockFields.push_back(dataRowFields);
+        return m_BlockFields.size() < BLOCK_SIZE || this->handleBlock();
+    }
+
+    SRecord record;
+    this->parseRecord(dataRowFields, record);
+    if (record.s_IsNormalizable) {
+        record.s_Normalizer = this->normalizer(record);
+        this->normalize(record);
+    }
+    return this->writeRecord(dataRowFields, record);
+}
+
+bool CResultNormalizer::finalise() {
+    return m_BlockFields.empty() || this->handleBlock();
+}
+
+bool CResultNormalizer::writeFieldNames(const TStrStrUMap& dataRowFields) {
     if (m_WriteFieldNames) {
         TStrVec fieldNames;
         fieldNames.reserve(dataRowFields.size());
@@ -67,66 +102,123 @@ bool CResultNormalizer::handleRecord(const TStrStrUMap& dataRowFields) {
         }
         m_WriteFieldNames = false;
     }
+    return true;
+}
 
-    std::string level;
-    std::string partitionName;
-    std::string partitionValue;
-    std::string personName;
-    std::string personValue;
-    std::string function;
-    std::string valueFieldName;
-    double probability(0.0);
+bool CResultNormalizer::handleBlock() {
+    std::size_t n{m_BlockFields.size()};
+    m_BlockRecords.resize(n);
+
+    m_ThreadPool->parallelForEach(n, [this](std::size_t i) {
+        m_BlockRecords[i] = SRecord{};
+        this->parseRecord(m_BlockFields[i], m_BlockRecords[i]);
+    });
+
+    // Records for the same normalizer tend to be grouped so looking up
+    // each normalizer once per block avoids most of the work of finding
+    // them. This is done serially because the lookups log errors.
+    m_BlockNormalizers.clear();
+    std::string key;
+    for (auto& record : m_BlockRecords) {
+        if (record.s_IsNormalizable) {
+            key.assign(record.s_Level).append(1, '\0');
+            key.append(record.s_PartitionName).append(1, '\0');
+            key.append(record.s_PersonName).append(1, '\0');
+            key.append(record.s_Function).append(1, '\0');
+            key.append(record.s_ValueFieldName);
+            auto i = m_BlockNormalizers.find(key);
+            if (i == m_BlockNormalizers.end()) {
+                i = m_BlockNormalizers.emplace(key, this->normalizer(record)).first;
+            }
+            record.s_Normalizer = i->second;
+        }
+    }
 
+    m_ThreadPool->parallelForEach(n, [this](std::size_t i) {
+        if (m_BlockRecords[i].s_IsNormalizable) {
+            this->normalize(m_BlockRecords[i]);
+        }
+    });
+
+    bool result{true};
+    for (std::size_t i = 0u; result && i < n; ++i) {
+        result = this->writeRecord(m_BlockFields[i], m_BlockRecords[i]);
+    }
+
+    m_BlockFields.clear();
+    m_BlockRecords.clear();
+
+    return result;
+}
+
+void CResultNormalizer::parseRecord(const TStrStrUMap& dataRowFields, SRecord& record) const {
     // As of version 6.5 the 'personValue' field is required for (re)normalization to succeed.
     // In the case of renormalization the 'personValue' field must be included in the set of
     // parameters sent from the Java side ML plugin to Elasticsearch.
     // In production the version of the native code application and the java application it is communicating directly
     // with will always match so supporting BWC with versions prior to 6.5 is not necessary.
-    bool isNormalizable = this->parseDataFields(
-        dataRowFields, level, partitionName, partitionValue, personName,
-        personValue, function, valueFieldName, probability);
-
-    LOG_TRACE(<< "level='" << level << "', partitionName='" << partitionName << "', partitionValue='"
-              << partitionValue << "', personName='" << personName << "', personValue='"
-              << personValue << "', function='" << function << "', valueFieldName='"
-              << valueFieldName << "', probability='" << probability << "'");
-
-    if (isNormalizable) {
-        const model::CAnomalyScore::CNormalizer* levelNormalizer = nullptr;
-        double score = probability > m_ModelConfig.maximumAnomalousProbability()
-                           ? 0.0
-                           : maths::CTools::anomalyScore(probability);
-        if (level == ROOT_LEVEL) {
-            levelNormalizer = &m_Normalizer.bucketNormalizer();
-        } else if (level == LEAF_LEVEL) {
-            levelNormalizer = m_Normalizer.leafNormalizer(
-                partitionName, personName, function, valueFieldName);
-        } else if (level == PARTITION_LEVEL) {
-            levelNormalizer = m_Normalizer.partitionNormalizer(partitionName);
-        } else if (level == BUCKET_INFLUENCER_LEVEL) {
-            levelNormalizer = m_Normalizer.influencerBucketNormalizer(personName);
-        } else if (level == INFLUENCER_LEVEL) {
-            levelNormalizer = m_Normalizer.influencerNormalizer(personName);
-        } else {
-            LOG_ERROR(<< "Unexpected   : " << level);
-        }
-        if (levelNormalizer != nullptr) {
-            if (levelNormalizer->canNormalize()) {
-                model::CAnomalyScore::CNormalizer::CMaximumScoreScope scope{
-                    partitionName, partitionValue, personName, personValue};
-                if (levelNormalizer->normalize(scope, score) == false) {
-                    LOG_ERROR(<< "Failed to normalize score " << score << " at level \""
-                              << level << "\" using scope " << scope.print());
-                }
-            }
-        } else {
-            LOG_ERROR(<< "No normalizer available at level '" << level
-                      << "' with partition field name '" << partitionName
-                      << "' and person field name '" << personName << "'");
+    record.s_IsNormalizable = this->parseDataFields(
+        dataRowFields, record.s_Level, record.s_PartitionName,
+        record.s_PartitionValue, record.s_PersonName, record.s_PersonValue,
+        record.s_Function, record.s_ValueFieldName, record.s_Probability);
+
+    LOG_TRACE(<< "level='" << record.s_Level << "', partitionName='"
+              << record.s_PartitionName << "', partitionValue='"
+              << record.s_PartitionValue << "', personName='" << record.s_PersonName
+              << "', personValue='" << record.s_PersonValue << "', function='"
+              << record.s_Function << "', valueFieldName='" << record.s_ValueFieldName
+              << "', probability='" << record.s_Probability << "'");
+}
+
+const model::CAnomalyScore::CNormalizer*
+CResultNormalizer::normalizer(const SRecord& record) const {
+    const model::CAnomalyScore::CNormalizer* levelNormalizer = nullptr;
+    const std::string& level = record.s_Level;
+    if (level == ROOT_LEVEL) {
+        levelNormalizer = &m_Normalizer.bucketNormalizer();
+    } else if (level == LEAF_LEVEL) {
+        levelNormalizer = m_Normalizer.leafNormalizer(
+            record.s_PartitionName, record.s_PersonName, record.s_Function,
+            record.s_ValueFieldName);
+    } else if (level == PARTITION_LEVEL) {
+        levelNormalizer = m_Normalizer.partitionNormalizer(record.s_PartitionName);
+    } else if (level == BUCKET_INFLUENCER_LEVEL) {
+        levelNormalizer = m_Normalizer.influencerBucketNormalizer(record.s_PersonName);
+    } else if (level == INFLUENCER_LEVEL) {
+        levelNormalizer = m_Normalizer.influencerNormalizer(record.s_PersonName);
+    } else {
+        LOG_ERROR(<< "Unexpected   : " << level);
+    }
+    if (levelNormalizer == nullptr) {
+        LOG_ERROR(<< "No normalizer available at level '" << level
+                  << "' with partition field name '" << record.s_PartitionName
+                  << "' and person field name '" << record.s_PersonName << "'");
+    }
+    return levelNormalizer;
+}
+
+void CResultNormalizer::normalize(SRecord& record) const {
+    double score = record.s_Probability > m_ModelConfig.maximumAnomalousProbability()
+                       ? 0.0
+                       : maths::CTools::anomalyScore(record.s_Probability);
+    const model::CAnomalyScore::CNormalizer* levelNormalizer = record.s_Normalizer;
+    if (levelNormalizer != nullptr && levelNormalizer->canNormalize()) {
+        model::CAnomalyScore::CNormalizer::CMaximumScoreScope scope{
+            record.s_PartitionName, record.s_PartitionValue, record.s_PersonName,
+            record.s_PersonValue};
+        if (levelNormalizer->normalize(scope, score) == false) {
+            LOG_ERROR(<< "Failed to normalize score " << score << " at level \""
+                      << record.s_Level << "\" using scope " << scope.print());
         }
+    }
+
+    record.s_NormalizedScore = (score > 0.0) ? core::CStringUtils::typeToStringPretty(score)
+                                             : ZERO;
+}
 
-        m_OutputFieldNormalizedScore =
-            (score > 0.0) ? core::CStringUtils::typeToStringPretty(score) : ZERO;
+bool CResultNormalizer::writeRecord(const TStrStrUMap& dataRowFields, const SRecord& record) {
+    if (record.s_IsNormalizable) {
+        m_OutputFieldNormalizedScore = record.s_NormalizedScore;
     } else {
         m_OutputFieldNormalizedScore.clear();
     }
@@ -147,7 +239,7 @@ bool CResultNormalizer::parseDataFields(const TStrStrUMap& dataRowFields,
                                         std::string& personValue,
                                         std::string& function,
                                         std::string& valueFieldName,
-                                        double& probability) {
+                                        double& probability) const {
     return this->parseDataField(dataRowFields, LEVEL, level) &&
            this->parseDataField(dataRowFields, PARTITION_FIELD_NAME, partitionName) &&
            this->parseDataField(dataRowFields, PARTITION_FIELD_VALUE, partitionValue) &&
@@ -8,24 +8,43 @@
 #include <core/CJsonOutputStreamWrapper.h>
 #include <core/CLogger.h>
 #include <core/CRegex.h>
+#include <core/CStatistics.h>
+#include <core/CStopWatch.h>
+#include <core/CStringUtils.h>
+
+#include <maths/CTimeSeriesTestScheduler.h>
 
 #include <model/CAnomalyDetectorModelConfig.h>
 #include <model/CDataGatherer.h>
 #include <model/CLimits.h>
+#include <model/CStringStore.h>
 
 #include <api/CAnomalyJob.h>
+#include <api/CCmdSkeleton.h>
 #include <api/CCsvInputParser.h>
 #include <api/CFieldConfig.h>
 #include <api/CHierarchicalResultsWriter.h>
 #include <api/CJsonOutputWriter.h>
+#include <api/CSingleStreamDataAdder.h>
+#include <api/CSingleStreamSearcher.h>
+#include <api/CStateRestoreStreamFilter.h>
 
 #include <rapidjson/document.h>
 
+#include <boost/iostreams/filtering_stream.hpp>
 #include <boost/tuple/tuple.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <numeric>
+#include <regex>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 namespace {
 
@@ -170,10 +189,83 @@ bool findLine(const std::string& regex, const ml::core::CRegex::TStrVec& lines)
 }
 
 const ml::core_t::TTime BUCKET_SIZE(3600);
+
+//! Run a job which models the mean value of every animal in every zoo
+//! using \p numberThreads threads and return its output without the
+//! fields which depend on timing.
+//!
+//! \param[out] closeTimes The time in ms taken to close each bucket,
+//! which happens when the first record of the next bucket is handled.
+std::string runZooJob(std::size_t numberThreads,
+                      std::size_t numberZoos,
+                      std::size_t numberAnimals,
+                      std::size_t numberBuckets,
+                      std::vector<std::uint64_t>& closeTimes) {
+    ml::core_t::TTime bucketSize = 600;
+
+    ml::model::CLimits limits;
+    ml::api::CFieldConfig fieldConfig;
+    ml::api::CFieldConfig::TStrVec clauses{"mean(value)", "by", "animal",
+                                           "partitionfield=zoo"};
+    fieldConfig.initFromClause(clauses);
+
+    ml::model::CAnomalyDetectorModelConfig modelConfig =
+        ml::model::CAnomalyDetectorModelConfig::defaultConfig(bucketSize);
+    modelConfig.modelPlotBoundsPercentile(1.0);
+    modelConfig.modelPlotTerms({"zoo1", "animal7"});
+
+    closeTimes.clear();
+    closeTimes.reserve(numberBuckets);
+
+    std::stringstream outputStrm;
+    {
+        ml::core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+
+        ml::api::CAnomalyJob job("job", limits, fieldConfig, modelConfig,
+                                 wrappedOutputStream,
+                                 ml::api::CAnomalyJob::TPersistCompleteFunc(),
+                                 nullptr, -1, "time", "", 0, numberThreads);
+
+        ml::api::CAnomalyJob::TStrStrUMap dataRows;
+        for (std::size_t i = 0; i < numberBuckets; ++i) {
+            ml::core_t::TTime time{static_cast<ml::core_t::TTime>(i) * bucketSize};
+            dataRows["time"] = ml::core::CStringUtils::typeToString(time + 1);
+            for (std::size_t j = 0; j < numberZoos; ++j) {
+                dataRows["zoo"] = "zoo" + ml::core::CStringUtils::typeToString(j);
+                for (std::size_t k = 0; k < numberAnimals; ++k) {
+                    double value{10.0 + static_cast<double>((j + k) % 5) +
+                                 std::sin(static_cast<double>(i + j + k))};
+                    if (i == (4 * numberBuckets) / 5 && j == 1 && k == 7) {
+                        value += 50.0;
+                    }
+                    dataRows["animal"] = "animal" + ml::core::CStringUtils::typeToString(k);
+                    dataRows["value"] = ml::core::CStringUtils::typeToString(value);
+                    if (i > 0 && j == 0 && k == 0) {
+                        ml::core::CStopWatch stopWatch{true};
+                        CPPUNIT_ASSERT(job.handleRecord(dataRows));
+                        closeTimes.push_back(stopWatch.stop());
+                    } else {
+                        CPPUNIT_ASSERT(job.handleRecord(dataRows));
+                    }
+                }
+            }
+        }
+        job.finalise();
+    }
+
+    // The processing and log times are the only things which should differ.
+    return std::regex_replace(outputStrm.str(),
+                              std::regex{"\"(processing_time_ms|log_time)\":[0-9]+"}, "");
+}
 }
 
 using namespace ml;
 
+void CAnomalyJobTest::tearDown() {
+    // Jobs configure the test scheduler singleton.
+    maths::CTimeSeriesTestScheduler::instance().reset();
+}
+
 void CAnomalyJobTest::testBadTimes() {
     {
         // Test with no time field
@@ -1842,6 +1934,698 @@ void CAnomalyJobTest::testRestoreFailsWithEmptyStream() {
     CPPUNIT_ASSERT(job.restoreState(restoreSearcher, completeToTime) == false);
 }
 
+void CAnomalyJobTest::testParallelBucketFinalisation() {
+    // Check that sharing the bucket work over threads gives exactly the
+    // same output as processing it on one thread. There are just enough
+    // animals in each zoo that every detector's models are sampled in
+    // several shards.
+
+    std::size_t numberZoos{2};
+    std::size_t numberAnimals{300};
+    std::size_t numberBuckets{60};
+
+    std::vector<std::uint64_t> closeTimes;
+    std::string expected{runZooJob(1, numberZoos, numberAnimals, numberBuckets, closeTimes)};
+    CPPUNIT_ASSERT(expected.find("\"record_score\"") != std::string::npos);
+    CPPUNIT_ASSERT(expected.find("\"model_plot\"") != std::string::npos);
+
+    std::string actual{runZooJob(4, numberZoos, numberAnimals, numberBuckets, closeTimes)};
+    CPPUNIT_ASSERT_EQUAL(expected, actual);
+}
+
+void CAnomalyJobTest::testBucketFinalisationPerformance() {
+    // Log the time taken to close a bucket against the number of threads
+    // used to finalise it. This is too slow to run with the other tests.
+
+    std::size_t numberZoos{10};
+    std::size_t numberAnimals{500};
+    std::size_t numberBuckets{40};
+
+    std::vector<std::uint64_t> closeTimes;
+    std::uint64_t serial{0};
+    for (std::size_t numberThreads : {1, 2, 4, 8}) {
+        runZooJob(numberThreads, numberZoos, numberAnimals, numberBuckets, closeTimes);
+        CPPUNIT_ASSERT_EQUAL(numberBuckets - 1, closeTimes.size());
+        std::sort(closeTimes.begin(), closeTimes.end());
+        std::uint64_t total{std::accumulate(closeTimes.begin(), closeTimes.end(),
+                                            std::uint64_t{0})};
+        if (numberThreads == 1) {
+            serial = total;
+        }
+        LOG_DEBUG(<< numberThreads << " threads: mean close "
+                  << static_cast<double>(total) / static_cast<double>(closeTimes.size())
+                  << "ms, median close " << closeTimes[closeTimes.size() / 2]
+                  << "ms, max close " << closeTimes.back() << "ms, speedup "
+                  << static_cast<double>(serial) /
+                         static_cast<double>(std::max(total, std::uint64_t{1})));
+    }
+}
+
+void CAnomalyJobTest::testBinaryState() {
+    // Check that binary state restores to exactly the same models as JSON
+    // state and log the time taken to persist and restore a large job in
+    // each format.
+
+    core_t::TTime bucketSize = 600;
+    std::size_t numberPartitions = 100;
+    std::size_t numberBuckets = 300;
+
+    model::CLimits limits;
+    api::CFieldConfig fieldConfig;
+    api::CFieldConfig::TStrVec clauses{"mean(value)", "by", "animal", "partitionfield=zoo"};
+    fieldConfig.initFromClause(clauses);
+    model::CAnomalyDetectorModelConfig modelConfig =
+        model::CAnomalyDetectorModelConfig::defaultConfig(bucketSize);
+
+    std::stringstream outputStrm;
+    core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+
+    std::string snapshotId;
+    auto persistComplete = [&snapshotId](const api::CModelSnapshotJsonWriter::SModelSnapshotReport& report) {
+        snapshotId = report.s_SnapshotId;
+    };
+
+    auto persist = [&](api::CAnomalyJob& job, std::uint64_t& elapsed) {
+        std::ostringstream* strm{nullptr};
+        api::CSingleStreamDataAdder::TOStreamP ptr(strm = new std::ostringstream());
+        api::CSingleStreamDataAdder persister(ptr);
+        core::CStopWatch stopWatch{true};
+        CPPUNIT_ASSERT(job.persistState(persister));
+        elapsed = stopWatch.stop();
+        std::string state{strm->str()};
+        // The snapshot ID depends on the time of the persist.
+        CPPUNIT_ASSERT_EQUAL(std::size_t(1),
+                             core::CStringUtils::replaceFirst(snapshotId, "snap", state));
+        return state;
+    };
+    auto restore = [&](api::CAnomalyJob& job, const std::string& state, std::uint64_t& elapsed) {
+        auto strm = std::make_shared<boost::iostreams::filtering_istream>();
+        strm->push(api::CStateRestoreStreamFilter());
+        std::istringstream inputStream(state);
+        strm->push(inputStream);
+        api::CSingleStreamSearcher retriever(strm);
+        core_t::TTime completeToTime{0};
+        core::CStopWatch stopWatch{true};
+        CPPUNIT_ASSERT(job.restoreState(retriever, completeToTime));
+        elapsed = stopWatch.stop();
+        CPPUNIT_ASSERT(completeToTime > 0);
+    };
+
+    std::uint64_t elapsed;
+
+    api::CAnomalyJob origJob("job", limits, fieldConfig, modelConfig,
+                             wrappedOutputStream, persistComplete);
+    api::CAnomalyJob::TStrStrUMap dataRows;
+    for (std::size_t i = 0; i < numberBuckets; ++i) {
+        core_t::TTime time{static_cast<core_t::TTime>(i) * bucketSize};
+        dataRows["time"] = core::CStringUtils::typeToString(time + 1);
+        for (std::size_t j = 0; j < numberPartitions; ++j) {
+            dataRows["zoo"] = "zoo" + core::CStringUtils::typeToString(j);
+            for (const auto& animal : {"baboon", "shark"}) {
+                double value{10.0 + static_cast<double>(j % 5) +
+                             std::sin(static_cast<double>(i + j))};
+                dataRows["animal"] = animal;
+                dataRows["value"] = core::CStringUtils::typeToString(value);
+                CPPUNIT_ASSERT(origJob.handleRecord(dataRows));
+            }
+        }
+    }
+    std::string jsonState{persist(origJob, elapsed)};
+    LOG_DEBUG(<< "JSON persist took " << elapsed << "ms, size = " << jsonState.size());
+
+    api::CAnomalyJob binaryJob("job", limits, fieldConfig, modelConfig, wrappedOutputStream,
+                               persistComplete, nullptr, -1, "time", "", 0, 1, true);
+    restore(binaryJob, jsonState, elapsed);
+    LOG_DEBUG(<< "JSON restore took " << elapsed << "ms");
+    std::string binaryState{persist(binaryJob, elapsed)};
+    LOG_DEBUG(<< "Binary persist took " << elapsed << "ms, size = " << binaryState.size());
+
+    // The format is detected on restore.
+    api::CAnomalyJob restoredJob("job", limits, fieldConfig, modelConfig,
+                                 wrappedOutputStream, persistComplete);
+    restore(restoredJob, binaryState, elapsed);
+    LOG_DEBUG(<< "Binary restore took " << elapsed << "ms");
+    CPPUNIT_ASSERT_EQUAL(jsonState, persist(restoredJob, elapsed));
+}
+
+void CAnomalyJobTest::testConcurrentRestore() {
+    // Check that restoring detectors on a thread pool gives exactly the same
+    // models as restoring them serially, for both state formats, and log the
+    // time taken to restore with each number of threads.
+
+    core_t::TTime bucketSize = 600;
+    std::size_t numberPartitions = 200;
+    std::size_t numberBuckets = 300;
+
+    model::CLimits limits;
+    api::CFieldConfig fieldConfig;
+    api::CFieldConfig::TStrVec clauses{"mean(value)", "by", "animal", "partitionfield=zoo"};
+    fieldConfig.initFromClause(clauses);
+    model::CAnomalyDetectorModelConfig modelConfig =
+        model::CAnomalyDetectorModelConfig::defaultConfig(bucketSize);
+
+    std::stringstream outputStrm;
+    core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+
+    std::string snapshotId;
+    auto persistComplete = [&snapshotId](const api::CModelSnapshotJsonWriter::SModelSnapshotReport& report) {
+        snapshotId = report.s_SnapshotId;
+    };
+
+    auto persist = [&](api::CAnomalyJob& job) {
+        std::ostringstream* strm{nullptr};
+        api::CSingleStreamDataAdder::TOStreamP ptr(strm = new std::ostringstream());
+        api::CSingleStreamDataAdder persister(ptr);
+        CPPUNIT_ASSERT(job.persistState(persister));
+        std::string state{strm->str()};
+        // The snapshot ID depends on the time of the persist.
+        CPPUNIT_ASSERT_EQUAL(std::size_t(1),
+                             core::CStringUtils::replaceFirst(snapshotId, "snap", state));
+        return state;
+    };
+    auto restore = [&](api::CAnomalyJob& job, const std::string& state) {
+        auto strm = std::make_shared<boost::iostreams::filtering_istream>();
+        strm->push(api::CStateRestoreStreamFilter());
+        std::istringstream inputStream(state);
+        strm->push(inputStream);
+        api::CSingleStreamSearcher retriever(strm);
+        core_t::TTime completeToTime{0};
+        core::CStopWatch stopWatch{true};
+        CPPUNIT_ASSERT(job.restoreState(retriever, completeToTime));
+        std::uint64_t elapsed{stopWatch.stop()};
+        CPPUNIT_ASSERT(completeToTime > 0);
+        return elapsed;
+    };
+
+    model::CLimits origLimits;
+    api::CAnomalyJob origJob("job", origLimits, fieldConfig, modelConfig,
+                             wrappedOutputStream, persistComplete);
+    api::CAnomalyJob::TStrStrUMap dataRows;
+    for (std::size_t i = 0; i < numberBuckets; ++i) {
+        core_t::TTime time{static_cast<core_t::TTime>(i) * bucketSize};
+        dataRows["time"] = core::CStringUtils::typeToString(time + 1);
+        for (std::size_t j = 0; j < numberPartitions; ++j) {
+            dataRows["zoo"] = "zoo" + core::CStringUtils::typeToString(j);
+            for (const auto& animal : {"baboon", "shark"}) {
+                double value{10.0 + static_cast<double>(j % 5) +
+                             std::sin(static_cast<double>(i + j))};
+                dataRows["animal"] = animal;
+                dataRows["value"] = core::CStringUtils::typeToString(value);
+                CPPUNIT_ASSERT(origJob.handleRecord(dataRows));
+            }
+        }
+    }
+    std::string jsonState{persist(origJob)};
+    std::size_t origMemoryUsage{origLimits.resourceMonitor().createMemoryUsageReport(0).s_Usage};
+
+    api::CAnomalyJob binaryJob("job", limits, fieldConfig, modelConfig, wrappedOutputStream,
+                               persistComplete, nullptr, -1, "time", "", 0, 1, true);
+    restore(binaryJob, jsonState);
+    std::string binaryState{persist(binaryJob)};
+
+    for (const auto& format : {std::make_pair("JSON", &jsonState),
+                               std::make_pair("Binary", &binaryState)}) {
+        const std::string& state{*format.second};
+        for (std::size_t numberThreads : {1, 4}) {
+            model::CLimits jobLimits;
+            api::CAnomalyJob job("job", jobLimits, fieldConfig, modelConfig,
+                                 wrappedOutputStream, persistComplete, nullptr,
+                                 -1, "time", "", 0, numberThreads);
+            std::uint64_t elapsed{restore(job, state)};
+            LOG_DEBUG(<< format.first << " restore of "
+                      << state.size() << " bytes using " << numberThreads
+                      << " threads took " << elapsed << "ms");
+
+            if (numberThreads > 1) {
+                // Each detector's memory is counted once it's restored and
+                // the copies of the state waiting to be restored aren't.
+                std::size_t memoryUsage{
+                    jobLimits.resourceMonitor().createMemoryUsageReport(0).s_Usage};
+                LOG_DEBUG(<< "memory usage = " << memoryUsage
+                          << ", original memory usage = " << origMemoryUsage);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(static_cast<double>(origMemoryUsage),
+                                             static_cast<double>(memoryUsage),
+                                             0.02 * static_cast<double>(origMemoryUsage));
+            }
+            CPPUNIT_ASSERT_EQUAL(jsonState, persist(job));
+        }
+    }
+}
+
+void CAnomalyJobTest::testRecordViewThroughput() {
+    // Check that addressing record fields by index gives exactly the same
+    // output as looking them up in a map and log the records per second
+    // handled end-to-end by CCmdSkeleton::ioLoop for each.
+
+    core_t::TTime bucketSize = 600;
+    std::size_t numberPartitions = 20;
+    std::size_t numberBuckets = 500;
+
+    std::ostringstream input;
+    input << "time,zoo,animal,value\n";
+    for (std::size_t i = 0; i < numberBuckets; ++i) {
+        core_t::TTime time{static_cast<core_t::TTime>(i) * bucketSize};
+        for (std::size_t j = 0; j < numberPartitions; ++j) {
+            for (const auto& animal : {"baboon", "shark"}) {
+                double value{10.0 + static_cast<double>(j % 5) +
+                             std::sin(static_cast<double>(i + j))};
+                input << time + 1 << ",zoo" << j << ',' << animal << ','
+                      << core::CStringUtils::typeToString(value) << '\n';
+            }
+        }
+    }
+    std::size_t numberRecords{numberBuckets * numberPartitions * 2};
+
+    auto runJob = [&](bool byIndex, std::uint64_t& elapsed) {
+        model::CLimits limits;
+        api::CFieldConfig fieldConfig;
+        api::CFieldConfig::TStrVec clauses{"mean(value)", "by", "animal",
+                                           "partitionfield=zoo"};
+        fieldConfig.initFromClause(clauses);
+
+        model::CAnomalyDetectorModelConfig modelConfig =
+            model::CAnomalyDetectorModelConfig::defaultConfig(bucketSize);
+
+        std::stringstream outputStrm;
+        {
+            core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+
+            api::CAnomalyJob job("job", limits, fieldConfig, modelConfig, wrappedOutputStream);
+
+            std::istringstream inputStrm{input.str()};
+            api::CCsvInputParser parser(inputStrm);
+
+            core::CStopWatch stopWatch{true};
+            if (byIndex) {
+                api::CCmdSkeleton skeleton(nullptr, nullptr, parser, job);
+                CPPUNIT_ASSERT(skeleton.ioLoop());
+            } else {
+                CPPUNIT_ASSERT(parser.readStream(
+                    [&job](const api::CAnomalyJob::TStrStrUMap& dataRowFields) {
+                        return job.handleRecord(dataRowFields);
+                    }));
+                job.finalise();
+            }
+            elapsed = stopWatch.stop();
+            CPPUNIT_ASSERT_EQUAL(numberRecords, static_cast<std::size_t>(job.numRecordsHandled()));
+        }
+
+        // The processing and log times are the only things which should differ.
+        return std::regex_replace(
+            outputStrm.str(), std::regex{"\"(processing_time_ms|log_time)\":[0-9]+"}, "");
+    };
+
+    std::uint64_t elapsed;
+    std::string expected{runJob(false, elapsed)};
+    LOG_DEBUG(<< "By name handled "
+              << 1000.0 * static_cast<double>(numberRecords) /
+                     static_cast<double>(std::max(elapsed, std::uint64_t{1}))
+              << " records/s");
+    CPPUNIT_ASSERT(expected.find("\"bucket\"") != std::string::npos);
+
+    std::string actual{runJob(true, elapsed)};
+    LOG_DEBUG(<< "By index handled "
+              << 1000.0 * static_cast<double>(numberRecords) /
+                     static_cast<double>(std::max(elapsed, std::uint64_t{1}))
+              << " records/s");
+    CPPUNIT_ASSERT_EQUAL(expected, actual);
+}
+
+void CAnomalyJobTest::testPipelinedInput() {
+    // Check that parsing input on a separate thread gives exactly the same
+    // output as parsing it on the processing thread, including the order
+    // in which control messages are acknowledged relative to the results.
+
+    core_t::TTime bucketSize = 600;
+    std::size_t numberPartitions = 10;
+    std::size_t numberBuckets = 300;
+    std::size_t flushInterval = 37;
+
+    std::ostringstream input;
+    input << "time,zoo,animal,value,.\n";
+    std::size_t numberRecords{0};
+    std::size_t numberFlushes{0};
+    for (std::size_t i = 0; i < numberBuckets; ++i) {
+        core_t::TTime time{static_cast<core_t::TTime>(i) * bucketSize};
+        for (std::size_t j = 0; j < numberPartitions; ++j) {
+            for (const auto& animal : {"baboon", "shark"}) {
+                double value{10.0 + static_cast<double>(j % 5) +
+                             std::sin(static_cast<double>(i + j))};
+                input << time + 1 << ",zoo" << j << ',' << animal << ','
+                      << core::CStringUtils::typeToString(value) << ",\n";
+                ++numberRecords;
+            }
+        }
+        if (i % flushInterval == 0) {
+            input << ",,,,f" << numberFlushes++ << '\n';
+        }
+    }
+
+    auto runJob = [&](bool pipelineInput, std::uint64_t& elapsed) {
+        model::CLimits limits;
+        api::CFieldConfig fieldConfig;
+        api::CFieldConfig::TStrVec clauses{"mean(value)", "by", "animal",
+                                           "partitionfield=zoo"};
+        fieldConfig.initFromClause(clauses);
+
+        model::CAnomalyDetectorModelConfig modelConfig =
+            model::CAnomalyDetectorModelConfig::defaultConfig(bucketSize);
+
+        std::stringstream outputStrm;
+        {
+            core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+
+            api::CAnomalyJob job("job", limits, fieldConfig, modelConfig, wrappedOutputStream);
+
+            std::istringstream inputStrm{input.str()};
+            api::CCsvInputParser parser(inputStrm);
+
+            core::CStopWatch stopWatch{true};
+            api::CCmdSkeleton skeleton(nullptr, nullptr, parser, job, pipelineInput);
+            CPPUNIT_ASSERT(skeleton.ioLoop());
+            elapsed = stopWatch.stop();
+            CPPUNIT_ASSERT_EQUAL(numberRecords, static_cast<std::size_t>(job.numRecordsHandled()));
+        }
+
+        return std::regex_replace(
+            outputStrm.str(), std::regex{"\"(processing_time_ms|log_time)\":[0-9]+"}, "");
+    };
+
+    std::uint64_t elapsed;
+    std::string expected{runJob(false, elapsed)};
+    LOG_DEBUG(<< "Serial input handled "
+              << 1000.0 * static_cast<double>(numberRecords) /
+                     static_cast<double>(std::max(elapsed, std::uint64_t{1}))
+              << " records/s");
+
+    // Every flush is acknowledged and in order.
+    std::size_t last{0};
+    for (std::size_t i = 0; i < numberFlushes; ++i) {
+        std::string id{"\"id\":\"" + core::CStringUtils::typeToString(i) + "\""};
+        std::size_t pos{expected.find(id, last)};
+        CPPUNIT_ASSERT(pos != std::string::npos);
+        last = pos;
+    }
+
+    std::uint64_t numberBatches{core::CStatistics::stat(stat_t::E_NumberInputBatches).value()};
+    std::string actual{runJob(true, elapsed)};
+    LOG_DEBUG(<< "Pipelined input handled "
+              << 1000.0 * static_cast<double>(numberRecords) /
+                     static_cast<double>(std::max(elapsed, std::uint64_t{1}))
+              << " records/s");
+    CPPUNIT_ASSERT_EQUAL(expected, actual);
+
+    // Each flush ends a batch so there must be at least one batch per flush.
+    numberBatches = core::CStatistics::stat(stat_t::E_NumberInputBatches).value() - numberBatches;
+    LOG_DEBUG(<< "Number batches = " << numberBatches);
+    CPPUNIT_ASSERT(numberBatches >= numberFlushes);
+}
+
+void CAnomalyJobTest::testMultiDetectorThroughput() {
+    // Check that every detector of a job with many detectors over several
+    // partition fields sees its records and log the records per second it
+    // handles.
+
+    core_t::TTime bucketSize = 600;
+    std::size_t numberPartitions = 10;
+    std::size_t numberRegions = 3;
+    std::size_t numberBuckets = 300;
+
+    // Five functions for each of four combinations of partition and by
+    // fields gives twenty detectors.
+    api::CFieldConfig fieldConfig;
+    int configKey{0};
+    for (const auto& fields : {std::make_pair("zoo", "animal"), std::make_pair("region", "animal"),
+                               std::make_pair("zoo", ""), std::make_pair("", "animal")}) {
+        for (auto function : {model::function_t::E_IndividualMetricMean,
+                              model::function_t::E_IndividualMetricMax,
+                              model::function_t::E_IndividualMetricSum,
+                              model::function_t::E_IndividualMetricHighMean,
+                              model::function_t::E_IndividualMetricHighSum}) {
+            CPPUNIT_ASSERT(fieldConfig.addOptions(api::CFieldConfig::CFieldOptions(
+                function, "value", configKey++, fields.second, "", fields.first,
+                false, false, false)));
+        }
+    }
+
+    std::ostringstream input;
+    input << "time,zoo,region,animal,value\n";
+    for (std::size_t i = 0; i < numberBuckets; ++i) {
+        core_t::TTime time{static_cast<core_t::TTime>(i) * bucketSize};
+        for (std::size_t j = 0; j < numberPartitions; ++j) {
+            for (const auto& animal : {"baboon", "shark"}) {
+                double value{10.0 + static_cast<double>(j % 5) +
+                             std::sin(static_cast<double>(i + j))};
+                if (i == 250 && j == 7) {
+                    value += 100.0;
+                }
+                input << time + 1 << ",zoo" << j << ",region" << j % numberRegions
+                      << ',' << animal << ',' << core::CStringUtils::typeToString(value)
+                      << '\n';
+            }
+        }
+    }
+    std::size_t numberRecords{numberBuckets * numberPartitions * 2};
+
+    model::CLimits limits;
+    model::CAnomalyDetectorModelConfig modelConfig =
+        model::CAnomalyDetectorModelConfig::defaultConfig(bucketSize);
+
+    std::stringstream outputStrm;
+    std::uint64_t elapsed;
+    {
+        core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+
+        api::CAnomalyJob job("job", limits, fieldConfig, modelConfig, wrappedOutputStream);
+
+        std::istringstream inputStrm{input.str()};
+        api::CCsvInputParser parser(inputStrm);
+        api::CCmdSkeleton skeleton(nullptr, nullptr, parser, job);
+
+        core::CStopWatch stopWatch{true};
+        CPPUNIT_ASSERT(skeleton.ioLoop());
+        elapsed = stopWatch.stop();
+        CPPUNIT_ASSERT_EQUAL(numberRecords, static_cast<std::size_t>(job.numRecordsHandled()));
+    }
+    LOG_DEBUG(<< configKey << " detectors handled "
+              << 1000.0 * static_cast<double>(numberRecords) /
+                     static_cast<double>(std::max(elapsed, std::uint64_t{1}))
+              << " records/s");
+
+    // Every detector should find the anomaly.
+    std::string output{outputStrm.str()};
+    for (int i = 0; i < configKey; ++i) {
+        std::string detectorIndex{"\"detector_index\":" +
+                                  core::CStringUtils::typeToString(i) + ","};
+        CPPUNIT_ASSERT(output.find(detectorIndex) != std::string::npos);
+    }
+}
+
+void CAnomalyJobTest::testPartitionRouteCache() {
+    // Check that caching the detectors of each partition field value gives
+    // exactly the same output as looking them up for every record, including
+    // when the cache is too small for all the values, and that the cache is
+    // bounded and emptied when the models are pruned.
+
+    core_t::TTime bucketSize = 600;
+    std::size_t numberPartitions = 20;
+    std::size_t numberRegions = 3;
+    std::size_t numberBuckets = 200;
+
+    std::ostringstream input;
+    input << "time,zoo,region,animal,value\n";
+    for (std::size_t i = 0; i < numberBuckets; ++i) {
+        core_t::TTime time{static_cast<core_t::TTime>(i) * bucketSize};
+        for (std::size_t j = 0; j < numberPartitions; ++j) {
+            for (const auto& animal : {"baboon", "shark"}) {
+                double value{10.0 + static_cast<double>(j % 5) +
+                             std::sin(static_cast<double>(i + j))};
+                if (i == 150 && j == 7) {
+                    value += 100.0;
+                }
+                input << time + 1 << ",zoo" << j << ",region" << j % numberRegions
+                      << ',' << animal << ',' << core::CStringUtils::typeToString(value)
+                      << '\n';
+            }
+        }
+    }
+    std::size_t numberRecords{numberBuckets * numberPartitions * 2};
+
+    auto runJob = [&](std::size_t maxCachedPartitionValues) {
+        model::CLimits limits;
+        api::CFieldConfig fieldConfig;
+        int configKey{0};
+        for (const auto& fields : {std::make_pair("zoo", "animal"),
+                                   std::make_pair("region", "animal"),
+                                   std::make_pair("zoo", ""), std::make_pair("", "animal")}) {
+            CPPUNIT_ASSERT(fieldConfig.addOptions(api::CFieldConfig::CFieldOptions(
+                model::function_t::E_IndividualMetricMean, "value", configKey++,
+                fields.second, "", fields.first, false, false, false)));
+        }
+
+        model::CAnomalyDetectorModelConfig modelConfig =
+            model::CAnomalyDetectorModelConfig::defaultConfig(bucketSize);
+
+        std::stringstream outputStrm;
+        {
+            core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+
+            api::CAnomalyJob job("job", limits, fieldConfig, modelConfig, wrappedOutputStream);
+            job.m_MaxCachedPartitionValues = maxCachedPartitionValues;
+
+            std::istringstream inputStrm{input.str()};
+            api::CCsvInputParser parser(inputStrm);
+            CPPUNIT_ASSERT(parser.readStream(
+                [&job](const api::CAnomalyJob::TStrStrUMap& dataRowFields) {
+                    return job.handleRecord(dataRowFields);
+                }));
+            CPPUNIT_ASSERT_EQUAL(numberRecords, static_cast<std::size_t>(job.numRecordsHandled()));
+
+            for (const auto& route : job.m_PartitionRoutes) {
+                CPPUNIT_ASSERT(route.s_Detectors.size() <= maxCachedPartitionValues);
+            }
+            job.finalise();
+            for (const auto& route : job.m_PartitionRoutes) {
+                CPPUNIT_ASSERT(route.s_Detectors.empty());
+            }
+        }
+
+        // The processing and log times are the only things which should differ.
+        return std::regex_replace(
+            outputStrm.str(), std::regex{"\"(processing_time_ms|log_time)\":[0-9]+"}, "");
+    };
+
+    std::string uncached{runJob(0)};
+    CPPUNIT_ASSERT(uncached.find("\"bucket\"") != std::string::npos);
+
+    std::string cached{runJob(api::CAnomalyJob::MAX_CACHED_PARTITION_VALUES)};
+    CPPUNIT_ASSERT_EQUAL(uncached, cached);
+
+    std::string bounded{runJob(numberPartitions / 4)};
+    CPPUNIT_ASSERT_EQUAL(uncached, bounded);
+}
+
+void CAnomalyJobTest::testRecordBatching() {
+    // Check that holding records to add them to the detectors in batches
+    // gives the same results as adding each one as it arrives, including
+    // when the memory limit is reached and when the partition routes don't
+    // cache detectors, and log the records per second.
+
+    core_t::TTime bucketSize = 600;
+    std::size_t numberPartitions = 10;
+    std::size_t numberBuckets = 200;
+
+    api::CFieldConfig fieldConfig;
+    int configKey{0};
+    for (const auto& fields : {std::make_pair("zoo", "animal"), std::make_pair("zoo", ""),
+                               std::make_pair("", "animal")}) {
+        for (auto function : {model::function_t::E_IndividualMetricMean,
+                              model::function_t::E_IndividualMetricMax,
+                              model::function_t::E_IndividualMetricHighSum}) {
+            CPPUNIT_ASSERT(fieldConfig.addOptions(api::CFieldConfig::CFieldOptions(
+                function, "value", configKey++, fields.second, "", fields.first,
+                false, false, false)));
+        }
+    }
+    CPPUNIT_ASSERT(fieldConfig.addOptions(api::CFieldConfig::CFieldOptions(
+        model::function_t::E_PopulationCount, "", configKey++, "", "animal", "",
+        false, false, false)));
+
+    // New zoos keep arriving, so a small memory limit is eventually reached,
+    // and some records are missing fields.
+    std::ostringstream input;
+    input << "time,zoo,animal,value\n";
+    for (std::size_t i = 0; i < numberBuckets; ++i) {
+        core_t::TTime time{static_cast<core_t::TTime>(i) * bucketSize};
+        for (std::size_t j = 0; j < numberPartitions; ++j) {
+            std::size_t zoo{j + numberPartitions * (i / 20)};
+            for (const auto& animal : {"baboon", "shark", ""}) {
+                double value{10.0 + static_cast<double>(j % 5) +
+                             std::sin(static_cast<double>(i + j))};
+                if (i == 150 && j == 7) {
+                    value += 100.0;
+                }
+                input << time + static_cast<core_t::TTime>(10 * j) << ",zoo" << zoo
+                      << ',' << animal << ','
+                      << (i % 7 == j ? "" : core::CStringUtils::typeToString(value))
+                      << '\n';
+            }
+        }
+    }
+    std::size_t numberRecords{numberBuckets * numberPartitions * 3};
+
+    auto run = [&](std::size_t recordBatchSize, std::size_t memoryLimit,
+                   bool cachePartitionRoutes) {
+        // The string stores are shared by all jobs and count towards their
+        // memory, so they must start each run in the same state.
+        model::CStringStore::tidyUpNotThreadSafe();
+
+        model::CLimits limits;
+        if (memoryLimit > 0) {
+            limits.resourceMonitor().memoryLimit(memoryLimit);
+        }
+        model::CAnomalyDetectorModelConfig modelConfig =
+            model::CAnomalyDetectorModelConfig::defaultConfig(bucketSize);
+
+        std::stringstream outputStrm;
+        std::uint64_t elapsed;
+        {
+            core::CJsonOutputStreamWrapper wrappedOutputStream(outputStrm);
+
+            api::CAnomalyJob job("job", limits, fieldConfig, modelConfig,
+                                 wrappedOutputStream, api::CAnomalyJob::TPersistCompleteFunc(),
+                                 nullptr, -1, "time", "", 0, 1, false, recordBatchSize);
+            if (cachePartitionRoutes == false) {
+                job.m_MaxCachedPartitionValues = 0;
+            }
+
+            std::istringstream inputStrm{input.str()};
+            api::CCsvInputParser parser(inputStrm);
+            api::CCmdSkeleton skeleton(nullptr, nullptr, parser, job);
+
+            core::CStopWatch stopWatch{true};
+            CPPUNIT_ASSERT(skeleton.ioLoop());
+            elapsed = stopWatch.stop();
+            CPPUNIT_ASSERT_EQUAL(numberRecords,
+                                 static_cast<std::size_t>(job.numRecordsHandled()));
+        }
+        LOG_DEBUG(<< "batch size " << recordBatchSize << " handled "
+                  << 1000.0 * static_cast<double>(numberRecords) /
+                         static_cast<double>(std::max(elapsed, std::uint64_t{1}))
+                  << " records/s");
+
+        // Remove the fields which depend on the wall clock or earlier jobs.
+        std::string output{outputStrm.str()};
+        for (const auto& field : {"\"processing_time_ms\":", "\"log_time\":",
+                                  "\"seasonality_test_time_ms\":",
+                                  "\"deferred_seasonality_tests_count\":"}) {
+            std::size_t length{std::strlen(field)};
+            for (std::size_t i = output.find(field); i != std::string::npos;
+                 i = output.find(field, i)) {
+                output.erase(i, output.find_first_not_of("0123456789", i + length) - i);
+            }
+        }
+        return output;
+    };
+
+    // Fill the string stores so their capacity is the same for every run.
+    CPPUNIT_ASSERT(run(1, 0, true).find("\"detector_index\":") != std::string::npos);
+
+    for (std::size_t memoryLimit : {0, 4}) {
+        LOG_DEBUG(<< "memory limit = " << memoryLimit << "MB");
+        std::string expected{run(1, memoryLimit, true)};
+        for (std::size_t recordBatchSize : {7, 256}) {
+            std::string actual{run(recordBatchSize, memoryLimit, true)};
+            CPPUNIT_ASSERT_EQUAL(expected, actual);
+        }
+        CPPUNIT_ASSERT_EQUAL(expected, run(7, memoryLimit, false));
+        if (memoryLimit > 0) {
+            CPPUNIT_ASSERT(expected.find("\"memory_status\":\"hard_limit\"") !=
+                           std::string::npos);
+        }
+    }
+}
+
 CppUnit::Test* CAnomalyJobTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CAnomalyJobTest");
 
@@ -1866,5 +2650,27 @@ CppUnit::Test* CAnomalyJobTest::suite() {
     suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
         "CAnomalyJobTest::testRestoreFailsWithEmptyStream",
         &CAnomalyJobTest::testRestoreFailsWithEmptyStream));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
+        "CAnomalyJobTest::testParallelBucketFinalisation",
+        &CAnomalyJobTest::testParallelBucketFinalisation));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
+        "CAnomalyJobTest::testBinaryState", &CAnomalyJobTest::testBinaryState));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
+        "CAnomalyJobTest::testConcurrentRestore", &CAnomalyJobTest::testConcurrentRestore));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
+        "CAnomalyJobTest::testRecordViewThroughput",
+        &CAnomalyJobTest::testRecordViewThroughput));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
+        "CAnomalyJobTest::testPipelinedInput", &CAnomalyJobTest::testPipelinedInput));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
+        "CAnomalyJobTest::testMultiDetectorThroughput",
+        &CAnomalyJobTest::testMultiDetectorThroughput));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
+        "CAnomalyJobTest::testPartitionRouteCache", &CAnomalyJobTest::testPartitionRouteCache));
+    //suiteOfTests->addTest( new CppUnit::TestCaller<CAnomalyJobTest>(
+    //                               "CAnomalyJobTest::testBucketFinalisationPerformance",
+    //                               &CAnomalyJobTest::testBucketFinalisationPerformance) );
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyJobTest>(
+        "CAnomalyJobTest::testRecordBatching", &CAnomalyJobTest::testRecordBatching));
     return suiteOfTests;
 }
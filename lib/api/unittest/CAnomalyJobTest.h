@@ -22,6 +22,17 @@ public:
     void testModelPlot();
     void testInterimResultEdgeCases();
     void testRestoreFailsWithEmptyStream();
+    void testParallelBucketFinalisation();
+    void testBucketFinalisationPerformance();
+    void testBinaryState();
+    void testConcurrentRestore();
+    void testRecordViewThroughput();
+    void testPipelinedInput();
+    void testMultiDetectorThroughput();
+    void testPartitionRouteCache();
+    void testRecordBatching();
+
+    void tearDown();
 
     static CppUnit::Test* suite();
 };
@@ -16,10 +16,14 @@
 #include <api/CFieldConfig.h>
 
 #include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
 
+#include <algorithm>
 #include <cmath>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace {
 
@@ -356,6 +360,100 @@ void CForecastRunnerTest::testValidateMissingId() {
                        message, forecastJob, 1400000000) == false);
 }
 
+void CForecastRunnerTest::testParallelForecast() {
+    LOG_INFO(<< "*** test forecast using multiple threads ***");
+
+    // Forecasting the models on several threads must write exactly the
+    // same forecast records, possibly in a different order, and report
+    // increasing progress.
+
+    std::size_t numberBuckets{500};
+    std::size_t numberSeries{20};
+
+    auto forecast = [&](std::size_t numberThreads) {
+        std::stringstream outputStrm;
+        {
+            ml::core::CJsonOutputStreamWrapper streamWrapper(outputStrm);
+            ml::model::CLimits limits;
+            ml::api::CFieldConfig fieldConfig;
+            ml::api::CFieldConfig::TStrVec clauses{"mean(value)", "by", "animal"};
+            fieldConfig.initFromClause(clauses);
+            ml::model::CAnomalyDetectorModelConfig modelConfig =
+                ml::model::CAnomalyDetectorModelConfig::defaultConfig(BUCKET_LENGTH);
+
+            ml::api::CAnomalyJob job(
+                "job", limits, fieldConfig, modelConfig, streamWrapper,
+                ml::api::CAnomalyJob::TPersistCompleteFunc(), nullptr, -1,
+                ml::api::CAnomalyJob::DEFAULT_TIME_FIELD_NAME,
+                ml::api::CAnomalyJob::EMPTY_STRING, 0, numberThreads);
+
+            ml::api::CAnomalyJob::TStrStrUMap dataRows;
+            for (std::size_t i = 0; i < numberBuckets; ++i) {
+                ml::core_t::TTime time{START_TIME + static_cast<ml::core_t::TTime>(i) * BUCKET_LENGTH};
+                for (std::size_t j = 0; j < numberSeries; ++j) {
+                    double value{static_cast<double>(j) +
+                                 std::sin(static_cast<double>(i) / 4.0 + static_cast<double>(j))};
+                    dataRows["time"] = ml::core::CStringUtils::typeToString(time);
+                    dataRows["animal"] = "animal" + std::to_string(j);
+                    dataRows["value"] = ml::core::CStringUtils::typeToString(value);
+                    CPPUNIT_ASSERT(job.handleRecord(dataRows));
+                }
+            }
+
+            dataRows.clear();
+            dataRows["."] = "p{\"duration\":" + std::to_string(50 * BUCKET_LENGTH) +
+                            ",\"forecast_id\": \"42\"" +
+                            ",\"create_time\": \"1511370819\" }";
+            CPPUNIT_ASSERT(job.handleRecord(dataRows));
+        }
+        return outputStrm.str();
+    };
+
+    auto forecastRecords = [](const std::string& output, double& lastProgress,
+                              int& processedRecordCount) {
+        rapidjson::Document doc;
+        doc.Parse<rapidjson::kParseDefaultFlags>(output);
+        CPPUNIT_ASSERT(!doc.HasParseError());
+
+        std::vector<std::string> result;
+        lastProgress = 0.0;
+        for (const auto& m : doc.GetArray()) {
+            if (m.HasMember("model_forecast")) {
+                rapidjson::StringBuffer buffer;
+                rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+                m["model_forecast"].Accept(writer);
+                result.emplace_back(buffer.GetString());
+            } else if (m.HasMember("model_forecast_request_stats")) {
+                const rapidjson::Value& stats = m["model_forecast_request_stats"];
+                if (stats.HasMember("forecast_progress")) {
+                    double progress{stats["forecast_progress"].GetDouble()};
+                    CPPUNIT_ASSERT(progress >= lastProgress);
+                    lastProgress = progress;
+                }
+                if (stats.HasMember("processed_record_count")) {
+                    processedRecordCount = stats["processed_record_count"].GetInt();
+                }
+            }
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    };
+
+    double lastProgress;
+    int processedRecordCount{0};
+    std::vector<std::string> expected{
+        forecastRecords(forecast(1), lastProgress, processedRecordCount)};
+    CPPUNIT_ASSERT_EQUAL(1.0, lastProgress);
+    CPPUNIT_ASSERT(expected.empty() == false);
+    CPPUNIT_ASSERT_EQUAL(static_cast<int>(expected.size()), processedRecordCount);
+
+    std::vector<std::string> actual{
+        forecastRecords(forecast(4), lastProgress, processedRecordCount)};
+    CPPUNIT_ASSERT_EQUAL(1.0, lastProgress);
+    CPPUNIT_ASSERT_EQUAL(static_cast<int>(actual.size()), processedRecordCount);
+    CPPUNIT_ASSERT(expected == actual);
+}
+
 CppUnit::Test* CForecastRunnerTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CForecastRunnerTest");
 
@@ -381,6 +479,8 @@ CppUnit::Test* CForecastRunnerTest::suite() {
         "CForecastRunnerTest::testBrokenMessage", &CForecastRunnerTest::testValidateBrokenMessage));
     suiteOfTests->addTest(new CppUnit::TestCaller<CForecastRunnerTest>(
         "CForecastRunnerTest::testMissingId", &CForecastRunnerTest::testValidateMissingId));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CForecastRunnerTest>(
+        "CForecastRunnerTest::testParallelForecast", &CForecastRunnerTest::testParallelForecast));
 
     return suiteOfTests;
 }
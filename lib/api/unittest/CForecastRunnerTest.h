@@ -25,6 +25,7 @@ public:
     void testValidateInvalidExpiry();
     void testValidateBrokenMessage();
     void testValidateMissingId();
+    void testParallelForecast();
 
     static CppUnit::Test* suite();
 };
@@ -1561,6 +1561,8 @@ void CJsonOutputWriterTest::testReportMemoryUsage() {
         resourceUsage.s_AllocationFailures = 5;
         resourceUsage.s_MemoryStatus = ml::model_t::E_MemoryStatusHardLimit;
         resourceUsage.s_BucketStartTime = 6;
+        resourceUsage.s_DeferredSeasonalityTests = 7;
+        resourceUsage.s_SeasonalityTestTime = 8;
 
         writer.reportMemoryUsage(resourceUsage);
         writer.endOutputBatch(false, 1ul);
@@ -1587,6 +1589,10 @@ void CJsonOutputWriterTest::testReportMemoryUsage() {
     CPPUNIT_ASSERT_EQUAL(4, sizeStats["total_over_field_count"].GetInt());
     CPPUNIT_ASSERT(sizeStats.HasMember("bucket_allocation_failures_count"));
     CPPUNIT_ASSERT_EQUAL(5, sizeStats["bucket_allocation_failures_count"].GetInt());
+    CPPUNIT_ASSERT(sizeStats.HasMember("deferred_seasonality_tests_count"));
+    CPPUNIT_ASSERT_EQUAL(7, sizeStats["deferred_seasonality_tests_count"].GetInt());
+    CPPUNIT_ASSERT(sizeStats.HasMember("seasonality_test_time_ms"));
+    CPPUNIT_ASSERT_EQUAL(8, sizeStats["seasonality_test_time_ms"].GetInt());
     CPPUNIT_ASSERT(sizeStats.HasMember("timestamp"));
     CPPUNIT_ASSERT_EQUAL(6000, sizeStats["timestamp"].GetInt());
     CPPUNIT_ASSERT(sizeStats.HasMember("memory_status"));
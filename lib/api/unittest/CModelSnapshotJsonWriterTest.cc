@@ -38,7 +38,9 @@ void CModelSnapshotJsonWriterTest::testWrite() {
             150,                       // # over fields
             4,                         // # allocation failures
             model_t::E_MemoryStatusOk, // memory status
-            core_t::TTime(1521046309)  // bucket start time
+            core_t::TTime(1521046309), // bucket start time
+            2,                         // # deferred seasonality tests
+            35                         // seasonality test time
         };
 
         CModelSnapshotJsonWriter::SModelSnapshotReport report{
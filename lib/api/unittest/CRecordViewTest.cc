@@ -0,0 +1,173 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include "CRecordViewTest.h"
+
+#include <core/CLogger.h>
+
+#include <api/CCsvInputParser.h>
+#include <api/CLineifiedJsonInputParser.h>
+#include <api/CRecordView.h>
+
+#include <sstream>
+
+CppUnit::Test* CRecordViewTest::suite() {
+    CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CRecordViewTest");
+
+    suiteOfTests->addTest(new CppUnit::TestCaller<CRecordViewTest>(
+        "CRecordViewTest::testFieldLookup", &CRecordViewTest::testFieldLookup));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CRecordViewTest>(
+        "CRecordViewTest::testFieldIndices", &CRecordViewTest::testFieldIndices));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CRecordViewTest>(
+        "CRecordViewTest::testParserViews", &CRecordViewTest::testParserViews));
+
+    return suiteOfTests;
+}
+
+using namespace ml;
+using TStrVec = api::CRecordView::TStrVec;
+using TStrStrUMap = api::CRecordView::TStrStrUMap;
+using TStrRefVec = api::CRecordView::TStrRefVec;
+
+namespace {
+
+void makeRecord(const TStrVec& fieldNames, TStrStrUMap& fieldMap, TStrRefVec& fieldValues) {
+    fieldMap.clear();
+    fieldValues.clear();
+    for (const auto& fieldName : fieldNames) {
+        fieldValues.push_back(boost::ref(fieldMap[fieldName]));
+    }
+}
+}
+
+void CRecordViewTest::testFieldLookup() {
+    TStrVec fieldNames{"time", "airline", "responsetime"};
+    TStrStrUMap fieldMap;
+    TStrRefVec fieldValues;
+    makeRecord(fieldNames, fieldMap, fieldValues);
+    fieldMap["time"] = "1000";
+    fieldMap["airline"] = "AAL";
+    fieldMap["responsetime"] = "132.2";
+
+    api::CRecordView indexed(api::CRecordView::newGeneration(), fieldNames,
+                             fieldValues, fieldMap);
+    CPPUNIT_ASSERT(indexed.indexed());
+    CPPUNIT_ASSERT_EQUAL(fieldNames.size(), indexed.fieldNames().size());
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1), indexed.fieldIndex("airline"));
+    CPPUNIT_ASSERT_EQUAL(api::CRecordView::NOT_FOUND, indexed.fieldIndex("missing"));
+    CPPUNIT_ASSERT_EQUAL(std::string("AAL"), *indexed.fieldValue(std::size_t(1)));
+    CPPUNIT_ASSERT(&fieldMap["responsetime"] == indexed.fieldValue(std::size_t(2)));
+    CPPUNIT_ASSERT(indexed.fieldValue(api::CRecordView::NOT_FOUND) == nullptr);
+    CPPUNIT_ASSERT_EQUAL(std::string("1000"), *indexed.fieldValue(std::string("time")));
+    CPPUNIT_ASSERT(indexed.fieldValue(std::string("missing")) == nullptr);
+
+    api::CRecordView unindexed(fieldMap);
+    CPPUNIT_ASSERT(!unindexed.indexed());
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), unindexed.generation());
+    CPPUNIT_ASSERT(unindexed.fieldNames().empty());
+    CPPUNIT_ASSERT_EQUAL(api::CRecordView::NOT_FOUND, unindexed.fieldIndex("airline"));
+    CPPUNIT_ASSERT_EQUAL(std::string("AAL"), *unindexed.fieldValue(std::string("airline")));
+    CPPUNIT_ASSERT(&fieldMap == &unindexed.fieldMap());
+
+    CPPUNIT_ASSERT(api::CRecordView::newGeneration() != indexed.generation());
+}
+
+void CRecordViewTest::testFieldIndices() {
+    api::CRecordView::CFieldIndices indices;
+    std::size_t time{indices.slot("time")};
+    std::size_t airline{indices.slot("airline")};
+    std::size_t missing{indices.slot("missing")};
+    CPPUNIT_ASSERT_EQUAL(airline, indices.slot("airline"));
+
+    TStrVec fieldNames{"time", "airline"};
+    TStrStrUMap fieldMap;
+    TStrRefVec fieldValues;
+    makeRecord(fieldNames, fieldMap, fieldValues);
+    fieldMap["time"] = "1000";
+    fieldMap["airline"] = "AAL";
+
+    std::size_t generation{api::CRecordView::newGeneration()};
+    api::CRecordView record(generation, fieldNames, fieldValues, fieldMap);
+    CPPUNIT_ASSERT_EQUAL(std::string("1000"), *indices.value(time, record));
+    CPPUNIT_ASSERT_EQUAL(std::string("AAL"), *indices.value(airline, record));
+    CPPUNIT_ASSERT(indices.value(missing, record) == nullptr);
+
+    // A slot added later must be resolved even though the generation is unchanged.
+    fieldNames.push_back("responsetime");
+    fieldValues.push_back(boost::ref(fieldMap["responsetime"]));
+    fieldMap["responsetime"] = "132.2";
+    std::size_t responsetime{indices.slot("responsetime")};
+    api::CRecordView extended(generation, fieldNames, fieldValues, fieldMap);
+    CPPUNIT_ASSERT_EQUAL(std::string("132.2"), *indices.value(responsetime, extended));
+
+    // A new generation with different field order must be re-resolved.
+    TStrVec reordered{"airline", "missing", "time"};
+    makeRecord(reordered, fieldMap, fieldValues);
+    fieldMap["airline"] = "JZA";
+    fieldMap["missing"] = "found";
+    fieldMap["time"] = "2000";
+    api::CRecordView next(api::CRecordView::newGeneration(), reordered, fieldValues, fieldMap);
+    CPPUNIT_ASSERT_EQUAL(std::string("2000"), *indices.value(time, next));
+    CPPUNIT_ASSERT_EQUAL(std::string("JZA"), *indices.value(airline, next));
+    CPPUNIT_ASSERT_EQUAL(std::string("found"), *indices.value(missing, next));
+    CPPUNIT_ASSERT(indices.value(responsetime, next) == nullptr);
+
+    // Unindexed views are looked up by name.
+    api::CRecordView unindexed(fieldMap);
+    CPPUNIT_ASSERT_EQUAL(std::string("JZA"), *indices.value(airline, unindexed));
+    CPPUNIT_ASSERT(indices.value(responsetime, unindexed) == nullptr);
+}
+
+void CRecordViewTest::testParserViews() {
+    // Check that every field of the views parsers produce can be found by
+    // index and has the same value as in the field map.
+
+    auto checkRecord = [](const api::CRecordView& record, std::size_t& generation,
+                          std::size_t& count) {
+        if (record.indexed()) {
+            if (generation == 0) {
+                generation = record.generation();
+            }
+            CPPUNIT_ASSERT_EQUAL(generation, record.generation());
+            CPPUNIT_ASSERT_EQUAL(record.fieldMap().size(), record.fieldNames().size());
+            for (std::size_t i = 0; i < record.fieldNames().size(); ++i) {
+                CPPUNIT_ASSERT_EQUAL(i, record.fieldIndex(record.fieldNames()[i]));
+                CPPUNIT_ASSERT_EQUAL(record.fieldValue(record.fieldNames()[i]),
+                                     record.fieldValue(i));
+            }
+        }
+        ++count;
+        return true;
+    };
+
+    std::string csv{"time,airline,responsetime\n"
+                    "1000,AAL,132.2\n"
+                    "1001,JZA,990.4\n"
+                    "1002,AAL,\"12,5\"\n"};
+    {
+        api::CCsvInputParser parser(csv);
+        std::size_t generation{0};
+        std::size_t count{0};
+        CPPUNIT_ASSERT(parser.readRecords([&](const api::CRecordView& record) {
+            CPPUNIT_ASSERT(record.indexed());
+            return checkRecord(record, generation, count);
+        }));
+        CPPUNIT_ASSERT_EQUAL(std::size_t(3), count);
+    }
+
+    std::string json{"{\"time\":\"1000\",\"airline\":\"AAL\",\"responsetime\":132.2}\n"
+                     "{\"time\":\"1001\",\"airline\":\"JZA\",\"responsetime\":990.4}\n"};
+    for (bool allDocsSameStructure : {false, true}) {
+        std::istringstream input{json};
+        api::CLineifiedJsonInputParser parser(input, allDocsSameStructure);
+        std::size_t generation{0};
+        std::size_t count{0};
+        CPPUNIT_ASSERT(parser.readRecords([&](const api::CRecordView& record) {
+            CPPUNIT_ASSERT_EQUAL(allDocsSameStructure, record.indexed());
+            return checkRecord(record, generation, count);
+        }));
+        CPPUNIT_ASSERT_EQUAL(std::size_t(2), count);
+    }
+}
@@ -6,6 +6,7 @@
 #include "CResultNormalizerTest.h"
 
 #include <core/CLogger.h>
+#include <core/CStopWatch.h>
 
 #include <model/CAnomalyDetectorModelConfig.h>
 
@@ -18,6 +19,7 @@
 #include <boost/bind.hpp>
 
 #include <fstream>
+#include <iterator>
 #include <sstream>
 #include <string>
 
@@ -31,6 +33,9 @@ CppUnit::Test* CResultNormalizerTest::suite() {
     suiteOfTests->addTest(new CppUnit::TestCaller<CResultNormalizerTest>(
         "CResultNormalizerTest::testInitNormalizer", &CResultNormalizerTest::testInitNormalizer));
 
+    suiteOfTests->addTest(new CppUnit::TestCaller<CResultNormalizerTest>(
+        "CResultNormalizerTest::testMultipleThreads", &CResultNormalizerTest::testMultipleThreads));
+
     return suiteOfTests;
 }
 
@@ -552,3 +557,56 @@ void CResultNormalizerTest::testInitNormalizer() {
                              std::string(doc["normalized_score"].GetString()));
     }
 }
+
+void CResultNormalizerTest::testMultipleThreads() {
+    // Check that normalizing blocks of results concurrently gives the same
+    // results in the same order as normalizing them one at a time. Note the
+    // order of the fields in each document isn't significant.
+
+    ml::model::CAnomalyDetectorModelConfig modelConfig =
+        ml::model::CAnomalyDetectorModelConfig::defaultConfig(900);
+
+    std::ifstream inputStrm("testfiles/new_normalizerInput.csv");
+    std::string input{std::istreambuf_iterator<char>(inputStrm),
+                      std::istreambuf_iterator<char>()};
+
+    // Enough records to fill a few blocks and part of another.
+    std::size_t repeats{30};
+
+    std::string results[2];
+    for (std::size_t numberThreads : {1, 4}) {
+        ml::api::CLineifiedJsonOutputWriter outputWriter;
+        ml::api::CResultNormalizer normalizer(modelConfig, outputWriter, numberThreads);
+        CPPUNIT_ASSERT(normalizer.initNormalizer("testfiles/new_quantilesState.json"));
+
+        ml::core::CStopWatch watch{true};
+        for (std::size_t i = 0u; i < repeats; ++i) {
+            std::istringstream strm(input);
+            ml::api::CCsvInputParser inputParser(strm, ml::api::CCsvInputParser::COMMA);
+            CPPUNIT_ASSERT(inputParser.readStream(
+                boost::bind(&ml::api::CResultNormalizer::handleRecord, &normalizer, _1)));
+        }
+        CPPUNIT_ASSERT(normalizer.finalise());
+        LOG_DEBUG(<< "Normalizing with " << numberThreads << " threads took "
+                  << watch.stop() << "ms");
+
+        results[numberThreads == 1 ? 0 : 1] = outputWriter.internalString();
+    }
+
+    std::stringstream serialStrm(results[0]);
+    std::stringstream concurrentStrm(results[1]);
+    std::string serialDocString;
+    std::string concurrentDocString;
+    std::size_t count{0};
+    while (std::getline(serialStrm, serialDocString)) {
+        CPPUNIT_ASSERT(std::getline(concurrentStrm, concurrentDocString));
+        rapidjson::Document serialDoc;
+        rapidjson::Document concurrentDoc;
+        serialDoc.Parse<rapidjson::kParseDefaultFlags>(serialDocString.c_str());
+        concurrentDoc.Parse<rapidjson::kParseDefaultFlags>(concurrentDocString.c_str());
+        CPPUNIT_ASSERT(serialDoc == concurrentDoc);
+        ++count;
+    }
+    CPPUNIT_ASSERT(!std::getline(concurrentStrm, concurrentDocString));
+    CPPUNIT_ASSERT_EQUAL(std::size_t(327 * repeats), count);
+}
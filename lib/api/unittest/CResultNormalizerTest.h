@@ -12,6 +12,7 @@ class CResultNormalizerTest : public CppUnit::TestFixture {
 public:
     void testInitNormalizerPartitioned();
     void testInitNormalizer();
+    void testMultipleThreads();
 
     static CppUnit::Test* suite();
 };
@@ -15,6 +15,13 @@
 #include <api/CTokenListDataTyper.h>
 #include <api/CTokenListReverseSearchCreator.h>
 
+#include <test/CRandomNumbers.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
 namespace {
 
 using TTokenListDataTyperKeepsFields =
@@ -63,6 +70,8 @@ CppUnit::Test* CTokenListDataTyperTest::suite() {
     suiteOfTests->addTest(new CppUnit::TestCaller<CTokenListDataTyperTest>(
         "CTokenListDataTyperTest::testPreTokenisedPerformance",
         &CTokenListDataTyperTest::testPreTokenisedPerformance));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CTokenListDataTyperTest>(
+        "CTokenListDataTyperTest::testManyTypes", &CTokenListDataTyperTest::testManyTypes));
 
     return suiteOfTests;
 }
@@ -480,3 +489,66 @@ void CTokenListDataTyperTest::testPreTokenisedPerformance() {
         CPPUNIT_ASSERT(preTokenisationTime <= inlineTokenisationTime);
     }
 }
+
+void CTokenListDataTyperTest::testManyTypes() {
+    // Check that messages are assigned to the right type when there are many
+    // types which share some of their tokens and report the throughput.
+
+    // Trace logging would dominate the timings
+    ml::core::CLogger::instance().setLoggingLevel(ml::core::CLogger::E_Debug);
+
+    using TSizeVec = std::vector<std::size_t>;
+    using TStrVec = std::vector<std::string>;
+
+    // Tokens are made of letters only so none of them are ignored
+    auto word = [](std::string prefix, std::size_t index) {
+        do {
+            prefix += static_cast<char>('a' + index % 26);
+            index /= 26;
+        } while (index > 0);
+        return prefix;
+    };
+
+    ml::test::CRandomNumbers rng;
+
+    for (std::size_t numberTypes : {100, 1000, 10000}) {
+        // Each message has six tokens unique to its type, one token shared
+        // with about one in twenty other types and one variable token.
+        TStrVec templates;
+        for (std::size_t i = 0; i < numberTypes; ++i) {
+            std::string message;
+            for (std::size_t j = 0; j < 6; ++j) {
+                message += word("qz", 6 * i + j) + ' ';
+            }
+            templates.push_back(message + word("xq", i % 20) + ' ');
+        }
+
+        TTokenListDataTyperKeepsFields typer(NO_REVERSE_SEARCH_CREATOR, 0.7, "whatever");
+
+        TSizeVec variable;
+        rng.generateUniformSamples(0, 10, numberTypes, variable);
+        for (std::size_t i = 0; i < numberTypes; ++i) {
+            CPPUNIT_ASSERT_EQUAL(static_cast<int>(i + 1),
+                                 typer.computeType(false, templates[i] + word("vq", variable[i]), 500));
+        }
+
+        std::size_t numberMessages{20000};
+        TSizeVec types;
+        rng.generateUniformSamples(0, numberTypes, numberMessages, types);
+        rng.generateUniformSamples(0, 10, numberMessages, variable);
+
+        ml::core::CStopWatch stopWatch(true);
+        for (std::size_t i = 0; i < numberMessages; ++i) {
+            CPPUNIT_ASSERT_EQUAL(static_cast<int>(types[i] + 1),
+                                 typer.computeType(false, templates[types[i]] + word("vq", variable[i]),
+                                                   500));
+        }
+        std::uint64_t elapsed{stopWatch.stop()};
+
+        LOG_INFO(<< "Typed " << numberMessages << " messages with " << numberTypes
+                 << " types in " << elapsed << "ms, "
+                 << 1000.0 * static_cast<double>(numberMessages) /
+                        static_cast<double>(std::max(elapsed, std::uint64_t{1}))
+                 << " messages/sec");
+    }
+}
@@ -23,6 +23,7 @@ public:
     void testLongReverseSearch();
     void testPreTokenised();
     void testPreTokenisedPerformance();
+    void testManyTypes();
 
     void setUp();
     void tearDown();
@@ -0,0 +1,226 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include "CTokenListTokeniserTest.h"
+
+#include <core/CLogger.h>
+#include <core/CStopWatch.h>
+
+#include <api/CTokenListTokeniser.h>
+
+#include <test/CRandomNumbers.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
+CppUnit::Test* CTokenListTokeniserTest::suite() {
+    CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CTokenListTokeniserTest");
+
+    suiteOfTests->addTest(new CppUnit::TestCaller<CTokenListTokeniserTest>(
+        "CTokenListTokeniserTest::testTokens", &CTokenListTokeniserTest::testTokens));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CTokenListTokeniserTest>(
+        "CTokenListTokeniserTest::testVectorisedMatchesScalar",
+        &CTokenListTokeniserTest::testVectorisedMatchesScalar));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CTokenListTokeniserTest>(
+        "CTokenListTokeniserTest::testThroughput", &CTokenListTokeniserTest::testThroughput));
+
+    return suiteOfTests;
+}
+
+namespace {
+
+using TSizeVec = std::vector<std::size_t>;
+using TStrVec = std::vector<std::string>;
+using TSizeSizeSizeTr = std::tuple<std::size_t, std::size_t, std::size_t>;
+using TSizeSizeSizeTrVec = std::vector<TSizeSizeSizeTr>;
+
+template<typename TOKENISER>
+TStrVec tokens(const std::string& str) {
+    TStrVec result;
+    TOKENISER::tokenise(str, [&](std::size_t start, std::size_t length, std::size_t) {
+        result.push_back(str.substr(start, length));
+    });
+    return result;
+}
+
+template<typename TOKENISER>
+TSizeSizeSizeTrVec scalarTokens(const std::string& str) {
+    TSizeSizeSizeTrVec result;
+    TOKENISER::tokeniseScalar(str, [&result](std::size_t start, std::size_t length,
+                                             std::size_t nonHexPos) {
+        result.emplace_back(start, length, nonHexPos);
+    });
+    return result;
+}
+
+template<typename TOKENISER>
+TSizeSizeSizeTrVec vectorisedTokens(const std::string& str) {
+    TSizeSizeSizeTrVec result;
+#if defined(__SSE2__) || defined(_M_X64)
+    TOKENISER::tokeniseVectorised(str, [&result](std::size_t start, std::size_t length,
+                                                 std::size_t nonHexPos) {
+        result.emplace_back(start, length, nonHexPos);
+    });
+#else
+    TOKENISER::tokeniseScalar(str, [&result](std::size_t start, std::size_t length,
+                                             std::size_t nonHexPos) {
+        result.emplace_back(start, length, nonHexPos);
+    });
+#endif
+    return result;
+}
+
+template<bool ALLOW_UNDERSCORE, bool ALLOW_DOT, bool ALLOW_DASH, bool IGNORE_HEX>
+void checkVectorisedMatchesScalar(const TStrVec& strings) {
+    using TTokeniser =
+        ml::api::CTokenListTokeniser<ALLOW_UNDERSCORE, ALLOW_DOT, ALLOW_DASH, IGNORE_HEX>;
+    for (const auto& str : strings) {
+        TSizeSizeSizeTrVec expected(scalarTokens<TTokeniser>(str));
+        TSizeSizeSizeTrVec actual(vectorisedTokens<TTokeniser>(str));
+        if (IGNORE_HEX == false) {
+            // The hex position is only defined if hex tokens are ignored
+            for (auto& token : expected) {
+                std::get<2>(token) = 0;
+            }
+            for (auto& token : actual) {
+                std::get<2>(token) = 0;
+            }
+        }
+        if (expected != actual) {
+            LOG_ERROR(<< "Tokenisations differ for '" << str << "'");
+        }
+        CPPUNIT_ASSERT(expected == actual);
+    }
+}
+}
+
+void CTokenListTokeniserTest::testTokens() {
+    using TTokeniser = ml::api::CTokenListTokeniser<true, true, true, true>;
+    using TNoPunctuationTokeniser = ml::api::CTokenListTokeniser<false, false, false, true>;
+
+    std::string message{"<ml13-4608.1.p2ps: Info: > Source ML_SERVICE2 on 33122:967 "
+                        "has shut down. 0xdeadbeef -_- x"};
+
+    TStrVec expected{"ml13-4608.1.p2ps", "Info", "Source", "ML_SERVICE2",
+                     "on", "33122", "967", "has", "shut", "down.", "0xdeadbeef", "x"};
+    CPPUNIT_ASSERT(expected == tokens<TTokeniser>(message));
+
+    expected = {"ml13", "4608", "1", "p2ps", "Info", "Source", "ML", "SERVICE2",
+                "on", "33122", "967", "has", "shut", "down", "0xdeadbeef", "x"};
+    CPPUNIT_ASSERT(expected == tokens<TNoPunctuationTokeniser>(message));
+
+    // Check the position of the last character which can't be part of a
+    // hex number
+    TSizeVec nonHexPos;
+    TTokeniser::tokenise(std::string{"deadbeef 0xdeadbeef 12.34-56 a_b"},
+                         [&nonHexPos](std::size_t, std::size_t, std::size_t pos) {
+                             nonHexPos.push_back(pos);
+                         });
+    TSizeVec expectedNonHexPos{std::string::npos, 1, std::string::npos, 1};
+    CPPUNIT_ASSERT(expectedNonHexPos == nonHexPos);
+
+    CPPUNIT_ASSERT(tokens<TTokeniser>("").empty());
+    CPPUNIT_ASSERT(tokens<TTokeniser>("  \t-_.  ").empty());
+
+    // Non-ASCII characters are token boundaries
+    expected = {"caf", "na", "ve"};
+    CPPUNIT_ASSERT(expected == tokens<TTokeniser>("caf\xc3\xa9 na\xc3\xafve"));
+}
+
+void CTokenListTokeniserTest::testVectorisedMatchesScalar() {
+    // Random strings over an alphabet rich in token boundaries, with lengths
+    // either side of multiples of the block size, plus long tokens which
+    // span several blocks.
+
+    ml::test::CRandomNumbers rng;
+
+    std::string alphabet{"aZ09fF_.- x:\t/\xc3\xa9"};
+    TStrVec strings;
+    for (std::size_t length = 0; length <= 200; ++length) {
+        for (std::size_t trial = 0; trial < 10; ++trial) {
+            TSizeVec characters;
+            rng.generateUniformSamples(0, alphabet.size(), length, characters);
+            std::string str;
+            for (auto i : characters) {
+                str += alphabet[i];
+            }
+            strings.push_back(str);
+        }
+    }
+    for (std::size_t length : {63, 64, 65, 127, 128, 129, 300}) {
+        strings.push_back(std::string(length, 'a'));
+        strings.push_back(std::string(length, 'a') + ' ');
+        strings.push_back(' ' + std::string(length, 'a'));
+        strings.push_back(std::string(length, '1') + 'g' + std::string(length, '-'));
+    }
+
+    checkVectorisedMatchesScalar<false, false, false, false>(strings);
+    checkVectorisedMatchesScalar<false, false, false, true>(strings);
+    checkVectorisedMatchesScalar<true, false, false, true>(strings);
+    checkVectorisedMatchesScalar<false, true, false, true>(strings);
+    checkVectorisedMatchesScalar<false, false, true, true>(strings);
+    checkVectorisedMatchesScalar<true, true, true, false>(strings);
+    checkVectorisedMatchesScalar<true, true, true, true>(strings);
+}
+
+void CTokenListTokeniserTest::testThroughput() {
+    // Report the tokenisation throughput for log messages of typical length.
+
+    using TTokeniser = ml::api::CTokenListTokeniser<true, true, true, true>;
+
+    TStrVec messages{
+        "Vpxa: [49EC0B90 verbose 'VpxaHalCnxHostagent' opID=WFU-ddeadb59] "
+        "[WaitForUpdatesDone] Received callback for host 10.113.22.81 with "
+        "property collector version 6729102 and 3 changes to apply",
+        "2018-09-26 12:23:46,115 ERROR [org.apache.catalina.core.ContainerBase."
+        "[Catalina].[localhost].[/].[dispatcherServlet]] (http-nio-8080-exec-7) "
+        "Servlet.service() for servlet [dispatcherServlet] in context with path [] "
+        "threw exception [Request processing failed; nested exception is "
+        "java.lang.IllegalStateException: No instances available for "
+        "payment-service] with root cause",
+        "<ml13-4608.1.p2ps: Info: > Source ML_SERVICE2 on 33122:967 has shut down. "
+        "Trying to reconnect to the primary source in 30 seconds, last error "
+        "was 0x80004005 (unspecified failure) from 192.168.1.103:8443"};
+
+    std::size_t repeats{20000};
+    std::size_t bytes{0};
+    for (const auto& message : messages) {
+        bytes += repeats * message.size();
+    }
+
+    std::size_t numberTokens{0};
+    auto count = [&numberTokens](std::size_t, std::size_t, std::size_t) {
+        ++numberTokens;
+    };
+
+    ml::core::CStopWatch stopWatch(true);
+    for (std::size_t i = 0; i < repeats; ++i) {
+        for (const auto& message : messages) {
+            TTokeniser::tokeniseScalar(message, count);
+        }
+    }
+    std::uint64_t scalarTime{std::max(stopWatch.stop(), std::uint64_t{1})};
+    std::size_t scalarTokens{numberTokens};
+
+    numberTokens = 0;
+    stopWatch.reset(true);
+    for (std::size_t i = 0; i < repeats; ++i) {
+        for (const auto& message : messages) {
+            TTokeniser::tokenise(message, count);
+        }
+    }
+    std::uint64_t time{std::max(stopWatch.stop(), std::uint64_t{1})};
+
+    CPPUNIT_ASSERT_EQUAL(scalarTokens, numberTokens);
+
+    LOG_INFO(<< "Tokenised " << bytes << " bytes in " << scalarTime << "ms ("
+             << 1000.0 * static_cast<double>(bytes) / static_cast<double>(scalarTime)
+             << " bytes/sec) one character at a time and in " << time << "ms ("
+             << 1000.0 * static_cast<double>(bytes) / static_cast<double>(time)
+             << " bytes/sec) using the fastest implementation");
+}
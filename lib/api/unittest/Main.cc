@@ -27,6 +27,7 @@
 #include "CModelSnapshotJsonWriterTest.h"
 #include "CMultiFileDataAdderTest.h"
 #include "COutputChainerTest.h"
+#include "CRecordViewTest.h"
 #include "CRestorePreviousStateTest.h"
 #include "CResultNormalizerTest.h"
 #include "CSingleStreamDataAdderTest.h"
@@ -34,6 +35,7 @@
 #include "CStringStoreTest.h"
 #include "CTokenListDataTyperTest.h"
 #include "CTokenListReverseSearchCreatorTest.h"
+#include "CTokenListTokeniserTest.h"
 
 int main(int argc, const char** argv) {
     ml::test::CTestRunner runner(argc, argv);
@@ -60,12 +62,14 @@ int main(int argc, const char** argv) {
     runner.addTest(CModelSnapshotJsonWriterTest::suite());
     runner.addTest(CMultiFileDataAdderTest::suite());
     runner.addTest(COutputChainerTest::suite());
+    runner.addTest(CRecordViewTest::suite());
     runner.addTest(CRestorePreviousStateTest::suite());
     runner.addTest(CResultNormalizerTest::suite());
     runner.addTest(CSingleStreamDataAdderTest::suite());
     runner.addTest(CStringStoreTest::suite());
     runner.addTest(CTokenListDataTyperTest::suite());
     runner.addTest(CTokenListReverseSearchCreatorTest::suite());
+    runner.addTest(CTokenListTokeniserTest::suite());
 
     return !runner.runTests();
 }
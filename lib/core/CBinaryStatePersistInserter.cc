@@ -0,0 +1,95 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include <core/CBinaryStatePersistInserter.h>
+
+#include <cstring>
+#include <ostream>
+
+namespace ml {
+namespace core {
+
+namespace {
+//! The buffer size at which we write to the stream.
+const std::size_t FLUSH_SIZE{65536};
+}
+
+// The first character is a null so the header can't be confused with JSON
+// and the last is a version number.
+const std::string CBinaryStatePersistInserter::HEADER("\0mlb1", 5);
+const char CBinaryStatePersistInserter::START_LEVEL;
+const char CBinaryStatePersistInserter::END_LEVEL;
+const char CBinaryStatePersistInserter::STRING_VALUE;
+const char CBinaryStatePersistInserter::DOUBLE_VALUE;
+
+CBinaryStatePersistInserter::CBinaryStatePersistInserter(std::ostream& outputStream)
+    : m_OutputStream(outputStream) {
+    m_Buffer.reserve(FLUSH_SIZE + 1024);
+    m_Buffer += HEADER;
+}
+
+CBinaryStatePersistInserter::~CBinaryStatePersistInserter() {
+    m_Buffer += END_LEVEL;
+    this->flush();
+}
+
+void CBinaryStatePersistInserter::insertValue(const std::string& name,
+                                              const std::string& value) {
+    m_Buffer += STRING_VALUE;
+    this->appendString(name);
+    this->appendString(value);
+    this->flushIfFull();
+}
+
+void CBinaryStatePersistInserter::insertValue(const std::string& name,
+                                              double value,
+                                              CIEEE754::EPrecision precision) {
+    value = CIEEE754::round(value, precision);
+    char raw[sizeof(double)];
+    std::memcpy(raw, &value, sizeof(double));
+    m_Buffer += DOUBLE_VALUE;
+    this->appendString(name);
+    m_Buffer += static_cast<char>(precision);
+    m_Buffer.append(raw, sizeof(double));
+    this->flushIfFull();
+}
+
+void CBinaryStatePersistInserter::flush() {
+    m_OutputStream.write(m_Buffer.data(), static_cast<std::streamsize>(m_Buffer.size()));
+    m_OutputStream.flush();
+    m_Buffer.clear();
+}
+
+void CBinaryStatePersistInserter::newLevel(const std::string& name) {
+    m_Buffer += START_LEVEL;
+    this->appendString(name);
+}
+
+void CBinaryStatePersistInserter::endLevel() {
+    m_Buffer += END_LEVEL;
+    this->flushIfFull();
+}
+
+void CBinaryStatePersistInserter::appendString(const std::string& value) {
+    // The length is written as a base 128 varint, which is one byte for
+    // all the names and most of the values.
+    std::size_t length{value.length()};
+    while (length >= 0x80) {
+        m_Buffer += static_cast<char>((length & 0x7f) | 0x80);
+        length >>= 7;
+    }
+    m_Buffer += static_cast<char>(length);
+    m_Buffer += value;
+}
+
+void CBinaryStatePersistInserter::flushIfFull() {
+    if (m_Buffer.size() >= FLUSH_SIZE) {
+        m_OutputStream.write(m_Buffer.data(),
+                             static_cast<std::streamsize>(m_Buffer.size()));
+        m_Buffer.clear();
+    }
+}
+}
+}
@@ -0,0 +1,290 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include <core/CBinaryStateRestoreTraverser.h>
+
+#include <core/CBinaryStatePersistInserter.h>
+#include <core/CLogger.h>
+#include <core/CStringUtils.h>
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+
+namespace ml {
+namespace core {
+
+namespace {
+const std::string EMPTY_STRING;
+//! Strings are read in chunks of at most this many bytes.
+const std::size_t STRING_CHUNK_SIZE{65536};
+}
+
+CBinaryStateRestoreTraverser::CBinaryStateRestoreTraverser(std::istream& inputStream)
+    : m_Input(inputStream.rdbuf()), m_Started(false), m_Eof(false),
+      m_Type(E_EndOfLevel), m_SubLevelRead(false), m_ValueIsRaw(false),
+      m_Double(0.0), m_Precision(CIEEE754::E_DoublePrecision) {
+}
+
+bool CBinaryStateRestoreTraverser::isBinaryState(std::istream& inputStream) {
+    // JSON state starts with '{' or white space and binary state starts
+    // with a null character.
+    return inputStream.peek() == CBinaryStatePersistInserter::HEADER[0];
+}
+
+bool CBinaryStateRestoreTraverser::next() {
+    if (this->start() == false) {
+        return false;
+    }
+
+    if (m_Type == E_EndOfLevel) {
+        return false;
+    }
+    if (m_Type == E_StartOfLevel && m_SubLevelRead == false &&
+        this->skipSubLevel() == false) {
+        return false;
+    }
+    if (this->advance() == false) {
+        return false;
+    }
+    if (m_Type == E_EndOfLevel) {
+        m_Eof = m_Parents.empty();
+        return false;
+    }
+    return true;
+}
+
+bool CBinaryStateRestoreTraverser::hasSubLevel() const {
+    if (const_cast<CBinaryStateRestoreTraverser*>(this)->start() == false) {
+        return false;
+    }
+
+    return m_Type == E_StartOfLevel && m_SubLevelRead == false;
+}
+
+const std::string& CBinaryStateRestoreTraverser::name() const {
+    if (const_cast<CBinaryStateRestoreTraverser*>(this)->start() == false) {
+        return EMPTY_STRING;
+    }
+
+    return m_Name;
+}
+
+const std::string& CBinaryStateRestoreTraverser::value() const {
+    if (const_cast<CBinaryStateRestoreTraverser*>(this)->start() == false) {
+        return EMPTY_STRING;
+    }
+
+    if (m_ValueIsRaw) {
+        m_Value = CStringUtils::typeToStringPrecise(m_Double, m_Precision);
+        m_ValueIsRaw = false;
+    }
+    return m_Value;
+}
+
+bool CBinaryStateRestoreTraverser::valueAs(double& result) const {
+    if (const_cast<CBinaryStateRestoreTraverser*>(this)->start() == false) {
+        return false;
+    }
+
+    if (m_Type == E_Double) {
+        result = m_Double;
+        return true;
+    }
+    return CStringUtils::stringToType(m_Value, result);
+}
+
+bool CBinaryStateRestoreTraverser::isEof() const {
+    if (const_cast<CBinaryStateRestoreTraverser*>(this)->start() == false) {
+        return true;
+    }
+
+    return m_Eof;
+}
+
+bool CBinaryStateRestoreTraverser::descend() {
+    if (this->start() == false) {
+        return false;
+    }
+
+    if (m_Type != E_StartOfLevel || m_SubLevelRead) {
+        return false;
+    }
+
+    m_Parents.push_back(m_Name);
+
+    // If the level is empty this leaves the traverser at the end of the
+    // level with an empty name and value, so the sub-level traverser will
+    // find nothing and then ascend.
+    return this->advance();
+}
+
+bool CBinaryStateRestoreTraverser::ascend() {
+    // If we're trying to ascend above the root level then something has gone
+    // wrong
+    if (m_Parents.empty()) {
+        LOG_ERROR(<< "Inconsistency - trying to ascend above binary state root");
+        return false;
+    }
+
+    while (m_Type != E_EndOfLevel) {
+        if (m_Type == E_StartOfLevel && m_SubLevelRead == false &&
+            this->skipSubLevel() == false) {
+            return false;
+        }
+        if (this->advance() == false) {
+            return false;
+        }
+    }
+
+    // Point at the element whose sub-level we've just finished so next()
+    // moves on to its sibling.
+    m_Type = E_StartOfLevel;
+    m_SubLevelRead = true;
+    m_Name = std::move(m_Parents.back());
+    m_Value.clear();
+    m_ValueIsRaw = false;
+    m_Parents.pop_back();
+
+    return this->haveBadState() == false;
+}
+
+void CBinaryStateRestoreTraverser::copyValue(CStatePersistInserter& inserter) const {
+    if (m_Type == E_Double) {
+        inserter.insertValue(m_Name, m_Double, m_Precision);
+    } else {
+        this->CStateRestoreTraverser::copyValue(inserter);
+    }
+}
+
+bool CBinaryStateRestoreTraverser::start() {
+    if (m_Started) {
+        return true;
+    }
+    m_Started = true;
+
+    std::string header(CBinaryStatePersistInserter::HEADER.size(), '\0');
+    if (m_Input == nullptr ||
+        m_Input->sgetn(&header[0], static_cast<std::streamsize>(header.size())) !=
+            static_cast<std::streamsize>(header.size()) ||
+        header != CBinaryStatePersistInserter::HEADER) {
+        return this->fail("missing header");
+    }
+
+    if (this->advance() == false) {
+        return false;
+    }
+    m_Eof = (m_Type == E_EndOfLevel);
+
+    return true;
+}
+
+bool CBinaryStateRestoreTraverser::advance() {
+    int token{m_Input->sbumpc()};
+    if (token == std::streambuf::traits_type::eof()) {
+        return this->fail("unexpected end of input");
+    }
+
+    m_SubLevelRead = false;
+    m_ValueIsRaw = false;
+
+    switch (static_cast<char>(token)) {
+    case CBinaryStatePersistInserter::END_LEVEL:
+        m_Type = E_EndOfLevel;
+        m_Name.clear();
+        m_Value.clear();
+        return true;
+    case CBinaryStatePersistInserter::START_LEVEL:
+        m_Type = E_StartOfLevel;
+        m_Value.clear();
+        return this->readString(m_Name);
+    case CBinaryStatePersistInserter::STRING_VALUE:
+        m_Type = E_String;
+        return this->readString(m_Name) && this->readString(m_Value);
+    case CBinaryStatePersistInserter::DOUBLE_VALUE: {
+        m_Type = E_Double;
+        if (this->readString(m_Name) == false) {
+            return false;
+        }
+        int precision{m_Input->sbumpc()};
+        char raw[sizeof(double)];
+        if (precision < CIEEE754::E_HalfPrecision || precision > CIEEE754::E_DoublePrecision ||
+            m_Input->sgetn(raw, sizeof(double)) != sizeof(double)) {
+            return this->fail("bad floating point value");
+        }
+        std::memcpy(&m_Double, raw, sizeof(double));
+        m_Precision = static_cast<CIEEE754::EPrecision>(precision);
+        m_Value.clear();
+        m_ValueIsRaw = true;
+        return true;
+    }
+    default:
+        break;
+    }
+
+    return this->fail("unknown token");
+}
+
+bool CBinaryStateRestoreTraverser::skipSubLevel() {
+    for (std::size_t depth = 1; depth > 0; /**/) {
+        if (this->advance() == false) {
+            return false;
+        }
+        if (m_Type == E_StartOfLevel) {
+            ++depth;
+        } else if (m_Type == E_EndOfLevel) {
+            --depth;
+        }
+    }
+    // Point back at the element whose sub-level we skipped.
+    m_Type = E_StartOfLevel;
+    m_SubLevelRead = true;
+    return true;
+}
+
+bool CBinaryStateRestoreTraverser::readString(std::string& result) {
+    std::size_t length{0};
+    for (std::size_t shift = 0; /**/; shift += 7) {
+        int byte{m_Input->sbumpc()};
+        // The last of ten bytes can only contribute the top bit.
+        if (byte == std::streambuf::traits_type::eof() || shift > 63 ||
+            (shift == 63 && (byte & 0x7e) != 0)) {
+            return this->fail("bad string length");
+        }
+        length |= static_cast<std::size_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+
+    // The length is only as good as the input, so the string grows with
+    // the bytes actually read. A corrupt length then fails at the end of
+    // the input rather than allocating whatever it says.
+    result.clear();
+    while (result.size() < length) {
+        std::size_t offset{result.size()};
+        std::size_t chunk{std::min(length - offset, STRING_CHUNK_SIZE)};
+        result.resize(offset + chunk);
+        if (m_Input->sgetn(&result[offset], static_cast<std::streamsize>(chunk)) !=
+            static_cast<std::streamsize>(chunk)) {
+            result.clear();
+            return this->fail("truncated string");
+        }
+    }
+    return true;
+}
+
+bool CBinaryStateRestoreTraverser::fail(const char* reason) {
+    LOG_ERROR(<< "Failed to read binary state: " << reason);
+    m_Eof = true;
+    m_Type = E_EndOfLevel;
+    m_Name.clear();
+    m_Value.clear();
+    m_ValueIsRaw = false;
+    this->setBadState();
+    return false;
+}
+}
+}
@@ -0,0 +1,262 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include <core/CPerfectHashWordMap.h>
+
+#include <core/CLogger.h>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <ostream>
+
+namespace ml {
+namespace core {
+
+namespace {
+
+const char IMAGE_MAGIC[4] = {'M', 'L', 'W', 'M'};
+const std::uint32_t IMAGE_VERSION(1);
+const std::uint32_t IMAGE_BYTE_ORDER(0x01020304);
+
+//! The average number of words per bucket.
+const std::size_t WORDS_PER_BUCKET(4);
+
+//! Give up building the table if a bucket needs more seeds than this.
+const std::uint32_t MAX_SEED(1 << 24);
+
+char toLower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+}
+
+CPerfectHashWordMap::CPerfectHashWordMap()
+    : m_NumberBuckets(0), m_NumberSlots(0), m_PoolSize(0), m_Seeds(nullptr),
+      m_Slots(nullptr), m_Pool(nullptr) {
+}
+
+CPerfectHashWordMap::~CPerfectHashWordMap() {
+}
+
+bool CPerfectHashWordMap::write(const TStrUInt16PrVec& words, std::ostream& strm) {
+    // Keep the last value of each word ignoring case
+    std::map<std::string, std::uint16_t> lowered;
+    for (const auto& word : words) {
+        if (word.first.length() > std::numeric_limits<std::uint16_t>::max()) {
+            LOG_ERROR(<< "Word too long for perfect hash map: " << word.first);
+            return false;
+        }
+        std::string key(word.first);
+        std::transform(key.begin(), key.end(), key.begin(), toLower);
+        lowered[key] = word.second;
+    }
+
+    std::size_t numberSlots(lowered.size());
+    std::size_t numberBuckets((numberSlots + WORDS_PER_BUCKET - 1) / WORDS_PER_BUCKET);
+
+    // Lay out the pool and assign words to buckets
+    std::string pool;
+    std::vector<SSlot> entries;
+    std::vector<std::uint64_t> hashes;
+    std::vector<std::vector<std::size_t>> buckets(numberBuckets);
+    for (const auto& word : lowered) {
+        if (pool.size() + word.first.size() > std::numeric_limits<std::uint32_t>::max()) {
+            LOG_ERROR(<< "Too many words for perfect hash map");
+            return false;
+        }
+        SSlot slot;
+        slot.s_Offset = static_cast<std::uint32_t>(pool.size());
+        slot.s_Length = static_cast<std::uint16_t>(word.first.size());
+        slot.s_Value = word.second;
+        pool += word.first;
+        std::uint64_t wordHash(hash(word.first.data(), word.first.size()));
+        buckets[mix(wordHash, 0) % numberBuckets].push_back(entries.size());
+        entries.push_back(slot);
+        hashes.push_back(wordHash);
+    }
+
+    // Find a seed for each bucket, largest first, which sends all its words
+    // to distinct free slots
+    std::vector<std::size_t> order(numberBuckets);
+    for (std::size_t i = 0; i < numberBuckets; ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&buckets](std::size_t lhs, std::size_t rhs) {
+        return buckets[lhs].size() > buckets[rhs].size();
+    });
+
+    std::vector<std::uint32_t> seeds(numberBuckets, 0);
+    std::vector<SSlot> slots(numberSlots, SSlot{0, 0, 0});
+    std::vector<bool> used(numberSlots, false);
+    std::vector<std::size_t> positions;
+    for (auto bucket : order) {
+        if (buckets[bucket].empty()) {
+            break;
+        }
+        std::uint32_t seed(0);
+        for (/**/; seed < MAX_SEED; ++seed) {
+            positions.clear();
+            for (auto word : buckets[bucket]) {
+                std::size_t position(mix(hashes[word], std::uint64_t(seed) + 1) % numberSlots);
+                if (used[position] ||
+                    std::find(positions.begin(), positions.end(), position) != positions.end()) {
+                    break;
+                }
+                positions.push_back(position);
+            }
+            if (positions.size() == buckets[bucket].size()) {
+                break;
+            }
+        }
+        if (seed == MAX_SEED) {
+            LOG_ERROR(<< "Failed to find perfect hash for " << numberSlots << " words");
+            return false;
+        }
+        seeds[bucket] = seed;
+        for (std::size_t i = 0; i < positions.size(); ++i) {
+            used[positions[i]] = true;
+            slots[positions[i]] = entries[buckets[bucket][i]];
+        }
+    }
+
+    SHeader header;
+    std::memcpy(header.s_Magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+    header.s_Version = IMAGE_VERSION;
+    header.s_ByteOrder = IMAGE_BYTE_ORDER;
+    header.s_NumberBuckets = static_cast<std::uint32_t>(numberBuckets);
+    header.s_NumberSlots = static_cast<std::uint32_t>(numberSlots);
+    header.s_PoolSize = static_cast<std::uint32_t>(pool.size());
+
+    strm.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    strm.write(reinterpret_cast<const char*>(seeds.data()),
+               static_cast<std::streamsize>(seeds.size() * sizeof(std::uint32_t)));
+    strm.write(reinterpret_cast<const char*>(slots.data()),
+               static_cast<std::streamsize>(slots.size() * sizeof(SSlot)));
+    strm.write(pool.data(), static_cast<std::streamsize>(pool.size()));
+
+    return strm.good();
+}
+
+bool CPerfectHashWordMap::map(const std::string& fileName) {
+    this->clear();
+
+    try {
+        m_File.reset(new boost::interprocess::file_mapping(
+            fileName.c_str(), boost::interprocess::read_only));
+        m_Region.reset(new boost::interprocess::mapped_region(
+            *m_File, boost::interprocess::read_only));
+    } catch (const std::exception& e) {
+        LOG_DEBUG(<< "Unable to map " << fileName << ": " << e.what());
+        this->clear();
+        return false;
+    }
+
+    const char* image(static_cast<const char*>(m_Region->get_address()));
+    std::size_t size(m_Region->get_size());
+
+    SHeader header;
+    if (size < sizeof(header)) {
+        LOG_ERROR(<< "Perfect hash map image " << fileName << " is truncated");
+        this->clear();
+        return false;
+    }
+    std::memcpy(&header, image, sizeof(header));
+    if (std::memcmp(header.s_Magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0 ||
+        header.s_Version != IMAGE_VERSION || header.s_ByteOrder != IMAGE_BYTE_ORDER) {
+        LOG_ERROR(<< "Perfect hash map image " << fileName
+                  << " has the wrong format, version or byte order");
+        this->clear();
+        return false;
+    }
+    std::size_t expectedSize(sizeof(header) +
+                             header.s_NumberBuckets * sizeof(std::uint32_t) +
+                             header.s_NumberSlots * sizeof(SSlot) + header.s_PoolSize);
+    if (size != expectedSize || (header.s_NumberSlots > 0 && header.s_NumberBuckets == 0)) {
+        LOG_ERROR(<< "Perfect hash map image " << fileName << " is corrupt: size "
+                  << size << " but expected " << expectedSize);
+        this->clear();
+        return false;
+    }
+
+    m_NumberBuckets = header.s_NumberBuckets;
+    m_NumberSlots = header.s_NumberSlots;
+    m_PoolSize = header.s_PoolSize;
+    m_Seeds = reinterpret_cast<const std::uint32_t*>(image + sizeof(header));
+    m_Slots = reinterpret_cast<const SSlot*>(m_Seeds + m_NumberBuckets);
+    m_Pool = reinterpret_cast<const char*>(m_Slots + m_NumberSlots);
+
+    return true;
+}
+
+bool CPerfectHashWordMap::mapped() const {
+    return m_Region != nullptr;
+}
+
+std::size_t CPerfectHashWordMap::size() const {
+    return m_NumberSlots;
+}
+
+bool CPerfectHashWordMap::lookup(const std::string& word, std::uint16_t& value) const {
+    if (m_NumberSlots == 0) {
+        return false;
+    }
+
+    std::uint64_t wordHash(hash(word.data(), word.length()));
+    std::uint32_t seed(m_Seeds[mix(wordHash, 0) % m_NumberBuckets]);
+    const SSlot& slot(m_Slots[mix(wordHash, std::uint64_t(seed) + 1) % m_NumberSlots]);
+
+    // The slot's bounds are checked in case the image is corrupt
+    if (slot.s_Length != word.length() ||
+        std::uint64_t(slot.s_Offset) + slot.s_Length > m_PoolSize) {
+        return false;
+    }
+    const char* key(m_Pool + slot.s_Offset);
+    for (std::size_t i = 0; i < word.length(); ++i) {
+        if (toLower(word[i]) != key[i]) {
+            return false;
+        }
+    }
+
+    value = slot.s_Value;
+    return true;
+}
+
+std::uint64_t CPerfectHashWordMap::hash(const char* word, std::size_t length) {
+    // FNV-1a of the lower case word
+    std::uint64_t result(0xcbf29ce484222325ULL);
+    for (std::size_t i = 0; i < length; ++i) {
+        result ^= static_cast<unsigned char>(toLower(word[i]));
+        result *= 0x100000001b3ULL;
+    }
+    return result;
+}
+
+std::uint64_t CPerfectHashWordMap::mix(std::uint64_t hash, std::uint64_t seed) {
+    // The MurmurHash3 finaliser
+    hash ^= seed * 0x9e3779b97f4a7c15ULL;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+void CPerfectHashWordMap::clear() {
+    m_Region.reset();
+    m_File.reset();
+    m_NumberBuckets = 0;
+    m_NumberSlots = 0;
+    m_PoolSize = 0;
+    m_Seeds = nullptr;
+    m_Slots = nullptr;
+    m_Pool = nullptr;
+}
+}
+}
@@ -6,6 +6,7 @@
 #include <core/CStateRestoreTraverser.h>
 
 #include <core/CLogger.h>
+#include <core/CStatePersistInserter.h>
 
 namespace ml {
 namespace core {
@@ -16,6 +17,30 @@ CStateRestoreTraverser::CStateRestoreTraverser() : m_BadState(false) {
 CStateRestoreTraverser::~CStateRestoreTraverser() {
 }
 
+bool CStateRestoreTraverser::valueAs(double& result) const {
+    return CStringUtils::stringToType(this->value(), result);
+}
+
+bool CStateRestoreTraverser::copyTo(CStatePersistInserter& inserter) {
+    do {
+        if (this->hasSubLevel()) {
+            bool copied{true};
+            inserter.insertLevel(this->name(), [this, &copied](CStatePersistInserter& levelInserter) {
+                copied = this->traverseSubLevel([&levelInserter](CStateRestoreTraverser& traverser) {
+                    return traverser.copyTo(levelInserter);
+                });
+            });
+            if (copied == false) {
+                return false;
+            }
+        } else if (this->name().empty() == false) {
+            // An empty level appears as a single element with no name
+            this->copyValue(inserter);
+        }
+    } while (this->next());
+    return true;
+}
+
 bool CStateRestoreTraverser::haveBadState() const {
     return m_BadState;
 }
@@ -24,6 +49,10 @@ void CStateRestoreTraverser::setBadState() {
     m_BadState = true;
 }
 
+void CStateRestoreTraverser::copyValue(CStatePersistInserter& inserter) const {
+    inserter.insertValue(this->name(), this->value());
+}
+
 CStateRestoreTraverser::CAutoLevel::CAutoLevel(CStateRestoreTraverser& traverser)
     : m_Traverser(traverser), m_Descended(traverser.descend()), m_BadState(false) {
 }
@@ -0,0 +1,156 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include <core/CStaticThreadPool.h>
+
+#include <core/CLogger.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace ml {
+namespace core {
+
+namespace {
+
+//! \brief The state shared by the threads taking part in a parallelForEach.
+//!
+//! This is held by shared pointer because helper tasks can start after the
+//! caller has already returned, in which case they must find nothing to do.
+class CParallelForEachState {
+public:
+    CParallelForEachState(std::size_t n, const CStaticThreadPool::TSizeFunc& f)
+        : m_N(n), m_Func(f), m_Next(0), m_Completed(0) {}
+
+    //! Process indices until there are none left.
+    void run() {
+        for (std::size_t i = m_Next++; i < m_N; i = m_Next++) {
+            try {
+                m_Func(i);
+            } catch (...) {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                if (m_Exception == nullptr) {
+                    m_Exception = std::current_exception();
+                }
+            }
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            if (++m_Completed == m_N) {
+                lock.unlock();
+                m_AllCompleted.notify_all();
+            }
+        }
+    }
+
+    //! Block until every index has been processed and rethrow the
+    //! first exception if there was one.
+    void wait() {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_AllCompleted.wait(lock, [this] { return m_Completed == m_N; });
+        if (m_Exception != nullptr) {
+            std::rethrow_exception(m_Exception);
+        }
+    }
+
+private:
+    std::size_t m_N;
+    CStaticThreadPool::TSizeFunc m_Func;
+    std::atomic<std::size_t> m_Next;
+    std::size_t m_Completed;
+    std::exception_ptr m_Exception;
+    std::mutex m_Mutex;
+    std::condition_variable m_AllCompleted;
+};
+}
+
+CStaticThreadPool::CStaticThreadPool(std::size_t size) : m_Done(false) {
+    m_Workers.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        m_Workers.emplace_back([this] { this->worker(); });
+    }
+}
+
+CStaticThreadPool::~CStaticThreadPool() {
+    this->shutdown();
+}
+
+std::size_t CStaticThreadPool::size() const {
+    return m_Workers.size();
+}
+
+void CStaticThreadPool::schedule(TTask task) {
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        if (m_Done == false && m_Workers.empty() == false) {
+            m_Tasks.push_back(std::move(task));
+            lock.unlock();
+            m_TaskReady.notify_one();
+            return;
+        }
+    }
+    task();
+}
+
+void CStaticThreadPool::parallelForEach(std::size_t n, const TSizeFunc& f) {
+    if (n == 0) {
+        return;
+    }
+    if (n == 1 || m_Workers.empty()) {
+        for (std::size_t i = 0; i < n; ++i) {
+            f(i);
+        }
+        return;
+    }
+
+    auto state = std::make_shared<CParallelForEachState>(n, f);
+    std::size_t helpers{std::min(m_Workers.size(), n - 1)};
+    for (std::size_t i = 0; i < helpers; ++i) {
+        this->schedule([state] { state->run(); });
+    }
+    state->run();
+    state->wait();
+}
+
+void CStaticThreadPool::shutdown() {
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        if (m_Done) {
+            return;
+        }
+        m_Done = true;
+    }
+    m_TaskReady.notify_all();
+    for (auto& worker : m_Workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void CStaticThreadPool::worker() {
+    for (;;) {
+        TTask task;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_TaskReady.wait(lock, [this] { return m_Done || m_Tasks.empty() == false; });
+            if (m_Tasks.empty()) {
+                // Only reachable when shutting down.
+                return;
+            }
+            task = std::move(m_Tasks.front());
+            m_Tasks.pop_front();
+        }
+        try {
+            task();
+        } catch (const std::exception& e) {
+            LOG_ERROR(<< "Thread pool task failed: " << e.what());
+        } catch (...) {
+            LOG_ERROR(<< "Thread pool task failed");
+        }
+    }
+}
+}
+}
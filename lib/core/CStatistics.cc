@@ -51,6 +51,14 @@ void addStringInt(TGenericLineWriter& writer,
 
     writer.EndObject();
 }
+
+//! Check if the statistic at \p index describes the job, so is persisted.
+//! The statistics of the last background persist describe the persist
+//! which is writing the state and would differ from a foreground persist.
+bool isJobStatistic(int index) {
+    return index != stat_t::E_BackgroundPersistPauseTime &&
+           index != stat_t::E_BackgroundPersistExtraMemory;
+}
 }
 
 CStatistics::CStatistics() {
@@ -82,6 +90,9 @@ void CStatistics::staticsAcceptPersistInserter(CStatePersistInserter& inserter)
     // the copy operation.)
 
     for (int i = 0; i < stat_t::E_LastEnumStat; ++i) {
+        if (isJobStatistic(i) == false) {
+            continue;
+        }
         inserter.insertValue(KEY_TAG, i);
         inserter.insertValue(VALUE_TAG, stat(i).value());
     }
@@ -190,6 +201,30 @@ std::ostream& operator<<(std::ostream& o, const CStatistics& /*stats*/) {
                  "The number of old people or attributes pruned from the models",
                  CStatistics::stat(stat_t::E_NumberPrunedItems).value());
 
+    addStringInt(writer, "E_BackgroundPersistPauseTime",
+                 "Time in ms processing was paused to start the last background persist",
+                 CStatistics::stat(stat_t::E_BackgroundPersistPauseTime).value());
+
+    addStringInt(writer, "E_BackgroundPersistExtraMemory",
+                 "Memory in bytes the last background persist didn't share with the models",
+                 CStatistics::stat(stat_t::E_BackgroundPersistExtraMemory).value());
+
+    addStringInt(writer, "E_NumberInputBatches",
+                 "Number of record batches passed from the input reader thread",
+                 CStatistics::stat(stat_t::E_NumberInputBatches).value());
+
+    addStringInt(writer, "E_InputQueueOccupancy",
+                 "Total batches waiting in the input queue when each was taken",
+                 CStatistics::stat(stat_t::E_InputQueueOccupancy).value());
+
+    addStringInt(writer, "E_InputReaderStalls",
+                 "Number of times input reading waited because processing was behind",
+                 CStatistics::stat(stat_t::E_InputReaderStalls).value());
+
+    addStringInt(writer, "E_InputProcessorStalls",
+                 "Number of times processing waited because input reading was behind",
+                 CStatistics::stat(stat_t::E_InputProcessorStalls).value());
+
     writer.EndArray();
     writeStream.Flush();
 
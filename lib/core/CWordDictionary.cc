@@ -11,6 +11,7 @@
 #include <core/CStrCaseCmp.h>
 #include <core/CStringUtils.h>
 
+#include <cstdint>
 #include <fstream>
 
 #include <ctype.h>
@@ -63,9 +64,57 @@ CWordDictionary::EPartOfSpeech partOfSpeechFromCode(char partOfSpeechCode) {
     // This should be treated as an error when returned by this function
     return CWordDictionary::E_NotInDictionary;
 }
+
+//! Read the words in the dictionary file \p fileName and call \p f for
+//! each word with its part of speech.
+template<typename F>
+bool readDictionary(const std::string& fileName, F f) {
+    // If the file can't be read for some reason, we just end up with an empty
+    // dictionary
+    std::ifstream ifs(fileName.c_str());
+    if (ifs.is_open() == false) {
+        LOG_ERROR(<< "Failed to open dictionary file " << fileName);
+        return false;
+    }
+
+    LOG_DEBUG(<< "Populating word dictionary from file " << fileName);
+
+    std::string word;
+    while (std::getline(ifs, word)) {
+        CStringUtils::trimWhitespace(word);
+        if (word.empty()) {
+            continue;
+        }
+        size_t sepPos(word.find(PART_OF_SPEECH_SEPARATOR));
+        if (sepPos == std::string::npos) {
+            LOG_ERROR(<< "Found word with no part-of-speech separator: " << word);
+            continue;
+        }
+        if (sepPos == 0) {
+            LOG_ERROR(<< "Found part-of-speech separator with no preceding word: " << word);
+            continue;
+        }
+        if (sepPos + 1 >= word.length()) {
+            LOG_ERROR(<< "Found word with no part-of-speech code: " << word);
+            continue;
+        }
+        char partOfSpeechCode(word[sepPos + 1]);
+        CWordDictionary::EPartOfSpeech partOfSpeech(partOfSpeechFromCode(partOfSpeechCode));
+        if (partOfSpeech == CWordDictionary::E_NotInDictionary) {
+            LOG_ERROR(<< "Unknown part-of-speech code (" << partOfSpeechCode
+                      << ") for word: " << word);
+            continue;
+        }
+        word.erase(sepPos);
+        f(word, partOfSpeech);
+    }
+
+    return true;
+}
 }
 
 const char* const CWordDictionary::DICTIONARY_FILE("ml-en.dict");
+const char* const CWordDictionary::COMPILED_DICTIONARY_FILE("ml-en.dict.mph");
 
 CFastMutex CWordDictionary::ms_LoadMutex;
 volatile CWordDictionary* CWordDictionary::ms_Instance(nullptr);
@@ -88,10 +137,15 @@ const CWordDictionary& CWordDictionary::instance() {
 }
 
 bool CWordDictionary::isInDictionary(const std::string& str) const {
-    return m_DictionaryWords.find(str) != m_DictionaryWords.end();
+    return this->partOfSpeech(str) != E_NotInDictionary;
 }
 
 CWordDictionary::EPartOfSpeech CWordDictionary::partOfSpeech(const std::string& str) const {
+    if (m_CompiledWords.mapped()) {
+        std::uint16_t partOfSpeech(E_NotInDictionary);
+        m_CompiledWords.lookup(str, partOfSpeech);
+        return static_cast<EPartOfSpeech>(partOfSpeech);
+    }
     TStrUMapCItr iter = m_DictionaryWords.find(str);
     if (iter == m_DictionaryWords.end()) {
         return E_NotInDictionary;
@@ -99,48 +153,45 @@ CWordDictionary::EPartOfSpeech CWordDictionary::partOfSpeech(const std::string&
     return iter->second;
 }
 
+bool CWordDictionary::compile(const std::string& dictionaryFile, const std::string& compiledFile) {
+    CPerfectHashWordMap::TStrUInt16PrVec words;
+    if (readDictionary(dictionaryFile, [&words](const std::string& word, EPartOfSpeech partOfSpeech) {
+            words.emplace_back(word, static_cast<std::uint16_t>(partOfSpeech));
+        }) == false) {
+        return false;
+    }
+
+    std::ofstream ofs(compiledFile.c_str(), std::ios::binary | std::ios::trunc);
+    if (ofs.is_open() == false) {
+        LOG_ERROR(<< "Failed to open " << compiledFile << " for writing");
+        return false;
+    }
+    if (CPerfectHashWordMap::write(words, ofs) == false) {
+        LOG_ERROR(<< "Failed to write compiled dictionary " << compiledFile);
+        return false;
+    }
+
+    LOG_DEBUG(<< "Compiled " << words.size() << " words from " << dictionaryFile
+              << " into " << compiledFile);
+
+    return true;
+}
+
 CWordDictionary::CWordDictionary() {
-    std::string fileToLoad(CResourceLocator::resourceDir() + '/' + DICTIONARY_FILE);
+    std::string resourceDir(CResourceLocator::resourceDir());
 
-    // If the file can't be read for some reason, we just end up with an empty
-    // dictionary
-    std::ifstream ifs(fileToLoad.c_str());
-    if (ifs.is_open()) {
-        LOG_DEBUG(<< "Populating word dictionary from file " << fileToLoad);
-
-        std::string word;
-        while (std::getline(ifs, word)) {
-            CStringUtils::trimWhitespace(word);
-            if (word.empty()) {
-                continue;
-            }
-            size_t sepPos(word.find(PART_OF_SPEECH_SEPARATOR));
-            if (sepPos == std::string::npos) {
-                LOG_ERROR(<< "Found word with no part-of-speech separator: " << word);
-                continue;
-            }
-            if (sepPos == 0) {
-                LOG_ERROR(<< "Found part-of-speech separator with no preceding word: " << word);
-                continue;
-            }
-            if (sepPos + 1 >= word.length()) {
-                LOG_ERROR(<< "Found word with no part-of-speech code: " << word);
-                continue;
-            }
-            char partOfSpeechCode(word[sepPos + 1]);
-            EPartOfSpeech partOfSpeech(partOfSpeechFromCode(partOfSpeechCode));
-            if (partOfSpeech == E_NotInDictionary) {
-                LOG_ERROR(<< "Unknown part-of-speech code (" << partOfSpeechCode
-                          << ") for word: " << word);
-                continue;
-            }
-            word.erase(sepPos);
-            m_DictionaryWords[word] = partOfSpeech;
-        }
+    std::string compiledFile(resourceDir + '/' + COMPILED_DICTIONARY_FILE);
+    if (m_CompiledWords.map(compiledFile)) {
+        LOG_DEBUG(<< "Mapped word dictionary with " << m_CompiledWords.size()
+                  << " words from file " << compiledFile);
+        return;
+    }
 
+    if (readDictionary(resourceDir + '/' + DICTIONARY_FILE,
+                       [this](const std::string& word, EPartOfSpeech partOfSpeech) {
+                           m_DictionaryWords[word] = partOfSpeech;
+                       })) {
         LOG_DEBUG(<< "Populated word dictionary with " << m_DictionaryWords.size() << " words");
-    } else {
-        LOG_ERROR(<< "Failed to open dictionary file " << fileToLoad);
     }
 }
 
@@ -0,0 +1,371 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include "CBinaryStateRestoreTraverserTest.h"
+
+#include <core/CBinaryStatePersistInserter.h>
+#include <core/CBinaryStateRestoreTraverser.h>
+#include <core/CJsonStatePersistInserter.h>
+#include <core/CLogger.h>
+#include <core/CStringUtils.h>
+
+#include <sstream>
+
+CppUnit::Test* CBinaryStateRestoreTraverserTest::suite() {
+    CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CBinaryStateRestoreTraverserTest");
+
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStateRestoreTraverserTest>(
+        "CBinaryStateRestoreTraverserTest::testRestore",
+        &CBinaryStateRestoreTraverserTest::testRestore));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStateRestoreTraverserTest>(
+        "CBinaryStateRestoreTraverserTest::testRestoreEmptyLevel",
+        &CBinaryStateRestoreTraverserTest::testRestoreEmptyLevel));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStateRestoreTraverserTest>(
+        "CBinaryStateRestoreTraverserTest::testRestoreSkippingLevels",
+        &CBinaryStateRestoreTraverserTest::testRestoreSkippingLevels));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStateRestoreTraverserTest>(
+        "CBinaryStateRestoreTraverserTest::testDoubles",
+        &CBinaryStateRestoreTraverserTest::testDoubles));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStateRestoreTraverserTest>(
+        "CBinaryStateRestoreTraverserTest::testCopy", &CBinaryStateRestoreTraverserTest::testCopy));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStateRestoreTraverserTest>(
+        "CBinaryStateRestoreTraverserTest::testIsBinaryState",
+        &CBinaryStateRestoreTraverserTest::testIsBinaryState));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBinaryStateRestoreTraverserTest>(
+        "CBinaryStateRestoreTraverserTest::testCorruptState",
+        &CBinaryStateRestoreTraverserTest::testCorruptState));
+
+    return suiteOfTests;
+}
+
+namespace {
+
+void insert3rdLevel(ml::core::CStatePersistInserter& inserter) {
+    inserter.insertValue("level3A", "deep");
+}
+
+void insert2ndLevel(ml::core::CStatePersistInserter& inserter) {
+    inserter.insertValue("level2A", 3.14, ml::core::CIEEE754::E_SinglePrecision);
+    inserter.insertLevel("level2B", &insert3rdLevel);
+    inserter.insertValue("level2C", 'z');
+}
+
+void insertEmptyLevel(ml::core::CStatePersistInserter&) {
+}
+
+void insert1stLevel(ml::core::CStatePersistInserter& inserter) {
+    inserter.insertValue("level1A", "a");
+    inserter.insertValue("level1B", 25);
+    inserter.insertLevel("level1C", &insert2ndLevel);
+    inserter.insertLevel("level1D", &insertEmptyLevel);
+    inserter.insertValue("level1E", "afterAscending");
+}
+
+std::string persist() {
+    std::ostringstream strm;
+    {
+        ml::core::CBinaryStatePersistInserter inserter(strm);
+        inserter.insertLevel("_source", &insert1stLevel);
+    }
+    return strm.str();
+}
+
+bool traverse3rdLevel(ml::core::CStateRestoreTraverser& traverser) {
+    CPPUNIT_ASSERT_EQUAL(std::string("level3A"), traverser.name());
+    CPPUNIT_ASSERT_EQUAL(std::string("deep"), traverser.value());
+    CPPUNIT_ASSERT(!traverser.next());
+    return true;
+}
+
+bool traverse2ndLevel(ml::core::CStateRestoreTraverser& traverser) {
+    CPPUNIT_ASSERT_EQUAL(std::string("level2A"), traverser.name());
+    CPPUNIT_ASSERT_EQUAL(std::string("3.14"), traverser.value());
+    CPPUNIT_ASSERT(!traverser.hasSubLevel());
+    CPPUNIT_ASSERT(traverser.next());
+    CPPUNIT_ASSERT_EQUAL(std::string("level2B"), traverser.name());
+    CPPUNIT_ASSERT(traverser.hasSubLevel());
+    CPPUNIT_ASSERT(traverser.traverseSubLevel(&traverse3rdLevel));
+    CPPUNIT_ASSERT(traverser.next());
+    CPPUNIT_ASSERT_EQUAL(std::string("level2C"), traverser.name());
+    CPPUNIT_ASSERT_EQUAL(std::string("z"), traverser.value());
+    CPPUNIT_ASSERT(!traverser.hasSubLevel());
+    CPPUNIT_ASSERT(!traverser.next());
+    return true;
+}
+
+bool traverseEmptyLevel(ml::core::CStateRestoreTraverser& traverser) {
+    CPPUNIT_ASSERT(traverser.name().empty());
+    CPPUNIT_ASSERT(traverser.value().empty());
+    CPPUNIT_ASSERT(!traverser.hasSubLevel());
+    CPPUNIT_ASSERT(!traverser.next());
+    return true;
+}
+
+bool traverse1stLevel(ml::core::CStateRestoreTraverser& traverser) {
+    CPPUNIT_ASSERT_EQUAL(std::string("level1A"), traverser.name());
+    CPPUNIT_ASSERT_EQUAL(std::string("a"), traverser.value());
+    CPPUNIT_ASSERT(!traverser.hasSubLevel());
+    CPPUNIT_ASSERT(traverser.next());
+    CPPUNIT_ASSERT_EQUAL(std::string("level1B"), traverser.name());
+    CPPUNIT_ASSERT_EQUAL(std::string("25"), traverser.value());
+    CPPUNIT_ASSERT(!traverser.hasSubLevel());
+    CPPUNIT_ASSERT(traverser.next());
+    CPPUNIT_ASSERT_EQUAL(std::string("level1C"), traverser.name());
+    CPPUNIT_ASSERT(traverser.hasSubLevel());
+    CPPUNIT_ASSERT(traverser.traverseSubLevel(&traverse2ndLevel));
+    CPPUNIT_ASSERT(traverser.next());
+    CPPUNIT_ASSERT_EQUAL(std::string("level1D"), traverser.name());
+    CPPUNIT_ASSERT(traverser.hasSubLevel());
+    CPPUNIT_ASSERT(traverser.traverseSubLevel(&traverseEmptyLevel));
+    CPPUNIT_ASSERT(traverser.next());
+    CPPUNIT_ASSERT_EQUAL(std::string("level1E"), traverser.name());
+    CPPUNIT_ASSERT_EQUAL(std::string("afterAscending"), traverser.value());
+    CPPUNIT_ASSERT(!traverser.hasSubLevel());
+    CPPUNIT_ASSERT(!traverser.next());
+    return true;
+}
+
+bool traverse1stLevelSkipping(ml::core::CStateRestoreTraverser& traverser) {
+    CPPUNIT_ASSERT_EQUAL(std::string("level1A"), traverser.name());
+    CPPUNIT_ASSERT(traverser.next());
+    CPPUNIT_ASSERT(traverser.next());
+    CPPUNIT_ASSERT_EQUAL(std::string("level1C"), traverser.name());
+    // Skip the nested levels of level1C.
+    CPPUNIT_ASSERT(traverser.next());
+    CPPUNIT_ASSERT_EQUAL(std::string("level1D"), traverser.name());
+    CPPUNIT_ASSERT(traverser.next());
+    CPPUNIT_ASSERT_EQUAL(std::string("level1E"), traverser.name());
+    CPPUNIT_ASSERT(!traverser.next());
+    return true;
+}
+
+bool traverse1stLevelPartially(ml::core::CStateRestoreTraverser& traverser) {
+    CPPUNIT_ASSERT_EQUAL(std::string("level1A"), traverser.name());
+    CPPUNIT_ASSERT(traverser.next());
+    CPPUNIT_ASSERT(traverser.next());
+    CPPUNIT_ASSERT_EQUAL(std::string("level1C"), traverser.name());
+    // Stop after the first element of level1C.
+    return traverser.traverseSubLevel([](ml::core::CStateRestoreTraverser& traverser_) {
+        return traverser_.name() == "level2A";
+    });
+}
+}
+
+void CBinaryStateRestoreTraverserTest::testRestore() {
+    std::istringstream strm(persist());
+
+    ml::core::CBinaryStateRestoreTraverser traverser(strm);
+
+    CPPUNIT_ASSERT(!traverser.isEof());
+    CPPUNIT_ASSERT_EQUAL(std::string("_source"), traverser.name());
+    CPPUNIT_ASSERT(traverser.hasSubLevel());
+    CPPUNIT_ASSERT(traverser.traverseSubLevel(&traverse1stLevel));
+    CPPUNIT_ASSERT(!traverser.next());
+    CPPUNIT_ASSERT(traverser.isEof());
+    CPPUNIT_ASSERT(!traverser.haveBadState());
+}
+
+void CBinaryStateRestoreTraverserTest::testRestoreEmptyLevel() {
+    std::ostringstream strm;
+    {
+        ml::core::CBinaryStatePersistInserter inserter(strm);
+    }
+    std::istringstream istrm(strm.str());
+
+    ml::core::CBinaryStateRestoreTraverser traverser(istrm);
+
+    CPPUNIT_ASSERT(traverser.name().empty());
+    CPPUNIT_ASSERT(traverser.isEof());
+    CPPUNIT_ASSERT(!traverser.hasSubLevel());
+    CPPUNIT_ASSERT(!traverser.next());
+    CPPUNIT_ASSERT(!traverser.haveBadState());
+}
+
+void CBinaryStateRestoreTraverserTest::testRestoreSkippingLevels() {
+    {
+        std::istringstream strm(persist());
+        ml::core::CBinaryStateRestoreTraverser traverser(strm);
+        CPPUNIT_ASSERT(traverser.traverseSubLevel(&traverse1stLevelSkipping));
+        CPPUNIT_ASSERT(!traverser.next());
+        CPPUNIT_ASSERT(traverser.isEof());
+    }
+    {
+        // Ascending should skip anything which wasn't read.
+        std::istringstream strm(persist());
+        ml::core::CBinaryStateRestoreTraverser traverser(strm);
+        CPPUNIT_ASSERT(traverser.traverseSubLevel(&traverse1stLevelPartially));
+        CPPUNIT_ASSERT(!traverser.next());
+        CPPUNIT_ASSERT(traverser.isEof());
+        CPPUNIT_ASSERT(!traverser.haveBadState());
+    }
+}
+
+void CBinaryStateRestoreTraverserTest::testDoubles() {
+    const double values[]{0.0, -1.0, 3.14159265358979, 1e-300, 2.5e300, 1.0 / 3.0};
+
+    std::ostringstream binary;
+    std::ostringstream json;
+    {
+        ml::core::CBinaryStatePersistInserter binaryInserter(binary);
+        ml::core::CJsonStatePersistInserter jsonInserter(json);
+        for (auto precision : {ml::core::CIEEE754::E_HalfPrecision,
+                               ml::core::CIEEE754::E_SinglePrecision,
+                               ml::core::CIEEE754::E_DoublePrecision}) {
+            for (double value : values) {
+                binaryInserter.insertValue("d", value, precision);
+                jsonInserter.insertValue("d", value, precision);
+            }
+        }
+    }
+    LOG_DEBUG(<< "Binary size = " << binary.str().size()
+              << ", JSON size = " << json.str().size());
+
+    std::istringstream strm(binary.str());
+    ml::core::CBinaryStateRestoreTraverser traverser(strm);
+    for (auto precision : {ml::core::CIEEE754::E_HalfPrecision,
+                           ml::core::CIEEE754::E_SinglePrecision,
+                           ml::core::CIEEE754::E_DoublePrecision}) {
+        for (double value : values) {
+            CPPUNIT_ASSERT_EQUAL(std::string("d"), traverser.name());
+
+            // The value is stored raw at the requested precision.
+            double restored;
+            CPPUNIT_ASSERT(traverser.valueAs(restored));
+            CPPUNIT_ASSERT_EQUAL(ml::core::CIEEE754::round(value, precision), restored);
+
+            // The string is the same as we'd get from the other formats.
+            CPPUNIT_ASSERT_EQUAL(ml::core::CStringUtils::typeToStringPrecise(value, precision),
+                                 traverser.value());
+
+            traverser.next();
+        }
+    }
+    CPPUNIT_ASSERT(traverser.isEof());
+}
+
+void CBinaryStateRestoreTraverserTest::testCopy() {
+    std::string original(persist());
+
+    // Copying to the same format should reproduce the state exactly,
+    // including the raw doubles and empty levels.
+    {
+        std::istringstream strm(original);
+        ml::core::CBinaryStateRestoreTraverser traverser(strm);
+        std::ostringstream copy;
+        {
+            ml::core::CBinaryStatePersistInserter inserter(copy);
+            CPPUNIT_ASSERT(traverser.copyTo(inserter));
+        }
+        CPPUNIT_ASSERT(original == copy.str());
+    }
+
+    // Copying to JSON should be the same as persisting to JSON.
+    {
+        std::ostringstream expected;
+        {
+            ml::core::CJsonStatePersistInserter inserter(expected);
+            inserter.insertLevel("_source", &insert1stLevel);
+        }
+        std::istringstream strm(original);
+        ml::core::CBinaryStateRestoreTraverser traverser(strm);
+        std::ostringstream copy;
+        {
+            ml::core::CJsonStatePersistInserter inserter(copy);
+            CPPUNIT_ASSERT(traverser.copyTo(inserter));
+        }
+        LOG_DEBUG(<< "JSON copy = " << copy.str());
+        CPPUNIT_ASSERT_EQUAL(expected.str(), copy.str());
+    }
+
+    // Copy just a sub-level and check it can be restored on its own.
+    {
+        std::istringstream strm(original);
+        ml::core::CBinaryStateRestoreTraverser traverser(strm);
+        std::ostringstream copy;
+        {
+            ml::core::CBinaryStatePersistInserter inserter(copy);
+            CPPUNIT_ASSERT(traverser.traverseSubLevel(
+                [&inserter](ml::core::CStateRestoreTraverser& traverser_) {
+                    return traverser_.copyTo(inserter);
+                }));
+        }
+        std::istringstream copyStrm(copy.str());
+        ml::core::CBinaryStateRestoreTraverser copyTraverser(copyStrm);
+        CPPUNIT_ASSERT(traverse1stLevel(copyTraverser));
+    }
+}
+
+void CBinaryStateRestoreTraverserTest::testIsBinaryState() {
+    {
+        std::istringstream strm(persist());
+        CPPUNIT_ASSERT(ml::core::CBinaryStateRestoreTraverser::isBinaryState(strm));
+        // Checking mustn't consume anything.
+        ml::core::CBinaryStateRestoreTraverser traverser(strm);
+        CPPUNIT_ASSERT_EQUAL(std::string("_source"), traverser.name());
+    }
+    {
+        std::ostringstream json;
+        {
+            ml::core::CJsonStatePersistInserter inserter(json);
+            inserter.insertLevel("_source", &insert1stLevel);
+        }
+        std::istringstream strm(json.str());
+        CPPUNIT_ASSERT(!ml::core::CBinaryStateRestoreTraverser::isBinaryState(strm));
+    }
+    {
+        std::istringstream strm;
+        CPPUNIT_ASSERT(!ml::core::CBinaryStateRestoreTraverser::isBinaryState(strm));
+    }
+}
+
+void CBinaryStateRestoreTraverserTest::testCorruptState() {
+    std::string state(persist());
+
+    // Truncated.
+    {
+        std::istringstream strm(state.substr(0, state.size() / 2));
+        ml::core::CBinaryStateRestoreTraverser traverser(strm);
+        CPPUNIT_ASSERT(!traverser.traverseSubLevel(&traverse1stLevel) ||
+                       traverser.haveBadState());
+        CPPUNIT_ASSERT(traverser.haveBadState());
+        CPPUNIT_ASSERT(traverser.isEof());
+    }
+
+    // Missing header.
+    {
+        std::istringstream strm(state.substr(1));
+        ml::core::CBinaryStateRestoreTraverser traverser(strm);
+        CPPUNIT_ASSERT(traverser.name().empty());
+        CPPUNIT_ASSERT(traverser.isEof());
+        CPPUNIT_ASSERT(!traverser.next());
+        CPPUNIT_ASSERT(traverser.haveBadState());
+    }
+
+    // Unknown token.
+    {
+        std::string corrupt(state);
+        corrupt[ml::core::CBinaryStatePersistInserter::HEADER.size()] = 'X';
+        std::istringstream strm(corrupt);
+        ml::core::CBinaryStateRestoreTraverser traverser(strm);
+        CPPUNIT_ASSERT(!traverser.hasSubLevel());
+        CPPUNIT_ASSERT(traverser.isEof());
+        CPPUNIT_ASSERT(traverser.haveBadState());
+    }
+
+    // A string length far longer than the input.
+    {
+        std::string corrupt(ml::core::CBinaryStatePersistInserter::HEADER);
+        corrupt += ml::core::CBinaryStatePersistInserter::START_LEVEL;
+        corrupt += std::string(8, '\xff');
+        corrupt += '\x3f';
+        corrupt += "name";
+        std::istringstream strm(corrupt);
+        ml::core::CBinaryStateRestoreTraverser traverser(strm);
+        CPPUNIT_ASSERT(traverser.name().empty());
+        CPPUNIT_ASSERT(traverser.isEof());
+        CPPUNIT_ASSERT(!traverser.next());
+        CPPUNIT_ASSERT(traverser.haveBadState());
+    }
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#include "CPerfectHashWordMapTest.h"
+
+#include <core/CLogger.h>
+#include <core/CPerfectHashWordMap.h>
+#include <core/CStringUtils.h>
+
+#include <test/CTestTmpDir.h>
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include <stdio.h>
+
+CppUnit::Test* CPerfectHashWordMapTest::suite() {
+    CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CPerfectHashWordMapTest");
+
+    suiteOfTests->addTest(new CppUnit::TestCaller<CPerfectHashWordMapTest>(
+        "CPerfectHashWordMapTest::testLookups", &CPerfectHashWordMapTest::testLookups));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CPerfectHashWordMapTest>(
+        "CPerfectHashWordMapTest::testEmpty", &CPerfectHashWordMapTest::testEmpty));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CPerfectHashWordMapTest>(
+        "CPerfectHashWordMapTest::testInvalidImages",
+        &CPerfectHashWordMapTest::testInvalidImages));
+
+    return suiteOfTests;
+}
+
+namespace {
+using TStrUInt16PrVec = ml::core::CPerfectHashWordMap::TStrUInt16PrVec;
+
+bool writeImage(const TStrUInt16PrVec& words, const std::string& fileName) {
+    std::ofstream ofs(fileName.c_str(), std::ios::binary | std::ios::trunc);
+    return ofs.is_open() && ml::core::CPerfectHashWordMap::write(words, ofs);
+}
+
+std::string readImage(const std::string& fileName) {
+    std::ifstream ifs(fileName.c_str(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+void writeRaw(const std::string& image, const std::string& fileName) {
+    std::ofstream ofs(fileName.c_str(), std::ios::binary | std::ios::trunc);
+    ofs << image;
+}
+}
+
+void CPerfectHashWordMapTest::testLookups() {
+    TStrUInt16PrVec words;
+    for (std::uint16_t i = 0; i < 20000; ++i) {
+        words.emplace_back("word" + ml::core::CStringUtils::typeToString(i), i);
+    }
+    words.emplace_back("Hello", 1);
+    words.emplace_back("HELLO", 2);
+    words.emplace_back("a", 3);
+
+    std::string fileName(ml::test::CTestTmpDir::tmpDir() + "/lookups.mph");
+    CPPUNIT_ASSERT(writeImage(words, fileName));
+
+    {
+        ml::core::CPerfectHashWordMap map;
+        CPPUNIT_ASSERT(map.map(fileName));
+        CPPUNIT_ASSERT(map.mapped());
+        CPPUNIT_ASSERT_EQUAL(std::size_t(20002), map.size());
+
+        std::uint16_t value(0);
+        for (std::uint16_t i = 0; i < 20000; ++i) {
+            std::string word("word" + ml::core::CStringUtils::typeToString(i));
+            CPPUNIT_ASSERT_MESSAGE(word, map.lookup(word, value));
+            CPPUNIT_ASSERT_EQUAL(i, value);
+            word[0] = 'W';
+            CPPUNIT_ASSERT_MESSAGE(word, map.lookup(word, value));
+            CPPUNIT_ASSERT_EQUAL(i, value);
+        }
+
+        // The last duplicate ignoring case wins
+        CPPUNIT_ASSERT(map.lookup("hello", value));
+        CPPUNIT_ASSERT_EQUAL(std::uint16_t(2), value);
+        CPPUNIT_ASSERT(map.lookup("hElLo", value));
+        CPPUNIT_ASSERT_EQUAL(std::uint16_t(2), value);
+        CPPUNIT_ASSERT(map.lookup("A", value));
+        CPPUNIT_ASSERT_EQUAL(std::uint16_t(3), value);
+
+        value = 999;
+        CPPUNIT_ASSERT(!map.lookup("", value));
+        CPPUNIT_ASSERT(!map.lookup("b", value));
+        CPPUNIT_ASSERT(!map.lookup("word20000", value));
+        CPPUNIT_ASSERT(!map.lookup("hello2", value));
+        CPPUNIT_ASSERT(!map.lookup("hell", value));
+        CPPUNIT_ASSERT_EQUAL(std::uint16_t(999), value);
+    }
+
+    CPPUNIT_ASSERT_EQUAL(0, ::remove(fileName.c_str()));
+}
+
+void CPerfectHashWordMapTest::testEmpty() {
+    std::string fileName(ml::test::CTestTmpDir::tmpDir() + "/empty.mph");
+    CPPUNIT_ASSERT(writeImage(TStrUInt16PrVec(), fileName));
+
+    {
+        ml::core::CPerfectHashWordMap map;
+        CPPUNIT_ASSERT(map.map(fileName));
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), map.size());
+
+        std::uint16_t value(0);
+        CPPUNIT_ASSERT(!map.lookup("hello", value));
+        CPPUNIT_ASSERT(!map.lookup("", value));
+    }
+
+    CPPUNIT_ASSERT_EQUAL(0, ::remove(fileName.c_str()));
+}
+
+void CPerfectHashWordMapTest::testInvalidImages() {
+    std::string fileName(ml::test::CTestTmpDir::tmpDir() + "/invalid.mph");
+
+    ml::core::CPerfectHashWordMap map;
+    std::uint16_t value(0);
+
+    // Missing file
+    ::remove(fileName.c_str());
+    CPPUNIT_ASSERT(!map.map(fileName));
+    CPPUNIT_ASSERT(!map.mapped());
+
+    TStrUInt16PrVec words{{"hello", 1}, {"world", 2}, {"service", 3}};
+    CPPUNIT_ASSERT(writeImage(words, fileName));
+    std::string image(readImage(fileName));
+    {
+        ml::core::CPerfectHashWordMap valid;
+        CPPUNIT_ASSERT(valid.map(fileName));
+        CPPUNIT_ASSERT(valid.lookup("world", value));
+    }
+
+    // Truncated
+    writeRaw(image.substr(0, image.size() - 1), fileName);
+    CPPUNIT_ASSERT(!map.map(fileName));
+    CPPUNIT_ASSERT(!map.mapped());
+    CPPUNIT_ASSERT(!map.lookup("world", value));
+
+    writeRaw(image.substr(0, 10), fileName);
+    CPPUNIT_ASSERT(!map.map(fileName));
+
+    // Trailing garbage
+    writeRaw(image + "x", fileName);
+    CPPUNIT_ASSERT(!map.map(fileName));
+
+    // Bad magic
+    std::string badMagic(image);
+    badMagic[0] = 'X';
+    writeRaw(badMagic, fileName);
+    CPPUNIT_ASSERT(!map.map(fileName));
+
+    // Bad version
+    std::string badVersion(image);
+    badVersion[4] = 99;
+    writeRaw(badVersion, fileName);
+    CPPUNIT_ASSERT(!map.map(fileName));
+
+    // Other byte order
+    std::string badByteOrder(image);
+    std::swap(badByteOrder[8], badByteOrder[11]);
+    std::swap(badByteOrder[9], badByteOrder[10]);
+    writeRaw(badByteOrder, fileName);
+    CPPUNIT_ASSERT(!map.map(fileName));
+
+    // An image can be mapped again after a failure
+    writeRaw(image, fileName);
+    CPPUNIT_ASSERT(map.map(fileName));
+    CPPUNIT_ASSERT(map.lookup("SERVICE", value));
+    CPPUNIT_ASSERT_EQUAL(std::uint16_t(3), value);
+
+    // Failing to map an image unmaps the current one
+    CPPUNIT_ASSERT(!map.map(fileName + ".missing"));
+    CPPUNIT_ASSERT(!map.mapped());
+
+    CPPUNIT_ASSERT_EQUAL(0, ::remove(fileName.c_str()));
+}
@@ -0,0 +1,20 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_CPerfectHashWordMapTest_h
+#define INCLUDED_CPerfectHashWordMapTest_h
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class CPerfectHashWordMapTest : public CppUnit::TestFixture {
+public:
+    void testLookups();
+    void testEmpty();
+    void testInvalidImages();
+
+    static CppUnit::Test* suite();
+};
+
+#endif // INCLUDED_CPerfectHashWordMapTest_h
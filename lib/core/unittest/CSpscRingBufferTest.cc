@@ -0,0 +1,132 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#include "CSpscRingBufferTest.h"
+
+#include <core/CLogger.h>
+#include <core/CSpscRingBuffer.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace ml;
+
+void CSpscRingBufferTest::testSingleThreaded() {
+    core::CSpscRingBuffer<int> queue{3};
+    CPPUNIT_ASSERT_EQUAL(std::size_t(3), queue.capacity());
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), queue.size());
+
+    // Wrap around the buffer a few times.
+    int item{-1};
+    for (int i = 0; i < 10; ++i) {
+        queue.push(2 * i);
+        queue.push(2 * i + 1);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(2), queue.size());
+        queue.pop(item);
+        CPPUNIT_ASSERT_EQUAL(2 * i, item);
+        queue.pop(item);
+        CPPUNIT_ASSERT_EQUAL(2 * i + 1, item);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), queue.size());
+    }
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), queue.producerStalls());
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), queue.consumerStalls());
+
+    // Move only types are supported.
+    core::CSpscRingBuffer<std::unique_ptr<int>> pointers{2};
+    pointers.push(std::unique_ptr<int>(new int(5)));
+    std::unique_ptr<int> pointer;
+    pointers.pop(pointer);
+    CPPUNIT_ASSERT(pointer != nullptr);
+    CPPUNIT_ASSERT_EQUAL(5, *pointer);
+}
+
+void CSpscRingBufferTest::testOrderAcrossThreads() {
+    const std::size_t n{100000};
+
+    for (std::size_t capacity : {1, 2, 7, 64}) {
+        core::CSpscRingBuffer<std::size_t> queue{capacity};
+
+        std::thread producer([&queue, n] {
+            for (std::size_t i = 0; i < n; ++i) {
+                queue.push(i);
+            }
+        });
+
+        std::vector<std::size_t> received;
+        received.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            std::size_t item;
+            queue.pop(item);
+            received.push_back(item);
+        }
+        producer.join();
+
+        LOG_DEBUG(<< "capacity = " << capacity << ", producer stalls = "
+                  << queue.producerStalls()
+                  << ", consumer stalls = " << queue.consumerStalls());
+
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), queue.size());
+        for (std::size_t i = 0; i < n; ++i) {
+            CPPUNIT_ASSERT_EQUAL(i, received[i]);
+        }
+    }
+}
+
+void CSpscRingBufferTest::testStalls() {
+    // A slow consumer should stall the producer.
+    {
+        core::CSpscRingBuffer<int> queue{2};
+        std::thread producer([&queue] {
+            for (int i = 0; i < 10; ++i) {
+                queue.push(i);
+            }
+        });
+        int item;
+        for (int i = 0; i < 10; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            queue.pop(item);
+            CPPUNIT_ASSERT_EQUAL(i, item);
+        }
+        producer.join();
+        LOG_DEBUG(<< "producer stalls = " << queue.producerStalls());
+        CPPUNIT_ASSERT(queue.producerStalls() > 0);
+    }
+
+    // A slow producer should stall the consumer.
+    {
+        core::CSpscRingBuffer<int> queue{2};
+        std::thread producer([&queue] {
+            for (int i = 0; i < 10; ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                queue.push(i);
+            }
+        });
+        int item;
+        for (int i = 0; i < 10; ++i) {
+            queue.pop(item);
+            CPPUNIT_ASSERT_EQUAL(i, item);
+        }
+        producer.join();
+        LOG_DEBUG(<< "consumer stalls = " << queue.consumerStalls());
+        CPPUNIT_ASSERT(queue.consumerStalls() > 0);
+    }
+}
+
+CppUnit::Test* CSpscRingBufferTest::suite() {
+    CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CSpscRingBufferTest");
+
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSpscRingBufferTest>(
+        "CSpscRingBufferTest::testSingleThreaded", &CSpscRingBufferTest::testSingleThreaded));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSpscRingBufferTest>(
+        "CSpscRingBufferTest::testOrderAcrossThreads",
+        &CSpscRingBufferTest::testOrderAcrossThreads));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSpscRingBufferTest>(
+        "CSpscRingBufferTest::testStalls", &CSpscRingBufferTest::testStalls));
+
+    return suiteOfTests;
+}
@@ -0,0 +1,21 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#ifndef INCLUDED_CSpscRingBufferTest_h
+#define INCLUDED_CSpscRingBufferTest_h
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class CSpscRingBufferTest : public CppUnit::TestFixture {
+public:
+    void testSingleThreaded();
+    void testOrderAcrossThreads();
+    void testStalls();
+
+    static CppUnit::Test* suite();
+};
+
+#endif /* INCLUDED_CSpscRingBufferTest_h */
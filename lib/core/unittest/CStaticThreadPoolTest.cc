@@ -0,0 +1,143 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#include "CStaticThreadPoolTest.h"
+
+#include <core/CLogger.h>
+#include <core/CStaticThreadPool.h>
+
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace ml;
+
+void CStaticThreadPoolTest::testSchedule() {
+    std::atomic<std::size_t> count{0};
+    {
+        core::CStaticThreadPool pool{4};
+        CPPUNIT_ASSERT_EQUAL(std::size_t(4), pool.size());
+        for (std::size_t i = 0; i < 1000; ++i) {
+            pool.schedule([&count] { ++count; });
+        }
+        // The destructor must finish all queued tasks.
+    }
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1000), count.load());
+
+    // Tasks scheduled after shutdown run on the calling thread.
+    core::CStaticThreadPool pool{2};
+    pool.shutdown();
+    std::thread::id id;
+    pool.schedule([&id] { id = std::this_thread::get_id(); });
+    CPPUNIT_ASSERT(id == std::this_thread::get_id());
+}
+
+void CStaticThreadPoolTest::testParallelForEach() {
+    core::CStaticThreadPool pool{3};
+
+    for (std::size_t n : {0, 1, 2, 3, 4, 17, 1000}) {
+        std::vector<std::size_t> calls(n, 0);
+        pool.parallelForEach(n, [&calls](std::size_t i) { calls[i] += i + 1; });
+        std::vector<std::size_t> expected(n);
+        std::iota(expected.begin(), expected.end(), 1);
+        CPPUNIT_ASSERT(calls == expected);
+    }
+
+    // Check very uneven task costs are handled.
+    std::vector<std::size_t> calls(20, 0);
+    pool.parallelForEach(calls.size(), [&calls](std::size_t i) {
+        if (i % 5 == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        ++calls[i];
+    });
+    CPPUNIT_ASSERT(calls == std::vector<std::size_t>(20, 1));
+}
+
+void CStaticThreadPoolTest::testParallelForEachNoThreads() {
+    core::CStaticThreadPool pool{0};
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), pool.size());
+
+    std::vector<std::thread::id> ids(10);
+    pool.parallelForEach(ids.size(), [&ids](std::size_t i) {
+        ids[i] = std::this_thread::get_id();
+    });
+    for (const auto& id : ids) {
+        CPPUNIT_ASSERT(id == std::this_thread::get_id());
+    }
+}
+
+void CStaticThreadPoolTest::testNestedParallelForEach() {
+    // The caller takes part in the work so nesting can't deadlock even
+    // when every worker is busy with the outer loop.
+    core::CStaticThreadPool pool{2};
+
+    std::vector<std::size_t> sums(8, 0);
+    pool.parallelForEach(sums.size(), [&pool, &sums](std::size_t i) {
+        std::vector<std::size_t> values(50, 0);
+        pool.parallelForEach(values.size(),
+                             [&values, i](std::size_t j) { values[j] = i * j; });
+        sums[i] = std::accumulate(values.begin(), values.end(), std::size_t(0));
+    });
+    for (std::size_t i = 0; i < sums.size(); ++i) {
+        CPPUNIT_ASSERT_EQUAL(i * 1225, sums[i]);
+    }
+}
+
+void CStaticThreadPoolTest::testExceptions() {
+    core::CStaticThreadPool pool{3};
+
+    std::atomic<std::size_t> count{0};
+    bool thrown{false};
+    try {
+        pool.parallelForEach(100, [&count](std::size_t i) {
+            ++count;
+            if (i == 42) {
+                throw std::runtime_error("test");
+            }
+        });
+    } catch (const std::runtime_error& e) {
+        LOG_DEBUG(<< "Caught " << e.what());
+        thrown = true;
+    }
+    CPPUNIT_ASSERT(thrown);
+    // All the other indices should still have been processed.
+    CPPUNIT_ASSERT_EQUAL(std::size_t(100), count.load());
+
+    // The pool should still be usable.
+    count = 0;
+    pool.parallelForEach(10, [&count](std::size_t) { ++count; });
+    CPPUNIT_ASSERT_EQUAL(std::size_t(10), count.load());
+
+    // Exceptions thrown by plain scheduled tasks mustn't kill the workers.
+    pool.schedule([] { throw std::runtime_error("test"); });
+    count = 0;
+    pool.parallelForEach(10, [&count](std::size_t) { ++count; });
+    CPPUNIT_ASSERT_EQUAL(std::size_t(10), count.load());
+}
+
+CppUnit::Test* CStaticThreadPoolTest::suite() {
+    CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CStaticThreadPoolTest");
+
+    suiteOfTests->addTest(new CppUnit::TestCaller<CStaticThreadPoolTest>(
+        "CStaticThreadPoolTest::testSchedule", &CStaticThreadPoolTest::testSchedule));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CStaticThreadPoolTest>(
+        "CStaticThreadPoolTest::testParallelForEach",
+        &CStaticThreadPoolTest::testParallelForEach));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CStaticThreadPoolTest>(
+        "CStaticThreadPoolTest::testParallelForEachNoThreads",
+        &CStaticThreadPoolTest::testParallelForEachNoThreads));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CStaticThreadPoolTest>(
+        "CStaticThreadPoolTest::testNestedParallelForEach",
+        &CStaticThreadPoolTest::testNestedParallelForEach));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CStaticThreadPoolTest>(
+        "CStaticThreadPoolTest::testExceptions", &CStaticThreadPoolTest::testExceptions));
+
+    return suiteOfTests;
+}
@@ -149,8 +149,16 @@ void CStatisticsTest::testPersist() {
             &ml::core::CStatistics::staticsAcceptRestoreTraverser));
     }
 
+    // The statistics of the last background persist describe the process
+    // rather than the job so aren't persisted.
+    auto isPersisted = [](int i) {
+        return i != ml::stat_t::E_BackgroundPersistPauseTime &&
+               i != ml::stat_t::E_BackgroundPersistExtraMemory;
+    };
+
     for (int i = 0; i < ml::stat_t::E_LastEnumStat; i++) {
-        CPPUNIT_ASSERT_EQUAL(uint64_t(0), stats.stat(i).value());
+        CPPUNIT_ASSERT_EQUAL(isPersisted(i) ? uint64_t(0) : uint64_t(567 + (i * 3)),
+                             stats.stat(i).value());
     }
 
     // Restore the non-zero state
@@ -174,6 +182,8 @@ void CStatisticsTest::testPersist() {
         CPPUNIT_ASSERT(traverser.traverseSubLevel(
             &ml::core::CStatistics::staticsAcceptRestoreTraverser));
     }
+    stats.stat(ml::stat_t::E_BackgroundPersistPauseTime).set(0);
+    stats.stat(ml::stat_t::E_BackgroundPersistExtraMemory).set(0);
 
     for (int i = 0; i < ml::stat_t::E_LastEnumStat; i++) {
         CPPUNIT_ASSERT_EQUAL(uint64_t(0), stats.stat(i).value());
@@ -6,9 +6,12 @@
 #include "CStringSimilarityTesterTest.h"
 
 #include <core/CLogger.h>
+#include <core/CStopWatch.h>
 #include <core/CStringSimilarityTester.h>
 #include <core/CTimeUtils.h>
 
+#include <algorithm>
+#include <cstdint>
 #include <string>
 #include <utility>
 #include <vector>
@@ -16,6 +19,50 @@
 #include <ctype.h>
 #include <stdlib.h>
 
+namespace {
+
+using TSizeSizePr = std::pair<size_t, size_t>;
+using TSizeSizePrVec = std::vector<TSizeSizePr>;
+using TSizeSizePrVecVec = std::vector<TSizeSizePrVec>;
+
+//! Generate a random sequence of up to \p maxLen tokens drawn from an
+//! alphabet of \p alphabetSize, each with weight \p weight or, if this
+//! is zero, a random weight.
+TSizeSizePrVec randomSequence(int maxLen, int alphabetSize, size_t weight) {
+    TSizeSizePrVec result;
+    for (int len = (::rand() % (maxLen + 1)); len > 0; --len) {
+        result.emplace_back(size_t(::rand() % alphabetSize),
+                            weight > 0 ? weight : size_t(1 + ::rand() % 5));
+    }
+    return result;
+}
+
+//! The weighted edit distance calculated using the entire matrix.
+size_t referenceWeightedEditDistance(const TSizeSizePrVec& first,
+                                     const TSizeSizePrVec& second) {
+    std::vector<std::vector<size_t>> matrix(
+        first.size() + 1, std::vector<size_t>(second.size() + 1, 0));
+    for (size_t i = 1; i <= first.size(); ++i) {
+        matrix[i][0] = matrix[i - 1][0] + first[i - 1].second;
+    }
+    for (size_t j = 1; j <= second.size(); ++j) {
+        matrix[0][j] = matrix[0][j - 1] + second[j - 1].second;
+    }
+    for (size_t i = 1; i <= first.size(); ++i) {
+        for (size_t j = 1; j <= second.size(); ++j) {
+            size_t substitution(first[i - 1].first == second[j - 1].first
+                                    ? 0
+                                    : std::max(first[i - 1].second,
+                                               second[j - 1].second));
+            matrix[i][j] = std::min({matrix[i - 1][j] + first[i - 1].second,
+                                     matrix[i][j - 1] + second[j - 1].second,
+                                     matrix[i - 1][j - 1] + substitution});
+        }
+    }
+    return matrix[first.size()][second.size()];
+}
+}
+
 CppUnit::Test* CStringSimilarityTesterTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CStringSimilarityTesterTest");
 
@@ -40,6 +87,12 @@ CppUnit::Test* CStringSimilarityTesterTest::suite() {
     suiteOfTests->addTest(new CppUnit::TestCaller<CStringSimilarityTesterTest>(
         "CStringSimilarityTesterTest::testWeightedEditDistance",
         &CStringSimilarityTesterTest::testWeightedEditDistance));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CStringSimilarityTesterTest>(
+        "CStringSimilarityTesterTest::testWeightedEditDistanceBounded",
+        &CStringSimilarityTesterTest::testWeightedEditDistanceBounded));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CStringSimilarityTesterTest>(
+        "CStringSimilarityTesterTest::testWeightedEditDistanceBoundedThroughput",
+        &CStringSimilarityTesterTest::testWeightedEditDistanceBoundedThroughput));
 
     return suiteOfTests;
 }
@@ -442,3 +495,113 @@ void CStringSimilarityTesterTest::testWeightedEditDistance() {
     CPPUNIT_ASSERT_EQUAL(size_t(21), sst.weightedEditDistance(serviceStart, empty));
     CPPUNIT_ASSERT_EQUAL(size_t(21), sst.weightedEditDistance(empty, serviceStart));
 }
+
+void CStringSimilarityTesterTest::testWeightedEditDistanceBounded() {
+    // Check that the bounded weighted edit distance is exact whenever the
+    // distance is within the bound and exceeds the bound otherwise, for both
+    // uniform weights, which use the bit-parallel algorithm for sequences of
+    // up to 64 tokens, and arbitrary weights, which use the banded algorithm.
+
+    ml::core::CStringSimilarityTester sst;
+
+    for (size_t trial = 0; trial < 2000; ++trial) {
+        // Small alphabets give plenty of matching tokens
+        int alphabetSize(2 + ::rand() % 10);
+        size_t weight(trial % 2 == 0 ? size_t(1 + ::rand() % 3) : 0);
+        int maxLen(trial % 10 == 0 ? 100 : 30);
+
+        TSizeSizePrVec first(randomSequence(maxLen, alphabetSize, weight));
+        TSizeSizePrVec second(randomSequence(maxLen, alphabetSize, weight));
+        if (::rand() % 2 == 0) {
+            // Make the sequences similar
+            second = first;
+            for (int edits = ::rand() % 5; edits > 0 && second.size() > 0; --edits) {
+                second[size_t(::rand()) % second.size()].first = size_t(alphabetSize);
+            }
+        }
+
+        size_t expected(referenceWeightedEditDistance(first, second));
+        CPPUNIT_ASSERT_EQUAL(expected, sst.weightedEditDistance(first, second));
+        CPPUNIT_ASSERT_EQUAL(expected, sst.weightedEditDistance(second, first));
+
+        for (size_t maxCost : {size_t(0), expected / 2, expected - std::min(expected, size_t(1)),
+                               expected, expected + 1, 2 * expected + 5}) {
+            size_t bounded(sst.weightedEditDistance(first, second, maxCost));
+            size_t reverse(sst.weightedEditDistance(second, first, maxCost));
+            if (expected <= maxCost) {
+                CPPUNIT_ASSERT_EQUAL(expected, bounded);
+                CPPUNIT_ASSERT_EQUAL(expected, reverse);
+            } else {
+                CPPUNIT_ASSERT(bounded > maxCost);
+                CPPUNIT_ASSERT(reverse > maxCost);
+            }
+        }
+    }
+}
+
+void CStringSimilarityTesterTest::testWeightedEditDistanceBoundedThroughput() {
+    // Compare the time taken to decide which pairs of token sequences are
+    // within 30% of the larger weight of each other, which is the typical
+    // question asked when categorising, with and without the bound.
+
+    ml::core::CStringSimilarityTester sst;
+
+    static const size_t TEST_SIZE(700);
+
+    for (size_t weight : {size_t(1), size_t(0)}) {
+        // Sequences of log message like lengths from a few templates, so
+        // some pairs are similar and most are very different
+        TSizeSizePrVecVec templates;
+        for (size_t i = 0; i < 20; ++i) {
+            templates.push_back(randomSequence(30, 1000, weight));
+        }
+        TSizeSizePrVecVec input;
+        for (size_t index = 0; index < TEST_SIZE; ++index) {
+            input.push_back(templates[size_t(::rand()) % templates.size()]);
+            for (auto& token : input.back()) {
+                if (::rand() % 10 == 0) {
+                    token.first = size_t(1000 + ::rand() % 1000);
+                }
+            }
+        }
+        std::vector<size_t> weights;
+        for (const auto& sequence : input) {
+            size_t total(0);
+            for (const auto& token : sequence) {
+                total += token.second;
+            }
+            weights.push_back(total);
+        }
+
+        ml::core::CStopWatch stopWatch;
+
+        std::vector<bool> unboundedSimilar;
+        stopWatch.start();
+        for (size_t i = 0; i < TEST_SIZE; ++i) {
+            for (size_t j = 0; j < TEST_SIZE; ++j) {
+                size_t maxCost((3 * std::max(weights[i], weights[j])) / 10);
+                unboundedSimilar.push_back(
+                    sst.weightedEditDistance(input[i], input[j]) <= maxCost);
+            }
+        }
+        std::uint64_t unboundedTime(stopWatch.stop());
+
+        std::vector<bool> boundedSimilar;
+        stopWatch.reset(true);
+        for (size_t i = 0; i < TEST_SIZE; ++i) {
+            for (size_t j = 0; j < TEST_SIZE; ++j) {
+                size_t maxCost((3 * std::max(weights[i], weights[j])) / 10);
+                boundedSimilar.push_back(
+                    sst.weightedEditDistance(input[i], input[j], maxCost) <= maxCost);
+            }
+        }
+        std::uint64_t boundedTime(stopWatch.stop());
+
+        CPPUNIT_ASSERT(unboundedSimilar == boundedSimilar);
+
+        LOG_INFO(<< "Weighted edit distance throughput test with "
+                 << (weight > 0 ? "uniform" : "varying") << " weights for "
+                 << TEST_SIZE << " sequences took " << unboundedTime
+                 << "ms unbounded and " << boundedTime << "ms bounded");
+    }
+}
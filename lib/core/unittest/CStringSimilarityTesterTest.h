@@ -17,6 +17,8 @@ public:
     void testLevensteinDistanceThroughputSimilar();
     void testLevensteinDistanceAlgorithmEquivalence();
     void testWeightedEditDistance();
+    void testWeightedEditDistanceBounded();
+    void testWeightedEditDistanceBoundedThroughput();
 
     static CppUnit::Test* suite();
 };
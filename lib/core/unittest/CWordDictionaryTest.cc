@@ -6,9 +6,20 @@
 #include "CWordDictionaryTest.h"
 
 #include <core/CLogger.h>
+#include <core/CPerfectHashWordMap.h>
+#include <core/CResourceLocator.h>
+#include <core/CStopWatch.h>
+#include <core/CStringUtils.h>
 #include <core/CTimeUtils.h>
 #include <core/CWordDictionary.h>
 
+#include <test/CTestTmpDir.h>
+
+#include <cstdint>
+#include <fstream>
+
+#include <stdio.h>
+
 CppUnit::Test* CWordDictionaryTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CWordDictionaryTest");
 
@@ -20,6 +31,9 @@ CppUnit::Test* CWordDictionaryTest::suite() {
         "CWordDictionaryTest::testWeightingFunctors", &CWordDictionaryTest::testWeightingFunctors));
     suiteOfTests->addTest(new CppUnit::TestCaller<CWordDictionaryTest>(
         "CWordDictionaryTest::testPerformance", &CWordDictionaryTest::testPerformance));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CWordDictionaryTest>(
+        "CWordDictionaryTest::testCompiledDictionary",
+        &CWordDictionaryTest::testCompiledDictionary));
 
     return suiteOfTests;
 }
@@ -131,3 +145,53 @@ void CWordDictionaryTest::testPerformance() {
 
     LOG_INFO(<< "Word dictionary throughput test took " << (end - start) << " seconds");
 }
+
+void CWordDictionaryTest::testCompiledDictionary() {
+    const ml::core::CWordDictionary& dict = ml::core::CWordDictionary::instance();
+
+    std::string dictionaryFile(ml::core::CResourceLocator::resourceDir() + "/ml-en.dict");
+    std::string compiledFile(ml::test::CTestTmpDir::tmpDir() + "/ml-en.dict.mph");
+
+    CPPUNIT_ASSERT(ml::core::CWordDictionary::compile(dictionaryFile, compiledFile));
+    CPPUNIT_ASSERT(!ml::core::CWordDictionary::compile(dictionaryFile + ".missing",
+                                                       compiledFile + ".missing"));
+
+    {
+        ml::core::CStopWatch stopWatch(true);
+        ml::core::CPerfectHashWordMap compiled;
+        CPPUNIT_ASSERT(compiled.map(compiledFile));
+        LOG_INFO(<< "Mapping " << compiled.size() << " words took "
+                 << stopWatch.stop() << "ms");
+
+        // Every word in the text file must have the same part of speech in
+        // the image as in the dictionary, whatever its case
+        std::ifstream ifs(dictionaryFile.c_str());
+        CPPUNIT_ASSERT(ifs.is_open());
+        std::size_t words(0);
+        std::string line;
+        while (std::getline(ifs, line)) {
+            std::size_t sepPos(line.find('@'));
+            if (sepPos == std::string::npos || sepPos == 0) {
+                continue;
+            }
+            std::string word(line.substr(0, sepPos));
+            std::uint16_t partOfSpeech(ml::core::CWordDictionary::E_NotInDictionary);
+            CPPUNIT_ASSERT_MESSAGE(word, compiled.lookup(word, partOfSpeech));
+            CPPUNIT_ASSERT_EQUAL(dict.partOfSpeech(word),
+                                 static_cast<ml::core::CWordDictionary::EPartOfSpeech>(partOfSpeech));
+            word = ml::core::CStringUtils::toUpper(word);
+            CPPUNIT_ASSERT_MESSAGE(word, compiled.lookup(word, partOfSpeech));
+            ++words;
+        }
+        LOG_DEBUG(<< "Checked " << words << " words");
+        CPPUNIT_ASSERT(words > 0);
+        CPPUNIT_ASSERT(compiled.size() <= words);
+
+        std::uint16_t partOfSpeech(0);
+        CPPUNIT_ASSERT(!compiled.lookup("hkjsdfg", partOfSpeech));
+        CPPUNIT_ASSERT(!compiled.lookup("hello2", partOfSpeech));
+        CPPUNIT_ASSERT(!compiled.lookup("", partOfSpeech));
+    }
+
+    CPPUNIT_ASSERT_EQUAL(0, ::remove(compiledFile.c_str()));
+}
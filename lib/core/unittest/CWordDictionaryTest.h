@@ -14,6 +14,7 @@ public:
     void testPartOfSpeech();
     void testWeightingFunctors();
     void testPerformance();
+    void testCompiledDictionary();
 
     static CppUnit::Test* suite();
 };
@@ -7,6 +7,7 @@
 
 #include "CAllocationStrategyTest.h"
 #include "CBase64FilterTest.h"
+#include "CBinaryStateRestoreTraverserTest.h"
 #include "CBlockingMessageQueueTest.h"
 #include "CByteSwapperTest.h"
 #include "CCompressUtilsTest.h"
@@ -38,6 +39,7 @@
 #include "CNamedPipeFactoryTest.h"
 #include "COsFileFuncsTest.h"
 #include "CPatternSetTest.h"
+#include "CPerfectHashWordMapTest.h"
 #include "CPersistUtilsTest.h"
 #include "CPolymorphicStackObjectCPtrTest.h"
 #include "CProcessPriorityTest.h"
@@ -55,8 +57,10 @@
 #include "CShellArgQuoterTest.h"
 #include "CSleepTest.h"
 #include "CSmallVectorTest.h"
+#include "CSpscRingBufferTest.h"
 #include "CStateCompressorTest.h"
 #include "CStateMachineTest.h"
+#include "CStaticThreadPoolTest.h"
 #include "CStatisticsTest.h"
 #include "CStopWatchTest.h"
 #include "CStoredStringPtrTest.h"
@@ -81,6 +85,7 @@ int main(int argc, const char** argv) {
 
     runner.addTest(CAllocationStrategyTest::suite());
     runner.addTest(CBase64FilterTest::suite());
+    runner.addTest(CBinaryStateRestoreTraverserTest::suite());
     runner.addTest(CBlockingMessageQueueTest::suite());
     runner.addTest(CByteSwapperTest::suite());
     runner.addTest(CCompressedDictionaryTest::suite());
@@ -112,6 +117,7 @@ int main(int argc, const char** argv) {
     runner.addTest(CNamedPipeFactoryTest::suite());
     runner.addTest(COsFileFuncsTest::suite());
     runner.addTest(CPatternSetTest::suite());
+    runner.addTest(CPerfectHashWordMapTest::suite());
     runner.addTest(CPersistUtilsTest::suite());
     runner.addTest(CPolymorphicStackObjectCPtrTest::suite());
     runner.addTest(CProcessTest::suite());
@@ -129,8 +135,10 @@ int main(int argc, const char** argv) {
     runner.addTest(CShellArgQuoterTest::suite());
     runner.addTest(CSleepTest::suite());
     runner.addTest(CSmallVectorTest::suite());
+    runner.addTest(CSpscRingBufferTest::suite());
     runner.addTest(CStateCompressorTest::suite());
     runner.addTest(CStateMachineTest::suite());
+    runner.addTest(CStaticThreadPoolTest::suite());
     runner.addTest(CStatisticsTest::suite());
     runner.addTest(CStopWatchTest::suite());
     runner.addTest(CStoredStringPtrTest::suite());
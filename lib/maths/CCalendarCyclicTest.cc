@@ -225,6 +225,10 @@ CCalendarCyclicTest::TOptionalFeature CCalendarCyclicTest::test() const {
     return result.count() > 0 ? result[0].third : TOptionalFeature();
 }
 
+std::size_t CCalendarCyclicTest::size() const {
+    return static_cast<std::size_t>(SIZE);
+}
+
 std::uint64_t CCalendarCyclicTest::checksum(std::uint64_t seed) const {
     seed = CChecksum::calculate(seed, m_DecayRate);
     seed = CChecksum::calculate(seed, m_ErrorQuantiles);
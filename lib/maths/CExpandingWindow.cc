@@ -19,28 +19,139 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 
 namespace ml {
 namespace maths {
 namespace {
+using TByte = unsigned char;
+using TByteVec = std::vector<TByte>;
+using TFloatMeanAccumulator = CExpandingWindow::TFloatMeanAccumulator;
+using TFloatMeanAccumulatorVec = CExpandingWindow::TFloatMeanAccumulatorVec;
+
 const std::string BUCKET_LENGTH_INDEX_TAG{"a"};
 const std::string BUCKET_VALUES_TAG{"b"};
 const std::string START_TIME_TAG{"c"};
 const std::string MEAN_OFFSET_TAG{"d"};
 const std::size_t MAX_BUFFER_SIZE{5};
+
+// Byte packing codes. Each word of a packed bucket value is coded by its
+// number of significant bytes and its number of trailing zero bytes. The
+// codes of a bucket value's two words share one byte and the remaining
+// values of that byte code runs of empty buckets.
+
+//! The number of codes for a word.
+const std::size_t NUMBER_WORD_CODES{11};
+//! The first code of a word with each number of significant bytes.
+const std::size_t FIRST_WORD_CODE[]{0, 1, 5, 8, 10};
+//! The number of significant bytes of a word with each code.
+const std::size_t WORD_CODE_LENGTH[]{0, 1, 1, 1, 1, 2, 2, 2, 3, 3, 4};
+//! The number of trailing zero bytes of a word with each code.
+const std::size_t WORD_CODE_SHIFT[]{0, 0, 1, 2, 3, 0, 1, 2, 0, 1, 0};
+//! The first code of a run of empty buckets.
+const std::size_t FIRST_EMPTY_RUN_CODE{NUMBER_WORD_CODES * NUMBER_WORD_CODES};
+//! The longest run of empty buckets which can be coded by one byte.
+const std::size_t MAX_EMPTY_RUN{256 - FIRST_EMPTY_RUN_CODE};
+
+static_assert(sizeof(TFloatMeanAccumulator) == 2 * sizeof(std::uint32_t),
+              "Byte packing assumes the bucket values are two 32 bit words");
+
+//! Get the code of \p word.
+std::size_t wordCode(std::uint32_t word) {
+    if (word == 0) {
+        return 0;
+    }
+    std::size_t shift{0};
+    for (/**/; (word & 0xff) == 0; word >>= 8) {
+        ++shift;
+    }
+    std::size_t length{1};
+    for (word >>= 8; word != 0; word >>= 8) {
+        ++length;
+    }
+    return FIRST_WORD_CODE[length] + shift;
+}
+
+//! Byte pack \p values into \p result.
+void pack(const TFloatMeanAccumulatorVec& values, TByteVec& result) {
+    static thread_local TByteVec buffer;
+    buffer.clear();
+
+    // Each word is XOR'd with the same word of the last populated bucket,
+    // so counts which are equal and means which are close need few bytes.
+    std::uint32_t last[2]{0, 0};
+    std::size_t run{0};
+    auto flushRun = [&run]() {
+        if (run > 0) {
+            buffer.push_back(static_cast<TByte>(FIRST_EMPTY_RUN_CODE + run - 1));
+            run = 0;
+        }
+    };
+
+    for (const auto& value : values) {
+        std::uint32_t words[2];
+        std::memcpy(words, reinterpret_cast<const TByte*>(&value), sizeof(words));
+        if (words[0] == 0 && words[1] == 0) {
+            if (++run == MAX_EMPTY_RUN) {
+                flushRun();
+            }
+            continue;
+        }
+        flushRun();
+
+        std::uint32_t deltas[]{words[0] ^ last[0], words[1] ^ last[1]};
+        std::size_t codes[]{wordCode(deltas[0]), wordCode(deltas[1])};
+        buffer.push_back(static_cast<TByte>(codes[0] * NUMBER_WORD_CODES + codes[1]));
+        for (std::size_t i = 0u; i < 2; ++i) {
+            std::uint32_t delta{deltas[i] >> (8 * WORD_CODE_SHIFT[codes[i]])};
+            for (std::size_t j = 0u; j < WORD_CODE_LENGTH[codes[i]]; ++j, delta >>= 8) {
+                buffer.push_back(static_cast<TByte>(delta & 0xff));
+            }
+        }
+        last[0] = words[0];
+        last[1] = words[1];
+    }
+    flushRun();
+
+    TByteVec(buffer.begin(), buffer.end()).swap(result);
+}
+
+//! Unpack the byte packed values \p packed into \p result.
+void unpack(const TByteVec& packed, TFloatMeanAccumulatorVec& result) {
+    result.clear();
+    std::uint32_t last[2]{0, 0};
+    for (std::size_t i = 0u; i < packed.size(); /**/) {
+        std::size_t code{packed[i++]};
+        if (code >= FIRST_EMPTY_RUN_CODE) {
+            result.resize(result.size() + code - FIRST_EMPTY_RUN_CODE + 1);
+            continue;
+        }
+        std::size_t codes[]{code / NUMBER_WORD_CODES, code % NUMBER_WORD_CODES};
+        for (std::size_t j = 0u; j < 2; ++j) {
+            std::uint32_t delta{0};
+            for (std::size_t k = 0u; k < WORD_CODE_LENGTH[codes[j]]; ++k) {
+                delta |= static_cast<std::uint32_t>(packed[i++]) << (8 * k);
+            }
+            last[j] ^= delta << (8 * WORD_CODE_SHIFT[codes[j]]);
+        }
+        result.emplace_back();
+        std::memcpy(reinterpret_cast<TByte*>(&result.back()), last, sizeof(last));
+    }
+}
 }
 
 CExpandingWindow::CExpandingWindow(core_t::TTime bucketLength,
                                    TTimeCRng bucketLengths,
                                    std::size_t size,
                                    double decayRate,
-                                   bool deflate)
-    : m_Deflate{deflate}, m_DecayRate{decayRate}, m_Size{size}, m_BucketLength{bucketLength},
+                                   ECompression compression)
+    : m_Compression{compression}, m_DecayRate{decayRate}, m_Size{size}, m_BucketLength{bucketLength},
       m_BucketLengths{bucketLengths}, m_BucketLengthIndex{0},
       m_StartTime{boost::numeric::bounds<core_t::TTime>::lowest()},
       m_BufferedTimeToPropagate(0.0), m_BucketValues(size % 2 == 0 ? size : size + 1) {
     m_BufferedValues.reserve(MAX_BUFFER_SIZE);
-    this->deflate(true);
+    this->compress(true);
 }
 
 bool CExpandingWindow::acceptRestoreTraverser(core::CStateRestoreTraverser& traverser) {
@@ -53,15 +164,16 @@ bool CExpandingWindow::acceptRestoreTraverser(core::CStateRestoreTraverser& trav
                 core::CPersistUtils::restore(BUCKET_VALUES_TAG, m_BucketValues, traverser));
         RESTORE(MEAN_OFFSET_TAG, m_MeanOffset.fromDelimited(traverser.value()))
     } while (traverser.next());
-    this->deflate(true);
+    this->compress(true);
     return true;
 }
 
 void CExpandingWindow::acceptPersistInserter(core::CStatePersistInserter& inserter) const {
-    CScopeInflate inflate(*this, false);
+    TFloatMeanAccumulatorVec values;
+    this->bucketValues(values);
     inserter.insertValue(BUCKET_LENGTH_INDEX_TAG, m_BucketLengthIndex);
     inserter.insertValue(START_TIME_TAG, m_StartTime);
-    core::CPersistUtils::persist(BUCKET_VALUES_TAG, m_BucketValues, inserter);
+    core::CPersistUtils::persist(BUCKET_VALUES_TAG, values, inserter);
     inserter.insertValue(MEAN_OFFSET_TAG, m_MeanOffset.toDelimited());
 }
 
@@ -87,17 +199,19 @@ std::size_t CExpandingWindow::size() const {
 }
 
 CExpandingWindow::TFloatMeanAccumulatorVec CExpandingWindow::values() const {
-    CScopeInflate inflate(*this, false);
-    return m_BucketValues;
+    TFloatMeanAccumulatorVec result;
+    this->bucketValues(result);
+    return result;
 }
 
 CExpandingWindow::TFloatMeanAccumulatorVec
 CExpandingWindow::valuesMinusPrediction(const TPredictor& predictor) const {
-    CScopeInflate inflate(*this, false);
+    TFloatMeanAccumulatorVec result;
+    this->bucketValues(result);
 
     core_t::TTime start{CIntegerTools::floor(this->startTime(), m_BucketLength)};
     core_t::TTime end{CIntegerTools::ceil(this->endTime(), m_BucketLength)};
-    core_t::TTime size{static_cast<core_t::TTime>(m_BucketValues.size())};
+    core_t::TTime size{static_cast<core_t::TTime>(result.size())};
     core_t::TTime offset{this->offset()};
 
     TFloatMeanAccumulatorVec predictions(size);
@@ -108,7 +222,6 @@ CExpandingWindow::valuesMinusPrediction(const TPredictor& predictor) const {
         }
     }
 
-    TFloatMeanAccumulatorVec result(m_BucketValues);
     for (core_t::TTime i = 0; i < size; ++i) {
         if (CBasicStatistics::count(result[i]) > 0.0) {
             CBasicStatistics::moment<0>(result[i]) -=
@@ -133,6 +246,12 @@ void CExpandingWindow::propagateForwardsByTime(double time) {
         return;
     }
     double factor{std::exp(-m_DecayRate * time)};
+    if (m_Compression == E_NoCompression) {
+        for (auto& value : m_BucketValues) {
+            value.age(factor);
+        }
+        return;
+    }
     for (auto& value : m_BufferedValues) {
         value.second.age(factor);
     }
@@ -142,7 +261,7 @@ void CExpandingWindow::propagateForwardsByTime(double time) {
 void CExpandingWindow::add(core_t::TTime time, double value, double weight) {
     if (time >= m_StartTime) {
         if (this->needToCompress(time)) {
-            CScopeInflate inflate(*this, true);
+            CScopeDecompress decompress(*this, true);
             do {
                 m_BucketLengthIndex = (m_BucketLengthIndex + 1) %
                                       m_BucketLengths.size();
@@ -167,12 +286,12 @@ void CExpandingWindow::add(core_t::TTime time, double value, double weight) {
         }
 
         std::size_t index((time - m_StartTime) / m_BucketLengths[m_BucketLengthIndex]);
-        if (m_Deflate == false) {
+        if (m_Compression == E_NoCompression) {
             m_BucketValues[index].add(value, weight);
         } else {
             if (m_BufferedValues.empty() || index != m_BufferedValues.back().first) {
                 if (m_BufferedValues.size() == MAX_BUFFER_SIZE) {
-                    CScopeInflate inflate(*this, true);
+                    CScopeDecompress decompress(*this, true);
                 }
                 m_BufferedValues.push_back({index, TFloatMeanAccumulator{}});
             }
@@ -187,77 +306,116 @@ bool CExpandingWindow::needToCompress(core_t::TTime time) const {
 }
 
 uint64_t CExpandingWindow::checksum(uint64_t seed) const {
-    CScopeInflate inflate(*this, false);
+    TFloatMeanAccumulatorVec values;
+    this->bucketValues(values);
     seed = CChecksum::calculate(seed, m_BucketLengthIndex);
     seed = CChecksum::calculate(seed, m_StartTime);
-    seed = CChecksum::calculate(seed, m_BucketValues);
+    seed = CChecksum::calculate(seed, values);
     return CChecksum::calculate(seed, m_MeanOffset);
 }
 
 void CExpandingWindow::debugMemoryUsage(core::CMemoryUsage::TMemoryUsagePtr mem) const {
     mem->setName("CExpandingWindow");
     core::CMemoryDebug::dynamicSize("m_BucketValues", m_BucketValues, mem);
-    core::CMemoryDebug::dynamicSize("m_DeflatedBucketValues", m_DeflatedBucketValues, mem);
+    core::CMemoryDebug::dynamicSize("m_CompressedBucketValues", m_CompressedBucketValues, mem);
 }
 
 std::size_t CExpandingWindow::memoryUsage() const {
     std::size_t mem{core::CMemory::dynamicSize(m_BucketValues)};
-    mem += core::CMemory::dynamicSize(m_DeflatedBucketValues);
+    mem += core::CMemory::dynamicSize(m_CompressedBucketValues);
     return mem;
 }
 
-void CExpandingWindow::deflate(bool commit) const {
-    if (m_Deflate && m_BucketValues.size() > 0) {
-        const_cast<CExpandingWindow*>(this)->doDeflate(commit);
+void CExpandingWindow::bucketValues(TFloatMeanAccumulatorVec& result) const {
+    if (m_Compression == E_NoCompression) {
+        result = m_BucketValues;
+    } else {
+        this->extract(result);
+        this->addBufferedValues(result);
+    }
+}
+
+void CExpandingWindow::compress(bool commit) const {
+    if (m_Compression != E_NoCompression && m_BucketValues.size() > 0) {
+        const_cast<CExpandingWindow*>(this)->doCompress(commit);
     }
 }
 
-void CExpandingWindow::doDeflate(bool commit) {
+void CExpandingWindow::doCompress(bool commit) {
     if (commit) {
-        bool lengthOnly{false};
-        core::CDeflator compressor(lengthOnly);
-        compressor.addVector(m_BucketValues);
-        compressor.finishAndTakeData(m_DeflatedBucketValues);
+        switch (m_Compression) {
+        case E_NoCompression:
+            break;
+        case E_Deflate: {
+            bool lengthOnly{false};
+            core::CDeflator compressor(lengthOnly);
+            compressor.addVector(m_BucketValues);
+            compressor.finishAndTakeData(m_CompressedBucketValues);
+            break;
+        }
+        case E_BytePack:
+            pack(m_BucketValues, m_CompressedBucketValues);
+            break;
+        }
     }
     m_BucketValues.clear();
     m_BucketValues.shrink_to_fit();
 }
 
-void CExpandingWindow::inflate(bool commit) const {
-    if (m_Deflate && m_BucketValues.empty()) {
-        const_cast<CExpandingWindow*>(this)->doInflate(commit);
+void CExpandingWindow::decompress(bool commit) const {
+    if (m_Compression != E_NoCompression && m_BucketValues.empty()) {
+        const_cast<CExpandingWindow*>(this)->doDecompress(commit);
     }
 }
 
-void CExpandingWindow::doInflate(bool commit) {
-    bool lengthOnly{false};
-    core::CInflator decompressor(lengthOnly);
-    decompressor.addVector(m_DeflatedBucketValues);
-    TByteVec inflated;
-    decompressor.finishAndTakeData(inflated);
-    m_BucketValues.resize(inflated.size() / sizeof(TFloatMeanAccumulator));
-    std::copy(inflated.begin(), inflated.end(),
-              reinterpret_cast<TByte*>(m_BucketValues.data()));
+void CExpandingWindow::doDecompress(bool commit) {
+    this->extract(m_BucketValues);
+    this->addBufferedValues(m_BucketValues);
+    if (commit) {
+        m_BufferedValues.clear();
+        m_BufferedTimeToPropagate = 0.0;
+    }
+}
+
+void CExpandingWindow::extract(TFloatMeanAccumulatorVec& result) const {
+    switch (m_Compression) {
+    case E_NoCompression:
+        result = m_BucketValues;
+        break;
+    case E_Deflate: {
+        bool lengthOnly{false};
+        core::CInflator decompressor(lengthOnly);
+        decompressor.addVector(m_CompressedBucketValues);
+        TByteVec inflated;
+        decompressor.finishAndTakeData(inflated);
+        result.resize(inflated.size() / sizeof(TFloatMeanAccumulator));
+        std::copy(inflated.begin(), inflated.end(), reinterpret_cast<TByte*>(result.data()));
+        break;
+    }
+    case E_BytePack:
+        result.reserve(m_Size + 1);
+        unpack(m_CompressedBucketValues, result);
+        break;
+    }
+}
+
+void CExpandingWindow::addBufferedValues(TFloatMeanAccumulatorVec& result) const {
     double factor{std::exp(-m_DecayRate * m_BufferedTimeToPropagate)};
-    for (auto& value : m_BucketValues) {
+    for (auto& value : result) {
         value.age(factor);
     }
     for (auto& value : m_BufferedValues) {
-        m_BucketValues[value.first] += value.second;
-    }
-    if (commit) {
-        m_BufferedValues.clear();
-        m_BufferedTimeToPropagate = 0.0;
+        result[value.first] += value.second;
     }
 }
 
-CExpandingWindow::CScopeInflate::CScopeInflate(const CExpandingWindow& window, bool commit)
+CExpandingWindow::CScopeDecompress::CScopeDecompress(const CExpandingWindow& window, bool commit)
     : m_Window{window}, m_Commit{commit} {
-    m_Window.inflate(commit);
+    m_Window.decompress(commit);
 }
 
-CExpandingWindow::CScopeInflate::~CScopeInflate() {
-    m_Window.deflate(m_Commit);
+CExpandingWindow::CScopeDecompress::~CScopeDecompress() {
+    m_Window.compress(m_Commit);
 }
 }
 }
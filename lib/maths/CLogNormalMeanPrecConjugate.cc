@@ -35,6 +35,7 @@
 #include <algorithm>
 #include <cmath>
 #include <functional>
+#include <limits>
 #include <numeric>
 #include <sstream>
 #include <string>
@@ -46,6 +47,7 @@ namespace {
 
 using TSizeVec = std::vector<std::size_t>;
 using TDouble1Vec = core::CSmallVector<double, 1>;
+using TDouble4Vec = core::CSmallVector<double, 4>;
 using TDoubleWeightsAry1Vec = maths_t::TDoubleWeightsAry1Vec;
 using TMeanAccumulator = CBasicStatistics::SSampleMean<double>::TAccumulator;
 using TMeanVarAccumulator = CBasicStatistics::SSampleMeanVar<double>::TAccumulator;
@@ -209,6 +211,66 @@ bool evaluateFunctionOnJointDistribution(const TDouble1Vec& samples,
     return true;
 }
 
+//! Compute the standardized log values of \p samples at each of the \p n
+//! offsets \p offsets w.r.t. the log-normal approximation of the marginal
+//! likelihood, which is used for large shape (see evaluateFunctionOnJointDistribution
+//! for details). The values for offset j are stored in \p z starting at
+//! j * samples.size(). Values outside the support are mapped to minus
+//! infinity.
+//!
+//! \return False if any of the values can't be computed, in which case
+//! the caller should use evaluateFunctionOnJointDistribution, which will
+//! report the problem.
+bool logNormalZScores(const TDouble1Vec& samples,
+                      const TDoubleWeightsAry1Vec& weights,
+                      const double* offsets,
+                      std::size_t n,
+                      double shape,
+                      double rate,
+                      double mean,
+                      double precision,
+                      TDouble4Vec& z,
+                      TDouble1Vec& counts) {
+    std::size_t m = samples.size();
+    z.resize(n * m);
+    counts.resize(m);
+
+    double r = rate / shape;
+    double s = std::exp(-r);
+
+    for (std::size_t i = 0u; i < m; ++i) {
+        double varianceScale = maths_t::seasonalVarianceScale(weights[i]) *
+                               maths_t::countVarianceScale(weights[i]);
+        double location;
+        double scale;
+        locationAndScale(varianceScale, r, s, mean, precision, rate, shape, location, scale);
+        if (!CMathsFuncs::isFinite(location) || !CMathsFuncs::isFinite(scale) || scale <= 0.0) {
+            return false;
+        }
+
+        counts[i] = maths_t::count(weights[i]);
+        for (std::size_t j = 0u; j < n; ++j) {
+            double x = samples[i] + offsets[j];
+            if (CMathsFuncs::isNan(x)) {
+                return false;
+            }
+            z[j * m + i] = x <= 0.0 ? -std::numeric_limits<double>::infinity()
+                                    : (std::log(x) - location) / scale;
+        }
+    }
+
+    return true;
+}
+
+//! Get the sign of the standardized values for which the minus log of
+//! the standard normal c.d.f. gives \p F.
+inline double minusLogCdfSign(const CTools::SMinusLogCdf&) {
+    return 1.0;
+}
+inline double minusLogCdfSign(const CTools::SMinusLogCdfComplement&) {
+    return -1.0;
+}
+
 //! \brief Evaluates a specified function object, which must be default constructible,
 //! on the joint distribution of a set of the samples at a specified offset.
 //!
@@ -231,9 +293,46 @@ public:
           m_Precision(precision), m_Shape(shape), m_Rate(rate) {}
 
     bool operator()(double x, double& result) const {
-        return evaluateFunctionOnJointDistribution(
-            m_Samples, m_Weights, F(), SPlusWeight(), m_IsNonInformative,
-            m_Offset + x, m_Shape, m_Rate, m_Mean, m_Precision, result);
+        return (*this)(&x, 1, &result);
+    }
+
+    //! Evaluate at the \p n offsets \p x, sharing the work between them.
+    bool operator()(const double* x, std::size_t n, double* result) const {
+        TDouble4Vec offsets(x, x + n);
+        for (auto& offset : offsets) {
+            offset += m_Offset;
+        }
+
+        // The common case is the log-normal approximation of the marginal
+        // likelihood, which we evaluate for all samples and offsets at once.
+        TDouble4Vec z;
+        TDouble1Vec counts;
+        if (!m_IsNonInformative && m_Shape > MINIMUM_LOGNORMAL_SHAPE &&
+            logNormalZScores(m_Samples, m_Weights, offsets.data(), n, m_Shape,
+                             m_Rate, m_Mean, m_Precision, z, counts)) {
+            double sign = minusLogCdfSign(F());
+            for (auto& zi : z) {
+                zi *= sign;
+            }
+            CTools::minusLogStandardNormalCdf(z.data(), z.size(), z.data());
+            std::size_t m = counts.size();
+            for (std::size_t j = 0u; j < n; ++j) {
+                result[j] = 0.0;
+                for (std::size_t i = 0u; i < m; ++i) {
+                    result[j] += counts[i] * z[j * m + i];
+                }
+            }
+            return true;
+        }
+
+        for (std::size_t j = 0u; j < n; ++j) {
+            if (!evaluateFunctionOnJointDistribution(
+                    m_Samples, m_Weights, F(), SPlusWeight(), m_IsNonInformative,
+                    offsets[j], m_Shape, m_Rate, m_Mean, m_Precision, result[j])) {
+                return false;
+            }
+        }
+        return true;
     }
 
 private:
@@ -1275,7 +1374,7 @@ bool CLogNormalMeanPrecConjugate::minusLogJointCdf(const TDouble1Vec& samples,
         // w.r.t. to the hidden offset of the samples Z, which is uniform
         // on the interval [0,1].
         double value;
-        if (!CIntegration::logGaussLegendre<CIntegration::OrderThree>(
+        if (!CIntegration::batchLogGaussLegendre<CIntegration::OrderThree>(
                 minusLogCdf, 0.0, 1.0, value)) {
             LOG_ERROR(<< "Failed computing c.d.f. for "
                       << core::CContainerPrinter::print(samples));
@@ -1315,7 +1414,7 @@ bool CLogNormalMeanPrecConjugate::minusLogJointCdfComplement(const TDouble1Vec&
         // w.r.t. to the hidden offset of the samples Z, which is uniform
         // on the interval [0,1].
         double value;
-        if (!CIntegration::logGaussLegendre<CIntegration::OrderThree>(
+        if (!CIntegration::batchLogGaussLegendre<CIntegration::OrderThree>(
                 minusLogCdfComplement, 0.0, 1.0, value)) {
             LOG_ERROR(<< "Failed computing c.d.f. complement for "
                       << core::CContainerPrinter::print(samples));
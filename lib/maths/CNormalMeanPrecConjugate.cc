@@ -50,6 +50,7 @@ const double MINIMUM_GAUSSIAN_SHAPE = 100.0;
 namespace detail {
 
 using TDouble1Vec = core::CSmallVector<double, 1>;
+using TDouble4Vec = core::CSmallVector<double, 4>;
 using TDoubleWeightsAry1Vec = maths_t::TDoubleWeightsAry1Vec;
 using TDoubleDoublePr = std::pair<double, double>;
 using TDoubleDoublePrVec = std::vector<TDoubleDoublePr>;
@@ -191,6 +192,69 @@ bool evaluateFunctionOnJointDistribution(const TDouble1Vec& samples,
     return true;
 }
 
+//! Compute the standardized values of \p samples at each of the \p n
+//! offsets \p offsets w.r.t. the moment matched Gaussian approximation
+//! of the marginal likelihood, which is used for large shape (see
+//! evaluateFunctionOnJointDistribution for details). The values for
+//! offset j are stored in \p z starting at j * samples.size().
+//!
+//! \return False if any of the values can't be computed, in which case
+//! the caller should use evaluateFunctionOnJointDistribution, which will
+//! report the problem.
+bool gaussianZScores(const TDouble1Vec& samples,
+                     const TDoubleWeightsAry1Vec& weights,
+                     const double* offsets,
+                     std::size_t n,
+                     double shape,
+                     double rate,
+                     double mean,
+                     double precision,
+                     double predictionMean,
+                     TDouble4Vec& z,
+                     TDouble1Vec& counts) {
+    std::size_t m = samples.size();
+    z.resize(n * m);
+    counts.resize(m);
+
+    for (std::size_t i = 0u; i < m; ++i) {
+        double seasonalScale = std::sqrt(maths_t::seasonalVarianceScale(weights[i]));
+        double countVarianceScale = maths_t::countVarianceScale(weights[i]);
+
+        double x = seasonalScale != 1.0
+                       ? predictionMean + (samples[i] - predictionMean) / seasonalScale
+                       : samples[i];
+
+        // Get the effective precision and rate of the sample.
+        double scaledPrecision = countVarianceScale * precision;
+        double scaledRate = countVarianceScale * rate;
+
+        double deviation = std::sqrt((scaledPrecision + 1.0) /
+                                     scaledPrecision * scaledRate / shape);
+        if (!CMathsFuncs::isFinite(deviation) || deviation <= 0.0) {
+            return false;
+        }
+
+        counts[i] = maths_t::count(weights[i]);
+        for (std::size_t j = 0u; j < n; ++j) {
+            z[j * m + i] = (x + offsets[j] - mean) / deviation;
+            if (CMathsFuncs::isNan(z[j * m + i])) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+//! Get the sign of the standardized values for which the minus log of
+//! the standard normal c.d.f. gives \p F.
+inline double minusLogCdfSign(const CTools::SMinusLogCdf&) {
+    return 1.0;
+}
+inline double minusLogCdfSign(const CTools::SMinusLogCdfComplement&) {
+    return -1.0;
+}
+
 //! Evaluates a specified function object, which must be default constructible,
 //! on the joint distribution of a set of the samples at a specified offset.
 //!
@@ -213,9 +277,41 @@ public:
           m_Shape(shape), m_Rate(rate), m_PredictionMean(predictionMean) {}
 
     bool operator()(double x, double& result) const {
-        return evaluateFunctionOnJointDistribution(
-            m_Samples, m_Weights, F(), SPlusWeight(), m_IsNonInformative, x,
-            m_Shape, m_Rate, m_Mean, m_Precision, m_PredictionMean, result);
+        return (*this)(&x, 1, &result);
+    }
+
+    //! Evaluate at the \p n offsets \p x, sharing the work between them.
+    bool operator()(const double* x, std::size_t n, double* result) const {
+        // The common case is the Gaussian approximation of the marginal
+        // likelihood, which we evaluate for all samples and offsets at once.
+        TDouble4Vec z;
+        TDouble1Vec counts;
+        if (!m_IsNonInformative && m_Shape > MINIMUM_GAUSSIAN_SHAPE &&
+            gaussianZScores(m_Samples, m_Weights, x, n, m_Shape, m_Rate, m_Mean,
+                            m_Precision, m_PredictionMean, z, counts)) {
+            double sign = minusLogCdfSign(F());
+            for (auto& zi : z) {
+                zi *= sign;
+            }
+            CTools::minusLogStandardNormalCdf(z.data(), z.size(), z.data());
+            std::size_t m = counts.size();
+            for (std::size_t j = 0u; j < n; ++j) {
+                result[j] = 0.0;
+                for (std::size_t i = 0u; i < m; ++i) {
+                    result[j] += counts[i] * z[j * m + i];
+                }
+            }
+            return true;
+        }
+
+        for (std::size_t j = 0u; j < n; ++j) {
+            if (!evaluateFunctionOnJointDistribution(
+                    m_Samples, m_Weights, F(), SPlusWeight(), m_IsNonInformative, x[j],
+                    m_Shape, m_Rate, m_Mean, m_Precision, m_PredictionMean, result[j])) {
+                return false;
+            }
+        }
+        return true;
     }
 
 private:
@@ -251,22 +347,75 @@ public:
           m_PredictionMean(predictionMean), m_Tail(0) {}
 
     bool operator()(double x, double& result) const {
+        return (*this)(&x, 1, &result);
+    }
 
-        CJointProbabilityOfLessLikelySamples probability;
-        maths_t::ETail tail = maths_t::E_UndeterminedTail;
-
-        if (!evaluateFunctionOnJointDistribution(
-                m_Samples, m_Weights,
-                boost::bind<double>(CTools::CProbabilityOfLessLikelySample(m_Calculation),
-                                    _1, _2, boost::ref(tail)),
-                CJointProbabilityOfLessLikelySamples::SAddProbability(), m_IsNonInformative,
-                x, m_Shape, m_Rate, m_Mean, m_Precision, m_PredictionMean, probability) ||
-            !probability.calculate(result)) {
-            LOG_ERROR(<< "Failed to compute probability of less likely samples");
-            return false;
+    //! Evaluate at the \p n offsets \p x, sharing the work between them.
+    bool operator()(const double* x, std::size_t n, double* result) const {
+        // The common case is the Gaussian approximation of the marginal
+        // likelihood, which we evaluate for all samples and offsets at once.
+        TDouble4Vec z;
+        TDouble1Vec counts;
+        if (!m_IsNonInformative && m_Shape > MINIMUM_GAUSSIAN_SHAPE &&
+            gaussianZScores(m_Samples, m_Weights, x, n, m_Shape, m_Rate, m_Mean,
+                            m_Precision, m_PredictionMean, z, counts)) {
+            TDouble4Vec p(z.size());
+            CTools::standardNormalTwoTailProbability(z.data(), z.size(), p.data());
+
+            // This matches CTools::CProbabilityOfLessLikelySample for the
+            // normal distribution.
+            int tail = maths_t::E_UndeterminedTail;
+            std::size_t m = counts.size();
+            for (std::size_t j = 0u; j < n; ++j) {
+                CJointProbabilityOfLessLikelySamples probability;
+                for (std::size_t i = 0u; i < m; ++i) {
+                    double zi = z[j * m + i];
+                    double pi = p[j * m + i];
+                    switch (m_Calculation) {
+                    case maths_t::E_OneSidedBelow:
+                        pi = zi < 0.0 ? pi : 1.0;
+                        tail = tail | maths_t::E_LeftTail;
+                        break;
+                    case maths_t::E_TwoSided:
+                        tail = tail | (zi <= 0.0 ? maths_t::E_LeftTail : 0) |
+                               (zi >= 0.0 ? maths_t::E_RightTail : 0);
+                        break;
+                    case maths_t::E_OneSidedAbove:
+                        pi = zi > 0.0 ? pi : 1.0;
+                        tail = tail | maths_t::E_RightTail;
+                        break;
+                    }
+                    probability.add(pi, counts[i]);
+                }
+                if (!probability.calculate(result[j])) {
+                    LOG_ERROR(<< "Failed to compute probability of less likely samples");
+                    return false;
+                }
+            }
+
+            m_Tail = m_Tail | tail;
+
+            return true;
         }
 
-        m_Tail = m_Tail | tail;
+        for (std::size_t j = 0u; j < n; ++j) {
+            CJointProbabilityOfLessLikelySamples probability;
+            maths_t::ETail tail = maths_t::E_UndeterminedTail;
+
+            if (!evaluateFunctionOnJointDistribution(
+                    m_Samples, m_Weights,
+                    boost::bind<double>(CTools::CProbabilityOfLessLikelySample(m_Calculation),
+                                        _1, _2, boost::ref(tail)),
+                    CJointProbabilityOfLessLikelySamples::SAddProbability(),
+                    m_IsNonInformative, x[j], m_Shape, m_Rate, m_Mean, m_Precision,
+                    m_PredictionMean, probability) ||
+                !probability.calculate(result[j])) {
+                LOG_ERROR(<< "Failed to compute probability of less likely samples");
+                return false;
+            }
+
+            m_Tail = m_Tail | tail;
+        }
 
         return true;
     }
@@ -1034,7 +1183,7 @@ bool CNormalMeanPrecConjugate::minusLogJointCdf(const TDouble1Vec& samples,
         // w.r.t. to the hidden offset of the samples Z, which is uniform
         // on the interval [0,1].
         double value;
-        if (!CIntegration::logGaussLegendre<CIntegration::OrderThree>(
+        if (!CIntegration::batchLogGaussLegendre<CIntegration::OrderThree>(
                 minusLogCdf, 0.0, 1.0, value)) {
             LOG_ERROR(<< "Failed computing c.d.f. for "
                       << core::CContainerPrinter::print(samples));
@@ -1074,7 +1223,7 @@ bool CNormalMeanPrecConjugate::minusLogJointCdfComplement(const TDouble1Vec& sam
         // w.r.t. to the hidden offset of the samples Z, which is uniform
         // on the interval [0,1].
         double value;
-        if (!CIntegration::logGaussLegendre<CIntegration::OrderThree>(
+        if (!CIntegration::batchLogGaussLegendre<CIntegration::OrderThree>(
                 minusLogCdfComplement, 0.0, 1.0, value)) {
             LOG_ERROR(<< "Failed computing c.d.f. complement for "
                       << core::CContainerPrinter::print(samples));
@@ -1116,8 +1265,8 @@ bool CNormalMeanPrecConjugate::probabilityOfLessLikelySamples(
         // w.r.t. to the hidden offset of the samples Z, which is uniform
         // on the interval [0,1].
         double value;
-        if (!CIntegration::gaussLegendre<CIntegration::OrderThree>(probability, 0.0,
-                                                                   1.0, value)) {
+        if (!CIntegration::batchGaussLegendre<CIntegration::OrderThree>(
+                probability, 0.0, 1.0, value)) {
             LOG_ERROR(<< "Failed computing probability for "
                       << core::CContainerPrinter::print(samples));
             return false;
@@ -8,6 +8,7 @@
 
 #include <core/CContainerPrinter.h>
 #include <core/CLogger.h>
+#include <core/CPersistUtils.h>
 #include <core/CStatePersistInserter.h>
 #include <core/CStateRestoreTraverser.h>
 #include <core/CStringUtils.h>
@@ -25,6 +26,7 @@
 #include <maths/Constants.h>
 
 #include <boost/bind.hpp>
+#include <boost/make_unique.hpp>
 #include <boost/numeric/conversion/bounds.hpp>
 #include <boost/ref.hpp>
 
@@ -57,6 +59,9 @@ const double LOG_INITIAL_WEIGHT = std::log(1e-6);
 const double MINIMUM_SIGNIFICANT_WEIGHT = 0.01;
 const double MAXIMUM_RELATIVE_ERROR = 1e-3;
 const double LOG_MAXIMUM_RELATIVE_ERROR = std::log(MAXIMUM_RELATIVE_ERROR);
+//! The log weight, relative to the most probable model, below which
+//! models are frozen.
+const double LOG_FREEZE_WEIGHT = std::log(1e-6);
 
 // We use short field names to reduce the state size
 const std::string MODEL_TAG("a");
@@ -64,10 +69,17 @@ const std::string NUMBER_SAMPLES_TAG("b");
 //const std::string MINIMUM_TAG("c"); No longer used
 //const std::string MAXIMUM_TAG("d"); No longer used
 const std::string DECAY_RATE_TAG("e");
+const std::string LAZY_UPDATES_TAG("f");
 
 // Nested tags
 const std::string WEIGHT_TAG("a");
 const std::string PRIOR_TAG("b");
+const std::string PENDING_UPDATES_TAG("c");
+
+// Pending updates tags
+const std::string PENDING_SAMPLES_TAG("a");
+const std::string PENDING_WEIGHTS_TAG("b");
+const std::string TIME_TAG("c");
 
 const std::string EMPTY_STRING;
 
@@ -80,6 +92,16 @@ void modelAcceptPersistInserter(const CModelWeight& weight,
     inserter.insertLevel(PRIOR_TAG, boost::bind<void>(CPriorStateSerialiser(),
                                                       boost::cref(prior), _1));
 }
+
+//! Check if \p prior can be updated with samples in the range [\p minSample,
+//! \p maxSample] without adjusting its offset.
+bool isInSupport(const CPrior& prior, double minSample, double maxSample) {
+    if (prior.needsOffset() && minSample + prior.offset() < prior.offsetMargin()) {
+        return false;
+    }
+    auto support = prior.marginalLikelihoodSupport();
+    return minSample >= support.first && maxSample <= support.second;
+}
 }
 
 //////// COneOfNPrior Implementation ////////
@@ -137,8 +159,13 @@ bool COneOfNPrior::acceptRestoreTraverser(const SDistributionRestoreParams& para
         RESTORE_SETUP_TEARDOWN(NUMBER_SAMPLES_TAG, double numberSamples,
                                core::CStringUtils::stringToType(traverser.value(), numberSamples),
                                this->numberSamples(numberSamples))
+        RESTORE_BOOL(LAZY_UPDATES_TAG, m_LazyUpdates)
     } while (traverser.next());
 
+    if (m_LazyUpdates) {
+        m_PendingUpdates.resize(m_Models.size());
+    }
+
     return true;
 }
 
@@ -149,6 +176,13 @@ COneOfNPrior::COneOfNPrior(const COneOfNPrior& other)
     for (const auto& model : other.m_Models) {
         m_Models.emplace_back(model.first, TPriorPtr(model.second->clone()));
     }
+    m_PendingUpdates.reserve(other.m_PendingUpdates.size());
+    for (const auto& pending : other.m_PendingUpdates) {
+        m_PendingUpdates.push_back(pending == nullptr
+                                       ? nullptr
+                                       : boost::make_unique<SPendingUpdates>(*pending));
+    }
+    m_LazyUpdates = other.m_LazyUpdates;
 
     this->CPrior::addSamples(other.numberSamples());
 }
@@ -164,6 +198,8 @@ COneOfNPrior& COneOfNPrior::operator=(const COneOfNPrior& rhs) {
 void COneOfNPrior::swap(COneOfNPrior& other) {
     this->CPrior::swap(other);
     m_Models.swap(other.m_Models);
+    m_PendingUpdates.swap(other.m_PendingUpdates);
+    std::swap(m_LazyUpdates, other.m_LazyUpdates);
 }
 
 COneOfNPrior::EPrior COneOfNPrior::type() const {
@@ -193,6 +229,9 @@ void COneOfNPrior::setToNonInformative(double offset, double decayRate) {
         model.first.age(0.0);
         model.second->setToNonInformative(offset, decayRate);
     }
+    for (auto& pending : m_PendingUpdates) {
+        pending.reset();
+    }
     this->decayRate(decayRate);
     this->numberSamples(0.0);
 }
@@ -204,12 +243,18 @@ void COneOfNPrior::removeModels(CModelFilter& filter) {
     for (std::size_t i = 0u; i < m_Models.size(); ++i) {
         if (last != i) {
             std::swap(m_Models[last], m_Models[i]);
+            if (m_PendingUpdates.size() > 0) {
+                std::swap(m_PendingUpdates[last], m_PendingUpdates[i]);
+            }
         }
         if (!filter(m_Models[last].second->type())) {
             ++last;
         }
     }
     m_Models.erase(m_Models.begin() + last, m_Models.end());
+    if (m_PendingUpdates.size() > 0) {
+        m_PendingUpdates.erase(m_PendingUpdates.begin() + last, m_PendingUpdates.end());
+    }
 }
 
 bool COneOfNPrior::needsOffset() const {
@@ -223,11 +268,15 @@ bool COneOfNPrior::needsOffset() const {
 
 double COneOfNPrior::adjustOffset(const TDouble1Vec& samples,
                                   const TDoubleWeightsAry1Vec& weights) {
+    this->thawModels(samples);
+
     TMeanAccumulator result;
 
     TDouble5Vec penalties;
-    for (auto& model : m_Models) {
-        double penalty = model.second->adjustOffset(samples, weights);
+    for (std::size_t i = 0u; i < m_Models.size(); ++i) {
+        // Frozen models which need their offset adjusting were thawed.
+        auto& model = m_Models[i];
+        double penalty = this->isFrozen(i) ? 0.0 : model.second->adjustOffset(samples, weights);
         penalties.push_back(penalty);
         result.add(penalty, model.first);
     }
@@ -321,6 +370,10 @@ void COneOfNPrior::addSamples(const TDouble1Vec& samples,
 
     CScopeCanonicalizeWeights<TPriorPtr> canonicalize(m_Models);
 
+    // Frozen models which can't queue these samples are brought up-to-date
+    // first, so the queue of each model never exceeds its capacity.
+    this->thawModels(samples);
+
     // We need to check *before* adding samples to the constituent models.
     bool isNonInformative = this->isNonInformative();
 
@@ -330,7 +383,8 @@ void COneOfNPrior::addSamples(const TDouble1Vec& samples,
     TDouble5Vec logLikelihoods;
     TMaxAccumulator maxLogLikelihood;
     TBool5Vec used, uses;
-    for (auto& model : m_Models) {
+    for (std::size_t i = 0u; i < m_Models.size(); ++i) {
+        auto& model = m_Models[i];
         bool use = model.second->participatesInModelSelection();
 
         // Update the weights with the marginal likelihoods.
@@ -353,8 +407,17 @@ void COneOfNPrior::addSamples(const TDouble1Vec& samples,
             logLikelihoods.push_back(MINUS_INF);
         }
 
-        // Update the component prior distribution.
-        model.second->addSamples(samples, weights);
+        // Update the component prior distribution. Frozen models are
+        // updated when they're thawed.
+        if (this->isFrozen(i) == false) {
+            model.second->addSamples(samples, weights);
+        } else {
+            SPendingUpdates& pending = *m_PendingUpdates[i];
+            pending.s_Samples.insert(pending.s_Samples.end(), samples.begin(),
+                                     samples.end());
+            pending.s_Weights.insert(pending.s_Weights.end(), weights.begin(),
+                                     weights.end());
+        }
 
         used.push_back(use);
         uses.push_back(model.second->participatesInModelSelection());
@@ -400,6 +463,15 @@ void COneOfNPrior::addSamples(const TDouble1Vec& samples,
                 m_Models[i].first.logWeight(maxLogWeight[0] + LOG_INITIAL_WEIGHT);
             }
         }
+
+        if (m_LazyUpdates) {
+            for (std::size_t i = 0u; i < m_Models.size(); ++i) {
+                if (used[i] && uses[i] && m_PendingUpdates[i] == nullptr &&
+                    m_Models[i].first.logWeight() < maxLogWeight[0] + LOG_FREEZE_WEIGHT) {
+                    m_PendingUpdates[i] = boost::make_unique<SPendingUpdates>();
+                }
+            }
+        }
     }
 
     if (this->badWeights()) {
@@ -420,9 +492,13 @@ void COneOfNPrior::propagateForwardsByTime(double time) {
 
     double alpha = std::exp(-this->decayRate() * time);
 
-    for (auto& model : m_Models) {
-        model.first.age(alpha);
-        model.second->propagateForwardsByTime(time);
+    for (std::size_t i = 0u; i < m_Models.size(); ++i) {
+        m_Models[i].first.age(alpha);
+        if (this->isFrozen(i) == false) {
+            m_Models[i].second->propagateForwardsByTime(time);
+        } else {
+            m_PendingUpdates[i]->s_Time += time;
+        }
     }
 
     this->numberSamples(this->numberSamples() * alpha);
@@ -943,16 +1019,20 @@ std::string COneOfNPrior::printJointDensityFunction() const {
 
 uint64_t COneOfNPrior::checksum(uint64_t seed) const {
     seed = this->CPrior::checksum(seed);
-    return CChecksum::calculate(seed, m_Models);
+    seed = CChecksum::calculate(seed, m_Models);
+    return m_LazyUpdates ? CChecksum::calculate(seed, m_PendingUpdates) : seed;
 }
 
 void COneOfNPrior::debugMemoryUsage(core::CMemoryUsage::TMemoryUsagePtr mem) const {
     mem->setName("COneOfNPrior");
     core::CMemoryDebug::dynamicSize("m_Models", m_Models, mem);
+    if (m_LazyUpdates) {
+        core::CMemoryDebug::dynamicSize("m_PendingUpdates", m_PendingUpdates, mem);
+    }
 }
 
 std::size_t COneOfNPrior::memoryUsage() const {
-    return core::CMemory::dynamicSize(m_Models);
+    return core::CMemory::dynamicSize(m_Models) + core::CMemory::dynamicSize(m_PendingUpdates);
 }
 
 std::size_t COneOfNPrior::staticSize() const {
@@ -960,14 +1040,22 @@ std::size_t COneOfNPrior::staticSize() const {
 }
 
 void COneOfNPrior::acceptPersistInserter(core::CStatePersistInserter& inserter) const {
-    for (const auto& model : m_Models) {
-        inserter.insertLevel(MODEL_TAG, boost::bind(&modelAcceptPersistInserter,
-                                                    boost::cref(model.first),
-                                                    boost::cref(*model.second), _1));
+    for (std::size_t i = 0u; i < m_Models.size(); ++i) {
+        inserter.insertLevel(MODEL_TAG, [this, i](core::CStatePersistInserter& inserter_) {
+            modelAcceptPersistInserter(m_Models[i].first, *m_Models[i].second, inserter_);
+            if (this->isFrozen(i)) {
+                inserter_.insertLevel(PENDING_UPDATES_TAG,
+                                      boost::bind(&SPendingUpdates::acceptPersistInserter,
+                                                  m_PendingUpdates[i].get(), _1));
+            }
+        });
     }
     inserter.insertValue(DECAY_RATE_TAG, this->decayRate(), core::CIEEE754::E_SinglePrecision);
     inserter.insertValue(NUMBER_SAMPLES_TAG, this->numberSamples(),
                          core::CIEEE754::E_SinglePrecision);
+    if (m_LazyUpdates) {
+        inserter.insertValue(LAZY_UPDATES_TAG, static_cast<int>(m_LazyUpdates));
+    }
 }
 
 COneOfNPrior::TDoubleVec COneOfNPrior::weights() const {
@@ -1005,11 +1093,47 @@ COneOfNPrior::TPriorCPtrVec COneOfNPrior::models() const {
     return result;
 }
 
+std::size_t COneOfNPrior::numberFrozenModels() const {
+    return static_cast<std::size_t>(
+        std::count_if(m_PendingUpdates.begin(), m_PendingUpdates.end(),
+                      [](const TPendingUpdatesPtr& pending) {
+                          return pending != nullptr;
+                      }));
+}
+
+std::size_t COneOfNPrior::maximumNumberPendingSamples() const {
+    std::size_t result{0};
+    for (const auto& pending : m_PendingUpdates) {
+        if (pending != nullptr) {
+            result = std::max(result, pending->s_Samples.size());
+        }
+    }
+    return result;
+}
+
+void COneOfNPrior::lazyUpdates(bool enabled) {
+    if (enabled == m_LazyUpdates) {
+        return;
+    }
+    m_LazyUpdates = enabled;
+    if (enabled) {
+        m_PendingUpdates.resize(m_Models.size());
+    } else {
+        for (std::size_t i = 0u; i < m_Models.size(); ++i) {
+            if (this->isFrozen(i)) {
+                this->thaw(i);
+            }
+        }
+        TPendingUpdatesPtrVec().swap(m_PendingUpdates);
+    }
+}
+
 bool COneOfNPrior::modelAcceptRestoreTraverser(const SDistributionRestoreParams& params,
                                                core::CStateRestoreTraverser& traverser) {
     CModelWeight weight(1.0);
     bool gotWeight = false;
     TPriorPtr model;
+    TPendingUpdatesPtr pending;
 
     do {
         const std::string& name = traverser.name();
@@ -1021,6 +1145,12 @@ bool COneOfNPrior::modelAcceptRestoreTraverser(const SDistributionRestoreParams&
         RESTORE(PRIOR_TAG, traverser.traverseSubLevel(boost::bind<bool>(
                                CPriorStateSerialiser(), boost::cref(params),
                                boost::ref(model), _1)))
+        RESTORE_SETUP_TEARDOWN(PENDING_UPDATES_TAG,
+                               pending = boost::make_unique<SPendingUpdates>(),
+                               traverser.traverseSubLevel(boost::bind(
+                                   &SPendingUpdates::acceptRestoreTraverser,
+                                   pending.get(), _1)),
+                               /**/)
     } while (traverser.next());
 
     if (!gotWeight) {
@@ -1033,6 +1163,10 @@ bool COneOfNPrior::modelAcceptRestoreTraverser(const SDistributionRestoreParams&
     }
 
     m_Models.emplace_back(weight, std::move(model));
+    if (pending != nullptr) {
+        m_PendingUpdates.resize(m_Models.size());
+        m_PendingUpdates.back() = std::move(pending);
+    }
 
     return true;
 }
@@ -1056,6 +1190,57 @@ COneOfNPrior::TDoubleSizePr5Vec COneOfNPrior::normalizedLogWeights() const {
     return result;
 }
 
+void COneOfNPrior::thawModels(const TDouble1Vec& samples) {
+    if (std::none_of(m_PendingUpdates.begin(), m_PendingUpdates.end(),
+                     [](const TPendingUpdatesPtr& pending) {
+                         return pending != nullptr;
+                     })) {
+        return;
+    }
+
+    // Models are thawed if they would otherwise lag by too many samples,
+    // if their weight has recovered or if their offset needs adjusting.
+
+    double minSample = INF;
+    double maxSample = MINUS_INF;
+    for (auto i = CMathsFuncs::beginFinite(samples); i != CMathsFuncs::endFinite(samples); ++i) {
+        minSample = std::min(minSample, *i);
+        maxSample = std::max(maxSample, *i);
+    }
+    TMaxAccumulator maxLogWeight;
+    for (const auto& model : m_Models) {
+        if (model.second->participatesInModelSelection()) {
+            maxLogWeight.add(model.first.logWeight());
+        }
+    }
+
+    for (std::size_t i = 0u; i < m_Models.size(); ++i) {
+        if (this->isFrozen(i) &&
+            (m_PendingUpdates[i]->s_Samples.size() + samples.size() > MAXIMUM_PENDING_SAMPLES ||
+             m_Models[i].first.logWeight() >= maxLogWeight[0] + LOG_FREEZE_WEIGHT ||
+             (minSample <= maxSample &&
+              isInSupport(*m_Models[i].second, minSample, maxSample) == false))) {
+            this->thaw(i);
+        }
+    }
+}
+
+bool COneOfNPrior::isFrozen(std::size_t i) const {
+    return m_PendingUpdates.size() > 0 && m_PendingUpdates[i] != nullptr;
+}
+
+void COneOfNPrior::thaw(std::size_t i) {
+    SPendingUpdates& pending = *m_PendingUpdates[i];
+    CPrior& model = *m_Models[i].second;
+    if (pending.s_Time > 0.0) {
+        model.propagateForwardsByTime(pending.s_Time);
+    }
+    if (pending.s_Samples.size() > 0) {
+        model.addSamples(pending.s_Samples, pending.s_Weights);
+    }
+    m_PendingUpdates[i].reset();
+}
+
 double COneOfNPrior::medianModelMean() const {
     TDoubleVec means;
     means.reserve(m_Models.size());
@@ -1088,5 +1273,61 @@ std::string COneOfNPrior::debugWeights() const {
     result << " ";
     return result.str();
 }
+
+//////// COneOfNPrior::SPendingUpdates Implementation ////////
+
+uint64_t COneOfNPrior::SPendingUpdates::checksum(uint64_t seed) const {
+    seed = CChecksum::calculate(seed, s_Samples);
+    seed = CChecksum::calculate(seed, s_Weights);
+    return CChecksum::calculate(seed, s_Time);
+}
+
+void COneOfNPrior::SPendingUpdates::debugMemoryUsage(core::CMemoryUsage::TMemoryUsagePtr mem) const {
+    mem->setName("SPendingUpdates");
+    core::CMemoryDebug::dynamicSize("s_Samples", s_Samples, mem);
+    core::CMemoryDebug::dynamicSize("s_Weights", s_Weights, mem);
+}
+
+std::size_t COneOfNPrior::SPendingUpdates::memoryUsage() const {
+    return core::CMemory::dynamicSize(s_Samples) + core::CMemory::dynamicSize(s_Weights);
+}
+
+void COneOfNPrior::SPendingUpdates::acceptPersistInserter(core::CStatePersistInserter& inserter) const {
+    // The weights are flattened because this is much more compact.
+    TDoubleVec weights;
+    weights.reserve(s_Weights.size() * maths_t::NUMBER_WEIGHT_STYLES);
+    for (const auto& weight : s_Weights) {
+        weights.insert(weights.end(), weight.begin(), weight.end());
+    }
+    core::CPersistUtils::persist(PENDING_SAMPLES_TAG, s_Samples, inserter);
+    core::CPersistUtils::persist(PENDING_WEIGHTS_TAG, weights, inserter);
+    inserter.insertValue(TIME_TAG, s_Time, core::CIEEE754::E_DoublePrecision);
+}
+
+bool COneOfNPrior::SPendingUpdates::acceptRestoreTraverser(core::CStateRestoreTraverser& traverser) {
+    do {
+        const std::string& name = traverser.name();
+        RESTORE(PENDING_SAMPLES_TAG,
+                core::CPersistUtils::restore(PENDING_SAMPLES_TAG, s_Samples, traverser))
+        if (name == PENDING_WEIGHTS_TAG) {
+            TDoubleVec weights;
+            if (core::CPersistUtils::fromString(traverser.value(), weights) == false ||
+                weights.size() % maths_t::NUMBER_WEIGHT_STYLES != 0) {
+                LOG_ERROR(<< "Invalid weights in " << traverser.value());
+                return false;
+            }
+            s_Weights.resize(weights.size() / maths_t::NUMBER_WEIGHT_STYLES);
+            for (std::size_t i = 0u; i < weights.size(); ++i) {
+                s_Weights[i / maths_t::NUMBER_WEIGHT_STYLES][i % maths_t::NUMBER_WEIGHT_STYLES] =
+                    weights[i];
+            }
+            continue;
+        }
+        RESTORE_BUILT_IN(TIME_TAG, s_Time)
+    } while (traverser.next());
+    return s_Samples.size() == s_Weights.size();
+}
+
+const std::size_t COneOfNPrior::MAXIMUM_PENDING_SAMPLES{16};
 }
 }
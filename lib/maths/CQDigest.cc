@@ -356,6 +356,32 @@ void CQDigest::superlevelSetInfimum(uint32_t x, uint32_t& result) const {
     m_Root->superlevelSetInfimum(x, result);
 }
 
+void CQDigest::cdfEndPoints(TUInt32Vec& result) const {
+    result.clear();
+
+    if (m_N == 0) {
+        return;
+    }
+
+    TNodePtrVec nodes;
+    m_Root->postOrder(nodes);
+
+    // The c.d.f. lower bound changes at each node's maximum and the upper
+    // bound at each node's minimum. The p.d.f. also depends on the nearest
+    // node maximum less than x, which changes one past each node's maximum.
+    result.reserve(3 * nodes.size() + 1);
+    result.push_back(0);
+    for (const auto& node : nodes) {
+        result.push_back(node->min());
+        result.push_back(node->max());
+        if (node->max() < std::numeric_limits<uint32_t>::max()) {
+            result.push_back(node->max() + 1);
+        }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+}
+
 void CQDigest::summary(TUInt32UInt64PrVec& result) const {
     result.clear();
 
@@ -7,10 +7,12 @@
 #include <maths/CSampling.h>
 
 #include <core/CContainerPrinter.h>
+#include <core/CHashing.h>
 #include <core/CLogger.h>
 #include <core/CScopedFastLock.h>
 #include <core/CStatePersistInserter.h>
 #include <core/CStateRestoreTraverser.h>
+#include <core/CStringUtils.h>
 
 #include <maths/CLinearAlgebraEigen.h>
 #include <maths/COrderings.h>
@@ -394,6 +396,13 @@ void sampleQuantiles(const DISTRIBUTION& distribution, std::size_t n, TDoubleVec
 }
 
 const std::string RNG_TAG("a");
+const std::string STREAM_SEED_TAG("b");
+
+//! The default seed for random number streams.
+const std::uint64_t DEFAULT_STREAM_SEED{0x5851f42d4c957f2d};
+
+//! The calling thread's innermost random number stream.
+thread_local CSampling::CScopeRandomNumberStream* currentStream{nullptr};
 }
 
 bool CSampling::staticsAcceptRestoreTraverser(core::CStateRestoreTraverser& traverser) {
@@ -409,6 +418,13 @@ bool CSampling::staticsAcceptRestoreTraverser(core::CStateRestoreTraverser& trav
             std::istringstream ss(value);
             core::CScopedFastLock scopedLock(ms_Lock);
             ss >> ms_Rng;
+        } else if (name == STREAM_SEED_TAG) {
+            std::uint64_t seed;
+            if (core::CStringUtils::stringToType(traverser.value(), seed) == false) {
+                LOG_ERROR(<< "Invalid stream seed in " << traverser.value());
+                return false;
+            }
+            ms_StreamSeed.store(seed);
         }
     } while (traverser.next());
 
@@ -428,17 +444,18 @@ void CSampling::staticsAcceptPersistInserter(core::CStatePersistInserter& insert
     // the JSON parser gets confused.
     std::replace(rng.begin(), rng.end(), ' ', '_');
     inserter.insertValue(RNG_TAG, rng);
+    inserter.insertValue(STREAM_SEED_TAG, ms_StreamSeed.load());
 }
 
 void CSampling::seed() {
     core::CScopedFastLock scopedLock(ms_Lock);
     ms_Rng.seed();
+    ms_StreamSeed.store(DEFAULT_STREAM_SEED);
 }
 
 #define UNIFORM_SAMPLE(TYPE)                                                                  \
     TYPE CSampling::uniformSample(TYPE a, TYPE b) {                                           \
-        core::CScopedFastLock scopedLock(ms_Lock);                                            \
-        return doUniformSample(ms_Rng, a, b);                                                 \
+        return withGenerator([&](auto& rng) { return doUniformSample(rng, a, b); });          \
     }                                                                                         \
     TYPE CSampling::uniformSample(CPRNG::CXorOShiro128Plus& rng, TYPE a, TYPE b) {            \
         return doUniformSample(rng, a, b);                                                    \
@@ -447,8 +464,7 @@ void CSampling::seed() {
         return doUniformSample(rng, a, b);                                                    \
     }                                                                                         \
     void CSampling::uniformSample(TYPE a, TYPE b, std::size_t n, std::vector<TYPE>& result) { \
-        core::CScopedFastLock scopedLock(ms_Lock);                                            \
-        doUniformSample(ms_Rng, a, b, n, result);                                             \
+        withGenerator([&](auto& rng) { doUniformSample(rng, a, b, n, result); });             \
     }                                                                                         \
     void CSampling::uniformSample(CPRNG::CXorOShiro128Plus& rng, TYPE a, TYPE b,              \
                                   std::size_t n, std::vector<TYPE>& result) {                 \
@@ -464,8 +480,7 @@ UNIFORM_SAMPLE(double)
 #undef UNIFORM_SAMPLE
 
 double CSampling::normalSample(double mean, double variance) {
-    core::CScopedFastLock scopedLock(ms_Lock);
-    return doNormalSample(ms_Rng, mean, variance);
+    return withGenerator([&](auto& rng) { return doNormalSample(rng, mean, variance); });
 }
 
 double CSampling::normalSample(CPRNG::CXorOShiro128Plus& rng, double mean, double variance) {
@@ -477,8 +492,7 @@ double CSampling::normalSample(CPRNG::CXorShift1024Mult& rng, double mean, doubl
 }
 
 void CSampling::normalSample(double mean, double variance, std::size_t n, TDoubleVec& result) {
-    core::CScopedFastLock scopedLock(ms_Lock);
-    doNormalSample(ms_Rng, mean, variance, n, result);
+    withGenerator([&](auto& rng) { doNormalSample(rng, mean, variance, n, result); });
 }
 
 void CSampling::normalSample(CPRNG::CXorOShiro128Plus& rng,
@@ -498,8 +512,7 @@ void CSampling::normalSample(CPRNG::CXorShift1024Mult& rng,
 }
 
 void CSampling::chiSquaredSample(double f, std::size_t n, TDoubleVec& result) {
-    core::CScopedFastLock scopedLock(ms_Lock);
-    doChiSquaredSample(ms_Rng, f, n, result);
+    withGenerator([&](auto& rng) { doChiSquaredSample(rng, f, n, result); });
 }
 
 void CSampling::chiSquaredSample(CPRNG::CXorOShiro128Plus& rng,
@@ -520,8 +533,9 @@ bool CSampling::multivariateNormalSample(const TDoubleVec& mean,
                                          const TDoubleVecVec& covariance,
                                          std::size_t n,
                                          TDoubleVecVec& samples) {
-    core::CScopedFastLock scopedLock(ms_Lock);
-    return doMultivariateNormalSample(ms_Rng, mean, covariance, n, samples);
+    return withGenerator([&](auto& rng) {
+        return doMultivariateNormalSample(rng, mean, covariance, n, samples);
+    });
 }
 
 bool CSampling::multivariateNormalSample(CPRNG::CXorOShiro128Plus& rng,
@@ -544,8 +558,9 @@ bool CSampling::multivariateNormalSample(CPRNG::CXorShift1024Mult& rng,
     void CSampling::multivariateNormalSample(                                                \
         const CVectorNx1<double, N>& mean, const CSymmetricMatrixNxN<double, N>& covariance, \
         std::size_t n, std::vector<CVectorNx1<double, N>>& samples) {                        \
-        core::CScopedFastLock scopedLock(ms_Lock);                                           \
-        doMultivariateNormalSample(ms_Rng, mean, covariance, n, samples);                    \
+        withGenerator([&](auto& rng) {                                                       \
+            doMultivariateNormalSample(rng, mean, covariance, n, samples);                   \
+        });                                                                                  \
     }                                                                                        \
     void CSampling::multivariateNormalSample(                                                \
         CPRNG::CXorOShiro128Plus& rng, const CVectorNx1<double, N>& mean,                    \
@@ -566,8 +581,7 @@ MULTIVARIATE_NORMAL_SAMPLE(5)
 #undef MULTIVARIATE_NORMAL_SAMPLE
 
 std::size_t CSampling::categoricalSample(TDoubleVec& probabilities) {
-    core::CScopedFastLock scopedLock(ms_Lock);
-    return doCategoricalSample(ms_Rng, probabilities);
+    return withGenerator([&](auto& rng) { return doCategoricalSample(rng, probabilities); });
 }
 
 std::size_t CSampling::categoricalSample(CPRNG::CXorOShiro128Plus& rng,
@@ -583,8 +597,9 @@ std::size_t CSampling::categoricalSample(CPRNG::CXorShift1024Mult& rng,
 void CSampling::categoricalSampleWithReplacement(TDoubleVec& probabilities,
                                                  std::size_t n,
                                                  TSizeVec& result) {
-    core::CScopedFastLock scopedLock(ms_Lock);
-    doCategoricalSampleWithReplacement(ms_Rng, probabilities, n, result);
+    withGenerator([&](auto& rng) {
+        doCategoricalSampleWithReplacement(rng, probabilities, n, result);
+    });
 }
 
 void CSampling::categoricalSampleWithReplacement(CPRNG::CXorOShiro128Plus& rng,
@@ -604,8 +619,9 @@ void CSampling::categoricalSampleWithReplacement(CPRNG::CXorShift1024Mult& rng,
 void CSampling::categoricalSampleWithoutReplacement(TDoubleVec& probabilities,
                                                     std::size_t n,
                                                     TSizeVec& result) {
-    core::CScopedFastLock scopedLock(ms_Lock);
-    doCategoricalSampleWithoutReplacement(ms_Rng, probabilities, n, result);
+    withGenerator([&](auto& rng) {
+        doCategoricalSampleWithoutReplacement(rng, probabilities, n, result);
+    });
 }
 
 void CSampling::categoricalSampleWithoutReplacement(CPRNG::CXorOShiro128Plus& rng,
@@ -666,15 +682,16 @@ void CSampling::multinomialSampleFast(TDoubleVec& probabilities,
         std::size_t r = n;
         double p = 1.0;
         std::size_t m = probabilities.size() - 1;
-        core::CScopedFastLock scopedLock(ms_Lock);
-        for (std::size_t i = 0u; r > 0 && i < m; ++i) {
-            boost::random::binomial_distribution<> binomial(static_cast<int>(r),
-                                                            probabilities[i] / p);
-            std::size_t ni = static_cast<std::size_t>(binomial(ms_Rng));
-            sample.push_back(ni);
-            r -= ni;
-            p -= probabilities[i];
-        }
+        withGenerator([&](auto& rng) {
+            for (std::size_t i = 0u; r > 0 && i < m; ++i) {
+                boost::random::binomial_distribution<> binomial(static_cast<int>(r),
+                                                                probabilities[i] / p);
+                std::size_t ni = static_cast<std::size_t>(binomial(rng));
+                sample.push_back(ni);
+                r -= ni;
+                p -= probabilities[i];
+            }
+        });
         if (r > 0) {
             sample.push_back(r);
         }
@@ -834,6 +851,8 @@ void CSampling::gammaSampleQuantiles(double shape, double rate, std::size_t n, T
 
 core::CFastMutex CSampling::ms_Lock;
 CSampling::CRandomNumberGenerator CSampling::ms_Rng;
+std::atomic<std::uint64_t> CSampling::ms_StreamSeed{DEFAULT_STREAM_SEED};
+std::atomic<bool> CSampling::ms_Mocked{false};
 
 void CSampling::CRandomNumberGenerator::mock() {
     m_Mock.reset((min() + max()) / 2);
@@ -849,10 +868,34 @@ void CSampling::CRandomNumberGenerator::seed() {
 
 CSampling::CScopeMockRandomNumberGenerator::CScopeMockRandomNumberGenerator() {
     CSampling::ms_Rng.mock();
+    CSampling::ms_Mocked.store(true);
 }
 
 CSampling::CScopeMockRandomNumberGenerator::~CScopeMockRandomNumberGenerator() {
+    CSampling::ms_Mocked.store(false);
     CSampling::ms_Rng.unmock();
 }
+
+CSampling::CScopeRandomNumberStream::CScopeRandomNumberStream(std::uint64_t stream)
+    : m_Previous(currentStream), m_Stream(stream), m_Mocked(ms_Mocked.load()),
+      m_Rng(core::CHashing::hashCombine(ms_StreamSeed.load(), stream)) {
+    currentStream = this;
+}
+
+CSampling::CScopeRandomNumberStream::~CScopeRandomNumberStream() {
+    currentStream = m_Previous;
+}
+
+CSampling::CScopeRandomNumberStream::TOptionalUInt64
+CSampling::CScopeRandomNumberStream::current() {
+    return currentStream != nullptr ? TOptionalUInt64{currentStream->m_Stream}
+                                    : TOptionalUInt64{};
+}
+
+CPRNG::CXorOShiro128Plus* CSampling::CScopeRandomNumberStream::generator() {
+    return currentStream != nullptr && currentStream->m_Mocked == false
+               ? &currentStream->m_Rng
+               : nullptr;
+}
 }
 }
@@ -14,17 +14,32 @@
 
 #include <algorithm>
 #include <cmath>
+#include <map>
+#include <memory>
 
 namespace ml {
 namespace maths {
 
 namespace {
 
+class CFftPlan;
+class CRealFftPlan;
+
+using TSizeVec = std::vector<std::size_t>;
+using TDoubleVec = std::vector<double>;
 using TComplex = std::complex<double>;
 using TComplexVec = std::vector<TComplex>;
+using TFftPlanCPtr = std::shared_ptr<const CFftPlan>;
+using TRealFftPlanCPtr = std::shared_ptr<const CRealFftPlan>;
 using TMeanAccumulator = CBasicStatistics::SSampleMean<double>::TAccumulator;
 using TMeanVarAccumulator = CBasicStatistics::SSampleMeanVar<double>::TAccumulator;
 
+//! The largest prime factor of a length for which we use a mixed radix
+//! transform. Lengths with larger prime factors use Bluestein's trick.
+const std::size_t MAXIMUM_RADIX{31};
+//! The maximum number of plans of each type cached per thread.
+const std::size_t MAXIMUM_CACHED_PLANS{64};
+
 //! Scale \p f by \p scale.
 void scale(double scale, TComplexVec& f) {
     for (std::size_t i = 0u; i < f.size(); ++i) {
@@ -32,37 +47,310 @@ void scale(double scale, TComplexVec& f) {
     }
 }
 
-//! Compute the radix 2 FFT of \p f in-place.
-void radix2fft(TComplexVec& f) {
-    // Perform the appropriate permutation of f(x) by swapping
-    // each i in [0, N] with its bit reversal.
+//! Get \f$e^{-2\pi i k / n}\f$.
+TComplex twiddle(std::size_t k, std::size_t n) {
+    double t = -boost::math::double_constants::two_pi * static_cast<double>(k) /
+               static_cast<double>(n);
+    return {std::cos(t), std::sin(t)};
+}
+
+//! Multiply \p z by -i.
+TComplex timesMinusI(const TComplex& z) {
+    return {z.imag(), -z.real()};
+}
+
+//! \brief The factors and twiddle factors needed to compute the DFT of
+//! one length.
+//!
+//! DESCRIPTION:\n
+//! Lengths whose prime factors are all small are transformed by a mixed
+//! radix decimation in time with specialised butterflies for radices 2,
+//! 3, 4 and 5. Other lengths use Bluestein's trick to reformulate the DFT
+//! as a cyclic convolution whose length is a power of 2.
+class CFftPlan {
+public:
+    explicit CFftPlan(std::size_t n);
+
+    //! Compute the DFT of \p f in-place using \p workspace as scratch.
+    void transform(TComplexVec& f, TComplexVec& workspace) const;
+
+private:
+    //! Write the DFT of the \p n values of \p in at spacing \p stride to
+    //! \p out using the radices from \p factor onwards.
+    void mixedRadix(const TComplex* in,
+                    std::size_t stride,
+                    TComplex* out,
+                    std::size_t n,
+                    std::size_t factor) const;
+
+    //! Compute the DFT of \p f using Bluestein's trick.
+    void bluestein(TComplexVec& f, TComplexVec& workspace) const;
+
+private:
+    //! The length of the transform.
+    std::size_t m_Size;
+    //! The radices in the order they're applied.
+    TSizeVec m_Factors;
+    //! The values \f$e^{-2\pi i k / n}\f$ for \f$k < n\f$.
+    TComplexVec m_Twiddles;
+    //! The chirp \f$e^{\pi i k^2 / n}\f$ if using Bluestein's trick.
+    TComplexVec m_Chirp;
+    //! The DFT of the chirp padded to the convolution length.
+    TComplexVec m_ChirpDft;
+    //! The plan for the convolution if using Bluestein's trick.
+    TFftPlanCPtr m_Convolution;
+};
+
+//! \brief The plan needed to compute the DFT of a real series of even
+//! length as a complex DFT of half its length.
+class CRealFftPlan {
+public:
+    explicit CRealFftPlan(std::size_t n);
+
+    //! Write the DFT of \p f to \p result using \p workspace as scratch.
+    void transform(const TDoubleVec& f, TComplexVec& result, TComplexVec& workspace) const;
+
+private:
+    //! The plan for the half length complex DFT.
+    TFftPlanCPtr m_Half;
+    //! The values \f$e^{-2\pi i k / n}\f$ for \f$k < n / 2\f$.
+    TComplexVec m_Twiddles;
+};
+
+//! \brief The plans and scratch space used by the current thread.
+struct SFftCache {
+    std::map<std::size_t, TFftPlanCPtr> s_Plans;
+    std::map<std::size_t, TRealFftPlanCPtr> s_RealPlans;
+    TComplexVec s_Workspace;
+};
+
+SFftCache& fftCache() {
+    thread_local SFftCache cache;
+    return cache;
+}
+
+//! Get the plan for length \p n from \p plans creating it if necessary.
+template<typename PLAN>
+std::shared_ptr<const PLAN>
+cachedPlan(std::map<std::size_t, std::shared_ptr<const PLAN>>& plans, std::size_t n) {
+    auto i = plans.find(n);
+    if (i == plans.end()) {
+        if (plans.size() >= MAXIMUM_CACHED_PLANS) {
+            // Plans hold shared pointers to any plans they use.
+            plans.clear();
+        }
+        i = plans.emplace(n, std::make_shared<const PLAN>(n)).first;
+    }
+    return i->second;
+}
+
+TFftPlanCPtr fftPlan(std::size_t n) {
+    return cachedPlan(fftCache().s_Plans, n);
+}
+
+TRealFftPlanCPtr realFftPlan(std::size_t n) {
+    return cachedPlan(fftCache().s_RealPlans, n);
+}
 
-    uint64_t bits = CIntegerTools::nextPow2(f.size()) - 1;
-    for (uint64_t i = 0; i < f.size(); ++i) {
-        uint64_t j = CIntegerTools::reverseBits(i) >> (64 - bits);
-        if (j > i) {
-            LOG_TRACE(<< j << " -> " << i);
-            std::swap(f[i], f[j]);
+CFftPlan::CFftPlan(std::size_t n) : m_Size{n} {
+    // Use radix 4 where possible since it needs the fewest operations.
+    for (/**/; n % 4 == 0; n /= 4) {
+        m_Factors.push_back(4);
+    }
+    for (std::size_t r = 2; r <= MAXIMUM_RADIX && n > 1; ++r) {
+        for (/**/; n % r == 0; n /= r) {
+            m_Factors.push_back(r);
         }
     }
 
-    // Apply the twiddle factors.
+    if (n == 1) {
+        m_Twiddles.reserve(m_Size);
+        for (std::size_t k = 0u; k < m_Size; ++k) {
+            m_Twiddles.push_back(twiddle(k, m_Size));
+        }
+    } else {
+        LOG_TRACE(<< "Using Bluestein's trick for " << m_Size);
+        m_Factors.clear();
 
-    for (std::size_t stride = 1; stride < f.size(); stride <<= 1) {
-        for (std::size_t k = 0u; k < stride; ++k) {
+        n = m_Size;
+        std::size_t m = std::size_t{1} << CIntegerTools::nextPow2(2 * n - 1);
+        m_Convolution = fftPlan(m);
+
+        m_Chirp.reserve(n);
+        m_ChirpDft.resize(m, TComplex(0.0));
+        m_Chirp.emplace_back(1.0, 0.0);
+        m_ChirpDft[0] = m_Chirp[0];
+        for (std::size_t i = 1u; i < n; ++i) {
+            // Reduce i^2 modulo 2n to keep the angle accurate.
             double t = boost::math::double_constants::pi *
-                       static_cast<double>(k) / static_cast<double>(stride);
-            TComplex w(std::cos(t), std::sin(t));
-            for (std::size_t start = k; start < f.size(); start += 2 * stride) {
-                TComplex fs = f[start];
-                TComplex tw = w * f[start + stride];
-                f[start] = fs + tw;
-                f[start + stride] = fs - tw;
+                       static_cast<double>((i * i) % (2 * n)) / static_cast<double>(n);
+            m_Chirp.emplace_back(std::cos(t), std::sin(t));
+            m_ChirpDft[i] = m_ChirpDft[m - i] = m_Chirp[i];
+        }
+        TComplexVec workspace;
+        m_Convolution->transform(m_ChirpDft, workspace);
+    }
+}
+
+void CFftPlan::transform(TComplexVec& f, TComplexVec& workspace) const {
+    if (m_Size <= 1) {
+        return;
+    }
+    if (m_Convolution != nullptr) {
+        this->bluestein(f, workspace);
+    } else {
+        workspace.assign(f.begin(), f.end());
+        this->mixedRadix(workspace.data(), 1, f.data(), m_Size, 0);
+    }
+}
+
+void CFftPlan::mixedRadix(const TComplex* in,
+                          std::size_t stride,
+                          TComplex* out,
+                          std::size_t n,
+                          std::size_t factor) const {
+    std::size_t r = m_Factors[factor];
+    std::size_t m = n / r;
+
+    if (m == 1) {
+        for (std::size_t q = 0u; q < r; ++q) {
+            out[q] = in[q * stride];
+        }
+    } else {
+        for (std::size_t q = 0u; q < r; ++q) {
+            this->mixedRadix(in + q * stride, stride * r, out + q * m, m, factor + 1);
+        }
+    }
+
+    // Combine the r DFTs of length m. The twiddle factor for the q'th
+    // DFT's k'th value is exp(-2 pi i q k / n).
+
+    std::size_t step = m_Size / n;
+    TComplex t[MAXIMUM_RADIX];
+    for (std::size_t k = 0u; k < m; ++k) {
+        t[0] = out[k];
+        for (std::size_t q = 1u; q < r; ++q) {
+            t[q] = out[q * m + k] * m_Twiddles[q * k * step];
+        }
+        switch (r) {
+        case 2:
+            out[k] = t[0] + t[1];
+            out[k + m] = t[0] - t[1];
+            break;
+        case 3: {
+            static const double SIN_PI_BY_3 = std::sqrt(3.0) / 2.0;
+            TComplex s = t[1] + t[2];
+            TComplex d = SIN_PI_BY_3 * timesMinusI(t[1] - t[2]);
+            TComplex c = t[0] - 0.5 * s;
+            out[k] = t[0] + s;
+            out[k + m] = c + d;
+            out[k + 2 * m] = c - d;
+            break;
+        }
+        case 4: {
+            TComplex a = t[0] + t[2];
+            TComplex b = t[0] - t[2];
+            TComplex c = t[1] + t[3];
+            TComplex d = timesMinusI(t[1] - t[3]);
+            out[k] = a + c;
+            out[k + m] = b + d;
+            out[k + 2 * m] = a - c;
+            out[k + 3 * m] = b - d;
+            break;
+        }
+        case 5: {
+            static const double C1 = std::cos(boost::math::double_constants::two_pi / 5.0);
+            static const double C2 = std::cos(2.0 * boost::math::double_constants::two_pi / 5.0);
+            static const double S1 = std::sin(boost::math::double_constants::two_pi / 5.0);
+            static const double S2 = std::sin(2.0 * boost::math::double_constants::two_pi / 5.0);
+            TComplex a1 = t[1] + t[4];
+            TComplex a2 = t[2] + t[3];
+            TComplex b1 = timesMinusI(t[1] - t[4]);
+            TComplex b2 = timesMinusI(t[2] - t[3]);
+            TComplex c1 = t[0] + C1 * a1 + C2 * a2;
+            TComplex c2 = t[0] + C2 * a1 + C1 * a2;
+            TComplex d1 = S1 * b1 + S2 * b2;
+            TComplex d2 = S2 * b1 - S1 * b2;
+            out[k] = t[0] + a1 + a2;
+            out[k + m] = c1 + d1;
+            out[k + 2 * m] = c2 + d2;
+            out[k + 3 * m] = c2 - d2;
+            out[k + 4 * m] = c1 - d1;
+            break;
+        }
+        default: {
+            // The twiddle factor exp(-2 pi i p q / r) is m_Twiddles[(p q mod r) m_Size / r].
+            std::size_t rstep = m_Size / r;
+            for (std::size_t p = 0u; p < r; ++p) {
+                TComplex y = t[0];
+                for (std::size_t q = 1u, pq = p; q < r; ++q, pq = (pq + p) % r) {
+                    y += t[q] * m_Twiddles[pq * rstep];
+                }
+                out[k + p * m] = y;
             }
+            break;
+        }
         }
     }
+}
+
+void CFftPlan::bluestein(TComplexVec& f, TComplexVec& workspace) const {
+    std::size_t n = m_Size;
+    std::size_t m = m_ChirpDft.size();
+
+    TComplexVec a(m, TComplex(0.0));
+    for (std::size_t i = 0u; i < n; ++i) {
+        a[i] = f[i] * std::conj(m_Chirp[i]);
+    }
+
+    // Convolve with the chirp using the fact that the inverse DFT is the
+    // conjugate of the DFT of the conjugate.
+    m_Convolution->transform(a, workspace);
+    for (std::size_t i = 0u; i < m; ++i) {
+        a[i] = std::conj(a[i] * m_ChirpDft[i]);
+    }
+    m_Convolution->transform(a, workspace);
 
-    std::reverse(f.begin() + 1, f.end());
+    for (std::size_t i = 0u; i < n; ++i) {
+        f[i] = std::conj(m_Chirp[i]) * std::conj(a[i]) / static_cast<double>(m);
+    }
+}
+
+CRealFftPlan::CRealFftPlan(std::size_t n) : m_Half{fftPlan(n / 2)} {
+    m_Twiddles.reserve(n / 2);
+    for (std::size_t k = 0u; k < n / 2; ++k) {
+        m_Twiddles.push_back(twiddle(k, n));
+    }
+}
+
+void CRealFftPlan::transform(const TDoubleVec& f,
+                             TComplexVec& result,
+                             TComplexVec& workspace) const {
+    // Pack the even and odd values into the real and imaginary parts of
+    // a half length series z, whose DFT Z gives the DFTs of the even and
+    // odd values, E and O, since E(k) = (Z(k) + Z(h-k)^*) / 2 and O(k) =
+    // (Z(k) - Z(h-k)^*) / 2i. Then F(k) = E(k) + exp(-2 pi i k / n) O(k)
+    // and F(n - k) = F(k)^*.
+
+    std::size_t n = f.size();
+    std::size_t h = n / 2;
+
+    result.resize(n);
+    for (std::size_t i = 0u; i < h; ++i) {
+        result[i] = TComplex(f[2 * i], f[2 * i + 1]);
+    }
+    TComplexVec z(result.begin(), result.begin() + h);
+    m_Half->transform(z, workspace);
+
+    result[0] = TComplex(z[0].real() + z[0].imag(), 0.0);
+    result[h] = TComplex(z[0].real() - z[0].imag(), 0.0);
+    for (std::size_t k = 1u; k < h; ++k) {
+        TComplex zc = std::conj(z[h - k]);
+        TComplex even = 0.5 * (z[k] + zc);
+        TComplex odd = 0.5 * timesMinusI(z[k] - zc);
+        result[k] = even + m_Twiddles[k] * odd;
+        result[n - k] = std::conj(result[k]);
+    }
 }
 }
 
@@ -79,48 +367,17 @@ void CSignal::hadamard(const TComplexVec& fx, TComplexVec& fy) {
 }
 
 void CSignal::fft(TComplexVec& f) {
-    std::size_t n = f.size();
-    std::size_t p = CIntegerTools::nextPow2(n);
-    std::size_t m = std::size_t{1} << p;
-
-    LOG_TRACE(<< "n = " << n << ", m = " << m);
+    if (f.size() > 1) {
+        fftPlan(f.size())->transform(f, fftCache().s_Workspace);
+    }
+}
 
-    if ((m >> 1) == n) {
-        radix2fft(f);
+void CSignal::fft(const TDoubleVec& f, TComplexVec& result) {
+    if (f.size() % 2 == 1 || f.size() < 2) {
+        result.assign(f.begin(), f.end());
+        fft(result);
     } else {
-        // We use Bluestein's trick to reformulate as a convolution
-        // which can be computed by padding to a power of 2.
-
-        LOG_TRACE(<< "Using Bluestein's trick");
-
-        m = 2 * n - 1;
-        p = CIntegerTools::nextPow2(m);
-        m = std::size_t{1} << p;
-
-        TComplexVec chirp;
-        chirp.reserve(n);
-        TComplexVec a(m, TComplex(0.0));
-        TComplexVec b(m, TComplex(0.0));
-
-        chirp.emplace_back(1.0, 0.0);
-        a[0] = f[0] * chirp[0];
-        b[0] = chirp[0];
-        for (std::size_t i = 1u; i < n; ++i) {
-            double t = boost::math::double_constants::pi *
-                       static_cast<double>(i * i) / static_cast<double>(n);
-            chirp.emplace_back(std::cos(t), std::sin(t));
-            a[i] = f[i] * std::conj(chirp[i]);
-            b[i] = b[m - i] = chirp[i];
-        }
-
-        fft(a);
-        fft(b);
-        hadamard(a, b);
-        ifft(b);
-
-        for (std::size_t i = 0u; i < n; ++i) {
-            f[i] = std::conj(chirp[i]) * b[i];
-        }
+        realFftPlan(f.size())->transform(f, result, fftCache().s_Workspace);
     }
 }
 
@@ -182,7 +439,7 @@ void CSignal::autocorrelations(const TFloatMeanAccumulatorVec& values, TDoubleVe
     double mean = CBasicStatistics::mean(moments);
     double variance = CBasicStatistics::maximumLikelihoodVariance(moments);
 
-    TComplexVec f;
+    TDoubleVec f;
     f.reserve(n);
     for (std::size_t i = 0u; i < n; ++i) {
         std::size_t j = i;
@@ -191,32 +448,36 @@ void CSignal::autocorrelations(const TFloatMeanAccumulatorVec& values, TDoubleVe
         if (i != j) {
             // Infer missing values by linearly interpolating.
             if (j == n) {
-                f.resize(n, TComplex(0.0, 0.0));
+                f.resize(n, 0.0);
                 break;
             } else if (i == 0) {
-                f.resize(j - 1, TComplex(0.0, 0.0));
+                f.resize(j - 1, 0.0);
             } else {
                 for (std::size_t k = i; k < j; ++k) {
                     double alpha = static_cast<double>(k - i + 1) /
                                    static_cast<double>(j - i + 1);
                     double real = CBasicStatistics::mean(values[j]) - mean;
-                    f.push_back((1.0 - alpha) * f[i - 1] + alpha * TComplex(real, 0.0));
+                    f.push_back((1.0 - alpha) * f[i - 1] + alpha * real);
                 }
             }
             i = j;
         }
-        f.emplace_back(CBasicStatistics::mean(values[i]) - mean, 0.0);
+        f.push_back(CBasicStatistics::mean(values[i]) - mean);
     }
 
-    fft(f);
-    TComplexVec fConj(f);
-    conj(fConj);
-    hadamard(fConj, f);
-    ifft(f);
+    // The inverse DFT of the power spectrum is the cyclic autocorrelation
+    // and, since the power spectrum is real and symmetric, we can compute
+    // it with a forward DFT of real values.
+    TComplexVec F;
+    fft(f, F);
+    for (std::size_t i = 0u; i < f.size(); ++i) {
+        f[i] = std::norm(F[i]) / static_cast<double>(f.size());
+    }
+    fft(f, F);
 
     result.reserve(n);
     for (std::size_t i = 1u; i < n; ++i) {
-        result.push_back(f[i].real() / variance / static_cast<double>(n));
+        result.push_back(F[i].real() / variance / static_cast<double>(n));
     }
 }
 }
@@ -12,6 +12,7 @@
 #include <core/CPersistUtils.h>
 #include <core/CStatePersistInserter.h>
 #include <core/CStateRestoreTraverser.h>
+#include <core/CStringUtils.h>
 #include <core/CTimezone.h>
 #include <core/Constants.h>
 #include <core/RestoreMacros.h>
@@ -33,6 +34,7 @@
 #include <maths/CStatisticalTests.h>
 #include <maths/CTimeSeriesDecomposition.h>
 #include <maths/CTimeSeriesSegmentation.h>
+#include <maths/CTimeSeriesTestScheduler.h>
 #include <maths/CTools.h>
 #include <maths/Constants.h>
 
@@ -279,6 +281,10 @@ const std::string VERSION_6_4_TAG("6.4");
 const std::string PERIODICITY_TEST_MACHINE_6_3_TAG{"a"};
 const std::string SHORT_WINDOW_6_3_TAG{"b"};
 const std::string LONG_WINDOW_6_3_TAG{"c"};
+const std::string DEFERRED_SHORT_WINDOW_6_3_TAG{"d"};
+const std::string DEFERRED_LONG_WINDOW_6_3_TAG{"e"};
+const std::string DEFERRED_SHORT_TIME_6_3_TAG{"f"};
+const std::string DEFERRED_LONG_TIME_6_3_TAG{"g"};
 // Old versions can't be restored.
 
 // Calendar Cyclic Test Tags
@@ -286,6 +292,8 @@ const std::string LONG_WINDOW_6_3_TAG{"c"};
 const std::string CALENDAR_TEST_MACHINE_6_3_TAG{"a"};
 const std::string LAST_MONTH_6_3_TAG{"b"};
 const std::string CALENDAR_TEST_6_3_TAG{"c"};
+const std::string DEFERRED_TIME_6_3_TAG{"d"};
+const std::string DEFERRED_CALENDAR_TEST_6_3_TAG{"e"};
 // These work for all versions.
 
 // Components Tags
@@ -480,18 +488,22 @@ CTimeSeriesDecompositionDetail::CPeriodicityTest::CPeriodicityTest(double decayR
           PT_STATES,
           PT_TRANSITION_FUNCTION,
           bucketLength > LONGEST_BUCKET_LENGTH ? PT_NOT_TESTING : PT_INITIAL)},
-      m_DecayRate{decayRate}, m_BucketLength{bucketLength} {
+      m_DecayRate{decayRate}, m_BucketLength{bucketLength}, m_DeferredTimes{{0, 0}} {
 }
 
 CTimeSeriesDecompositionDetail::CPeriodicityTest::CPeriodicityTest(const CPeriodicityTest& other,
                                                                    bool isForForecast)
     : CHandler(), m_Machine{other.m_Machine}, m_DecayRate{other.m_DecayRate},
-      m_BucketLength{other.m_BucketLength} {
+      m_BucketLength{other.m_BucketLength}, m_DeferredTimes(other.m_DeferredTimes) {
     // Note that m_Windows is an array.
     for (std::size_t i = 0u; !isForForecast && i < other.m_Windows.size(); ++i) {
         if (other.m_Windows[i] != nullptr) {
             m_Windows[i] = boost::make_unique<CExpandingWindow>(*other.m_Windows[i]);
         }
+        if (other.m_DeferredWindows[i] != nullptr) {
+            m_DeferredWindows[i] =
+                boost::make_unique<CExpandingWindow>(*other.m_DeferredWindows[i]);
+        }
     }
 }
 
@@ -515,6 +527,22 @@ bool CTimeSeriesDecompositionDetail::CPeriodicityTest::acceptRestoreTraverser(
                 traverser.traverseSubLevel(boost::bind(&CExpandingWindow::acceptRestoreTraverser,
                                                        m_Windows[E_Long].get(), _1)),
             /**/)
+        RESTORE_SETUP_TEARDOWN(
+            DEFERRED_SHORT_WINDOW_6_3_TAG,
+            m_DeferredWindows[E_Short].reset(this->newWindow(E_Short)),
+            m_DeferredWindows[E_Short] &&
+                traverser.traverseSubLevel(boost::bind(&CExpandingWindow::acceptRestoreTraverser,
+                                                       m_DeferredWindows[E_Short].get(), _1)),
+            /**/)
+        RESTORE_SETUP_TEARDOWN(
+            DEFERRED_LONG_WINDOW_6_3_TAG,
+            m_DeferredWindows[E_Long].reset(this->newWindow(E_Long)),
+            m_DeferredWindows[E_Long] &&
+                traverser.traverseSubLevel(boost::bind(&CExpandingWindow::acceptRestoreTraverser,
+                                                       m_DeferredWindows[E_Long].get(), _1)),
+            /**/)
+        RESTORE_BUILT_IN(DEFERRED_SHORT_TIME_6_3_TAG, m_DeferredTimes[E_Short])
+        RESTORE_BUILT_IN(DEFERRED_LONG_TIME_6_3_TAG, m_DeferredTimes[E_Long])
     } while (traverser.next());
     return true;
 }
@@ -534,6 +562,18 @@ void CTimeSeriesDecompositionDetail::CPeriodicityTest::acceptPersistInserter(
                              boost::bind(&CExpandingWindow::acceptPersistInserter,
                                          m_Windows[E_Long].get(), _1));
     }
+    if (m_DeferredWindows[E_Short] != nullptr) {
+        inserter.insertLevel(DEFERRED_SHORT_WINDOW_6_3_TAG,
+                             boost::bind(&CExpandingWindow::acceptPersistInserter,
+                                         m_DeferredWindows[E_Short].get(), _1));
+        inserter.insertValue(DEFERRED_SHORT_TIME_6_3_TAG, m_DeferredTimes[E_Short]);
+    }
+    if (m_DeferredWindows[E_Long] != nullptr) {
+        inserter.insertLevel(DEFERRED_LONG_WINDOW_6_3_TAG,
+                             boost::bind(&CExpandingWindow::acceptPersistInserter,
+                                         m_DeferredWindows[E_Long].get(), _1));
+        inserter.insertValue(DEFERRED_LONG_TIME_6_3_TAG, m_DeferredTimes[E_Long]);
+    }
 }
 
 void CTimeSeriesDecompositionDetail::CPeriodicityTest::swap(CPeriodicityTest& other) {
@@ -542,6 +582,9 @@ void CTimeSeriesDecompositionDetail::CPeriodicityTest::swap(CPeriodicityTest& ot
     std::swap(m_BucketLength, other.m_BucketLength);
     m_Windows[E_Short].swap(other.m_Windows[E_Short]);
     m_Windows[E_Long].swap(other.m_Windows[E_Long]);
+    m_DeferredWindows[E_Short].swap(other.m_DeferredWindows[E_Short]);
+    m_DeferredWindows[E_Long].swap(other.m_DeferredWindows[E_Long]);
+    std::swap(m_DeferredTimes, other.m_DeferredTimes);
 }
 
 void CTimeSeriesDecompositionDetail::CPeriodicityTest::handle(const SAddValue& message) {
@@ -601,26 +644,26 @@ bool CTimeSeriesDecompositionDetail::CPeriodicityTest::shouldTest(ETest test,
 
 void CTimeSeriesDecompositionDetail::CPeriodicityTest::test(const SAddValue& message) {
     core_t::TTime time{message.s_Time};
-    core_t::TTime lastTime{message.s_LastTime};
-    const TPredictor& predictor{message.s_Predictor};
-    const CPeriodicityHypothesisTestsConfig& config{message.s_PeriodicityTestConfig};
+
+    CTimeSeriesTestScheduler& scheduler{CTimeSeriesTestScheduler::instance()};
 
     switch (m_Machine.state()) {
     case PT_TEST:
         for (auto i : {E_Short, E_Long}) {
-            if (this->shouldTest(i, time)) {
-                const auto& window = m_Windows[i];
-                TFloatMeanAccumulatorVec values(window->valuesMinusPrediction(predictor));
-                core_t::TTime start{CIntegerTools::floor(window->startTime(), m_BucketLength)};
-                core_t::TTime bucketLength{window->bucketLength()};
-                CPeriodicityHypothesisTestsResult result{
-                    testForPeriods(config, start, bucketLength, values)};
-                result.remove([i](const CPeriodicityHypothesisTestsResult::SComponent& component) {
-                    return i == E_Long && component.s_Period <= WEEK;
-                });
-                if (result.periodic()) {
-                    this->mediator()->forward(SDetectedSeasonal{
-                        time, lastTime, result, *window, predictor});
+            bool shouldTest{this->shouldTest(i, time)};
+            // A deferred test is run before the next one falls due.
+            if (m_DeferredWindows[i] != nullptr && (shouldTest || time >= m_DeferredTimes[i])) {
+                TExpandingWindowPtr window{std::move(m_DeferredWindows[i])};
+                m_DeferredTimes[i] = 0;
+                this->test(i, *window, message);
+            }
+            if (shouldTest && m_Windows[i] != nullptr) {
+                std::size_t delay{scheduler.delay(m_Windows[i]->size())};
+                if (delay == 0) {
+                    this->test(i, *m_Windows[i], message);
+                } else {
+                    m_DeferredWindows[i] = boost::make_unique<CExpandingWindow>(*m_Windows[i]);
+                    m_DeferredTimes[i] = time + static_cast<core_t::TTime>(delay) * m_BucketLength;
                 }
             }
         }
@@ -641,12 +684,20 @@ void CTimeSeriesDecompositionDetail::CPeriodicityTest::shiftTime(core_t::TTime d
             window->shiftTime(dt);
         }
     }
+    for (auto i : {E_Short, E_Long}) {
+        if (m_DeferredWindows[i] != nullptr) {
+            m_DeferredWindows[i]->shiftTime(dt);
+            m_DeferredTimes[i] += dt;
+        }
+    }
 }
 
 void CTimeSeriesDecompositionDetail::CPeriodicityTest::propagateForwards(core_t::TTime start,
                                                                          core_t::TTime end) {
     stepwisePropagateForwards(DAY, start, end, m_Windows[E_Short]);
     stepwisePropagateForwards(WEEK, start, end, m_Windows[E_Long]);
+    stepwisePropagateForwards(DAY, start, end, m_DeferredWindows[E_Short]);
+    stepwisePropagateForwards(WEEK, start, end, m_DeferredWindows[E_Long]);
 }
 
 CTimeSeriesDecompositionDetail::CPeriodicityTest::TTimeFloatMeanAccumulatorPrVec
@@ -671,17 +722,21 @@ uint64_t CTimeSeriesDecompositionDetail::CPeriodicityTest::checksum(uint64_t see
     seed = CChecksum::calculate(seed, m_Machine);
     seed = CChecksum::calculate(seed, m_DecayRate);
     seed = CChecksum::calculate(seed, m_BucketLength);
-    return CChecksum::calculate(seed, m_Windows);
+    seed = CChecksum::calculate(seed, m_Windows);
+    seed = CChecksum::calculate(seed, m_DeferredWindows);
+    return CChecksum::calculate(seed, m_DeferredTimes);
 }
 
 void CTimeSeriesDecompositionDetail::CPeriodicityTest::debugMemoryUsage(
     core::CMemoryUsage::TMemoryUsagePtr mem) const {
     mem->setName("CPeriodicityTest");
     core::CMemoryDebug::dynamicSize("m_Windows", m_Windows, mem);
+    core::CMemoryDebug::dynamicSize("m_DeferredWindows", m_DeferredWindows, mem);
 }
 
 std::size_t CTimeSeriesDecompositionDetail::CPeriodicityTest::memoryUsage() const {
-    std::size_t usage{core::CMemory::dynamicSize(m_Windows)};
+    std::size_t usage{core::CMemory::dynamicSize(m_Windows) +
+                      core::CMemory::dynamicSize(m_DeferredWindows)};
     if (m_Machine.state() == PT_INITIAL) {
         usage += this->extraMemoryOnInitialization();
     }
@@ -689,16 +744,19 @@ std::size_t CTimeSeriesDecompositionDetail::CPeriodicityTest::memoryUsage() cons
 }
 
 std::size_t CTimeSeriesDecompositionDetail::CPeriodicityTest::extraMemoryOnInitialization() const {
-    static std::size_t result{0};
-    if (result == 0) {
+    // This is initialized once in a thread safe way because models can
+    // be sampled concurrently.
+    static const std::size_t result{[this] {
+        std::size_t size{0};
         for (auto i : {E_Short, E_Long}) {
             TExpandingWindowPtr window(this->newWindow(i, false));
             // The 0.3 is a rule-of-thumb estimate of the worst case
             // compression ratio we achieve on the test state.
-            result += static_cast<std::size_t>(
+            size += static_cast<std::size_t>(
                 0.3 * static_cast<double>(core::CMemory::dynamicSize(window)));
         }
-    }
+        return size;
+    }()};
     return result;
 }
 
@@ -732,6 +790,9 @@ void CTimeSeriesDecompositionDetail::CPeriodicityTest::apply(std::size_t symbol,
                     window->initialize(time_);
                 }
             }
+            m_DeferredWindows[0].reset();
+            m_DeferredWindows[1].reset();
+            m_DeferredTimes.fill(0);
         };
 
         switch (state) {
@@ -749,6 +810,9 @@ void CTimeSeriesDecompositionDetail::CPeriodicityTest::apply(std::size_t symbol,
         case PT_NOT_TESTING:
             m_Windows[0].reset();
             m_Windows[1].reset();
+            m_DeferredWindows[0].reset();
+            m_DeferredWindows[1].reset();
+            m_DeferredTimes.fill(0);
             break;
         default:
             LOG_ERROR(<< "Test in a bad state: " << state);
@@ -758,8 +822,30 @@ void CTimeSeriesDecompositionDetail::CPeriodicityTest::apply(std::size_t symbol,
     }
 }
 
+void CTimeSeriesDecompositionDetail::CPeriodicityTest::test(ETest test,
+                                                            const CExpandingWindow& window,
+                                                            const SAddValue& message) {
+    core_t::TTime time{message.s_Time};
+    core_t::TTime lastTime{message.s_LastTime};
+    const TPredictor& predictor{message.s_Predictor};
+    const CPeriodicityHypothesisTestsConfig& config{message.s_PeriodicityTestConfig};
+
+    CTimeSeriesTestScheduler::CScopeTimeTest timer;
+
+    TFloatMeanAccumulatorVec values(window.valuesMinusPrediction(predictor));
+    core_t::TTime start{CIntegerTools::floor(window.startTime(), m_BucketLength)};
+    core_t::TTime bucketLength{window.bucketLength()};
+    CPeriodicityHypothesisTestsResult result{testForPeriods(config, start, bucketLength, values)};
+    result.remove([test](const CPeriodicityHypothesisTestsResult::SComponent& component) {
+        return test == E_Long && component.s_Period <= WEEK;
+    });
+    if (result.periodic()) {
+        this->mediator()->forward(SDetectedSeasonal{time, lastTime, result, window, predictor});
+    }
+}
+
 CExpandingWindow*
-CTimeSeriesDecompositionDetail::CPeriodicityTest::newWindow(ETest test, bool deflate) const {
+CTimeSeriesDecompositionDetail::CPeriodicityTest::newWindow(ETest test, bool compress) const {
 
     using TTimeCRng = CExpandingWindow::TTimeCRng;
 
@@ -795,7 +881,8 @@ CTimeSeriesDecompositionDetail::CPeriodicityTest::newWindow(ETest test, bool def
             return new CExpandingWindow(
                 m_BucketLength,
                 TTimeCRng(buckets, a - buckets.begin(), b - buckets.begin()),
-                size, m_DecayRate, deflate);
+                size, m_DecayRate,
+                compress ? CExpandingWindow::E_BytePack : CExpandingWindow::E_NoCompression);
         }
         return static_cast<CExpandingWindow*>(nullptr);
     };
@@ -819,16 +906,20 @@ CTimeSeriesDecompositionDetail::CCalendarTest::CCalendarTest(double decayRate,
                                             CC_STATES,
                                             CC_TRANSITION_FUNCTION,
                                             bucketLength > DAY ? CC_NOT_TESTING : CC_INITIAL)},
-      m_DecayRate{decayRate}, m_LastMonth{} {
+      m_DecayRate{decayRate}, m_BucketLength{bucketLength}, m_LastMonth{}, m_DeferredTime{0} {
 }
 
 CTimeSeriesDecompositionDetail::CCalendarTest::CCalendarTest(const CCalendarTest& other,
                                                              bool isForForecast)
     : CHandler(), m_Machine{other.m_Machine}, m_DecayRate{other.m_DecayRate},
-      m_LastMonth{other.m_LastMonth}, m_Test{!isForForecast && other.m_Test
-                                                 ? boost::make_unique<CCalendarCyclicTest>(
-                                                       *other.m_Test)
-                                                 : nullptr} {
+      m_BucketLength{other.m_BucketLength}, m_LastMonth{other.m_LastMonth},
+      m_DeferredTime{other.m_DeferredTime}, m_Test{!isForForecast && other.m_Test
+                                                       ? boost::make_unique<CCalendarCyclicTest>(
+                                                             *other.m_Test)
+                                                       : nullptr} {
+    if (!isForForecast && other.m_DeferredTest != nullptr) {
+        m_DeferredTest = boost::make_unique<CCalendarCyclicTest>(*other.m_DeferredTest);
+    }
 }
 
 bool CTimeSeriesDecompositionDetail::CCalendarTest::acceptRestoreTraverser(core::CStateRestoreTraverser& traverser) {
@@ -839,12 +930,19 @@ bool CTimeSeriesDecompositionDetail::CCalendarTest::acceptRestoreTraverser(core:
                     return m_Machine.acceptRestoreTraverser(traverser_);
                 }))
         RESTORE_BUILT_IN(LAST_MONTH_6_3_TAG, m_LastMonth);
+        RESTORE_BUILT_IN(DEFERRED_TIME_6_3_TAG, m_DeferredTime)
         RESTORE_SETUP_TEARDOWN(
             CALENDAR_TEST_6_3_TAG,
             m_Test = boost::make_unique<CCalendarCyclicTest>(m_DecayRate),
             traverser.traverseSubLevel(boost::bind(
                 &CCalendarCyclicTest::acceptRestoreTraverser, m_Test.get(), _1)),
             /**/)
+        RESTORE_SETUP_TEARDOWN(
+            DEFERRED_CALENDAR_TEST_6_3_TAG,
+            m_DeferredTest = boost::make_unique<CCalendarCyclicTest>(m_DecayRate),
+            traverser.traverseSubLevel(boost::bind(&CCalendarCyclicTest::acceptRestoreTraverser,
+                                                   m_DeferredTest.get(), _1)),
+            /**/)
     } while (traverser.next());
     return true;
 }
@@ -860,13 +958,22 @@ void CTimeSeriesDecompositionDetail::CCalendarTest::acceptPersistInserter(
                              boost::bind(&CCalendarCyclicTest::acceptPersistInserter,
                                          m_Test.get(), _1));
     }
+    if (m_DeferredTest) {
+        inserter.insertLevel(DEFERRED_CALENDAR_TEST_6_3_TAG,
+                             boost::bind(&CCalendarCyclicTest::acceptPersistInserter,
+                                         m_DeferredTest.get(), _1));
+        inserter.insertValue(DEFERRED_TIME_6_3_TAG, m_DeferredTime);
+    }
 }
 
 void CTimeSeriesDecompositionDetail::CCalendarTest::swap(CCalendarTest& other) {
     std::swap(m_Machine, other.m_Machine);
     std::swap(m_DecayRate, other.m_DecayRate);
+    std::swap(m_BucketLength, other.m_BucketLength);
     std::swap(m_LastMonth, other.m_LastMonth);
+    std::swap(m_DeferredTime, other.m_DeferredTime);
     m_Test.swap(other.m_Test);
+    m_DeferredTest.swap(other.m_DeferredTest);
 }
 
 void CTimeSeriesDecompositionDetail::CCalendarTest::handle(const SAddValue& message) {
@@ -909,18 +1016,34 @@ void CTimeSeriesDecompositionDetail::CCalendarTest::handle(const SNewComponents&
 
 void CTimeSeriesDecompositionDetail::CCalendarTest::test(const SMessage& message) {
     core_t::TTime time{message.s_Time};
-    core_t::TTime lastTime{message.s_LastTime};
 
-    if (this->shouldTest(time)) {
+    CTimeSeriesTestScheduler& scheduler{CTimeSeriesTestScheduler::instance()};
+
+    bool shouldTest{this->shouldTest(time)};
+    if (shouldTest || m_DeferredTest != nullptr) {
         switch (m_Machine.state()) {
         case CC_TEST: {
-            if (CCalendarCyclicTest::TOptionalFeature feature = m_Test->test()) {
-                this->mediator()->forward(SDetectedCalendar(time, lastTime, *feature));
+            // A deferred test is run before the next one falls due.
+            if (m_DeferredTest != nullptr && (shouldTest || time >= m_DeferredTime)) {
+                TCalendarCyclicTestPtr test{std::move(m_DeferredTest)};
+                m_DeferredTime = 0;
+                this->test(*test, message);
+            }
+            if (shouldTest && m_Test != nullptr) {
+                std::size_t delay{scheduler.delay(m_Test->size())};
+                if (delay == 0) {
+                    this->test(*m_Test, message);
+                } else {
+                    m_DeferredTest = boost::make_unique<CCalendarCyclicTest>(*m_Test);
+                    m_DeferredTime = time + static_cast<core_t::TTime>(delay) * m_BucketLength;
+                }
             }
             break;
         }
         case CC_NOT_TESTING:
         case CC_INITIAL:
+            m_DeferredTest.reset();
+            m_DeferredTime = 0;
             break;
         default:
             LOG_ERROR(<< "Test in a bad state: " << m_Machine.state());
@@ -930,15 +1053,29 @@ void CTimeSeriesDecompositionDetail::CCalendarTest::test(const SMessage& message
     }
 }
 
+void CTimeSeriesDecompositionDetail::CCalendarTest::test(const CCalendarCyclicTest& test,
+                                                         const SMessage& message) {
+    core_t::TTime time{message.s_Time};
+    core_t::TTime lastTime{message.s_LastTime};
+
+    CTimeSeriesTestScheduler::CScopeTimeTest timer;
+    if (CCalendarCyclicTest::TOptionalFeature feature = test.test()) {
+        this->mediator()->forward(SDetectedCalendar(time, lastTime, *feature));
+    }
+}
+
 void CTimeSeriesDecompositionDetail::CCalendarTest::propagateForwards(core_t::TTime start,
                                                                       core_t::TTime end) {
     stepwisePropagateForwards(DAY, start, end, m_Test);
+    stepwisePropagateForwards(DAY, start, end, m_DeferredTest);
 }
 
 uint64_t CTimeSeriesDecompositionDetail::CCalendarTest::checksum(uint64_t seed) const {
     seed = CChecksum::calculate(seed, m_Machine);
     seed = CChecksum::calculate(seed, m_DecayRate);
     seed = CChecksum::calculate(seed, m_LastMonth);
+    seed = CChecksum::calculate(seed, m_DeferredTime);
+    seed = CChecksum::calculate(seed, m_DeferredTest);
     return CChecksum::calculate(seed, m_Test);
 }
 
@@ -946,10 +1083,12 @@ void CTimeSeriesDecompositionDetail::CCalendarTest::debugMemoryUsage(
     core::CMemoryUsage::TMemoryUsagePtr mem) const {
     mem->setName("CCalendarTest");
     core::CMemoryDebug::dynamicSize("m_Test", m_Test, mem);
+    core::CMemoryDebug::dynamicSize("m_DeferredTest", m_DeferredTest, mem);
 }
 
 std::size_t CTimeSeriesDecompositionDetail::CCalendarTest::memoryUsage() const {
-    std::size_t usage{core::CMemory::dynamicSize(m_Test)};
+    std::size_t usage{core::CMemory::dynamicSize(m_Test) +
+                      core::CMemory::dynamicSize(m_DeferredTest)};
     if (m_Machine.state() == CC_INITIAL) {
         usage += this->extraMemoryOnInitialization();
     }
@@ -957,11 +1096,11 @@ std::size_t CTimeSeriesDecompositionDetail::CCalendarTest::memoryUsage() const {
 }
 
 std::size_t CTimeSeriesDecompositionDetail::CCalendarTest::extraMemoryOnInitialization() const {
-    static std::size_t result{0};
-    if (result == 0) {
+    // See CPeriodicityTest::extraMemoryOnInitialization.
+    static const std::size_t result{[this] {
         TCalendarCyclicTestPtr test = boost::make_unique<CCalendarCyclicTest>(m_DecayRate);
-        result = core::CMemory::dynamicSize(test);
-    }
+        return core::CMemory::dynamicSize(test);
+    }()};
     return result;
 }
 
@@ -987,6 +1126,8 @@ void CTimeSeriesDecompositionDetail::CCalendarTest::apply(std::size_t symbol,
         case CC_NOT_TESTING:
         case CC_INITIAL:
             m_Test.reset();
+            m_DeferredTest.reset();
+            m_DeferredTime = 0;
             m_LastMonth = int{};
             break;
         default:
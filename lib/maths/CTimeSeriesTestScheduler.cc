@@ -0,0 +1,128 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#include <maths/CTimeSeriesTestScheduler.h>
+
+#include <core/CScopedFastLock.h>
+
+#include <limits>
+
+namespace {
+// To ensure the singleton is constructed before multiple threads may require it
+// call instance() during the static initialisation phase of the program.  Of
+// course, the instance may already be constructed before this if another static
+// object has used it.
+const ml::maths::CTimeSeriesTestScheduler& DO_NOT_USE_THIS_VARIABLE =
+    ml::maths::CTimeSeriesTestScheduler::instance();
+
+const std::uint64_t NANOSECONDS_PER_MILLISECOND{1000000};
+}
+
+namespace ml {
+namespace maths {
+
+CTimeSeriesTestScheduler::CTimeSeriesTestScheduler()
+    : m_MaximumDelay{0}, m_BucketBudget{std::numeric_limits<std::size_t>::max()},
+      m_Bucket{0}, m_ScheduledCosts(1, 0), m_BucketTestTime{0},
+      m_LastBucketTestTime{0}, m_DeferredTests{0}, m_LastBucketDeferredTests{0} {
+}
+
+CTimeSeriesTestScheduler& CTimeSeriesTestScheduler::instance() {
+    static CTimeSeriesTestScheduler instance;
+    return instance;
+}
+
+void CTimeSeriesTestScheduler::maximumDelay(std::size_t delay) {
+    core::CScopedFastLock lock(m_Mutex);
+    m_MaximumDelay = delay;
+    m_ScheduledCosts.assign(delay + 1, 0);
+}
+
+void CTimeSeriesTestScheduler::bucketBudget(std::size_t budget) {
+    core::CScopedFastLock lock(m_Mutex);
+    m_BucketBudget = budget;
+}
+
+void CTimeSeriesTestScheduler::startBucket() {
+    core::CScopedFastLock lock(m_Mutex);
+    // The slot of the bucket which has just finished is reused for the
+    // last bucket to which tests can now be deferred.
+    m_ScheduledCosts[m_Bucket % m_ScheduledCosts.size()] = 0;
+    ++m_Bucket;
+    m_LastBucketTestTime = m_BucketTestTime;
+    m_BucketTestTime = 0;
+    m_LastBucketDeferredTests = m_DeferredTests;
+    m_DeferredTests = 0;
+}
+
+std::size_t CTimeSeriesTestScheduler::delay(std::size_t cost) {
+    core::CScopedFastLock lock(m_Mutex);
+
+    if (m_MaximumDelay == 0) {
+        return 0;
+    }
+
+    std::size_t n{m_ScheduledCosts.size()};
+    std::size_t result{0};
+    for (/**/; result < n; ++result) {
+        if (m_ScheduledCosts[(m_Bucket + result) % n] + cost <= m_BucketBudget) {
+            break;
+        }
+    }
+    if (result == n) {
+        result = 0;
+        for (std::size_t i = 1u; i < n; ++i) {
+            if (m_ScheduledCosts[(m_Bucket + i) % n] <
+                m_ScheduledCosts[(m_Bucket + result) % n]) {
+                result = i;
+            }
+        }
+    }
+
+    m_ScheduledCosts[(m_Bucket + result) % n] += cost;
+    if (result > 0) {
+        ++m_DeferredTests;
+    }
+    return result;
+}
+
+std::size_t CTimeSeriesTestScheduler::numberDeferredTests() const {
+    core::CScopedFastLock lock(m_Mutex);
+    return m_LastBucketDeferredTests;
+}
+
+std::uint64_t CTimeSeriesTestScheduler::lastBucketTestTime() const {
+    core::CScopedFastLock lock(m_Mutex);
+    return m_LastBucketTestTime / NANOSECONDS_PER_MILLISECOND;
+}
+
+void CTimeSeriesTestScheduler::reset() {
+    core::CScopedFastLock lock(m_Mutex);
+    m_MaximumDelay = 0;
+    m_BucketBudget = std::numeric_limits<std::size_t>::max();
+    m_Bucket = 0;
+    m_ScheduledCosts.assign(1, 0);
+    m_BucketTestTime = 0;
+    m_LastBucketTestTime = 0;
+    m_DeferredTests = 0;
+    m_LastBucketDeferredTests = 0;
+}
+
+void CTimeSeriesTestScheduler::addTestTime(std::uint64_t time) {
+    core::CScopedFastLock lock(m_Mutex);
+    m_BucketTestTime += time;
+}
+
+CTimeSeriesTestScheduler::CScopeTimeTest::CScopeTimeTest()
+    : m_Start{CTimeSeriesTestScheduler::instance().m_Clock.nanoseconds()} {
+}
+
+CTimeSeriesTestScheduler::CScopeTimeTest::~CScopeTimeTest() {
+    CTimeSeriesTestScheduler& scheduler{CTimeSeriesTestScheduler::instance()};
+    scheduler.addTestTime(scheduler.m_Clock.nanoseconds() - m_Start);
+}
+}
+}
@@ -22,6 +22,7 @@
 #include <maths/CToolsDetail.h>
 #include <maths/Constants.h>
 
+#include <boost/math/constants/constants.hpp>
 #include <boost/math/distributions/beta.hpp>
 #include <boost/math/distributions/binomial.hpp>
 #include <boost/math/distributions/chi_squared.hpp>
@@ -1700,6 +1701,128 @@ double CTools::safeCdfComplement(const chi_squared& chi2, double x) {
     return continuousSafeCdfComplement(allowOverflow(chi2), x);
 }
 
+//////// Batch Standard Normal Implementation ////////
+
+namespace {
+
+//! The number of points which are processed together.
+const std::size_t STANDARD_NORMAL_BLOCK_SIZE = 32;
+
+//! Below this number of points the latency of the Chebyshev recurrence isn't
+//! hidden and it is faster to evaluate each point with boost::math.
+const std::size_t MINIMUM_STANDARD_NORMAL_BATCH_SIZE = 4;
+
+//! Chebyshev coefficients of log(erfcx(t) / y) as a function of u = 2y - 1,
+//! where y = 2 / (2 + t) and erfcx(t) = exp(t^2) * erfc(t). This maps
+//! t in [0, inf) to u in (-1, 1] and the function is smooth everywhere in
+//! this range. The coefficients were computed in extended precision and
+//! the error in the fit is less than 5e-16. The constant term is rounded
+//! so that the fit is exactly zero at t = 0 in double precision.
+const std::size_t NUMBER_ERFCX_COEFFICIENTS = 28;
+const double ERFCX_COEFFICIENTS[] = {
+    -0.6513268598908546,     0.64196979235649021,     0.019476473204185836,
+    -0.0095615147868086323,  -0.00094659534448203713, 0.00036683949785276166,
+    4.2523324806907688e-05,  -2.027857811253436e-05,  -1.624290004646838e-06,
+    1.3036558355803818e-06,  1.5626441722093889e-08,  -8.52380959148488e-08,
+    6.529054439016332e-09,   5.0593434956186372e-09,  -9.9136415647121411e-10,
+    -2.2736512229977178e-10, 9.6467911040900689e-11,  2.3940380775212431e-12,
+    -6.8860275169155326e-12, 8.9448795541872831e-13,  3.1309204937045396e-13,
+    -1.1270810004490963e-13, 3.8095391506056883e-16,  7.1061714760451648e-15,
+    -1.5230232609201189e-15, -9.4637297130828468e-17, 1.2097875124101633e-16,
+    -2.8147751870207655e-17};
+
+//! -log of the smallest positive double, beyond which the c.d.f. underflows.
+const double MINUS_LOG_DENORM_MIN = -std::log(std::numeric_limits<double>::denorm_min());
+
+//! Compute y = 2 / (2 + t) and log(Phi(-|z|)) - log(y / 2), where t = |z| / sqrt(2),
+//! for the \p n <= STANDARD_NORMAL_BLOCK_SIZE values \p z.
+//!
+//! Each loop is over the points in the block, has no branches and no calls,
+//! so the compiler can vectorise it.
+void standardNormalLogTail(const double* z, std::size_t n, double* y, double* logTail) {
+    double u[STANDARD_NORMAL_BLOCK_SIZE];
+    double b0[STANDARD_NORMAL_BLOCK_SIZE];
+    double b1[STANDARD_NORMAL_BLOCK_SIZE];
+
+    for (std::size_t i = 0u; i < n; ++i) {
+        double t = std::fabs(z[i]) / boost::math::double_constants::root_two;
+        y[i] = 2.0 / (2.0 + t);
+        u[i] = 2.0 * y[i] - 1.0;
+        b0[i] = 0.0;
+        b1[i] = 0.0;
+        logTail[i] = ERFCX_COEFFICIENTS[0] - t * t;
+    }
+
+    // Clenshaw's recurrence.
+    for (std::size_t k = NUMBER_ERFCX_COEFFICIENTS - 1; k > 0; --k) {
+        double c = ERFCX_COEFFICIENTS[k];
+        for (std::size_t i = 0u; i < n; ++i) {
+            double b = 2.0 * u[i] * b0[i] - b1[i] + c;
+            b1[i] = b0[i];
+            b0[i] = b;
+        }
+    }
+
+    for (std::size_t i = 0u; i < n; ++i) {
+        logTail[i] += u[i] * b0[i] - b1[i];
+    }
+}
+}
+
+void CTools::minusLogStandardNormalCdf(const double* z, std::size_t n, double* result) {
+    if (n < MINIMUM_STANDARD_NORMAL_BATCH_SIZE) {
+        normal standard;
+        for (std::size_t i = 0u; i < n; ++i) {
+            result[i] = SMinusLogCdf()(standard, z[i]);
+        }
+        return;
+    }
+
+    double y[STANDARD_NORMAL_BLOCK_SIZE];
+    double logTail[STANDARD_NORMAL_BLOCK_SIZE];
+    bool lower[STANDARD_NORMAL_BLOCK_SIZE];
+
+    for (std::size_t start = 0u; start < n; start += STANDARD_NORMAL_BLOCK_SIZE) {
+        std::size_t m = std::min(n - start, STANDARD_NORMAL_BLOCK_SIZE);
+        for (std::size_t i = 0u; i < m; ++i) {
+            lower[i] = z[start + i] < 0.0;
+        }
+        standardNormalLogTail(z + start, m, y, logTail);
+
+        for (std::size_t i = 0u; i < m; ++i) {
+            // For z < 0, Phi(z) is the tail and otherwise it's one minus the tail.
+            double value = lower[i] ? -(std::log(0.5 * y[i]) + logTail[i])
+                                    : -std::log1p(-0.5 * y[i] * std::exp(logTail[i]));
+            // Match safeMinusLogCdf when the c.d.f. underflows.
+            result[start + i] = value > MINUS_LOG_DENORM_MIN
+                                    ? -core::constants::LOG_MIN_DOUBLE
+                                    : std::max(value, 0.0);
+        }
+    }
+}
+
+void CTools::standardNormalTwoTailProbability(const double* z, std::size_t n, double* result) {
+    if (n < MINIMUM_STANDARD_NORMAL_BATCH_SIZE) {
+        normal standard;
+        for (std::size_t i = 0u; i < n; ++i) {
+            result[i] = std::min(2.0 * safeCdf(standard, -std::fabs(z[i])), 1.0);
+        }
+        return;
+    }
+
+    double y[STANDARD_NORMAL_BLOCK_SIZE];
+    double logTail[STANDARD_NORMAL_BLOCK_SIZE];
+
+    for (std::size_t start = 0u; start < n; start += STANDARD_NORMAL_BLOCK_SIZE) {
+        std::size_t m = std::min(n - start, STANDARD_NORMAL_BLOCK_SIZE);
+        standardNormalLogTail(z + start, m, y, logTail);
+        for (std::size_t i = 0u; i < m; ++i) {
+            // The approximation can exceed one by a rounding error near zero.
+            result[start + i] = std::min(y[i] * std::exp(logTail[i]), 1.0);
+        }
+    }
+}
+
 //////// deviation Implementation ////////
 
 namespace {
@@ -10,6 +10,7 @@
 #include <core/CLogger.h>
 #include <core/CRapidXmlStatePersistInserter.h>
 #include <core/CRapidXmlStateRestoreTraverser.h>
+#include <core/CStopWatch.h>
 #include <core/Constants.h>
 
 #include <maths/CBasicStatistics.h>
@@ -31,7 +32,12 @@ using TFloatMeanAccumulator =
     maths::CBasicStatistics::SSampleMean<maths::CFloatStorage>::TAccumulator;
 using TFloatMeanAccumulatorVec = std::vector<TFloatMeanAccumulator>;
 
+using TCompression = maths::CExpandingWindow::ECompression;
+
 TTimeVec BUCKET_LENGTHS{300, 600, 1800, 3600};
+const TCompression COMPRESSIONS[]{maths::CExpandingWindow::E_NoCompression,
+                                  maths::CExpandingWindow::E_Deflate,
+                                  maths::CExpandingWindow::E_BytePack};
 }
 
 void CExpandingWindowTest::testBasicUsage() {
@@ -50,43 +56,47 @@ void CExpandingWindowTest::testBasicUsage() {
     rng.generateUniformSamples(0.0, 10.0, size, values);
 
     for (auto startTime : {0, 100000}) {
-        LOG_DEBUG(<< "Testing start time " << startTime);
-
-        maths::CExpandingWindow compressed{
-            bucketLength, TTimeCRng{BUCKET_LENGTHS, 0, 4}, size, decayRate, true};
-        maths::CExpandingWindow uncompressed{
-            bucketLength, TTimeCRng{BUCKET_LENGTHS, 0, 4}, size, decayRate, false};
-        TFloatMeanAccumulatorVec expected300(size);
-        TFloatMeanAccumulatorVec expected1800(size);
-
-        compressed.initialize(startTime);
-        uncompressed.initialize(startTime);
-
-        for (core_t::TTime time = startTime;
-             time < static_cast<core_t::TTime>(size) * bucketLength; time += bucketLength) {
-            double value{values[(time - startTime) / bucketLength]};
-            compressed.add(time, value);
-            uncompressed.add(time, value);
-            expected300[(time - startTime) / 300].add(value);
-            expected1800[(time - startTime) / 1800].add(value);
-            if (((time - startTime) / bucketLength) % 3 == 0) {
-                CPPUNIT_ASSERT_EQUAL(uncompressed.checksum(), compressed.checksum());
+        for (auto compression : {maths::CExpandingWindow::E_Deflate,
+                                 maths::CExpandingWindow::E_BytePack}) {
+            LOG_DEBUG(<< "Testing start time " << startTime << ", compression " << compression);
+
+            maths::CExpandingWindow compressed{
+                bucketLength, TTimeCRng{BUCKET_LENGTHS, 0, 4}, size, decayRate, compression};
+            maths::CExpandingWindow uncompressed{bucketLength, TTimeCRng{BUCKET_LENGTHS, 0, 4},
+                                                 size, decayRate,
+                                                 maths::CExpandingWindow::E_NoCompression};
+            TFloatMeanAccumulatorVec expected300(size);
+            TFloatMeanAccumulatorVec expected1800(size);
+
+            compressed.initialize(startTime);
+            uncompressed.initialize(startTime);
+
+            for (core_t::TTime time = startTime;
+                 time < static_cast<core_t::TTime>(size) * bucketLength; time += bucketLength) {
+                double value{values[(time - startTime) / bucketLength]};
+                compressed.add(time, value);
+                uncompressed.add(time, value);
+                expected300[(time - startTime) / 300].add(value);
+                expected1800[(time - startTime) / 1800].add(value);
+                if (((time - startTime) / bucketLength) % 3 == 0) {
+                    CPPUNIT_ASSERT_EQUAL(uncompressed.checksum(), compressed.checksum());
+                }
             }
+            CPPUNIT_ASSERT_EQUAL(core::CContainerPrinter::print(expected300),
+                                 core::CContainerPrinter::print(uncompressed.values()));
+            CPPUNIT_ASSERT_EQUAL(core::CContainerPrinter::print(expected300),
+                                 core::CContainerPrinter::print(compressed.values()));
+
+            core_t::TTime time{startTime + static_cast<core_t::TTime>(600 * size + 1)};
+            compressed.add(time, 5.0, 0.9);
+            uncompressed.add(time, 5.0, 0.9);
+            expected1800[(time - startTime) / 1800].add(5.0, 0.9);
+
+            CPPUNIT_ASSERT_EQUAL(core::CContainerPrinter::print(expected1800),
+                                 core::CContainerPrinter::print(uncompressed.values()));
+            CPPUNIT_ASSERT_EQUAL(core::CContainerPrinter::print(expected1800),
+                                 core::CContainerPrinter::print(compressed.values()));
         }
-        CPPUNIT_ASSERT_EQUAL(core::CContainerPrinter::print(expected300),
-                             core::CContainerPrinter::print(uncompressed.values()));
-        CPPUNIT_ASSERT_EQUAL(core::CContainerPrinter::print(expected300),
-                             core::CContainerPrinter::print(compressed.values()));
-
-        core_t::TTime time{startTime + static_cast<core_t::TTime>(600 * size + 1)};
-        compressed.add(time, 5.0, 0.9);
-        uncompressed.add(time, 5.0, 0.9);
-        expected1800[(time - startTime) / 1800].add(5.0, 0.9);
-
-        CPPUNIT_ASSERT_EQUAL(core::CContainerPrinter::print(expected1800),
-                             core::CContainerPrinter::print(uncompressed.values()));
-        CPPUNIT_ASSERT_EQUAL(core::CContainerPrinter::print(expected1800),
-                             core::CContainerPrinter::print(compressed.values()));
     }
 
     LOG_DEBUG(<< "Testing multiple rounds of compression");
@@ -97,7 +107,7 @@ void CExpandingWindowTest::testBasicUsage() {
     std::sort(times.begin(), times.end());
 
     maths::CExpandingWindow window{bucketLength, TTimeCRng{BUCKET_LENGTHS, 0, 4},
-                                   size, decayRate, true};
+                                   size, decayRate};
     TFloatMeanAccumulatorVec expected300(size);
     TFloatMeanAccumulatorVec expected600(size);
     TFloatMeanAccumulatorVec expected1800(size);
@@ -176,7 +186,7 @@ void CExpandingWindowTest::testValuesMinusPrediction() {
     rng.generateUniformSamples(0.0, 2.0, size, noise);
 
     maths::CExpandingWindow window{bucketLength, TTimeCRng{BUCKET_LENGTHS, 0, 4},
-                                   size, decayRate, true};
+                                   size, decayRate};
 
     TFloatMeanAccumulatorVec expected(size);
     for (core_t::TTime time = 0; time < static_cast<core_t::TTime>(size) * bucketLength;
@@ -203,9 +213,9 @@ void CExpandingWindowTest::testPersistence() {
 
     test::CRandomNumbers rng;
 
-    for (auto compressed : {true, false}) {
+    for (auto compression : COMPRESSIONS) {
         maths::CExpandingWindow origWindow{
-            bucketLength, TTimeCRng{BUCKET_LENGTHS, 0, 4}, size, decayRate, compressed};
+            bucketLength, TTimeCRng{BUCKET_LENGTHS, 0, 4}, size, decayRate, compression};
 
         TDoubleVec values;
         rng.generateUniformSamples(0.0, 10.0, size, values);
@@ -230,7 +240,7 @@ void CExpandingWindowTest::testPersistence() {
             CPPUNIT_ASSERT(parser.parseStringIgnoreCdata(origXml));
             core::CRapidXmlStateRestoreTraverser traverser(parser);
             maths::CExpandingWindow restoredWindow{
-                bucketLength, TTimeCRng{BUCKET_LENGTHS, 0, 4}, size, decayRate, compressed};
+                bucketLength, TTimeCRng{BUCKET_LENGTHS, 0, 4}, size, decayRate, compression};
             CPPUNIT_ASSERT_EQUAL(true, traverser.traverseSubLevel(boost::bind(
                                            &maths::CExpandingWindow::acceptRestoreTraverser,
                                            &restoredWindow, _1)));
@@ -242,6 +252,141 @@ void CExpandingWindowTest::testPersistence() {
     }
 }
 
+void CExpandingWindowTest::testCompression() {
+    // Compare the memory used and the time taken to add values and extract
+    // them for the different ways of storing the bucket values.
+
+    core_t::TTime bucketLength{300};
+    std::size_t size{336};
+    double decayRate{0.001};
+    std::size_t numberWindows{200};
+
+    test::CRandomNumbers rng;
+
+    auto periodic = [](core_t::TTime time, double noise) {
+        return 100.0 + 20.0 * std::sin(boost::math::double_constants::two_pi *
+                                       static_cast<double>(time) /
+                                       static_cast<double>(core::constants::DAY)) +
+               noise;
+    };
+    auto counts = [](core_t::TTime time, double noise) {
+        return std::floor(10.0 + 5.0 * std::sin(boost::math::double_constants::two_pi *
+                                                 static_cast<double>(time) /
+                                                 static_cast<double>(core::constants::DAY)) +
+                          noise);
+    };
+
+    for (std::size_t test = 0u; test < 3; ++test) {
+        TDoubleVec noise;
+        rng.generateNormalSamples(0.0, 4.0, numberWindows * size, noise);
+        TDoubleVec uniform;
+        rng.generateUniformSamples(0.0, 1.0, numberWindows * size, uniform);
+
+        TFloatMeanAccumulatorVec expected;
+        std::size_t memory[3];
+        std::uint64_t time[3];
+
+        for (std::size_t i = 0u; i < 3; ++i) {
+            core::CStopWatch watch{true};
+
+            std::size_t memory_{0};
+            for (std::size_t j = 0u, k = 0u; j < numberWindows; ++j) {
+                maths::CExpandingWindow window{bucketLength, TTimeCRng{BUCKET_LENGTHS, 0, 4},
+                                               size, decayRate, COMPRESSIONS[i]};
+                window.initialize(0);
+                for (core_t::TTime t = 0; t < static_cast<core_t::TTime>(size) * bucketLength;
+                     t += bucketLength, ++k) {
+                    switch (test) {
+                    case 0:
+                        window.add(t, periodic(t, noise[k]));
+                        break;
+                    case 1:
+                        window.add(t, counts(t, noise[k]));
+                        break;
+                    case 2:
+                        if (uniform[k] < 0.1) {
+                            window.add(t, periodic(t, noise[k]));
+                        }
+                        break;
+                    }
+                    window.propagateForwardsByTime(1.0);
+                }
+                memory_ += window.memoryUsage();
+
+                TFloatMeanAccumulatorVec values;
+                for (std::size_t l = 0u; l < 10; ++l) {
+                    values = window.valuesMinusPrediction(
+                        [](core_t::TTime) { return 0.0; });
+                }
+                if (j == 0 && i == 1) {
+                    expected = values;
+                } else if (j == 0 && i > 1) {
+                    // The compressed formats age the values identically.
+                    CPPUNIT_ASSERT_EQUAL(expected.size(), values.size());
+                    for (std::size_t l = 0u; l < values.size(); ++l) {
+                        CPPUNIT_ASSERT_DOUBLES_EQUAL(
+                            maths::CBasicStatistics::count(expected[l]),
+                            maths::CBasicStatistics::count(values[l]), 1e-5);
+                        CPPUNIT_ASSERT_EQUAL(maths::CBasicStatistics::mean(expected[l]),
+                                             maths::CBasicStatistics::mean(values[l]));
+                    }
+                }
+            }
+
+            memory[i] = memory_ / numberWindows;
+            time[i] = watch.stop();
+        }
+
+        LOG_DEBUG(<< "test " << test << ": memory per window uncompressed = " << memory[0]
+                  << ", deflated = " << memory[1] << ", packed = " << memory[2]);
+        LOG_DEBUG(<< "test " << test << ": time uncompressed = " << time[0]
+                  << "ms, deflated = " << time[1] << "ms, packed = " << time[2] << "ms");
+
+        CPPUNIT_ASSERT(memory[2] <= memory[1]);
+        CPPUNIT_ASSERT(memory[2] < memory[0]);
+    }
+}
+
+void CExpandingWindowTest::testAging() {
+    // Check that every storage format ages the bucket values.
+
+    core_t::TTime bucketLength{300};
+    std::size_t size{48};
+    double decayRate{0.01};
+
+    test::CRandomNumbers rng;
+    TDoubleVec values;
+    rng.generateUniformSamples(0.0, 10.0, size, values);
+
+    for (auto compression : COMPRESSIONS) {
+        LOG_DEBUG(<< "Testing compression " << compression);
+
+        maths::CExpandingWindow window{bucketLength, TTimeCRng{BUCKET_LENGTHS, 0, 4},
+                                       size, decayRate, compression};
+        window.initialize(0);
+
+        TFloatMeanAccumulatorVec expected(size);
+        for (std::size_t i = 0u; i < size; ++i) {
+            window.add(static_cast<core_t::TTime>(i) * bucketLength, values[i]);
+            window.propagateForwardsByTime(1.0);
+            expected[i].add(values[i]);
+            for (auto& value : expected) {
+                value.age(std::exp(-decayRate));
+            }
+        }
+
+        TFloatMeanAccumulatorVec actual{window.values()};
+        CPPUNIT_ASSERT_EQUAL(expected.size(), actual.size());
+        for (std::size_t i = 0u; i < size; ++i) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(maths::CBasicStatistics::count(expected[i]),
+                                         maths::CBasicStatistics::count(actual[i]), 1e-5);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(maths::CBasicStatistics::mean(expected[i]),
+                                         maths::CBasicStatistics::mean(actual[i]), 1e-5);
+        }
+        CPPUNIT_ASSERT(maths::CBasicStatistics::count(actual[0]) < 0.7);
+    }
+}
+
 CppUnit::Test* CExpandingWindowTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CExpandingWindowTest");
 
@@ -252,6 +397,10 @@ CppUnit::Test* CExpandingWindowTest::suite() {
         &CExpandingWindowTest::testValuesMinusPrediction));
     suiteOfTests->addTest(new CppUnit::TestCaller<CExpandingWindowTest>(
         "CExpandingWindowTest::testPersistence", &CExpandingWindowTest::testPersistence));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CExpandingWindowTest>(
+        "CExpandingWindowTest::testCompression", &CExpandingWindowTest::testCompression));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CExpandingWindowTest>(
+        "CExpandingWindowTest::testAging", &CExpandingWindowTest::testAging));
 
     return suiteOfTests;
 }
@@ -14,6 +14,8 @@ public:
     void testBasicUsage();
     void testValuesMinusPrediction();
     void testPersistence();
+    void testCompression();
+    void testAging();
 
     static CppUnit::Test* suite();
 };
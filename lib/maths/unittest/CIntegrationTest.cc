@@ -740,6 +740,61 @@ void CIntegrationTest::testAllSingleVariate() {
     }
 }
 
+void CIntegrationTest::testBatch() {
+    // Test that the batch quadratures match evaluating the abscissas
+    // one at a time.
+
+    double coeffs[] = {1.3, -0.2, 0.6, 0.1, 0.02, 0.1};
+    CPolynomialFunction<5u> f(coeffs);
+    auto batchF = [&f](const double* x, std::size_t n, double* fx) {
+        for (std::size_t i = 0u; i < n; ++i) {
+            f(x[i], fx[i]);
+        }
+        return true;
+    };
+    auto logF = [&f](double x, double& fx) {
+        f(x, fx);
+        fx = std::log(fx);
+        return true;
+    };
+    auto batchLogF = [&logF](const double* x, std::size_t n, double* fx) {
+        for (std::size_t i = 0u; i < n; ++i) {
+            logF(x[i], fx[i]);
+        }
+        return true;
+    };
+
+    double ranges[][2] = {{-1.0, 1.0}, {0.0, 2.0}, {1.0, 0.5}};
+
+    for (const auto& range : ranges) {
+        double expected;
+        double actual;
+        CPPUNIT_ASSERT(CIntegration::gaussLegendre<CIntegration::OrderThree>(
+            f, range[0], range[1], expected));
+        CPPUNIT_ASSERT(CIntegration::batchGaussLegendre<CIntegration::OrderThree>(
+            batchF, range[0], range[1], actual));
+        LOG_DEBUG(<< "expected = " << expected << ", actual = " << actual);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, actual, 1e-12 * std::fabs(expected));
+
+        CPPUNIT_ASSERT(CIntegration::batchGaussLegendre<CIntegration::OrderSix>(
+            batchF, range[0], range[1], actual));
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(integrate(f, range[0], range[1]), actual, 1e-12);
+
+        CPPUNIT_ASSERT(CIntegration::logGaussLegendre<CIntegration::OrderThree>(
+            logF, range[0], range[1], expected));
+        CPPUNIT_ASSERT(CIntegration::batchLogGaussLegendre<CIntegration::OrderThree>(
+            batchLogF, range[0], range[1], actual));
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, actual, 1e-12 * std::fabs(expected));
+    }
+
+    double result;
+    auto fail = [](const double*, std::size_t, double*) { return false; };
+    CPPUNIT_ASSERT(!CIntegration::batchGaussLegendre<CIntegration::OrderThree>(
+        fail, 0.0, 1.0, result));
+    CPPUNIT_ASSERT(!CIntegration::batchLogGaussLegendre<CIntegration::OrderThree>(
+        fail, 0.0, 1.0, result));
+}
+
 void CIntegrationTest::testAdaptive() {
     using TDoubleDoublePr = std::pair<double, double>;
     using TDoubleDoublePrVec = std::vector<TDoubleDoublePr>;
@@ -1253,6 +1308,8 @@ CppUnit::Test* CIntegrationTest::suite() {
 
     suiteOfTests->addTest(new CppUnit::TestCaller<CIntegrationTest>(
         "CIntegrationTest::testAllSingleVariate", &CIntegrationTest::testAllSingleVariate));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CIntegrationTest>(
+        "CIntegrationTest::testBatch", &CIntegrationTest::testBatch));
     suiteOfTests->addTest(new CppUnit::TestCaller<CIntegrationTest>(
         "CIntegrationTest::testAdaptive", &CIntegrationTest::testAdaptive));
     suiteOfTests->addTest(new CppUnit::TestCaller<CIntegrationTest>(
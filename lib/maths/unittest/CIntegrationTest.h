@@ -12,6 +12,7 @@
 class CIntegrationTest : public CppUnit::TestFixture {
 public:
     void testAllSingleVariate();
+    void testBatch();
     void testAdaptive();
     void testSparseGrid();
     void testMultivariateSmooth();
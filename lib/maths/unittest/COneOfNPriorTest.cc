@@ -44,6 +44,7 @@ using namespace handy_typedefs;
 namespace {
 
 using TUIntVec = std::vector<unsigned int>;
+using TSizeVec = std::vector<std::size_t>;
 using TDoubleVec = std::vector<double>;
 using TDoubleDoublePr = std::pair<double, double>;
 using TDoubleDoublePrVec = std::vector<TDoubleDoublePr>;
@@ -144,6 +145,10 @@ void COneOfNPriorTest::testMultipleUpdate() {
     COneOfNPrior filter1(maths::COneOfNPrior(clone(models), E_ContinuousData));
     COneOfNPrior filter2(maths::COneOfNPrior(clone(models), E_ContinuousData));
 
+    // Frozen models are updated in a batch so we test eager updates.
+    filter1.lazyUpdates(false);
+    filter2.lazyUpdates(false);
+
     test::CRandomNumbers rng;
 
     // Deal with improper prior pathology.
@@ -1241,6 +1246,161 @@ void COneOfNPriorTest::testPersist() {
     CPPUNIT_ASSERT_EQUAL(origXml, newXml);
 }
 
+void COneOfNPriorTest::testLazyUpdates() {
+    // Test that freezing models with very low weight gives nearly the same
+    // results as updating all the models with every sample.
+
+    test::CRandomNumbers rng;
+
+    TPriorPtrVec models;
+    models.push_back(TPriorPtr(
+        CGammaRateConjugate::nonInformativePrior(E_ContinuousData, 0.0, 0.001).clone()));
+    models.push_back(TPriorPtr(
+        CLogNormalMeanPrecConjugate::nonInformativePrior(E_ContinuousData, 0.0, 0.001)
+            .clone()));
+    models.push_back(TPriorPtr(
+        CNormalMeanPrecConjugate::nonInformativePrior(E_ContinuousData, 0.001).clone()));
+
+    TDoubleVec gammaSamples;
+    rng.generateGammaSamples(5.0, 2.0, 3000, gammaSamples);
+    TDoubleVec logNormalSamples;
+    rng.generateLogNormalSamples(2.0, 0.5, 3000, logNormalSamples);
+
+    for (const auto& samples : {gammaSamples, logNormalSamples}) {
+        maths::COneOfNPrior lazy(clone(models), E_ContinuousData, 0.001);
+        maths::COneOfNPrior eager(clone(models), E_ContinuousData, 0.001);
+        lazy.lazyUpdates(true);
+        eager.lazyUpdates(false);
+
+        double frozen = 0.0;
+        TMeanAccumulator error;
+        for (std::size_t i = 0u; i < samples.size(); ++i) {
+            lazy.addSamples({samples[i]}, maths_t::CUnitWeights::SINGLE_UNIT);
+            lazy.propagateForwardsByTime(1.0);
+            eager.addSamples({samples[i]}, maths_t::CUnitWeights::SINGLE_UNIT);
+            eager.propagateForwardsByTime(1.0);
+            frozen += static_cast<double>(lazy.numberFrozenModels());
+            CPPUNIT_ASSERT_EQUAL(std::size_t(0), eager.numberFrozenModels());
+
+            if (i % 10 == 0) {
+                TDoubleVec lazyWeights = lazy.weights();
+                TDoubleVec eagerWeights = eager.weights();
+                for (std::size_t j = 0u; j < lazyWeights.size(); ++j) {
+                    CPPUNIT_ASSERT_DOUBLES_EQUAL(eagerWeights[j], lazyWeights[j], 1e-6);
+                }
+
+                double x = samples[i];
+                for (double scale : {0.5, 1.0, 2.0, 4.0}) {
+                    TDouble1Vec sample{scale * x};
+                    double lazyLowerBound, lazyUpperBound;
+                    double eagerLowerBound, eagerUpperBound;
+                    maths_t::ETail tail;
+                    lazy.probabilityOfLessLikelySamples(
+                        maths_t::E_TwoSided, sample, maths_t::CUnitWeights::SINGLE_UNIT,
+                        lazyLowerBound, lazyUpperBound, tail);
+                    eager.probabilityOfLessLikelySamples(
+                        maths_t::E_TwoSided, sample, maths_t::CUnitWeights::SINGLE_UNIT,
+                        eagerLowerBound, eagerUpperBound, tail);
+                    CPPUNIT_ASSERT_DOUBLES_EQUAL(eagerLowerBound, lazyLowerBound,
+                                                 1e-3 * eagerLowerBound);
+                    error.add(std::fabs(lazyLowerBound - eagerLowerBound) / eagerLowerBound);
+                }
+            }
+        }
+        LOG_DEBUG(<< "mean frozen = " << frozen / static_cast<double>(samples.size()));
+        LOG_DEBUG(<< "mean relative error = " << maths::CBasicStatistics::mean(error));
+        CPPUNIT_ASSERT(frozen > 0.5 * static_cast<double>(samples.size()));
+        CPPUNIT_ASSERT(maths::CBasicStatistics::mean(error) < 1e-5);
+
+        // Check that persist/restore preserves frozen models.
+        CPPUNIT_ASSERT(lazy.numberFrozenModels() > 0);
+
+        std::string origXml;
+        {
+            core::CRapidXmlStatePersistInserter inserter("root");
+            lazy.acceptPersistInserter(inserter);
+            inserter.toXml(origXml);
+        }
+
+        core::CRapidXmlParser parser;
+        CPPUNIT_ASSERT(parser.parseStringIgnoreCdata(origXml));
+        core::CRapidXmlStateRestoreTraverser traverser(parser);
+        maths::SDistributionRestoreParams params(
+            E_ContinuousData, 0.001, maths::MINIMUM_CLUSTER_SPLIT_FRACTION,
+            maths::MINIMUM_CLUSTER_SPLIT_COUNT, maths::MINIMUM_CATEGORY_COUNT);
+        maths::COneOfNPrior restored(params, traverser);
+
+        CPPUNIT_ASSERT_EQUAL(lazy.numberFrozenModels(), restored.numberFrozenModels());
+        CPPUNIT_ASSERT_EQUAL(lazy.checksum(), restored.checksum());
+
+        for (std::size_t i = 0u; i < 100; ++i) {
+            lazy.addSamples({samples[i]}, maths_t::CUnitWeights::SINGLE_UNIT);
+            restored.addSamples({samples[i]}, maths_t::CUnitWeights::SINGLE_UNIT);
+        }
+        TDoubleVec lazyWeights = lazy.weights();
+        TDoubleVec restoredWeights = restored.weights();
+        for (std::size_t j = 0u; j < lazyWeights.size(); ++j) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(lazyWeights[j], restoredWeights[j], 1e-6);
+        }
+
+        // Check that disabling lazy updates thaws all models and frees
+        // their queues.
+        lazy.lazyUpdates(false);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), lazy.numberFrozenModels());
+        CPPUNIT_ASSERT_EQUAL(eager.memoryUsage(), lazy.memoryUsage());
+    }
+}
+
+void COneOfNPriorTest::testLazyUpdatesPendingSamples() {
+    // Test that the samples queued for frozen models are bounded when they
+    // are only ever added, in batches of various sizes, and that the weights
+    // still match updating all the models with every batch.
+
+    test::CRandomNumbers rng;
+
+    TPriorPtrVec models;
+    models.push_back(TPriorPtr(
+        CGammaRateConjugate::nonInformativePrior(E_ContinuousData, 0.0, 0.001).clone()));
+    models.push_back(TPriorPtr(
+        CLogNormalMeanPrecConjugate::nonInformativePrior(E_ContinuousData, 0.0, 0.001)
+            .clone()));
+    models.push_back(TPriorPtr(
+        CNormalMeanPrecConjugate::nonInformativePrior(E_ContinuousData, 0.001).clone()));
+
+    TDoubleVec samples;
+    rng.generateGammaSamples(5.0, 2.0, 3000, samples);
+    TSizeVec batchSizes;
+    rng.generateUniformSamples(1, 2 * maths::COneOfNPrior::MAXIMUM_PENDING_SAMPLES,
+                               samples.size(), batchSizes);
+
+    maths::COneOfNPrior lazy(clone(models), E_ContinuousData, 0.001);
+    maths::COneOfNPrior eager(clone(models), E_ContinuousData, 0.001);
+    lazy.lazyUpdates(true);
+    eager.lazyUpdates(false);
+
+    std::size_t frozen{0};
+    for (std::size_t i = 0u, j = 0u; i < samples.size(); i += batchSizes[j++]) {
+        TDouble1Vec batch(samples.begin() + i,
+                          samples.begin() + std::min(i + batchSizes[j], samples.size()));
+        maths_t::TDoubleWeightsAry1Vec weights(batch.size(),
+                                               maths_t::CUnitWeights::UNIT);
+        lazy.addSamples(batch, weights);
+        eager.addSamples(batch, weights);
+
+        frozen += lazy.numberFrozenModels();
+        CPPUNIT_ASSERT(lazy.maximumNumberPendingSamples() <=
+                       maths::COneOfNPrior::MAXIMUM_PENDING_SAMPLES);
+
+        TDoubleVec lazyWeights = lazy.weights();
+        TDoubleVec eagerWeights = eager.weights();
+        for (std::size_t k = 0u; k < lazyWeights.size(); ++k) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(eagerWeights[k], lazyWeights[k], 1e-6);
+        }
+    }
+    LOG_DEBUG(<< "frozen = " << frozen);
+    CPPUNIT_ASSERT(frozen > 0);
+}
+
 CppUnit::Test* COneOfNPriorTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("COneOfNPriorTest");
 
@@ -1275,6 +1435,11 @@ CppUnit::Test* COneOfNPriorTest::suite() {
         &COneOfNPriorTest::testProbabilityOfLessLikelySamples));
     suiteOfTests->addTest(new CppUnit::TestCaller<COneOfNPriorTest>(
         "COneOfNPriorTest::testPersist", &COneOfNPriorTest::testPersist));
+    suiteOfTests->addTest(new CppUnit::TestCaller<COneOfNPriorTest>(
+        "COneOfNPriorTest::testLazyUpdates", &COneOfNPriorTest::testLazyUpdates));
+    suiteOfTests->addTest(new CppUnit::TestCaller<COneOfNPriorTest>(
+        "COneOfNPriorTest::testLazyUpdatesPendingSamples",
+        &COneOfNPriorTest::testLazyUpdatesPendingSamples));
 
     return suiteOfTests;
 }
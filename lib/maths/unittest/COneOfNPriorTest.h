@@ -24,6 +24,8 @@ public:
     void testCdf();
     void testProbabilityOfLessLikelySamples();
     void testPersist();
+    void testLazyUpdates();
+    void testLazyUpdatesPendingSamples();
 
     static CppUnit::Test* suite();
 };
@@ -8,14 +8,22 @@
 
 #include <core/CContainerPrinter.h>
 #include <core/CLogger.h>
+#include <core/CRapidXmlParser.h>
+#include <core/CRapidXmlStatePersistInserter.h>
+#include <core/CRapidXmlStateRestoreTraverser.h>
+#include <core/CStopWatch.h>
 
 #include <maths/CBasicStatistics.h>
 #include <maths/CSampling.h>
 
 #include <boost/range.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <memory>
 #include <numeric>
+#include <thread>
 
 using TDoubleVec = std::vector<double>;
 using TSizeVec = std::vector<std::size_t>;
@@ -213,6 +221,197 @@ void CSamplingTest::testMultivariateNormalSample() {
     }
 }
 
+void CSamplingTest::testRandomNumberStreams() {
+    auto draw = [](std::size_t n) {
+        TDoubleVec result;
+        maths::CSampling::uniformSample(0.0, 1.0, n, result);
+        return result;
+    };
+
+    maths::CSampling::seed();
+
+    // Test that a stream is repeatable and doesn't depend on the draws
+    // made from the shared generator.
+    TDoubleVec expected;
+    {
+        maths::CSampling::CScopeRandomNumberStream stream{1};
+        CPPUNIT_ASSERT(maths::CSampling::CScopeRandomNumberStream::generator() != nullptr);
+        expected = draw(10);
+    }
+    CPPUNIT_ASSERT(maths::CSampling::CScopeRandomNumberStream::generator() == nullptr);
+    draw(10);
+    {
+        maths::CSampling::CScopeRandomNumberStream stream{1};
+        CPPUNIT_ASSERT_EQUAL(core::CContainerPrinter::print(expected),
+                             core::CContainerPrinter::print(draw(10)));
+    }
+
+    // Test that distinct streams differ.
+    {
+        maths::CSampling::CScopeRandomNumberStream stream{2};
+        CPPUNIT_ASSERT(expected != draw(10));
+    }
+
+    // Test that stream zero is distinguished from no stream.
+    CPPUNIT_ASSERT(!maths::CSampling::CScopeRandomNumberStream::current());
+    {
+        maths::CSampling::CScopeRandomNumberStream stream{0};
+        CPPUNIT_ASSERT(maths::CSampling::CScopeRandomNumberStream::current());
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(0),
+                             *maths::CSampling::CScopeRandomNumberStream::current());
+    }
+
+    // Test that streams nest.
+    CPPUNIT_ASSERT(!maths::CSampling::CScopeRandomNumberStream::current());
+    {
+        maths::CSampling::CScopeRandomNumberStream outer{1};
+        TDoubleVec first{draw(5)};
+        {
+            maths::CSampling::CScopeRandomNumberStream inner{2};
+            CPPUNIT_ASSERT_EQUAL(std::uint64_t(2),
+                                 *maths::CSampling::CScopeRandomNumberStream::current());
+            draw(5);
+        }
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(1),
+                             *maths::CSampling::CScopeRandomNumberStream::current());
+        TDoubleVec second{draw(5)};
+        first.insert(first.end(), second.begin(), second.end());
+        CPPUNIT_ASSERT_EQUAL(core::CContainerPrinter::print(expected),
+                             core::CContainerPrinter::print(first));
+    }
+
+    // Test that draws are the same whichever thread makes them.
+    {
+        std::vector<TDoubleVec> results(8);
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            threads.emplace_back([i, &draw, &results] {
+                maths::CSampling::CScopeRandomNumberStream stream{i % 2 + 1};
+                results[i] = draw(1000);
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (std::size_t i = 2; i < results.size(); ++i) {
+            CPPUNIT_ASSERT(results[i] == results[i % 2]);
+        }
+        CPPUNIT_ASSERT(std::equal(expected.begin(), expected.end(), results[0].begin()));
+    }
+
+    // Test that a stream uses the mock if it's active.
+    {
+        maths::CSampling::CScopeMockRandomNumberGenerator mock;
+        maths::CSampling::CScopeRandomNumberStream stream{1};
+        CPPUNIT_ASSERT(maths::CSampling::CScopeRandomNumberStream::generator() == nullptr);
+        TDoubleVec mocked{draw(10)};
+        CPPUNIT_ASSERT(std::all_of(mocked.begin(), mocked.end(),
+                                   [&mocked](double x) { return x == mocked[0]; }));
+    }
+
+    // Test that reseeding restores the default streams.
+    maths::CSampling::seed();
+    {
+        maths::CSampling::CScopeRandomNumberStream stream{1};
+        CPPUNIT_ASSERT_EQUAL(core::CContainerPrinter::print(expected),
+                             core::CContainerPrinter::print(draw(10)));
+    }
+}
+
+void CSamplingTest::testPersist() {
+    maths::CSampling::seed();
+    maths::CSampling::uniformSample(0.0, 1.0);
+
+    std::string origXml;
+    {
+        core::CRapidXmlStatePersistInserter inserter("root");
+        maths::CSampling::staticsAcceptPersistInserter(inserter);
+        inserter.toXml(origXml);
+    }
+    LOG_DEBUG(<< "XML representation:\n" << origXml);
+
+    TDoubleVec expected;
+    maths::CSampling::uniformSample(0.0, 1.0, 10, expected);
+    TDoubleVec expectedStream;
+    {
+        maths::CSampling::CScopeRandomNumberStream stream{1};
+        maths::CSampling::uniformSample(0.0, 1.0, 10, expectedStream);
+    }
+
+    maths::CSampling::seed();
+    {
+        core::CRapidXmlParser parser;
+        CPPUNIT_ASSERT(parser.parseStringIgnoreCdata(origXml));
+        core::CRapidXmlStateRestoreTraverser traverser(parser);
+        CPPUNIT_ASSERT(traverser.traverseSubLevel(
+            &maths::CSampling::staticsAcceptRestoreTraverser));
+    }
+
+    std::string newXml;
+    {
+        core::CRapidXmlStatePersistInserter inserter("root");
+        maths::CSampling::staticsAcceptPersistInserter(inserter);
+        inserter.toXml(newXml);
+    }
+    CPPUNIT_ASSERT_EQUAL(origXml, newXml);
+
+    TDoubleVec actual;
+    maths::CSampling::uniformSample(0.0, 1.0, 10, actual);
+    CPPUNIT_ASSERT_EQUAL(core::CContainerPrinter::print(expected),
+                         core::CContainerPrinter::print(actual));
+    TDoubleVec actualStream;
+    {
+        maths::CSampling::CScopeRandomNumberStream stream{1};
+        maths::CSampling::uniformSample(0.0, 1.0, 10, actualStream);
+    }
+    CPPUNIT_ASSERT_EQUAL(core::CContainerPrinter::print(expectedStream),
+                         core::CContainerPrinter::print(actualStream));
+
+    maths::CSampling::seed();
+}
+
+void CSamplingTest::testStreamThroughput() {
+    // Compare the rate at which threads can draw from the shared generator
+    // with the rate at which they can draw from their own streams.
+
+    const std::size_t drawsPerThread{200000};
+
+    auto drawsPerSecond = [drawsPerThread](std::size_t numberThreads, bool useStreams) {
+        std::atomic<double> total{0.0};
+        core::CStopWatch watch{true};
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < numberThreads; ++i) {
+            threads.emplace_back([i, useStreams, drawsPerThread, &total] {
+                std::unique_ptr<maths::CSampling::CScopeRandomNumberStream> stream;
+                if (useStreams) {
+                    stream = std::make_unique<maths::CSampling::CScopeRandomNumberStream>(i);
+                }
+                double sum{0.0};
+                for (std::size_t j = 0; j < drawsPerThread; ++j) {
+                    sum += maths::CSampling::uniformSample(0.0, 1.0);
+                }
+                double expected{total.load()};
+                while (total.compare_exchange_weak(expected, expected + sum) == false) {
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        double elapsed{std::max(static_cast<double>(watch.stop()), 1.0) / 1000.0};
+        // Every draw should be in [0, 1).
+        CPPUNIT_ASSERT(total.load() < static_cast<double>(numberThreads * drawsPerThread));
+        return static_cast<double>(numberThreads * drawsPerThread) / elapsed;
+    };
+
+    for (std::size_t numberThreads : {1, 2, 4, 8, 16}) {
+        double locked{drawsPerSecond(numberThreads, false)};
+        double streams{drawsPerSecond(numberThreads, true)};
+        LOG_INFO(<< numberThreads << " threads: shared generator = " << locked
+                 << " draws/s, streams = " << streams << " draws/s");
+    }
+}
+
 CppUnit::Test* CSamplingTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CSamplingTest");
 
@@ -221,6 +420,12 @@ CppUnit::Test* CSamplingTest::suite() {
     suiteOfTests->addTest(new CppUnit::TestCaller<CSamplingTest>(
         "CSamplingTest::testMultivariateNormalSample",
         &CSamplingTest::testMultivariateNormalSample));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSamplingTest>(
+        "CSamplingTest::testRandomNumberStreams", &CSamplingTest::testRandomNumberStreams));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSamplingTest>(
+        "CSamplingTest::testPersist", &CSamplingTest::testPersist));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSamplingTest>(
+        "CSamplingTest::testStreamThroughput", &CSamplingTest::testStreamThroughput));
 
     return suiteOfTests;
 }
@@ -13,6 +13,9 @@ class CSamplingTest : public CppUnit::TestFixture {
 public:
     void testMultinomialSample();
     void testMultivariateNormalSample();
+    void testRandomNumberStreams();
+    void testPersist();
+    void testStreamThroughput();
 
     static CppUnit::Test* suite();
 };
@@ -7,6 +7,7 @@
 #include "CSignalTest.h"
 
 #include <core/CLogger.h>
+#include <core/CStopWatch.h>
 #include <core/CoreTypes.h>
 
 #include <maths/CSignal.h>
@@ -323,6 +324,75 @@ void CSignalTest::testFFTIFFTIdempotency() {
     }
 }
 
+void CSignalTest::testRealFFT() {
+    // Test the DFT of real values versus the complex DFT.
+
+    test::CRandomNumbers rng;
+
+    for (std::size_t length = 1u; length < 100; ++length) {
+        TDoubleVec values;
+        rng.generateUniformSamples(-100000.0, 100000.0, length, values);
+
+        maths::CSignal::TComplexVec expected(values.begin(), values.end());
+        maths::CSignal::fft(expected);
+
+        maths::CSignal::TComplexVec actual;
+        maths::CSignal::fft(values, actual);
+
+        CPPUNIT_ASSERT_EQUAL(expected.size(), actual.size());
+        double error = 0.0;
+        for (std::size_t k = 0u; k < actual.size(); ++k) {
+            error += std::abs(actual[k] - expected[k]);
+        }
+
+        if (length % 10 == 0 || error >= 1e-5) {
+            LOG_DEBUG(<< "length = " << length << ", error  = " << error);
+        }
+        CPPUNIT_ASSERT(error < 1e-5);
+    }
+}
+
+void CSignalTest::testFFTPerformance() {
+    // Time the transforms of the window lengths used by the periodicity
+    // tests, i.e. 336 buckets, and windows which are padded by a third
+    // to compute serial autocorrelations, and check they're accurate.
+
+    test::CRandomNumbers rng;
+
+    std::size_t lengths[]{168, 224, 336, 448, 672, 896};
+
+    for (auto length : lengths) {
+        TDoubleVec values;
+        rng.generateUniformSamples(-1000.0, 1000.0, length, values);
+
+        maths::CSignal::TComplexVec expected(values.begin(), values.end());
+        bruteForceDft(expected, +1.0);
+
+        maths::CSignal::TComplexVec actual;
+        maths::CSignal::fft(values, actual);
+        double error = 0.0;
+        for (std::size_t k = 0u; k < actual.size(); ++k) {
+            error += std::abs(actual[k] - expected[k]);
+        }
+        LOG_DEBUG(<< "length = " << length << ", error = " << error);
+        CPPUNIT_ASSERT(error < 1e-5);
+
+        core::CStopWatch watch{true};
+        for (std::size_t i = 0u; i < 1000; ++i) {
+            actual.assign(values.begin(), values.end());
+            maths::CSignal::fft(actual);
+        }
+        std::uint64_t complexTime{watch.stop()};
+        watch.reset(true);
+        for (std::size_t i = 0u; i < 1000; ++i) {
+            maths::CSignal::fft(values, actual);
+        }
+        std::uint64_t realTime{watch.stop()};
+        LOG_DEBUG(<< "1000 transforms: complex = " << complexTime
+                  << "ms, real = " << realTime << "ms");
+    }
+}
+
 void CSignalTest::testAutocorrelations() {
     test::CRandomNumbers rng;
 
@@ -368,6 +438,10 @@ CppUnit::Test* CSignalTest::suite() {
         "CSignalTest::testIFFTRandomized", &CSignalTest::testIFFTRandomized));
     suiteOfTests->addTest(new CppUnit::TestCaller<CSignalTest>(
         "CSignalTest::testFFTIFFTIdempotency", &CSignalTest::testFFTIFFTIdempotency));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSignalTest>(
+        "CSignalTest::testRealFFT", &CSignalTest::testRealFFT));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CSignalTest>(
+        "CSignalTest::testFFTPerformance", &CSignalTest::testFFTPerformance));
     suiteOfTests->addTest(new CppUnit::TestCaller<CSignalTest>(
         "CSignalTest::testAutocorrelations", &CSignalTest::testAutocorrelations));
 
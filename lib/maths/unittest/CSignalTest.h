@@ -16,6 +16,8 @@ public:
     void testFFTRandomized();
     void testIFFTRandomized();
     void testFFTIFFTIdempotency();
+    void testRealFFT();
+    void testFFTPerformance();
     void testAutocorrelations();
 
     static CppUnit::Test* suite();
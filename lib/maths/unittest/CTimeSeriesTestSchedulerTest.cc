@@ -0,0 +1,251 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#include "CTimeSeriesTestSchedulerTest.h"
+
+#include <core/CContainerPrinter.h>
+#include <core/CLogger.h>
+#include <core/CRapidXmlParser.h>
+#include <core/CRapidXmlStatePersistInserter.h>
+#include <core/CRapidXmlStateRestoreTraverser.h>
+#include <core/CSleep.h>
+#include <core/Constants.h>
+#include <core/CoreTypes.h>
+
+#include <maths/CRestoreParams.h>
+#include <maths/CTimeSeriesDecomposition.h>
+#include <maths/CTimeSeriesTestScheduler.h>
+
+#include <test/CRandomNumbers.h>
+
+#include <boost/math/constants/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace ml;
+
+namespace {
+using TDoubleVec = std::vector<double>;
+using TSizeVec = std::vector<std::size_t>;
+using TUInt64Vec = std::vector<std::uint64_t>;
+
+const core_t::TTime HOUR{core::constants::HOUR};
+const core_t::TTime DAY{core::constants::DAY};
+const core_t::TTime WEEK{core::constants::WEEK};
+
+double daily(core_t::TTime time) {
+    return 20.0 + 10.0 * std::sin(boost::math::double_constants::two_pi *
+                                  static_cast<double>(time) / static_cast<double>(DAY));
+}
+}
+
+void CTimeSeriesTestSchedulerTest::tearDown() {
+    maths::CTimeSeriesTestScheduler::instance().reset();
+}
+
+void CTimeSeriesTestSchedulerTest::testDelay() {
+    // Test that tests are only deferred if there is a maximum delay and a
+    // bucket's budget is exhausted, that tests which are overdue take their
+    // share of a bucket's budget first and that the deferred tests are
+    // counted per bucket.
+
+    maths::CTimeSeriesTestScheduler& scheduler{maths::CTimeSeriesTestScheduler::instance()};
+    scheduler.reset();
+
+    for (std::size_t i = 0u; i < 10; ++i) {
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), scheduler.delay(100));
+    }
+
+    // There is no load without a budget.
+    scheduler.maximumDelay(3);
+    for (std::size_t i = 0u; i < 10; ++i) {
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), scheduler.delay(100));
+    }
+    scheduler.startBucket();
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), scheduler.numberDeferredTests());
+
+    scheduler.bucketBudget(300);
+
+    TSizeVec delays;
+    for (std::size_t i = 0u; i < 10; ++i) {
+        delays.push_back(scheduler.delay(100));
+    }
+    LOG_DEBUG(<< "delays = " << core::CContainerPrinter::print(delays));
+    CPPUNIT_ASSERT_EQUAL(std::string("[0, 0, 0, 1, 1, 1, 2, 2, 2, 3]"),
+                         core::CContainerPrinter::print(delays));
+    scheduler.startBucket();
+    CPPUNIT_ASSERT_EQUAL(std::size_t(7), scheduler.numberDeferredTests());
+
+    // The tests deferred to this bucket and the next have used their
+    // budgets.
+    CPPUNIT_ASSERT_EQUAL(std::size_t(2), scheduler.delay(100));
+    CPPUNIT_ASSERT_EQUAL(std::size_t(3), scheduler.delay(200));
+
+    // If there isn't enough budget left in any bucket the test runs in the
+    // earliest one with the least cost scheduled.
+    CPPUNIT_ASSERT_EQUAL(std::size_t(2), scheduler.delay(200));
+    CPPUNIT_ASSERT_EQUAL(std::size_t(3), scheduler.delay(1000));
+
+    scheduler.startBucket();
+    CPPUNIT_ASSERT_EQUAL(std::size_t(4), scheduler.numberDeferredTests());
+    scheduler.startBucket();
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), scheduler.numberDeferredTests());
+
+    scheduler.reset();
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), scheduler.numberDeferredTests());
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), scheduler.delay(1));
+}
+
+void CTimeSeriesTestSchedulerTest::testTestTime() {
+    // Test that the time spent testing is accounted per bucket and doesn't
+    // affect the delay of tests.
+
+    maths::CTimeSeriesTestScheduler& scheduler{maths::CTimeSeriesTestScheduler::instance()};
+    scheduler.reset();
+    scheduler.maximumDelay(12);
+    scheduler.startBucket();
+
+    std::size_t delay{scheduler.delay(7)};
+    {
+        maths::CTimeSeriesTestScheduler::CScopeTimeTest timer;
+        core::CSleep::sleep(12);
+    }
+    CPPUNIT_ASSERT_EQUAL(delay, scheduler.delay(7));
+
+    scheduler.startBucket();
+    LOG_DEBUG(<< "last bucket test time = " << scheduler.lastBucketTestTime() << "ms");
+    CPPUNIT_ASSERT(scheduler.lastBucketTestTime() >= 12);
+
+    scheduler.startBucket();
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), scheduler.lastBucketTestTime());
+}
+
+void CTimeSeriesTestSchedulerTest::testDecomposition() {
+    // Test that deferring the tests of many series delays, but doesn't
+    // prevent, detecting seasonality and that the results don't depend on
+    // anything but the data.
+
+    const std::size_t numberSeries{10};
+
+    test::CRandomNumbers rng;
+    TDoubleVec noise;
+    rng.generateNormalSamples(0.0, 1.0, numberSeries * 6 * WEEK / HOUR, noise);
+
+    maths::CTimeSeriesTestScheduler& scheduler{maths::CTimeSeriesTestScheduler::instance()};
+
+    core_t::TTime detected[3];
+    TUInt64Vec checksums[3];
+    std::size_t deferred[3];
+    for (std::size_t i = 0u; i < 3; ++i) {
+        scheduler.reset();
+        if (i > 0) {
+            scheduler.maximumDelay(6);
+            scheduler.bucketBudget(1000);
+        }
+
+        std::vector<maths::CTimeSeriesDecomposition> decompositions(
+            numberSeries, maths::CTimeSeriesDecomposition(0.01, HOUR));
+        detected[i] = 0;
+        deferred[i] = 0;
+        for (core_t::TTime time = 0; time < 6 * WEEK; time += HOUR) {
+            scheduler.startBucket();
+            deferred[i] += scheduler.numberDeferredTests();
+            for (std::size_t j = 0u; j < numberSeries; ++j) {
+                std::size_t index{j * 6 * WEEK / HOUR + static_cast<std::size_t>(time / HOUR)};
+                decompositions[j].addPoint(time, daily(time) + noise[index]);
+            }
+            if (std::all_of(decompositions.begin(), decompositions.end(),
+                            [](const maths::CTimeSeriesDecomposition& decomposition) {
+                                return decomposition.seasonalComponents().size() > 0;
+                            })) {
+                detected[i] = time;
+                break;
+            }
+        }
+        for (const auto& decomposition : decompositions) {
+            checksums[i].push_back(decomposition.checksum());
+        }
+        LOG_DEBUG(<< "detected at " << detected[i] << ", deferred = " << deferred[i]);
+    }
+
+    CPPUNIT_ASSERT(detected[0] > 0);
+    CPPUNIT_ASSERT(detected[1] > 0);
+    CPPUNIT_ASSERT(detected[1] >= detected[0]);
+    CPPUNIT_ASSERT(detected[1] <= detected[0] + 6 * HOUR);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), deferred[0]);
+    CPPUNIT_ASSERT(deferred[1] > 0);
+    CPPUNIT_ASSERT_EQUAL(detected[1], detected[2]);
+    CPPUNIT_ASSERT_EQUAL(deferred[1], deferred[2]);
+    CPPUNIT_ASSERT_EQUAL(core::CContainerPrinter::print(checksums[1]),
+                         core::CContainerPrinter::print(checksums[2]));
+}
+
+void CTimeSeriesTestSchedulerTest::testPersist() {
+    // Test that a decomposition with deferred tests is persisted correctly.
+
+    test::CRandomNumbers rng;
+    TDoubleVec noise;
+    rng.generateNormalSamples(0.0, 1.0, 3 * WEEK / HOUR, noise);
+
+    maths::CTimeSeriesTestScheduler& scheduler{maths::CTimeSeriesTestScheduler::instance()};
+    scheduler.reset();
+    scheduler.maximumDelay(1000);
+    scheduler.bucketBudget(1);
+
+    // Each bucket's budget is used up before the decomposition is updated
+    // so its tests are deferred. We stop just after a test was deferred.
+    maths::CTimeSeriesDecomposition origDecomposition(0.01, HOUR);
+    for (core_t::TTime time = 0; time < 3 * WEEK; time += HOUR) {
+        scheduler.startBucket();
+        if (time >= 2 * WEEK && scheduler.numberDeferredTests() > 0) {
+            break;
+        }
+        scheduler.delay(1);
+        origDecomposition.addPoint(time, daily(time) + noise[time / HOUR]);
+    }
+    CPPUNIT_ASSERT(scheduler.numberDeferredTests() > 0);
+
+    std::string origXml;
+    {
+        core::CRapidXmlStatePersistInserter inserter("root");
+        origDecomposition.acceptPersistInserter(inserter);
+        inserter.toXml(origXml);
+    }
+    LOG_TRACE(<< "Decomposition XML representation:\n" << origXml);
+
+    core::CRapidXmlParser parser;
+    CPPUNIT_ASSERT(parser.parseStringIgnoreCdata(origXml));
+    core::CRapidXmlStateRestoreTraverser traverser(parser);
+    maths::STimeSeriesDecompositionRestoreParams params{
+        0.01, HOUR, maths::SDistributionRestoreParams{maths_t::E_ContinuousData, 0.01}};
+    maths::CTimeSeriesDecomposition restoredDecomposition(params, traverser);
+
+    std::string newXml;
+    {
+        core::CRapidXmlStatePersistInserter inserter("root");
+        restoredDecomposition.acceptPersistInserter(inserter);
+        inserter.toXml(newXml);
+    }
+    CPPUNIT_ASSERT_EQUAL(origXml, newXml);
+}
+
+CppUnit::Test* CTimeSeriesTestSchedulerTest::suite() {
+    CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CTimeSeriesTestSchedulerTest");
+
+    suiteOfTests->addTest(new CppUnit::TestCaller<CTimeSeriesTestSchedulerTest>(
+        "CTimeSeriesTestSchedulerTest::testDelay", &CTimeSeriesTestSchedulerTest::testDelay));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CTimeSeriesTestSchedulerTest>(
+        "CTimeSeriesTestSchedulerTest::testTestTime", &CTimeSeriesTestSchedulerTest::testTestTime));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CTimeSeriesTestSchedulerTest>(
+        "CTimeSeriesTestSchedulerTest::testDecomposition",
+        &CTimeSeriesTestSchedulerTest::testDecomposition));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CTimeSeriesTestSchedulerTest>(
+        "CTimeSeriesTestSchedulerTest::testPersist", &CTimeSeriesTestSchedulerTest::testPersist));
+
+    return suiteOfTests;
+}
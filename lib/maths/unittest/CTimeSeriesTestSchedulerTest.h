@@ -0,0 +1,24 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#ifndef INCLUDED_CTimeSeriesTestSchedulerTest_h
+#define INCLUDED_CTimeSeriesTestSchedulerTest_h
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class CTimeSeriesTestSchedulerTest : public CppUnit::TestFixture {
+public:
+    void testDelay();
+    void testTestTime();
+    void testDecomposition();
+    void testPersist();
+
+    void tearDown();
+
+    static CppUnit::Test* suite();
+};
+
+#endif // INCLUDED_CTimeSeriesTestSchedulerTest_h
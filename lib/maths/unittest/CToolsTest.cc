@@ -8,6 +8,7 @@
 
 #include <core/CContainerPrinter.h>
 #include <core/CLogger.h>
+#include <core/Constants.h>
 
 #include <maths/CCompositeFunctions.h>
 #include <maths/CIntegration.h>
@@ -27,6 +28,7 @@
 #include <boost/range.hpp>
 
 #include <array>
+#include <limits>
 
 using namespace ml;
 using namespace maths;
@@ -1211,6 +1213,94 @@ void CToolsTest::testLgamma() {
     CPPUNIT_ASSERT_EQUAL(result, std::numeric_limits<double>::infinity());
 }
 
+void CToolsTest::testBatchStandardNormal() {
+    // Check the batch functions against the boost::math based functions,
+    // including far into the tails and across many blocks of points.
+
+    boost::math::normal normal;
+    maths::CTools::CProbabilityOfLessLikelySample probability(maths_t::E_TwoSided);
+
+    TDoubleVec z;
+    for (double zi = -40.0; zi <= 40.0; zi += 0.01) {
+        z.push_back(zi);
+    }
+    z.push_back(0.0);
+
+    TDoubleVec minusZ(z);
+    for (auto& zi : minusZ) {
+        zi = -zi;
+    }
+
+    TDoubleVec minusLogCdf(z.size());
+    TDoubleVec minusLogCdfComplement(z.size());
+    TDoubleVec twoTail(z.size());
+    maths::CTools::minusLogStandardNormalCdf(z.data(), z.size(), minusLogCdf.data());
+    maths::CTools::minusLogStandardNormalCdf(minusZ.data(), minusZ.size(),
+                                             minusLogCdfComplement.data());
+    maths::CTools::standardNormalTwoTailProbability(z.data(), z.size(), twoTail.data());
+
+    // Where the c.d.f. is subnormal boost::math loses precision and it may
+    // underflow, in which case both are limited to -log(min double), so we
+    // can only check that the results are in the subnormal range.
+    const double minusLogMinDouble = -core::constants::LOG_MIN_DOUBLE;
+    const double minusLogDenormMin = -std::log(std::numeric_limits<double>::denorm_min());
+    auto checkMinusLogCdf = [&](double expected, double actual) {
+        if (expected < minusLogMinDouble && actual < minusLogMinDouble) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, actual, 1e-10 * expected + 1e-15);
+        } else {
+            CPPUNIT_ASSERT(expected >= minusLogMinDouble - 1e-10);
+            CPPUNIT_ASSERT(actual >= minusLogMinDouble - 1e-10);
+            CPPUNIT_ASSERT(expected <= minusLogDenormMin);
+            CPPUNIT_ASSERT(actual <= minusLogDenormMin);
+        }
+    };
+
+    double maxError = 0.0;
+    for (std::size_t i = 0u; i < z.size(); ++i) {
+        double expected = maths::CTools::SMinusLogCdf()(normal, z[i]);
+        checkMinusLogCdf(expected, minusLogCdf[i]);
+        if (expected < minusLogMinDouble) {
+            maxError = std::max(maxError, std::fabs(minusLogCdf[i] - expected));
+        }
+
+        expected = maths::CTools::SMinusLogCdfComplement()(normal, z[i]);
+        checkMinusLogCdf(expected, minusLogCdfComplement[i]);
+
+        maths_t::ETail tail;
+        expected = probability(normal, z[i], tail);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, twoTail[i], 1e-10 * expected + 1e-300);
+    }
+    LOG_DEBUG(<< "max error = " << maxError);
+
+    // The results should be limited in the same way as SMinusLogCdf.
+    double limits[]{-std::numeric_limits<double>::infinity(), -1e10, 1e10,
+                    std::numeric_limits<double>::infinity()};
+    maths::CTools::minusLogStandardNormalCdf(limits, 4, limits);
+    CPPUNIT_ASSERT_EQUAL(-core::constants::LOG_MIN_DOUBLE, limits[0]);
+    CPPUNIT_ASSERT_EQUAL(-core::constants::LOG_MIN_DOUBLE, limits[1]);
+    CPPUNIT_ASSERT_EQUAL(0.0, limits[2]);
+    CPPUNIT_ASSERT_EQUAL(0.0, limits[3]);
+
+    // Very small batches are evaluated one point at a time so check they're
+    // consistent with large batches.
+    for (std::size_t i = 0u; i + 3 <= z.size(); i += 997) {
+        double batch[3];
+        maths::CTools::minusLogStandardNormalCdf(&z[i], 3, batch);
+        for (std::size_t j = 0u; j < 3; ++j) {
+            checkMinusLogCdf(minusLogCdf[i + j], batch[j]);
+        }
+        maths::CTools::standardNormalTwoTailProbability(&z[i], 3, batch);
+        for (std::size_t j = 0u; j < 3; ++j) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(twoTail[i + j], batch[j],
+                                         1e-10 * twoTail[i + j] + 1e-300);
+        }
+    }
+
+    // Writing the results over the input is allowed.
+    maths::CTools::minusLogStandardNormalCdf(z.data(), z.size(), z.data());
+    CPPUNIT_ASSERT(z == minusLogCdf);
+}
+
 CppUnit::Test* CToolsTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CToolsTest");
 
@@ -1232,6 +1322,8 @@ CppUnit::Test* CToolsTest::suite() {
         "CToolsTest::testMiscellaneous", &CToolsTest::testMiscellaneous));
     suiteOfTests->addTest(new CppUnit::TestCaller<CToolsTest>(
         "CToolsTest::testLgamma", &CToolsTest::testLgamma));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CToolsTest>(
+        "CToolsTest::testBatchStandardNormal", &CToolsTest::testBatchStandardNormal));
 
     return suiteOfTests;
 }
@@ -19,6 +19,7 @@ public:
     void testFastLog();
     void testMiscellaneous();
     void testLgamma();
+    void testBatchStandardNormal();
 
     static CppUnit::Test* suite();
 };
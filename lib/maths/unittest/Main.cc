@@ -79,6 +79,7 @@
 #include "CTimeSeriesModelTest.h"
 #include "CTimeSeriesMultibucketFeaturesTest.h"
 #include "CTimeSeriesSegmentationTest.h"
+#include "CTimeSeriesTestSchedulerTest.h"
 #include "CToolsTest.h"
 #include "CTrendComponentTest.h"
 #include "CXMeansOnline1dTest.h"
@@ -161,6 +162,7 @@ int main(int argc, const char** argv) {
     runner.addTest(CTimeSeriesModelTest::suite());
     runner.addTest(CTimeSeriesMultibucketFeaturesTest::suite());
     runner.addTest(CTimeSeriesSegmentationTest::suite());
+    runner.addTest(CTimeSeriesTestSchedulerTest::suite());
     runner.addTest(CToolsTest::suite());
     runner.addTest(CTrendComponentTest::suite());
     runner.addTest(CXMeansTest::suite());
@@ -358,11 +358,22 @@ void CAnomalyDetector::addRecord(core_t::TTime time, const TStrCPtrVec& fieldVal
     m_DataGatherer->addArrival(processedFieldValues, eventData, m_Limits.resourceMonitor());
 }
 
+void CAnomalyDetector::addRecords(const TTimeVec& times, const TStrCPtrVecVec& fieldValues) {
+    m_DataGatherer->addArrivals(times, this->preprocessFieldValues(times.size(), fieldValues),
+                                m_Limits.resourceMonitor());
+}
+
 const CAnomalyDetector::TStrCPtrVec&
 CAnomalyDetector::preprocessFieldValues(const TStrCPtrVec& fieldValues) {
     return fieldValues;
 }
 
+const CAnomalyDetector::TStrCPtrVecVec&
+CAnomalyDetector::preprocessFieldValues(std::size_t /*numberRecords*/,
+                                        const TStrCPtrVecVec& fieldValues) {
+    return fieldValues;
+}
+
 void CAnomalyDetector::buildResults(core_t::TTime bucketStartTime,
                                     core_t::TTime bucketEndTime,
                                     CHierarchicalResults& results) {
@@ -399,15 +410,10 @@ void CAnomalyDetector::sample(core_t::TTime startTime,
         m_Model->sample(time, time + bucketLength, resourceMonitor);
     }
 
-    if ((endTime / bucketLength) % 10 == 0) {
-        // Even if memory limiting is disabled, force a refresh every 10 buckets
-        // so the user has some idea what's going on with memory.  (Note: the
-        // 10 bucket interval is inexact as sampling may not take place for
-        // every bucket.  However, it's probably good enough.)
-        resourceMonitor.forceRefresh(*this);
-    } else {
-        resourceMonitor.refresh(*this);
-    }
+    // Even if memory limiting is disabled the resource monitor audits the
+    // memory usage periodically so the user has some idea what's going on
+    // with memory.
+    resourceMonitor.refresh(*this);
 }
 
 void CAnomalyDetector::sampleBucketStatistics(core_t::TTime startTime,
@@ -601,6 +607,23 @@ std::size_t CAnomalyDetector::memoryUsage() const {
     return core::CMemory::dynamicSize(m_DataGatherer) + core::CMemory::dynamicSize(m_Model);
 }
 
+std::size_t CAnomalyDetector::computeMemoryUsage() const {
+    std::size_t mem{core::CMemory::dynamicSize(m_DataGatherer)};
+    if (m_Model != nullptr) {
+        mem += core::CMemory::staticSize(*m_Model) + m_Model->computedMemoryUsage();
+    }
+    return mem;
+}
+
+std::size_t CAnomalyDetector::sharedMemoryUsage() const {
+    return m_Model != nullptr ? m_Model->sharedMemoryUsage() : 0;
+}
+
+std::ptrdiff_t CAnomalyDetector::takeMemoryUsageDelta() {
+    return (m_Model != nullptr ? m_Model->takeMemoryUsageDelta() : 0) +
+           m_DataGatherer->takeMemoryUsageDelta();
+}
+
 const core_t::TTime& CAnomalyDetector::lastBucketEndTime() const {
     return m_LastBucketEndTime;
 }
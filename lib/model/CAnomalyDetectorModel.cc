@@ -33,6 +33,7 @@
 #include <boost/bind.hpp>
 
 #include <algorithm>
+#include <atomic>
 
 namespace ml {
 namespace model {
@@ -81,7 +82,7 @@ CAnomalyDetectorModel::CAnomalyDetectorModel(const SModelParams& params,
                                              const TDataGathererPtr& dataGatherer,
                                              const TFeatureInfluenceCalculatorCPtrPrVecVec& influenceCalculators)
     : m_Params(params), m_DataGatherer(dataGatherer), m_BucketCount(0.0),
-      m_InfluenceCalculators(influenceCalculators) {
+      m_InfluenceCalculators(influenceCalculators), m_MemoryUsageDelta(0) {
     if (!m_DataGatherer) {
         LOG_ABORT(<< "Must provide a data gatherer");
     }
@@ -100,7 +101,7 @@ CAnomalyDetectorModel::CAnomalyDetectorModel(bool isForPersistence,
       // data gatherer that are invariant.
       m_Params(other.m_Params), m_DataGatherer(other.m_DataGatherer),
       m_PersonBucketCounts(other.m_PersonBucketCounts),
-      m_BucketCount(other.m_BucketCount) {
+      m_BucketCount(other.m_BucketCount), m_MemoryUsageDelta(0) {
     if (!isForPersistence) {
         LOG_ABORT(<< "This constructor only creates clones for persistence");
     }
@@ -310,6 +311,20 @@ void CAnomalyDetectorModel::debugMemoryUsage(core::CMemoryUsage::TMemoryUsagePtr
     core::CMemoryDebug::dynamicSize("m_InfluenceCalculators", m_InfluenceCalculators, mem);
 }
 
+std::size_t CAnomalyDetectorModel::computedMemoryUsage() const {
+    return this->computeMemoryUsage();
+}
+
+std::size_t CAnomalyDetectorModel::sharedMemoryUsage() const {
+    return 0;
+}
+
+std::ptrdiff_t CAnomalyDetectorModel::takeMemoryUsageDelta() {
+    std::ptrdiff_t result{m_MemoryUsageDelta};
+    m_MemoryUsageDelta = 0;
+    return result;
+}
+
 std::size_t CAnomalyDetectorModel::memoryUsage() const {
     std::size_t mem{core::CMemory::dynamicSize(m_Params)};
     mem += core::CMemory::dynamicSize(m_DataGatherer);
@@ -416,8 +431,10 @@ double CAnomalyDetectorModel::windowBucketCount() const {
 
 void CAnomalyDetectorModel::createNewModels(std::size_t n, std::size_t /*m*/) {
     if (n > 0) {
+        std::size_t before{core::CMemory::dynamicSize(m_PersonBucketCounts)};
         n += m_PersonBucketCounts.size();
         core::CAllocationStrategy::resize(m_PersonBucketCounts, n, 0.0);
+        this->recordMemoryUsageChange(before, core::CMemory::dynamicSize(m_PersonBucketCounts));
     }
 }
 
@@ -473,6 +490,10 @@ maths::CModel* CAnomalyDetectorModel::tinyModel() {
     return new maths::CModelStub;
 }
 
+void CAnomalyDetectorModel::recordMemoryUsageChange(std::size_t before, std::size_t after) {
+    m_MemoryUsageDelta += static_cast<std::ptrdiff_t>(after) - static_cast<std::ptrdiff_t>(before);
+}
+
 const std::size_t CAnomalyDetectorModel::MAXIMUM_PERMITTED_AGE(1000000);
 const core_t::TTime CAnomalyDetectorModel::TIME_UNSET(-1);
 const std::string CAnomalyDetectorModel::EMPTY_STRING;
@@ -509,14 +530,50 @@ void CAnomalyDetectorModel::SFeatureModels::acceptPersistInserter(core::CStatePe
     }
 }
 
+maths::CModel* CAnomalyDetectorModel::SFeatureModels::writableModel(std::size_t id) const {
+    TMathsModelSPtr& model{s_Models[id]};
+    if (model.use_count() > 1) {
+        model.reset(model->clone(model->identifier()));
+    } else {
+        // Synchronise with a clone on another thread releasing the model.
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return model.get();
+}
+
 void CAnomalyDetectorModel::SFeatureModels::debugMemoryUsage(core::CMemoryUsage::TMemoryUsagePtr mem) const {
     mem->setName("SFeatureModels");
     core::CMemoryDebug::dynamicSize("s_NewModel", s_NewModel, mem);
-    core::CMemoryDebug::dynamicSize("s_Models", s_Models, mem);
+    // We charge models shared with a clone in full so the memory usage
+    // doesn't drop while a clone for persistence exists.
+    mem->addItem("s_Models", s_Models.capacity() * sizeof(TMathsModelSPtr));
+    for (const auto& model : s_Models) {
+        if (model != nullptr) {
+            mem->addItem("shared_ptr", sizeof(long) + core::CMemory::staticSize(*model));
+            core::CMemoryDebug::dynamicSize("s_Models", *model, mem);
+        }
+    }
 }
 
 std::size_t CAnomalyDetectorModel::SFeatureModels::memoryUsage() const {
-    return core::CMemory::dynamicSize(s_NewModel) + core::CMemory::dynamicSize(s_Models);
+    std::size_t mem{core::CMemory::dynamicSize(s_NewModel)};
+    mem += s_Models.capacity() * sizeof(TMathsModelSPtr);
+    for (const auto& model : s_Models) {
+        if (model != nullptr) {
+            mem += sizeof(long) + core::CMemory::dynamicSize(model.get());
+        }
+    }
+    return mem;
+}
+
+std::size_t CAnomalyDetectorModel::SFeatureModels::sharedMemoryUsage() const {
+    std::size_t mem{0};
+    for (const auto& model : s_Models) {
+        if (model.use_count() > 1) {
+            mem += sizeof(long) + core::CMemory::dynamicSize(model.get());
+        }
+    }
+    return mem;
 }
 
 CAnomalyDetectorModel::SFeatureCorrelateModels::SFeatureCorrelateModels(
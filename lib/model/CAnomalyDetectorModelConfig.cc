@@ -60,6 +60,8 @@ const std::size_t CAnomalyDetectorModelConfig::DEFAULT_SAMPLE_COUNT_FACTOR_WITH_
 const double CAnomalyDetectorModelConfig::DEFAULT_SAMPLE_QUEUE_GROWTH_FACTOR(0.1);
 const core_t::TTime CAnomalyDetectorModelConfig::STANDARD_BUCKET_LENGTH(1800);
 const std::size_t CAnomalyDetectorModelConfig::DEFAULT_BUCKET_RESULTS_DELAY(0);
+const std::size_t CAnomalyDetectorModelConfig::DEFAULT_MAXIMUM_TEST_DELAY(0);
+const std::size_t CAnomalyDetectorModelConfig::DEFAULT_BUCKET_TEST_BUDGET(100000);
 const double CAnomalyDetectorModelConfig::DEFAULT_DECAY_RATE(0.0005);
 const double CAnomalyDetectorModelConfig::DEFAULT_INITIAL_DECAY_RATE_MULTIPLIER(4.0);
 const double CAnomalyDetectorModelConfig::DEFAULT_LEARN_RATE(1.0);
@@ -166,7 +168,10 @@ double CAnomalyDetectorModelConfig::trendDecayRate(double modelDecayRate,
 CAnomalyDetectorModelConfig::CAnomalyDetectorModelConfig()
     : m_BucketLength(STANDARD_BUCKET_LENGTH),
       m_BucketResultsDelay(DEFAULT_BUCKET_RESULTS_DELAY),
-      m_MultivariateByFields(false), m_ModelPlotBoundsPercentile(-1.0),
+      m_MaximumTestDelay(DEFAULT_MAXIMUM_TEST_DELAY),
+      m_BucketTestBudget(DEFAULT_BUCKET_TEST_BUDGET),
+      m_MultivariateByFields(false), m_ThreadPool(nullptr),
+      m_ModelPlotBoundsPercentile(-1.0),
       m_MaximumAnomalousProbability(DEFAULT_MAXIMUM_ANOMALOUS_PROBABILITY),
       m_NoisePercentile(DEFAULT_NOISE_PERCENTILE),
       m_NoiseMultiplier(DEFAULT_NOISE_MULTIPLIER),
@@ -191,6 +196,14 @@ void CAnomalyDetectorModelConfig::bucketResultsDelay(std::size_t delay) {
     m_BucketResultsDelay = delay;
 }
 
+void CAnomalyDetectorModelConfig::maximumTestDelay(std::size_t delay) {
+    m_MaximumTestDelay = delay;
+}
+
+void CAnomalyDetectorModelConfig::bucketTestBudget(std::size_t budget) {
+    m_BucketTestBudget = budget;
+}
+
 void CAnomalyDetectorModelConfig::interimBucketCorrector(const TInterimBucketCorrectorPtr& interimBucketCorrector) {
     m_InterimBucketCorrector = interimBucketCorrector;
     for (auto& factory : m_Factories) {
@@ -209,6 +222,10 @@ void CAnomalyDetectorModelConfig::multivariateByFields(bool enabled) {
     m_MultivariateByFields = enabled;
 }
 
+void CAnomalyDetectorModelConfig::threadPool(core::CStaticThreadPool* threadPool) {
+    m_ThreadPool = threadPool;
+}
+
 void CAnomalyDetectorModelConfig::factories(const TFactoryTypeFactoryPtrMap& factories) {
     m_Factories = factories;
 }
@@ -628,6 +645,7 @@ CAnomalyDetectorModelConfig::factory(int identifier,
     result->features(features);
     result->bucketResultsDelay(m_BucketResultsDelay);
     result->multivariateByFields(m_MultivariateByFields);
+    result->threadPool(m_ThreadPool);
     TIntDetectionRuleVecUMapCItr rulesItr = m_DetectionRules.get().find(identifier);
     if (rulesItr != m_DetectionRules.get().end()) {
         result->detectionRules(TDetectionRuleVecCRef(rulesItr->second));
@@ -663,6 +681,14 @@ std::size_t CAnomalyDetectorModelConfig::bucketResultsDelay() const {
     return m_BucketResultsDelay;
 }
 
+std::size_t CAnomalyDetectorModelConfig::maximumTestDelay() const {
+    return m_MaximumTestDelay;
+}
+
+std::size_t CAnomalyDetectorModelConfig::bucketTestBudget() const {
+    return m_BucketTestBudget;
+}
+
 const CInterimBucketCorrector& CAnomalyDetectorModelConfig::interimBucketCorrector() const {
     return *m_InterimBucketCorrector;
 }
@@ -734,7 +760,10 @@ const std::string INDIVIDUAL_MODE_FRACTION_PROPERTY("individualmodefraction");
 const std::string POPULATION_MODE_FRACTION_PROPERTY("populationmodefraction");
 const std::string PEERS_MODE_FRACTION_PROPERTY("peersmodefraction");
 const std::string COMPONENT_SIZE_PROPERTY("componentsize");
+const std::string LAZY_PRIOR_UPDATES_PROPERTY("lazypriorupdates");
 const std::string SAMPLE_COUNT_FACTOR_PROPERTY("samplecountfactor");
+const std::string MAXIMUM_TEST_DELAY_PROPERTY("maximumtestdelay");
+const std::string BUCKET_TEST_BUDGET_PROPERTY("buckettestbudget");
 const std::string PRUNE_WINDOW_SCALE_MINIMUM("prunewindowscaleminimum");
 const std::string PRUNE_WINDOW_SCALE_MAXIMUM("prunewindowscalemaximum");
 const std::string AGGREGATION_STYLE_PARAMS("aggregationstyleparams");
@@ -855,6 +884,16 @@ bool CAnomalyDetectorModelConfig::processStanza(const boost::property_tree::ptre
             for (auto& factory : m_Factories) {
                 factory.second->componentSize(componentSize);
             }
+        } else if (propName == LAZY_PRIOR_UPDATES_PROPERTY) {
+            bool enabled;
+            if (core::CStringUtils::stringToType(propValue, enabled) == false) {
+                LOG_ERROR(<< "Invalid value of property " << propName << " : " << propValue);
+                result = false;
+                continue;
+            }
+            for (auto& factory : m_Factories) {
+                factory.second->lazyPriorUpdates(enabled);
+            }
         } else if (propName == SAMPLE_COUNT_FACTOR_PROPERTY) {
             int factor;
             if (core::CStringUtils::stringToType(propValue, factor) == false || factor < 0) {
@@ -865,6 +904,22 @@ bool CAnomalyDetectorModelConfig::processStanza(const boost::property_tree::ptre
             for (auto& factory : m_Factories) {
                 factory.second->sampleCountFactor(factor);
             }
+        } else if (propName == MAXIMUM_TEST_DELAY_PROPERTY) {
+            std::size_t delay;
+            if (core::CStringUtils::stringToType(propValue, delay) == false) {
+                LOG_ERROR(<< "Invalid value for property " << propName << " : " << propValue);
+                result = false;
+                continue;
+            }
+            this->maximumTestDelay(delay);
+        } else if (propName == BUCKET_TEST_BUDGET_PROPERTY) {
+            std::size_t budget;
+            if (core::CStringUtils::stringToType(propValue, budget) == false) {
+                LOG_ERROR(<< "Invalid value for property " << propName << " : " << propValue);
+                result = false;
+                continue;
+            }
+            this->bucketTestBudget(budget);
         } else if (propName == PRUNE_WINDOW_SCALE_MINIMUM) {
             double factor;
             if (core::CStringUtils::stringToType(propValue, factor) == false) {
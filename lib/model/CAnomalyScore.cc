@@ -11,6 +11,7 @@
 #include <core/CJsonStateRestoreTraverser.h>
 #include <core/CLogger.h>
 #include <core/CPersistUtils.h>
+#include <core/CScopedFastLock.h>
 #include <core/RestoreMacros.h>
 
 #include <maths/CBasicStatistics.h>
@@ -28,6 +29,8 @@
 #include <boost/range.hpp>
 #include <boost/ref.hpp>
 
+#include <algorithm>
+#include <limits>
 #include <numeric>
 #include <vector>
 
@@ -257,7 +260,7 @@ CAnomalyScore::CNormalizer::CNormalizer(const CAnomalyDetectorModelConfig& confi
                   std::max(static_cast<double>(config.bucketLength()) /
                                static_cast<double>(CAnomalyDetectorModelConfig::STANDARD_BUCKET_LENGTH),
                            1.0)),
-      m_TimeToQuantileDecay(QUANTILE_DECAY_TIME) {
+      m_TimeToQuantileDecay(QUANTILE_DECAY_TIME), m_LookupIsCurrent(false) {
 }
 
 bool CAnomalyScore::CNormalizer::canNormalize() const {
@@ -279,13 +282,13 @@ bool CAnomalyScore::CNormalizer::normalize(const CMaximumScoreScope& scope,
 
     LOG_TRACE(<< "Normalising " << score);
 
-    static const double CONFIDENCE_INTERVAL = 70.0;
-
     double normalizedScores[] = {m_MaximumNormalizedScore, m_MaximumNormalizedScore,
                                  m_MaximumNormalizedScore, m_MaximumNormalizedScore};
 
     uint32_t discreteScore = this->discreteScore(score);
 
+    this->refreshLookup();
+
     // Our normalized score is the minimum of a set of different
     // score ceilings. The idea is that we have a number of factors
     // which can reduce the score based on the other score values
@@ -323,78 +326,19 @@ bool CAnomalyScore::CNormalizer::normalize(const CMaximumScoreScope& scope,
     // c.d.f. of the score and pn the noise percentile. We achieve
     // this by adding "max score" * min(F(0) / "noise percentile",
     // to the score.
-    uint32_t noiseScore;
-    m_RawScoreQuantileSummary.quantile(m_NoisePercentile / 100.0, noiseScore);
-    auto knotPoint = std::lower_bound(m_NormalizedScoreKnotPoints.begin(),
-                                      m_NormalizedScoreKnotPoints.end(),
-                                      TDoubleDoublePr(m_NoisePercentile, 0.0));
     double signalStrength =
         m_NoiseMultiplier * 10.0 / DISCRETIZATION_FACTOR *
-        (static_cast<double>(discreteScore) - static_cast<double>(noiseScore));
-    double l0;
-    double u0;
-    m_RawScoreQuantileSummary.cdf(0, 0.0, l0, u0);
-    normalizedScores[0] =
-        knotPoint->second * std::max(1.0 + signalStrength, 0.0) +
-        m_MaximumNormalizedScore *
-            std::max(2.0 * std::min(50.0 * (l0 + u0) / m_NoisePercentile, 1.0) - 1.0, 0.0);
+        (static_cast<double>(discreteScore) - static_cast<double>(m_LookupNoiseScore));
+    normalizedScores[0] = m_LookupNoiseKnotPoint * std::max(1.0 + signalStrength, 0.0) +
+                          m_LookupNoiseOffset;
     LOG_TRACE(<< "normalizedScores[0] = " << normalizedScores[0]
-              << ", knotPoint = " << knotPoint->second << ", discreteScore = " << discreteScore
-              << ", noiseScore = " << noiseScore << ", l(0) = " << l0
-              << ", u(0) = " << u0 << ", signalStrength = " << signalStrength);
-
-    // Compute the raw normalized score. Note we compute the probability
-    // of seeing a lower score on the normal bucket length and convert
-    // this to an equivalent percentile. This is just the probability
-    // that all n buckets in a normal bucket length have a lower quantile
-    // which is P^n where P is the quantile expressed as a probability.
-    double lowerBound;
-    double upperBound;
-    this->quantile(score, CONFIDENCE_INTERVAL, lowerBound, upperBound);
-    double lowerPercentile = 100.0 * std::pow(lowerBound, 1.0 / m_BucketNormalizationFactor);
-    double upperPercentile = 100.0 * std::pow(upperBound, 1.0 / m_BucketNormalizationFactor);
-    if (lowerPercentile > upperPercentile) {
-        std::swap(lowerPercentile, upperPercentile);
-    }
-    lowerPercentile = maths::CTools::truncate(lowerPercentile, 0.0, 100.0);
-    upperPercentile = maths::CTools::truncate(upperPercentile, 0.0, 100.0);
+              << ", knotPoint = " << m_LookupNoiseKnotPoint << ", discreteScore = "
+              << discreteScore << ", noiseScore = " << m_LookupNoiseScore
+              << ", signalStrength = " << signalStrength);
 
-    std::size_t lowerKnotPoint =
-        std::max(std::lower_bound(m_NormalizedScoreKnotPoints.begin(),
-                                  m_NormalizedScoreKnotPoints.end(), lowerPercentile,
-                                  maths::COrderings::SFirstLess()) -
-                     m_NormalizedScoreKnotPoints.begin(),
-                 ptrdiff_t(1));
-    std::size_t upperKnotPoint =
-        std::max(std::lower_bound(m_NormalizedScoreKnotPoints.begin(),
-                                  m_NormalizedScoreKnotPoints.end(), upperPercentile,
-                                  maths::COrderings::SFirstLess()) -
-                     m_NormalizedScoreKnotPoints.begin(),
-                 ptrdiff_t(1));
-    if (lowerKnotPoint < m_NormalizedScoreKnotPoints.size()) {
-        const TDoubleDoublePr& left = m_NormalizedScoreKnotPoints[lowerKnotPoint - 1];
-        const TDoubleDoublePr& right = m_NormalizedScoreKnotPoints[lowerKnotPoint];
-        // Linearly interpolate between the two knot points.
-        normalizedScores[1] = left.second + (right.second - left.second) *
-                                                (lowerPercentile - left.first) /
-                                                (right.first - left.first);
-    } else {
-        normalizedScores[1] = m_MaximumNormalizedScore;
-    }
-    if (upperKnotPoint < m_NormalizedScoreKnotPoints.size()) {
-        const TDoubleDoublePr& left = m_NormalizedScoreKnotPoints[upperKnotPoint - 1];
-        const TDoubleDoublePr& right = m_NormalizedScoreKnotPoints[upperKnotPoint];
-        // Linearly interpolate between the two knot points.
-        normalizedScores[1] = (normalizedScores[1] + left.second +
-                               (right.second - left.second) * (upperPercentile - left.first) /
-                                   (right.first - left.first)) /
-                              2.0;
-    } else {
-        normalizedScores[1] = (normalizedScores[1] + m_MaximumNormalizedScore) / 2.0;
-    }
-    LOG_TRACE(<< "normalizedScores[1] = " << normalizedScores[1] << ", lowerBound = " << lowerBound
-              << ", upperBound = " << upperBound << ", lowerPercentile = " << lowerPercentile
-              << ", upperPercentile = " << upperPercentile);
+    // Compute the quantile ceiling. See quantileScoreCeiling for details.
+    normalizedScores[1] = this->lookupQuantileScoreCeiling(discreteScore);
+    LOG_TRACE(<< "normalizedScores[1] = " << normalizedScores[1]);
 
     double maxScore{0.0};
     bool hasValidMaxScore = this->maxScore(scope, maxScore);
@@ -438,7 +382,13 @@ void CAnomalyScore::CNormalizer::quantile(double score,
                                           double confidence,
                                           double& lowerBound,
                                           double& upperBound) const {
-    uint32_t discreteScore = this->discreteScore(score);
+    this->quantile(this->discreteScore(score), confidence, lowerBound, upperBound);
+}
+
+void CAnomalyScore::CNormalizer::quantile(uint32_t discreteScore,
+                                          double confidence,
+                                          double& lowerBound,
+                                          double& upperBound) const {
     double n = static_cast<double>(m_RawScoreQuantileSummary.n());
     double lowerQuantile = (100.0 - confidence) / 200.0;
     double upperQuantile = (100.0 + confidence) / 200.0;
@@ -461,14 +411,15 @@ void CAnomalyScore::CNormalizer::quantile(double score,
         upperBound = maths::CTools::truncate(upperBound - pdfLowerBound, 0.0, fu);
         if (!(lowerBound >= 0.0 && lowerBound <= 1.0) ||
             !(upperBound >= 0.0 && upperBound <= 1.0)) {
-            LOG_ERROR(<< "score = " << score << ", cdf = [" << lowerBound << ","
+            LOG_ERROR(<< "discreteScore = " << discreteScore << ", cdf = [" << lowerBound << ","
                       << upperBound << "]"
                       << ", pdf = [" << pdfLowerBound << "," << pdfUpperBound << "]");
         }
         lowerBound = maths::CQDigest::cdfQuantile(n, lowerBound, lowerQuantile);
         upperBound = maths::CQDigest::cdfQuantile(n, upperBound, upperQuantile);
 
-        LOG_TRACE(<< "score = " << score << ", cdf = [" << lowerBound << "," << upperBound << "]"
+        LOG_TRACE(<< "discreteScore = " << discreteScore << ", cdf = [" << lowerBound
+                  << "," << upperBound << "]"
                   << ", pdf = [" << pdfLowerBound << "," << pdfUpperBound << "]");
 
         return;
@@ -500,7 +451,8 @@ void CAnomalyScore::CNormalizer::quantile(double score,
                                    std::numeric_limits<double>::epsilon());
     if (!(lowerBound >= 0.0 && lowerBound <= 1.0) ||
         !(upperBound >= 0.0 && upperBound <= 1.0)) {
-        LOG_ERROR(<< "score = " << score << ", cdf = [" << lowerBound << "," << upperBound << "]"
+        LOG_ERROR(<< "discreteScore = " << discreteScore << ", cdf = [" << lowerBound
+                  << "," << upperBound << "]"
                   << ", cutoff = [" << cutoffCdfLowerBound << "," << cutoffCdfUpperBound << "]"
                   << ", pdf = [" << pdfLowerBound << "," << pdfUpperBound << "]"
                   << ", f = " << f);
@@ -508,18 +460,141 @@ void CAnomalyScore::CNormalizer::quantile(double score,
     lowerBound = maths::CQDigest::cdfQuantile(n, lowerBound, lowerQuantile);
     upperBound = maths::CQDigest::cdfQuantile(n, upperBound, upperQuantile);
 
-    LOG_TRACE(<< "score = " << score << ", cdf = [" << lowerBound << "," << upperBound << "]"
+    LOG_TRACE(<< "discreteScore = " << discreteScore << ", cdf = [" << lowerBound
+              << "," << upperBound << "]"
               << ", cutoff = [" << cutoffCdfLowerBound << "," << cutoffCdfUpperBound << "]"
               << ", pdf = [" << pdfLowerBound << "," << pdfUpperBound << "]"
               << ", f = " << f);
 }
 
+double CAnomalyScore::CNormalizer::quantileScoreCeiling(uint32_t discreteScore) const {
+    static const double CONFIDENCE_INTERVAL = 70.0;
+
+    // Compute the raw normalized score. Note we compute the probability
+    // of seeing a lower score on the normal bucket length and convert
+    // this to an equivalent percentile. This is just the probability
+    // that all n buckets in a normal bucket length have a lower quantile
+    // which is P^n where P is the quantile expressed as a probability.
+    double lowerBound;
+    double upperBound;
+    this->quantile(discreteScore, CONFIDENCE_INTERVAL, lowerBound, upperBound);
+    double lowerPercentile = 100.0 * std::pow(lowerBound, 1.0 / m_BucketNormalizationFactor);
+    double upperPercentile = 100.0 * std::pow(upperBound, 1.0 / m_BucketNormalizationFactor);
+    if (lowerPercentile > upperPercentile) {
+        std::swap(lowerPercentile, upperPercentile);
+    }
+    lowerPercentile = maths::CTools::truncate(lowerPercentile, 0.0, 100.0);
+    upperPercentile = maths::CTools::truncate(upperPercentile, 0.0, 100.0);
+
+    std::size_t lowerKnotPoint =
+        std::max(std::lower_bound(m_NormalizedScoreKnotPoints.begin(),
+                                  m_NormalizedScoreKnotPoints.end(), lowerPercentile,
+                                  maths::COrderings::SFirstLess()) -
+                     m_NormalizedScoreKnotPoints.begin(),
+                 ptrdiff_t(1));
+    std::size_t upperKnotPoint =
+        std::max(std::lower_bound(m_NormalizedScoreKnotPoints.begin(),
+                                  m_NormalizedScoreKnotPoints.end(), upperPercentile,
+                                  maths::COrderings::SFirstLess()) -
+                     m_NormalizedScoreKnotPoints.begin(),
+                 ptrdiff_t(1));
+    double result;
+    if (lowerKnotPoint < m_NormalizedScoreKnotPoints.size()) {
+        const TDoubleDoublePr& left = m_NormalizedScoreKnotPoints[lowerKnotPoint - 1];
+        const TDoubleDoublePr& right = m_NormalizedScoreKnotPoints[lowerKnotPoint];
+        // Linearly interpolate between the two knot points.
+        result = left.second + (right.second - left.second) *
+                                   (lowerPercentile - left.first) /
+                                   (right.first - left.first);
+    } else {
+        result = m_MaximumNormalizedScore;
+    }
+    if (upperKnotPoint < m_NormalizedScoreKnotPoints.size()) {
+        const TDoubleDoublePr& left = m_NormalizedScoreKnotPoints[upperKnotPoint - 1];
+        const TDoubleDoublePr& right = m_NormalizedScoreKnotPoints[upperKnotPoint];
+        // Linearly interpolate between the two knot points.
+        result = (result + left.second +
+                  (right.second - left.second) * (upperPercentile - left.first) /
+                      (right.first - left.first)) /
+                 2.0;
+    } else {
+        result = (result + m_MaximumNormalizedScore) / 2.0;
+    }
+    LOG_TRACE(<< "quantile ceiling = " << result << ", lowerBound = " << lowerBound
+              << ", upperBound = " << upperBound << ", lowerPercentile = " << lowerPercentile
+              << ", upperPercentile = " << upperPercentile);
+
+    return result;
+}
+
+void CAnomalyScore::CNormalizer::refreshLookup() const {
+    if (m_LookupIsCurrent.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    core::CScopedFastLock lock(m_LookupMutex);
+    if (m_LookupIsCurrent.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    m_RawScoreQuantileSummary.quantile(m_NoisePercentile / 100.0, m_LookupNoiseScore);
+    auto knotPoint = std::lower_bound(m_NormalizedScoreKnotPoints.begin(),
+                                      m_NormalizedScoreKnotPoints.end(),
+                                      TDoubleDoublePr(m_NoisePercentile, 0.0));
+    m_LookupNoiseKnotPoint = knotPoint->second;
+    double l0;
+    double u0;
+    m_RawScoreQuantileSummary.cdf(0, 0.0, l0, u0);
+    m_LookupNoiseOffset =
+        m_MaximumNormalizedScore *
+        std::max(2.0 * std::min(50.0 * (l0 + u0) / m_NoisePercentile, 1.0) - 1.0, 0.0);
+
+    // The quantile bounds only change at the end points of the quantile
+    // summaries' c.d.f.s and one past the high percentile score, where
+    // we switch summary.
+    TUInt32Vec endPoints;
+    m_RawScoreQuantileSummary.cdfEndPoints(m_LookupIntervals);
+    m_RawScoreHighQuantileSummary.cdfEndPoints(endPoints);
+    if (m_HighPercentileScore < std::numeric_limits<uint32_t>::max()) {
+        endPoints.push_back(m_HighPercentileScore + 1);
+    }
+    m_LookupIntervals.insert(m_LookupIntervals.end(), endPoints.begin(), endPoints.end());
+    std::sort(m_LookupIntervals.begin(), m_LookupIntervals.end());
+    m_LookupIntervals.erase(std::unique(m_LookupIntervals.begin(), m_LookupIntervals.end()),
+                            m_LookupIntervals.end());
+
+    m_LookupQuantileScoreCeilings = TAtomicDoubleVec(m_LookupIntervals.size());
+    for (auto& ceiling : m_LookupQuantileScoreCeilings) {
+        ceiling.store(std::numeric_limits<double>::quiet_NaN(), std::memory_order_relaxed);
+    }
+    LOG_TRACE(<< "# intervals = " << m_LookupIntervals.size());
+
+    m_LookupIsCurrent.store(true, std::memory_order_release);
+}
+
+double CAnomalyScore::CNormalizer::lookupQuantileScoreCeiling(uint32_t discreteScore) const {
+    // The first interval always starts at zero.
+    std::size_t i = std::upper_bound(m_LookupIntervals.begin(),
+                                     m_LookupIntervals.end(), discreteScore) -
+                    m_LookupIntervals.begin() - 1;
+    double result = m_LookupQuantileScoreCeilings[i].load(std::memory_order_relaxed);
+    if (maths::CMathsFuncs::isNan(result)) {
+        // The ceiling is the same for every score in the interval so it
+        // doesn't matter if more than one thread fills it in.
+        result = this->quantileScoreCeiling(discreteScore);
+        m_LookupQuantileScoreCeilings[i].store(result, std::memory_order_relaxed);
+    }
+    return result;
+}
+
 bool CAnomalyScore::CNormalizer::updateQuantiles(const CMaximumScoreScope& scope, double score) {
     using TUInt32UInt64Pr = std::pair<uint32_t, uint64_t>;
     using TUInt32UInt64PrVec = std::vector<TUInt32UInt64Pr>;
 
     bool bigChange(false);
 
+    m_LookupIsCurrent.store(false);
+
     CMaxScore& maxScore = m_MaxScores[scope.key(m_IsForMembersOfPopulation, m_Dictionary)];
 
     double oldMaxScore(maxScore.score());
@@ -696,6 +771,8 @@ void CAnomalyScore::CNormalizer::propagateForwardByTime(double time) {
     if (m_TimeToQuantileDecay <= 0.0) {
         time = std::floor((QUANTILE_DECAY_TIME - m_TimeToQuantileDecay) / QUANTILE_DECAY_TIME);
 
+        m_LookupIsCurrent.store(false);
+
         uint64_t n = m_RawScoreQuantileSummary.n();
         m_RawScoreQuantileSummary.propagateForwardsByTime(time);
         m_RawScoreHighQuantileSummary.propagateForwardsByTime(time);
@@ -763,6 +840,8 @@ bool CAnomalyScore::CNormalizer::upgrade(const std::string& loadedVersion,
         element.second.age(highScoreUpgradeFactor);
     }
 
+    m_LookupIsCurrent.store(false);
+
     if (m_RawScoreQuantileSummary.scale(qDigestUpgradeFactor) == false) {
         LOG_ERROR(<< "Failed to scale raw score quantiles");
         return false;
@@ -784,6 +863,7 @@ void CAnomalyScore::CNormalizer::clear() {
     m_RawScoreQuantileSummary.clear();
     m_RawScoreHighQuantileSummary.clear();
     m_TimeToQuantileDecay = QUANTILE_DECAY_TIME;
+    m_LookupIsCurrent.store(false);
 }
 
 void CAnomalyScore::CNormalizer::acceptPersistInserter(core::CStatePersistInserter& inserter) const {
@@ -832,6 +912,8 @@ bool CAnomalyScore::CNormalizer::acceptRestoreTraverser(core::CStateRestoreTrave
 
     } while (traverser.next());
 
+    m_LookupIsCurrent.store(false);
+
     return true;
 }
 
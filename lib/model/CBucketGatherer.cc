@@ -126,9 +126,7 @@ bool restoreInfluencerPersonAttributeCounts(core::CStateRestoreTraverser& traver
 
 //! \brief Manages persistence of bucket counts.
 struct SBucketCountsPersister {
-    using TSizeSizePrUInt64UMap = CBucketGatherer::TSizeSizePrUInt64UMap;
-
-    void operator()(const TSizeSizePrUInt64UMap& bucketCounts,
+    void operator()(const CPersonAttributeCounts& bucketCounts,
                     core::CStatePersistInserter& inserter) {
         CBucketGatherer::TSizeSizePrUInt64PrVec personAttributeCounts;
         personAttributeCounts.reserve(bucketCounts.size());
@@ -141,7 +139,7 @@ struct SBucketCountsPersister {
         }
     }
 
-    bool operator()(TSizeSizePrUInt64UMap& bucketCounts,
+    bool operator()(CPersonAttributeCounts& bucketCounts,
                     core::CStateRestoreTraverser& traverser) {
         do {
             TSizeSizePr key;
@@ -204,8 +202,7 @@ CBucketGatherer::CBucketGatherer(CDataGatherer& dataGatherer,
     : m_DataGatherer(dataGatherer), m_EarliestTime(startTime), m_BucketStart(startTime),
       m_PersonAttributeCounts(dataGatherer.params().s_LatencyBuckets,
                               dataGatherer.params().s_BucketLength,
-                              startTime,
-                              TSizeSizePrUInt64UMap(1)),
+                              startTime),
       m_PersonAttributeExplicitNulls(dataGatherer.params().s_LatencyBuckets,
                                      dataGatherer.params().s_BucketLength,
                                      startTime,
@@ -213,7 +210,8 @@ CBucketGatherer::CBucketGatherer(CDataGatherer& dataGatherer,
       m_InfluencerCounts(dataGatherer.params().s_LatencyBuckets + 3,
                          dataGatherer.params().s_BucketLength,
                          startTime,
-                         TSizeSizePrStoredStringPtrPrUInt64UMapVec(numberInfluencers)) {
+                         TSizeSizePrStoredStringPtrPrUInt64UMapVec(numberInfluencers)),
+      m_BucketQueuesMemoryUsage(0), m_MemoryUsageDelta(0) {
 }
 
 CBucketGatherer::CBucketGatherer(bool isForPersistence, const CBucketGatherer& other)
@@ -221,7 +219,8 @@ CBucketGatherer::CBucketGatherer(bool isForPersistence, const CBucketGatherer& o
       m_EarliestTime(other.m_EarliestTime), m_BucketStart(other.m_BucketStart),
       m_PersonAttributeCounts(other.m_PersonAttributeCounts),
       m_PersonAttributeExplicitNulls(other.m_PersonAttributeExplicitNulls),
-      m_InfluencerCounts(other.m_InfluencerCounts) {
+      m_InfluencerCounts(other.m_InfluencerCounts),
+      m_BucketQueuesMemoryUsage(0), m_MemoryUsageDelta(0) {
     if (!isForPersistence) {
         LOG_ABORT(<< "This constructor only creates clones for persistence");
     }
@@ -270,7 +269,7 @@ bool CBucketGatherer::addEventData(CEventData& data) {
             return true;
         }
 
-        TSizeSizePrUInt64UMap& bucketCounts = m_PersonAttributeCounts.get(time);
+        CPersonAttributeCounts& bucketCounts = m_PersonAttributeCounts.get(time);
         if (count > 0) {
             bucketCounts[pidCid] += count;
         }
@@ -328,14 +327,27 @@ void CBucketGatherer::hiddenTimeNow(core_t::TTime time, bool skipUpdates) {
         // after startNewBucket has been called.
         std::ptrdiff_t numberInfluences{this->endInfluencers() - this->beginInfluencers()};
         this->startNewBucket(newBucketStart, skipUpdates);
-        m_PersonAttributeCounts.push(TSizeSizePrUInt64UMap(1), newBucketStart);
-        m_PersonAttributeExplicitNulls.push(TSizeSizePrUSet(1), newBucketStart);
-        m_InfluencerCounts.push(TSizeSizePrStoredStringPtrPrUInt64UMapVec(numberInfluences),
-                                newBucketStart);
+        // We reuse the earliest bucket's collections, which are no longer
+        // needed, to avoid reallocating their memory for every bucket.
+        m_PersonAttributeCounts.recycle(
+            newBucketStart, [](CPersonAttributeCounts& counts) { counts.clear(); });
+        m_PersonAttributeExplicitNulls.recycle(
+            newBucketStart, [](TSizeSizePrUSet& explicitNulls) { explicitNulls.clear(); });
+        m_InfluencerCounts.recycle(
+            newBucketStart, [numberInfluences](TSizeSizePrStoredStringPtrPrUInt64UMapVec& counts) {
+                counts.resize(numberInfluences);
+                for (auto& influencerCounts : counts) {
+                    influencerCounts.clear();
+                }
+            });
         m_BucketStart = newBucketStart;
     }
 }
 
+void CBucketGatherer::recordMemoryUsageChange(std::size_t before, std::size_t after) {
+    m_MemoryUsageDelta += static_cast<std::ptrdiff_t>(after) - static_cast<std::ptrdiff_t>(before);
+}
+
 void CBucketGatherer::sampleNow(core_t::TTime sampleBucketStart) {
     core_t::TTime timeNow =
         sampleBucketStart +
@@ -482,8 +494,7 @@ std::string CBucketGatherer::printCurrentBucket() const {
     return result.str();
 }
 
-const CBucketGatherer::TSizeSizePrUInt64UMap&
-CBucketGatherer::bucketCounts(core_t::TTime time) const {
+const CPersonAttributeCounts& CBucketGatherer::bucketCounts(core_t::TTime time) const {
     return m_PersonAttributeCounts.get(time);
 }
 
@@ -497,7 +508,7 @@ bool CBucketGatherer::hasExplicitNullsOnly(core_t::TTime time, std::size_t pid,
     if (bucketExplicitNulls.empty()) {
         return false;
     }
-    const TSizeSizePrUInt64UMap& bucketCounts = m_PersonAttributeCounts.get(time);
+    const CPersonAttributeCounts& bucketCounts = m_PersonAttributeCounts.get(time);
     TSizeSizePr pidCid = std::make_pair(pid, cid);
     return bucketExplicitNulls.find(pidCid) != bucketExplicitNulls.end() &&
            bucketCounts.find(pidCid) == bucketCounts.end();
@@ -566,8 +577,20 @@ std::size_t CBucketGatherer::memoryUsage() const {
     return mem;
 }
 
+std::ptrdiff_t CBucketGatherer::takeMemoryUsageDelta() {
+    // The queues are recycled at bucket turnover so their memory only
+    // changes with the number of records in the latency window and they
+    // are cheap to measure.
+    std::size_t bucketQueuesMemoryUsage{this->CBucketGatherer::memoryUsage()};
+    this->recordMemoryUsageChange(m_BucketQueuesMemoryUsage, bucketQueuesMemoryUsage);
+    m_BucketQueuesMemoryUsage = bucketQueuesMemoryUsage;
+    std::ptrdiff_t result{m_MemoryUsageDelta};
+    m_MemoryUsageDelta = 0;
+    return result;
+}
+
 void CBucketGatherer::clear() {
-    m_PersonAttributeCounts.clear(TSizeSizePrUInt64UMap(1));
+    m_PersonAttributeCounts.clear();
     m_PersonAttributeExplicitNulls.clear(TSizeSizePrUSet(1));
     m_InfluencerCounts.clear(TSizeSizePrStoredStringPtrPrUInt64UMapVec(
         this->endInfluencers() - this->beginInfluencers()));
@@ -599,7 +622,7 @@ void CBucketGatherer::baseAcceptPersistInserter(core::CStatePersistInserter& ins
     inserter.insertValue(BUCKET_START_TAG, m_BucketStart);
     inserter.insertLevel(
         BUCKET_COUNT_TAG,
-        boost::bind<void>(TSizeSizePrUInt64UMapQueue::CSerializer<detail::SBucketCountsPersister>(),
+        boost::bind<void>(TPersonAttributeCountsQueue::CSerializer<detail::SBucketCountsPersister>(),
                           boost::cref(m_PersonAttributeCounts), _1));
     // Clear any empty collections before persist these are resized on restore.
     TSizeSizePrStoredStringPtrPrUInt64UMapVecQueue influencerCounts{m_InfluencerCounts};
@@ -619,12 +642,10 @@ bool CBucketGatherer::baseAcceptRestoreTraverser(core::CStateRestoreTraverser& t
         RESTORE_BUILT_IN(BUCKET_START_TAG, m_BucketStart)
         RESTORE_SETUP_TEARDOWN(
             BUCKET_COUNT_TAG,
-            m_PersonAttributeCounts = TSizeSizePrUInt64UMapQueue(
-                m_DataGatherer.params().s_LatencyBuckets, this->bucketLength(),
-                m_BucketStart, TSizeSizePrUInt64UMap(1)),
+            m_PersonAttributeCounts = TPersonAttributeCountsQueue(
+                m_DataGatherer.params().s_LatencyBuckets, this->bucketLength(), m_BucketStart),
             traverser.traverseSubLevel(boost::bind<bool>(
-                TSizeSizePrUInt64UMapQueue::CSerializer<detail::SBucketCountsPersister>(
-                    TSizeSizePrUInt64UMap(1)),
+                TPersonAttributeCountsQueue::CSerializer<detail::SBucketCountsPersister>(),
                 boost::ref(m_PersonAttributeCounts), _1)),
             /**/)
         RESTORE_SETUP_TEARDOWN(
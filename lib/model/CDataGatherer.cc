@@ -164,6 +164,9 @@ const std::size_t
     CDataGatherer::EXPLICIT_NULL_SUMMARY_COUNT(std::numeric_limits<std::size_t>::max());
 const std::size_t CDataGatherer::ESTIMATED_MEM_USAGE_PER_BY_FIELD(20000);
 const std::size_t CDataGatherer::ESTIMATED_MEM_USAGE_PER_OVER_FIELD(1000);
+const std::size_t CDataGatherer::MAX_EXTRA_MEM_USAGE_PER_RECORD(
+    std::max(ESTIMATED_MEM_USAGE_PER_BY_FIELD, ESTIMATED_MEM_USAGE_PER_OVER_FIELD) +
+    ESTIMATED_MEM_USAGE_PER_BY_FIELD);
 
 CDataGatherer::CDataGatherer(model_t::EAnalysisCategory gathererType,
                              model_t::ESummaryMode summaryMode,
@@ -190,7 +193,9 @@ CDataGatherer::CDataGatherer(model_t::EAnalysisCategory gathererType,
                            stat_t::E_NumberNewAttributes,
                            stat_t::E_NumberNewAttributesNotAllowed,
                            stat_t::E_NumberNewAttributesRecycled),
-      m_Population(detail::isPopulation(gathererType)), m_UseNull(key.useNull()) {
+      m_Population(detail::isPopulation(gathererType)), m_UseNull(key.useNull()),
+      m_RegistriesMemoryUsage(0), m_AddingBatch(false),
+      m_BatchPerson(nullptr, 0), m_BatchAttribute(nullptr, 0) {
     // Constructor needs to create 1 bucket gatherer at the startTime
     // and possibly 1 bucket gatherer at (startTime + bucketLength / 2).
 
@@ -230,7 +235,9 @@ CDataGatherer::CDataGatherer(model_t::EAnalysisCategory gathererType,
                            stat_t::E_NumberNewAttributes,
                            stat_t::E_NumberNewAttributesNotAllowed,
                            stat_t::E_NumberNewAttributesRecycled),
-      m_Population(detail::isPopulation(gathererType)), m_UseNull(key.useNull()) {
+      m_Population(detail::isPopulation(gathererType)), m_UseNull(key.useNull()),
+      m_RegistriesMemoryUsage(0), m_AddingBatch(false),
+      m_BatchPerson(nullptr, 0), m_BatchAttribute(nullptr, 0) {
     if (traverser.traverseSubLevel(boost::bind(
             &CDataGatherer::acceptRestoreTraverser, this, boost::cref(summaryCountFieldName),
             boost::cref(personFieldName), boost::cref(attributeFieldName),
@@ -246,7 +253,9 @@ CDataGatherer::CDataGatherer(bool isForPersistence, const CDataGatherer& other)
       m_PartitionFieldValue(other.m_PartitionFieldValue),
       m_PeopleRegistry(isForPersistence, other.m_PeopleRegistry),
       m_AttributesRegistry(isForPersistence, other.m_AttributesRegistry),
-      m_Population(other.m_Population), m_UseNull(other.m_UseNull) {
+      m_Population(other.m_Population), m_UseNull(other.m_UseNull),
+      m_RegistriesMemoryUsage(0), m_AddingBatch(false),
+      m_BatchPerson(nullptr, 0), m_BatchAttribute(nullptr, 0) {
     if (!isForPersistence) {
         LOG_ABORT(<< "This constructor only creates clones for persistence");
     }
@@ -359,6 +368,29 @@ bool CDataGatherer::addArrival(const TStrCPtrVec& fieldValues,
     return result;
 }
 
+std::size_t CDataGatherer::addArrivals(const TTimeVec& times,
+                                       const TStrCPtrVecVec& fieldValues,
+                                       CResourceMonitor& resourceMonitor) {
+    std::size_t result{0};
+    TStrCPtrVec recordFieldValues(fieldValues.size());
+    CEventData data;
+    m_AddingBatch = true;
+    for (std::size_t i = 0u; i < times.size(); ++i) {
+        for (std::size_t j = 0u; j < fieldValues.size(); ++j) {
+            recordFieldValues[j] = fieldValues[j][i];
+        }
+        data.clear();
+        data.time(times[i]);
+        if (this->addArrival(recordFieldValues, data, resourceMonitor)) {
+            ++result;
+        }
+    }
+    m_AddingBatch = false;
+    m_BatchPerson = TStrCPtrSizePr(nullptr, 0);
+    m_BatchAttribute = TStrCPtrSizePr(nullptr, 0);
+    return result;
+}
+
 void CDataGatherer::sampleNow(core_t::TTime sampleBucketStart) {
     this->chooseBucketGatherer(sampleBucketStart).sampleNow(sampleBucketStart);
 }
@@ -463,8 +495,7 @@ bool CDataGatherer::isPersonActive(std::size_t pid) const {
 std::size_t CDataGatherer::addPerson(const std::string& person,
                                      CResourceMonitor& resourceMonitor,
                                      bool& addedPerson) {
-    return m_PeopleRegistry.addName(person, this->chooseBucketGatherer(0).currentBucketStartTime(),
-                                    resourceMonitor, addedPerson);
+    return this->addName(m_PeopleRegistry, m_BatchPerson, person, resourceMonitor, addedPerson);
 }
 
 std::size_t CDataGatherer::numberActiveAttributes() const {
@@ -538,9 +569,8 @@ bool CDataGatherer::isAttributeActive(std::size_t cid) const {
 std::size_t CDataGatherer::addAttribute(const std::string& attribute,
                                         CResourceMonitor& resourceMonitor,
                                         bool& addedAttribute) {
-    return m_AttributesRegistry.addName(
-        attribute, this->chooseBucketGatherer(0).currentBucketStartTime(),
-        resourceMonitor, addedAttribute);
+    return this->addName(m_AttributesRegistry, m_BatchAttribute, attribute,
+                         resourceMonitor, addedAttribute);
 }
 
 double CDataGatherer::sampleCount(std::size_t id) const {
@@ -607,7 +637,7 @@ std::string CDataGatherer::printCurrentBucket(core_t::TTime time) const {
     return this->chooseBucketGatherer(time).printCurrentBucket();
 }
 
-const CDataGatherer::TSizeSizePrUInt64UMap& CDataGatherer::bucketCounts(core_t::TTime time) const {
+const CPersonAttributeCounts& CDataGatherer::bucketCounts(core_t::TTime time) const {
     return this->chooseBucketGatherer(time).bucketCounts(time);
 }
 
@@ -655,6 +685,20 @@ std::size_t CDataGatherer::memoryUsage() const {
     return mem;
 }
 
+std::ptrdiff_t CDataGatherer::takeMemoryUsageDelta() {
+    // The registries and sample counts are flat so are cheap to measure.
+    std::size_t registriesMemoryUsage{core::CMemory::dynamicSize(m_PeopleRegistry) +
+                                      core::CMemory::dynamicSize(m_AttributesRegistry) +
+                                      core::CMemory::dynamicSize(m_SampleCounts)};
+    std::ptrdiff_t result{static_cast<std::ptrdiff_t>(registriesMemoryUsage) -
+                          static_cast<std::ptrdiff_t>(m_RegistriesMemoryUsage)};
+    m_RegistriesMemoryUsage = registriesMemoryUsage;
+    for (auto& gatherer : m_Gatherers) {
+        result += gatherer->takeMemoryUsageDelta();
+    }
+    return result;
+}
+
 bool CDataGatherer::useNull() const {
     return m_UseNull;
 }
@@ -917,6 +961,26 @@ void CDataGatherer::persistBucketGatherers(core::CStatePersistInserter& inserter
     }
 }
 
+std::size_t CDataGatherer::addName(CDynamicStringIdRegistry& registry,
+                                   TStrCPtrSizePr& batchName,
+                                   const std::string& name,
+                                   CResourceMonitor& resourceMonitor,
+                                   bool& added) {
+    // Identifiers aren't recycled while a batch is added, so a name which
+    // was recorded earlier in the batch has the same identifier and adding
+    // it again would change nothing.
+    if (batchName.first != nullptr &&
+        (batchName.first == &name || *batchName.first == name)) {
+        return batchName.second;
+    }
+    std::size_t result = registry.addName(
+        name, this->chooseBucketGatherer(0).currentBucketStartTime(), resourceMonitor, added);
+    if (m_AddingBatch && result != CDynamicStringIdRegistry::INVALID_ID) {
+        batchName = TStrCPtrSizePr(&name, result);
+    }
+    return result;
+}
+
 void CDataGatherer::createBucketGatherer(model_t::EAnalysisCategory gathererType,
                                          const std::string& summaryCountFieldName,
                                          const std::string& personFieldName,
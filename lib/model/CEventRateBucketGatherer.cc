@@ -1197,7 +1197,7 @@ void CEventRateBucketGatherer::nonZeroPersonCounts(model_t::EFeature feature,
     auto& result =
         *boost::unsafe_any_cast<TSizeFeatureDataPrVec>(&result_.back().second);
 
-    const TSizeSizePrUInt64UMap& personAttributeCounts = this->bucketCounts(time);
+    const CPersonAttributeCounts& personAttributeCounts = this->bucketCounts(time);
     result.reserve(personAttributeCounts.size());
     for (const auto& count : personAttributeCounts) {
         result.emplace_back(CDataGatherer::extractPersonId(count),
@@ -1215,7 +1215,7 @@ void CEventRateBucketGatherer::personIndicator(model_t::EFeature feature,
     auto& result =
         *boost::unsafe_any_cast<TSizeFeatureDataPrVec>(&result_.back().second);
 
-    const TSizeSizePrUInt64UMap& personAttributeCounts = this->bucketCounts(time);
+    const CPersonAttributeCounts& personAttributeCounts = this->bucketCounts(time);
     result.reserve(personAttributeCounts.size());
     for (const auto& count : personAttributeCounts) {
         result.emplace_back(CDataGatherer::extractPersonId(count), 1);
@@ -1239,7 +1239,7 @@ void CEventRateBucketGatherer::nonZeroAttributeCounts(model_t::EFeature feature,
     auto& result =
         *boost::unsafe_any_cast<TSizeSizePrFeatureDataPrVec>(&result_.back().second);
 
-    const TSizeSizePrUInt64UMap& personAttributeCounts = this->bucketCounts(time);
+    const CPersonAttributeCounts& personAttributeCounts = this->bucketCounts(time);
     result.reserve(personAttributeCounts.size());
     for (const auto& count : personAttributeCounts) {
         if (CDataGatherer::extractData(count) > 0) {
@@ -1284,7 +1284,7 @@ void CEventRateBucketGatherer::attributeIndicator(model_t::EFeature feature,
     auto& result =
         *boost::unsafe_any_cast<TSizeSizePrFeatureDataPrVec>(&result_.back().second);
 
-    const TSizeSizePrUInt64UMap& counts = this->bucketCounts(time);
+    const CPersonAttributeCounts& counts = this->bucketCounts(time);
     result.reserve(counts.size());
     for (const auto& count : counts) {
         if (CDataGatherer::extractData(count) > 0) {
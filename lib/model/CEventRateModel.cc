@@ -7,8 +7,10 @@
 #include <model/CEventRateModel.h>
 
 #include <core/CContainerPrinter.h>
+#include <core/CFastMutex.h>
 #include <core/CFunctional.h>
 #include <core/CLogger.h>
+#include <core/CScopedFastLock.h>
 #include <core/CStatePersistInserter.h>
 #include <core/CStateRestoreTraverser.h>
 #include <core/CStatistics.h>
@@ -19,6 +21,7 @@
 #include <maths/COrderings.h>
 #include <maths/CPrior.h>
 #include <maths/CRestoreParams.h>
+#include <maths/CSampling.h>
 #include <maths/CTools.h>
 #include <maths/ProbabilityAggregators.h>
 
@@ -243,9 +246,11 @@ void CEventRateModel::sample(core_t::TTime startTime,
 
         this->CIndividualModel::sample(time, time + bucketLength, resourceMonitor);
 
-        // Declared outside the loop to minimize the number of times they are created.
-        maths::CModel::TTimeDouble2VecSizeTrVec values;
-        maths::CModelAddSamplesParams::TDouble2VecWeightsAryVec weights;
+        // People whose models were reset. The resets must be applied to
+        // the gatherer after the models have been sampled because this
+        // can happen concurrently.
+        TSizeVec resets;
+        core::CFastMutex resetsMutex;
 
         for (auto& featureData : m_CurrentBucketStats.s_FeatureData) {
             model_t::EFeature feature = featureData.first;
@@ -273,62 +278,75 @@ void CEventRateModel::sample(core_t::TTime startTime,
 
             this->applyFilter(model_t::E_XF_By, true, this->personFilter(), data);
 
-            for (const auto& data_ : data) {
-                std::size_t pid = data_.first;
+            this->sampleInShards(data.size(), [&](std::size_t begin, std::size_t end) {
+                // Declared outside the loop to minimize the number of times they are created.
+                maths::CModel::TTimeDouble2VecSizeTrVec values;
+                maths::CModelAddSamplesParams::TDouble2VecWeightsAryVec weights;
 
-                maths::CModel* model = this->model(feature, pid);
-                if (!model) {
-                    LOG_ERROR(<< "Missing model for " << this->personName(pid));
-                    continue;
-                }
+                for (std::size_t j = begin; j < end; ++j) {
+                    std::size_t pid = data[j].first;
+                    maths::CSampling::CScopeRandomNumberStream stream{
+                        sampleStream(feature, pid, time)};
 
-                core_t::TTime sampleTime = model_t::sampleTime(feature, time, bucketLength);
-                if (this->shouldIgnoreSample(feature, pid, model_t::INDIVIDUAL_ANALYSIS_ATTRIBUTE_ID,
-                                             sampleTime)) {
-                    model->skipTime(sampleTime - lastBucketTimesMap[pid]);
-                    continue;
-                }
+                    maths::CModel* model = this->writableModel(feature, pid);
+                    if (!model) {
+                        LOG_ERROR(<< "Missing model for " << this->personName(pid));
+                        continue;
+                    }
 
-                double emptyBucketWeight = this->emptyBucketWeight(feature, pid, time);
-                if (emptyBucketWeight == 0.0) {
-                    continue;
-                }
+                    core_t::TTime sampleTime = model_t::sampleTime(feature, time, bucketLength);
+                    if (this->shouldIgnoreSample(
+                            feature, pid, model_t::INDIVIDUAL_ANALYSIS_ATTRIBUTE_ID, sampleTime)) {
+                        model->skipTime(sampleTime - lastBucketTimesMap.at(pid));
+                        continue;
+                    }
+
+                    double emptyBucketWeight = this->emptyBucketWeight(feature, pid, time);
+                    if (emptyBucketWeight == 0.0) {
+                        continue;
+                    }
 
-                double count = model_t::offsetCountToZero(
-                    feature, static_cast<double>(data_.second.s_Count));
-                double derate = this->derate(pid, sampleTime);
-                double interval =
-                    (1.0 + (this->params().s_InitialDecayRateMultiplier - 1.0) * derate) *
-                    emptyBucketWeight;
-                double ceff = emptyBucketWeight * this->learnRate(feature);
-
-                LOG_TRACE(<< "Bucket = " << this->printCurrentBucket()
-                          << ", feature = " << model_t::print(feature) << ", count = "
-                          << count << ", person = " << this->personName(pid)
-                          << ", empty bucket weight = " << emptyBucketWeight
-                          << ", derate = " << derate << ", interval = " << interval);
-
-                model->params().probabilityBucketEmpty(
-                    this->probabilityBucketEmpty(feature, pid));
-
-                TDouble2Vec value{count};
-                values.assign(1, core::make_triple(sampleTime, value, model_t::INDIVIDUAL_ANALYSIS_ATTRIBUTE_ID));
-                weights.resize(1, maths_t::CUnitWeights::unit<TDouble2Vec>(dimension));
-                maths_t::setCount(TDouble2Vec(dimension, ceff), weights[0]);
-                maths_t::setWinsorisationWeight(
-                    model->winsorisationWeight(derate, sampleTime, value), weights[0]);
-
-                maths::CModelAddSamplesParams params;
-                params.integer(true)
-                    .nonNegative(true)
-                    .propagationInterval(interval)
-                    .trendWeights(weights)
-                    .priorWeights(weights);
-
-                if (model->addSamples(params, values) == maths::CModel::E_Reset) {
-                    gatherer.resetSampleCount(pid);
+                    double count = model_t::offsetCountToZero(
+                        feature, static_cast<double>(data[j].second.s_Count));
+                    double derate = this->derate(pid, sampleTime);
+                    double interval =
+                        (1.0 + (this->params().s_InitialDecayRateMultiplier - 1.0) * derate) *
+                        emptyBucketWeight;
+                    double ceff = emptyBucketWeight * this->learnRate(feature);
+
+                    LOG_TRACE(<< "Bucket = " << this->printCurrentBucket()
+                              << ", feature = " << model_t::print(feature) << ", count = "
+                              << count << ", person = " << this->personName(pid)
+                              << ", empty bucket weight = " << emptyBucketWeight
+                              << ", derate = " << derate << ", interval = " << interval);
+
+                    model->params().probabilityBucketEmpty(
+                        this->probabilityBucketEmpty(feature, pid));
+
+                    TDouble2Vec value{count};
+                    values.assign(1, core::make_triple(sampleTime, value, model_t::INDIVIDUAL_ANALYSIS_ATTRIBUTE_ID));
+                    weights.resize(1, maths_t::CUnitWeights::unit<TDouble2Vec>(dimension));
+                    maths_t::setCount(TDouble2Vec(dimension, ceff), weights[0]);
+                    maths_t::setWinsorisationWeight(
+                        model->winsorisationWeight(derate, sampleTime, value), weights[0]);
+
+                    maths::CModelAddSamplesParams params;
+                    params.integer(true)
+                        .nonNegative(true)
+                        .propagationInterval(interval)
+                        .trendWeights(weights)
+                        .priorWeights(weights);
+
+                    if (model->addSamples(params, values) == maths::CModel::E_Reset) {
+                        core::CScopedFastLock lock(resetsMutex);
+                        resets.push_back(pid);
+                    }
                 }
-            }
+            });
+        }
+
+        for (auto pid : resets) {
+            gatherer.resetSampleCount(pid);
         }
 
         this->sampleCorrelateModels();
@@ -392,6 +410,10 @@ bool CEventRateModel::computeProbability(std::size_t pid,
 
         LOG_TRACE(<< "Compute probability for " << data->print());
 
+        // Computing the probability updates the anomaly model so the model
+        // mustn't be shared with a clone for persistence.
+        this->writableModel(feature, pid);
+
         if (this->correlates(feature, pid, startTime)) {
             CProbabilityAndInfluenceCalculator::SCorrelateParams params(partitioningFields);
             TStrCRefDouble1VecDouble1VecPrPrVecVecVec influenceValues;
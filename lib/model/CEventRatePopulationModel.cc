@@ -148,12 +148,24 @@ CEventRatePopulationModel::CEventRatePopulationModel(bool isForPersistence,
         LOG_ABORT(<< "This constructor only creates clones for persistence");
     }
 
-    m_FeatureModels.reserve(m_FeatureModels.size());
+    // The models are shared with the clone and copied on write. However,
+    // models of correlated features register themselves with the live
+    // correlations object so these are copied up front.
+    m_FeatureModels.reserve(other.m_FeatureModels.size());
     for (const auto& feature : other.m_FeatureModels) {
+        bool correlated{std::any_of(other.m_FeatureCorrelatesModels.begin(),
+                                    other.m_FeatureCorrelatesModels.end(),
+                                    [&feature](const SFeatureCorrelateModels& correlates) {
+                                        return correlates.s_Feature == feature.s_Feature;
+                                    })};
         m_FeatureModels.emplace_back(feature.s_Feature, feature.s_NewModel);
-        m_FeatureModels.back().s_Models.reserve(feature.s_Models.size());
-        for (const auto& model : feature.s_Models) {
-            m_FeatureModels.back().s_Models.emplace_back(model->cloneForPersistence());
+        if (correlated) {
+            m_FeatureModels.back().s_Models.reserve(feature.s_Models.size());
+            for (const auto& model : feature.s_Models) {
+                m_FeatureModels.back().s_Models.emplace_back(model->cloneForPersistence());
+            }
+        } else {
+            m_FeatureModels.back().s_Models = feature.s_Models;
         }
     }
 
@@ -416,7 +428,7 @@ void CEventRatePopulationModel::sample(core_t::TTime startTime,
                 std::size_t pid = CDataGatherer::extractPersonId(data_);
                 std::size_t cid = CDataGatherer::extractAttributeId(data_);
 
-                maths::CModel* model{this->model(feature, cid)};
+                const maths::CModel* model{this->model(feature, cid)};
                 if (!model) {
                     LOG_ERROR(<< "Missing model for " << this->attributeName(cid));
                     continue;
@@ -424,7 +436,7 @@ void CEventRatePopulationModel::sample(core_t::TTime startTime,
                 if (this->shouldIgnoreSample(feature, pid, cid, sampleTime)) {
                     core_t::TTime skipTime = sampleTime - attributeLastBucketTimesMap[cid];
                     if (skipTime > 0) {
-                        model->skipTime(skipTime);
+                        this->writableModel(feature, cid)->skipTime(skipTime);
                         // Update the last time so we don't advance the same model
                         // multiple times (once per person)
                         attributeLastBucketTimesMap[cid] = sampleTime;
@@ -466,7 +478,7 @@ void CEventRatePopulationModel::sample(core_t::TTime startTime,
                     .propagationInterval(this->propagationTime(cid, sampleTime))
                     .trendWeights(attribute.second.s_Weights)
                     .priorWeights(attribute.second.s_Weights);
-                maths::CModel* model{this->model(feature, cid)};
+                maths::CModel* model{this->writableModel(feature, cid)};
                 if (model->addSamples(params, attribute.second.s_Values) ==
                     maths::CModel::E_Reset) {
                     gatherer.resetSampleCount(cid);
@@ -613,6 +625,10 @@ bool CEventRatePopulationModel::computeProbability(std::size_t pid,
 
             partitioningFields.back().second = TStrCRef(gatherer.attributeName(cid));
 
+            // Computing the probability updates the anomaly model so the
+            // model mustn't be shared with a clone for persistence.
+            this->writableModel(feature, cid);
+
             if (this->correlates(feature, pid, cid, startTime)) {
                 // TODO
             } else {
@@ -824,6 +840,14 @@ std::size_t CEventRatePopulationModel::memoryUsage() const {
     return estimate ? estimate.get() : this->computeMemoryUsage();
 }
 
+std::size_t CEventRatePopulationModel::sharedMemoryUsage() const {
+    std::size_t mem{0};
+    for (const auto& feature : m_FeatureModels) {
+        mem += feature.sharedMemoryUsage();
+    }
+    return mem;
+}
+
 std::size_t CEventRatePopulationModel::computeMemoryUsage() const {
     std::size_t mem = this->CPopulationModel::memoryUsage();
     mem += core::CMemory::dynamicSize(m_CurrentBucketStats.s_PersonCounts);
@@ -886,7 +910,9 @@ void CEventRatePopulationModel::createNewModels(std::size_t n, std::size_t m) {
     if (m > 0) {
         for (auto& feature : m_FeatureModels) {
             std::size_t newM = feature.s_Models.size() + m;
+            std::size_t before{feature.s_Models.capacity() * sizeof(TMathsModelSPtr)};
             core::CAllocationStrategy::reserve(feature.s_Models, newM);
+            std::size_t after{feature.s_Models.capacity() * sizeof(TMathsModelSPtr)};
             for (std::size_t cid = feature.s_Models.size(); cid < newM; ++cid) {
                 feature.s_Models.emplace_back(feature.s_NewModel->clone(cid));
                 for (const auto& correlates : m_FeatureCorrelatesModels) {
@@ -894,7 +920,9 @@ void CEventRatePopulationModel::createNewModels(std::size_t n, std::size_t m) {
                         feature.s_Models.back()->modelCorrelations(*correlates.s_Models);
                     }
                 }
+                after += core::CMemory::dynamicSize(feature.s_Models.back());
             }
+            this->recordMemoryUsageChange(before, after);
         }
     }
     this->CPopulationModel::createNewModels(n, m);
@@ -905,12 +933,15 @@ void CEventRatePopulationModel::updateRecycledModels() {
     for (auto cid : gatherer.recycledAttributeIds()) {
         for (auto& feature : m_FeatureModels) {
             if (cid < feature.s_Models.size()) {
+                std::size_t before{core::CMemory::dynamicSize(feature.s_Models[cid])};
                 feature.s_Models[cid].reset(feature.s_NewModel->clone(cid));
                 for (const auto& correlates : m_FeatureCorrelatesModels) {
                     if (feature.s_Feature == correlates.s_Feature) {
                         feature.s_Models.back()->modelCorrelations(*correlates.s_Models);
                     }
                 }
+                this->recordMemoryUsageChange(
+                    before, core::CMemory::dynamicSize(feature.s_Models[cid]));
             }
         }
     }
@@ -938,7 +969,10 @@ void CEventRatePopulationModel::clearPrunedResources(const TSizeVec& /*people*/,
     for (auto cid : attributes) {
         for (auto& feature : m_FeatureModels) {
             if (cid < feature.s_Models.size()) {
+                std::size_t before{core::CMemory::dynamicSize(feature.s_Models[cid])};
                 feature.s_Models[cid].reset(this->tinyModel());
+                this->recordMemoryUsageChange(
+                    before, core::CMemory::dynamicSize(feature.s_Models[cid]));
             }
         }
     }
@@ -951,8 +985,8 @@ const CInterimBucketCorrector& CEventRatePopulationModel::interimValueCorrector(
 void CEventRatePopulationModel::doSkipSampling(core_t::TTime startTime, core_t::TTime endTime) {
     core_t::TTime gap = endTime - startTime;
     for (auto& feature : m_FeatureModels) {
-        for (auto& model : feature.s_Models) {
-            model->skipTime(gap);
+        for (std::size_t cid = 0u; cid < feature.s_Models.size(); ++cid) {
+            feature.writableModel(cid)->skipTime(gap);
         }
     }
     this->CPopulationModel::doSkipSampling(startTime, endTime);
@@ -960,16 +994,22 @@ void CEventRatePopulationModel::doSkipSampling(core_t::TTime startTime, core_t::
 
 const maths::CModel* CEventRatePopulationModel::model(model_t::EFeature feature,
                                                       std::size_t cid) const {
-    return const_cast<CEventRatePopulationModel*>(this)->model(feature, cid);
+    auto i = std::find_if(m_FeatureModels.begin(), m_FeatureModels.end(),
+                          [feature](const SFeatureModels& model) {
+                              return model.s_Feature == feature;
+                          });
+    return i != m_FeatureModels.end() && cid < i->s_Models.size()
+               ? i->s_Models[cid].get()
+               : nullptr;
 }
 
-maths::CModel* CEventRatePopulationModel::model(model_t::EFeature feature, std::size_t cid) {
+maths::CModel* CEventRatePopulationModel::writableModel(model_t::EFeature feature, std::size_t cid) const {
     auto i = std::find_if(m_FeatureModels.begin(), m_FeatureModels.end(),
                           [feature](const SFeatureModels& model) {
                               return model.s_Feature == feature;
                           });
     return i != m_FeatureModels.end() && cid < i->s_Models.size()
-               ? i->s_Models[cid].get()
+               ? i->writableModel(cid)
                : nullptr;
 }
 
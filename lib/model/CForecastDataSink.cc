@@ -191,6 +191,10 @@ uint64_t CForecastDataSink::numRecordsWritten() const {
     return m_NumRecordsWritten;
 }
 
+void CForecastDataSink::addNumRecordsWritten(uint64_t numRecords) {
+    m_NumRecordsWritten += numRecords;
+}
+
 void CForecastDataSink::push(const maths::SErrorBar errorBar,
                              const std::string& feature,
                              const std::string& partitionFieldName,
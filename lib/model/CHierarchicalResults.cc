@@ -555,6 +555,17 @@ void CHierarchicalResults::addInfluencer(const std::string& name) {
     this->newPivotRoot(CStringStore::influencers().get(name));
 }
 
+void CHierarchicalResults::merge(CHierarchicalResults& other) {
+    for (auto& node : other.m_Nodes) {
+        this->newNode().swap(node);
+    }
+    for (const auto& root : other.m_PivotRootNodes) {
+        this->newPivotRoot(root.first);
+    }
+    other.m_Nodes.clear();
+    other.m_PivotRootNodes.clear();
+}
+
 void CHierarchicalResults::buildHierarchy() {
     using TNodePtrVec = std::vector<SNode*>;
 
@@ -9,7 +9,9 @@
 #include <core/CAllocationStrategy.h>
 #include <core/CContainerPrinter.h>
 #include <core/CFunctional.h>
+#include <core/CHashing.h>
 #include <core/CLogger.h>
+#include <core/CStaticThreadPool.h>
 #include <core/CStatistics.h>
 #include <core/Constants.h>
 #include <core/RestoreMacros.h>
@@ -18,6 +20,7 @@
 #include <maths/CMultivariatePrior.h>
 #include <maths/COrderings.h>
 #include <maths/CPrior.h>
+#include <maths/CSampling.h>
 #include <maths/CTimeSeriesDecomposition.h>
 
 #include <model/CAnnotatedProbabilityBuilder.h>
@@ -56,6 +59,13 @@ void hashActive(const CDataGatherer& gatherer,
 
 const std::size_t CHUNK_SIZE = 500u;
 
+//! The minimum number of people to sample in a shard. This keeps the
+//! cost of scheduling small compared to the cost of the updates.
+const std::size_t MINIMUM_SHARD_SIZE = 128u;
+
+//! The number of shards per thread, which balances uneven update costs.
+const std::size_t SHARDS_PER_THREAD = 4u;
+
 // We use short field names to reduce the state size
 const std::string WINDOW_BUCKET_COUNT_TAG("a");
 const std::string PERSON_BUCKET_COUNT_TAG("b");
@@ -110,12 +120,24 @@ CIndividualModel::CIndividualModel(bool isForPersistence, const CIndividualModel
         LOG_ABORT(<< "This constructor only creates clones for persistence");
     }
 
-    m_FeatureModels.reserve(m_FeatureModels.size());
+    // The models are shared with the clone and copied on write. However,
+    // models of correlated features register themselves with the live
+    // correlations object so these are copied up front.
+    m_FeatureModels.reserve(other.m_FeatureModels.size());
     for (const auto& feature : other.m_FeatureModels) {
+        bool correlated{std::any_of(other.m_FeatureCorrelatesModels.begin(),
+                                    other.m_FeatureCorrelatesModels.end(),
+                                    [&feature](const SFeatureCorrelateModels& correlates) {
+                                        return correlates.s_Feature == feature.s_Feature;
+                                    })};
         m_FeatureModels.emplace_back(feature.s_Feature, feature.s_NewModel);
-        m_FeatureModels.back().s_Models.reserve(feature.s_Models.size());
-        for (const auto& model : feature.s_Models) {
-            m_FeatureModels.back().s_Models.emplace_back(model->cloneForPersistence());
+        if (correlated) {
+            m_FeatureModels.back().s_Models.reserve(feature.s_Models.size());
+            for (const auto& model : feature.s_Models) {
+                m_FeatureModels.back().s_Models.emplace_back(model->cloneForPersistence());
+            }
+        } else {
+            m_FeatureModels.back().s_Models = feature.s_Models;
         }
     }
 
@@ -315,6 +337,14 @@ std::size_t CIndividualModel::memoryUsage() const {
     return estimate ? estimate.get() : this->computeMemoryUsage();
 }
 
+std::size_t CIndividualModel::sharedMemoryUsage() const {
+    std::size_t mem{0};
+    for (const auto& feature : m_FeatureModels) {
+        mem += feature.sharedMemoryUsage();
+    }
+    return mem;
+}
+
 std::size_t CIndividualModel::computeMemoryUsage() const {
     std::size_t mem = this->CAnomalyDetectorModel::memoryUsage();
     mem += core::CMemory::dynamicSize(m_FirstBucketTimes);
@@ -445,13 +475,19 @@ void CIndividualModel::createUpdateNewModels(core_t::TTime time,
 
 void CIndividualModel::createNewModels(std::size_t n, std::size_t m) {
     if (n > 0) {
+        std::size_t before{core::CMemory::dynamicSize(m_FirstBucketTimes) +
+                           core::CMemory::dynamicSize(m_LastBucketTimes)};
         std::size_t newN = m_FirstBucketTimes.size() + n;
         core::CAllocationStrategy::resize(m_FirstBucketTimes, newN,
                                           CAnomalyDetectorModel::TIME_UNSET);
         core::CAllocationStrategy::resize(m_LastBucketTimes, newN,
                                           CAnomalyDetectorModel::TIME_UNSET);
+        std::size_t after{core::CMemory::dynamicSize(m_FirstBucketTimes) +
+                          core::CMemory::dynamicSize(m_LastBucketTimes)};
         for (auto& feature : m_FeatureModels) {
+            before += feature.s_Models.capacity() * sizeof(TMathsModelSPtr);
             core::CAllocationStrategy::reserve(feature.s_Models, newN);
+            after += feature.s_Models.capacity() * sizeof(TMathsModelSPtr);
             for (std::size_t pid = feature.s_Models.size(); pid < newN; ++pid) {
                 feature.s_Models.emplace_back(feature.s_NewModel->clone(pid));
                 for (const auto& correlates : m_FeatureCorrelatesModels) {
@@ -459,8 +495,10 @@ void CIndividualModel::createNewModels(std::size_t n, std::size_t m) {
                         feature.s_Models.back()->modelCorrelations(*correlates.s_Models);
                     }
                 }
+                after += core::CMemory::dynamicSize(feature.s_Models.back());
             }
         }
+        this->recordMemoryUsageChange(before, after);
     }
     this->CAnomalyDetectorModel::createNewModels(n, m);
 }
@@ -471,12 +509,15 @@ void CIndividualModel::updateRecycledModels() {
             m_FirstBucketTimes[pid] = CAnomalyDetectorModel::TIME_UNSET;
             m_LastBucketTimes[pid] = CAnomalyDetectorModel::TIME_UNSET;
             for (auto& feature : m_FeatureModels) {
+                std::size_t before{core::CMemory::dynamicSize(feature.s_Models[pid])};
                 feature.s_Models[pid].reset(feature.s_NewModel->clone(pid));
                 for (const auto& correlates : m_FeatureCorrelatesModels) {
                     if (feature.s_Feature == correlates.s_Feature) {
                         feature.s_Models.back()->modelCorrelations(*correlates.s_Models);
                     }
                 }
+                this->recordMemoryUsageChange(
+                    before, core::CMemory::dynamicSize(feature.s_Models[pid]));
             }
         }
     }
@@ -504,7 +545,10 @@ void CIndividualModel::clearPrunedResources(const TSizeVec& people,
     for (auto pid : people) {
         for (auto& feature : m_FeatureModels) {
             if (pid < feature.s_Models.size()) {
+                std::size_t before{core::CMemory::dynamicSize(feature.s_Models[pid])};
                 feature.s_Models[pid].reset(this->tinyModel());
+                this->recordMemoryUsageChange(
+                    before, core::CMemory::dynamicSize(feature.s_Models[pid]));
             }
         }
     }
@@ -538,16 +582,22 @@ double CIndividualModel::probabilityBucketEmpty(model_t::EFeature feature,
 }
 
 const maths::CModel* CIndividualModel::model(model_t::EFeature feature, std::size_t pid) const {
-    return const_cast<CIndividualModel*>(this)->model(feature, pid);
+    auto i = std::find_if(m_FeatureModels.begin(), m_FeatureModels.end(),
+                          [feature](const SFeatureModels& model) {
+                              return model.s_Feature == feature;
+                          });
+    return i != m_FeatureModels.end() && pid < i->s_Models.size()
+               ? i->s_Models[pid].get()
+               : nullptr;
 }
 
-maths::CModel* CIndividualModel::model(model_t::EFeature feature, std::size_t pid) {
+maths::CModel* CIndividualModel::writableModel(model_t::EFeature feature, std::size_t pid) const {
     auto i = std::find_if(m_FeatureModels.begin(), m_FeatureModels.end(),
                           [feature](const SFeatureModels& model) {
                               return model.s_Feature == feature;
                           });
     return i != m_FeatureModels.end() && pid < i->s_Models.size()
-               ? i->s_Models[pid].get()
+               ? i->writableModel(pid)
                : nullptr;
 }
 
@@ -557,6 +607,41 @@ void CIndividualModel::sampleCorrelateModels() {
     }
 }
 
+void CIndividualModel::sampleInShards(std::size_t n, const TSizeSizeFunc& f) const {
+    core::CStaticThreadPool* threadPool = this->params().s_ThreadPool;
+    if (threadPool == nullptr || threadPool->size() == 0 ||
+        n < 2 * MINIMUM_SHARD_SIZE || m_FeatureCorrelatesModels.size() > 0) {
+        f(0, n);
+        return;
+    }
+
+    std::size_t shards = std::min(n / MINIMUM_SHARD_SIZE,
+                                  SHARDS_PER_THREAD * (threadPool->size() + 1));
+    LOG_TRACE(<< "Sampling " << n << " people in " << shards << " shards");
+    TOptionalUInt64 stream{maths::CSampling::CScopeRandomNumberStream::current()};
+    threadPool->parallelForEach(shards, [n, shards, stream, &f](std::size_t i) {
+        std::size_t begin{(i * n) / shards};
+        std::size_t end{((i + 1) * n) / shards};
+        if (stream) {
+            maths::CSampling::CScopeRandomNumberStream scopeStream{*stream};
+            f(begin, end);
+        } else {
+            f(begin, end);
+        }
+    });
+}
+
+uint64_t CIndividualModel::sampleStream(model_t::EFeature feature,
+                                        std::size_t pid,
+                                        core_t::TTime time) {
+    TOptionalUInt64 stream{maths::CSampling::CScopeRandomNumberStream::current()};
+    uint64_t seed{stream ? core::CHashing::hashCombine(*stream, static_cast<uint64_t>(feature))
+                         : static_cast<uint64_t>(feature)};
+    return core::CHashing::hashCombine(
+        seed, core::CHashing::hashCombine(static_cast<uint64_t>(pid),
+                                          static_cast<uint64_t>(time)));
+}
+
 void CIndividualModel::correctBaselineForInterim(model_t::EFeature feature,
                                                  std::size_t pid,
                                                  model_t::CResultType type,
@@ -624,8 +709,8 @@ void CIndividualModel::doSkipSampling(core_t::TTime startTime, core_t::TTime end
     }
 
     for (auto& feature : m_FeatureModels) {
-        for (auto& model : feature.s_Models) {
-            model->skipTime(gap);
+        for (std::size_t pid = 0u; pid < feature.s_Models.size(); ++pid) {
+            feature.writableModel(pid)->skipTime(gap);
         }
     }
 }
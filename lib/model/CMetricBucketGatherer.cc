@@ -24,11 +24,11 @@
 
 #include <boost/any.hpp>
 #include <boost/ref.hpp>
-#include <boost/tuple/tuple.hpp>
 #include <boost/unordered_map.hpp>
 
-#include <atomic>
+#include <algorithm>
 #include <map>
+#include <numeric>
 #include <utility>
 #include <vector>
 
@@ -46,49 +46,17 @@ using TStrCRefStrCRefPr = std::pair<TStrCRef, TStrCRef>;
 using TStrCRefStrCRefPrUInt64Map =
     std::map<TStrCRefStrCRefPr, uint64_t, maths::COrderings::SLexicographicalCompare>;
 using TSampleVec = std::vector<CSample>;
-using TSizeMeanGathererUMap = boost::unordered_map<std::size_t, CGathererTools::TMeanGatherer>;
-using TSizeSizeMeanGathererUMapUMap = boost::unordered_map<std::size_t, TSizeMeanGathererUMap>;
-using TSizeMedianGathererUMap =
-    boost::unordered_map<std::size_t, CGathererTools::TMedianGatherer>;
-using TSizeSizeMedianGathererUMapUMap = boost::unordered_map<std::size_t, TSizeMedianGathererUMap>;
-using TSizeMinGathererUMap = boost::unordered_map<std::size_t, CGathererTools::TMinGatherer>;
-using TSizeSizeMinGathererUMapUMap = boost::unordered_map<std::size_t, TSizeMinGathererUMap>;
-using TSizeMaxGathererUMap = boost::unordered_map<std::size_t, CGathererTools::TMaxGatherer>;
-using TSizeSizeMaxGathererUMapUMap = boost::unordered_map<std::size_t, TSizeMaxGathererUMap>;
-using TSizeVarianceGathererUMap =
-    boost::unordered_map<std::size_t, CGathererTools::TVarianceGatherer>;
-using TSizeSizeVarianceGathererUMapUMap =
-    boost::unordered_map<std::size_t, TSizeVarianceGathererUMap>;
-using TSizeSumGathererUMap = boost::unordered_map<std::size_t, CGathererTools::CSumGatherer>;
-using TSizeSizeSumGathererUMapUMap = boost::unordered_map<std::size_t, TSizeSumGathererUMap>;
-using TSizeMultivariateMeanGathererUMap =
-    boost::unordered_map<std::size_t, CGathererTools::TMultivariateMeanGatherer>;
-using TSizeSizeMultivariateMeanGathererUMapUMap =
-    boost::unordered_map<std::size_t, TSizeMultivariateMeanGathererUMap>;
-using TSizeMultivariateMinGathererUMap =
-    boost::unordered_map<std::size_t, CGathererTools::TMultivariateMinGatherer>;
-using TSizeSizeMultivariateMinGathererUMapUMap =
-    boost::unordered_map<std::size_t, TSizeMultivariateMinGathererUMap>;
-using TSizeMultivariateMaxGathererUMap =
-    boost::unordered_map<std::size_t, CGathererTools::TMultivariateMaxGatherer>;
-using TSizeSizeMultivariateMaxGathererUMapUMap =
-    boost::unordered_map<std::size_t, TSizeMultivariateMaxGathererUMap>;
 using TSizeFeatureDataPr = std::pair<std::size_t, SMetricFeatureData>;
 using TSizeFeatureDataPrVec = std::vector<TSizeFeatureDataPr>;
 using TSizeSizePrFeatureDataPr = std::pair<TSizeSizePr, SMetricFeatureData>;
 using TSizeSizePrFeatureDataPrVec = std::vector<TSizeSizePrFeatureDataPr>;
-using TSizeSizePrUInt64UMap = CMetricBucketGatherer::TSizeSizePrUInt64UMap;
+using TSizeVecCItr = TSizeVec::const_iterator;
+using TSizeSizeUMap = boost::unordered_map<std::size_t, std::size_t>;
 using TCategorySizePr = CMetricBucketGatherer::TCategorySizePr;
-using TCategorySizePrAnyMap = CMetricBucketGatherer::TCategorySizePrAnyMap;
-using TCategorySizePrAnyMapItr = CMetricBucketGatherer::TCategorySizePrAnyMapItr;
-using TCategorySizePrAnyMapCItr = CMetricBucketGatherer::TCategorySizePrAnyMapCItr;
+using TGatherers = CMetricBucketGatherer::TGatherers;
+using TCategorySizePrGatherersMap = CMetricBucketGatherer::TCategorySizePrGatherersMap;
 using TStoredStringPtrVec = CBucketGatherer::TStoredStringPtrVec;
 
-template<typename T>
-using TSizeTUMap = boost::unordered_map<std::size_t, T>;
-template<typename T>
-using TSizeSizeTUMapUMap = boost::unordered_map<std::size_t, TSizeTUMap<T>>;
-
 const std::string CURRENT_VERSION("1");
 
 // We use short field names to reduce the state size
@@ -125,136 +93,95 @@ template<model_t::EMetricCategory>
 struct SDataType {};
 template<>
 struct SDataType<model_t::E_Mean> {
-    using Type = TSizeSizeMeanGathererUMapUMap;
+    using Type = CMetricBucketGatherer::TMeanGatherers;
 };
 template<>
 struct SDataType<model_t::E_Median> {
-    using Type = TSizeSizeMedianGathererUMapUMap;
+    using Type = CMetricBucketGatherer::TMedianGatherers;
 };
 template<>
 struct SDataType<model_t::E_Min> {
-    using Type = TSizeSizeMinGathererUMapUMap;
+    using Type = CMetricBucketGatherer::TMinGatherers;
 };
 template<>
 struct SDataType<model_t::E_Max> {
-    using Type = TSizeSizeMaxGathererUMapUMap;
+    using Type = CMetricBucketGatherer::TMaxGatherers;
 };
 template<>
 struct SDataType<model_t::E_Sum> {
-    using Type = TSizeSizeSumGathererUMapUMap;
+    using Type = CMetricBucketGatherer::TSumGatherers;
 };
 template<>
 struct SDataType<model_t::E_Variance> {
-    using Type = TSizeSizeVarianceGathererUMapUMap;
+    using Type = CMetricBucketGatherer::TVarianceGatherers;
 };
 template<>
 struct SDataType<model_t::E_MultivariateMean> {
-    using Type = TSizeSizeMultivariateMeanGathererUMapUMap;
+    using Type = CMetricBucketGatherer::TMultivariateMeanGatherers;
 };
 template<>
 struct SDataType<model_t::E_MultivariateMin> {
-    using Type = TSizeSizeMultivariateMinGathererUMapUMap;
+    using Type = CMetricBucketGatherer::TMultivariateMinGatherers;
 };
 template<>
 struct SDataType<model_t::E_MultivariateMax> {
-    using Type = TSizeSizeMultivariateMaxGathererUMapUMap;
-};
-template<typename ITR, typename T>
-struct SMaybeConst {};
-template<typename T>
-struct SMaybeConst<TCategorySizePrAnyMapItr, T> {
-    using Type = T;
-};
-template<typename T>
-struct SMaybeConst<TCategorySizePrAnyMapCItr, T> {
-    using Type = const T;
+    using Type = CMetricBucketGatherer::TMultivariateMaxGatherers;
 };
 
-//! Register the callbacks for computing the size of feature data gatherers
-//! with \p visitor.
-template<typename VISITOR>
-void registerMemoryCallbacks(VISITOR& visitor) {
-    visitor.template registerCallback<TSizeSizeMeanGathererUMapUMap>();
-    visitor.template registerCallback<TSizeSizeMedianGathererUMapUMap>();
-    visitor.template registerCallback<TSizeSizeMinGathererUMapUMap>();
-    visitor.template registerCallback<TSizeSizeMaxGathererUMapUMap>();
-    visitor.template registerCallback<TSizeSizeVarianceGathererUMapUMap>();
-    visitor.template registerCallback<TSizeSizeSumGathererUMapUMap>();
-    visitor.template registerCallback<TSizeSizeMultivariateMeanGathererUMapUMap>();
-    visitor.template registerCallback<TSizeSizeMultivariateMinGathererUMapUMap>();
-    visitor.template registerCallback<TSizeSizeMultivariateMaxGathererUMapUMap>();
-}
+//! \brief Visitor which applies a function to the gatherers of one
+//! metric category.
+template<typename F>
+class CApply : public boost::static_visitor<void> {
+public:
+    CApply(const TCategorySizePr& category, const F& f)
+        : m_Category(category), m_F(f) {}
 
-//! Register the callbacks for computing the size of feature data gatherers.
-void registerMemoryCallbacks() {
-    static std::atomic_flag once = ATOMIC_FLAG_INIT;
-    if (once.test_and_set() == false) {
-        registerMemoryCallbacks(core::CMemory::anyVisitor());
-        registerMemoryCallbacks(core::CMemoryDebug::anyVisitor());
+    template<typename T>
+    void operator()(T& gatherers) const {
+        m_F(m_Category, gatherers);
     }
-}
 
-//! Apply a function \p f to a gatherer held as a value by map entry \p i
-//! of an explicit metric category
-template<model_t::EMetricCategory CATEGORY, typename ITR, typename F>
-void apply(ITR i, const F& f) {
-    using TDataType = typename SDataType<CATEGORY>::Type;
-    f(i->first, boost::any_cast<typename SMaybeConst<ITR, TDataType>::Type&>(i->second));
-}
+private:
+    const TCategorySizePr& m_Category;
+    const F& m_F;
+};
+
+//! \brief Visitor which gets the memory used by the gatherers of one
+//! metric category.
+struct SMemoryUsage : public boost::static_visitor<std::size_t> {
+    template<typename T>
+    std::size_t operator()(const T& gatherers) const {
+        return gatherers.memoryUsage();
+    }
+};
+
+//! \brief Visitor which debugs the memory used by the gatherers of one
+//! metric category.
+struct SDebugMemoryUsage : public boost::static_visitor<void> {
+    template<typename T>
+    void operator()(core::CMemoryUsage::TMemoryUsagePtr mem, const T& gatherers) const {
+        gatherers.debugMemoryUsage(mem->addChild());
+    }
+};
 
 //! Apply a function \p f to all the gatherers held in [\p begin, \p end).
 template<typename ITR, typename F>
-bool apply(ITR begin, ITR end, const F& f) {
+void apply(ITR begin, ITR end, const F& f) {
     for (ITR i = begin; i != end; ++i) {
-        model_t::EMetricCategory category = i->first.first;
-        try {
-            switch (category) {
-            case model_t::E_Mean:
-                apply<model_t::E_Mean>(i, f);
-                break;
-            case model_t::E_Median:
-                apply<model_t::E_Median>(i, f);
-                break;
-            case model_t::E_Min:
-                apply<model_t::E_Min>(i, f);
-                break;
-            case model_t::E_Max:
-                apply<model_t::E_Max>(i, f);
-                break;
-            case model_t::E_Variance:
-                apply<model_t::E_Variance>(i, f);
-                break;
-            case model_t::E_Sum:
-                apply<model_t::E_Sum>(i, f);
-                break;
-            case model_t::E_MultivariateMean:
-                apply<model_t::E_MultivariateMean>(i, f);
-                break;
-            case model_t::E_MultivariateMin:
-                apply<model_t::E_MultivariateMin>(i, f);
-                break;
-            case model_t::E_MultivariateMax:
-                apply<model_t::E_MultivariateMax>(i, f);
-                break;
-            }
-        } catch (const std::exception& e) {
-            LOG_ERROR(<< "Apply failed for " << category << ": " << e.what());
-            return false;
-        }
+        boost::apply_visitor(CApply<F>(i->first, f), i->second);
     }
-
-    return true;
 }
 
 //! Apply a function \p f to all the gatherers held in \p data.
 template<typename T, typename F>
-bool apply(T& data, const F& f) {
-    return apply(data.begin(), data.end(), f);
+void apply(T& data, const F& f) {
+    apply(data.begin(), data.end(), f);
 }
 
 //! Initialize feature data for a specific category
 template<model_t::EMetricCategory CATEGORY>
-void initializeFeatureDataInstance(std::size_t dimension, TCategorySizePrAnyMap& featureData) {
+void initializeFeatureDataInstance(std::size_t dimension,
+                                   TCategorySizePrGatherersMap& featureData) {
     using Type = typename SDataType<CATEGORY>::Type;
     featureData[{CATEGORY, dimension}] = Type();
 }
@@ -264,7 +191,7 @@ class CPersistFeatureData {
 public:
     template<typename T>
     void operator()(const TCategorySizePr& category,
-                    const TSizeSizeTUMapUMap<T>& data,
+                    const CPersonAttributeGatherers<T>& data,
                     core::CStatePersistInserter& inserter) const {
         if (data.empty()) {
             inserter.insertValue(this->tagName(category), EMPTY_STRING);
@@ -305,47 +232,41 @@ private:
 
     struct SDoPersist {
         template<typename T>
-        void operator()(const TSizeSizeTUMapUMap<T>& data,
+        void operator()(const CPersonAttributeGatherers<T>& data,
                         core::CStatePersistInserter& inserter) const {
-            using TSizeSizeTUMapUMapCItr = typename TSizeSizeTUMapUMap<T>::const_iterator;
-            std::vector<TSizeSizeTUMapUMapCItr> dataItrs;
-            dataItrs.reserve(data.size());
-            for (auto i = data.cbegin(); i != data.cend(); ++i) {
-                dataItrs.push_back(i);
-            }
-            std::sort(dataItrs.begin(), dataItrs.end(),
-                      [](TSizeSizeTUMapUMapCItr lhs, TSizeSizeTUMapUMapCItr rhs) {
-                          return lhs->first < rhs->first;
+            // Persist the gatherers grouped by attribute in the order of
+            // attribute then person identifier.
+            TSizeVec positions(data.size());
+            std::iota(positions.begin(), positions.end(), 0);
+            std::sort(positions.begin(), positions.end(),
+                      [&data](std::size_t lhs, std::size_t rhs) {
+                          return std::make_pair(data.key(lhs).second, data.key(lhs).first) <
+                                 std::make_pair(data.key(rhs).second, data.key(rhs).first);
                       });
 
-            for (auto itr : dataItrs) {
+            for (TSizeVecCItr i = positions.begin(); i != positions.end(); /**/) {
+                std::size_t cid{data.key(*i).second};
+                TSizeVecCItr end{std::find_if(i, positions.cend(), [&data, cid](std::size_t j) {
+                    return data.key(j).second != cid;
+                })};
                 inserter.insertLevel(ATTRIBUTE_TAG,
-                                     boost::bind<void>(SDoPersist(), itr->first,
-                                                       boost::cref(itr->second), _1));
+                                     boost::bind<void>(SDoPersist(), cid, boost::cref(data),
+                                                       i, end, _1));
+                i = end;
             }
         }
 
         template<typename T>
         void operator()(std::size_t cid,
-                        const TSizeTUMap<T>& pidMap,
+                        const CPersonAttributeGatherers<T>& data,
+                        TSizeVecCItr begin,
+                        TSizeVecCItr end,
                         core::CStatePersistInserter& inserter) const {
             inserter.insertValue(ATTRIBUTE_TAG, cid);
-
-            using TSizeTUMapCItr = typename TSizeTUMap<T>::const_iterator;
-            std::vector<TSizeTUMapCItr> pidItrs;
-            pidItrs.reserve(pidMap.size());
-            for (auto i = pidMap.cbegin(); i != pidMap.cend(); ++i) {
-                pidItrs.push_back(i);
-            }
-            std::sort(pidItrs.begin(), pidItrs.end(),
-                      [](TSizeTUMapCItr lhs, TSizeTUMapCItr rhs) {
-                          return lhs->first < rhs->first;
-                      });
-
-            for (auto itr : pidItrs) {
+            for (auto i = begin; i != end; ++i) {
                 inserter.insertLevel(
-                    PERSON_TAG, boost::bind<void>(SDoPersist(), itr->first,
-                                                  boost::cref(itr->second), _1));
+                    PERSON_TAG, boost::bind<void>(SDoPersist(), data.key(*i).first,
+                                                  boost::cref(data[*i]), _1));
             }
         }
 
@@ -366,8 +287,8 @@ public:
                     std::size_t dimension,
                     bool isNewVersion,
                     const CMetricBucketGatherer& gatherer,
-                    TCategorySizePrAnyMap& result) const {
-        boost::any& data = result[{CATEGORY, dimension}];
+                    TCategorySizePrGatherersMap& result) const {
+        TGatherers& data = result[{CATEGORY, dimension}];
         return this->restore(traverser, dimension, isNewVersion, gatherer, data);
     }
 
@@ -377,12 +298,12 @@ private:
                  std::size_t dimension,
                  bool isNewVersion,
                  const CMetricBucketGatherer& gatherer,
-                 boost::any& result) const {
+                 TGatherers& result) const {
         using Type = typename SDataType<CATEGORY>::Type;
-        if (result.empty()) {
+        if (boost::get<Type>(&result) == nullptr) {
             result = Type();
         }
-        Type& data = *boost::unsafe_any_cast<Type>(&result);
+        Type& data = boost::get<Type>(result);
 
         // An empty sub-level implies a person with 100% invalid data.
         if (!traverser.hasSubLevel()) {
@@ -406,7 +327,7 @@ private:
         template<typename T>
         bool operator()(core::CStateRestoreTraverser& traverser,
                         const CMetricBucketGatherer& gatherer,
-                        TSizeSizeTUMapUMap<T>& result) const {
+                        CPersonAttributeGatherers<T>& result) const {
             do {
                 const std::string& name = traverser.name();
                 if (name == ATTRIBUTE_TAG) {
@@ -425,7 +346,7 @@ private:
         template<typename T>
         bool restoreAttributes(core::CStateRestoreTraverser& traverser,
                                const CMetricBucketGatherer& gatherer,
-                               TSizeSizeTUMapUMap<T>& result) const {
+                               CPersonAttributeGatherers<T>& result) const {
             std::size_t lastCid(0);
             bool seenCid(false);
 
@@ -437,7 +358,6 @@ private:
                         return false;
                     }
                     seenCid = true;
-                    result[lastCid] = TSizeTUMap<T>(1);
                 } else if (name == PERSON_TAG) {
                     if (!seenCid) {
                         LOG_ERROR(<< "Incorrect format - person before attribute ID in "
@@ -445,8 +365,8 @@ private:
                         return false;
                     }
                     if (traverser.traverseSubLevel(boost::bind<bool>(
-                            &CDoNewRestore::restorePeople<T>, this, _1,
-                            boost::cref(gatherer), boost::ref(result[lastCid]))) == false) {
+                            &CDoNewRestore::restorePeople<T>, this, _1, lastCid,
+                            boost::cref(gatherer), boost::ref(result))) == false) {
                         LOG_ERROR(<< "Invalid data in " << traverser.value());
                         return false;
                     }
@@ -458,8 +378,9 @@ private:
 
         template<typename T>
         bool restorePeople(core::CStateRestoreTraverser& traverser,
+                           std::size_t cid,
                            const CMetricBucketGatherer& gatherer,
-                           TSizeTUMap<T>& result) const {
+                           CPersonAttributeGatherers<T>& result) const {
             std::size_t lastPid(0);
             bool seenPid(false);
 
@@ -486,7 +407,7 @@ private:
                         LOG_ERROR(<< "Invalid data in " << traverser.value());
                         return false;
                     }
-                    result.emplace(lastPid, initial);
+                    result.emplace(lastPid, cid, std::move(initial));
                 }
             } while (traverser.next());
 
@@ -505,7 +426,7 @@ private:
         template<typename T>
         bool operator()(core::CStateRestoreTraverser& traverser,
                         const CMetricBucketGatherer& gatherer,
-                        TSizeSizeTUMapUMap<T>& result) const {
+                        CPersonAttributeGatherers<T>& result) const {
             bool isPopulation = gatherer.dataGatherer().isPopulation();
             if (isPopulation) {
                 this->restorePopulation(traverser, gatherer, result);
@@ -518,7 +439,7 @@ private:
         template<typename T>
         bool restoreIndividual(core::CStateRestoreTraverser& traverser,
                                const CMetricBucketGatherer& gatherer,
-                               TSizeSizeTUMapUMap<T>& result) const {
+                               CPersonAttributeGatherers<T>& result) const {
             std::size_t pid(0);
             do {
                 const std::string& name = traverser.name();
@@ -532,7 +453,8 @@ private:
                         LOG_ERROR(<< "Invalid data in " << traverser.value());
                         return false;
                     }
-                    result[model_t::INDIVIDUAL_ANALYSIS_ATTRIBUTE_ID].emplace(pid, initial);
+                    result.emplace(pid, model_t::INDIVIDUAL_ANALYSIS_ATTRIBUTE_ID,
+                                   std::move(initial));
                     pid++;
                 }
             } while (traverser.next());
@@ -543,8 +465,8 @@ private:
         template<typename T>
         bool restorePopulation(core::CStateRestoreTraverser& traverser,
                                const CMetricBucketGatherer& gatherer,
-                               TSizeSizeTUMapUMap<T>& result) const {
-            std::size_t pid;
+                               CPersonAttributeGatherers<T>& result) const {
+            TSizeSizeUMap numberPeople;
 
             std::size_t lastCid(0);
             bool seenCid(false);
@@ -574,9 +496,8 @@ private:
                         return false;
                     }
 
-                    auto& pidMap = result[lastCid];
-                    pid = pidMap.size();
-                    pidMap.emplace(pid, initial);
+                    std::size_t pid{numberPeople[lastCid]++};
+                    result.emplace(pid, lastCid, std::move(initial));
                 }
             } while (traverser.next());
 
@@ -593,25 +514,25 @@ struct SRemovePeople {
 public:
     template<typename T>
     void operator()(const TCategorySizePr& /*category*/,
-                    TSizeSizeTUMapUMap<T>& data,
+                    CPersonAttributeGatherers<T>& data,
                     std::size_t begin,
-                    std::size_t end) const {
-        for (auto& cidEntry : data) {
-            for (std::size_t pid = begin; pid < end; ++pid) {
-                cidEntry.second.erase(pid);
-            }
-        }
+                    std::size_t end,
+                    std::size_t& releasedMemory) const {
+        releasedMemory += data.eraseIf([begin, end](const TSizeSizePr& key, const T&) {
+            return key.first >= begin && key.first < end;
+        });
     }
 
     template<typename T>
     void operator()(const TCategorySizePr& /*category*/,
-                    TSizeSizeTUMapUMap<T>& data,
-                    const TSizeVec& peopleToRemove) const {
-        for (auto& cidEntry : data) {
-            for (auto pid : peopleToRemove) {
-                cidEntry.second.erase(pid);
-            }
-        }
+                    CPersonAttributeGatherers<T>& data,
+                    const TSizeVec& peopleToRemove,
+                    std::size_t& releasedMemory) const {
+        TSizeVec people(peopleToRemove);
+        std::sort(people.begin(), people.end());
+        releasedMemory += data.eraseIf([&people](const TSizeSizePr& key, const T&) {
+            return std::binary_search(people.begin(), people.end(), key.first);
+        });
     }
 };
 
@@ -619,21 +540,25 @@ public:
 struct SRemoveAttributes {
     template<typename T>
     void operator()(const TCategorySizePr& /*category*/,
-                    TSizeSizeTUMapUMap<T>& data,
-                    const TSizeVec& attributesToRemove) const {
-        for (auto cid : attributesToRemove) {
-            data.erase(cid);
-        }
+                    CPersonAttributeGatherers<T>& data,
+                    const TSizeVec& attributesToRemove,
+                    std::size_t& releasedMemory) const {
+        TSizeVec attributes(attributesToRemove);
+        std::sort(attributes.begin(), attributes.end());
+        releasedMemory += data.eraseIf([&attributes](const TSizeSizePr& key, const T&) {
+            return std::binary_search(attributes.begin(), attributes.end(), key.second);
+        });
     }
 
     template<typename T>
     void operator()(const TCategorySizePr& /*category*/,
-                    TSizeSizeTUMapUMap<T>& data,
+                    CPersonAttributeGatherers<T>& data,
                     std::size_t begin,
-                    std::size_t end) const {
-        for (std::size_t cid = begin; cid < end; ++cid) {
-            data.erase(cid);
-        }
+                    std::size_t end,
+                    std::size_t& releasedMemory) const {
+        releasedMemory += data.eraseIf([begin, end](const TSizeSizePr& key, const T&) {
+            return key.second >= begin && key.second < end;
+        });
     }
 };
 
@@ -642,28 +567,27 @@ struct SDoSample {
 public:
     template<typename T>
     void operator()(const TCategorySizePr& /*category*/,
-                    TSizeSizeTUMapUMap<T>& data,
+                    CPersonAttributeGatherers<T>& data,
                     core_t::TTime time,
                     const CMetricBucketGatherer& gatherer,
-                    CSampleCounts& sampleCounts) const {
+                    CSampleCounts& sampleCounts,
+                    std::size_t& oldMemory,
+                    std::size_t& newMemory) const {
         for (const auto& count : gatherer.bucketCounts(time)) {
             std::size_t pid = CDataGatherer::extractPersonId(count);
             std::size_t cid = CDataGatherer::extractAttributeId(count);
             std::size_t activeId = gatherer.dataGatherer().isPopulation() ? cid : pid;
-            auto cidEntry = data.find(cid);
-            if (cidEntry == data.end()) {
+            T* data_ = data.find(pid, cid);
+            if (data_ == nullptr) {
                 LOG_ERROR(<< "No gatherer for attribute "
                           << gatherer.dataGatherer().attributeName(cid) << " of person "
                           << gatherer.dataGatherer().personName(pid));
             } else {
-                auto pidEntry = cidEntry->second.find(pid);
-                if (pidEntry == cidEntry->second.end()) {
-                    LOG_ERROR(<< "No gatherer for attribute "
-                              << gatherer.dataGatherer().attributeName(cid) << " of person "
-                              << gatherer.dataGatherer().personName(pid));
-                } else if (pidEntry->second.sample(time, sampleCounts.count(activeId))) {
+                oldMemory += core::CMemory::dynamicSize(*data_);
+                if (data_->sample(time, sampleCounts.count(activeId))) {
                     sampleCounts.updateSampleVariance(activeId);
                 }
+                newMemory += core::CMemory::dynamicSize(*data_);
             }
         }
     }
@@ -674,23 +598,19 @@ struct SHash {
 public:
     template<typename T>
     void operator()(const TCategorySizePr& /*category*/,
-                    const TSizeSizeTUMapUMap<T>& data,
+                    const CPersonAttributeGatherers<T>& data,
                     const CMetricBucketGatherer& gatherer,
                     TStrCRefStrCRefPrUInt64Map& hashes) const {
-        for (const auto& cidEntry : data) {
-            std::size_t cid = cidEntry.first;
-            if (gatherer.dataGatherer().isAttributeActive(cid)) {
+        for (std::size_t i = 0u; i < data.size(); ++i) {
+            std::size_t pid = data.key(i).first;
+            std::size_t cid = data.key(i).second;
+            if (gatherer.dataGatherer().isAttributeActive(cid) &&
+                gatherer.dataGatherer().isPersonActive(pid)) {
                 TStrCRef cidName = TStrCRef(gatherer.dataGatherer().attributeName(cid));
-                for (const auto& pidEntry : cidEntry.second) {
-                    std::size_t pid = pidEntry.first;
-                    if (gatherer.dataGatherer().isPersonActive(pid)) {
-                        TStrCRef pidName =
-                            TStrCRef(gatherer.dataGatherer().personName(pid));
-                        hashes.emplace(std::piecewise_construct,
-                                       std::forward_as_tuple(cidName, pidName),
-                                       std::forward_as_tuple(pidEntry.second.checksum()));
-                    }
-                }
+                TStrCRef pidName = TStrCRef(gatherer.dataGatherer().personName(pid));
+                hashes.emplace(std::piecewise_construct,
+                               std::forward_as_tuple(cidName, pidName),
+                               std::forward_as_tuple(data[i].checksum()));
             }
         }
     }
@@ -705,7 +625,7 @@ public:
 public:
     template<typename T>
     void operator()(const TCategorySizePr& /*category*/,
-                    const TSizeSizeTUMapUMap<T>& data,
+                    const CPersonAttributeGatherers<T>& data,
                     const CMetricBucketGatherer& gatherer,
                     model_t::EFeature feature,
                     core_t::TTime time,
@@ -735,7 +655,7 @@ private:
     }
 
     template<typename T, typename U>
-    void featureData(const TSizeSizeTUMapUMap<T>& data,
+    void featureData(const CPersonAttributeGatherers<T>& data,
                      const CMetricBucketGatherer& gatherer,
                      core_t::TTime time,
                      core_t::TTime bucketLength,
@@ -743,40 +663,30 @@ private:
                      U& result) const {
         result.clear();
         if (isSum) {
-            if (data.empty() == false) {
-                auto& pidMap = data.begin()->second;
-                result.reserve(pidMap.size());
-                for (auto& pidEntry : pidMap) {
-                    std::size_t pid = pidEntry.first;
-                    if (gatherer.hasExplicitNullsOnly(
-                            time, pid, model_t::INDIVIDUAL_ANALYSIS_ATTRIBUTE_ID) == false) {
-                        this->featureData(pidEntry.second, gatherer, pid,
-                                          model_t::INDIVIDUAL_ANALYSIS_ATTRIBUTE_ID,
-                                          time, bucketLength, result);
-                    }
+            result.reserve(data.size());
+            for (std::size_t i = 0u; i < data.size(); ++i) {
+                std::size_t pid = data.key(i).first;
+                std::size_t cid = data.key(i).second;
+                if (cid == model_t::INDIVIDUAL_ANALYSIS_ATTRIBUTE_ID &&
+                    gatherer.hasExplicitNullsOnly(time, pid, cid) == false) {
+                    this->featureData(data[i], gatherer, pid, cid, time, bucketLength, result);
                 }
             }
         } else {
-            const TSizeSizePrUInt64UMap& counts = gatherer.bucketCounts(time);
+            const CPersonAttributeCounts& counts = gatherer.bucketCounts(time);
             result.reserve(counts.size());
             for (const auto& count : counts) {
-                std::size_t cid = CDataGatherer::extractAttributeId(count);
-                auto cidEntry = data.find(cid);
-                if (cidEntry == data.end()) {
-                    LOG_ERROR(<< "No gatherers for attribute "
-                              << gatherer.dataGatherer().attributeName(cid));
-                    continue;
-                }
                 std::size_t pid = CDataGatherer::extractPersonId(count);
-                auto pidEntry = cidEntry->second.find(pid);
-                if (pidEntry == cidEntry->second.end()) {
-                    LOG_ERROR(<< "No gatherers for person "
+                std::size_t cid = CDataGatherer::extractAttributeId(count);
+                const T* data_ = data.find(pid, cid);
+                if (data_ == nullptr) {
+                    LOG_ERROR(<< "No gatherer for attribute "
+                              << gatherer.dataGatherer().attributeName(cid) << " of person "
                               << gatherer.dataGatherer().personName(pid));
                     continue;
                 }
 
-                this->featureData(pidEntry->second, gatherer, pid, cid, time,
-                                  bucketLength, result);
+                this->featureData(*data_, gatherer, pid, cid, time, bucketLength, result);
             }
         }
         std::sort(result.begin(), result.end(), maths::COrderings::SFirstLess());
@@ -842,22 +752,28 @@ struct SAddValue {
 
     template<typename T>
     inline void operator()(const TCategorySizePr& category,
-                           TSizeSizeTUMapUMap<T>& data,
+                           CPersonAttributeGatherers<T>& data,
                            std::size_t pid,
                            std::size_t cid,
                            const CMetricBucketGatherer& gatherer,
-                           const SStatistic& stat) const {
-        auto& entry =
-            data[cid]
-                .emplace(boost::unordered::piecewise_construct, boost::make_tuple(pid),
-                         boost::make_tuple(
-                             boost::cref(gatherer.dataGatherer().params()),
-                             category.second, gatherer.currentBucketStartTime(),
-                             gatherer.bucketLength(), gatherer.beginInfluencers(),
-                             gatherer.endInfluencers()))
-                .first->second;
+                           const SStatistic& stat,
+                           std::size_t& oldMemory,
+                           std::size_t& newMemory) const {
+        std::size_t n{data.size()};
+        oldMemory += data.storageMemoryUsage();
+        T& entry = data.emplace(pid, cid, gatherer.dataGatherer().params(),
+                                category.second, gatherer.currentBucketStartTime(),
+                                gatherer.bucketLength(), gatherer.beginInfluencers(),
+                                gatherer.endInfluencers());
+        // Adding a value can grow an existing gatherer, for example when
+        // it sees a new influence, so this is counted as well as the
+        // memory of any new gatherer.
+        if (data.size() == n) {
+            oldMemory += core::CMemory::dynamicSize(entry);
+        }
         entry.add(stat.s_Time, (*stat.s_Values)[category.first], stat.s_Count,
                   stat.s_SampleCount, *stat.s_Influences);
+        newMemory += data.storageMemoryUsage() + core::CMemory::dynamicSize(entry);
     }
 };
 
@@ -866,12 +782,14 @@ struct SStartNewBucket {
 public:
     template<typename T>
     void operator()(const TCategorySizePr& /*category*/,
-                    TSizeSizeTUMapUMap<T>& data,
-                    core_t::TTime time) const {
-        for (auto& cidEntry : data) {
-            for (auto& pidEntry : cidEntry.second) {
-                pidEntry.second.startNewBucket(time);
-            }
+                    CPersonAttributeGatherers<T>& data,
+                    core_t::TTime time,
+                    std::size_t& oldMemory,
+                    std::size_t& newMemory) const {
+        for (std::size_t i = 0u; i < data.size(); ++i) {
+            oldMemory += core::CMemory::dynamicSize(data[i]);
+            data[i].startNewBucket(time);
+            newMemory += core::CMemory::dynamicSize(data[i]);
         }
     }
 };
@@ -881,12 +799,14 @@ struct SResetBucket {
 public:
     template<typename T>
     void operator()(const TCategorySizePr& /*category*/,
-                    TSizeSizeTUMapUMap<T>& data,
-                    core_t::TTime bucketStart) const {
-        for (auto& cidEntry : data) {
-            for (auto& pidEntry : cidEntry.second) {
-                pidEntry.second.resetBucket(bucketStart);
-            }
+                    CPersonAttributeGatherers<T>& data,
+                    core_t::TTime bucketStart,
+                    std::size_t& oldMemory,
+                    std::size_t& newMemory) const {
+        for (std::size_t i = 0u; i < data.size(); ++i) {
+            oldMemory += core::CMemory::dynamicSize(data[i]);
+            data[i].resetBucket(bucketStart);
+            newMemory += core::CMemory::dynamicSize(data[i]);
         }
     }
 };
@@ -896,18 +816,12 @@ struct SReleaseMemory {
 public:
     template<typename T>
     void operator()(const TCategorySizePr& /*category*/,
-                    TSizeSizeTUMapUMap<T>& data,
-                    core_t::TTime samplingCutoffTime) const {
-        for (auto& cidEntry : data) {
-            auto& pidMap = cidEntry.second;
-            for (auto i = pidMap.begin(); i != pidMap.end(); /**/) {
-                if (i->second.isRedundant(samplingCutoffTime)) {
-                    i = pidMap.erase(i);
-                } else {
-                    ++i;
-                }
-            }
-        }
+                    CPersonAttributeGatherers<T>& data,
+                    core_t::TTime samplingCutoffTime,
+                    std::size_t& releasedMemory) const {
+        releasedMemory += data.eraseIf([samplingCutoffTime](const TSizeSizePr&, const T& data_) {
+            return data_.isRedundant(samplingCutoffTime);
+        });
     }
 };
 
@@ -1264,15 +1178,20 @@ void CMetricBucketGatherer::recyclePeople(const TSizeVec& peopleToRemove) {
         return;
     }
 
-    apply(m_FeatureData,
-          boost::bind<void>(SRemovePeople(), _1, _2, boost::cref(peopleToRemove)));
+    std::size_t releasedMemory{0};
+    apply(m_FeatureData, boost::bind<void>(SRemovePeople(), _1, _2, boost::cref(peopleToRemove),
+                                           boost::ref(releasedMemory)));
+    this->recordMemoryUsageChange(releasedMemory, 0);
 
     this->CBucketGatherer::recyclePeople(peopleToRemove);
 }
 
 void CMetricBucketGatherer::removePeople(std::size_t lowestPersonToRemove) {
+    std::size_t releasedMemory{0};
     apply(m_FeatureData, boost::bind<void>(SRemovePeople(), _1, _2, lowestPersonToRemove,
-                                           m_DataGatherer.numberPeople()));
+                                           m_DataGatherer.numberPeople(),
+                                           boost::ref(releasedMemory)));
+    this->recordMemoryUsageChange(releasedMemory, 0);
 
     this->CBucketGatherer::removePeople(lowestPersonToRemove);
 }
@@ -1283,8 +1202,11 @@ void CMetricBucketGatherer::recycleAttributes(const TSizeVec& attributesToRemove
     }
 
     if (m_DataGatherer.isPopulation()) {
+        std::size_t releasedMemory{0};
         apply(m_FeatureData, boost::bind<void>(SRemoveAttributes(), _1, _2,
-                                               boost::cref(attributesToRemove)));
+                                               boost::cref(attributesToRemove),
+                                               boost::ref(releasedMemory)));
+        this->recordMemoryUsageChange(releasedMemory, 0);
     }
 
     this->CBucketGatherer::recycleAttributes(attributesToRemove);
@@ -1292,8 +1214,11 @@ void CMetricBucketGatherer::recycleAttributes(const TSizeVec& attributesToRemove
 
 void CMetricBucketGatherer::removeAttributes(std::size_t lowestAttributeToRemove) {
     if (m_DataGatherer.isPopulation()) {
+        std::size_t releasedMemory{0};
         apply(m_FeatureData, boost::bind<void>(SRemoveAttributes(), _1, _2, lowestAttributeToRemove,
-                                               m_DataGatherer.numberAttributes()));
+                                               m_DataGatherer.numberAttributes(),
+                                               boost::ref(releasedMemory)));
+        this->recordMemoryUsageChange(releasedMemory, 0);
     }
 
     this->CBucketGatherer::removeAttributes(lowestAttributeToRemove);
@@ -1311,22 +1236,31 @@ uint64_t CMetricBucketGatherer::checksum() const {
 }
 
 void CMetricBucketGatherer::debugMemoryUsage(core::CMemoryUsage::TMemoryUsagePtr mem) const {
-    registerMemoryCallbacks();
     mem->setName("CMetricBucketGatherer");
     this->CBucketGatherer::debugMemoryUsage(mem->addChild());
     core::CMemoryDebug::dynamicSize("m_ValueFieldName", m_ValueFieldName, mem);
     core::CMemoryDebug::dynamicSize("m_FieldNames", m_FieldNames, mem);
     core::CMemoryDebug::dynamicSize("m_FieldMetricCategories", m_FieldMetricCategories, mem);
     core::CMemoryDebug::dynamicSize("m_FeatureData", m_FeatureData, mem);
+    for (const auto& data : m_FeatureData) {
+        boost::apply_visitor(boost::bind<void>(SDebugMemoryUsage(), mem, _1), data.second);
+    }
 }
 
 std::size_t CMetricBucketGatherer::memoryUsage() const {
-    registerMemoryCallbacks();
     std::size_t mem = this->CBucketGatherer::memoryUsage();
     mem += core::CMemory::dynamicSize(m_ValueFieldName);
     mem += core::CMemory::dynamicSize(m_FieldNames);
     mem += core::CMemory::dynamicSize(m_FieldMetricCategories);
-    mem += core::CMemory::dynamicSize(m_FeatureData);
+    mem += this->featureDataMemoryUsage();
+    return mem;
+}
+
+std::size_t CMetricBucketGatherer::featureDataMemoryUsage() const {
+    std::size_t mem = core::CMemory::dynamicSize(m_FeatureData);
+    for (const auto& data : m_FeatureData) {
+        mem += boost::apply_visitor(SMemoryUsage(), data.second);
+    }
     return mem;
 }
 
@@ -1335,28 +1269,41 @@ std::size_t CMetricBucketGatherer::staticSize() const {
 }
 
 void CMetricBucketGatherer::clear() {
+    std::size_t oldMemory{this->featureDataMemoryUsage()};
     this->CBucketGatherer::clear();
     m_FeatureData.clear();
     this->initializeFeatureData();
+    this->recordMemoryUsageChange(oldMemory, this->featureDataMemoryUsage());
 }
 
 bool CMetricBucketGatherer::resetBucket(core_t::TTime bucketStart) {
     if (this->CBucketGatherer::resetBucket(bucketStart) == false) {
         return false;
     }
-    apply(m_FeatureData, boost::bind<void>(SResetBucket(), _1, _2, bucketStart));
+    std::size_t oldMemory{0};
+    std::size_t newMemory{0};
+    apply(m_FeatureData, boost::bind<void>(SResetBucket(), _1, _2, bucketStart,
+                                           boost::ref(oldMemory), boost::ref(newMemory)));
+    this->recordMemoryUsageChange(oldMemory, newMemory);
     return true;
 }
 
 void CMetricBucketGatherer::releaseMemory(core_t::TTime samplingCutoffTime) {
-    apply(m_FeatureData, boost::bind<void>(SReleaseMemory(), _1, _2, samplingCutoffTime));
+    std::size_t releasedMemory{0};
+    apply(m_FeatureData, boost::bind<void>(SReleaseMemory(), _1, _2, samplingCutoffTime,
+                                           boost::ref(releasedMemory)));
+    this->recordMemoryUsageChange(releasedMemory, 0);
 }
 
 void CMetricBucketGatherer::sample(core_t::TTime time) {
     if (m_DataGatherer.sampleCounts()) {
+        std::size_t oldMemory{0};
+        std::size_t newMemory{0};
         apply(m_FeatureData,
               boost::bind<void>(SDoSample(), _1, _2, time, boost::cref(*this),
-                                boost::ref(*m_DataGatherer.sampleCounts())));
+                                boost::ref(*m_DataGatherer.sampleCounts()),
+                                boost::ref(oldMemory), boost::ref(newMemory)));
+        this->recordMemoryUsageChange(oldMemory, newMemory);
     }
 }
 
@@ -1424,8 +1371,12 @@ void CMetricBucketGatherer::addValue(std::size_t pid,
     }
 
     stat.s_Influences = &influences;
-    apply(m_FeatureData, boost::bind<void>(SAddValue(), _1, _2, pid, cid,
-                                           boost::cref(*this), boost::ref(stat)));
+    std::size_t oldMemory{0};
+    std::size_t newMemory{0};
+    apply(m_FeatureData,
+          boost::bind<void>(SAddValue(), _1, _2, pid, cid, boost::cref(*this),
+                            boost::ref(stat), boost::ref(oldMemory), boost::ref(newMemory)));
+    this->recordMemoryUsageChange(oldMemory, newMemory);
 }
 
 void CMetricBucketGatherer::startNewBucket(core_t::TTime time, bool skipUpdates) {
@@ -1440,7 +1391,7 @@ void CMetricBucketGatherer::startNewBucket(core_t::TTime time, bool skipUpdates)
         core_t::TTime earliestAvailableBucketStartTime = this->earliestBucketStartTime();
         if (this->dataAvailable(earliestAvailableBucketStartTime)) {
             TSizeUInt64VecUMap counts;
-            const TSizeSizePrUInt64UMap& counts_ =
+            const CPersonAttributeCounts& counts_ =
                 this->bucketCounts(earliestAvailableBucketStartTime);
             for (const auto& count : counts_) {
                 if (m_DataGatherer.isPopulation()) {
@@ -1467,7 +1418,11 @@ void CMetricBucketGatherer::startNewBucket(core_t::TTime time, bool skipUpdates)
             m_DataGatherer.sampleCounts()->refresh(m_DataGatherer);
         }
     }
-    apply(m_FeatureData, boost::bind<void>(SStartNewBucket(), _1, _2, time));
+    std::size_t oldMemory{0};
+    std::size_t newMemory{0};
+    apply(m_FeatureData, boost::bind<void>(SStartNewBucket(), _1, _2, time,
+                                           boost::ref(oldMemory), boost::ref(newMemory)));
+    this->recordMemoryUsageChange(oldMemory, newMemory);
 }
 
 void CMetricBucketGatherer::initializeFieldNamesPart1(const std::string& personFieldName,
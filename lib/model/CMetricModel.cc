@@ -7,8 +7,10 @@
 #include <model/CMetricModel.h>
 
 #include <core/CContainerPrinter.h>
+#include <core/CFastMutex.h>
 #include <core/CFunctional.h>
 #include <core/CLogger.h>
+#include <core/CScopedFastLock.h>
 #include <core/CStatePersistInserter.h>
 #include <core/CStateRestoreTraverser.h>
 #include <core/CStatistics.h>
@@ -18,6 +20,7 @@
 #include <maths/CMultivariatePrior.h>
 #include <maths/COrderings.h>
 #include <maths/CPrior.h>
+#include <maths/CSampling.h>
 #include <maths/CTools.h>
 #include <maths/ProbabilityAggregators.h>
 
@@ -217,10 +220,11 @@ void CMetricModel::sample(core_t::TTime startTime,
 
         this->CIndividualModel::sample(time, time + bucketLength, resourceMonitor);
 
-        // Declared outside the loop to minimize the number of times they are created.
-        maths::CModel::TTimeDouble2VecSizeTrVec values;
-        maths::CModelAddSamplesParams::TDouble2VecWeightsAryVec trendWeights;
-        maths::CModelAddSamplesParams::TDouble2VecWeightsAryVec priorWeights;
+        // People whose models were reset. The resets must be applied to
+        // the gatherer after the models have been sampled because this
+        // can happen concurrently.
+        TSizeVec resets;
+        core::CFastMutex resetsMutex;
 
         for (auto& featureData : m_CurrentBucketStats.s_FeatureData) {
             model_t::EFeature feature = featureData.first;
@@ -230,91 +234,105 @@ void CMetricModel::sample(core_t::TTime startTime,
                       << " data = " << core::CContainerPrinter::print(data));
             this->applyFilter(model_t::E_XF_By, true, this->personFilter(), data);
 
-            for (const auto& data_ : data) {
-                std::size_t pid = data_.first;
-                const CGathererTools::TSampleVec& samples = data_.second.s_Samples;
-
-                maths::CModel* model = this->model(feature, pid);
-                if (!model) {
-                    LOG_ERROR(<< "Missing model for " << this->personName(pid));
-                    continue;
-                }
+            this->sampleInShards(data.size(), [&](std::size_t begin, std::size_t end) {
+                // Declared outside the loop to minimize the number of times they are created.
+                maths::CModel::TTimeDouble2VecSizeTrVec values;
+                maths::CModelAddSamplesParams::TDouble2VecWeightsAryVec trendWeights;
+                maths::CModelAddSamplesParams::TDouble2VecWeightsAryVec priorWeights;
+
+                for (std::size_t j = begin; j < end; ++j) {
+                    std::size_t pid = data[j].first;
+                    maths::CSampling::CScopeRandomNumberStream stream{
+                        sampleStream(feature, pid, time)};
+                    const CGathererTools::TSampleVec& samples = data[j].second.s_Samples;
+
+                    maths::CModel* model = this->writableModel(feature, pid);
+                    if (!model) {
+                        LOG_ERROR(<< "Missing model for " << this->personName(pid));
+                        continue;
+                    }
 
-                core_t::TTime sampleTime = model_t::sampleTime(feature, time, bucketLength);
-                if (this->shouldIgnoreSample(feature, pid, model_t::INDIVIDUAL_ANALYSIS_ATTRIBUTE_ID,
-                                             sampleTime)) {
-                    model->skipTime(time - lastBucketTimesMap[pid]);
-                    continue;
-                }
+                    core_t::TTime sampleTime = model_t::sampleTime(feature, time, bucketLength);
+                    if (this->shouldIgnoreSample(
+                            feature, pid, model_t::INDIVIDUAL_ANALYSIS_ATTRIBUTE_ID, sampleTime)) {
+                        model->skipTime(time - lastBucketTimesMap.at(pid));
+                        continue;
+                    }
 
-                const TOptionalSample& bucket = data_.second.s_BucketValue;
-                if (model_t::isSampled(feature) && bucket) {
-                    values.assign(1, core::make_triple(
-                                         bucket->time(), TDouble2Vec(bucket->value(dimension)),
-                                         model_t::INDIVIDUAL_ANALYSIS_ATTRIBUTE_ID));
-                    model->addBucketValue(values);
-                }
+                    const TOptionalSample& bucket = data[j].second.s_BucketValue;
+                    if (model_t::isSampled(feature) && bucket) {
+                        values.assign(1, core::make_triple(
+                                             bucket->time(), TDouble2Vec(bucket->value(dimension)),
+                                             model_t::INDIVIDUAL_ANALYSIS_ATTRIBUTE_ID));
+                        model->addBucketValue(values);
+                    }
 
-                double emptyBucketWeight = this->emptyBucketWeight(feature, pid, time);
-                if (emptyBucketWeight == 0.0) {
-                    continue;
-                }
+                    double emptyBucketWeight = this->emptyBucketWeight(feature, pid, time);
+                    if (emptyBucketWeight == 0.0) {
+                        continue;
+                    }
 
-                std::size_t n = samples.size();
-                double derate = this->derate(pid, sampleTime);
-                double interval =
-                    (1.0 + (this->params().s_InitialDecayRateMultiplier - 1.0) * derate) *
-                    emptyBucketWeight;
-                double count = this->params().s_MaximumUpdatesPerBucket > 0.0 && n > 0
-                                   ? this->params().s_MaximumUpdatesPerBucket /
-                                         static_cast<double>(n)
-                                   : 1.0;
-                double ceff = emptyBucketWeight * count * this->learnRate(feature);
-
-                LOG_TRACE(<< "Bucket = " << gatherer.printCurrentBucket(time)
-                          << ", feature = " << model_t::print(feature)
-                          << ", samples = " << core::CContainerPrinter::print(samples)
-                          << ", isInteger = " << data_.second.s_IsInteger
-                          << ", person = " << this->personName(pid)
-                          << ", count weight = " << count << ", dimension = " << dimension
-                          << ", empty bucket weight = " << emptyBucketWeight);
-
-                model->params().probabilityBucketEmpty(
-                    this->probabilityBucketEmpty(feature, pid));
-
-                values.resize(n);
-                trendWeights.resize(n, maths_t::CUnitWeights::unit<TDouble2Vec>(dimension));
-                priorWeights.resize(n, maths_t::CUnitWeights::unit<TDouble2Vec>(dimension));
-                for (std::size_t i = 0u; i < n; ++i) {
-                    core_t::TTime ti = samples[i].time();
-                    TDouble2Vec vi(samples[i].value(dimension));
-                    double vs = samples[i].varianceScale();
-                    values[i] = core::make_triple(
-                        model_t::sampleTime(feature, time, bucketLength, ti),
-                        vi, model_t::INDIVIDUAL_ANALYSIS_ATTRIBUTE_ID);
-                    maths_t::setCount(TDouble2Vec(dimension, ceff / vs), trendWeights[i]);
-                    maths_t::setWinsorisationWeight(
-                        model->winsorisationWeight(derate, ti, vi), trendWeights[i]);
-                    maths_t::setCountVarianceScale(TDouble2Vec(dimension, vs),
-                                                   trendWeights[i]);
-                    maths_t::setCount(TDouble2Vec(dimension, ceff), priorWeights[i]);
-                    maths_t::setWinsorisationWeight(
-                        maths_t::winsorisationWeight(trendWeights[i]), priorWeights[i]);
-                    maths_t::setCountVarianceScale(TDouble2Vec(dimension, vs),
-                                                   priorWeights[i]);
-                }
+                    std::size_t n = samples.size();
+                    double derate = this->derate(pid, sampleTime);
+                    double interval =
+                        (1.0 + (this->params().s_InitialDecayRateMultiplier - 1.0) * derate) *
+                        emptyBucketWeight;
+                    double count = this->params().s_MaximumUpdatesPerBucket > 0.0 && n > 0
+                                       ? this->params().s_MaximumUpdatesPerBucket /
+                                             static_cast<double>(n)
+                                       : 1.0;
+                    double ceff = emptyBucketWeight * count * this->learnRate(feature);
+
+                    LOG_TRACE(<< "Bucket = " << gatherer.printCurrentBucket(time)
+                              << ", feature = " << model_t::print(feature)
+                              << ", samples = " << core::CContainerPrinter::print(samples)
+                              << ", isInteger = " << data[j].second.s_IsInteger
+                              << ", person = " << this->personName(pid)
+                              << ", count weight = " << count << ", dimension = " << dimension
+                              << ", empty bucket weight = " << emptyBucketWeight);
+
+                    model->params().probabilityBucketEmpty(
+                        this->probabilityBucketEmpty(feature, pid));
+
+                    values.resize(n);
+                    trendWeights.resize(n, maths_t::CUnitWeights::unit<TDouble2Vec>(dimension));
+                    priorWeights.resize(n, maths_t::CUnitWeights::unit<TDouble2Vec>(dimension));
+                    for (std::size_t i = 0u; i < n; ++i) {
+                        core_t::TTime ti = samples[i].time();
+                        TDouble2Vec vi(samples[i].value(dimension));
+                        double vs = samples[i].varianceScale();
+                        values[i] = core::make_triple(
+                            model_t::sampleTime(feature, time, bucketLength, ti),
+                            vi, model_t::INDIVIDUAL_ANALYSIS_ATTRIBUTE_ID);
+                        maths_t::setCount(TDouble2Vec(dimension, ceff / vs), trendWeights[i]);
+                        maths_t::setWinsorisationWeight(
+                            model->winsorisationWeight(derate, ti, vi), trendWeights[i]);
+                        maths_t::setCountVarianceScale(TDouble2Vec(dimension, vs),
+                                                       trendWeights[i]);
+                        maths_t::setCount(TDouble2Vec(dimension, ceff), priorWeights[i]);
+                        maths_t::setWinsorisationWeight(
+                            maths_t::winsorisationWeight(trendWeights[i]), priorWeights[i]);
+                        maths_t::setCountVarianceScale(TDouble2Vec(dimension, vs),
+                                                       priorWeights[i]);
+                    }
 
-                maths::CModelAddSamplesParams params;
-                params.integer(data_.second.s_IsInteger)
-                    .nonNegative(data_.second.s_IsNonNegative)
-                    .propagationInterval(interval)
-                    .trendWeights(trendWeights)
-                    .priorWeights(priorWeights);
+                    maths::CModelAddSamplesParams params;
+                    params.integer(data[j].second.s_IsInteger)
+                        .nonNegative(data[j].second.s_IsNonNegative)
+                        .propagationInterval(interval)
+                        .trendWeights(trendWeights)
+                        .priorWeights(priorWeights);
 
-                if (model->addSamples(params, values) == maths::CModel::E_Reset) {
-                    gatherer.resetSampleCount(pid);
+                    if (model->addSamples(params, values) == maths::CModel::E_Reset) {
+                        core::CScopedFastLock lock(resetsMutex);
+                        resets.push_back(pid);
+                    }
                 }
-            }
+            });
+        }
+
+        for (auto pid : resets) {
+            gatherer.resetSampleCount(pid);
         }
 
         this->sampleCorrelateModels();
@@ -368,6 +386,10 @@ bool CMetricModel::computeProbability(const std::size_t pid,
 
         LOG_TRACE(<< "Compute probability for " << data->print());
 
+        // Computing the probability updates the anomaly model so the model
+        // mustn't be shared with a clone for persistence.
+        this->writableModel(feature, pid);
+
         if (this->correlates(feature, pid, startTime)) {
             CProbabilityAndInfluenceCalculator::SCorrelateParams params(partitioningFields);
             TStrCRefDouble1VecDouble1VecPrPrVecVecVec influenceValues;
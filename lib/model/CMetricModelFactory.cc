@@ -165,7 +165,9 @@ CMetricModelFactory::defaultPrior(model_t::EFeature feature, const SModelParams&
         priors.emplace_back(multimodalPrior.clone());
     }
 
-    return boost::make_unique<maths::COneOfNPrior>(priors, dataType, params.s_DecayRate);
+    auto result = boost::make_unique<maths::COneOfNPrior>(priors, dataType, params.s_DecayRate);
+    result->lazyUpdates(params.s_LazyPriorUpdates);
+    return result;
 }
 
 CMetricModelFactory::TMultivariatePriorUPtr
@@ -167,7 +167,9 @@ CMetricPopulationModelFactory::defaultPrior(model_t::EFeature feature,
         priors.emplace_back(multimodalPrior.clone());
     }
 
-    return boost::make_unique<maths::COneOfNPrior>(priors, dataType, params.s_DecayRate);
+    auto result = boost::make_unique<maths::COneOfNPrior>(priors, dataType, params.s_DecayRate);
+    result->lazyUpdates(params.s_LazyPriorUpdates);
+    return result;
 }
 
 CMetricPopulationModelFactory::TMultivariatePriorUPtr
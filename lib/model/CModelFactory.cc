@@ -6,6 +6,8 @@
 
 #include <model/CModelFactory.h>
 
+#include <core/CFastMutex.h>
+#include <core/CScopedFastLock.h>
 #include <core/CStateRestoreTraverser.h>
 #include <core/Constants.h>
 
@@ -36,6 +38,17 @@
 namespace ml {
 namespace model {
 
+namespace {
+//! Get the lock which guards the lazily populated caches. Factories are
+//! shared by all the detectors for a given search key, which may create
+//! models concurrently, and cache misses are rare so a single lock is
+//! sufficient.
+core::CFastMutex& cacheMutex() {
+    static core::CFastMutex mutex;
+    return mutex;
+}
+}
+
 const std::string CModelFactory::EMPTY_STRING("");
 
 CModelFactory::CModelFactory(const SModelParams& params,
@@ -48,6 +61,7 @@ CModelFactory::defaultFeatureModels(const TFeatureVec& features,
                                     core_t::TTime bucketLength,
                                     double minimumSeasonalVarianceScale,
                                     bool modelAnomalies) const {
+    core::CScopedFastLock lock(cacheMutex());
     auto result = m_MathsModelCache.emplace(features, TFeatureMathsModelPtrPrVec());
     if (result.second) {
         result.first->second.reserve(features.size());
@@ -115,6 +129,7 @@ CModelFactory::defaultFeatureModel(model_t::EFeature feature,
 
 const CModelFactory::TFeatureMultivariatePriorSPtrPrVec&
 CModelFactory::defaultCorrelatePriors(const TFeatureVec& features) const {
+    core::CScopedFastLock lock(cacheMutex());
     auto result = m_CorrelatePriorCache.emplace(features, TFeatureMultivariatePriorSPtrPrVec{});
     if (result.second) {
         result.first->second.reserve(features.size());
@@ -177,6 +192,7 @@ CModelFactory::defaultDecomposition(model_t::EFeature feature, core_t::TTime buc
 const CModelFactory::TFeatureInfluenceCalculatorCPtrPrVec&
 CModelFactory::defaultInfluenceCalculators(const std::string& influencerName,
                                            const TFeatureVec& features) const {
+    core::CScopedFastLock lock(cacheMutex());
     auto& result = m_InfluenceCalculatorCache[{influencerName, features}];
 
     if (result.empty()) {
@@ -256,6 +272,10 @@ void CModelFactory::multivariateByFields(bool enabled) {
     m_ModelParams.s_MultivariateByFields = enabled;
 }
 
+void CModelFactory::threadPool(core::CStaticThreadPool* threadPool) {
+    m_ModelParams.s_ThreadPool = threadPool;
+}
+
 void CModelFactory::minimumModeFraction(double minimumModeFraction) {
     m_ModelParams.s_MinimumModeFraction = minimumModeFraction;
 }
@@ -268,6 +288,10 @@ void CModelFactory::componentSize(std::size_t componentSize) {
     m_ModelParams.s_ComponentSize = componentSize;
 }
 
+void CModelFactory::lazyPriorUpdates(bool enabled) {
+    m_ModelParams.s_LazyPriorUpdates = enabled;
+}
+
 double CModelFactory::minimumModeFraction() const {
     return m_ModelParams.s_MinimumModeFraction;
 }
@@ -280,6 +304,10 @@ std::size_t CModelFactory::componentSize() const {
     return m_ModelParams.s_ComponentSize;
 }
 
+bool CModelFactory::lazyPriorUpdates() const {
+    return m_ModelParams.s_LazyPriorUpdates;
+}
+
 void CModelFactory::updateBucketLength(core_t::TTime length) {
     m_ModelParams.s_BucketLength = length;
 }
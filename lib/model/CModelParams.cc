@@ -30,6 +30,7 @@ SModelParams::SModelParams(core_t::TTime bucketLength)
       s_InitialDecayRateMultiplier(CAnomalyDetectorModelConfig::DEFAULT_INITIAL_DECAY_RATE_MULTIPLIER),
       s_ControlDecayRate(true), s_MinimumModeFraction(0.0),
       s_MinimumModeCount(CAnomalyDetectorModelConfig::DEFAULT_MINIMUM_CLUSTER_SPLIT_COUNT),
+      s_LazyPriorUpdates(false),
       s_CutoffToModelEmptyBuckets(CAnomalyDetectorModelConfig::DEFAULT_CUTOFF_TO_MODEL_EMPTY_BUCKETS),
       s_ComponentSize(CAnomalyDetectorModelConfig::DEFAULT_COMPONENT_SIZE),
       s_MinimumTimeToDetectChange(CAnomalyDetectorModelConfig::DEFAULT_MINIMUM_TIME_TO_DETECT_CHANGE),
@@ -54,7 +55,7 @@ SModelParams::SModelParams(core_t::TTime bucketLength)
       s_DetectionRules(EMPTY_RULES), s_ScheduledEvents(EMPTY_SCHEDULED_EVENTS),
       s_InfluenceCutoff(CAnomalyDetectorModelConfig::DEFAULT_INFLUENCE_CUTOFF),
       s_BucketResultsDelay(0), s_MinimumToFuzzyDeduplicate(10000),
-      s_CacheProbabilities(true) {
+      s_CacheProbabilities(true), s_ThreadPool(nullptr) {
 }
 
 void SModelParams::configureLatency(core_t::TTime latency, core_t::TTime bucketLength) {
@@ -91,6 +92,7 @@ uint64_t SModelParams::checksum(uint64_t seed) const {
     seed = maths::CChecksum::calculate(seed, s_InitialDecayRateMultiplier);
     seed = maths::CChecksum::calculate(seed, s_MinimumModeFraction);
     seed = maths::CChecksum::calculate(seed, s_MinimumModeCount);
+    seed = maths::CChecksum::calculate(seed, s_LazyPriorUpdates);
     seed = maths::CChecksum::calculate(seed, s_CutoffToModelEmptyBuckets);
     seed = maths::CChecksum::calculate(seed, s_ComponentSize);
     seed = maths::CChecksum::calculate(seed, s_MinimumTimeToDetectChange);
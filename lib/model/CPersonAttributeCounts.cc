@@ -0,0 +1,178 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#include <model/CPersonAttributeCounts.h>
+
+#include <core/CMemory.h>
+
+#include <algorithm>
+
+namespace ml {
+namespace model {
+
+namespace {
+const uint64_t INDEX_MASK{0xffffffff};
+const std::size_t TOMBSTONE{0xffffffff};
+}
+
+const std::size_t CPersonAttributeCounts::MINIMUM_CAPACITY{16};
+
+CPersonAttributeCounts::CPersonAttributeCounts()
+    : m_Generation{1}, m_Tombstones{0} {
+}
+
+uint64_t& CPersonAttributeCounts::operator[](const TSizeSizePr& key) {
+    std::size_t insert{m_Slots.size()};
+    if (m_Slots.size() > 0) {
+        std::size_t mask{m_Slots.size() - 1};
+        std::size_t i{this->home(key)};
+        for (/**/; this->current(i); i = (i + 1) & mask) {
+            std::size_t index{this->index(i)};
+            if (index == TOMBSTONE) {
+                insert = std::min(insert, i);
+            } else if (m_Counts[index].first == key) {
+                return m_Counts[index].second;
+            }
+        }
+        if (insert == m_Slots.size()) {
+            insert = i;
+        } else {
+            --m_Tombstones;
+        }
+    }
+
+    // Keep the table at most half full, counting tombstones.
+    if (2 * (m_Counts.size() + m_Tombstones + 1) > m_Slots.size()) {
+        this->rehash(2 * (m_Counts.size() + 1));
+        insert = this->home(key);
+        while (this->current(insert)) {
+            insert = (insert + 1) & (m_Slots.size() - 1);
+        }
+    }
+
+    this->point(insert, m_Counts.size());
+    m_Counts.emplace_back(key, 0);
+    return m_Counts.back().second;
+}
+
+CPersonAttributeCounts::iterator CPersonAttributeCounts::find(const TSizeSizePr& key) {
+    std::size_t i{this->slot(key)};
+    return i == m_Slots.size() ? m_Counts.end() : m_Counts.begin() + this->index(i);
+}
+
+CPersonAttributeCounts::const_iterator
+CPersonAttributeCounts::find(const TSizeSizePr& key) const {
+    std::size_t i{this->slot(key)};
+    return i == m_Slots.size() ? m_Counts.end() : m_Counts.begin() + this->index(i);
+}
+
+CPersonAttributeCounts::iterator CPersonAttributeCounts::erase(iterator i) {
+    std::size_t index{static_cast<std::size_t>(i - m_Counts.begin())};
+    std::size_t last{m_Counts.size() - 1};
+    this->point(this->slot(i->first), TOMBSTONE);
+    ++m_Tombstones;
+    if (index != last) {
+        this->point(this->slot(m_Counts[last].first), index);
+        m_Counts[index] = m_Counts[last];
+    }
+    m_Counts.pop_back();
+    return m_Counts.begin() + index;
+}
+
+void CPersonAttributeCounts::clear() {
+    m_Counts.clear();
+    m_Tombstones = 0;
+    if (++m_Generation == 0) {
+        std::fill(m_Slots.begin(), m_Slots.end(), 0);
+        m_Generation = 1;
+    }
+}
+
+bool CPersonAttributeCounts::empty() const {
+    return m_Counts.empty();
+}
+
+std::size_t CPersonAttributeCounts::size() const {
+    return m_Counts.size();
+}
+
+CPersonAttributeCounts::iterator CPersonAttributeCounts::begin() {
+    return m_Counts.begin();
+}
+
+CPersonAttributeCounts::iterator CPersonAttributeCounts::end() {
+    return m_Counts.end();
+}
+
+CPersonAttributeCounts::const_iterator CPersonAttributeCounts::begin() const {
+    return m_Counts.begin();
+}
+
+CPersonAttributeCounts::const_iterator CPersonAttributeCounts::end() const {
+    return m_Counts.end();
+}
+
+void CPersonAttributeCounts::debugMemoryUsage(core::CMemoryUsage::TMemoryUsagePtr mem) const {
+    mem->setName("CPersonAttributeCounts");
+    core::CMemoryDebug::dynamicSize("m_Counts", m_Counts, mem);
+    core::CMemoryDebug::dynamicSize("m_Slots", m_Slots, mem);
+}
+
+std::size_t CPersonAttributeCounts::memoryUsage() const {
+    return core::CMemory::dynamicSize(m_Counts) + core::CMemory::dynamicSize(m_Slots);
+}
+
+std::size_t CPersonAttributeCounts::home(const TSizeSizePr& key) const {
+    uint64_t hash{(static_cast<uint64_t>(key.first) * 0x9e3779b97f4a7c15 ^
+                   static_cast<uint64_t>(key.second)) *
+                  0xc2b2ae3d27d4eb4f};
+    return static_cast<std::size_t>(hash ^ (hash >> 32)) & (m_Slots.size() - 1);
+}
+
+std::size_t CPersonAttributeCounts::slot(const TSizeSizePr& key) const {
+    if (m_Slots.empty()) {
+        return 0;
+    }
+    std::size_t mask{m_Slots.size() - 1};
+    for (std::size_t i = this->home(key); this->current(i); i = (i + 1) & mask) {
+        std::size_t index{this->index(i)};
+        if (index != TOMBSTONE && m_Counts[index].first == key) {
+            return i;
+        }
+    }
+    return m_Slots.size();
+}
+
+void CPersonAttributeCounts::point(std::size_t i, std::size_t index) {
+    m_Slots[i] = (static_cast<uint64_t>(m_Generation) << 32) | static_cast<uint64_t>(index);
+}
+
+bool CPersonAttributeCounts::current(std::size_t i) const {
+    return (m_Slots[i] >> 32) == m_Generation;
+}
+
+std::size_t CPersonAttributeCounts::index(std::size_t i) const {
+    return static_cast<std::size_t>(m_Slots[i] & INDEX_MASK);
+}
+
+void CPersonAttributeCounts::rehash(std::size_t capacity) {
+    std::size_t n{std::max(MINIMUM_CAPACITY, m_Slots.size())};
+    while (n < capacity) {
+        n *= 2;
+    }
+    m_Slots.assign(n, 0);
+    m_Generation = 1;
+    m_Tombstones = 0;
+    for (std::size_t index = 0u; index < m_Counts.size(); ++index) {
+        std::size_t i{this->home(m_Counts[index].first)};
+        while (this->current(i)) {
+            i = (i + 1) & (n - 1);
+        }
+        this->point(i, index);
+    }
+}
+}
+}
@@ -183,7 +183,7 @@ void CPopulationModel::sample(core_t::TTime startTime,
     this->CAnomalyDetectorModel::sample(startTime, endTime, resourceMonitor);
 
     const CDataGatherer& gatherer = this->dataGatherer();
-    const CDataGatherer::TSizeSizePrUInt64UMap& counts = gatherer.bucketCounts(startTime);
+    const CPersonAttributeCounts& counts = gatherer.bucketCounts(startTime);
     for (const auto& count : counts) {
         std::size_t pid = CDataGatherer::extractPersonId(count);
         std::size_t cid = CDataGatherer::extractAttributeId(count);
@@ -418,6 +418,10 @@ void CPopulationModel::createUpdateNewModels(core_t::TTime time,
 }
 
 void CPopulationModel::createNewModels(std::size_t n, std::size_t m) {
+    std::size_t before{core::CMemory::dynamicSize(m_PersonLastBucketTimes) +
+                       core::CMemory::dynamicSize(m_AttributeFirstBucketTimes) +
+                       core::CMemory::dynamicSize(m_AttributeLastBucketTimes)};
+
     if (n > 0) {
         core::CAllocationStrategy::resize(m_PersonLastBucketTimes,
                                           n + m_PersonLastBucketTimes.size(),
@@ -437,6 +441,11 @@ void CPopulationModel::createNewModels(std::size_t n, std::size_t m) {
         }
     }
 
+    std::size_t after{core::CMemory::dynamicSize(m_PersonLastBucketTimes) +
+                      core::CMemory::dynamicSize(m_AttributeFirstBucketTimes) +
+                      core::CMemory::dynamicSize(m_AttributeLastBucketTimes)};
+    this->recordMemoryUsageChange(before, after);
+
     this->CAnomalyDetectorModel::createNewModels(n, m);
 }
 
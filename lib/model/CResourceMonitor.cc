@@ -6,19 +6,30 @@
 
 #include <model/CResourceMonitor.h>
 
+#include <core/CScopedFastLock.h>
 #include <core/CStatistics.h>
 #include <core/Constants.h>
 
+#include <maths/CTimeSeriesTestScheduler.h>
+
 #include <model/CAnomalyDetector.h>
 #include <model/CDataGatherer.h>
 #include <model/CStringStore.h>
 
 #include <algorithm>
+#include <cstddef>
 #include <limits>
 
 namespace ml {
 
 namespace model {
+namespace {
+//! Add \p delta to \p usage.
+std::size_t adjust(std::size_t usage, std::ptrdiff_t delta) {
+    return delta < 0 ? usage - std::min(usage, static_cast<std::size_t>(-delta))
+                     : usage + static_cast<std::size_t>(delta);
+}
+}
 
 // Only prune once per hour
 const core_t::TTime CResourceMonitor::MINIMUM_PRUNE_FREQUENCY(60 * 60);
@@ -26,11 +37,14 @@ const std::size_t CResourceMonitor::DEFAULT_MEMORY_LIMIT_MB(4096);
 const double CResourceMonitor::DEFAULT_BYTE_LIMIT_MARGIN(0.7);
 const core_t::TTime
     CResourceMonitor::MAXIMUM_BYTE_LIMIT_MARGIN_PERIOD(2 * core::constants::HOUR);
+const std::size_t CResourceMonitor::DEFAULT_FULL_AUDIT_PERIOD(10);
+const double CResourceMonitor::REFRESH_ERROR_FRACTION(0.01);
 
 CResourceMonitor::CResourceMonitor(double byteLimitMargin)
-    : m_AllowAllocations(true), m_ByteLimitMargin{byteLimitMargin},
-      m_ByteLimitHigh(0), m_ByteLimitLow(0), m_CurrentAnomalyDetectorMemory(0),
-      m_ExtraMemory(0), m_PreviousTotal(this->totalMemory()), m_Peak(m_PreviousTotal),
+    : m_FullAuditPeriod(DEFAULT_FULL_AUDIT_PERIOD), m_AllowAllocations(true),
+      m_ByteLimitMargin{byteLimitMargin}, m_ByteLimitHigh(0), m_ByteLimitLow(0),
+      m_CurrentAnomalyDetectorMemory(0), m_ErrorBound(0), m_ExtraMemory(0),
+      m_PreviousTotal(this->totalMemory()), m_Peak(m_PreviousTotal),
       m_LastAllocationFailureReport(0), m_MemoryStatus(model_t::E_MemoryStatusOk),
       m_HasPruningStarted(false), m_PruneThreshold(0), m_LastPruneTime(0),
       m_PruneWindow(std::numeric_limits<std::size_t>::max()),
@@ -45,10 +59,12 @@ void CResourceMonitor::memoryUsageReporter(const TMemoryUsageReporterFunc& repor
 
 void CResourceMonitor::registerComponent(CAnomalyDetector& detector) {
     LOG_TRACE(<< "Registering component: " << &detector);
-    m_Detectors.emplace(&detector, std::size_t(0));
+    core::CScopedFastLock lock(m_Mutex);
+    m_Detectors.emplace(&detector, SDetectorMemory());
 }
 
 void CResourceMonitor::unRegisterComponent(CAnomalyDetector& detector) {
+    core::CScopedFastLock lock(m_Mutex);
     auto itr = m_Detectors.find(&detector);
     if (itr == m_Detectors.end()) {
         LOG_ERROR(<< "Inconsistency - component has not been registered: " << &detector);
@@ -56,6 +72,7 @@ void CResourceMonitor::unRegisterComponent(CAnomalyDetector& detector) {
     }
 
     LOG_TRACE(<< "Unregistering component: " << &detector);
+    m_ErrorBound -= itr->second.s_ErrorBound;
     m_Detectors.erase(itr);
 }
 
@@ -100,19 +117,107 @@ model_t::EMemoryStatus CResourceMonitor::getMemoryStatus() {
 }
 
 void CResourceMonitor::refresh(CAnomalyDetector& detector) {
-    if (m_NoLimit) {
+    std::size_t usage{0};
+    bool auditDue{false};
+    {
+        core::CScopedFastLock lock(m_Mutex);
+        auto itr = m_Detectors.find(&detector);
+        if (itr == m_Detectors.end()) {
+            LOG_ERROR(<< "Inconsistency - component has not been registered: " << &detector);
+            return;
+        }
+        usage = itr->second.s_Usage;
+        auditDue = this->isAuditDue(itr->second);
+        if (auditDue == false) {
+            --itr->second.s_RefreshesUntilAudit;
+        }
+    }
+    if (auditDue) {
+        this->forceRefresh(detector);
         return;
     }
-    this->forceRefresh(detector);
+
+    // This only touches the detector so can be done without holding the lock.
+    std::ptrdiff_t delta{detector.takeMemoryUsageDelta()};
+    usage = adjust(usage, delta);
+    core::CScopedFastLock lock(m_Mutex);
+    this->memUsage(&detector, usage);
+    auto itr = m_Detectors.find(&detector);
+    if (itr != m_Detectors.end()) {
+        std::size_t error{static_cast<std::size_t>(
+            REFRESH_ERROR_FRACTION * static_cast<double>(usage))};
+        itr->second.s_ErrorBound += error;
+        m_ErrorBound += error;
+    }
+    core::CStatistics::stat(stat_t::E_MemoryUsage).set(this->totalMemory());
+    LOG_TRACE(<< "Checking allocations: currently at " << this->totalMemory());
+    this->updateAllowAllocations();
 }
 
 void CResourceMonitor::forceRefresh(CAnomalyDetector& detector) {
-    this->memUsage(&detector);
-    core::CStatistics::stat(stat_t::E_MemoryUsage).set(this->totalMemory());
+    // The recorded change is included in the audit so is discarded. The
+    // size calculation only touches the detector so can be done without
+    // holding the lock.
+    detector.takeMemoryUsageDelta();
+    this->audited(detector, core::CMemory::dynamicSize(&detector), true);
+}
+
+void CResourceMonitor::refreshRestored(CAnomalyDetector& detector) {
+    // Estimating the memory would count the estimates in the statistics
+    // restored with the detectors, so it's computed in full.
+    detector.takeMemoryUsageDelta();
+    this->audited(detector,
+                  core::CMemory::staticSize(detector) + detector.computeMemoryUsage(),
+                  false);
+}
+
+void CResourceMonitor::audited(CAnomalyDetector& detector,
+                               std::size_t usage,
+                               bool updateStatistic) {
+    core::CScopedFastLock lock(m_Mutex);
+    auto itr = m_Detectors.find(&detector);
+    if (itr != m_Detectors.end()) {
+        itr->second.s_RefreshesUntilAudit = m_FullAuditPeriod - 1;
+        m_ErrorBound -= itr->second.s_ErrorBound;
+        itr->second.s_ErrorBound = 0;
+    }
+    this->memUsage(&detector, usage);
+    if (updateStatistic) {
+        core::CStatistics::stat(stat_t::E_MemoryUsage).set(this->totalMemory());
+    }
     LOG_TRACE(<< "Checking allocations: currently at " << this->totalMemory());
     this->updateAllowAllocations();
 }
 
+void CResourceMonitor::fullAuditPeriod(std::size_t period) {
+    core::CScopedFastLock lock(m_Mutex);
+    m_FullAuditPeriod = std::max(period, std::size_t(1));
+    for (auto& detector : m_Detectors) {
+        detector.second.s_RefreshesUntilAudit =
+            std::min(detector.second.s_RefreshesUntilAudit, m_FullAuditPeriod - 1);
+    }
+}
+
+bool CResourceMonitor::isAuditDue(const SDetectorMemory& memory) const {
+    if (memory.s_RefreshesUntilAudit == 0) {
+        return true;
+    }
+    if (m_NoLimit) {
+        return false;
+    }
+    // Audit if the error in the recorded changes, including those of this
+    // refresh, means the usage could be on the other side of the limit
+    // which decides whether to allow allocations or of the prune threshold.
+    std::size_t total{this->totalMemory()};
+    std::size_t error{m_ErrorBound + static_cast<std::size_t>(REFRESH_ERROR_FRACTION *
+                                                              static_cast<double>(memory.s_Usage))};
+    auto isWithinError = [total, error](std::size_t limit) {
+        return total + error >= limit && total <= limit + error;
+    };
+    return isWithinError(m_AllowAllocations ? this->highLimit() : this->lowLimit()) ||
+           isWithinError(m_PruneThreshold);
+}
+
 void CResourceMonitor::updateAllowAllocations() {
     std::size_t total{this->totalMemory()};
     if (m_AllowAllocations) {
@@ -165,14 +270,15 @@ bool CResourceMonitor::pruneIfRequired(core_t::TTime endTime) {
     }
 
     if (aboveThreshold) {
-        // Do a prune and see how much we got back
-        // These are the expensive operations
+        // Do a prune and see how much we got back. Pruning records the
+        // memory it frees so we don't need to audit every detector.
         std::size_t usageAfter = 0;
         for (auto& detector : m_Detectors) {
             const auto& model = detector.first->model();
             model->prune(m_PruneWindow);
-            detector.second = core::CMemory::dynamicSize(detector.first);
-            usageAfter += detector.second;
+            detector.second.s_Usage = adjust(detector.second.s_Usage,
+                                             detector.first->takeMemoryUsageDelta());
+            usageAfter += detector.second.s_Usage;
         }
         m_CurrentAnomalyDetectorMemory = usageAfter;
         total = this->totalMemory();
@@ -200,11 +306,22 @@ bool CResourceMonitor::pruneIfRequired(core_t::TTime endTime) {
     return aboveThreshold;
 }
 
+bool CResourceMonitor::hasHeadroomForConcurrentUpdates() const {
+    if (m_NoLimit) {
+        return true;
+    }
+    core::CScopedFastLock lock(m_Mutex);
+    return m_AllowAllocations && m_MemoryStatus == model_t::E_MemoryStatusOk &&
+           this->totalMemory() < m_PruneThreshold;
+}
+
 bool CResourceMonitor::areAllocationsAllowed() const {
+    core::CScopedFastLock lock(m_Mutex);
     return m_AllowAllocations;
 }
 
 bool CResourceMonitor::areAllocationsAllowed(std::size_t size) const {
+    core::CScopedFastLock lock(m_Mutex);
     if (m_AllowAllocations) {
         return this->totalMemory() + size < this->highLimit();
     }
@@ -212,18 +329,19 @@ bool CResourceMonitor::areAllocationsAllowed(std::size_t size) const {
 }
 
 std::size_t CResourceMonitor::allocationLimit() const {
+    core::CScopedFastLock lock(m_Mutex);
     return this->highLimit() - std::min(this->highLimit(), this->totalMemory());
 }
 
-void CResourceMonitor::memUsage(CAnomalyDetector* detector) {
+void CResourceMonitor::memUsage(CAnomalyDetector* detector, std::size_t usage) {
     auto itr = m_Detectors.find(detector);
     if (itr == m_Detectors.end()) {
         LOG_ERROR(<< "Inconsistency - component has not been registered: " << detector);
         return;
     }
-    std::size_t modelPreviousUsage = itr->second;
-    std::size_t modelCurrentUsage = core::CMemory::dynamicSize(itr->first);
-    itr->second = modelCurrentUsage;
+    std::size_t modelPreviousUsage = itr->second.s_Usage;
+    std::size_t modelCurrentUsage = usage;
+    itr->second.s_Usage = modelCurrentUsage;
     m_CurrentAnomalyDetectorMemory += (modelCurrentUsage - modelPreviousUsage);
 }
 
@@ -278,10 +396,14 @@ CResourceMonitor::SResults CResourceMonitor::createMemoryUsageReport(core_t::TTi
         res.s_ByFields += dataGatherer.numberByFieldValues();
     }
     res.s_AllocationFailures += m_AllocationFailures.size();
+    const maths::CTimeSeriesTestScheduler& scheduler{maths::CTimeSeriesTestScheduler::instance()};
+    res.s_DeferredSeasonalityTests = scheduler.numberDeferredTests();
+    res.s_SeasonalityTestTime = scheduler.lastBucketTestTime();
     return res;
 }
 
 void CResourceMonitor::acceptAllocationFailureResult(core_t::TTime time) {
+    core::CScopedFastLock lock(m_Mutex);
     m_MemoryStatus = model_t::E_MemoryStatusHardLimit;
     ++m_AllocationFailures[time];
 }
@@ -297,11 +419,19 @@ bool CResourceMonitor::haveNoLimit() const {
 }
 
 void CResourceMonitor::addExtraMemory(std::size_t mem) {
+    core::CScopedFastLock lock(m_Mutex);
     m_ExtraMemory += mem;
     this->updateAllowAllocations();
 }
 
+void CResourceMonitor::removeExtraMemory(std::size_t mem) {
+    core::CScopedFastLock lock(m_Mutex);
+    m_ExtraMemory -= std::min(m_ExtraMemory, mem);
+    this->updateAllowAllocations();
+}
+
 void CResourceMonitor::clearExtraMemory() {
+    core::CScopedFastLock lock(m_Mutex);
     if (m_ExtraMemory != 0) {
         m_ExtraMemory = 0;
         this->updateAllowAllocations();
@@ -50,5 +50,23 @@ CSimpleCountDetector::preprocessFieldValues(const TStrCPtrVec& fieldValues) {
 
     return m_FieldValues;
 }
+
+const CAnomalyDetector::TStrCPtrVecVec&
+CSimpleCountDetector::preprocessFieldValues(std::size_t numberRecords,
+                                            const TStrCPtrVecVec& fieldValues) {
+    // Preprocess every record in the batch as for a single record
+    m_FieldValueColumns.resize(m_FieldValues.size());
+    if (m_FieldValueColumns.size() > 0) {
+        m_FieldValueColumns[0].assign(numberRecords, m_FieldValues[0]);
+    }
+    if (m_FieldValueColumns.size() > 1) {
+        if (fieldValues.size() > 1) {
+            m_FieldValueColumns[1] = fieldValues[1];
+        } else {
+            m_FieldValueColumns[1].assign(numberRecords, &EMPTY_STRING);
+        }
+    }
+    return m_FieldValueColumns;
+}
 }
 }
@@ -76,6 +76,10 @@ void CAnomalyDetectorModelConfigTest::testNormal() {
                              config.factory(1, POPULATION_COUNT)->componentSize());
         CPPUNIT_ASSERT_EQUAL(std::size_t(10),
                              config.factory(1, POPULATION_METRIC)->componentSize());
+        CPPUNIT_ASSERT(config.factory(1, INDIVIDUAL_COUNT)->lazyPriorUpdates());
+        CPPUNIT_ASSERT(config.factory(1, INDIVIDUAL_METRIC)->lazyPriorUpdates());
+        CPPUNIT_ASSERT(config.factory(1, POPULATION_COUNT)->lazyPriorUpdates());
+        CPPUNIT_ASSERT(config.factory(1, POPULATION_METRIC)->lazyPriorUpdates());
         CPPUNIT_ASSERT_EQUAL(std::size_t(20),
                              config.factory(1, INDIVIDUAL_COUNT)->modelParams().s_SampleCountFactor);
         CPPUNIT_ASSERT_EQUAL(std::size_t(20),
@@ -84,6 +88,8 @@ void CAnomalyDetectorModelConfigTest::testNormal() {
                              config.factory(1, POPULATION_COUNT)->modelParams().s_SampleCountFactor);
         CPPUNIT_ASSERT_EQUAL(std::size_t(20),
                              config.factory(1, POPULATION_METRIC)->modelParams().s_SampleCountFactor);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(3), config.maximumTestDelay());
+        CPPUNIT_ASSERT_EQUAL(std::size_t(50000), config.bucketTestBudget());
         TDoubleVec params;
         for (std::size_t i = 0u; i < model_t::NUMBER_AGGREGATION_STYLES; ++i) {
             for (std::size_t j = 0u; j < model_t::NUMBER_AGGREGATION_PARAMS; ++j) {
@@ -213,6 +219,10 @@ void CAnomalyDetectorModelConfigTest::testErrors() {
                              config1.factory(1, POPULATION_COUNT)->componentSize());
         CPPUNIT_ASSERT_EQUAL(config2.factory(1, POPULATION_METRIC)->componentSize(),
                              config1.factory(1, POPULATION_METRIC)->componentSize());
+        CPPUNIT_ASSERT_EQUAL(config2.factory(1, INDIVIDUAL_COUNT)->lazyPriorUpdates(),
+                             config1.factory(1, INDIVIDUAL_COUNT)->lazyPriorUpdates());
+        CPPUNIT_ASSERT_EQUAL(config2.factory(1, POPULATION_METRIC)->lazyPriorUpdates(),
+                             config1.factory(1, POPULATION_METRIC)->lazyPriorUpdates());
         CPPUNIT_ASSERT_EQUAL(
             config2.factory(1, INDIVIDUAL_COUNT)->modelParams().s_SampleCountFactor,
             config1.factory(1, INDIVIDUAL_COUNT)->modelParams().s_SampleCountFactor);
@@ -225,6 +235,8 @@ void CAnomalyDetectorModelConfigTest::testErrors() {
         CPPUNIT_ASSERT_EQUAL(
             config2.factory(1, POPULATION_METRIC)->modelParams().s_SampleCountFactor,
             config1.factory(1, POPULATION_METRIC)->modelParams().s_SampleCountFactor);
+        CPPUNIT_ASSERT_EQUAL(config2.maximumTestDelay(), config1.maximumTestDelay());
+        CPPUNIT_ASSERT_EQUAL(config2.bucketTestBudget(), config1.bucketTestBudget());
         for (std::size_t i = 0u; i < model_t::NUMBER_AGGREGATION_STYLES; ++i) {
             for (std::size_t j = 0u; j < model_t::NUMBER_AGGREGATION_PARAMS; ++j) {
                 CPPUNIT_ASSERT_EQUAL(config2.aggregationStyleParam(
@@ -10,6 +10,8 @@
 #include <core/CJsonStatePersistInserter.h>
 #include <core/CJsonStateRestoreTraverser.h>
 #include <core/CLogger.h>
+#include <core/CStaticThreadPool.h>
+#include <core/CStopWatch.h>
 #include <core/CStringUtils.h>
 
 #include <maths/CTools.h>
@@ -606,6 +608,79 @@ void CAnomalyScoreTest::testNormalizeScoresOrdering() {
     }
 }
 
+void CAnomalyScoreTest::testNormalizeScoresLookup() {
+    // Test that the normalized scores looked up match the scores computed
+    // directly from the quantile summaries as they are updated and aged
+    // and that looking them up from multiple threads gives the same scores.
+
+    test::CRandomNumbers rng;
+
+    TDoubleVec scores;
+    rng.generateGammaSamples(1.0, 2.0, 3000, scores);
+    TDoubleVec anomalies;
+    rng.generateUniformSamples(20.0, 80.0, 30, anomalies);
+    for (std::size_t i = 0u; i < anomalies.size(); ++i) {
+        scores[100 * i + 50] = anomalies[i];
+    }
+
+    model::CAnomalyDetectorModelConfig config =
+        model::CAnomalyDetectorModelConfig::defaultConfig(300);
+    model::CAnomalyScore::CNormalizer normalizer(config);
+    normalizer.isForMembersOfPopulation(false);
+
+    TDoubleVec samples;
+    for (std::size_t i = 0u; i < scores.size(); ++i) {
+        normalizer.updateQuantiles({"", "", "", ""}, scores[i]);
+        normalizer.propagateForwardByTime(1.0);
+
+        if (i % 100 == 99) {
+            rng.generateUniformSamples(0.0, 100.0, 200, samples);
+            normalizer.refreshLookup();
+            for (auto sample : samples) {
+                uint32_t discreteScore = normalizer.discreteScore(sample);
+                CPPUNIT_ASSERT_EQUAL(normalizer.quantileScoreCeiling(discreteScore),
+                                     normalizer.lookupQuantileScoreCeiling(discreteScore));
+            }
+            // Check the interval end points.
+            for (auto discreteScore : normalizer.m_LookupIntervals) {
+                for (auto x : {discreteScore, discreteScore + 1}) {
+                    CPPUNIT_ASSERT_EQUAL(normalizer.quantileScoreCeiling(x),
+                                         normalizer.lookupQuantileScoreCeiling(x));
+                }
+            }
+        }
+    }
+    LOG_DEBUG(<< "# intervals = " << normalizer.m_LookupIntervals.size());
+
+    rng.generateUniformSamples(0.0, 100.0, 20000, samples);
+
+    core::CStopWatch watch{true};
+    for (auto sample : samples) {
+        normalizer.quantileScoreCeiling(normalizer.discreteScore(sample));
+    }
+    std::uint64_t directTime{watch.stop()};
+
+    TDoubleVec expected(samples);
+    for (auto& score : expected) {
+        CPPUNIT_ASSERT(normalizer.normalize({"", "", "bucket_time", ""}, score));
+    }
+    watch.reset(true);
+    for (auto score : samples) {
+        normalizer.normalize({"", "", "bucket_time", ""}, score);
+    }
+    std::uint64_t lookupTime{watch.stop()};
+    LOG_DEBUG(<< "direct = " << directTime << "ms, lookup = " << lookupTime << "ms");
+
+    // Check normalizing concurrently starting from an empty lookup table.
+    normalizer.m_LookupIsCurrent.store(false);
+    TDoubleVec actual(samples);
+    core::CStaticThreadPool pool{3};
+    pool.parallelForEach(actual.size(), [&normalizer, &actual](std::size_t i) {
+        normalizer.normalize({"", "", "bucket_time", ""}, actual[i]);
+    });
+    CPPUNIT_ASSERT(expected == actual);
+}
+
 void CAnomalyScoreTest::testNormalizerGetMaxScore() {
     test::CRandomNumbers rng;
 
@@ -834,6 +909,9 @@ CppUnit::Test* CAnomalyScoreTest::suite() {
     suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyScoreTest>(
         "CAnomalyScoreTest::testNormalizeScoresOrdering",
         &CAnomalyScoreTest::testNormalizeScoresOrdering));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyScoreTest>(
+        "CAnomalyScoreTest::testNormalizeScoresLookup",
+        &CAnomalyScoreTest::testNormalizeScoresLookup));
     suiteOfTests->addTest(new CppUnit::TestCaller<CAnomalyScoreTest>(
         "CAnomalyScoreTest::testNormalizerGetMaxScore",
         &CAnomalyScoreTest::testNormalizerGetMaxScore));
@@ -24,6 +24,7 @@ public:
     void testNormalizeScoresPerPartitionMaxScore();
     void testNormalizeScoresNearZero();
     void testNormalizeScoresOrdering();
+    void testNormalizeScoresLookup();
     void testNormalizerGetMaxScore();
     void testJsonConversion();
     void testPersistEmpty();
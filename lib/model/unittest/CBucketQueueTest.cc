@@ -6,6 +6,7 @@
 
 #include "CBucketQueueTest.h"
 
+#include <core/CContainerPrinter.h>
 #include <core/CJsonStatePersistInserter.h>
 #include <core/CJsonStateRestoreTraverser.h>
 #include <core/CLogger.h>
@@ -171,6 +172,34 @@ void CBucketQueueTest::testBucketQueueUMap() {
     }
 }
 
+void CBucketQueueTest::testRecycle() {
+    // Test that recycling reuses the earliest bucket's item.
+
+    using TSizeVec = std::vector<std::size_t>;
+
+    CBucketQueue<TSizeVec> queue(2, 5, 0);
+    queue.latest().assign(10, 0);
+    queue.push(TSizeVec(1, 0), 5);
+    queue.latest().assign(10, 5);
+    queue.push(TSizeVec(1, 0), 10);
+    queue.earliest().reserve(100);
+    const std::size_t* earliest{queue.earliest().data()};
+
+    queue.recycle(15, [](TSizeVec& item) { item.clear(); });
+    CPPUNIT_ASSERT_EQUAL(std::size_t(3), queue.size());
+    CPPUNIT_ASSERT_EQUAL(core_t::TTime(19), queue.latestBucketEnd());
+    CPPUNIT_ASSERT(queue.latest().empty());
+    CPPUNIT_ASSERT(queue.latest().capacity() >= 100);
+    CPPUNIT_ASSERT(earliest == queue.latest().data());
+    CPPUNIT_ASSERT_EQUAL(std::string("[5, 5, 5, 5, 5, 5, 5, 5, 5, 5]"),
+                         core::CContainerPrinter::print(queue.earliest()));
+
+    // Recycling at an earlier time is ignored.
+    queue.recycle(17, [](TSizeVec& item) { item.push_back(1); });
+    CPPUNIT_ASSERT_EQUAL(core_t::TTime(19), queue.latestBucketEnd());
+    CPPUNIT_ASSERT(queue.latest().empty());
+}
+
 CppUnit::Test* CBucketQueueTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CBucketQueueTest");
 
@@ -193,6 +222,8 @@ CppUnit::Test* CBucketQueueTest::suite() {
         "CBucketQueueTest::testReverseIterators", &CBucketQueueTest::testReverseIterators));
     suiteOfTests->addTest(new CppUnit::TestCaller<CBucketQueueTest>(
         "CBucketQueueTest::testBucketQueueUMap", &CBucketQueueTest::testBucketQueueUMap));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CBucketQueueTest>(
+        "CBucketQueueTest::testRecycle", &CBucketQueueTest::testRecycle));
 
     return suiteOfTests;
 }
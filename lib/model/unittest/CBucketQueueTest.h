@@ -18,6 +18,7 @@ public:
     void testIterators();
     void testReverseIterators();
     void testBucketQueueUMap();
+    void testRecycle();
 
     static CppUnit::Test* suite();
 };
@@ -107,7 +107,7 @@ public:
 
 private:
     const ml::model::CAnomalyDetectorModelConfig& m_ModelConfig;
-    ml::model::CLimits m_Limits;
+    const ml::model::CLimits& m_Limits;
     std::size_t m_Calls;
     TTimeStrPrSet m_AllAnomalies;
     TTimeDoubleMap m_AnomalyScores;
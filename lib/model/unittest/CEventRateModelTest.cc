@@ -11,6 +11,7 @@
 #include <core/CRapidXmlStatePersistInserter.h>
 #include <core/CRapidXmlStateRestoreTraverser.h>
 #include <core/CSmallVector.h>
+#include <core/CStaticThreadPool.h>
 #include <core/Constants.h>
 #include <core/CoreTypes.h>
 
@@ -2929,6 +2930,58 @@ void CEventRateModelTest::testIgnoreSamplingGivenDetectionRules() {
     CPPUNIT_ASSERT_EQUAL(time, timeSeriesModel->trendModel().lastValueTime());
 }
 
+void CEventRateModelTest::testSampleConcurrently() {
+    // Check that sampling people's models on a thread pool gives exactly
+    // the same models as sampling them on the calling thread. Each person
+    // draws from their own random number stream, so this holds whichever
+    // thread samples them.
+
+    core_t::TTime startTime = 0;
+    core_t::TTime bucketLength = 600;
+    std::size_t numberPeople = 1000;
+    model_t::TFeatureVec features{model_t::E_IndividualCountByBucketAndPerson,
+                                  model_t::E_IndividualTotalBucketCountByPerson};
+
+    core::CStaticThreadPool threadPool{3};
+
+    SModelParams params(bucketLength);
+    auto interimBucketCorrector = std::make_shared<CInterimBucketCorrector>(bucketLength);
+    CEventRateModelFactory factory(params, interimBucketCorrector);
+    factory.features(features);
+    CModelFactory::TDataGathererPtr gatherer(factory.makeDataGatherer(startTime));
+    CModelFactory::TModelPtr model(factory.makeModel(gatherer));
+
+    params.s_ThreadPool = &threadPool;
+    CEventRateModelFactory concurrentFactory(params, interimBucketCorrector);
+    concurrentFactory.features(features);
+    CModelFactory::TDataGathererPtr concurrentGatherer(
+        concurrentFactory.makeDataGatherer(startTime));
+    CModelFactory::TModelPtr concurrentModel(concurrentFactory.makeModel(concurrentGatherer));
+
+    TStrVec people;
+    for (std::size_t i = 0u; i < numberPeople; ++i) {
+        people.push_back("p" + core::CStringUtils::typeToString(i));
+    }
+
+    test::CRandomNumbers rng;
+
+    test::CRandomNumbers::TUIntVec counts;
+    for (core_t::TTime time = startTime; time < startTime + 100 * bucketLength;
+         time += bucketLength) {
+        rng.generatePoissonSamples(3.0, numberPeople, counts);
+        for (std::size_t i = 0u; i < numberPeople; ++i) {
+            for (unsigned int j = 0u; j < counts[i]; ++j) {
+                addArrival(*gatherer, m_ResourceMonitor, time + 10 * j, people[i]);
+                addArrival(*concurrentGatherer, m_ResourceMonitor, time + 10 * j, people[i]);
+            }
+        }
+        model->sample(time, time + bucketLength, m_ResourceMonitor);
+        concurrentModel->sample(time, time + bucketLength, m_ResourceMonitor);
+    }
+
+    CPPUNIT_ASSERT_EQUAL(model->checksum(), concurrentModel->checksum());
+}
+
 CppUnit::Test* CEventRateModelTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CEventRateModelTest");
 
@@ -2988,6 +3041,9 @@ CppUnit::Test* CEventRateModelTest::suite() {
     suiteOfTests->addTest(new CppUnit::TestCaller<CEventRateModelTest>(
         "CEventRateModelTest::testIgnoreSamplingGivenDetectionRules",
         &CEventRateModelTest::testIgnoreSamplingGivenDetectionRules));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CEventRateModelTest>(
+        "CEventRateModelTest::testSampleConcurrently",
+        &CEventRateModelTest::testSampleConcurrently));
     return suiteOfTests;
 }
 
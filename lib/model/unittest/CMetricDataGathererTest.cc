@@ -11,6 +11,7 @@
 #include <core/CRapidXmlParser.h>
 #include <core/CRapidXmlStatePersistInserter.h>
 #include <core/CRapidXmlStateRestoreTraverser.h>
+#include <core/CStopWatch.h>
 #include <core/CStringUtils.h>
 #include <core/CoreTypes.h>
 
@@ -42,6 +43,12 @@ using TSizeFeatureDataPr = std::pair<std::size_t, SMetricFeatureData>;
 using TSizeFeatureDataPrVec = std::vector<TSizeFeatureDataPr>;
 using TFeatureSizeFeatureDataPrVecPr = std::pair<model_t::EFeature, TSizeFeatureDataPrVec>;
 using TFeatureSizeFeatureDataPrVecPrVec = std::vector<TFeatureSizeFeatureDataPrVecPr>;
+using TSizeSizePrFeatureDataPr = std::pair<TSizeSizePr, SMetricFeatureData>;
+using TSizeSizePrFeatureDataPrVec = std::vector<TSizeSizePrFeatureDataPr>;
+using TFeatureSizeSizePrFeatureDataPrVecPr =
+    std::pair<model_t::EFeature, TSizeSizePrFeatureDataPrVec>;
+using TFeatureSizeSizePrFeatureDataPrVecPrVec =
+    std::vector<TFeatureSizeSizePrFeatureDataPrVecPr>;
 using TOptionalDouble = boost::optional<double>;
 using TOptionalStr = boost::optional<std::string>;
 using TTimeDoublePr = std::pair<core_t::TTime, double>;
@@ -1901,6 +1908,305 @@ void CMetricDataGathererTest::testVarp() {
     }
 }
 
+void CMetricDataGathererTest::testPerformance() {
+    // Measure the memory used per series and the rate at which records
+    // are added and feature data are extracted for many series.
+
+    const core_t::TTime startTime{0};
+    const core_t::TTime bucketLength{600};
+    const std::size_t numberBuckets{5};
+    const std::size_t numberRecordsPerBucket{3};
+
+    test::CRandomNumbers rng;
+
+    auto run = [&](model_t::EAnalysisCategory gathererType, const TFeatureVec& features,
+                   std::size_t numberPeople, std::size_t numberAttributes) {
+        bool isPopulation{gathererType == model_t::E_PopulationMetric};
+
+        TStrVec people;
+        TStrVec attributes;
+        TStrVec values;
+        for (std::size_t i = 0u; i < numberPeople; ++i) {
+            people.push_back("p" + core::CStringUtils::typeToString(i));
+        }
+        for (std::size_t i = 0u; i < numberAttributes; ++i) {
+            attributes.push_back("a" + core::CStringUtils::typeToString(i));
+        }
+        TDoubleVec samples;
+        rng.generateNormalSamples(10.0, 4.0, 100, samples);
+        for (auto sample : samples) {
+            values.push_back(core::CStringUtils::typeToString(sample));
+        }
+
+        SModelParams params(bucketLength);
+        CDataGatherer gatherer(gathererType, model_t::E_None, params, EMPTY_STRING,
+                               EMPTY_STRING, EMPTY_STRING, EMPTY_STRING, EMPTY_STRING,
+                               {}, KEY, features, startTime, 0);
+
+        core::CStopWatch addWatch;
+        core::CStopWatch featureWatch;
+        uint64_t addTime{0};
+        uint64_t featureTime{0};
+        std::size_t numberRecords{0};
+        for (std::size_t bucket = 0u; bucket < numberBuckets; ++bucket) {
+            core_t::TTime bucketStart{startTime +
+                                      static_cast<core_t::TTime>(bucket) * bucketLength};
+            addWatch.start();
+            for (std::size_t i = 0u; i < numberRecordsPerBucket; ++i) {
+                core_t::TTime time{bucketStart + static_cast<core_t::TTime>(i) * 100};
+                for (std::size_t pid = 0u; pid < numberPeople; ++pid) {
+                    for (std::size_t cid = 0u; cid < numberAttributes; ++cid) {
+                        CDataGatherer::TStrCPtrVec fieldValues{&people[pid]};
+                        if (isPopulation) {
+                            fieldValues.push_back(&attributes[cid]);
+                        }
+                        fieldValues.push_back(&values[(pid + cid + i) % values.size()]);
+                        CEventData eventData;
+                        eventData.time(time);
+                        gatherer.addArrival(fieldValues, eventData, m_ResourceMonitor);
+                        ++numberRecords;
+                    }
+                }
+            }
+            addTime = addWatch.stop();
+
+            featureWatch.start();
+            TFeatureSizeFeatureDataPrVecPrVec featureData;
+            TFeatureSizeSizePrFeatureDataPrVecPrVec populationFeatureData;
+            if (isPopulation) {
+                gatherer.featureData(bucketStart, bucketLength, populationFeatureData);
+                CPPUNIT_ASSERT_EQUAL(numberPeople * numberAttributes,
+                                     populationFeatureData[0].second.size());
+            } else {
+                gatherer.featureData(bucketStart, bucketLength, featureData);
+                CPPUNIT_ASSERT_EQUAL(numberPeople, featureData[0].second.size());
+            }
+            featureTime = featureWatch.stop();
+        }
+
+        std::size_t numberSeries{numberPeople * numberAttributes};
+        LOG_DEBUG(<< "# series = " << numberSeries << ", memory per series = "
+                  << gatherer.memoryUsage() / numberSeries << " bytes");
+        LOG_DEBUG(<< "add time = " << addTime << "ms, records/sec = "
+                  << 1000.0 * static_cast<double>(numberRecords) /
+                         static_cast<double>(std::max(addTime, uint64_t(1))));
+        LOG_DEBUG(<< "feature data time = " << featureTime << "ms");
+    };
+
+    LOG_DEBUG(<< "individual");
+    run(model_t::E_Metric,
+        {model_t::E_IndividualMeanByPerson, model_t::E_IndividualMinByPerson,
+         model_t::E_IndividualMaxByPerson},
+        20000, 1);
+    LOG_DEBUG(<< "population");
+    run(model_t::E_PopulationMetric,
+        {model_t::E_PopulationMeanByPersonAndAttribute,
+         model_t::E_PopulationMinByPersonAndAttribute,
+         model_t::E_PopulationMaxByPersonAndAttribute},
+        2000, 10);
+}
+
+void CMetricDataGathererTest::testIncrementalMemoryUsage() {
+    // Check that the memory usage changes the gatherer records as values
+    // are added, buckets are sampled and people are pruned sum to the
+    // change in its full memory usage.
+
+    const core_t::TTime startTime{0};
+    const core_t::TTime bucketLength{600};
+    const std::size_t numberPeople{50};
+    const std::size_t numberBuckets{10};
+
+    test::CRandomNumbers rng;
+
+    TFeatureVec features{model_t::E_IndividualMeanByPerson, model_t::E_IndividualMinByPerson,
+                         model_t::E_IndividualMaxByPerson,
+                         model_t::E_IndividualSumByBucketAndPerson};
+    TStrVec influencerNames{"i1", "i2"};
+    SModelParams params(bucketLength);
+    CDataGatherer gatherer(model_t::E_Metric, model_t::E_None, params, EMPTY_STRING,
+                           EMPTY_STRING, EMPTY_STRING, EMPTY_STRING, EMPTY_STRING,
+                           influencerNames, KEY, features, startTime, 2u);
+
+    gatherer.takeMemoryUsageDelta();
+    std::ptrdiff_t incremental{static_cast<std::ptrdiff_t>(gatherer.memoryUsage())};
+    auto checkIncremental = [&](const std::string& stage) {
+        incremental += gatherer.takeMemoryUsageDelta();
+        std::ptrdiff_t full{static_cast<std::ptrdiff_t>(gatherer.memoryUsage())};
+        LOG_DEBUG(<< stage << ": incremental = " << incremental << ", full = " << full);
+        CPPUNIT_ASSERT_EQUAL(full, incremental);
+    };
+
+    TStrVec people;
+    for (std::size_t i = 0u; i < numberPeople; ++i) {
+        people.push_back("p" + core::CStringUtils::typeToString(i));
+    }
+
+    core_t::TTime time{startTime};
+    for (std::size_t bucket = 0u; bucket < numberBuckets; ++bucket) {
+        core_t::TTime bucketStart{startTime + static_cast<core_t::TTime>(bucket) * bucketLength};
+
+        TSizeVec counts;
+        rng.generateUniformSamples(0, 3 * numberPeople, 1, counts);
+        for (std::size_t i = 0u; i < counts[0]; ++i) {
+            TSizeVec person;
+            rng.generateUniformSamples(0, numberPeople, 1, person);
+            TSizeVec influences;
+            rng.generateUniformSamples(0, 20, 2, influences);
+            TDoubleVec value;
+            rng.generateNormalSamples(10.0, 4.0, 1, value);
+            std::string influencer1{"i1" + core::CStringUtils::typeToString(influences[0])};
+            std::string influencer2{
+                influences[1] < 5 ? EMPTY_STRING
+                                  : "i2" + core::CStringUtils::typeToString(influences[1])};
+            addArrival(gatherer, m_ResourceMonitor, time, people[person[0]],
+                       value[0], influencer1, influencer2);
+            time = std::min(time + 1, bucketStart + bucketLength - 1);
+        }
+        checkIncremental("add");
+
+        if (bucket == numberBuckets / 2) {
+            gatherer.resetBucket(bucketStart);
+            checkIncremental("reset");
+        }
+
+        gatherer.sampleNow(bucketStart);
+        checkIncremental("sample");
+
+        time = bucketStart + bucketLength;
+        gatherer.timeNow(time);
+        checkIncremental("new bucket");
+    }
+
+    std::ptrdiff_t beforePruning{incremental};
+
+    gatherer.recyclePeople({0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+    checkIncremental("recycle people");
+
+    gatherer.removePeople(numberPeople - 10);
+    checkIncremental("remove people");
+
+    gatherer.releaseMemory(time + 100 * bucketLength);
+    checkIncremental("release memory");
+
+    CPPUNIT_ASSERT(incremental < beforePruning);
+}
+
+void CMetricDataGathererTest::testAddArrivals() {
+    // Test that adding batches of records gives the same result as adding
+    // each record in turn, including for missing fields, new people and
+    // attributes in the middle of a batch and runs of records which share
+    // a person or attribute.
+
+    const core_t::TTime startTime{0};
+    const core_t::TTime bucketLength{600};
+    const std::size_t numberBuckets{10};
+    const std::size_t numberRecordsPerBucket{500};
+
+    test::CRandomNumbers rng;
+
+    TStrVec people;
+    TStrVec attributes;
+    TStrVec influences;
+    TStrVec values;
+    for (std::size_t i = 0u; i < 50; ++i) {
+        people.push_back("p" + core::CStringUtils::typeToString(i));
+    }
+    for (std::size_t i = 0u; i < 5; ++i) {
+        attributes.push_back("a" + core::CStringUtils::typeToString(i));
+        influences.push_back("i" + core::CStringUtils::typeToString(i));
+    }
+    TDoubleVec samples;
+    rng.generateNormalSamples(10.0, 4.0, 100, samples);
+    for (auto sample : samples) {
+        values.push_back(core::CStringUtils::typeToString(sample));
+    }
+
+    TFeatureVec features{model_t::E_PopulationMeanByPersonAndAttribute,
+                         model_t::E_PopulationMaxByPersonAndAttribute};
+    SModelParams params(bucketLength);
+    CDataGatherer expected(model_t::E_PopulationMetric, model_t::E_None, params,
+                           EMPTY_STRING, EMPTY_STRING, "p", "a", "v", {"i"}, KEY,
+                           features, startTime, 0);
+    CDataGatherer actual(model_t::E_PopulationMetric, model_t::E_None, params,
+                         EMPTY_STRING, EMPTY_STRING, "p", "a", "v", {"i"}, KEY,
+                         features, startTime, 0);
+    CResourceMonitor expectedResourceMonitor;
+    CResourceMonitor actualResourceMonitor;
+
+    TStrVec peopleCopies(people);
+    TStrVec attributeCopies(attributes);
+
+    TSizeVec choices;
+    TSizeVec batchSizes;
+    CDataGatherer::TTimeVec times;
+    CDataGatherer::TStrCPtrVecVec fieldValues(4);
+    std::size_t person{0};
+    std::size_t attribute{0};
+    std::size_t numberAdded{0};
+
+    for (std::size_t bucket = 0u; bucket < numberBuckets; ++bucket) {
+        core_t::TTime bucketStart{startTime + static_cast<core_t::TTime>(bucket) * bucketLength};
+
+        // New people arrive throughout.
+        std::size_t numberPeople{5 * (bucket + 1)};
+        rng.generateUniformSamples(0, 100, 4 * numberRecordsPerBucket, choices);
+        rng.generateUniformSamples(1, 50, numberRecordsPerBucket, batchSizes);
+
+        for (std::size_t i = 0u, j = 0u; i < numberRecordsPerBucket; ++j) {
+            times.clear();
+            for (auto& field : fieldValues) {
+                field.clear();
+            }
+            for (std::size_t k = 0u; k < batchSizes[j] && i < numberRecordsPerBucket; ++i, ++k) {
+                const std::size_t* choice{&choices[4 * i]};
+                core_t::TTime time{bucketStart +
+                                   static_cast<core_t::TTime>(i) * bucketLength /
+                                       static_cast<core_t::TTime>(numberRecordsPerBucket)};
+
+                // Records often share the previous record's person or
+                // attribute, whose value is stored in a different string
+                // every other record.
+                person = choice[0] < 40 ? person : choice[0] % numberPeople;
+                attribute = choice[1] < 40 ? attribute : choice[1] % 5;
+                const TStrVec& names{i % 2 == 0 ? people : peopleCopies};
+                const TStrVec& categories{i % 2 == 0 ? attributes : attributeCopies};
+                CDataGatherer::TStrCPtrVec record{
+                    &names[person], &categories[attribute],
+                    choice[2] < 20 ? nullptr : &influences[choice[2] % 5],
+                    choice[3] < 5 ? nullptr : &values[choice[3]]};
+
+                CEventData eventData;
+                eventData.time(time);
+                expected.addArrival(record, eventData, expectedResourceMonitor);
+
+                times.push_back(time);
+                for (std::size_t field = 0u; field < record.size(); ++field) {
+                    fieldValues[field].push_back(record[field]);
+                }
+            }
+            numberAdded += actual.addArrivals(times, fieldValues, actualResourceMonitor);
+        }
+
+        CPPUNIT_ASSERT_EQUAL(expected.checksum(), actual.checksum());
+        CPPUNIT_ASSERT_EQUAL(expected.numberActivePeople(), actual.numberActivePeople());
+
+        TFeatureSizeSizePrFeatureDataPrVecPrVec expectedFeatureData;
+        TFeatureSizeSizePrFeatureDataPrVecPrVec actualFeatureData;
+        expected.featureData(bucketStart, bucketLength, expectedFeatureData);
+        actual.featureData(bucketStart, bucketLength, actualFeatureData);
+        CPPUNIT_ASSERT_EQUAL(core::CContainerPrinter::print(expectedFeatureData),
+                             core::CContainerPrinter::print(actualFeatureData));
+
+        expected.sampleNow(bucketStart);
+        actual.sampleNow(bucketStart);
+    }
+
+    // Records without a value aren't added.
+    LOG_DEBUG(<< "added " << numberAdded << " records");
+    CPPUNIT_ASSERT(numberAdded > 0);
+    CPPUNIT_ASSERT(numberAdded < numberBuckets * numberRecordsPerBucket);
+}
+
 CppUnit::Test* CMetricDataGathererTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CMetricDataGathererTest");
 
@@ -1934,5 +2240,12 @@ CppUnit::Test* CMetricDataGathererTest::suite() {
         &CMetricDataGathererTest::testStatisticsPersist));
     suiteOfTests->addTest(new CppUnit::TestCaller<CMetricDataGathererTest>(
         "CMetricDataGathererTest::testVarp", &CMetricDataGathererTest::testVarp));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CMetricDataGathererTest>(
+        "CMetricDataGathererTest::testPerformance", &CMetricDataGathererTest::testPerformance));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CMetricDataGathererTest>(
+        "CMetricDataGathererTest::testIncrementalMemoryUsage",
+        &CMetricDataGathererTest::testIncrementalMemoryUsage));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CMetricDataGathererTest>(
+        "CMetricDataGathererTest::testAddArrivals", &CMetricDataGathererTest::testAddArrivals));
     return suiteOfTests;
 }
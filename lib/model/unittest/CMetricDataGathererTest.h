@@ -25,6 +25,9 @@ public:
     void testMultivariate();
     void testStatisticsPersist();
     void testVarp();
+    void testPerformance();
+    void testIncrementalMemoryUsage();
+    void testAddArrivals();
 
     static CppUnit::Test* suite();
 
@@ -8,9 +8,11 @@
 
 #include <core/CContainerPrinter.h>
 #include <core/CLogger.h>
+#include <core/CMemoryUsage.h>
 #include <core/CRapidXmlParser.h>
 #include <core/CRapidXmlStatePersistInserter.h>
 #include <core/CRapidXmlStateRestoreTraverser.h>
+#include <core/CStaticThreadPool.h>
 #include <core/Constants.h>
 #include <core/CoreTypes.h>
 
@@ -2501,6 +2503,160 @@ void CMetricModelTest::testIgnoreSamplingGivenDetectionRules() {
     // CPPUNIT_ASSERT_EQUAL(time, timeSeriesModel->trend().lastValueTime());
 }
 
+void CMetricModelTest::testSampleConcurrently() {
+    // Check that sampling people's models on a thread pool gives exactly
+    // the same models as sampling them on the calling thread. Each person
+    // draws from their own random number stream, so this holds whichever
+    // thread samples them.
+
+    core_t::TTime startTime = 0;
+    core_t::TTime bucketLength = 600;
+    std::size_t numberPeople = 1000;
+    model_t::TFeatureVec features{model_t::E_IndividualMeanByPerson,
+                                  model_t::E_IndividualMaxByPerson};
+
+    core::CStaticThreadPool threadPool{3};
+
+    SModelParams params(bucketLength);
+    auto interimBucketCorrector = std::make_shared<CInterimBucketCorrector>(bucketLength);
+    CMetricModelFactory factory(params, interimBucketCorrector);
+    factory.features(features);
+    CModelFactory::TDataGathererPtr gatherer(factory.makeDataGatherer(startTime));
+    CModelFactory::TModelPtr model(factory.makeModel(gatherer));
+
+    params.s_ThreadPool = &threadPool;
+    CMetricModelFactory concurrentFactory(params, interimBucketCorrector);
+    concurrentFactory.features(features);
+    CModelFactory::TDataGathererPtr concurrentGatherer(
+        concurrentFactory.makeDataGatherer(startTime));
+    CModelFactory::TModelPtr concurrentModel(concurrentFactory.makeModel(concurrentGatherer));
+
+    TStrVec people;
+    for (std::size_t i = 0u; i < numberPeople; ++i) {
+        people.push_back("p" + core::CStringUtils::typeToString(i));
+    }
+
+    test::CRandomNumbers rng;
+
+    TDoubleVec values;
+    for (core_t::TTime time = startTime; time < startTime + 100 * bucketLength;
+         time += bucketLength) {
+        rng.generateNormalSamples(10.0, 4.0, 3 * numberPeople, values);
+        for (std::size_t i = 0u; i < values.size(); ++i) {
+            core_t::TTime time_ = time + static_cast<core_t::TTime>(i % 3) * 100;
+            addArrival(*gatherer, m_ResourceMonitor, time_,
+                       people[i % numberPeople], values[i]);
+            addArrival(*concurrentGatherer, m_ResourceMonitor, time_,
+                       people[i % numberPeople], values[i]);
+        }
+        model->sample(time, time + bucketLength, m_ResourceMonitor);
+        concurrentModel->sample(time, time + bucketLength, m_ResourceMonitor);
+    }
+
+    CPPUNIT_ASSERT_EQUAL(model->checksum(), concurrentModel->checksum());
+}
+
+void CMetricModelTest::testCloneForPersistenceCopiesOnWrite() {
+    // Check that a clone for persistence shares the models with the original,
+    // that updating the original doesn't change the clone's state and that
+    // taking the clone doesn't change how the original evolves.
+
+    core_t::TTime startTime = 0;
+    core_t::TTime bucketLength = 600;
+    std::size_t numberPeople = 50;
+    model_t::TFeatureVec features{model_t::E_IndividualMeanByPerson,
+                                  model_t::E_IndividualMaxByPerson};
+
+    SModelParams params(bucketLength);
+    auto interimBucketCorrector = std::make_shared<CInterimBucketCorrector>(bucketLength);
+    CMetricModelFactory factory(params, interimBucketCorrector);
+    factory.features(features);
+    CModelFactory::TDataGathererPtr gatherer(factory.makeDataGatherer(startTime));
+    CModelFactory::TModelPtr model(factory.makeModel(gatherer));
+    CModelFactory::TDataGathererPtr expectedGatherer(factory.makeDataGatherer(startTime));
+    CModelFactory::TModelPtr expectedModel(factory.makeModel(expectedGatherer));
+
+    TStrVec people;
+    for (std::size_t i = 0u; i < numberPeople; ++i) {
+        people.push_back("p" + core::CStringUtils::typeToString(i));
+    }
+
+    test::CRandomNumbers rng;
+
+    auto addBuckets = [&](core_t::TTime begin, core_t::TTime end) {
+        TDoubleVec values;
+        for (core_t::TTime time = begin; time < end; time += bucketLength) {
+            rng.generateNormalSamples(10.0, 4.0, 3 * numberPeople, values);
+            for (std::size_t i = 0u; i < values.size(); ++i) {
+                core_t::TTime time_ = time + static_cast<core_t::TTime>(i % 3) * 100;
+                addArrival(*gatherer, m_ResourceMonitor, time_,
+                           people[i % numberPeople], values[i]);
+                addArrival(*expectedGatherer, m_ResourceMonitor, time_,
+                           people[i % numberPeople], values[i]);
+            }
+            model->sample(time, time + bucketLength, m_ResourceMonitor);
+            expectedModel->sample(time, time + bucketLength, m_ResourceMonitor);
+        }
+    };
+    auto persist = [](const CAnomalyDetectorModel& model_) {
+        std::string result;
+        core::CRapidXmlStatePersistInserter inserter("root");
+        model_.acceptPersistInserter(inserter);
+        inserter.toXml(result);
+        return result;
+    };
+    auto memoryUsage = [](const CAnomalyDetectorModel& model_) {
+        core::CMemoryUsage mem;
+        model_.debugMemoryUsage(&mem);
+        return mem.usage();
+    };
+
+    core_t::TTime time = startTime + 20 * bucketLength;
+    addBuckets(startTime, time);
+    std::string expectedXml{persist(*model)};
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), model->sharedMemoryUsage());
+
+    CModelFactory::TModelPtr clone(model->cloneForPersistence());
+    // The clone shares the data gatherer, whose memory is split between its
+    // users, so add a user of the expected gatherer for a like comparison.
+    CModelFactory::TDataGathererPtr expectedGathererUser(expectedGatherer);
+    LOG_DEBUG(<< "shared memory = " << model->sharedMemoryUsage());
+    LOG_DEBUG(<< "memory = " << memoryUsage(*model));
+    CPPUNIT_ASSERT(model->sharedMemoryUsage() > 0);
+    CPPUNIT_ASSERT_EQUAL(model->sharedMemoryUsage(), clone->sharedMemoryUsage());
+    CPPUNIT_ASSERT_EQUAL(memoryUsage(*expectedModel), memoryUsage(*model));
+
+    // Reading the models mustn't copy them.
+    std::size_t sharedMemoryUsage{model->sharedMemoryUsage()};
+    model_t::CResultType type(model_t::CResultType::E_Unconditional |
+                              model_t::CResultType::E_Final);
+    for (std::size_t pid = 0u; pid < numberPeople; ++pid) {
+        model->baselineBucketMean(model_t::E_IndividualMeanByPerson, pid, 0,
+                                  type, NO_CORRELATES, time - bucketLength);
+    }
+    CPPUNIT_ASSERT_EQUAL(sharedMemoryUsage, model->sharedMemoryUsage());
+
+    // Computing probabilities updates the anomaly models so does copy them.
+    CPartitioningFields partitioningFields(EMPTY_STRING, EMPTY_STRING);
+    for (std::size_t pid = 0u; pid < numberPeople; ++pid) {
+        for (auto& model_ : {model.get(), expectedModel.get()}) {
+            SAnnotatedProbability probability;
+            CPPUNIT_ASSERT(model_->computeProbability(pid, time - bucketLength, time,
+                                                      partitioningFields, 1, probability));
+        }
+    }
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), model->sharedMemoryUsage());
+    CPPUNIT_ASSERT_EQUAL(expectedXml, persist(*clone));
+
+    addBuckets(time, time + 20 * bucketLength);
+
+    // Every person's models have been updated so none are shared.
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), model->sharedMemoryUsage());
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), clone->sharedMemoryUsage());
+    CPPUNIT_ASSERT_EQUAL(expectedXml, persist(*clone));
+    CPPUNIT_ASSERT_EQUAL(expectedModel->checksum(), model->checksum());
+}
+
 CppUnit::Test* CMetricModelTest::suite() {
     CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CMetricModelTest");
 
@@ -2567,6 +2723,11 @@ CppUnit::Test* CMetricModelTest::suite() {
     suiteOfTests->addTest(new CppUnit::TestCaller<CMetricModelTest>(
         "CMetricModelTest::testIgnoreSamplingGivenDetectionRules",
         &CMetricModelTest::testIgnoreSamplingGivenDetectionRules));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CMetricModelTest>(
+        "CMetricModelTest::testSampleConcurrently", &CMetricModelTest::testSampleConcurrently));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CMetricModelTest>(
+        "CMetricModelTest::testCloneForPersistenceCopiesOnWrite",
+        &CMetricModelTest::testCloneForPersistenceCopiesOnWrite));
 
     return suiteOfTests;
 }
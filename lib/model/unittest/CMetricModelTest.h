@@ -48,6 +48,8 @@ public:
     void testSummaryCountZeroRecordsAreIgnored();
     void testDecayRateControl();
     void testIgnoreSamplingGivenDetectionRules();
+    void testSampleConcurrently();
+    void testCloneForPersistenceCopiesOnWrite();
 
     void setUp();
     static CppUnit::Test* suite();
@@ -0,0 +1,278 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+
+#include "CPersonAttributeCountsTest.h"
+
+#include <core/CLogger.h>
+#include <core/CMemory.h>
+#include <core/CStopWatch.h>
+
+#include <model/CBucketQueue.h>
+#include <model/CDataGatherer.h>
+#include <model/CEventData.h>
+#include <model/CModelParams.h>
+#include <model/CPersonAttributeCounts.h>
+#include <model/CResourceMonitor.h>
+#include <model/CSearchKey.h>
+
+#include <test/CRandomNumbers.h>
+
+#include <boost/unordered_map.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace ml;
+using namespace model;
+
+namespace {
+using TSizeVec = std::vector<std::size_t>;
+using TStrVec = std::vector<std::string>;
+using TSizeSizePr = std::pair<std::size_t, std::size_t>;
+using TSizeSizePrUInt64Pr = std::pair<TSizeSizePr, uint64_t>;
+using TSizeSizePrUInt64PrVec = std::vector<TSizeSizePrUInt64Pr>;
+using TSizeSizePrUInt64UMap = boost::unordered_map<TSizeSizePr, uint64_t>;
+
+void checkEqual(const TSizeSizePrUInt64UMap& expected, const CPersonAttributeCounts& counts) {
+    CPPUNIT_ASSERT_EQUAL(expected.size(), counts.size());
+    CPPUNIT_ASSERT_EQUAL(expected.empty(), counts.empty());
+    for (const auto& count : expected) {
+        auto i = counts.find(count.first);
+        CPPUNIT_ASSERT(i != counts.end());
+        CPPUNIT_ASSERT_EQUAL(count.second, i->second);
+    }
+    TSizeSizePrUInt64PrVec expected_(expected.begin(), expected.end());
+    TSizeSizePrUInt64PrVec actual(counts.begin(), counts.end());
+    std::sort(expected_.begin(), expected_.end());
+    std::sort(actual.begin(), actual.end());
+    CPPUNIT_ASSERT(expected_ == actual);
+}
+}
+
+void CPersonAttributeCountsTest::testCounts() {
+    // Test we get the same counts as boost::unordered_map.
+
+    test::CRandomNumbers rng;
+
+    for (std::size_t numberKeys : {1, 10, 100, 1000, 10000}) {
+        LOG_DEBUG(<< "# keys = " << numberKeys);
+
+        TSizeVec people;
+        TSizeVec attributes;
+        TSizeVec counts;
+        rng.generateUniformSamples(0, numberKeys, 5 * numberKeys, people);
+        rng.generateUniformSamples(0, 10, 5 * numberKeys, attributes);
+        rng.generateUniformSamples(1, 20, 5 * numberKeys, counts);
+
+        TSizeSizePrUInt64UMap expected;
+        CPersonAttributeCounts actual;
+        CPPUNIT_ASSERT(actual.empty());
+        CPPUNIT_ASSERT(actual.find({0, 0}) == actual.end());
+
+        for (std::size_t i = 0u; i < people.size(); ++i) {
+            TSizeSizePr key{people[i], attributes[i]};
+            expected[key] += counts[i];
+            actual[key] += counts[i];
+            CPPUNIT_ASSERT_EQUAL(expected[key], actual.find(key)->second);
+        }
+        checkEqual(expected, actual);
+
+        const CPersonAttributeCounts& constActual = actual;
+        CPPUNIT_ASSERT(constActual.find({numberKeys, 0}) == constActual.end());
+        CPPUNIT_ASSERT(constActual.find({0, 10}) == constActual.end());
+    }
+}
+
+void CPersonAttributeCountsTest::testErase() {
+    // Test erasing while iterating and inserting after erasing.
+
+    test::CRandomNumbers rng;
+
+    TSizeVec people;
+    TSizeVec attributes;
+    rng.generateUniformSamples(0, 200, 2000, people);
+    rng.generateUniformSamples(0, 5, 2000, attributes);
+
+    TSizeSizePrUInt64UMap expected;
+    CPersonAttributeCounts actual;
+
+    for (std::size_t round = 0u; round < 10; ++round) {
+        for (std::size_t i = 0u; i < people.size(); ++i) {
+            TSizeSizePr key{(people[i] + 17 * round) % 200, attributes[i]};
+            ++expected[key];
+            ++actual[key];
+        }
+        checkEqual(expected, actual);
+
+        // Remove every person which is a multiple of the round plus two.
+        for (auto i = expected.begin(); i != expected.end(); /**/) {
+            i = i->first.first % (round + 2) == 0 ? expected.erase(i) : ++i;
+        }
+        for (auto i = actual.begin(); i != actual.end(); /**/) {
+            i = i->first.first % (round + 2) == 0 ? actual.erase(i) : ++i;
+        }
+        LOG_DEBUG(<< "size = " << actual.size());
+        checkEqual(expected, actual);
+    }
+
+    for (auto i = actual.begin(); i != actual.end(); /**/) {
+        i = actual.erase(i);
+    }
+    CPPUNIT_ASSERT(actual.empty());
+    CPPUNIT_ASSERT(actual.find({people[0], attributes[0]}) == actual.end());
+}
+
+void CPersonAttributeCountsTest::testClear() {
+    // Test that clearing removes all counts and keeps the memory
+    // for the next bucket.
+
+    CPersonAttributeCounts counts;
+    for (std::size_t i = 0u; i < 1000; ++i) {
+        counts[{i, i % 7}] += i;
+    }
+    std::size_t memory{core::CMemory::dynamicSize(counts)};
+    LOG_DEBUG(<< "memory = " << memory);
+    CPPUNIT_ASSERT(memory > 0);
+
+    for (std::size_t bucket = 0u; bucket < 10; ++bucket) {
+        counts.clear();
+        CPPUNIT_ASSERT(counts.empty());
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), counts.size());
+        CPPUNIT_ASSERT(counts.begin() == counts.end());
+        for (std::size_t i = 0u; i < 1000; ++i) {
+            CPPUNIT_ASSERT(counts.find({i, i % 7}) == counts.end());
+        }
+
+        TSizeSizePrUInt64UMap expected;
+        for (std::size_t i = 0u; i < 1000; ++i) {
+            expected[{i + bucket, i % 7}] += 2;
+            counts[{i + bucket, i % 7}] += 2;
+        }
+        checkEqual(expected, counts);
+        CPPUNIT_ASSERT_EQUAL(memory, core::CMemory::dynamicSize(counts));
+    }
+}
+
+void CPersonAttributeCountsTest::testPerformance() {
+    // Compare the cost of counting records and turning over buckets
+    // with boost::unordered_map and the rate at which a population
+    // gatherer adds records.
+
+    const core_t::TTime startTime{0};
+    const core_t::TTime bucketLength{600};
+    const std::size_t numberBuckets{20};
+    const std::size_t numberPeople{2000};
+    const std::size_t numberAttributes{50};
+    const std::size_t numberRecords{50000};
+
+    test::CRandomNumbers rng;
+
+    TSizeVec people;
+    TSizeVec attributes;
+    rng.generateUniformSamples(0, numberPeople, numberRecords, people);
+    rng.generateUniformSamples(0, numberAttributes, numberRecords, attributes);
+
+    uint64_t countsTime{0};
+    uint64_t countsTurnoverTime{0};
+    uint64_t countsTotal{0};
+    {
+        CBucketQueue<CPersonAttributeCounts> queue(2, bucketLength, startTime);
+        core::CStopWatch watch;
+        core::CStopWatch turnoverWatch;
+        for (std::size_t bucket = 0u; bucket < numberBuckets; ++bucket) {
+            watch.start();
+            for (std::size_t i = 0u; i < numberRecords; ++i) {
+                ++queue.latest()[{people[i], attributes[i]}];
+            }
+            countsTime = watch.stop();
+            countsTotal += queue.latest().size();
+            turnoverWatch.start();
+            queue.recycle(startTime + static_cast<core_t::TTime>(bucket + 1) * bucketLength,
+                          [](CPersonAttributeCounts& counts) { counts.clear(); });
+            countsTurnoverTime = turnoverWatch.stop();
+        }
+    }
+
+    uint64_t umapTime{0};
+    uint64_t umapTurnoverTime{0};
+    uint64_t umapTotal{0};
+    {
+        CBucketQueue<TSizeSizePrUInt64UMap> queue(2, bucketLength, startTime,
+                                                  TSizeSizePrUInt64UMap(1));
+        core::CStopWatch watch;
+        core::CStopWatch turnoverWatch;
+        for (std::size_t bucket = 0u; bucket < numberBuckets; ++bucket) {
+            watch.start();
+            for (std::size_t i = 0u; i < numberRecords; ++i) {
+                ++queue.latest()[{people[i], attributes[i]}];
+            }
+            umapTime = watch.stop();
+            umapTotal += queue.latest().size();
+            turnoverWatch.start();
+            queue.push(TSizeSizePrUInt64UMap(1),
+                       startTime + static_cast<core_t::TTime>(bucket + 1) * bucketLength);
+            umapTurnoverTime = turnoverWatch.stop();
+        }
+    }
+
+    LOG_DEBUG(<< "counts time = " << countsTime << "ms, turnover time = " << countsTurnoverTime
+              << "ms");
+    LOG_DEBUG(<< "unordered map time = " << umapTime
+              << "ms, turnover time = " << umapTurnoverTime << "ms");
+    CPPUNIT_ASSERT_EQUAL(umapTotal, countsTotal);
+
+    TStrVec personNames;
+    TStrVec attributeNames;
+    for (std::size_t i = 0u; i < numberPeople; ++i) {
+        personNames.push_back("p" + std::to_string(i));
+    }
+    for (std::size_t i = 0u; i < numberAttributes; ++i) {
+        attributeNames.push_back("a" + std::to_string(i));
+    }
+
+    const std::string EMPTY_STRING;
+    CResourceMonitor resourceMonitor;
+    CDataGatherer::TFeatureVec features{model_t::E_PopulationCountByBucketPersonAndAttribute,
+                                        model_t::E_PopulationUniquePersonCountByAttribute};
+    SModelParams params(bucketLength);
+    CDataGatherer gatherer(model_t::E_PopulationEventRate, model_t::E_None, params,
+                           EMPTY_STRING, EMPTY_STRING, EMPTY_STRING, EMPTY_STRING,
+                           EMPTY_STRING, {}, CSearchKey(), features, startTime, 0);
+
+    core::CStopWatch watch{true};
+    for (std::size_t bucket = 0u; bucket < numberBuckets; ++bucket) {
+        core_t::TTime time{startTime + static_cast<core_t::TTime>(bucket) * bucketLength};
+        for (std::size_t i = 0u; i < numberRecords; ++i) {
+            CDataGatherer::TStrCPtrVec fields{&personNames[people[i]],
+                                              &attributeNames[attributes[i]]};
+            CEventData eventData;
+            eventData.time(time + static_cast<core_t::TTime>(i) % bucketLength);
+            gatherer.addArrival(fields, eventData, resourceMonitor);
+        }
+    }
+    uint64_t gathererTime{watch.stop()};
+    LOG_DEBUG(<< "gatherer time = " << gathererTime << "ms, records/sec = "
+              << 1000.0 * static_cast<double>(numberBuckets * numberRecords) /
+                     static_cast<double>(std::max(gathererTime, uint64_t(1))));
+    CPPUNIT_ASSERT_EQUAL(numberPeople, gatherer.numberActivePeople());
+}
+
+CppUnit::Test* CPersonAttributeCountsTest::suite() {
+    CppUnit::TestSuite* suiteOfTests = new CppUnit::TestSuite("CPersonAttributeCountsTest");
+
+    suiteOfTests->addTest(new CppUnit::TestCaller<CPersonAttributeCountsTest>(
+        "CPersonAttributeCountsTest::testCounts", &CPersonAttributeCountsTest::testCounts));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CPersonAttributeCountsTest>(
+        "CPersonAttributeCountsTest::testErase", &CPersonAttributeCountsTest::testErase));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CPersonAttributeCountsTest>(
+        "CPersonAttributeCountsTest::testClear", &CPersonAttributeCountsTest::testClear));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CPersonAttributeCountsTest>(
+        "CPersonAttributeCountsTest::testPerformance",
+        &CPersonAttributeCountsTest::testPerformance));
+
+    return suiteOfTests;
+}
@@ -0,0 +1,21 @@
+/*
+ * Copyright Elasticsearch B.V. and/or licensed to Elasticsearch B.V. under one
+ * or more contributor license agreements. Licensed under the Elastic License;
+ * you may not use this file except in compliance with the Elastic License.
+ */
+#ifndef INCLUDED_CPersonAttributeCountsTest_h
+#define INCLUDED_CPersonAttributeCountsTest_h
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class CPersonAttributeCountsTest : public CppUnit::TestFixture {
+public:
+    void testCounts();
+    void testErase();
+    void testClear();
+    void testPerformance();
+
+    static CppUnit::Test* suite();
+};
+
+#endif // INCLUDED_CPersonAttributeCountsTest_h
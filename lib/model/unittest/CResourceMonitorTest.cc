@@ -5,6 +5,8 @@
  */
 #include "CResourceMonitorTest.h"
 
+#include <core/CMemory.h>
+
 #include <model/CAnomalyDetector.h>
 #include <model/CAnomalyDetectorModelConfig.h>
 #include <model/CHierarchicalResults.h>
@@ -13,6 +15,7 @@
 #include <model/CResourceMonitor.h>
 #include <model/CStringStore.h>
 
+#include <cmath>
 #include <string>
 
 using namespace ml;
@@ -27,6 +30,9 @@ CppUnit::Test* CResourceMonitorTest::suite() {
         "CResourceMonitorTest::testPruning", &CResourceMonitorTest::testPruning));
     suiteOfTests->addTest(new CppUnit::TestCaller<CResourceMonitorTest>(
         "CResourceMonitorTest::testExtraMemory", &CResourceMonitorTest::testExtraMemory));
+    suiteOfTests->addTest(new CppUnit::TestCaller<CResourceMonitorTest>(
+        "CResourceMonitorTest::testIncrementalAccounting",
+        &CResourceMonitorTest::testIncrementalAccounting));
     return suiteOfTests;
 }
 
@@ -396,6 +402,9 @@ void CResourceMonitorTest::testExtraMemory() {
     CPPUNIT_ASSERT(monitor.areAllocationsAllowed());
     CPPUNIT_ASSERT_EQUAL(allocationLimit - 200, monitor.allocationLimit());
 
+    monitor.removeExtraMemory(100);
+    CPPUNIT_ASSERT_EQUAL(allocationLimit - 100, monitor.allocationLimit());
+
     monitor.clearExtraMemory();
     CPPUNIT_ASSERT(monitor.areAllocationsAllowed());
     CPPUNIT_ASSERT_EQUAL(allocationLimit, monitor.allocationLimit());
@@ -405,11 +414,100 @@ void CResourceMonitorTest::testExtraMemory() {
     CPPUNIT_ASSERT(monitor.areAllocationsAllowed() == false);
     CPPUNIT_ASSERT_EQUAL(std::size_t(0), monitor.allocationLimit());
 
+    monitor.removeExtraMemory(1024 * 1024);
+    CPPUNIT_ASSERT(monitor.areAllocationsAllowed());
+    CPPUNIT_ASSERT_EQUAL(allocationLimit, monitor.allocationLimit());
+
+    monitor.addExtraMemory(1024 * 1024);
+
     monitor.clearExtraMemory();
     CPPUNIT_ASSERT(monitor.areAllocationsAllowed());
     CPPUNIT_ASSERT_EQUAL(allocationLimit, monitor.allocationLimit());
 }
 
+void CResourceMonitorTest::testIncrementalAccounting() {
+    // Check that the memory usage recorded between audits tracks the
+    // full calculation while people are being added and pruned.
+
+    const std::string EMPTY_STRING;
+    const core_t::TTime FIRST_TIME(358556400);
+    const core_t::TTime BUCKET_LENGTH(3600);
+
+    CAnomalyDetectorModelConfig modelConfig =
+        CAnomalyDetectorModelConfig::defaultConfig(BUCKET_LENGTH);
+    CLimits limits;
+
+    CSearchKey key(1, // identifier
+                   function_t::E_IndividualMetric, false, model_t::E_XF_None,
+                   "value", "colour");
+
+    CResourceMonitor& monitor = limits.resourceMonitor();
+    monitor.fullAuditPeriod(100000);
+
+    CAnomalyDetector detector(1, // identifier
+                              limits, modelConfig, EMPTY_STRING, FIRST_TIME,
+                              modelConfig.factory(key));
+
+    monitor.forceRefresh(detector);
+    std::size_t initialUsage{monitor.m_Detectors[&detector].s_Usage};
+
+    core_t::TTime bucket = FIRST_TIME;
+    std::size_t startOffset = 10;
+    for (std::size_t i = 0u; i < 5; ++i) {
+        this->addTestData(bucket, BUCKET_LENGTH, 20, 10, startOffset, detector, monitor);
+
+        std::size_t recorded{monitor.m_Detectors[&detector].s_Usage};
+        std::size_t actual{core::CMemory::dynamicSize(&detector)};
+        double error{std::fabs(static_cast<double>(recorded) - static_cast<double>(actual)) /
+                     static_cast<double>(actual)};
+        LOG_DEBUG(<< "recorded = " << recorded << ", actual = " << actual
+                  << ", error = " << error);
+        CPPUNIT_ASSERT(recorded > initialUsage);
+        CPPUNIT_ASSERT(error < 0.1);
+    }
+
+    // Pruning should release memory without an audit.
+    std::size_t usageBeforePruning{monitor.m_Detectors[&detector].s_Usage};
+    detector.model()->prune(1);
+    monitor.refresh(detector);
+    std::size_t recorded{monitor.m_Detectors[&detector].s_Usage};
+    std::size_t actual{core::CMemory::dynamicSize(&detector)};
+    LOG_DEBUG(<< "after pruning recorded = " << recorded << ", actual = " << actual);
+    CPPUNIT_ASSERT(recorded < usageBeforePruning);
+    CPPUNIT_ASSERT(std::fabs(static_cast<double>(recorded) - static_cast<double>(actual)) <
+                   0.1 * static_cast<double>(actual));
+
+    // An audit should correct any drift.
+    monitor.forceRefresh(detector);
+    CPPUNIT_ASSERT_EQUAL(core::CMemory::dynamicSize(&detector),
+                         monitor.m_Detectors[&detector].s_Usage);
+
+    // With a period of one every refresh should be an audit.
+    monitor.fullAuditPeriod(1);
+    this->addTestData(bucket, BUCKET_LENGTH, 3, 10, startOffset, detector, monitor);
+    monitor.refresh(detector);
+    CPPUNIT_ASSERT_EQUAL(core::CMemory::dynamicSize(&detector),
+                         monitor.m_Detectors[&detector].s_Usage);
+
+    // Away from the limits refreshes shouldn't audit, but they should
+    // once the error bound means the usage could be over a limit.
+    monitor.fullAuditPeriod(100000);
+    monitor.forceRefresh(detector);
+    std::size_t total{monitor.totalMemory()};
+    monitor.m_ByteLimitMargin = 1.0;
+    monitor.m_ByteLimitHigh = 2 * total;
+    for (std::size_t i = 0u; i < 5; ++i) {
+        CPPUNIT_ASSERT(monitor.isAuditDue(monitor.m_Detectors[&detector]) == false);
+        monitor.refresh(detector);
+    }
+    CPPUNIT_ASSERT(monitor.m_ErrorBound > 0);
+    CPPUNIT_ASSERT(monitor.m_ErrorBound < total / 10);
+    monitor.m_ByteLimitHigh = monitor.totalMemory() + monitor.m_ErrorBound;
+    CPPUNIT_ASSERT(monitor.isAuditDue(monitor.m_Detectors[&detector]));
+    monitor.refresh(detector);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), monitor.m_ErrorBound);
+}
+
 void CResourceMonitorTest::addTestData(core_t::TTime& firstTime,
                                        const core_t::TTime bucketLength,
                                        const std::size_t buckets,
@@ -23,6 +23,7 @@ public:
     void testMonitor();
     void testPruning();
     void testExtraMemory();
+    void testIncrementalAccounting();
 
     static CppUnit::Test* suite();
 
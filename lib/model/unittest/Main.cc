@@ -35,6 +35,7 @@
 #include "CModelMemoryTest.h"
 #include "CModelToolsTest.h"
 #include "CModelTypesTest.h"
+#include "CPersonAttributeCountsTest.h"
 #include "CProbabilityAndInfluenceCalculatorTest.h"
 #include "CResourceLimitTest.h"
 #include "CResourceMonitorTest.h"
@@ -75,6 +76,7 @@ int main(int argc, const char** argv) {
     runner.addTest(CModelMemoryTest::suite());
     runner.addTest(CModelToolsTest::suite());
     runner.addTest(CModelTypesTest::suite());
+    runner.addTest(CPersonAttributeCountsTest::suite());
     runner.addTest(CProbabilityAndInfluenceCalculatorTest::suite());
     runner.addTest(CResourceLimitTest::suite());
     runner.addTest(CResourceMonitorTest::suite());